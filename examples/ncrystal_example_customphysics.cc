@@ -60,6 +60,7 @@
 //We also use NCrystal::str2dbl from:
 #include "NCrystal/internal/NCString.hh"
 
+#include <algorithm>
 #include <iostream>
 
 namespace NC = NCrystal;
@@ -88,6 +89,21 @@ public:
     return { ekin_final, mu };
   }
 
+  //Optionally, models can also reimplement the batched methods, handling many
+  //neutrons in a single call, and advertise this (and the fact that the model
+  //never uses the CachePtr) via the capabilities() method. Callers like
+  //ProcComposition then route entire batches of neutrons to the model:
+  void crossSectionIsotropicMany( NC::CachePtr&, const double*,
+                                  std::size_t N, double* out_xs ) const override
+  {
+    std::fill( out_xs, out_xs + N, m_sigma.dbl() );
+  }
+
+  unsigned capabilities() const noexcept override
+  {
+    return CapBatchCrossSection | CapStateless;
+  }
+
 private:
   NC::CrossSect m_sigma;
 };
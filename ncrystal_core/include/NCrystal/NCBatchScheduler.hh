@@ -0,0 +1,86 @@
+#ifndef NCrystal_BatchScheduler_hh
+#define NCrystal_BatchScheduler_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCProc.hh"
+
+namespace NCrystal {
+
+  //////////////////////////////////////////////////////////////////////////////
+  //                                                                          //
+  // Scheduler for queues of neutrons in mixed materials, intended for        //
+  // event based transport codes. Neutrons are queued in arbitrary order,     //
+  // each referring to one of the registered processes. When evaluating the   //
+  // queue, the neutrons are grouped by process and sorted by energy (and for //
+  // oriented processes first by a coarse discretisation of their direction), //
+  // and each group is then handed to the batched methods of its process in a //
+  // single call. Thus, caches inside the processes (which are usually keyed  //
+  // on the neutron energy) see neutrons in an order which maximises reuse.   //
+  // Results are written back in the original order of the queue.             //
+  //                                                                          //
+  // A scheduler holds a cache for each registered process, and must not be   //
+  // used concurrently by several threads (multi-threaded applications should //
+  // use a scheduler in each thread, registering the same processes).         //
+  //                                                                          //
+  //////////////////////////////////////////////////////////////////////////////
+
+  class NCRYSTAL_API BatchScheduler final : private MoveOnly {
+  public:
+
+    BatchScheduler();
+    ~BatchScheduler();
+    BatchScheduler( BatchScheduler&& );
+    BatchScheduler& operator=( BatchScheduler&& );
+
+    //Register a process, returning the index used to refer to it when queuing
+    //neutrons (registering the same process again returns the same index):
+    unsigned addProcess( ProcImpl::ProcPtr );
+    unsigned addProcess( const Process& p ) { return addProcess( p.underlyingPtr() ); }
+    std::size_t nProcesses() const noexcept;
+
+    //Queue a neutron in the process with the given index:
+    void add( unsigned iproc, NeutronEnergy, const NeutronDirection& );
+    std::size_t size() const noexcept;
+
+    //Remove all queued neutrons (registered processes and their caches are
+    //kept, and so is any memory allocated for the queue):
+    void clear() noexcept;
+
+    //Evaluate cross sections of all queued neutrons, writing them to the
+    //out_xs array (which must hold size() entries) in queue order:
+    void crossSections( double* out_xs );
+
+    //Sample scatterings of all queued neutrons, writing them to the out array
+    //(which must hold size() entries) in queue order. All processes with
+    //queued neutrons must be scattering processes. Random numbers are
+    //consumed in the sorted order, so results are only statistically (not
+    //event-by-event) equivalent to those of sampling the neutrons one by one:
+    void sampleScatters( RNG&, ScatterOutcome* out );
+
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+  };
+
+}
+
+#endif
@@ -51,6 +51,18 @@ namespace NCrystal {
                                                     const NaturalAbundanceProvider&,
                                                     ForceIsotopesChoice = PreferNaturalElements );
 
+    //Versions starting from the flattened composition cached on the Info
+    //object (Info::getFlatComposition), thus avoiding the recursive breakdown
+    //of composite atoms in repeated calls. Results are the same as for the
+    //versions taking info.getComposition(), up to rounding errors:
+    NCRYSTAL_API FullBreakdown createFullBreakdown( const Info&,
+                                                    const NaturalAbundanceProvider&,
+                                                    ForceIsotopesChoice = PreferNaturalElements );
+
+    //Flatten composition into natural elements and isotopes (application
+    //code should normally use the cached Info::getFlatComposition instead):
+    NCRYSTAL_API Info::FlatComposition flattenComposition( const Info::Composition& );
+
 
     class NCRYSTAL_API ElementBreakdownLW : private MoveOnly {
       //Struct for keeping isotope breakdown of a particular element. Care is taken
@@ -82,6 +94,9 @@ namespace NCrystal {
     NCRYSTAL_API LWBreakdown createLWBreakdown( const Info::Composition& a,
                                                 const NaturalAbundanceProvider& b,
                                                 ForceIsotopesChoice c = PreferNaturalElements );
+    NCRYSTAL_API LWBreakdown createLWBreakdown( const Info& a,
+                                                const NaturalAbundanceProvider& b,
+                                                ForceIsotopesChoice c = PreferNaturalElements );
   }
 }
 
@@ -141,10 +141,20 @@ namespace NCrystal {
 
     // Disable all standard data sources, remove all TextData factories as well,
     // clear all registered virtual files and custom search directories. Finish
-    // by calling global clearCaches function ("Ripley: I say we take off and
-    // nuke the entire site from orbit. It's the only way to be sure."):
+    // by evicting all cached objects created from input data (cf. the
+    // evictFromCaches functions in NCFact.hh). Caches of objects which do not
+    // depend on input data are kept, so call the global clearCaches function
+    // afterwards for a full reset ("Ripley: I say we take off and nuke the
+    // entire site from orbit. It's the only way to be sure."):
     NCRYSTAL_API void removeAllDataSources();
 
+    ////////////////////////////////////////////////////////////////////////////
+    //Resolve and load several files at once. This is equivalent to calling
+    //FactImpl::createTextData for each name in turn, but the files are loaded
+    //concurrently (using up to getNumberOfThreads() threads). The results are
+    //returned in the same order as the requested names:
+    NCRYSTAL_API std::vector<TextDataSP> resolveMany( const VectS& names );
+
     ////////////////////////////////////////////////////////////////////////////
     //For "browsing" available files. This information is ultimately provided by
     //factories, and might not be exhaustive. For instance, absolute paths are
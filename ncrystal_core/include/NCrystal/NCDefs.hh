@@ -165,6 +165,11 @@ namespace NCrystal {
     double operator()();
     double generate();
 
+    //Fill out[0..n-1] with numbers uniformly in interval (0.0,1.0]. The result
+    //is identical to n calls to generate(), but avoids the per-number overhead
+    //of virtual calls for streams implementing actualGenerateMany:
+    void generateMany( double* out, std::size_t n );
+
     //Generate integer uniformly in { 0, 1, ..., N-1 }:
     uint32_t generateInt( uint32_t N );
     uint64_t generateInt64( uint64_t N );
@@ -176,6 +181,7 @@ namespace NCrystal {
 
   protected:
     virtual double actualGenerate() = 0;//uniformly in (0,1]
+    virtual void actualGenerateMany( double* out, std::size_t n );//default calls actualGenerate() n times
   };
 
   struct NCRYSTAL_API UniqueIDValue {
@@ -1144,6 +1150,15 @@ namespace NCrystal {
     return r;
   }
 
+  inline void RNG::generateMany( double* out, std::size_t n ) {
+    actualGenerateMany( out, n );
+#ifndef NDEBUG
+    for ( std::size_t i = 0; i < n; ++i )
+      if ( ! ( out[i] > 0.0 && out[i] <= 1.0 ) )
+        NCRYSTAL_THROW2(CalcError,"Random number stream generated number "<<out[i]<<" which is outside (0.0,1.0]");
+#endif
+  }
+
   inline uint32_t RNG::generateInt( uint32_t N )
   {
     constexpr uint32_t nmax = std::numeric_limits<uint32_t>::max();
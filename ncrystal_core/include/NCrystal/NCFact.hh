@@ -24,6 +24,7 @@
 #include "NCrystal/NCMatCfg.hh"
 #include "NCrystal/NCProc.hh"
 #include "NCrystal/NCInfo.hh"
+#include <future>
 
 namespace NCrystal {
 
@@ -53,6 +54,101 @@ namespace NCrystal {
   NCRYSTAL_API Scatter createScatter_RNGByIdx( const MatCfg& cfg, RNGStreamIndex rngidx );
   NCRYSTAL_API Scatter createScatter_RNGForCurrentThread( const MatCfg& cfg );
 
+  //////////////////////////////////////////////////////////////////////////
+  // NUMA-local Scatter instances. On machines with several NUMA nodes,  //
+  // this returns a Scatter instance (with RNG stream as for              //
+  // createScatter_RNGForCurrentThread) whose underlying read-only data  //
+  // (cross section and sampling tables, reflection planes, ...) is only  //
+  // shared with instances created by this function from threads on the  //
+  // same NUMA node. Each node gets its own replica, constructed by the   //
+  // first thread on that node which requests it, so with the usual       //
+  // first-touch policy of the OS it is allocated in the memory local to  //
+  // that node. Threads should be pinned to their cores before calling    //
+  // this, and it costs one initialisation (and copy of the data) per     //
+  // node. On machines with a single node (or where the NUMA topology is  //
+  // unavailable), this is the same as createScatter_RNGForCurrentThread: //
+  //////////////////////////////////////////////////////////////////////////
+
+  NCRYSTAL_API Scatter createScatter_NUMALocal( const MatCfg& cfg );
+  NCRYSTAL_API unsigned numberOfNUMANodes();
+  NCRYSTAL_API unsigned currentNUMANode();//node of the calling thread
+
+  //////////////////////////////////////////////////////////////////////////
+  // Create several Scatter instances at once, initialising the materials //
+  // concurrently using up to getNumberOfThreads() threads (see below).   //
+  // Shared dependencies (e.g. the same input file used by several cfgs)  //
+  // are only created once, courtesy of the factory caches. Results are   //
+  // returned in the same order as the cfgs, and are identical to those   //
+  // of calling createScatter on each cfg in turn (including the RNG      //
+  // streams assigned). Any exception is rethrown in the calling thread:  //
+  //////////////////////////////////////////////////////////////////////////
+
+  NCRYSTAL_API std::vector<Scatter> createScatterMany( const std::vector<MatCfg>& cfgs );
+
+  //////////////////////////////////////////////////////////////////////////
+  // Asynchronous versions of createInfo, createScatter and              //
+  // createAbsorption, which return immediately while the objects are    //
+  // created in a pool of background threads (using up to                //
+  // getNumberOfThreads() threads, see below). This allows materials to  //
+  // be prepared while the application is busy with other tasks, joining //
+  // later via std::future::get() (which rethrows any exception from the //
+  // creation). Concurrent requests for the same objects share a single  //
+  // computation, courtesy of the factory caches. The RNG stream of a    //
+  // Scatter object is assigned when createScatterAsync is called, so    //
+  // results are identical to those of calling createScatter at the same //
+  // point. When NCrystal is built without thread support, the objects   //
+  // are created immediately and ready futures are returned.             //
+  //////////////////////////////////////////////////////////////////////////
+
+  NCRYSTAL_API std::future<shared_obj<const Info>> createInfoAsync( const MatCfg& cfg );
+  NCRYSTAL_API std::future<Scatter> createScatterAsync( const MatCfg& cfg );
+  NCRYSTAL_API std::future<Absorption> createAbsorptionAsync( const MatCfg& cfg );
+
+  //////////////////////////////////////////////////////////////////////////
+  // Material snapshots allowing jobs to skip the expensive parts of      //
+  // material initialisation, namely the calculation of HKL lists and the //
+  // expansion of VDOS curves into scattering kernels (including the      //
+  // derived data needed for sampling). A snapshot is a directory holding //
+  // the versioned binary files of the on-disk HKL and scattering kernel  //
+  // caches (cf. NCRYSTAL_HKL_CACHEDIR and NCRYSTAL_SAB_CACHEDIR), plus a //
+  // manifest file listing the cfg-strings used to generate it.           //
+  //                                                                      //
+  // createSnapshot creates Info, Scatter and Absorption objects for the  //
+  // cfgs with both caches directed to the (existing) directory. Since    //
+  // the objects must actually be created, this happens in a private      //
+  // cache replica domain, bypassing the normal in-memory caches. It has  //
+  // no effect on the caches or cache directories used elsewhere, and can //
+  // safely be used concurrently with other NCrystal usage.               //
+  //                                                                      //
+  // loadSnapshot verifies the manifest (the snapshot must be created by  //
+  // the same NCrystal version) and directs both caches to the directory  //
+  // for the rest of the process, so subsequent creation of the listed    //
+  // materials load the results from the files (the input data files are  //
+  // still needed). It returns the cfg-strings listed in the manifest.    //
+  //////////////////////////////////////////////////////////////////////////
+
+  NCRYSTAL_API void createSnapshot( const std::vector<MatCfg>& cfgs, const std::string& dirname );
+  NCRYSTAL_API std::vector<std::string> loadSnapshot( const std::string& dirname );
+
+  //////////////////////////////////////////////////////////////////////////
+  // Granular alternatives to clearCaches() (cf. NCMem.hh), allowing     //
+  // long-running applications to release the memory of single           //
+  // materials while keeping other cached objects. evictFromCaches       //
+  // removes all cached objects created from the input data of the cfg   //
+  // (for any parameters, and for all phases of multiphase cfgs).        //
+  // evictInfo removes the Info object and all objects created from it   //
+  // (e.g. scattering kernels and processes), identified by its unique   //
+  // ID or by the ID of its underlying data (cf.                         //
+  // Info::detail_getUnderlyingUniqueID, which is used when an Info      //
+  // object is passed). Objects still in use are not affected, but will  //
+  // not be returned by the caches again. The functions return the       //
+  // number of removed cache entries:                                    //
+  //////////////////////////////////////////////////////////////////////////
+
+  NCRYSTAL_API std::size_t evictFromCaches( const MatCfg& cfg );
+  NCRYSTAL_API std::size_t evictInfo( UniqueIDValue );
+  NCRYSTAL_API std::size_t evictInfo( const Info& );
+
   //////////////////////////////////////////////////////////////////////////
   // Register in-memory data files which can later be referred to in      //
   // cfg strings. Note that the file NCDataSources.hh provides MANY more  //
@@ -69,6 +165,18 @@ namespace NCrystal {
   NCRYSTAL_API void registerInMemoryStaticFileData( std::string virtualFileName,
                                                     const char* static_data );
 
+  //////////////////////////////////////////////////////////////////////////
+  // Number of threads which NCrystal may use internally to speed up the  //
+  // initialisation of heavy objects (e.g. the integration of scattering  //
+  // kernels). Results do not depend on the number of threads. The        //
+  // default is taken from the NCRYSTAL_NTHREADS environment variable, or //
+  // is 1 if that is unset. A value of 0 means that the number of threads //
+  // reported by std::thread::hardware_concurrency() will be used.        //
+  //////////////////////////////////////////////////////////////////////////
+
+  NCRYSTAL_API void setNumberOfThreads( unsigned );
+  NCRYSTAL_API unsigned getNumberOfThreads();//actual number, never 0.
+
 }
 
 #endif
@@ -197,9 +197,38 @@ namespace NCrystal {
     //this extendable so plugins can provide new type recognition capabilities:
     NCRYSTAL_API std::string guessDataType( const RawStrData&, const std::string& filename = {} );
 
+    //Granular eviction of cached objects (cf. the evictFromCaches functions in
+    //NCFact.hh). Objects created from the TextData objects with the listed
+    //UIDs or data source names (or from any TextData if allTextData is true),
+    //as well as the listed
+    //Info objects (by the IDs of their underlying data, which are the ones
+    //recorded on ScatterRequest and AbsorptionRequest objects) and all objects
+    //derived from them, are removed from the caches. Caches outside FactImpl
+    //participate by registering eviction functions, which must remove the
+    //affected entries, add the IDs of any evicted objects from which other
+    //cached objects might be derived to the request, and return the number of
+    //removed entries (all functions are invoked repeatedly until the request
+    //no longer grows). Returns the total number of removed entries:
+    struct NCRYSTAL_API CacheEvictionRequest {
+      bool allTextData = false;
+      std::set<TextDataUID> textDataUIDs;
+      std::set<std::string> dataSourceNames;
+      std::set<UniqueIDValue> infoUIDs;
+      std::set<UniqueIDValue> dynInfoUIDs;//of DynamicInfo objects on evicted Info objects
+      std::set<UniqueIDValue> sabDataUIDs;//of evicted SABData objects
+      std::size_t size() const;
+    };
+    NCRYSTAL_API std::size_t evictFromCaches( CacheEvictionRequest );
+    NCRYSTAL_API void registerCacheEvictionFunction( std::function<std::size_t(CacheEvictionRequest&)> );
+
     //Advanced usage (for NCDataSources.cc, not recommended for other usage):
     NCRYSTAL_API void removeTextDataFactoryIfExists( const std::string& name );
 
+    //Evict objects created from TextData objects with the given DataSourceName
+    //(or all of them if empty), for usage when the corresponding data sources
+    //are replaced or removed:
+    NCRYSTAL_API std::size_t evictFromCachesByDataSourceName( const std::string& dsn );
+
   }
 }
 
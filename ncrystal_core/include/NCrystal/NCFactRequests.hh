@@ -76,6 +76,8 @@ namespace NCrystal {
       OptionalTextDataSP m_textDataSP;
       TextDataUID m_textDataUID;
       DataSourceName m_dataSourceName;
+      std::size_t m_dataHash = 0;//precomputed hash of m_data and m_dataSourceName
+      void updateDataHash();
       bool cmpDataLT(const InfoRequest&) const;
       bool cmpDataEQ(const InfoRequest&) const;
     };
@@ -126,6 +128,8 @@ namespace NCrystal {
       OptionalInfoPtr m_infoPtr;
       UniqueIDValue m_infoUID;
       DataSourceName m_dataSourceName;
+      std::size_t m_dataHash = 0;//precomputed hash of m_data and m_dataSourceName
+      void updateDataHash();
       bool cmpDataLT(const ProcessRequestBase&) const;
       bool cmpDataEQ(const ProcessRequestBase&) const;
     };
@@ -135,10 +139,13 @@ namespace NCrystal {
 
       //Parameters (basic):
       int get_vdoslux() const;
+      int get_sabsampler() const;
+      int get_elincsampler() const;
       bool get_coh_elas() const;
       bool get_incoh_elas() const;
       bool get_sans() const;
       std::string get_inelas() const;
+      std::string get_sabgrid() const;
       std::string get_scatfactory() const;
 
       //Parameters (single crystal):
@@ -146,7 +153,9 @@ namespace NCrystal {
       OrientDir get_dir1() const;
       OrientDir get_dir2() const;
       double get_mosprec() const;
+      double get_mosscreen() const;
       double get_sccutoff() const;
+      double get_scprune() const;
       double get_dirtol() const;
       const LCAxis& get_lcaxis() const;
       std::int_least32_t get_lcmode() const;
@@ -203,6 +212,7 @@ namespace NCrystal {
       res.m_data = m_data;
       res.m_textDataUID = m_textDataUID;
       res.m_dataSourceName = m_dataSourceName;
+      res.m_dataHash = m_dataHash;
       return res;
     }
 
@@ -213,6 +223,7 @@ namespace NCrystal {
       res.m_data = m_data;
       res.m_infoUID = m_infoUID;
       res.m_dataSourceName = m_dataSourceName;
+      res.m_dataHash = m_dataHash;
       return res;
     }
 
@@ -224,11 +235,13 @@ namespace NCrystal {
     {
       if ( m_textDataUID != o.m_textDataUID )
         return m_textDataUID < o.m_textDataUID;
+      if ( m_dataHash != o.m_dataHash )
+        return m_dataHash < o.m_dataHash;
       return cmpDataLT( o );
     }
     inline bool InfoRequest::operator==( const InfoRequest& o ) const
     {
-      if ( m_textDataUID != o.m_textDataUID )
+      if ( m_textDataUID != o.m_textDataUID || m_dataHash != o.m_dataHash )
         return false;
       return cmpDataEQ( o );
     }
@@ -256,13 +269,15 @@ namespace NCrystal {
     {
       if ( m_infoUID != o.m_infoUID )
         return m_infoUID < o.m_infoUID;
+      if ( m_dataHash != o.m_dataHash )
+        return m_dataHash < o.m_dataHash;
       return cmpDataLT( o );
     }
 
     template <class TR>
     inline bool ProcessRequestBase<TR>::operator==( const ProcessRequestBase& o ) const
     {
-      if ( m_infoUID != o.m_infoUID )
+      if ( m_infoUID != o.m_infoUID || m_dataHash != o.m_dataHash )
         return false;
       return cmpDataEQ( o );
     }
@@ -95,6 +95,19 @@ namespace NCrystal {
     typedef std::vector<CompositionEntry> Composition;
     const Composition& getComposition() const;
 
+    //The composition flattened into natural elements and isotopes, i.e. with
+    //composite atoms recursively broken down. Entries are sorted by (Z,A) and
+    //each (Z,A) appears just once, with A=0 for natural elements. The
+    //flattening is done once, on first usage (see also NCCompositionUtils.hh
+    //for breakdowns into isotopes):
+    struct NCRYSTAL_API FlatCompositionEntry {
+      unsigned Z = 0;
+      unsigned A = 0;
+      double fraction = -1.0;
+    };
+    typedef std::vector<FlatCompositionEntry> FlatComposition;
+    const FlatComposition& getFlatComposition() const;
+
     //Convenience methods calculating quantities (simple weighted averages over
     //atomic composition):
     SigmaAbsorption getXSectAbsorption() const;
@@ -196,6 +209,10 @@ namespace NCrystal {
     //matrix from the structure info:
     double dspacingFromHKL( int h, int k, int l ) const;
 
+    //Batched version, calculating the d-spacings of n Miller indices
+    //(creating the reciprocal lattice matrix just once):
+    void dspacingFromHKL( const HKL* hkls, std::size_t n, double* out_dspacings ) const;
+
     //////////////////////////////////////////////////////////
     // Crystalline phases: layout of atoms in the unit cell //
     //////////////////////////////////////////////////////////
@@ -243,6 +260,14 @@ namespace NCrystal {
     double hklDMinVal() const;
     double hklDMaxVal() const;
 
+    //Find the hklList() entry containing a given Miller index, returning
+    //nullptr if not found. This uses a hash table, which is built on first
+    //usage. When the entries can be expanded (HKLInfoType SymEqvGroup or
+    //ExplicitHKLs), all (h,k,l) indices of the entries can be found, otherwise
+    //only the representative (h,k,l) value of each entry. In both cases, the
+    //index (-h,-k,-l) finds the same entry as (h,k,l):
+    const HKLInfo* findHKL( const HKL& ) const;
+
     //Access just the Bragg threshold. In principle this method returns the same
     //value as 2*hklDMaxVal(), but with two differences: Firstly, it is safe to
     //call even if hasHKL()==false, returning NullOpt (it also returns NullOpt
@@ -266,8 +291,11 @@ namespace NCrystal {
     //As HKL list initialisation can be computationally expensive, it might be
     //the case that HKL lists internally are only created on-demand. Invoking
     //hklList(), hklDMinVal(), or hklDMaxVal(), will trigger this
-    //initialisation. This method can be used to check if the initialisation is
-    //fully done:
+    //initialisation (which happens only once, with concurrent callers waiting
+    //for the result). The NCMAT factory always defers it, so materials which
+    //are only used for e.g. absorption, inelastic scattering, or with
+    //coh_elas=0, never pay for it. This method can be used to check if the
+    //initialisation is fully done:
     bool hklListIsFullyInitialised() const;
 
     //Additionally (for advanced usage such as fast browsing), the following
@@ -396,6 +424,11 @@ namespace NCrystal {
     //phase list shr ptr (if multiphase):
     shared_obj<const PhaseList> detail_getPhasesSP() const;
 
+    //Approximate memory footprint in bytes, including daughter phases (used
+    //for memory accounting in factory caches). HKL lists are only included
+    //if they are already initialised:
+    std::size_t memoryFootprint() const;
+
   public:
     struct Data;
     struct OverrideableData;
@@ -451,7 +484,8 @@ namespace NCrystal {
     Optional<PairDD> hkl_dlower_and_dupper;//dspacing range. No value means HKL lists unavailable.
     std::function<HKLList(PairDD)> hkl_ondemand_fct;
     mutable std::atomic<bool> detail_hkllist_needs_init;
-    mutable HKLList detail_hklList;
+    mutable std::shared_ptr<const HKLList> detail_hklList;//shared between Info objects with identical lists
+    mutable std::mutex detail_hkllist_mtx;//held while calculating (so it happens only once)
     mutable std::atomic<double> detail_braggthreshold;//-1: needs init, =0: N/A, >0: the value
 
     //HKLInfoType as atomic integer (using hKLInfoTypeInt_unsetval if needs init):
@@ -470,9 +504,27 @@ namespace NCrystal {
         NCRYSTAL_THROW(LogicError,"Do not access hklList() on Info object which does not represent a crystalline material");
       if ( detail_hkllist_needs_init.load() )
         doInitHKLList();
-      return detail_hklList;
+      nc_assert( detail_hklList != nullptr );
+      return *detail_hklList;
     }
 
+    //Flattened composition for Info::getFlatComposition, created on first usage:
+    void doInitFlatComposition() const;
+    mutable std::atomic<bool> detail_flatcomp_needs_init{true};
+    mutable FlatComposition detail_flatComposition;
+    mutable std::mutex detail_flatcomp_mtx;//held while calculating
+
+    //Hash table for Info::findHKL, built on first usage:
+    struct HKLIndex;
+    void doInitHKLIndex() const;
+    mutable std::atomic<bool> detail_hklindex_needs_init{true};
+    mutable std::shared_ptr<const HKLIndex> detail_hklIndex;
+    mutable std::mutex detail_hklindex_mtx;//held while building
+
+    //Content-addressed sharing of HKL lists (returns a shared pointer to an
+    //existing identical list if one is in use by another Info object):
+    static std::shared_ptr<const HKLList> internHKLList( HKLList&& );
+
     //Both single and multi-phase:
     DataSourceName dataSourceName;
     StateOfMatter stateOfMatter = StateOfMatter::Unknown;
@@ -557,6 +609,12 @@ namespace NCrystal {
   inline const DynamicInfoList& Info::getDynamicInfoList() const  { singlePhaseOnly(__func__); return m_data->dyninfolist; }
   inline const Info::CustomData& Info::getAllCustomSections() const { singlePhaseOnly(__func__); return m_data->custom; }
   inline const Info::Composition& Info::getComposition() const { return m_data->composition; }
+  inline const Info::FlatComposition& Info::getFlatComposition() const
+  {
+    if ( m_data->detail_flatcomp_needs_init.load() )
+      m_data->doInitFlatComposition();
+    return m_data->detail_flatComposition;
+  }
   inline const std::string& Info::displayLabel(const AtomIndex& ai) const
   {
     singlePhaseOnly(__func__);
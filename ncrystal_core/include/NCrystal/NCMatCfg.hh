@@ -28,6 +28,7 @@ namespace NCrystal {
 
   class SCOrientation;
   class MatInfoCfg;
+  namespace ProcImpl { class Process; }
 
   class NCRYSTAL_API MatCfg {
   public:
@@ -210,17 +211,22 @@ namespace NCrystal {
     void set_dcutoffup( double );
     void set_mos( MosaicityFWHM );
     void set_mosprec( double );
+    void set_mosscreen( double );
     void set_sccutoff( double );
+    void set_scprune( double );
     void set_dirtol( double );
     void set_coh_elas( bool );
     void set_incoh_elas( bool );
     void set_sans( bool );
     void set_inelas( const std::string& );
+    void set_sabgrid( const std::string& );
     void set_infofactory( const std::string& );
     void set_scatfactory( const std::string& );
     void set_absnfactory( const std::string& );
     void set_lcmode( std::int_least32_t );
     void set_vdoslux( int );
+    void set_sabsampler( int );
+    void set_elincsampler( int );
     void set_atomdb( const std::string& );
     void set_lcaxis( const LCAxis& );
     void set_dir1( const HKLPoint&, const LabAxis& );
@@ -263,7 +269,9 @@ namespace NCrystal {
     double get_dcutoffup() const;
     MosaicityFWHM get_mos() const;
     double get_mosprec() const;
+    double get_mosscreen() const;
     double get_sccutoff() const;
+    double get_scprune() const;
     double get_dirtol() const;
     const LCAxis& get_lcaxis() const;
     std::string get_infofactory() const;
@@ -271,12 +279,15 @@ namespace NCrystal {
     std::string get_absnfactory() const;
     std::int_least32_t get_lcmode() const;
     int get_vdoslux() const;
+    int get_sabsampler() const;
+    int get_elincsampler() const;
     std::string get_atomdb() const;
     std::vector<VectS> get_atomdb_parsed() const;
     bool get_coh_elas() const;
     bool get_incoh_elas() const;
     bool get_sans() const;
     std::string get_inelas() const;
+    std::string get_sabgrid() const;
     OrientDir get_dir1() const;
     OrientDir get_dir2() const;
 
@@ -392,6 +403,17 @@ namespace NCrystal {
     const Cfg::CfgData& rawCfgData() const;//NB: singlephase only fct
     void apply( const Cfg::CfgData& );//NB: applies to all phases if multiphase
 
+    //Memoisation of the processes created from the configuration. The entries
+    //are kept on the internal data shared between copies of the MatCfg object,
+    //and are discarded whenever a copy is modified. Only weak references are
+    //kept, and entries are only returned for the epoch value with which they
+    //were recorded (the factory infrastructure changes the epoch whenever its
+    //caches are invalidated). Nothing is ever memoised or returned for objects
+    //with phase choices (the density state on the other hand is irrelevant
+    //for processes):
+    std::shared_ptr<const ProcImpl::Process> getProcMemo( ProcessType, std::uint64_t epoch ) const;
+    void setProcMemo( ProcessType, std::uint64_t epoch, const std::shared_ptr<const ProcImpl::Process>& ) const;
+
     //////////////////////////////////////////////////////////////////////
     // Obsolete functions kept temporarily for backwards compatibility. //
     //////////////////////////////////////////////////////////////////////
@@ -29,7 +29,9 @@
 #include <functional>
 #include <atomic>
 #include <cstddef>
+#include <cstdlib>
 #include <new>
+#include <vector>
 
 namespace NCrystal {
 
@@ -275,6 +277,101 @@ namespace NCrystal {
   template<class TValue>
   inline TValue* alignedAlloc( std::size_t number_of_objects );
 
+  //Allocation of large buffers with long lifetimes (e.g. the sampling tables
+  //of scattering kernels). Memory is aligned to at least 64 bytes, and when
+  //huge pages are enabled, buffers of 4MB or more are aligned to 2MB huge
+  //page boundaries and the OS is asked to back them with transparent huge
+  //pages (only on Linux), which reduces TLB misses in random access
+  //patterns. Huge pages are disabled by default, unless the
+  //NCRYSTAL_HUGEPAGES environment variable is set to 1. Changing the setting
+  //only affects subsequent allocations. Returned memory must be released
+  //with std::free:
+  NCRYSTAL_API void enableHugePages( bool status = true );
+  NCRYSTAL_API bool getHugePagesEnabled();
+  NCRYSTAL_API void * largeBufferAlloc( std::size_t size );
+
+  //Allocator for standard containers, using largeBufferAlloc:
+  template<class TValue>
+  struct LargeBufferAllocator {
+    using value_type = TValue;
+    LargeBufferAllocator() = default;
+    template<class U>
+    LargeBufferAllocator( const LargeBufferAllocator<U>& ) noexcept {}
+    TValue* allocate( std::size_t n ) { return static_cast<TValue*>( largeBufferAlloc( n * sizeof(TValue) ) ); }
+    void deallocate( TValue* p, std::size_t ) noexcept { std::free( p ); }
+    template<class U>
+    bool operator==( const LargeBufferAllocator<U>& ) const noexcept { return true; }
+    template<class U>
+    bool operator!=( const LargeBufferAllocator<U>& ) const noexcept { return false; }
+  };
+
+  //Simple expanding-only memory pool, intended for temporary (node-based)
+  //containers which are filled during initialisation and discarded
+  //afterwards. Memory is carved out of chunks of a given size, and is only
+  //released when the pool itself is destroyed, which gives better cache
+  //locality and less memory fragmentation than individual heap
+  //allocations. Requests larger than a quarter of the chunk size are given a
+  //dedicated chunk of their own. Pools are not thread-safe.
+  class MemPool {
+  public:
+    static constexpr std::size_t default_chunk_size = 65536;
+    explicit MemPool( std::size_t chunk_size = default_chunk_size );
+    MemPool( const MemPool& ) = delete;
+    MemPool& operator=( const MemPool& ) = delete;
+    ~MemPool();
+
+    //Alignment must not exceed alignof(std::max_align_t):
+    void * allocate( std::size_t n, std::size_t alignment );
+    void deallocate( void *, std::size_t ) noexcept {}//memory is only released by ~MemPool
+
+    std::size_t chunkSize() const noexcept { return m_size; }
+  private:
+    unsigned char * m_data = nullptr;
+    std::size_t m_size;
+    std::size_t m_offset;
+    std::vector<void*> m_chunks;
+  };
+
+  //Allocator which makes standard containers use a MemPool. The pool must
+  //outlive the containers. For instance:
+  //
+  //  MemPool pool;
+  //  std::map<int,double,std::less<int>,MemPoolAllocator<std::pair<const int,double>>> m(MemPoolAllocator<void>(&pool));
+  //
+  //The full (pre-C++11) allocator interface is provided, for compatibility
+  //with older standard libraries.
+  template <typename T>
+  class MemPoolAllocator {
+  public:
+    using value_type = T;
+    using pointer = T *;
+    using const_pointer = const T *;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    template <typename U> struct rebind { using other = MemPoolAllocator<U>; };
+
+    explicit MemPoolAllocator( MemPool * pool ) noexcept : m_pool(pool) {}
+    template <typename U> MemPoolAllocator( const MemPoolAllocator<U>& o ) noexcept : m_pool(o.m_pool) {}
+
+    pointer allocate( size_type n );
+    void deallocate( pointer p, size_type n ) noexcept { m_pool->deallocate( p, n * sizeof(T) ); }
+    size_type max_size() const noexcept { return static_cast<size_type>(-1) / sizeof(T); }
+    template <typename U, typename ...Args>
+    void construct( U* p, Args&& ...args ) { ::new(static_cast<void*>(p)) U( std::forward<Args>(args)... ); }
+    template <typename U>
+    void destroy( U* p ) { p->~U(); }
+
+    MemPool * pool() const noexcept { return m_pool; }
+    template <typename U> bool operator==( const MemPoolAllocator<U>& o ) const noexcept { return m_pool == o.m_pool; }
+    template <typename U> bool operator!=( const MemPoolAllocator<U>& o ) const noexcept { return m_pool != o.m_pool; }
+  private:
+    template <typename U> friend class MemPoolAllocator;
+    MemPool * m_pool;
+  };
+
 }
 
 #if __cplusplus < 201402L
@@ -330,6 +427,51 @@ namespace NCrystal {
     return static_cast<TValue*>(alignedAlloc( alignof(TValue), number_of_objects * sizeof(TValue) ));
   }
 
+  inline MemPool::MemPool( std::size_t chunk_size )
+    : m_size(chunk_size), m_offset(chunk_size)
+  {
+    nc_assert_always(chunk_size>0);
+  }
+
+  inline MemPool::~MemPool()
+  {
+    for ( auto& e : m_chunks )
+      ::operator delete(e);
+  }
+
+  inline void * MemPool::allocate( std::size_t n, std::size_t alignment )
+  {
+    nc_assert( alignment>0 && (alignment & (alignment - 1)) == 0 );
+    nc_assert( alignment <= alignof(std::max_align_t) );
+    if ( !n )
+      n = 1;//distinct addresses
+    if ( n > m_size / 4 ) {
+      //Dedicated chunk (memory from ::operator new is suitably aligned for
+      //anything with fundamental alignment), continue using the current one
+      //for small requests:
+      void * p = ::operator new( n );
+      m_chunks.push_back( p );
+      return p;
+    }
+    m_offset = ( ( m_offset + alignment - 1 ) / alignment ) * alignment;//move up to alignment
+    if ( m_offset + n > m_size ) {//must grow
+      m_chunks.reserve( m_chunks.size() + 1 );//avoid a leak if push_back throws
+      m_data = static_cast<unsigned char *>( ::operator new( m_size ) );
+      m_chunks.push_back( m_data );
+      m_offset = 0;
+    }
+    void * result = m_data + m_offset;
+    m_offset += n;
+    return result;
+  }
+
+  template <typename T>
+  inline typename MemPoolAllocator<T>::pointer MemPoolAllocator<T>::allocate( size_type n )
+  {
+    static_assert( alignof(T) <= alignof(std::max_align_t), "MemPoolAllocator does not support over-aligned types" );
+    return static_cast<pointer>( m_pool->allocate( n * sizeof(T), alignof(T) ) );
+  }
+
 }
 
 #endif
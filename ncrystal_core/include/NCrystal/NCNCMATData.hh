@@ -50,7 +50,7 @@ namespace NCrystal {
 
     //Metadata
     int version = 0;
-    constexpr static int latest_version = 6;
+    constexpr static int latest_version = 7;
     DataSourceName sourceDescription;
 
     //convenience (for a validated instance, this is the same as hasCell or hasAtomPos):
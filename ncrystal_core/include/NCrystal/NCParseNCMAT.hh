@@ -41,6 +41,21 @@ namespace NCrystal {
   NCRYSTAL_API NCMATData parseNCMATData( const TextData&,
                                          bool doFinalValidation = true );
 
+  //Parsing can be skipped entirely for text data with a static address (like
+  //the embedded data in NCrystal builds with EMBED_DATA=ON), if a pre-parsed
+  //binary encoding of the resulting NCMATData has been registered for that
+  //address. The versioned binary format stores all fields in native byte
+  //order (or rather, those available after parsing without final validation
+  //- the sourceDescription is always taken from the TextData). Registered
+  //data which can not be decoded (e.g. due to a different byte order or
+  //format version) is silently ignored, and the text data is parsed as usual:
+
+  NCRYSTAL_API std::string encodeNCMATDataBinary( const NCMATData& );
+  NCRYSTAL_API NCMATData decodeNCMATDataBinary( const char * data, std::size_t len );//throws BadInput
+  NCRYSTAL_API void registerPreParsedNCMATData( const char * static_text_data,
+                                                const unsigned char * static_binary_data,
+                                                std::size_t binary_len );
+
 }
 
 #endif
@@ -47,6 +47,15 @@ namespace NCrystal {
     // are enabled by adding them to the NCRYSTAL_PLUGIN_LIST environment
     // variable, while the loading of builtin plugins is handled by NCrystal's
     // cmake configuration.
+    //
+    // Dynamic plugins can also be registered for on-demand loading with
+    // registerLazyDynamicPlugin, by providing the data types (i.e. file
+    // extensions like "nxs") which the plugin supports. The shared library is
+    // then only loaded once a request involving one of those data types is
+    // made, or when a request can not otherwise be serviced (including requests
+    // for specific factories which are not available). In NCRYSTAL_PLUGIN_LIST
+    // the data types can be appended after an '@', e.g. "libmyplugin.so@nxs,laz"
+    // (entries without '@' are loaded immediately).
 
     //
     enum class PluginType { Dynamic, Builtin, Undefined };
@@ -64,9 +73,18 @@ namespace NCrystal {
     NCRYSTAL_API PluginInfo loadBuiltinPlugin( std::string pluginName,
                                                std::function<void()> regfct );
 
+    NCRYSTAL_API void registerLazyDynamicPlugin( std::string path_to_shared_lib,
+                                                 VectS dataTypes );
+
     //Query loaded plugins:
     NCRYSTAL_API std::vector<PluginInfo> loadedPlugins();
 
+    //Used by the factory infrastructure to trigger on-demand loading of lazy
+    //dynamic plugins, either those supporting a given data type or all of them
+    //(returns true if any plugins were loaded):
+    NCRYSTAL_API bool loadLazyPluginsForDataType( const std::string& );
+    NCRYSTAL_API bool loadAllLazyPlugins();
+
     //Call this to ensure plugins (both builtin and those in
     //NCRYSTAL_PLUGIN_LIST) are loaded. Multiple calls to this function will
     //have no effect, and it will be called automatically when users query the
@@ -63,9 +63,23 @@ namespace NCrystal {
     EnergyDomain domain() const noexcept;
     bool isNull() const noexcept;
 
+    //Whether the underlying process never uses a cache (in which case
+    //clearCache() has no effect):
+    bool isStateless() const noexcept;
+
     CrossSect crossSection( NeutronEnergy, const NeutronDirection& );
     CrossSect crossSectionIsotropic( NeutronEnergy );
 
+    //Batched versions evaluating cross sections for N neutrons at once:
+    void crossSectionMany( const double* ekin, const NeutronDirection* dirs,
+                           std::size_t N, double* out_xs );
+    void crossSectionIsotropicMany( const double* ekin, std::size_t N, double* out_xs );
+
+    //Pre-create lazily initialised structures needed for energies in the
+    //given domain (e.g. at the start of a simulation run, rather than in its
+    //first events). Does not affect the cache or RNG stream of the object:
+    void warmup( EnergyDomain, WarmupLevel = WarmupLevel::Essential ) const;
+
     void clearCache();
     ProcImpl::ProcPtr underlyingPtr() const;
     const ProcImpl::Process& underlying() const;
@@ -113,6 +127,35 @@ namespace NCrystal {
     ScatterOutcome sampleScatter( NeutronEnergy, const NeutronDirection& );
     ScatterOutcomeIsotropic sampleScatterIsotropic( NeutronEnergy );
 
+    //Batched versions sampling scatterings for N neutrons at once:
+    void sampleScatterMany( const double* ekin, const NeutronDirection* dirs,
+                            std::size_t N, ScatterOutcome* out );
+    void sampleScatterIsotropicMany( const double* ekin, std::size_t N,
+                                     ScatterOutcomeIsotropic* out );
+
+    //Sample N scatterings for neutrons all in the same state:
+    void sampleScatterRepeated( NeutronEnergy, const NeutronDirection&,
+                                std::size_t N, ScatterOutcome* out );
+    void sampleScatterIsotropicRepeated( NeutronEnergy, std::size_t N,
+                                         ScatterOutcomeIsotropic* out );
+
+    //Sample scatterings for N neutrons, using for neutron i a dedicated stream
+    //of the builtin counter-based RNG, identified by (seed,neutronids[i]). It
+    //is the stream which RNGProducer::produceByIdx(neutronids[i]) gives for a
+    //producer of createBuiltinCounterRNG(seed). The outcome for a given
+    //neutron is thus the same no matter how neutrons are split into batches
+    //or threads (the RNG stream of the Scatter object is not used):
+    void sampleScatterManyByIdx( uint64_t seed, const uint64_t* neutronids,
+                                 const double* ekin, const NeutronDirection* dirs,
+                                 std::size_t N, ScatterOutcome* out );
+    void sampleScatterIsotropicManyByIdx( uint64_t seed, const uint64_t* neutronids,
+                                          const double* ekin, std::size_t N,
+                                          ScatterOutcomeIsotropic* out );
+
+    //Get the cross section and sample a scattering at the same neutron state
+    //in a single call:
+    std::pair<CrossSect,ScatterOutcome> crossSectionAndSampleScatter( NeutronEnergy, const NeutronDirection& );
+
     //Multi-threaded applications should clone the object and work
     //with one cloned object per thread (will use equivalently named
     //RNGProducer::produceXXX methods to produce new RNG stream for
@@ -163,11 +206,18 @@ inline const char * NCrystal::Process::name() const noexcept { return m_proc->na
 inline bool NCrystal::Process::isOriented() const noexcept { return m_proc->isOriented(); }
 inline NCrystal::EnergyDomain NCrystal::Process::domain() const noexcept { return m_proc->domain(); }
 inline bool NCrystal::Process::isNull() const noexcept { return m_proc->isNull(); }
+inline bool NCrystal::Process::isStateless() const noexcept { return m_proc->isStateless(); }
 inline void NCrystal::Process::clearCache() { m_cachePtr.reset(); }
+inline void NCrystal::Process::warmup( EnergyDomain edom, WarmupLevel level ) const { m_proc->warmup(edom,level); }
 inline NCrystal::CrossSect NCrystal::Process::crossSection( NeutronEnergy ekin, const NeutronDirection& dir )
 { return m_proc->crossSection(m_cachePtr,ekin,dir); }
 inline NCrystal::CrossSect NCrystal::Process::crossSectionIsotropic( NeutronEnergy ekin )
 { return m_proc->crossSectionIsotropic(m_cachePtr,ekin); }
+inline void NCrystal::Process::crossSectionMany( const double* ekin, const NeutronDirection* dirs,
+                                                 std::size_t N, double* out_xs )
+{ m_proc->crossSectionMany(m_cachePtr,ekin,dirs,N,out_xs); }
+inline void NCrystal::Process::crossSectionIsotropicMany( const double* ekin, std::size_t N, double* out_xs )
+{ m_proc->crossSectionIsotropicMany(m_cachePtr,ekin,N,out_xs); }
 inline NCrystal::shared_obj<NCrystal::RNG> NCrystal::Scatter::rngSO() { return m_rng; }
 inline NCrystal::RNG& NCrystal::Scatter::rng() { return m_rng; }
 inline NCrystal::shared_obj<NCrystal::RNGProducer> NCrystal::Scatter::rngproducerSO() { return m_rngproducer; }
@@ -176,5 +226,19 @@ inline NCrystal::ScatterOutcome NCrystal::Scatter::sampleScatter( NeutronEnergy
 { return m_proc->sampleScatter(m_cachePtr,m_rng,ekin,dir); }
 inline NCrystal::ScatterOutcomeIsotropic NCrystal::Scatter::sampleScatterIsotropic( NeutronEnergy ekin )
 { return m_proc->sampleScatterIsotropic(m_cachePtr,m_rng,ekin); }
+inline void NCrystal::Scatter::sampleScatterMany( const double* ekin, const NeutronDirection* dirs,
+                                                  std::size_t N, ScatterOutcome* out )
+{ m_proc->sampleScatterMany(m_cachePtr,m_rng,ekin,dirs,N,out); }
+inline std::pair<NCrystal::CrossSect,NCrystal::ScatterOutcome> NCrystal::Scatter::crossSectionAndSampleScatter( NeutronEnergy ekin, const NeutronDirection& dir )
+{ return m_proc->crossSectionAndSampleScatter(m_cachePtr,m_rng,ekin,dir); }
+inline void NCrystal::Scatter::sampleScatterIsotropicMany( const double* ekin, std::size_t N,
+                                                           ScatterOutcomeIsotropic* out )
+{ m_proc->sampleScatterIsotropicMany(m_cachePtr,m_rng,ekin,N,out); }
+inline void NCrystal::Scatter::sampleScatterRepeated( NeutronEnergy ekin, const NeutronDirection& dir,
+                                                      std::size_t N, ScatterOutcome* out )
+{ m_proc->sampleScatterRepeated(m_cachePtr,m_rng,ekin,dir,N,out); }
+inline void NCrystal::Scatter::sampleScatterIsotropicRepeated( NeutronEnergy ekin, std::size_t N,
+                                                              ScatterOutcomeIsotropic* out )
+{ m_proc->sampleScatterIsotropicRepeated(m_cachePtr,m_rng,ekin,N,out); }
 
 #endif
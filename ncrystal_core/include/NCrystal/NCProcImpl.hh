@@ -67,8 +67,28 @@
 
 namespace NCrystal {
 
+  namespace detail {
+    struct FlatBackendUpload;//see NCFlatExport.hh
+  }
+
   namespace ProcImpl {
 
+    ///////////////////////////////////////////////////////////////////////////////
+    //
+    // Analytic form of cross sections with pure 1/velocity scaling,
+    // sigma(E)=coefficient/sqrt(E), which is the same as sigma0*sqrt(E0/E) with
+    // coefficient=sigma0*sqrt(E0). This can be evaluated inline by client code,
+    // without any virtual calls or CachePtr objects.
+    //
+    struct OOVCrossSection {
+      double coefficient;//[barn*sqrt(eV)]
+      CrossSect evaluate( NeutronEnergy ekin ) const noexcept
+      {
+        return CrossSect{ ekin.dbl() ? coefficient / std::sqrt(ekin.dbl())
+                          : ( coefficient ? kInfinity : 0.0 ) };
+      }
+    };
+
     ///////////////////////////////////////////////////////////////////////////////
     //
     // Common base class of all processes.
@@ -120,17 +140,98 @@ namespace NCrystal {
       //This can be called only when materialType is Isotropic:
       virtual CrossSect crossSectionIsotropic(CachePtr&, NeutronEnergy ) const = 0;
 
+      //Batched versions of the two cross section methods above, evaluating
+      //cross sections for N neutrons in a single call (the ekin, dirs and out_xs
+      //arrays must all hold N entries). Default implementations simply loop
+      //over the single-neutron methods, but models can reimplement them in
+      //order to avoid per-call overhead:
+      virtual void crossSectionMany( CachePtr&, const double* ekin, const NeutronDirection* dirs,
+                                     std::size_t N, double* out_xs ) const;
+      virtual void crossSectionIsotropicMany( CachePtr&, const double* ekin,
+                                              std::size_t N, double* out_xs ) const;
+
       //This can be called only when processType is Scatter:
       virtual ScatterOutcome sampleScatter(CachePtr&, RNG&, NeutronEnergy, const NeutronDirection& ) const = 0;
 
       //This can be called only when processType is Scatter and materialType is Isotropic:
       virtual ScatterOutcomeIsotropic sampleScatterIsotropic(CachePtr&, RNG&, NeutronEnergy ) const = 0;
 
+      //Batched versions of the two sampling methods above, sampling scatterings
+      //for N neutrons in a single call and consuming random numbers from a
+      //single RNG stream (the ekin, dirs and out arrays must all hold N
+      //entries). Default implementations simply loop over the single-neutron
+      //methods. Note that reimplementations are allowed to consume random
+      //numbers in a different order than a loop would, so results are only
+      //statistically (not event-by-event) equivalent to those of such a loop:
+      virtual void sampleScatterMany( CachePtr&, RNG&, const double* ekin, const NeutronDirection* dirs,
+                                      std::size_t N, ScatterOutcome* out ) const;
+      virtual void sampleScatterIsotropicMany( CachePtr&, RNG&, const double* ekin,
+                                               std::size_t N, ScatterOutcomeIsotropic* out ) const;
+
+      //Sample N scatterings for neutrons all in the same state (e.g. for
+      //histograms of scattering angles at a given energy), writing the
+      //outcomes to the out array which must hold N entries. Default
+      //implementations call the batched methods above, but models can
+      //reimplement them in order to carry out the setup for the neutron state
+      //only once. Like for the batched methods, results are only
+      //statistically equivalent to those of repeated calls to sampleScatter:
+      virtual void sampleScatterRepeated( CachePtr&, RNG&, NeutronEnergy, const NeutronDirection&,
+                                          std::size_t N, ScatterOutcome* out ) const;
+      virtual void sampleScatterIsotropicRepeated( CachePtr&, RNG&, NeutronEnergy,
+                                                   std::size_t N, ScatterOutcomeIsotropic* out ) const;
+
+      //Evaluate the cross section and sample a scattering at the same neutron
+      //state in a single call, for callers which need both (this can be called
+      //only when processType is Scatter). The default implementation simply
+      //calls crossSection and sampleScatter, but models can reimplement it
+      //in order to share work between the two:
+      virtual std::pair<CrossSect,ScatterOutcome> crossSectionAndSampleScatter( CachePtr&, RNG&, NeutronEnergy,
+                                                                                const NeutronDirection& ) const;
+
+      //Processes whose cross sections have a simple analytic form can expose it
+      //by reimplementing the following method, allowing callers to evaluate
+      //cross sections inline (e.g. absorption in each step of a transport
+      //code). Currently, the only supported form is pure 1/v scaling:
+      virtual Optional<OOVCrossSection> analyticOOVCrossSection() const { return NullOpt; }
+
+      //Processes can advertise capabilities (as a combination of the flags
+      //below), allowing callers such as ProcComposition to select efficient
+      //code paths. CapBatchCrossSection and CapBatchSampling indicate that the
+      //batched cross section or sampling methods above are reimplemented
+      //(processes without them are called neutron by neutron, with no overhead
+      //from gathering inputs into batches). CapStateless indicates that the
+      //process never uses its CachePtr arguments, so callers are free to pass
+      //the same (or an empty) CachePtr from any thread. Plugins can reimplement
+      //capabilities() to opt in:
+      enum CapabilityFlag : unsigned { CapBatchCrossSection = 0x1, CapBatchSampling = 0x2, CapStateless = 0x4 };
+      virtual unsigned capabilities() const noexcept { return 0; }
+      bool hasCapability( CapabilityFlag f ) const noexcept { return ( capabilities() & f ) != 0; }
+      bool isStateless() const noexcept { return hasCapability( CapStateless ); }
+
       //Callers who would like to reduce allocations during their event loops,
       //can call the following function which is likely (but not 100%
       //guaranteed) to allocate an object in the provided CachePtr (if needed):
       void initCachePtr(CachePtr& cp) const;
 
+      //Some models create parts of their data structures lazily, upon first
+      //usage (e.g. at a given neutron energy). Applications wishing to avoid
+      //such delays inside their event loops (e.g. in the first events of a
+      //simulation) can call warmup during their initialisation, to
+      //pre-create the structures needed for energies in the given domain
+      //(which is intersected with the domain of the process). The default
+      //implementation evaluates cross sections and (for scatterings) samples
+      //scatterings at a number of energies spread logarithmically over the
+      //domain, using a private RNG stream and cache, so results of
+      //subsequent calls are unaffected. Models can reimplement it to create
+      //their lazy structures directly, possibly using several threads (see
+      //getNumberOfThreads in NCFact.hh):
+      virtual void warmup( EnergyDomain, WarmupLevel = WarmupLevel::Essential ) const;
+
+      //Approximate memory footprint in bytes, used for memory accounting in
+      //factory caches. Models holding large tables should reimplement this to
+      //include them (the default implementation returns a nominal value):
+      virtual std::size_t memoryFootprint() const;
+
       //Summarise meta-data in JSON dictionary:
       std::string jsonDescription() const;
 
@@ -175,13 +276,24 @@ namespace NCrystal {
 
       //Isotropic material, anisotropic methods are implemented in terms of the isotropic ones:
       CrossSect crossSection(CachePtr& cp, NeutronEnergy ekin, const NeutronDirection& ) const final;
+      void crossSectionMany( CachePtr& cp, const double* ekin, const NeutronDirection*,
+                             std::size_t N, double* out_xs ) const final;
       ScatterOutcome sampleScatter(CachePtr& cp, RNG& rng, NeutronEnergy ekin, const NeutronDirection& ) const override;
+      void sampleScatterMany( CachePtr& cp, RNG& rng, const double* ekin, const NeutronDirection* dirs,
+                              std::size_t N, ScatterOutcome* out ) const override;
+      void sampleScatterRepeated( CachePtr& cp, RNG& rng, NeutronEnergy ekin, const NeutronDirection& dir,
+                                  std::size_t N, ScatterOutcome* out ) const override;
 
       //NB: We have marked the sampleScatter as "override" here instead of
       //"final", since some models might be able to do something more efficient
       //than the sampleScatter method implemented here (which calls
       //sampleScatterIsotropic followed by a call to
-      //the randNeutronDirectionGivenScatterMu utility function).
+      //the randNeutronDirectionGivenScatterMu utility function). Likewise,
+      //sampleScatterMany (sampleScatterRepeated) calls
+      //sampleScatterIsotropicMany (sampleScatterIsotropicRepeated) followed by
+      //a call to the batched randDirectionsGivenScatterMu function, so models
+      //reimplementing sampleScatter should normally also reimplement
+      //sampleScatterMany and sampleScatterRepeated.
 
     };
 
@@ -212,6 +324,8 @@ namespace NCrystal {
 
       //Isotropic material, anisotropic xsect is implemented in terms of the isotropic one:
       CrossSect crossSection(CachePtr& cp, NeutronEnergy ekin, const NeutronDirection& ) const final;
+      void crossSectionMany( CachePtr& cp, const double* ekin, const NeutronDirection*,
+                             std::size_t N, double* out_xs ) const final;
 
       //Absorption process, it is not allowed to call scattering methods (will
       //throw LogicError if attempted):
@@ -219,6 +333,22 @@ namespace NCrystal {
       ScatterOutcomeIsotropic sampleScatterIsotropic(CachePtr&, RNG&, NeutronEnergy ) const final;
     };
 
+    struct NCRYSTAL_API ProcCompTabulationCfg {
+      //Parameters for ProcComposition::createTabulated (defined outside the
+      //class due to https://stackoverflow.com/questions/17430377/). Tables
+      //cover the range [emin,emax], starting from a log-spaced grid with
+      //ndecade points per decade (or the egrid points, if provided). Grid
+      //points are added until linear interpolation reproduces the cross
+      //sections of all components to a precision of tolerance times the total
+      //cross section (or until npts_max grid points are reached):
+      double tolerance = 1e-3;
+      NeutronEnergy emin = NeutronEnergy{1e-5};
+      NeutronEnergy emax = NeutronEnergy{10.0};
+      unsigned ndecade = 10;
+      unsigned npts_max = 1000000;
+      VectD egrid;
+    };
+
     ///////////////////////////////////////////////////////////////////////////////
     //
     // Composition class. This is a technical class which can be used to
@@ -267,8 +397,42 @@ namespace NCrystal {
       EnergyDomain domain() const noexcept final { return m_domain; }
       CrossSect crossSection(CachePtr& cacheptr, NeutronEnergy ekin, const NeutronDirection& dir ) const final;
       CrossSect crossSectionIsotropic(CachePtr& cacheptr, NeutronEnergy ekin ) const final;
+      void crossSectionMany( CachePtr& cacheptr, const double* ekin, const NeutronDirection* dirs,
+                             std::size_t N, double* out_xs ) const final;
+      void crossSectionIsotropicMany( CachePtr& cacheptr, const double* ekin,
+                                      std::size_t N, double* out_xs ) const final;
       ScatterOutcome sampleScatter(CachePtr& cacheptr, RNG& rng, NeutronEnergy ekin, const NeutronDirection& dir ) const final;
       ScatterOutcomeIsotropic sampleScatterIsotropic(CachePtr& cacheptr, RNG& rng, NeutronEnergy ekin ) const final;
+      void sampleScatterMany( CachePtr& cacheptr, RNG& rng, const double* ekin, const NeutronDirection* dirs,
+                              std::size_t N, ScatterOutcome* out ) const final;
+      void sampleScatterIsotropicMany( CachePtr& cacheptr, RNG& rng, const double* ekin,
+                                       std::size_t N, ScatterOutcomeIsotropic* out ) const final;
+      //Components are selected for all N neutrons based on a single cross
+      //section evaluation, and each selected component then samples all its
+      //neutrons in a single call:
+      void sampleScatterRepeated( CachePtr& cacheptr, RNG& rng, NeutronEnergy ekin, const NeutronDirection& dir,
+                                  std::size_t N, ScatterOutcome* out ) const final;
+      void sampleScatterIsotropicRepeated( CachePtr& cacheptr, RNG& rng, NeutronEnergy ekin,
+                                           std::size_t N, ScatterOutcomeIsotropic* out ) const final;
+      //Component cross sections are evaluated once (or found in the cache), and
+      //used both for the total cross section and for selecting the component:
+      std::pair<CrossSect,ScatterOutcome> crossSectionAndSampleScatter( CachePtr& cacheptr, RNG& rng, NeutronEnergy ekin,
+                                                                        const NeutronDirection& dir ) const final;
+      unsigned capabilities() const noexcept final { return CapBatchCrossSection | CapBatchSampling; }
+
+      //Component-resolved access, for variance reduction schemes which need to
+      //bias the selection of components. The (scaled) cross sections of each
+      //component are written to out_xs, which must have room for
+      //components().size() values (all are zero outside the domain). They are
+      //taken from the same cache as the one used internally by sampleScatter,
+      //so calling sampleScatterComponent for the same neutron state afterwards
+      //implies no re-evaluation. Note that the latter samples the selected
+      //component regardless of its cross section (it is the responsibility of
+      //the caller to apply the appropriate weights):
+      void componentCrossSections( CachePtr& cacheptr, NeutronEnergy ekin, const NeutronDirection& dir,
+                                   double* out_xs ) const;
+      ScatterOutcome sampleScatterComponent( CachePtr& cacheptr, RNG& rng, std::size_t icomponent,
+                                             NeutronEnergy ekin, const NeutronDirection& dir ) const;
 
       //Combine components efficiently. Often this result in their placement in
       //a ProcComposition object, but in case of no null-processes in the list a
@@ -281,6 +445,35 @@ namespace NCrystal {
       template<typename... Args>
       static ProcPtr combine(Args &&... args);
 
+      //Opt-in tabulated mode for isotropic processes. This returns a new
+      //ProcComposition with the same components as the provided process (or
+      //with the process as its only component if it is not a ProcComposition),
+      //in which the summed cross section and the contributions of each
+      //component are precomputed on an adaptive energy grid (see
+      //ProcCompTabulationCfg). Inside the tabulated range, cross sections are
+      //then given by a single binary search and a linear interpolation, and
+      //scatterings are sampled by selecting components according to the
+      //interpolated contributions. Outside that range, results are computed
+      //exactly. An exception is thrown for anisotropic processes:
+      static shared_obj<const ProcComposition> createTabulated( ProcPtr,
+                                                                const ProcCompTabulationCfg& = ProcCompTabulationCfg() );
+      bool isTabulated() const noexcept { return m_tab != nullptr; }
+
+      //Energy grid points of the tabulation (empty if not tabulated). These
+      //can be used by client code which needs to build its own tables
+      //(e.g. with cross sections of materials rather than per atom):
+      const VectD& tabulatedEnergyGrid() const noexcept;
+
+      //Warms up all components:
+      void warmup( EnergyDomain, WarmupLevel = WarmupLevel::Essential ) const override;
+
+      //Includes components and tabulation:
+      std::size_t memoryFootprint() const override;
+
+      //Available if all components have an analytic 1/v form (and the process
+      //is not tabulated):
+      Optional<OOVCrossSection> analyticOOVCrossSection() const override;
+
     protected:
       Optional<std::string> specificJSONDescription() const override;
     private:
@@ -289,6 +482,18 @@ namespace NCrystal {
       ProcessType m_processType;
       MaterialType m_materialType;
       EnergyDomain m_domain = { NeutronEnergy{0.0}, NeutronEnergy{0.0} };
+      class Tabulation;
+      std::shared_ptr<const Tabulation> m_tab;
+      //Components active in each of the intervals between the edges of the
+      //component domains (updated whenever m_components change), so
+      //evaluations only need to visit the live components at a given energy:
+      class DomainIntervals;
+      std::shared_ptr<const DomainIntervals> m_domainIntervals;
+      void addComponentImpl( ProcPtr, double );
+      void updateDomainIntervals();
+      //Tables uploaded to the FlatBatchBackend (if any), accessed atomically:
+      mutable std::shared_ptr<const detail::FlatBackendUpload> m_flatUpload;
+      friend struct detail::FlatBackendUpload;
       class Impl;
       friend class Impl;
     };
@@ -304,8 +509,14 @@ namespace NCrystal {
       EnergyDomain domain() const noexcept final { return { NeutronEnergy{0.0}, NeutronEnergy{0.0} }; }
       CrossSect crossSectionIsotropic(CachePtr&, NeutronEnergy ) const final { return CrossSect{0.0}; }
       CrossSect crossSection(CachePtr&, NeutronEnergy, const NeutronDirection& ) const final { return CrossSect{0.0}; }
+      void crossSectionMany( CachePtr&, const double*, const NeutronDirection*,
+                             std::size_t N, double* out_xs ) const final { std::fill( out_xs, out_xs + N, 0.0 ); }
+      void crossSectionIsotropicMany( CachePtr&, const double*,
+                                      std::size_t N, double* out_xs ) const final { std::fill( out_xs, out_xs + N, 0.0 ); }
       ScatterOutcomeIsotropic sampleScatterIsotropic(CachePtr&, RNG&, NeutronEnergy ) const final;
       ScatterOutcome sampleScatter(CachePtr&, RNG&, NeutronEnergy, const NeutronDirection& ) const final;
+      Optional<OOVCrossSection> analyticOOVCrossSection() const final { return OOVCrossSection{ 0.0 }; }
+      unsigned capabilities() const noexcept final { return CapBatchCrossSection | CapStateless; }
     private:
       //Only NullScatter/NullAbsorption can inherit from this class:
       NullProcess() = default;
@@ -368,6 +579,18 @@ namespace NCrystal {
       return crossSectionIsotropic(cp,ekin);
     }
 
+    inline void ScatterIsotropicMat::crossSectionMany( CachePtr& cp, const double* ekin, const NeutronDirection*,
+                                                       std::size_t N, double* out_xs ) const
+    {
+      crossSectionIsotropicMany(cp,ekin,N,out_xs);
+    }
+
+    inline void AbsorptionIsotropicMat::crossSectionMany( CachePtr& cp, const double* ekin, const NeutronDirection*,
+                                                          std::size_t N, double* out_xs ) const
+    {
+      crossSectionIsotropicMany(cp,ekin,N,out_xs);
+    }
+
     inline const ProcComposition::ComponentList& ProcComposition::components() const noexcept
     {
       return m_components;
@@ -46,7 +46,19 @@ namespace NCrystal {
   NCRYSTAL_API shared_obj<RNGStream> createBuiltinRNG( uint64_t seed = 0 );
   NCRYSTAL_API shared_obj<RNGStream> createBuiltinRNG( const RNGStreamState& state );
 
-  //Check whether a given RNG state is from the builtin RNG:
+  //Alternatively, create an instance of the builtin counter-based RNG
+  //(Philox4x32-10). Streams for different (seed,streamidx) values are
+  //independent, and creating them is cheap for any value of streamidx. When
+  //such a stream is used as the default RNG, RNGProducer::produceByIdx
+  //creates the streams directly from their index, so that a given index
+  //always gives the same stream, regardless of the order of calls (which is
+  //useful for massively parallel applications). Note that the streams
+  //produced have stream indices streamidx+1+idx, so the user should not
+  //assign overlapping ranges of streamidx values to different producers:
+  NCRYSTAL_API shared_obj<RNGStream> createBuiltinCounterRNG( uint64_t seed = 0, uint64_t streamidx = 0 );
+
+  //Check whether a given RNG state is from the builtin RNG (either of the
+  //above):
   NCRYSTAL_API bool stateIsFromBuiltinRNG(const RNGStreamState&);
 
   // The RNGStream and RNGProducer classes are most likely to be of interest
@@ -80,6 +92,14 @@ namespace NCrystal {
     virtual bool isJumpCapable() const { return false; }
     virtual shared_obj<RNGStream> createJumped() const;
 
+    //Some RNG's support directly creating independent streams from an index,
+    //at a cost not depending on the index (e.g. counter-based RNG's). The
+    //stream for a given index must always be the same, and independent of
+    //both this stream and the jumped streams. This will be used by
+    //RNGProducer::produceByIdx:
+    virtual bool isIndexCapable() const { return false; }
+    virtual shared_obj<RNGStream> createByIndex( RNGStreamIndex ) const;
+
     //Override and return true if the same RNG stream should be used even if
     //objects are cloned for different threads (this supports wrapping of
     //global RNG sources which already takes care of concurrency by other
@@ -129,7 +149,9 @@ namespace NCrystal {
     shared_obj<RNGStream> produce();
 
     //Produce independent stream by index. Calling later with the same index
-    //will return the same stream:
+    //will return the same stream. If the RNG stream isIndexCapable(), the
+    //stream only depends on the index, otherwise it depends on the order of
+    //calls to the produce methods:
     shared_obj<RNGStream> produceByIdx( RNGStreamIndex );
 
     //Produce independent stream for current thread. All calls within a given
@@ -141,8 +163,9 @@ namespace NCrystal {
     RNGProducer& operator=( RNGProducer&& ) noexcept;
     ~RNGProducer();
 
-    //Reinit this producer:
-    void reinit( shared_obj<RNGStream> rng, SkipOriginal so ) { *this = RNGProducer(std::move(rng),so); }
+    //Reinit this producer (this also invalidates streams cached by getRNG(),
+    //in case this is the default producer):
+    void reinit( shared_obj<RNGStream> rng, SkipOriginal so );
 
     //Create null producer, not capable of producing anything:
     explicit RNGProducer( no_init_t );
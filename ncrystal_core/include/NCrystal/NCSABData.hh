@@ -25,6 +25,41 @@
 
 namespace NCrystal {
 
+  class NCRYSTAL_API ImmutableDblArray {
+  public:
+
+    //Read-only array of doubles, with shared ownership of the underlying
+    //storage. This can either be a normal vector, or externally managed
+    //memory (e.g. a read-only memory mapped file region) which is kept alive
+    //by the provided keepalive object for as long as any ImmutableDblArray
+    //refers to it. Copying is cheap and never copies the actual data.
+
+    using value_type = double;
+    using size_type = std::size_t;
+
+    ImmutableDblArray() = default;
+    explicit ImmutableDblArray( VectD&& );
+    ImmutableDblArray( const double * data, size_type n, std::shared_ptr<const void> keepalive );
+
+    const double * data() const noexcept { return m_data; }
+    size_type size() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+    const double * begin() const noexcept { return m_data; }
+    const double * end() const noexcept { return m_data + m_size; }
+    const double& operator[]( size_type i ) const ncnoexceptndebug { nc_assert(i<m_size); return m_data[i]; }
+    const double& at( size_type i ) const;
+    const double& front() const ncnoexceptndebug { nc_assert(m_size>0); return m_data[0]; }
+    const double& back() const ncnoexceptndebug { nc_assert(m_size>0); return m_data[m_size-1]; }
+
+    //The keepalive object (will be a VectD if constructed from one):
+    const std::shared_ptr<const void>& storage() const noexcept { return m_keepalive; }
+
+  private:
+    const double * m_data = nullptr;
+    size_type m_size = 0;
+    std::shared_ptr<const void> m_keepalive;
+  };
+
   class NCRYSTAL_API SABData : public UniqueID {
   public:
 
@@ -33,16 +68,26 @@ namespace NCrystal {
     //Access data:
     const VectD& alphaGrid() const { return m_a; }
     const VectD& betaGrid() const { return m_b; }
-    const VectD& sab() const { return m_sab; }
+    const ImmutableDblArray& sab() const { return m_sab; }
     Temperature temperature() const { return m_t; }
     SigmaBound boundXS() const { return m_bxs; }
     AtomMass elementMassAMU() const { return m_m; }
     double suggestedEmax() const { return m_sem; }
 
+    //Approximate memory footprint in bytes (used for memory accounting in
+    //factory caches):
+    std::size_t memoryFootprint() const noexcept;
+
     //Constructors etc. (all expensive operations forbidden):
     SABData( VectD&& alphaGrid, VectD&& betaGrid, VectD&& sab,
              Temperature temperature, SigmaBound boundXS, AtomMass elementMassAMU,
              double suggestedEmax = 0 );
+
+    //Version where S(alpha,beta) values might reside in externally managed
+    //storage (see ImmutableDblArray):
+    SABData( VectD&& alphaGrid, VectD&& betaGrid, ImmutableDblArray sab,
+             Temperature temperature, SigmaBound boundXS, AtomMass elementMassAMU,
+             double suggestedEmax = 0 );
     SABData ( SABData && ) = default;
     SABData & operator= ( SABData && ) = default;
     SABData ( const SABData & ) = delete;
@@ -51,7 +96,8 @@ namespace NCrystal {
     ~SABData () = default;
 
   private:
-    VectD m_a, m_b, m_sab;
+    VectD m_a, m_b;
+    ImmutableDblArray m_sab;
     Temperature m_t;
     AtomMass m_m;
     double m_sem;
@@ -0,0 +1,92 @@
+#ifndef NCrystal_ScatterPool_hh
+#define NCrystal_ScatterPool_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCProc.hh"
+
+namespace NCrystal {
+
+  //////////////////////////////////////////////////////////////////////////////
+  //                                                                          //
+  // Pool of recycled Scatter clones, for task based applications which need  //
+  // a Scatter object per (short-lived) task. Creating a clone involves the   //
+  // production of a new RNG stream and a few allocations, while acquiring a  //
+  // clone from the pool merely takes it from a list of idle clones. Released //
+  // clones keep their RNG stream and their cache, so the caches stay warm.   //
+  // New clones are created (with Scatter::clone) only when no idle clones    //
+  // are available.                                                           //
+  //                                                                          //
+  // The acquire and release methods are thread-safe. Note that the RNG      //
+  // stream used by a given task depends on which clone it happens to get, so //
+  // applications needing thread-count independent results should use the    //
+  // sampling methods with per-neutron streams (sampleScatterManyByIdx).      //
+  //                                                                          //
+  //////////////////////////////////////////////////////////////////////////////
+
+  class NCRYSTAL_API ScatterPool final : private NoCopyMove {
+  public:
+
+    //Clones will be made from the provided Scatter object (which should not
+    //be used for anything else afterwards). If nreserve is non-zero, that
+    //number of clones are created upfront:
+    explicit ScatterPool( Scatter&& prototype, std::size_t nreserve = 0 );
+    ~ScatterPool();
+
+    //Handle to an acquired clone, which is returned to the pool when the
+    //handle is destructed (handles must not outlive the pool):
+    class NCRYSTAL_API Handle final : private MoveOnly {
+    public:
+      Scatter& operator*() const noexcept { return *m_sc; }
+      Scatter* operator->() const noexcept { return m_sc.get(); }
+      Scatter& scatter() const noexcept { return *m_sc; }
+      Handle( Handle&& ) = default;
+      Handle& operator=( Handle&& );
+      ~Handle();
+    private:
+      friend class ScatterPool;
+      Handle( ScatterPool* pool, std::unique_ptr<Scatter> sc ) noexcept
+        : m_pool(pool), m_sc(std::move(sc)) {}
+      ScatterPool* m_pool;
+      std::unique_ptr<Scatter> m_sc;
+    };
+
+    Handle acquire();
+
+    //Return a clone to the pool before the handle is destructed:
+    void release( Handle&& );
+
+    //Make sure at least n idle clones are available:
+    void reserve( std::size_t n );
+
+    //Number of idle clones, and total number of clones created:
+    std::size_t nIdle() const;
+    std::size_t nCreated() const;
+
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+    void putBack( std::unique_ptr<Scatter> ) noexcept;
+  };
+
+}
+
+#endif
@@ -25,6 +25,7 @@
 #  include "NCrystal/NCDefs.hh"
 #endif
 #include <initializer_list>
+#include <cstring>
 #include <type_traits>
 
 namespace NCrystal {
@@ -297,6 +298,26 @@ namespace NCrystal {
     static constexpr bool large(const SmallVector* THIS) noexcept { return THIS->m_count > NSMALL; }
     static constexpr bool small(const SmallVector* THIS) noexcept { return THIS->m_count <= NSMALL; }
 
+    //Move-construct objects into uninitialised storage. Trivially copyable
+    //objects are simply copied with memcpy when relocating them to a new
+    //buffer (the moved-from objects still formally need to be destructed,
+    //but that is a no-op for such types):
+    using TrivialRelocation = std::integral_constant<bool,std::is_trivially_copyable<TValue>::value>;
+    static void moveConstructN( TValue * src, size_type n, TValue * dest, std::true_type ) noexcept
+    {
+      if ( n )
+        std::memcpy( static_cast<void*>(dest), static_cast<const void*>(src), n * sizeof(TValue) );
+    }
+    static void moveConstructN( TValue * src, size_type n, TValue * dest, std::false_type ) noexcept
+    {
+      for ( TValue * srcE = src + n; src != srcE; ++src )
+        new( (void*)(dest++) ) TValue(std::move(*src));
+    }
+    static void moveConstructN( TValue * src, size_type n, TValue * dest ) noexcept
+    {
+      moveConstructN( src, n, dest, TrivialRelocation() );
+    }
+
     class DetachedHeap {
       TValue * m_begin;
       TValue * m_end;
@@ -315,6 +336,14 @@ namespace NCrystal {
         ++m_end;//on line after TValue constructor (in case it throws)
         assert( m_end <= m_begin + m_capacity );
       }
+      void moveAppend( TValue * b, TValue * e ) noexcept
+      {
+        //NB: calling code is responsible for ensuring adequate capacity.
+        size_type n = static_cast<size_type>( std::distance( b, e ) );
+        assert( m_end + n <= m_begin + m_capacity );
+        moveConstructN( b, n, m_end );
+        m_end += n;
+      }
 
       ~DetachedHeap()
       {
@@ -362,8 +391,7 @@ namespace NCrystal {
       assert( large(THIS) );
       assert( n >= THIS->m_count );
       auto heap = createNewDetachedHeap(n);
-      for ( auto&& e : *THIS )
-        heap.emplace_back(std::move(e));
+      heap.moveAppend( THIS->begin(), THIS->end() );
       adoptHeap(THIS,heap);
     }
 
@@ -432,8 +460,7 @@ namespace NCrystal {
         auto heap = createNewDetachedHeap( NSMALL*2 );//might throw bad_alloc
         //Ok, done with everything that might throw, it is now safe to start
         //modifying our state:
-        for ( auto&& e : *THIS )
-          heap.emplace_back(std::move(e));//noexcept move constructor
+        heap.moveAppend( THIS->begin(), THIS->end() );//noexcept move constructor
         heap.emplace_back(std::move(newvalue));
         TValue * last = std::prev(heap.end());
         adoptHeap( THIS, heap );
@@ -478,9 +505,7 @@ namespace NCrystal {
       clear();
     if ( Impl::small(&o) ) {
       //Move values:
-      auto it = begin();
-      for ( auto&& e : o )
-        new(it++) TValue(std::move(e));
+      Impl::moveConstructN( o.begin(), o.m_count, begin() );
       m_count = o.m_count;
       o.clear();
       Impl::setBeginPtrSmallData(this);
@@ -808,8 +833,7 @@ namespace NCrystal {
     //relying on TValue to be is_nothrow_default_constructible):
     assert( n > NSMALL );
     auto heap = Impl::createNewDetachedHeap( n );
-    for ( auto&&e : *this )
-      heap.emplace_back(std::move(e));
+    heap.moveAppend( begin(), end() );
     for ( size_type i = m_count; i < n; ++i )
       heap.emplace_back();//TValue() is noexcept
     assert( (size_type)std::distance(heap.begin(),heap.end()) == n );
@@ -843,8 +867,7 @@ namespace NCrystal {
     //relying on TValue to be is_nothrow_copy_constructible):
     assert( n > NSMALL );
     auto heap = Impl::createNewDetachedHeap( n );
-    for ( auto&&e : *this )
-      heap.emplace_back(std::move(e));
+    heap.moveAppend( begin(), end() );
     for ( size_type i = m_count; i < n; ++i )
       heap.emplace_back(val_to_copy);//TValue(val_to_copy) is noexcept
     assert( (size_type)std::distance(heap.begin(),heap.end()) == n );
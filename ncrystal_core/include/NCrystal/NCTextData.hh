@@ -53,8 +53,9 @@ namespace NCrystal {
   public:
     //Low-level string data object which does not have any sort of meta-data. Is
     //cheap to copy around and should not have any life-time issues, since it
-    //internally wraps either a long-lived const char pointer or a
-    //shared_obj<std::string> object. The data is always contiguous and
+    //internally wraps either a long-lived const char pointer, a
+    //shared_obj<std::string> object, or data kept alive by some other shared
+    //object. The data is always contiguous and
     //null-terminated (thus can only store data with null-free encodings like
     //ASCII or UTF-8). Constructors taking std::string also optionally takes a
     //srcdescr parameter which is used for more meaningful error messages in
@@ -66,6 +67,13 @@ namespace NCrystal {
     RawStrData( std::string&&, const DataSourceName& );
     RawStrData( shared_obj<std::string>, const DataSourceName& );
 
+    //Data kept alive by some other object (e.g. memory-mapped file content),
+    //which must be null-terminated at dataEnd:
+    struct external_owner_t {};
+    RawStrData( external_owner_t, std::shared_ptr<const void> owner,
+                const char * dataBegin, const char * dataEnd,
+                const char * srcdescr = nullptr );
+
     RawStrData( const RawStrData& ) = default;
     RawStrData( RawStrData&& ) = default;
     RawStrData& operator=( const RawStrData& ) = default;
@@ -85,9 +93,13 @@ namespace NCrystal {
     //Expose checksum algorithm for usage without RawStrData objects:
     static uint64_t checkSumFromRawStringData(const char*begin, const char*end);
 
+    //Owner of external data (nullptr if not constructed with external_owner_t):
+    const std::shared_ptr<const void>& externalOwner() const noexcept { return m_owner; }
+
   private:
     const char *m_b, *m_e;
     optional_shared_obj<std::string> m_s;
+    std::shared_ptr<const void> m_owner;
   };
 
   class NCRYSTAL_API TextData : private MoveOnly {
@@ -0,0 +1,71 @@
+#ifndef NCrystal_Trace_hh
+#define NCrystal_Trace_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCDefs.hh"
+
+////////////////////////////////////////////////////////////////////////////////
+// Tracing hooks, for connecting NCrystal to external profilers and timeline  //
+// collectors (e.g. Tracy or ITT), to see NCrystal's contribution inside      //
+// traces of whole applications. The hooks are only invoked when NCrystal is  //
+// built with -DENABLE_TRACING=ON, otherwise the instrumentation compiles to  //
+// nothing (and isCompiledIn() returns false).                                //
+//                                                                            //
+// Zones are marked around the initialisation stages also covered by          //
+// NCRYSTAL_PROFILE_INIT: the factory lookups (createInfo, createScatter,     //
+// createAbsorption, TextData), NCMAT parsing, loadNCMAT, Info building, HKL  //
+// plane calculations, VDOS expansion, SAB integration and plugin loading.    //
+// Optionally, zones are also marked around all cross section and sampling    //
+// calls of ProcComposition objects (i.e. the processes of most materials),   //
+// which is only recommended for profilers with very low overhead.            //
+//                                                                            //
+// Zone names are string literals (so the pointers can be used for zone       //
+// identification), while the details (e.g. a cfg-string or a filename, or an //
+// empty string) are only valid during the begin call. Zones are strictly     //
+// nested within each thread, and each end call happens in the same thread as //
+// the corresponding begin call. The hooks can be invoked concurrently from   //
+// multiple threads, and must be thread-safe.                                 //
+////////////////////////////////////////////////////////////////////////////////
+
+namespace NCrystal {
+
+  namespace Trace {
+
+    using BeginZoneFct = void(*)( const char * zone, const char * details, void * userdata );
+    using EndZoneFct = void(*)( const char * zone, void * userdata );
+
+    //Whether tracing is compiled in:
+    NCRYSTAL_API bool isCompiledIn();
+
+    //Install hooks (replacing any previous ones). Zones already started will
+    //still be ended with their original hooks:
+    NCRYSTAL_API void setHooks( BeginZoneFct, EndZoneFct, void * userdata = nullptr,
+                                bool includeSamplingZones = false );
+
+    //Remove any installed hooks:
+    NCRYSTAL_API void clearHooks();
+
+  }
+
+}
+
+#endif
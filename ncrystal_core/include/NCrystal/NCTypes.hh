@@ -57,6 +57,13 @@ namespace NCrystal {
     //malloc on next usage. This function should ideally be called through the
     //free-standing invalidateCache function:
     virtual void invalidateCache() = 0;
+
+    //Cache objects are allocated through these, which place them in the
+    //memory arena of an enclosing ProcComposition cache when one is active in
+    //the current thread (keeping component caches together in memory), and
+    //otherwise on the heap:
+    static void* operator new( std::size_t );
+    static void operator delete( void* ) noexcept;
   };
   using CachePtr = std::unique_ptr<CacheBase>;
 
@@ -410,6 +417,12 @@ namespace NCrystal {
   enum class MaterialType { Anisotropic, Isotropic };
   enum class ProcessType { Absorption, Scatter };
 
+  //Extent of the lazy initialisation carried out by Process::warmup (see
+  //NCProcImpl.hh). Essential creates the structures needed by any call, while
+  //Complete also creates all energy dependent structures in the requested
+  //energy range:
+  enum class WarmupLevel { Essential, Complete };
+
   NCRYSTAL_API std::ostream& operator<<(std::ostream&, MaterialType);
   NCRYSTAL_API std::ostream& operator<<(std::ostream&, ProcessType);
 
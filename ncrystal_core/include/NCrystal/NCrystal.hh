@@ -49,6 +49,9 @@
 #ifndef NCrystal_PluginMgmt_hh
 #  include "NCrystal/NCPluginMgmt.hh"
 #endif
+#ifndef NCrystal_Trace_hh
+#  include "NCrystal/NCTrace.hh"
+#endif
 #ifndef NCrystal_AtomData_hh
 #  include "NCrystal/NCAtomData.hh"
 #endif
@@ -97,6 +100,12 @@
 #ifndef NCrystal_Proc_hh
 #  include "NCrystal/NCProc.hh"
 #endif
+#ifndef NCrystal_BatchScheduler_hh
+#  include "NCrystal/NCBatchScheduler.hh"
+#endif
+#ifndef NCrystal_ScatterPool_hh
+#  include "NCrystal/NCScatterPool.hh"
+#endif
 #ifndef NCrystal_FactTypes_hh
 #  include "NCrystal/NCFactTypes.hh"
 #endif
@@ -37,7 +37,20 @@ namespace NCrystal {
     const char * name() const noexcept final { return "AbsOOV"; }
     CrossSect crossSectionIsotropic(CachePtr&, NeutronEnergy ) const final;
 
+    //Same, but inline and not requiring a cache (for fast paths in client code
+    //which has already determined that a given process is an AbsOOV instance):
+    CrossSect crossSectionOOV( NeutronEnergy ekin ) const
+    {
+      return ProcImpl::OOVCrossSection{ m_c }.evaluate( ekin );
+    }
+
+    Optional<ProcImpl::OOVCrossSection> analyticOOVCrossSection() const final
+    {
+      return ProcImpl::OOVCrossSection{ m_c };
+    }
+
     EnergyDomain domain() const noexcept override { return m_domain; }
+    unsigned capabilities() const noexcept override { return CapStateless; }
 
     //Simple additive merge:
     std::shared_ptr<Process> createMerged( const Process& other,
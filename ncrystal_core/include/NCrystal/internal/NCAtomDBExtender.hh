@@ -22,6 +22,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "NCrystal/NCAtomData.hh"
+#include <unordered_map>
 
 namespace NCrystal {
 
@@ -57,7 +58,7 @@ namespace NCrystal {
     //problems. Each call to addData takes a single "line", consisting of
     //multiple words. In general only simple ASCII characters are allowed, and
     //whitespace is normalised and trimmed.
-    constexpr static int latest_version = 6;
+    constexpr static int latest_version = 7;
     void addData( const VectS& words, unsigned format_version = latest_version );
     void addData( const std::string& line, unsigned format_version = latest_version );
 
@@ -79,7 +80,8 @@ namespace NCrystal {
   private:
     bool m_allowInbuiltDB;
     void populateDB(const std::string&,AtomDataSP);
-    std::map<std::string,AtomDataSP> m_db;
+    std::unordered_map<std::string,AtomDataSP> m_db;
+    std::unordered_map<std::string,AtomDataSP> m_inbuiltCache;//labels resolved via AtomDB
   };
 
 }
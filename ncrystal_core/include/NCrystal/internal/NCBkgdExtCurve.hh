@@ -33,18 +33,42 @@ namespace NCrystal {
     //external functions for calculating cross-sections, using the XSectProvider
     //section in the passed Info object. Scatterings will be elastic and
     //isotropic.
+    //
+    //Since the external functions might be expensive, cross sections are
+    //tabulated at construction for energies in [emin,emax], on a grid which is
+    //refined until linear interpolation reproduces the external function to a
+    //relative precision of tolerance. Outside the tabulated range (or if
+    //tolerance is not positive), the external function is invoked directly.
 
     const char * name() const noexcept final { return "BkgdExtCurve"; }
 
-    BkgdExtCurve( shared_obj<const Info> );
+    BkgdExtCurve( shared_obj<const Info>,
+                  double tolerance = 1e-3,
+                  NeutronEnergy emin = NeutronEnergy{1e-5},
+                  NeutronEnergy emax = NeutronEnergy{10.0} );
     virtual ~BkgdExtCurve();
 
     CrossSect crossSectionIsotropic(CachePtr&, NeutronEnergy ) const final;
+    void crossSectionIsotropicMany( CachePtr&, const double* ekin,
+                                    std::size_t N, double* out_xs ) const final;
     ScatterOutcomeIsotropic sampleScatterIsotropic(CachePtr&, RNG&, NeutronEnergy ) const final;
     ScatterOutcome sampleScatter(CachePtr&, RNG&, NeutronEnergy, const NeutronDirection& ) const final;
+    void sampleScatterMany( CachePtr&, RNG&, const double* ekin, const NeutronDirection* dirs,
+                            std::size_t N, ScatterOutcome* out ) const final;
+    void sampleScatterIsotropicMany( CachePtr&, RNG&, const double* ekin,
+                                     std::size_t N, ScatterOutcomeIsotropic* out ) const final;
+    unsigned capabilities() const noexcept final { return CapBatchCrossSection | CapBatchSampling | CapStateless; }
+
+    std::size_t memoryFootprint() const override;
+
+    //Number of points in the tabulation (0 if not tabulated):
+    std::size_t nTabulationPoints() const { return m_egrid.size(); }
 
   protected:
     shared_obj<const Info> m_ci;
+    VectD m_egrid;
+    VectD m_xs;
+    double evalXS( double ekin ) const;
   };
 }
 
@@ -0,0 +1,87 @@
+#ifndef NCrystal_CPUDispatch_hh
+#define NCrystal_CPUDispatch_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCDefs.hh"
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Runtime selection between variants of hot loops compiled for different     //
+// instruction set extensions, so a single build can run optimally on several //
+// CPU generations. Variants are only compiled in when NCrystal is built with //
+// -DENABLE_SIMD_DISPATCH=ON (the default) by GCC or Clang for x86-64, which  //
+// defines NCRYSTAL_ENABLE_SIMD_DISPATCH for the library sources. Elsewhere,  //
+// and on aarch64 where NEON is always available, only the baseline variants  //
+// (SSE2 or NEON) exist.                                                      //
+//                                                                            //
+// The body of a loop is written once as a function marked with               //
+// NCRYSTAL_SIMD_INLINE, and the loop itself is repeated in functions marked  //
+// with NCRYSTAL_TARGET_AVX2 and NCRYSTAL_TARGET_AVX512 (compilers do not     //
+// vectorise loops inlined from functions lacking the target attributes),     //
+// between which the calling code selects with a switch on activeISA().       //
+//                                                                            //
+// When dispatching is enabled, source files containing such variants must    //
+// be built with -ffp-contract=off (so the variants are not allowed to fuse   //
+// multiplications and additions, and produce results identical to those of   //
+// the baseline variants, as long as the loops are free of reductions) and    //
+// with -fno-trapping-math (needed for vectorisation of loops with            //
+// comparisons and divisions). This is done per file in CMakeLists.txt, so    //
+// files adding new variants must be added there as well.                     //
+//                                                                            //
+// For testing, the environment variable NCRYSTAL_SIMD can be set to one of   //
+// "baseline", "avx2" or "avx512" to limit the selection (values above what   //
+// the CPU supports are lowered accordingly).                                 //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#if defined(NCRYSTAL_ENABLE_SIMD_DISPATCH) && ( defined(__GNUC__) || defined(__clang__) ) && defined(__x86_64__)
+#  define NCRYSTAL_SIMD_DISPATCH_X86
+#  define NCRYSTAL_TARGET_AVX2 __attribute__((target("avx2")))
+#  define NCRYSTAL_TARGET_AVX512 __attribute__((target("avx512f,avx512dq,avx2")))
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+#  define NCRYSTAL_SIMD_INLINE inline __attribute__((always_inline))
+#else
+#  define NCRYSTAL_SIMD_INLINE inline
+#endif
+
+namespace NCrystal {
+
+  namespace CPUDispatch {
+
+    enum class ISA : unsigned { Baseline = 0, AVX2 = 1, AVX512 = 2 };
+
+    //The variant to use (determined upon first call):
+    ISA activeISA();
+
+    //Most capable variant which is compiled in and supported by the CPU
+    //(i.e. ignoring NCRYSTAL_SIMD):
+    ISA supportedISA();
+
+    //Names like "avx2", with the baseline being "sse2" or "neon" if known:
+    const char * isaName( ISA );
+
+  }
+
+}
+
+#endif
@@ -109,6 +109,7 @@ namespace NCrystal {
       //Comparisons:
       static bool equal( const CfgData&, const CfgData& );
       static bool lessThan( const CfgData&, const CfgData& );//unspecified ordering
+      static HashValue hash( const CfgData& );//equal objects have equal hashes
 
       //Applies variables contained in other CfgData object to object:
       static void apply( CfgData&, const CfgData&, VarIdFilter = nullptr );
@@ -170,12 +171,20 @@ namespace NCrystal {
 
       static double get_mosprec(const CfgData& data) { return getValue<vardef_mosprec>(data); }
       static void set_mosprec( CfgData& data, double val ) { setValue<vardef_mosprec>(data,val); }
+      static double get_mosscreen(const CfgData& data) { return getValue<vardef_mosscreen>(data); }
+      static void set_mosscreen( CfgData& data, double val ) { setValue<vardef_mosscreen>(data,val); }
 
       static double get_sccutoff(const CfgData& data) { return getValue<vardef_sccutoff>(data); }
       static void set_sccutoff( CfgData& data, double val ) { setValue<vardef_sccutoff>(data,val); }
+      static double get_scprune(const CfgData& data) { return getValue<vardef_scprune>(data); }
+      static void set_scprune( CfgData& data, double val ) { setValue<vardef_scprune>(data,val); }
 
       static int get_vdoslux(const CfgData& data) { return static_cast<int>( getValue<vardef_vdoslux>(data) ); }
       static void set_vdoslux( CfgData& data, int val ) { setValue<vardef_vdoslux>( data, static_cast<std::int64_t>(val) ); }
+      static int get_sabsampler(const CfgData& data) { return static_cast<int>( getValue<vardef_sabsampler>(data) ); }
+      static void set_sabsampler( CfgData& data, int val ) { setValue<vardef_sabsampler>( data, static_cast<std::int64_t>(val) ); }
+      static int get_elincsampler(const CfgData& data) { return static_cast<int>( getValue<vardef_elincsampler>(data) ); }
+      static void set_elincsampler( CfgData& data, int val ) { setValue<vardef_elincsampler>( data, static_cast<std::int64_t>(val) ); }
 
       static std::int_least32_t get_lcmode(const CfgData& data) { return static_cast<std::int_least32_t>( getValue<vardef_lcmode>(data) ); }
       static void set_lcmode( CfgData& data, std::int_least32_t val ) { setValue<vardef_lcmode>( data,static_cast<std::int_least32_t>(val) ); }
@@ -215,6 +224,10 @@ namespace NCrystal {
       static void set_atomdb_stdstr( CfgData& data, const std::string& val ) { setValue<vardef_atomdb,std::string>(data,val); }
       static void set_atomdb_cstr( CfgData& data, const char * val ) { setValue<vardef_atomdb,const char *>(data,val); }
 
+      static StrView get_sabgrid(const CfgData& data) { return getValue<vardef_sabgrid>(data); }
+      static void set_sabgrid( CfgData& data, StrView val ) { setValue<vardef_sabgrid>(data,val); }
+      static void set_sabgrid_stdstr( CfgData& data, const std::string& val ) { setValue<vardef_sabgrid,std::string>(data,val); }
+      static void set_sabgrid_cstr( CfgData& data, const char * val ) { setValue<vardef_sabgrid,const char *>(data,val); }
       static StrView get_inelas(const CfgData& data) { return getValue<vardef_inelas>(data); }
       static void set_inelas( CfgData& data, StrView val ) { setValue<vardef_inelas>(data,val); }
       static void set_inelas_stdstr( CfgData& data, const std::string& val ) { setValue<vardef_inelas,std::string>(data,val); }
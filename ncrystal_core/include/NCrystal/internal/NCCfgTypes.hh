@@ -50,6 +50,9 @@ namespace NCrystal {
         NCRYSTAL_THROW2(BadInput,"NAN (not-a-number) value provided for parameter \""<<varname<<"\"");
       return ( v == 0.0 ? 0.0 : v );
     }
+    inline HashValue hashDblValue(double v) {
+      return calcHash( v == 0.0 ? 0.0 : v );//+0 and -0 must hash identically
+    }
     using ValDbl_ShortStrOrigRep = ShortStr<VarBuf::buffer_local_size - sizeof(double)>;
     struct units_notavail {
       static constexpr auto actual_unit = nullptr;
@@ -189,6 +192,12 @@ namespace NCrystal {
         return std::strcmp(cstr_A,cstr_B);
       }
 
+      static HashValue hash( const VarBuf& buf )
+      {
+        //Just the value (consistent with cmp, strreps only matter for equal values):
+        return hashDblValue( get_val( buf ) );
+      }
+
       static double get_val( const VarBuf& buf )
       {
         return *reinterpret_cast<const double*>(buf.dataAssertLocal());
@@ -256,6 +265,14 @@ namespace NCrystal {
       {
         return get_val( a ).lexCmp( get_val( b ) );
       }
+      static HashValue hash( const VarBuf& buf )
+      {
+        const Vector& v = get_val( buf );
+        HashValue h = hashDblValue( v[0] );
+        hash_combine( h, hashDblValue( v[1] ) );
+        hash_combine( h, hashDblValue( v[2] ) );
+        return h;
+      }
       static VarBuf set_val( VarId varid, const Vector& value ) {
         static_assert(std::is_trivially_destructible<Vector>::value,"");
         static_assert(std::is_trivially_copyable<Vector>::value,"");
@@ -352,6 +369,15 @@ namespace NCrystal {
         return 0;
       }
 
+      static HashValue hash( const VarBuf& buf )
+      {
+        auto db = detail_bufdecode(buf);
+        HashValue h = calcHash( db.crystal_is_hkl );
+        for ( auto i : ncrange(6) )
+          hash_combine( h, hashDblValue( db.vals[i] ) );
+        return h;
+      }
+
       static VarBuf set_val( VarId varid, const OrientDir& value ) {
         //nc_assert_always(!value.crystal.empty());//fails if moved-from
         alignas(double) char tmp[6*sizeof(double)+1];
@@ -482,6 +508,17 @@ namespace NCrystal {
         return valA == valB ? 0 : ( valA < valB ? -1 : 1 );
       }
 
+      static HashValue hash( const VarBuf& buf )
+      {
+        //FNV-1a (avoids creating a std::string):
+        std::uint64_t h = 14695981039346656037ULL;
+        for ( char c : get_val( buf ) ) {
+          h ^= static_cast<unsigned char>( c );
+          h *= 1099511628211ULL;
+        }
+        return static_cast<HashValue>( h );
+      }
+
       static VarBuf set_val( VarId varid, StrView value ) {
         return actual_set_val( varid, value );
       }
@@ -550,6 +587,8 @@ namespace NCrystal {
         return valA == valB ? 0 : ( valA ? -1 : 1 );
       }
 
+      static HashValue hash( const VarBuf& buf ) { return calcHash( get_val( buf ) ); }
+
       static bool get_val( const VarBuf& buf )
       {
         static_assert(VarBuf::buffer_local_size>=1,"");
@@ -597,6 +636,8 @@ namespace NCrystal {
         return valA == valB ? 0 : ( valA < valB ? -1 : 1 );
       }
 
+      static HashValue hash( const VarBuf& buf ) { return calcHash( get_val( buf ) ); }
+
       static int64_t get_val( const VarBuf& buf )
       {
         static_assert(VarBuf::buffer_local_size>=sizeof(int64_t),"");
@@ -635,6 +676,7 @@ namespace NCrystal {
     using VarFromStrFct = VarBuf(*)(VarId, StrView);
     using StreamVarFct  = void(*)(std::ostream&, const VarBuf&);
     using BufCmpFct = int(*)(const VarBuf&,const VarBuf&);
+    using BufHashFct = HashValue(*)(const VarBuf&);
     using BufToJSONFct = void(*)(std::ostream&, const VarBuf&);
 
     class VarInfo final {
@@ -645,6 +687,7 @@ namespace NCrystal {
       constexpr VarInfo( VarFromStrFct fs,
                          StreamVarFct sv,
                          BufCmpFct bcf,
+                         BufHashFct bhf,
                          VarGroupId grId,
                          const char * thename,
                          const char * thedescr,
@@ -657,6 +700,7 @@ namespace NCrystal {
         : m_fromStrFct(fs),
           m_streamFct(sv),
           m_bcf(bcf),
+          m_bhf(bhf),
           m_groupId(grId),
           m_namecstr(thename),
           m_name(StrView::constexpr_t(),thename),
@@ -673,6 +717,7 @@ namespace NCrystal {
       void stream( std::ostream& os, const VarBuf& buf) const { m_streamFct(os,buf); }
       void streamAsJSON( std::ostream& os, const VarBuf& buf ) const { nc_assert(m_jsonfct); m_jsonfct(os,buf); }
       int bufCmp( const VarBuf& a, const VarBuf& b ) const { return m_bcf(a,b); }
+      HashValue bufHash( const VarBuf& buf ) const { return m_bhf(buf); }//consistent with bufCmp
       constexpr VarGroupId groupId() const noexcept { return m_groupId; }
       constexpr const char * name() const noexcept { return m_namecstr; }
       constexpr const StrView& nameSV() const noexcept { return m_name; }
@@ -689,6 +734,7 @@ namespace NCrystal {
       VarFromStrFct m_fromStrFct;
       StreamVarFct m_streamFct;
       BufCmpFct m_bcf;
+      BufHashFct m_bhf;
       VarGroupId m_groupId;
       const char * m_namecstr;
       StrView m_name;//NB: Could potentially keep name in local buffer, for
@@ -711,6 +757,7 @@ namespace NCrystal {
       return VarInfo( TVarDef::from_str,
                       TVarDef::stream_val,
                       TVarDef::cmp,
+                      TVarDef::hash,
                       TVarDef::group,
                       TVarDef::name,
                       TVarDef::description,
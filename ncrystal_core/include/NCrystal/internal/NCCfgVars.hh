@@ -109,6 +109,27 @@ namespace NCrystal {
       }
     };
 
+    struct vardef_scprune final : public ValDbl<vardef_scprune> {
+      static constexpr auto name = "scprune";
+      static constexpr auto group = VarGroupId::ScatterExtra;
+      static constexpr auto description =
+        "Single-crystal plane pruning tolerance. Families of crystal planes are"
+        " discarded, starting with those contributing the least, as long as the"
+        " discarded fraction of the orientation-averaged Bragg diffraction cross"
+        " section stays below this value at all neutron wavelengths. This reduces"
+        " initialisation time, memory usage and the cost of cross section"
+        " evaluations, at the price of a controlled error. A value of 0 naturally"
+        " disables the pruning entirely.";
+      static constexpr value_type default_value() { return 0.0; }
+      using units = units_purenumberonly;
+      static double value_validate( double value )
+      {
+        if ( ! (value >= 0.0 && value < 1.0) )
+          NCRYSTAL_THROW2(BadInput,name<<" must be in the range [0.0,1.0)");
+        return value;
+      }
+    };
+
     struct vardef_mos final : public ValDbl<vardef_mos> {
       static constexpr auto name = "mos";
       static constexpr auto group = VarGroupId::ScatterExtra;
@@ -184,6 +205,32 @@ namespace NCrystal {
       }
     };
 
+    struct vardef_mosscreen final : public ValDbl<vardef_mosscreen> {
+      static constexpr auto name = "mosscreen";
+      static constexpr auto group = VarGroupId::ScatterExtra;
+      static constexpr auto description =
+        "Screening of the tails of the mosaicity distribution in single crystals."
+        " Reflection planes are skipped (with a cheap test) whenever the Gaussian"
+        " density of crystallite orientations nowhere on their circle of Bragg"
+        " scattering exceeds this fraction of its peak value, while contributions"
+        " from the remaining planes are still evaluated with the full mosprec precision."
+        " A value of 0 disables the screening, and values below mosprec have little"
+        " or no effect, since the mosaicity distribution is already truncated at a"
+        " comparable level. Larger values (e.g. 0.01 or 0.05) speed up cross sections"
+        " and scatterings in crystals with many reflection planes, at the cost of"
+        " underestimating cross sections by the contribution of the skipped tails"
+        " (which is roughly bounded by the value itself, and is typically a few"
+        " tenths of a percent for a value of 0.01 and 1-2% for 0.05).";
+      static constexpr value_type default_value() { return 0.0; }
+      using units = units_purenumberonly;
+      static double value_validate( double value )
+      {
+        if ( !(value>=0.0) || value>0.5 )
+          NCRYSTAL_THROW2(BadInput,name<<" must be in range [0,0.5]");
+        return value;
+      }
+    };
+
     struct vardef_vdoslux final : public ValInt<vardef_vdoslux> {
       static constexpr auto name = "vdoslux";
       static constexpr auto group = VarGroupId::ScatterBase;
@@ -211,6 +258,58 @@ namespace NCrystal {
       }
     };
 
+    struct vardef_sabsampler final : public ValInt<vardef_sabsampler> {
+      static constexpr auto name = "sabsampler";
+      static constexpr auto group = VarGroupId::ScatterBase;
+      static constexpr auto description =
+        "Choose which algorithm is used when sampling energy and momentum"
+        " transfers from scattering kernels, S(alpha,beta). The default value 0"
+        " selects the reference algorithm, in which beta and alpha bins are"
+        " located with binary searches in cumulative distributions. The value 1"
+        " selects an implementation of the same model in which beta bins are"
+        " picked in constant time with alias tables, and alpha bins are located"
+        " with guide tables (faster, but with a slightly higher memory usage,"
+        " and results which are only statistically equivalent)."
+        ;
+      static constexpr value_type default_value() { return 0; }
+      static value_type value_validate( value_type value )
+      {
+        if ( value < 0 || value > 1 )
+          NCRYSTAL_THROW2(BadInput,name<<" must be an integral value from 0 to 1");
+        return value;
+      }
+    };
+
+    struct vardef_sabgrid final : public ValStr<vardef_sabgrid> {
+      static constexpr auto name = "sabgrid";
+      static constexpr auto group = VarGroupId::ScatterBase;
+      static constexpr auto description =
+        "Density of the neutron energy grid on which cross sections and sampling"
+        " tables are prepared for scattering kernels, S(alpha,beta), trading"
+        " accuracy for initialisation time and memory usage (both of which"
+        " scale approximately linearly with the number of grid points). Allowed"
+        " values are \"default\" (300 points unless specified otherwise in the"
+        " input data, cross sections below 1eV typically within 0.2% of those"
+        " obtained with \"fine\"), \"coarse\" (5 times fewer points, intended"
+        " for quick preview runs, with deviations up to 1%), and \"fine\" (3"
+        " times more points). Finally, \"adaptive\" starts from a coarse grid and"
+        " adds points only where linear interpolation of the cross section is"
+        " not precise to 0.1%, typically needing far fewer points than"
+        " \"default\" for a similar accuracy (but never more than \"fine\")."
+        " Input data providing a complete energy grid is not affected. Note"
+        " that the granularity of kernels expanded from VDOS curves is"
+        " controlled separately by the vdoslux parameter."
+        ;
+      static constexpr value_type default_value() { return StrView::make("default"); }
+      static Variant<StrView,std::string> str2val( StrView sv )
+      {
+        if (!isOneOf(sv,"coarse","default","fine","adaptive"))
+          NCRYSTAL_THROW2(BadInput,"invalid value specified for parameter "<<name<<": \""<<sv
+                          <<"\" (must be one of \"coarse\", \"default\", \"fine\", or \"adaptive\")");
+        return sv;
+      }
+    };
+
     struct vardef_lcaxis final : public ValVector<vardef_lcaxis> {
       static constexpr auto name = "lcaxis";
       static constexpr auto group = VarGroupId::ScatterExtra;
@@ -243,7 +342,11 @@ namespace NCrystal {
         " (ignored unless the lcaxis, dir1, and dir2 parameters are set)."
         " The default value 0"
         " enables the recommended model, which is both fast and"
-        " accurate. A positive value N triggers a very slow but simple"
+        " accurate. The special value 1000000000 selects the same model,"
+        " but with cross sections interpolated from tables built when the"
+        " process is warmed up (faster when cross sections are needed much"
+        " more often than scatterings, e.g. for filters). A positive value"
+        " N triggers a very slow but simple"
         " reference model, in which N crystallite orientations"
         " are sampled internally (the model is accurate only when N"
         " is very high). A negative value -N triggers a different (and"
@@ -262,6 +365,26 @@ namespace NCrystal {
       }
     };
 
+    struct vardef_elincsampler final : public ValInt<vardef_elincsampler> {
+      static constexpr auto name = "elincsampler";
+      static constexpr auto group = VarGroupId::ScatterBase;
+      static constexpr auto description =
+        "Choose which algorithm is used when sampling scattering angles of"
+        " incoherent elastic scattering components. The default value 0"
+        " selects the reference algorithm, based on an analytical inversion of"
+        " the cumulative distribution. The value 1 replaces the logarithm in"
+        " that inversion with a lookup in a shared table (faster, with a"
+        " relative precision of sampled 1-mu values better than 1e-7)."
+        ;
+      static constexpr value_type default_value() { return 0; }
+      static value_type value_validate( value_type value )
+      {
+        if ( value < 0 || value > 1 )
+          NCRYSTAL_THROW2(BadInput,name<<" must be an integral value from 0 to 1");
+        return value;
+      }
+    };
+
     struct vardef_incoh_elas final : public ValBool<vardef_incoh_elas> {
       static constexpr auto name = "incoh_elas";
       static constexpr auto group = VarGroupId::ScatterBase;
@@ -507,6 +630,7 @@ namespace NCrystal {
       make_varinfo<vardef_dir1>(),
       make_varinfo<vardef_dir2>(),
       make_varinfo<vardef_dirtol>(),
+      make_varinfo<vardef_elincsampler>(),
       make_varinfo<vardef_incoh_elas>(),
       make_varinfo<vardef_inelas>(),
       make_varinfo<vardef_infofactory>(),
@@ -514,9 +638,13 @@ namespace NCrystal {
       make_varinfo<vardef_lcmode>(),
       make_varinfo<vardef_mos>(),
       make_varinfo<vardef_mosprec>(),
+      make_varinfo<vardef_mosscreen>(),
+      make_varinfo<vardef_sabgrid>(),
+      make_varinfo<vardef_sabsampler>(),
       make_varinfo<vardef_sans>(),
       make_varinfo<vardef_scatfactory>(),
       make_varinfo<vardef_sccutoff>(),
+      make_varinfo<vardef_scprune>(),
       make_varinfo<vardef_temp>(),
       make_varinfo<vardef_vdoslux>()
     };
@@ -529,11 +657,16 @@ namespace NCrystal {
     enum class detail::VarId : std::uint32_t {
       temp    = constexpr_varName2Idx("temp"),
       sccutoff = constexpr_varName2Idx("sccutoff"),
+      scprune = constexpr_varName2Idx("scprune"),
       dcutoff = constexpr_varName2Idx("dcutoff"),
       dcutoffup = constexpr_varName2Idx("dcutoffup"),
       dirtol = constexpr_varName2Idx("dirtol"),
       mosprec = constexpr_varName2Idx("mosprec"),
+      mosscreen = constexpr_varName2Idx("mosscreen"),
       vdoslux = constexpr_varName2Idx("vdoslux"),
+      sabsampler = constexpr_varName2Idx("sabsampler"),
+      sabgrid = constexpr_varName2Idx("sabgrid"),
+      elincsampler = constexpr_varName2Idx("elincsampler"),
       lcmode = constexpr_varName2Idx("lcmode"),
       lcaxis = constexpr_varName2Idx("lcaxis"),
       mos = constexpr_varName2Idx("mos"),
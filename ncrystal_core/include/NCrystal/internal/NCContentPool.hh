@@ -0,0 +1,89 @@
+#ifndef NCrystal_ContentPool_hh
+#define NCrystal_ContentPool_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/internal/NCMath.hh"
+#include <map>
+
+namespace NCrystal {
+
+  //Thread-safe pool for content-addressed sharing of large immutable objects
+  //(like HKL lists) between otherwise unrelated objects (like Info objects
+  //created from cfgs differing only by irrelevant parameters). Calling
+  //intern(obj,hash) returns a previously interned object with identical
+  //content if one is still alive, otherwise obj itself is adopted and
+  //returned. Only weak references are kept, so the pool never extends object
+  //lifetimes. Objects with equal content should have equal hash values (if
+  //not, sharing opportunities are simply missed).
+
+  template<class T, class TEqual = std::equal_to<T>>
+  class ContentPool final : private NoCopyMove {
+  public:
+    std::shared_ptr<const T> intern( T&& obj, HashValue hash );
+  private:
+    std::mutex m_mtx;
+    std::multimap<HashValue,std::weak_ptr<const T>> m_db;
+    std::size_t m_purgeThreshold = 64;
+  };
+
+}
+
+
+////////////////////////////
+// Inline implementations //
+////////////////////////////
+
+namespace NCrystal {
+
+  template<class T, class TEqual>
+  inline std::shared_ptr<const T> ContentPool<T,TEqual>::intern( T&& obj, HashValue hash )
+  {
+    NCRYSTAL_LOCK_GUARD(m_mtx);
+    auto range = m_db.equal_range( hash );
+    for ( auto it = range.first; it != range.second; ) {
+      auto sp = it->second.lock();
+      if ( !sp ) {
+        it = m_db.erase( it );
+        continue;
+      }
+      if ( TEqual()( *sp, obj ) )
+        return sp;
+      ++it;
+    }
+    auto res = std::make_shared<const T>( std::move(obj) );
+    m_db.emplace( hash, res );
+    if ( m_db.size() > m_purgeThreshold ) {
+      //Purge expired entries, and adapt threshold to keep amortized cost low:
+      for ( auto it = m_db.begin(); it != m_db.end(); ) {
+        if ( it->second.expired() )
+          it = m_db.erase( it );
+        else
+          ++it;
+      }
+      m_purgeThreshold = std::max<std::size_t>( 64, 2 * m_db.size() );
+    }
+    return res;
+  }
+
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef NCrystal_DiskCacheUtils_hh
+#define NCrystal_DiskCacheUtils_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCDefs.hh"
+#include <functional>
+#include <ostream>
+
+namespace NCrystal {
+
+  //Utilities shared by the opt-in persistent on-disk caches (of HKL lists,
+  //scattering kernels, ...). Entries of such caches are keyed by a byte string
+  //describing all inputs of the calculation (the "key material"), which is
+  //stored in full in the files and verified upon loading, while the file names
+  //are derived from a hash of the key material.
+
+  class DiskCacheKeyMaterial {
+  public:
+    DiskCacheKeyMaterial() = default;
+    explicit DiskCacheKeyMaterial( const char * tag ) { add(tag); }
+    DiskCacheKeyMaterial& add( const char * );//includes terminating null char
+    DiskCacheKeyMaterial& add( double );
+    DiskCacheKeyMaterial& add( uint64_t );
+    DiskCacheKeyMaterial& add( const VectD& );//includes size
+    const std::string& str() const { return m_data; }
+    uint64_t hash() const;
+  private:
+    std::string m_data;
+  };
+
+  //64 bit FNV-1a hash (stable across platforms and processes, unlike
+  //std::hash):
+  uint64_t fnv1a64( const std::string& );
+
+  //Cache file name "<prefix><hash>.bin" in the directory dir:
+  std::string diskCacheFileName( const std::string& dir,
+                                 const char * prefix,
+                                 const DiskCacheKeyMaterial& );
+
+  //Write file via a temporary file (with a name which is unique across
+  //processes and threads) which is renamed when complete, so other processes
+  //never see partially written files. Returns false on errors (in which case
+  //the temporary file is removed and fn is left untouched):
+  bool writeFileAtomically( const std::string& fn,
+                            const std::function<void(std::ostream&)>& writefct );
+
+  //Runtime-adjustable cache directory, initially taken from the
+  //NCRYSTAL_<envname> environment variable (see initialCacheDirSetting in
+  //NCFileUtils.hh). An empty string means the cache is disabled. While a
+  //DiskCacheDirScope is active in the current thread, get() returns the
+  //directory of the innermost such scope instead:
+  class DiskCacheDirSetting : private NoCopyMove {
+  public:
+    DiskCacheDirSetting( const char * envname );
+    std::string get() const;
+    void set( std::string );
+  private:
+    mutable std::mutex m_mtx;
+    std::string m_dir;
+  };
+
+  //Direct all disk caches to the given directory, but only for the current
+  //thread and the lifetime of the scope object (used when creating snapshots,
+  //without affecting other threads):
+  class DiskCacheDirScope : private NoCopyMove {
+  public:
+    DiskCacheDirScope( std::string dir );
+    ~DiskCacheDirScope();
+  private:
+    std::string m_dir;
+    const std::string * m_prev;
+  };
+
+}
+
+#endif
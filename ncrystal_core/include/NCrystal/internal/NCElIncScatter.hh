@@ -33,6 +33,7 @@ namespace NCrystal {
     bool use_sigma_incoherent = true;
     bool use_sigma_coherent = false;
     double scale_factor = 1.0;
+    bool use_tabulated_mu_sampling = false;//see ElIncXS::sampleMuMonoAtomicTabulated (cfg: elincsampler=1)
   };
 
   class ElIncScatter final : public ProcImpl::ScatterIsotropicMat {
@@ -66,6 +67,9 @@ namespace NCrystal {
     ElIncScatter( const Info&, const ElIncScatterCfg& cfg = ElIncScatterCfg() );
 
     CrossSect crossSectionIsotropic(CachePtr&, NeutronEnergy ) const final;
+    void crossSectionIsotropicMany( CachePtr&, const double* ekin,
+                                    std::size_t N, double* out_xs ) const final;
+    unsigned capabilities() const noexcept final { return CapBatchCrossSection | CapStateless; }
     ScatterOutcomeIsotropic sampleScatterIsotropic(CachePtr&, RNG&, NeutronEnergy ) const final;
 
     //Simple additive merge:
@@ -59,17 +59,34 @@ namespace NCrystal {
     ~ElIncXS();
 
     //Empty if no elements added (evaluate() will always return zero).
-    bool empty() const { return m_elm_data.empty(); }
+    bool empty() const { return m_msd.empty(); }
 
     //Evaluate the incoherent elastic cross section:
     static CrossSect evaluateMonoAtomic( NeutronEnergy, double meanSqDisp, SigmaBound bound_incoh_xs);
     CrossSect evaluate(NeutronEnergy ekin) const;
 
+    //Evaluate the cross section for N energies at once (ekin and out_xs must
+    //hold N entries). Results are identical to those of evaluate(..):
+    void evaluateMany( const double* ekin, std::size_t N, double* out_xs ) const;
+
     //Sample cosine of scatter angle:
     static CosineScatAngle sampleMuMonoAtomic( RNG&, NeutronEnergy, double meanSqDisp );
     CosineScatAngle sampleMu( RNG&, NeutronEnergy );
 
-    //Constructor merging two existing instances with associated scales:
+    //Alternative to sampleMuMonoAtomic which avoids all calls to transcendental
+    //functions, by replacing the logarithm in the inverse-CDF transformation
+    //with a table lookup. The table depends on nothing but ekin*meanSqDisp, so
+    //a single static table is shared by all elements and materials. The
+    //relative precision of the sampled 1-mu values is guaranteed to be better
+    //than 1e-7:
+    static CosineScatAngle sampleMuMonoAtomicTabulated( RNG&, NeutronEnergy, double meanSqDisp );
+
+    //Opt-in usage of sampleMuMonoAtomicTabulated in sampleMu (default false):
+    void setTabulatedMuSampling( bool b ) { m_tabulatedMu = b; }
+    bool tabulatedMuSampling() const { return m_tabulatedMu; }
+
+    //Constructor merging two existing instances with associated scales (the
+    //result uses tabulated mu sampling only if both instances do):
     ElIncXS( const ElIncXS&, double, const ElIncXS&,  double );
 
     //Number of elements:
@@ -113,7 +130,11 @@ namespace NCrystal {
     ////////////////////////////////////////////////////////////////////////////////////
 
   private:
-    SmallVector<PairDD,16> m_elm_data;//for exact eval, (msd,boundincohxs*scale)
+    //Element data, stored as separate arrays of msd and boundincohxs*scale
+    //values, so loops over elements or energies can be vectorised:
+    SmallVector<double,16> m_msd;
+    SmallVector<double,16> m_wxs;
+    bool m_tabulatedMu = false;
     static double eval_1mexpmtdivt(double t);//safe/fast eval of (1-exp(-t))/t for t>=0.0 with >10 sign. digits
 
   };
@@ -22,6 +22,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "NCrystal/NCTypes.hh"
+#include "NCrystal/internal/NCSpan.hh"
 
 //Class EqRefl provides symmetry-equivalent reflections for a given space group
 //number, by providing a list of all (h,k,l) indices symmetry-equivalent to a
@@ -74,7 +75,7 @@ namespace NCrystal {
       HKL m_data[24];
       HKL * m_end;
       friend class EqRefl;
-      void add(int, int, int);
+      void add( const HKL& );
     };
 
     EquivReflList getEquivalentReflections(int h, int k, int l) const;
@@ -88,10 +89,29 @@ namespace NCrystal {
     HKL getEquivalentReflectionsRepresentativeValue( const HKL& hkl ) const;
     HKL getEquivalentReflectionsRepresentativeValue( int h, int k, int l ) const;
 
+    //The symmetry operations behind the lists above, as integer matrices (in
+    //row-major order) acting on (h,k,l). Only half of the operations of the
+    //Laue class are included, since (h,k,l) and (-h,-k,-l) are trivially
+    //equivalent, and the first one is always the identity. Applying all of
+    //them and normalising the results gives the (unsorted) lists above,
+    //including any duplicates:
+    struct SymOp {
+      signed char m[9];
+      constexpr HKL apply( const HKL& ) const noexcept;
+    };
+    Span<const SymOp> symmetryOperations() const noexcept { return { m_ops, m_ops + m_nops }; }
+
+    //Of (h,k,l) and (-h,-k,-l), return the one which has first non-zero
+    //coordinate positive:
+    static HKL normalise( const HKL& ) noexcept;
+
   private:
     struct Helper;
     friend struct Helper;
     EquivReflList (*m_calc) (int,int,int) = nullptr;
+    HKL (*m_calcRepr) (int,int,int) = nullptr;
+    const SymOp * m_ops = nullptr;
+    std::size_t m_nops = 0;
   };
 }
 
@@ -122,13 +142,24 @@ namespace NCrystal{
     return *this;
   }
 
-  inline void EqRefl::EquivReflList::add(int h, int k, int l)
+  inline HKL EqRefl::normalise( const HKL& a ) noexcept
+  {
+    auto am = a.flipped();
+    return am < a ? am : a;
+  }
+
+  inline void EqRefl::EquivReflList::add( const HKL& a )
   {
     //Only ever consider the form of (h,k,l) and (-h,-k,-l) which has first
     //non-zero coordinate positive:
-    HKL a(h,k,l);
-    auto am = a.flipped();
-    *m_end++ =  am < a ? am : a;
+    *m_end++ = EqRefl::normalise( a );
+  }
+
+  inline constexpr HKL EqRefl::SymOp::apply( const HKL& a ) const noexcept
+  {
+    return HKL( m[0]*a.h + m[1]*a.k + m[2]*a.l,
+                m[3]*a.h + m[4]*a.k + m[5]*a.l,
+                m[6]*a.h + m[7]*a.k + m[8]*a.l );
   }
 
   inline EqRefl::EquivReflList EqRefl::getEquivalentReflections(int h, int k, int l) const
@@ -142,14 +173,7 @@ namespace NCrystal{
 
   inline HKL EqRefl::getEquivalentReflectionsRepresentativeValue( int h, int k, int l ) const
   {
-    auto raw = m_calc(h,k,l);
-    auto itLow = raw.begin();
-    auto itE = raw.end();
-    for ( auto it = std::next(itLow); it!=itE; ++it ) {
-      if ( *it < *itLow )
-        itLow = it;
-    }
-    return *itLow;
+    return m_calcRepr(h,k,l);
   }
 
   inline HKL EqRefl::getEquivalentReflectionsRepresentativeValue( const HKL& e ) const
@@ -23,7 +23,11 @@
 
 #include "NCrystal/NCDefs.hh"
 #include "NCrystal/NCSmallVector.hh"
+#include "NCrystal/internal/NCTraceZones.hh"
 #include <chrono>
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <iostream>
 #ifndef NCRYSTAL_DISABLE_THREADS
 #  include <thread>
@@ -33,6 +37,14 @@ namespace NCrystal {
 
   constexpr unsigned CachedFactory_KeepAllStrongRefs = std::numeric_limits<unsigned>::max();
 
+  struct FactoryStats {
+    std::size_t nstrongrefs = 0, nweakrefs = 0;
+    std::size_t strongRefBytes = 0;//summed memory footprint of strongly referenced objects
+    std::size_t nevictions = 0;//strong refs released due to the cache policy or memory budget
+    std::size_t nalive = 0;//cached objects still alive (whether or not strongly referenced)
+    std::size_t aliveBytes = 0;//current summed memory footprint of the alive objects
+  };
+
   template<class TKey>
   struct CFB_Unthinned_t {
     //Default key thinning strategy is to not actually do any thinning. If
@@ -72,6 +84,26 @@ namespace NCrystal {
     // global clearCaches function which will in turn call the cleanup function of
     // all factories.
     //
+    // The NStrongRefsKept parameter merely provides the default policy, which
+    // can be changed at runtime with setCachePolicy. Besides a maximal number
+    // of strong refs, the policy can impose a limit on the summed memory
+    // footprint of the objects kept alive by the strong refs (estimated via a
+    // memoryFootprint() method of the objects if present, otherwise via
+    // sizeof). Strong refs to the objects accessed longest ago are released
+    // first. Additionally, a global memory budget shared by all factories can
+    // be set with setFactoryMemoryBudget (see below).
+    //
+    // Lookups of objects already in the cache are served without taking the
+    // factory-wide mutex, from small per-thread shards of recently returned
+    // objects (threads are assigned to shards round-robin). Such fast hits do
+    // not move the object to the back of the list of strong refs, but are only
+    // used while no strong refs were released since the shard entry was made
+    // (and while the global memory budget is not exceeded). Any eviction thus
+    // sends all threads back through the locked lookup once, which restores
+    // the access order. This lets concurrent lookups (e.g. many threads
+    // creating the same scatter objects at initialisation) scale with the
+    // number of threads.
+    //
     /////////////////////////////////////////////////////////////////////////////////
 
     using key_type = TKey;
@@ -95,7 +127,31 @@ namespace NCrystal {
     //To automatically call a function whenever cleanup() is invoked:
     void registerCleanupCallback(std::function<void()>);
 
-    struct Stats { std::size_t nstrongrefs, nweakrefs; };
+    //Granular alternative to cleanup(), removing just the entries for which
+    //pred(thinned_key,obj) returns true (obj is nullptr if the object is not
+    //alive). Any strong references to their objects are released, and they
+    //will not be returned by the cache again (objects used elsewhere are of
+    //course not affected). The predicate is invoked while the factory mutex is
+    //held, so it must not use the factory. Returns the number of removed
+    //entries:
+    template<class TPred>
+    std::size_t evict( TPred pred );
+
+    //Runtime cache policy (maxStrongRefs=CachedFactory_KeepAllStrongRefs means
+    //no limit on the number of strong refs, and maxStrongRefBytes=0 means no
+    //limit on their memory footprint). Changing the policy immediately
+    //releases strong refs as needed:
+    struct CachePolicy {
+      unsigned maxStrongRefs = NStrongRefsKept;
+      std::size_t maxStrongRefBytes = 0;
+    };
+    void setCachePolicy( const CachePolicy& );
+    CachePolicy cachePolicy();
+
+    //Current statistics. Unlike strongRefBytes, which uses the footprints of
+    //the objects at the time they were created, aliveBytes is evaluated anew
+    //(some objects grow as they are used, e.g. due to lazily built tables):
+    using Stats = FactoryStats;
     Stats currentStats();
 
     //NB: This might seem sensible, but gives troubles since most
@@ -108,14 +164,39 @@ namespace NCrystal {
     struct CacheEntry {
       bool underConstruction = false;
       bool wasInvalidatedDuringConstruction = false;
+      std::size_t footprint = 0;
       WeakPtr weakPtr;
-      void clear() { underConstruction = wasInvalidatedDuringConstruction = false; weakPtr.reset(); }
+      void clear() { underConstruction = wasInvalidatedDuringConstruction = false; footprint = 0; weakPtr.reset(); }
     };
     using CacheMap = std::map<thinned_key_type,CacheEntry>;
     CacheMap m_cache;
+    std::map<unsigned,CacheMap> m_replicaCaches;//for non-zero replica domains (see CacheReplicaScope)
+    CacheMap& cacheMapForDomain( unsigned domain ) { return domain ? m_replicaCaches[domain] : m_cache; }
+    template<class TFct>
+    void forEachCacheMap( TFct fct )
+    {
+      fct( m_cache );
+      for ( auto& e : m_replicaCaches )
+        fct( e.second );
+    }
     std::mutex m_mutex;
     class StrongRefKeeper;
     StrongRefKeeper m_strongRefs;
+    struct FastPathEntry {
+      WeakPtr weakPtr;
+      std::uint64_t epoch;
+    };
+    struct FastPathShard {
+      std::mutex mtx;
+      std::map<thinned_key_type,FastPathEntry> entries;
+      char padding[64];//avoid false sharing between shards
+    };
+    static constexpr unsigned nFastPathShards = 16;
+    static constexpr std::size_t fastPathMaxEntries = 64;
+    std::array<FastPathShard,nFastPathShards> m_fastPathShards;
+    ShPtr fastPathLookup( FastPathShard&, const key_type&, Optional<thinned_key_type>& );
+    void fastPathRemember( FastPathShard&, const key_type&, Optional<thinned_key_type>&,
+                           const ShPtr&, std::uint64_t epoch );
     bool m_cleanupNeedsRegistry = true;
     SmallVector<std::function<void()>,1,SVMode::LOWFOOTPRINT> m_cleanupCallbacks;
   };
@@ -128,6 +209,92 @@ namespace NCrystal {
   void enableFactoryVerbosity( bool status = true );
   bool getFactoryVerbosity();
 
+  //Global memory budget (in bytes, 0 means unlimited) for the objects kept
+  //alive by strong refs in all CachedFactoryBase instances. Whenever the
+  //budget is exceeded, factories release their least recently accessed strong
+  //refs as they are accessed (it is thus a soft limit, and the most recently
+  //accessed object in each factory is always kept). Factories configured to
+  //keep all strong refs are exempt. The default budget can be set in
+  //megabytes through the NCRYSTAL_FACTORY_MEMORY_BUDGET_MB environment
+  //variable:
+  void setFactoryMemoryBudget( std::size_t bytes );
+  std::size_t getFactoryMemoryBudget();
+  std::size_t getFactoryStrongRefBytes();//current total over all factories
+
+  //Current statistics of all factories used so far, along with their names
+  //(ordered by first usage):
+  std::vector<std::pair<std::string,FactoryStats>> getAllFactoryStats();
+
+  //Profiling of initialisation times. When enabled (the default can be set
+  //with the NCRYSTAL_PROFILE_INIT environment variable), each top-level
+  //creation call prints a nested breakdown of the time spent in instrumented
+  //stages (TextData loading, NCMAT parsing, Info building, HKL plane
+  //calculations, scattering kernel expansion and integration, ...), along with
+  //the cache status of each factory lookup:
+  void enableInitProfiling( bool status = true );
+  bool getInitProfiling();
+
+  //Scope guard marking an instrumented stage (does nothing unless profiling is
+  //enabled, or tracing hooks are installed, cf. NCTrace.hh). The label must be
+  //a string literal, while the optional details (e.g. a cfg string) are
+  //provided by a function, which is only called if needed:
+  class InitProfileScope : private NoCopyMove {
+  public:
+    InitProfileScope( const char * label ) : InitProfileScope( label, [](){ return std::string(); } ) {}
+    template<class TDetailsFct>
+    InitProfileScope( const char * label, TDetailsFct detailsFct );
+    ~InitProfileScope()
+    {
+      if ( m_active )
+        end();
+      if ( m_traceHooks )
+        m_traceHooks->endZone( m_label, m_traceHooks->userdata );
+    }
+
+    //Attach a note (e.g. "cache miss") to the innermost active scope of the
+    //current thread. The note must be a string literal:
+    static void setNote( const char * note );
+  private:
+    bool m_active;
+    const char * m_label;
+    const Trace::detail::Hooks* m_traceHooks;
+    void begin( const char * label, std::string&& details );
+    void end();
+  };
+
+  //Objects created by any CachedFactoryBase while a CacheReplicaScope with a
+  //non-zero domain is active in the current thread are cached separately per
+  //domain, so the same keys result in independent copies of the objects (and
+  //of everything they are built from), one per domain. Scopes can be nested,
+  //the innermost one applies:
+  class CacheReplicaScope : private NoCopyMove {
+  public:
+    CacheReplicaScope( unsigned domain );
+    ~CacheReplicaScope();
+  private:
+    unsigned m_prev;
+  };
+
+  namespace detail {
+    unsigned currentCacheReplicaDomain();//0 unless in a CacheReplicaScope
+    void registerFactoryStrongRefBytes( std::size_t added, std::size_t removed );
+    bool factoryMemoryBudgetExceeded();
+    void registerFactoryStatsFunction( std::function<std::pair<std::string,FactoryStats>()> );
+    unsigned currentThreadFactoryShard();//small per-thread index (assigned round-robin)
+
+    //Memory footprint of cached objects, using a memoryFootprint() method if available:
+    template<class T>
+    inline auto cachedObjectFootprint( const T& t, int ) -> decltype( std::size_t( t.memoryFootprint() ) )
+    {
+      return t.memoryFootprint();
+    }
+    template<class T>
+    inline std::size_t cachedObjectFootprint( const T&, long )
+    {
+      return sizeof(T);
+    }
+  }
+
 }
 
 
@@ -155,70 +322,127 @@ namespace NCrystal {
 
   template<class TKey, class TValue, unsigned NStrongRefsKept,class TKT>
   class CachedFactoryBase<TKey,TValue,NStrongRefsKept,TKT>::StrongRefKeeper {
-    std::vector<ShPtr> m_v;
-    void reserveCapacity( std::vector<ShPtr>& v )
+    //Strong refs in order of access (most recent last), with the memory
+    //footprint of each object:
+    struct Entry {
+      ShPtr sp;
+      std::size_t footprint;
+    };
+    std::vector<Entry> m_v;
+    std::size_t m_bytes = 0;
+    std::size_t m_nevictions = 0;
+    CachePolicy m_policy;
+    std::atomic<std::uint64_t> m_epoch{0};//incremented whenever strong refs are released
+    void bumpEpoch() { m_epoch.fetch_add( 1, std::memory_order_release ); }
+    void reserveCapacity( std::vector<Entry>& v )
     {
-      if (NStrongRefsKept>0)
-        v.reserve(NStrongRefsKept > 512 ? 512 : NStrongRefsKept);
+      if ( m_policy.maxStrongRefs > 0 )
+        v.reserve( m_policy.maxStrongRefs > 512 ? 512 : m_policy.maxStrongRefs );
+    }
+    bool keepsAll() const { return m_policy.maxStrongRefs == CachedFactory_KeepAllStrongRefs; }
+    bool overLimitsAfterRemoving( std::size_t nremoved ) const
+    {
+      if ( !keepsAll() && m_v.size() - nremoved > m_policy.maxStrongRefs )
+        return true;
+      if ( m_policy.maxStrongRefBytes > 0 && m_bytes > m_policy.maxStrongRefBytes )
+        return true;
+      return !keepsAll() && detail::factoryMemoryBudgetExceeded();
+    }
+    void enforceLimits()
+    {
+      //Release strong refs accessed longest ago, but always keep the most
+      //recent one (unless policy says to keep none):
+      if ( m_policy.maxStrongRefs == 0 ) {
+        m_nevictions += m_v.size();
+        clear();
+        return;
+      }
+      std::size_t nremove = 0;
+      while ( nremove + 1 < m_v.size() ) {
+        if ( !overLimitsAfterRemoving( nremove ) )
+          break;
+        //Account for each removal immediately, since the global budget is
+        //checked in the next iteration:
+        m_bytes -= m_v[nremove].footprint;
+        detail::registerFactoryStrongRefBytes( 0, m_v[nremove].footprint );
+        ++nremove;
+      }
+      if ( !nremove )
+        return;
+      bumpEpoch();
+      m_nevictions += nremove;
+      m_v.erase( m_v.begin(), std::next( m_v.begin(), nremove ) );
+    }
+    void add( const ShPtr& sp, std::size_t footprint )
+    {
+      m_v.push_back( Entry{ sp, footprint } );
+      m_bytes += footprint;
+      detail::registerFactoryStrongRefBytes( footprint, 0 );
+    }
+    void removeAt( typename std::vector<Entry>::iterator it )
+    {
+      m_bytes -= it->footprint;
+      detail::registerFactoryStrongRefBytes( 0, it->footprint );
+      m_v.erase( it );
+      bumpEpoch();
     }
   public:
     StrongRefKeeper()  { reserveCapacity(m_v); }
-    void clear() { m_v.clear(); }
+    void clear()
+    {
+      detail::registerFactoryStrongRefBytes( 0, m_bytes );
+      m_bytes = 0;
+      m_v.clear();
+      bumpEpoch();
+    }
     bool empty() const { return m_v.empty(); }
     std::size_t size() const { return static_cast<std::size_t>(m_v.size()); }
-    void wasAccessedAndIsNotInList( const ShPtr& sp ) {
+    std::size_t bytes() const { return m_bytes; }
+    std::size_t nevictions() const { return m_nevictions; }
+    const CachePolicy& policy() const { return m_policy; }
+    //Objects which were accessed are kept in the list until the epoch changes
+    //(unless policy says to keep none). The epoch can be read without locking:
+    bool keepsAccessed() const { return m_policy.maxStrongRefs > 0; }
+    std::uint64_t epoch() const { return m_epoch.load( std::memory_order_acquire ); }
+    void setPolicy( const CachePolicy& p )
+    {
+      m_policy = p;
+      enforceLimits();
+    }
+
+    void wasAccessedAndIsNotInList( const ShPtr& sp, std::size_t footprint ) {
       //was just created, so we know it is not already in the list.
-      if (NStrongRefsKept==0)
-        return;
-      if (NStrongRefsKept==CachedFactory_KeepAllStrongRefs) {
-        m_v.push_back( sp );
+      if ( m_policy.maxStrongRefs == 0 )
         return;
-      }
-      if ( m_v.size()==NStrongRefsKept ) {
-        //make room, discard first entry (was accessed longest ago).
-        for ( auto i : ncrange(typename decltype(m_v)::size_type(1),m_v.size() ) )
-          m_v[i-1] = std::move(m_v[i]);
-        m_v.pop_back();
-      }
-      m_v.push_back( sp );
+      add( sp, footprint );
+      enforceLimits();
     }
 
-    void wasAccessed( const ShPtr& sp ) {
+    void wasAccessed( const ShPtr& sp, std::size_t footprint ) {
       //was accessed, might (or might not) already be in the list.
-      //NStrongRefsKept==CachedFactory_KeepAllStrongRefs
-      if (NStrongRefsKept==0)
+      if ( m_policy.maxStrongRefs == 0 )
         return;
       //Check if we already have it:
-      auto it = m_v.begin();
       auto itE = m_v.end();
-      for (;it!=itE;++it) {
-        if ( *it == sp ) {
-          //Already there! Shuffle it to the end:
-          if ( std::next(it) == itE )
-            return;//already at end
-          auto itLast = std::prev(itE);
-          for ( ;it!=itLast; ++it)
-            *it = std::move(*std::next(it));
-          *itLast = sp;
-          return;
-        }
+      auto it = std::find_if( m_v.begin(), itE, [&sp]( const Entry& e ) { return e.sp == sp; } );
+      if ( it != itE ) {
+        //Already there! Rotate it to the end:
+        std::rotate( it, std::next(it), itE );
+        if ( detail::factoryMemoryBudgetExceeded() )
+          enforceLimits();
+        return;
       }
       //was not already in the list:
-      wasAccessedAndIsNotInList(sp);
+      wasAccessedAndIsNotInList( sp, footprint );
     }
 
     void releaseOne( const ShPtr& sp ) {
       if ( !sp || empty() )
         return;
       auto itE = m_v.end();
-      auto it = std::find( m_v.begin(), itE, sp );
-      if ( it == itE )
-        return;//not there
-      //Move it to the end and pop_back:
-      auto itLast = std::prev(itE);
-      for ( ;it!=itLast; ++it)
-        *it = std::move(*std::next(it));
-      m_v.pop_back();
+      auto it = std::find_if( m_v.begin(), itE, [&sp]( const Entry& e ) { return e.sp == sp; } );
+      if ( it != itE )
+        removeAt( it );
     }
 
     void releaseMany( const std::set<ShPtr>& to_remove )
@@ -229,14 +453,36 @@ namespace NCrystal {
       }
       decltype(m_v) new_v;
       reserveCapacity(new_v);
-      for ( auto& sp : m_v ) {
-        if ( !to_remove.count(sp) )
-          new_v.push_back( std::move(sp) );
+      std::size_t bytes_removed = 0;
+      for ( auto& e : m_v ) {
+        if ( !to_remove.count(e.sp) )
+          new_v.push_back( std::move(e) );
+        else
+          bytes_removed += e.footprint;
       }
       std::swap(new_v,m_v);
+      bumpEpoch();
+      m_bytes -= bytes_removed;
+      detail::registerFactoryStrongRefBytes( 0, bytes_removed );
     }
   };
 
+  template<class TDetailsFct>
+  inline InitProfileScope::InitProfileScope( const char * label, TDetailsFct detailsFct )
+    : m_active( getInitProfiling() ),
+      m_label( label ),
+      m_traceHooks( Trace::detail::activeHooks() )
+  {
+    if ( m_traceHooks ) {
+      std::string details = detailsFct();
+      m_traceHooks->beginZone( label, details.c_str(), m_traceHooks->userdata );
+      if ( m_active )
+        begin( label, std::move(details) );
+    } else if ( m_active ) {
+      begin( label, detailsFct() );
+    }
+  }
+
   template<class TKey,class TValue,unsigned N,class TKT>
   inline void CachedFactoryBase<TKey,TValue,N,TKT>::registerCleanupCallback(std::function<void()> fn)
   {
@@ -248,31 +494,147 @@ namespace NCrystal {
   {
     NCRYSTAL_LOCK_GUARD(m_mutex);
     m_strongRefs.clear();
-    auto it = m_cache.begin();
-    auto itE = m_cache.end();
-    while (it!=itE) {
-      auto itNext = std::next(it);
-      if ( it->second.underConstruction ) {
-        it->second.wasInvalidatedDuringConstruction = true;
-      } else {
-        m_cache.erase(it);
+    forEachCacheMap( []( CacheMap& cache )
+    {
+      auto it = cache.begin();
+      auto itE = cache.end();
+      while (it!=itE) {
+        auto itNext = std::next(it);
+        if ( it->second.underConstruction ) {
+          it->second.wasInvalidatedDuringConstruction = true;
+        } else {
+          cache.erase(it);
+        }
+        it = itNext;
       }
-      it = itNext;
+    } );
+    for ( auto& shard : m_fastPathShards ) {
+      NCRYSTAL_LOCK_GUARD(shard.mtx);
+      shard.entries.clear();
     }
     for ( const auto& fn : m_cleanupCallbacks )
       fn();
   }
 
   template<class TKey,class TValue,unsigned N,class TKT>
-  inline typename CachedFactoryBase<TKey,TValue,N,TKT>::Stats CachedFactoryBase<TKey,TValue,N,TKT>::currentStats()
+  template<class TPred>
+  inline std::size_t CachedFactoryBase<TKey,TValue,N,TKT>::evict( TPred pred )
   {
+    //Objects are only released after unlocking, since their destructors might
+    //use the factory:
+    std::set<ShPtr> evicted;
+    std::vector<ShPtr> otherRefs;
+    std::size_t nremoved = 0;
     NCRYSTAL_LOCK_GUARD(m_mutex);
+    forEachCacheMap( [&pred,&evicted,&otherRefs,&nremoved]( CacheMap& cache )
+    {
+      for ( auto it = cache.begin(); it != cache.end(); ) {
+        ShPtr sp = it->second.weakPtr.lock();
+        if ( !pred( it->first, static_cast<const TValue*>( sp.get() ) ) ) {
+          if ( sp != nullptr )
+            otherRefs.push_back( std::move(sp) );
+          ++it;
+          continue;
+        }
+        ++nremoved;
+        if ( sp != nullptr )
+          evicted.insert( std::move(sp) );
+        if ( it->second.underConstruction ) {
+          it->second.wasInvalidatedDuringConstruction = true;
+          ++it;
+        } else {
+          it = cache.erase(it);
+        }
+      }
+    } );
+    if ( !evicted.empty() )
+      m_strongRefs.releaseMany( evicted );
+    for ( auto& shard : m_fastPathShards ) {
+      NCRYSTAL_LOCK_GUARD(shard.mtx);
+      for ( auto it = shard.entries.begin(); it != shard.entries.end(); ) {
+        ShPtr sp = it->second.weakPtr.lock();
+        const bool remove = pred( it->first, static_cast<const TValue*>( sp.get() ) );
+        if ( sp != nullptr )
+          otherRefs.push_back( std::move(sp) );
+        if ( remove )
+          it = shard.entries.erase(it);
+        else
+          ++it;
+      }
+    }
+    return nremoved;
+  }
+
+  template<class TKey,class TValue,unsigned N,class TKT>
+  inline std::shared_ptr<const TValue> CachedFactoryBase<TKey,TValue,N,TKT>::fastPathLookup( FastPathShard& shard,
+                                                                                              const key_type& key,
+                                                                                              Optional<thinned_key_type>& thinned_key )
+  {
+    NCRYSTAL_LOCK_GUARD(shard.mtx);
+    if ( shard.entries.empty() )
+      return nullptr;
+    auto it = TKT::cacheMapFind( shard.entries, key, thinned_key );
+    if ( it == shard.entries.end() || it->second.epoch != m_strongRefs.epoch() || detail::factoryMemoryBudgetExceeded() )
+      return nullptr;
+    return it->second.weakPtr.lock();
+  }
+
+  template<class TKey,class TValue,unsigned N,class TKT>
+  inline void CachedFactoryBase<TKey,TValue,N,TKT>::fastPathRemember( FastPathShard& shard,
+                                                                      const key_type& key,
+                                                                      Optional<thinned_key_type>& thinned_key,
+                                                                      const ShPtr& sp,
+                                                                      std::uint64_t epoch )
+  {
+    NCRYSTAL_LOCK_GUARD(shard.mtx);
+    if ( shard.entries.size() >= fastPathMaxEntries )
+      shard.entries.clear();
+    auto& e = TKT::cacheMapLookup( shard.entries, key, thinned_key );
+    e.weakPtr = sp;
+    e.epoch = epoch;
+  }
+
+  template<class TKey,class TValue,unsigned N,class TKT>
+  inline typename CachedFactoryBase<TKey,TValue,N,TKT>::Stats CachedFactoryBase<TKey,TValue,N,TKT>::currentStats()
+  {
     Stats s;
-    s.nstrongrefs = m_strongRefs.size();
-    s.nweakrefs = static_cast<std::size_t>(m_cache.size());
+    std::vector<ShPtr> alive;
+    {
+      NCRYSTAL_LOCK_GUARD(m_mutex);
+      s.nstrongrefs = m_strongRefs.size();
+      s.strongRefBytes = m_strongRefs.bytes();
+      s.nevictions = m_strongRefs.nevictions();
+      forEachCacheMap( [&s,&alive]( CacheMap& cache )
+      {
+        s.nweakrefs += static_cast<std::size_t>(cache.size());
+        for ( auto& e : cache ) {
+          auto sp = e.second.weakPtr.lock();
+          if ( sp )
+            alive.push_back( std::move(sp) );
+        }
+      } );
+    }
+    //Evaluate footprints (and release our refs) without holding the lock:
+    s.nalive = alive.size();
+    for ( auto& sp : alive )
+      s.aliveBytes += detail::cachedObjectFootprint( *sp, 0 );
     return s;
   }
 
+  template<class TKey,class TValue,unsigned N,class TKT>
+  inline void CachedFactoryBase<TKey,TValue,N,TKT>::setCachePolicy( const CachePolicy& p )
+  {
+    NCRYSTAL_LOCK_GUARD(m_mutex);
+    m_strongRefs.setPolicy( p );
+  }
+
+  template<class TKey,class TValue,unsigned N,class TKT>
+  inline typename CachedFactoryBase<TKey,TValue,N,TKT>::CachePolicy CachedFactoryBase<TKey,TValue,N,TKT>::cachePolicy()
+  {
+    NCRYSTAL_LOCK_GUARD(m_mutex);
+    return m_strongRefs.policy();
+  }
+
   template<class TKey,class TValue,unsigned N,class TKT>
   inline std::shared_ptr<const TValue> CachedFactoryBase<TKey,TValue,N,TKT>::createWithoutCache( const TKey& key ) const
   {
@@ -355,6 +717,19 @@ namespace NCrystal {
 
     //////////////////////////////////////////////////////////////////////////////////////
     const bool verbose = getFactoryVerbosity();
+    Optional<thinned_key_type> thinned_key;
+    const unsigned domain = detail::currentCacheReplicaDomain();
+
+    //Fast path for objects recently returned to this thread (skipped in
+    //verbose mode, to get the usual printouts, and for replica domains, which
+    //are only used during initialisation):
+    FastPathShard& fastPathShard = m_fastPathShards[ detail::currentThreadFactoryShard() % nFastPathShards ];
+    if ( !verbose && !domain ) {
+      ShPtr res = fastPathLookup( fastPathShard, key, thinned_key );
+      if ( res )
+        return res;
+    }
+
     const std::string keystr = ( verbose ? keyToString(key) : std::string() );
 
     Guard guard(m_mutex);
@@ -363,6 +738,10 @@ namespace NCrystal {
       m_cleanupNeedsRegistry = false;
       std::function<void()> fct_cleanup = [this](){ this->cleanup(); };
       registerCacheCleanupFunction(fct_cleanup);
+      detail::registerFactoryStatsFunction( [this]()
+      {
+        return std::make_pair( std::string( this->factoryName() ), this->currentStats() );
+      } );
     }
 
     if ( verbose )
@@ -370,10 +749,7 @@ namespace NCrystal {
                <<" (thread_"<<thread_details::currentThreadIDForPrint()<<")"
                <<" : Request to provide object for key "<<keystr<<std::endl;
 
-
-    Optional<thinned_key_type> thinned_key;
-
-    auto& cache_entry = TKT::cacheMapLookup( m_cache, key, thinned_key );
+    auto& cache_entry = TKT::cacheMapLookup( cacheMapForDomain( domain ), key, thinned_key );
     ShPtr res = cache_entry.weakPtr.lock();
     if (!!res) {
       if ( verbose )
@@ -384,7 +760,12 @@ namespace NCrystal {
 
       //Record access:
       nc_assert(guard.isLocked());
-      m_strongRefs.wasAccessed( res );
+      m_strongRefs.wasAccessed( res, cache_entry.footprint );
+      const bool fastPathOK = ( !domain && m_strongRefs.keepsAccessed() );
+      const std::uint64_t epoch = m_strongRefs.epoch();
+      guard.ensureUnlock(NCRYSTAL_DEBUG_LOCKS_ARGS);
+      if ( fastPathOK )
+        fastPathRemember( fastPathShard, key, thinned_key, res, epoch );
       return res;//easy: already there
     }
     //Not there: check if already under construction or if we should construct:
@@ -415,9 +796,10 @@ namespace NCrystal {
 #endif
         res = actualCreate(key);
       }
+      const std::size_t footprint = ( res ? detail::cachedObjectFootprint( *res, 0 ) : 0 );
       //Populate result while holding mutex lock:
       guard.ensureLock(NCRYSTAL_DEBUG_LOCKS_ARGS);
-      cache_entry = TKT::cacheMapLookup( m_cache, key, thinned_key );//reacquire after getting lock back
+      cache_entry = TKT::cacheMapLookup( cacheMapForDomain( domain ), key, thinned_key );//reacquire after getting lock back
       //no one else should have tried to create this:
       nc_assert_always(cache_entry.underConstruction);
       nc_assert_always(!cache_entry.weakPtr.lock());
@@ -439,9 +821,14 @@ namespace NCrystal {
                    <<" (thread_"<<thread_details::currentThreadIDForPrint()<<")"
                    <<" : Finished construction"<<std::endl;
         cache_entry.weakPtr = res;
-        m_strongRefs.wasAccessedAndIsNotInList( res );
+        cache_entry.footprint = footprint;
+        m_strongRefs.wasAccessedAndIsNotInList( res, footprint );
+        const bool fastPathOK = ( res && !domain && m_strongRefs.keepsAccessed() );
+        const std::uint64_t epoch = m_strongRefs.epoch();
         guard.setConstructFlagFalseAndRelease();
         guard.ensureUnlock(NCRYSTAL_DEBUG_LOCKS_ARGS);
+        if ( fastPathOK )
+          fastPathRemember( fastPathShard, key, thinned_key, res, epoch );
         return res;
       }
     } else {
@@ -463,7 +850,7 @@ namespace NCrystal {
                        "NCRYSTAL_DISABLE_THREADS and can not support this.");
 #endif
         guard.ensureLock(NCRYSTAL_DEBUG_LOCKS_ARGS);
-        cache_entry = TKT::cacheMapLookup( m_cache, key, thinned_key );//reacquire after getting lock back
+        cache_entry = TKT::cacheMapLookup( cacheMapForDomain( domain ), key, thinned_key );//reacquire after getting lock back
         if ( verbose )
           std::cout<< this->factoryName()
                    <<" (thread_"<<thread_details::currentThreadIDForPrint()<<")"
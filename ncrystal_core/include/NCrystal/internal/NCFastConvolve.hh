@@ -22,7 +22,6 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "NCrystal/internal/NCMath.hh"
-#include <complex>
 
 namespace NCrystal {
 
@@ -37,6 +36,12 @@ namespace NCrystal {
     // And places |b| * constant in the output vector y (of length
     // a1.size()+a2.size()-1) where the constant is given by dt/N where N is
     // y.size() rounded up to the next power of 2.
+    //
+    // Since the inputs are real, the transforms are carried out as
+    // real-to-complex (and complex-to-real) FFTs, each implemented with a
+    // complex FFT of half the length. Tables of twiddle factors are cached
+    // per transform size and shared between all FastConvolve instances (and
+    // threads), so the objects themselves carry no state.
 
   public:
     FastConvolve();
@@ -48,16 +53,6 @@ namespace NCrystal {
 
     //Internal function for calculating exp(i*2pi*k/2^n), exposed for unit testing:
     static PairDD calcPhase(unsigned k, unsigned n);
-
-  private:
-
-    enum caltype {FT_forward,FT_inverse};
-    std::vector< std::complex<double> > m_w;
-
-    //The actual fast-fourier transform algorithm:
-    void fftd( std::vector<std::complex<double> > &inout, caltype ct,
-               unsigned minimum_output_size );
-    void initWTable( unsigned );
   };
 }
 
@@ -26,6 +26,7 @@
 // ubiquitous, but until then...
 
 #include "NCrystal/NCDefs.hh"
+#include "NCrystal/NCTextData.hh"
 
 namespace NCrystal {
 
@@ -35,6 +36,14 @@ namespace NCrystal {
   //Simple file globbing (sorts results before returning!):
   VectS ncglob( const std::string&);
 
+  //Names of all entries in a directory (including hidden ones, but excluding
+  //"." and ".."), or NullOpt if the directory can not be read:
+  Optional<VectS> listDirectory( const std::string& dirname );
+
+  //Modification time of file or directory (in nanoseconds, but the actual
+  //resolution depends on the platform), or NullOpt if not available:
+  Optional<int64_t> fileModificationTime( const std::string& path );
+
   //Current working directory:
   std::string ncgetcwd();
 
@@ -61,6 +70,38 @@ namespace NCrystal {
   //DataLoadError.
   Optional<std::string> readEntireFileToString( const std::string& path );
 
+  //Alternatively, try to memory-map the file content (read-only) into a
+  //RawStrData object, avoiding any copies and the size limit of
+  //readEntireFileToString. Returns NullOpt when this is not possible (non-posix
+  //platforms, missing or unreadable files, files smaller than minsize, or files
+  //whose size is a multiple of the page size, as the data would then not be
+  //null-terminated). Can be disabled by setting NCRYSTAL_DISABLE_MMAP=1. Note
+  //that the files should not be modified while in use, since the mapped
+  //content would then change as well (and reading it crashes the process with
+  //SIGBUS if the file was truncated):
+  Optional<RawStrData> tryMapFileToRawStrData( const std::string& path, std::size_t minsize = 0 );
+
+  //The mappings pin the identity, size and modification time of the file at
+  //the time it was mapped. This function checks that the file on disk still
+  //matches, so it is safe to keep (re)using the data. Always returns true for
+  //data not created by tryMapFileToRawStrData:
+  bool mappedFileIsUnchanged( const RawStrData& );
+
+  //Private directory of the current user in node-local shared memory
+  //(/dev/shm/ncrystal_cache_<uid>), created on first use. Files created
+  //there live in RAM, and memory-mapping them from several processes gives
+  //a single physical copy per node. Returns an empty string if this is not
+  //supported on the platform, or if the directory can not be created or is
+  //not a directory owned by the current user:
+  std::string nodeSharedCacheDir();
+
+  //Initial value of the directory of an on-disk cache (like the HKL and
+  //scattering kernel caches), taken from the NCRYSTAL_<envname> environment
+  //variable. If that is unset and NCRYSTAL_NODE_SHARED_CACHE=1, the
+  //nodeSharedCacheDir() is used instead, so the first process on a node
+  //computes and stores the entries, and later processes simply map them:
+  std::string initialCacheDirSetting( const std::string& envname );
+
 }
 
 #endif
@@ -37,6 +37,17 @@ namespace NCrystal {
   // unit cell is required to contain mean-squared-displacement information so
   // Debye-Waller factors can be calculated internally.
   //
+  // Structure factors are evaluated concurrently using up to
+  // getNumberOfThreads() threads (cf. NCFact.hh), with results independent of
+  // the number of threads. Results can be cached persistently on disk by
+  // setting the NCRYSTAL_HKL_CACHEDIR environment variable to the path of an
+  // existing writable directory (or by calling setHKLDiskCacheDir below).
+  // Additionally, the enumerated planes and their temperature independent
+  // phase sums are kept in memory for a few recently used materials, so
+  // subsequent calls differing only in the mean-squared-displacements (e.g. in
+  // temperature scans) merely reevaluate the Debye-Waller factors (unless the
+  // NCRYSTAL_FILLHKL_NOPLANECACHE environment variable is set).
+  //
   // The parameters which can be used to tune the behaviour are:
 
   struct FillHKLCfg {
@@ -70,6 +81,12 @@ namespace NCrystal {
                               const AtomInfoList&,
                               FillHKLCfg = {} );
 
+  //Runtime override of the on-disk cache directory, initially taken from the
+  //NCRYSTAL_HKL_CACHEDIR environment variable (an empty string disables the
+  //cache):
+  void setHKLDiskCacheDir( std::string );
+  std::string getHKLDiskCacheDir();
+
 }
 
 #endif
@@ -0,0 +1,238 @@
+#ifndef NCrystal_FlatEval_hh
+#define NCrystal_FlatEval_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+
+//Evaluation of the flat tables produced by exportFlatIsotropic (see
+//NCFlatExport.hh for the layout and the approximations involved). This header
+//has no dependencies on the rest of NCrystal and uses no standard library
+//containers, so it can be compiled unchanged as device code for GPU backends
+//by defining NCRYSTAL_FLATEVAL_FCT before including it (e.g. as
+//"__host__ __device__ inline" for CUDA and HIP). Random numbers are provided by
+//a callable returning values uniformly in (0,1].
+
+#include <cmath>
+
+#ifndef NCRYSTAL_FLATEVAL_FCT
+#  define NCRYSTAL_FLATEVAL_FCT inline
+#endif
+
+namespace NCrystal {
+  namespace FlatEval {
+
+    //Decoded view of the array (no data is copied):
+    struct Tables {
+      unsigned long ncomp = 0;
+      unsigned long negrid = 0;
+      const double * egrid = nullptr;
+      const double * xs = nullptr;//xs[icomp*negrid+i]
+      const double * blocks = nullptr;//sampling data of the first component
+    };
+
+    //Returns false if the version of the array is not supported:
+    NCRYSTAL_FLATEVAL_FCT bool decode( const double * data, Tables& t )
+    {
+      if ( data[0] != 1.0 )
+        return false;
+      t.ncomp = static_cast<unsigned long>( data[1] );
+      t.negrid = static_cast<unsigned long>( data[2] );
+      t.egrid = data + 3;
+      t.xs = t.egrid + t.negrid;
+      t.blocks = t.xs + t.ncomp * t.negrid;
+      return true;
+    }
+
+    //Number of entries in the sorted v[0..n-1] which are not above x (i.e. the
+    //upper_bound index), and index of the first entry not below x (the
+    //lower_bound index):
+    NCRYSTAL_FLATEVAL_FCT unsigned long upperBound( const double * v, unsigned long n, double x )
+    {
+      unsigned long lo = 0;
+      while ( n > 0 ) {
+        const unsigned long half = n / 2;
+        if ( !( x < v[lo+half] ) ) {
+          lo += half + 1;
+          n -= half + 1;
+        } else {
+          n = half;
+        }
+      }
+      return lo;
+    }
+
+    NCRYSTAL_FLATEVAL_FCT unsigned long lowerBound( const double * v, unsigned long n, double x )
+    {
+      unsigned long lo = 0;
+      while ( n > 0 ) {
+        const unsigned long half = n / 2;
+        if ( v[lo+half] < x ) {
+          lo += half + 1;
+          n -= half + 1;
+        } else {
+          n = half;
+        }
+      }
+      return lo;
+    }
+
+    //Neutrons outside the energy grid can not be handled with the tables (a
+    //material without components has a vanishing cross section everywhere):
+    NCRYSTAL_FLATEVAL_FCT bool inRange( const Tables& t, double ekin )
+    {
+      if ( t.ncomp == 0 )
+        return true;
+      return t.negrid >= 2 && ekin >= t.egrid[0] && ekin <= t.egrid[t.negrid-1];
+    }
+
+    //Interpolation bin and fraction for ekin (which must be in range):
+    NCRYSTAL_FLATEVAL_FCT unsigned long findBin( const Tables& t, double ekin, double& frac )
+    {
+      unsigned long i = upperBound( t.egrid, t.negrid, ekin );
+      i = ( i > 0 ? i - 1 : 0 );
+      if ( i > t.negrid - 2 )
+        i = t.negrid - 2;
+      const double e0 = t.egrid[i];
+      const double e1 = t.egrid[i+1];
+      frac = ( e1 > e0 ? ( ekin - e0 ) / ( e1 - e0 ) : 0.0 );
+      return i;
+    }
+
+    NCRYSTAL_FLATEVAL_FCT double componentXS( const Tables& t, unsigned long icomp,
+                                              unsigned long ibin, double frac )
+    {
+      const double * xs = t.xs + icomp * t.negrid + ibin;
+      return xs[0] + frac * ( xs[1] - xs[0] );
+    }
+
+    //Total cross section in barn, or -1.0 if ekin is out of range:
+    NCRYSTAL_FLATEVAL_FCT double crossSection( const Tables& t, double ekin )
+    {
+      if ( !inRange( t, ekin ) )
+        return -1.0;
+      if ( t.ncomp == 0 )
+        return 0.0;
+      double frac;
+      const unsigned long ibin = findBin( t, ekin, frac );
+      double sum = 0.0;
+      for ( unsigned long ic = 0; ic < t.ncomp; ++ic )
+        sum += componentXS( t, ic, ibin, frac );
+      return sum;
+    }
+
+    //Number of values in a component block, or 0 for unknown types:
+    NCRYSTAL_FLATEVAL_FCT unsigned long blockSize( const double * block )
+    {
+      if ( block[0] == 1.0 )
+        return 2 + 2 * static_cast<unsigned long>( block[1] );
+      if ( block[0] == 2.0 ) {
+        const unsigned long nbank = static_cast<unsigned long>( block[1] );
+        const unsigned long nsamples = static_cast<unsigned long>( block[2] );
+        return 3 + nbank + 2 * nbank * nsamples;
+      }
+      return 0;
+    }
+
+    //Sample a scattering, returning false if ekin is out of range (or the
+    //tables are invalid). Neutrons which do not scatter (e.g. below all Bragg
+    //thresholds) are returned unchanged with mu=1:
+    template<class TRand>
+    NCRYSTAL_FLATEVAL_FCT bool sampleScatter( const Tables& t, double ekin, TRand& rand,
+                                              double& ekin_final, double& mu )
+    {
+      ekin_final = ekin;
+      mu = 1.0;
+      if ( !inRange( t, ekin ) )
+        return false;
+      if ( t.ncomp == 0 )
+        return true;
+
+      //Select component:
+      double frac;
+      const unsigned long ibin = findBin( t, ekin, frac );
+      double sum = 0.0;
+      for ( unsigned long ic = 0; ic < t.ncomp; ++ic )
+        sum += componentXS( t, ic, ibin, frac );
+      if ( !( sum > 0.0 ) )
+        return true;
+      const double target = rand() * sum;
+      unsigned long icomp = t.ncomp - 1;
+      double cumul = 0.0;
+      for ( unsigned long ic = 0; ic + 1 < t.ncomp; ++ic ) {
+        cumul += componentXS( t, ic, ibin, frac );
+        if ( target <= cumul ) {
+          icomp = ic;
+          break;
+        }
+      }
+      const double * block = t.blocks;
+      for ( unsigned long ic = 0; ic < icomp; ++ic ) {
+        const unsigned long bs = blockSize( block );
+        if ( !bs )
+          return false;
+        block += bs;
+      }
+
+      if ( block[0] == 1.0 ) {
+        //Powder Bragg diffraction, select plane among those below ekin:
+        const unsigned long nplanes = static_cast<unsigned long>( block[1] );
+        const double * v2dE = block + 2;
+        const double * fdm_commul = v2dE + nplanes;
+        const unsigned long n = upperBound( v2dE, nplanes, ekin );
+        if ( n == 0 )
+          return true;
+        unsigned long i = lowerBound( fdm_commul, n, rand() * fdm_commul[n-1] );
+        if ( i > n - 1 )
+          i = n - 1;
+        mu = 1.0 - 2.0 * v2dE[i] / ekin;
+        return true;
+      }
+
+      if ( block[0] == 2.0 ) {
+        //Generic, select bank point and stored outcome:
+        const unsigned long nbank = static_cast<unsigned long>( block[1] );
+        const unsigned long nsamples = static_cast<unsigned long>( block[2] );
+        const double * bankegrid = block + 3;
+        const double * outcomes = bankegrid + nbank;
+        unsigned long ib = upperBound( bankegrid, nbank, ekin );
+        ib = ( ib > 0 ? ib - 1 : 0 );
+        if ( ib > nbank - 2 )
+          ib = nbank - 2;
+        double f = std::log( ekin / bankegrid[ib] ) / std::log( bankegrid[ib+1] / bankegrid[ib] );
+        f = ( f < 0.0 ? 0.0 : ( f > 1.0 ? 1.0 : f ) );
+        if ( rand() <= f )
+          ++ib;
+        unsigned long is = static_cast<unsigned long>( rand() * nsamples );
+        if ( is > nsamples - 1 )
+          is = nsamples - 1;
+        const double * o = outcomes + 2 * ( ib * nsamples + is );
+        ekin_final = ekin * o[0];
+        mu = o[1];
+        return true;
+      }
+
+      return false;
+    }
+
+  }
+}
+
+#endif
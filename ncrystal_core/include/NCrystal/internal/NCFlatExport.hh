@@ -0,0 +1,128 @@
+#ifndef NCrystal_FlatExport_hh
+#define NCrystal_FlatExport_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCProcImpl.hh"
+
+namespace NCrystal {
+
+  //Export of isotropic scattering processes to a single flat array of doubles,
+  //for evaluation by code which can not use the C++ objects directly (for
+  //instance GPU kernels, to which the array can simply be copied). The host
+  //library remains the reference, and the exported tables are approximations
+  //of it at the level described below.
+  //
+  //The processes are split into their (scaled) components, with nested
+  //ProcComposition objects flattened and null processes dropped. The layout of
+  //the array is (counts are stored as doubles):
+  //
+  //  [ version(=1), ncomp, negrid ]
+  //  egrid[negrid]                       : energy grid [eV]
+  //  xs[ncomp][negrid]                   : component cross sections [barn]
+  //  followed by one block per component, starting with a type value:
+  //    type=1 (powder Bragg diffraction, elastic):
+  //      [ nplanes ], v2dE[nplanes], fdm_commul[nplanes]
+  //      (see PCBragg::get2dE/getFDMCommul, the scale factor is included in
+  //      fdm_commul, and sampling a plane i by fdm_commul gives
+  //      mu = 1 - 2*v2dE[i]/ekin)
+  //    type=2 (generic):
+  //      [ nbank, nsamples ], bankegrid[nbank],
+  //      outcomes[nbank][nsamples][2] with (ekin_final/ekin, mu) values.
+  //
+  //Cross sections are linearly interpolated in the egrid, which is the
+  //adaptive grid of ProcComposition::createTabulated (thus resolving Bragg
+  //edges). Generic components are sampled by picking one of the stored
+  //outcomes at a neighbouring point of the bank grid (log-spaced), selected
+  //randomly with a probability depending linearly on log(ekin), and applying
+  //the sampled energy ratio to ekin. The bank outcomes are sampled with the
+  //builtin RNG and a fixed seed, so exports are reproducible.
+
+  struct NCRYSTAL_API FlatExportCfg {
+    ProcImpl::ProcCompTabulationCfg tabulation;
+    unsigned bank_ndecade = 10;
+    unsigned bank_nsamples = 256;
+  };
+
+  constexpr unsigned flatExportVersion = 1;
+
+  NCRYSTAL_API VectD exportFlatIsotropic( ProcImpl::ProcPtr, const FlatExportCfg& = FlatExportCfg() );
+
+  //Backends for batched evaluation of exported tables, for instance with
+  //kernels running on GPUs (the functions in NCFlatEval.hh can be compiled as
+  //device code for this purpose). When a backend is set, the batched methods
+  //of isotropic ProcComposition objects (crossSectionMany,
+  //crossSectionIsotropicMany, sampleScatterMany and
+  //sampleScatterIsotropicMany, and thus also the corresponding methods of the
+  //Scatter class and the C API) transparently dispatch to it. The tables of
+  //each process are exported and uploaded on first use, and the handle is
+  //kept by the process until it is destroyed (or until its next use after the
+  //backend was replaced). Neutrons outside the range of the tables, which the
+  //backend must flag with negative cross sections or final energies, are
+  //handled with the usual code on the host.
+  //
+  //Backend methods might be called concurrently from several threads, and
+  //release might be called from the destructors of processes (so it must not
+  //throw), possibly after the backend was replaced. setFlatBatchBackend must
+  //not be called while batched methods are in use.
+
+  class NCRYSTAL_API FlatBatchBackend : private NoCopyMove {
+  public:
+    virtual ~FlatBatchBackend();
+    virtual const char * name() const = 0;
+
+    using Handle = std::uint64_t;
+    virtual Handle upload( const VectD& tables ) = 0;
+    virtual void release( Handle ) = 0;
+
+    //Cross sections in barn (negative if out of range):
+    virtual void crossSectionMany( Handle, const double* ekin, std::size_t N, double* out_xs ) = 0;
+
+    //Sample final energies and mu values (out_ekin negative if out of
+    //range). The seed is drawn from the RNG of the caller, and results must
+    //depend only on it and the input:
+    virtual void sampleScatterMany( Handle, std::uint64_t seed, const double* ekin,
+                                    std::size_t N, double* out_ekin, double* out_mu ) = 0;
+  };
+
+  //Set backend (nullptr disables), and access the current one:
+  NCRYSTAL_API void setFlatBatchBackend( std::shared_ptr<FlatBatchBackend> );
+  NCRYSTAL_API std::shared_ptr<FlatBatchBackend> getFlatBatchBackend();
+
+  //Reference backend evaluating the tables on the host with NCFlatEval.hh,
+  //useful for validating device backends (and for testing the dispatch):
+  NCRYSTAL_API std::shared_ptr<FlatBatchBackend> createReferenceFlatBatchBackend();
+
+  namespace detail {
+    //Dispatch used by ProcComposition. Returns false (having done nothing)
+    //when no backend is set or the process can not be handled by it:
+    bool flatBackendCrossSectionMany( const ProcImpl::ProcComposition&, CachePtr&,
+                                      const double* ekin, std::size_t N, double* out_xs );
+    bool flatBackendSampleScatterMany( const ProcImpl::ProcComposition&, CachePtr&, RNG&,
+                                       const double* ekin, std::size_t N, ScatterOutcomeIsotropic* out );
+    bool flatBackendSampleScatterMany( const ProcImpl::ProcComposition&, CachePtr&, RNG&,
+                                       const double* ekin, const NeutronDirection* dirs,
+                                       std::size_t N, ScatterOutcome* out );
+  }
+
+}
+
+#endif
@@ -48,7 +48,12 @@ namespace NCrystal {
     FreeGas( Temperature, const AtomData& );
 
     CrossSect crossSectionIsotropic(CachePtr&, NeutronEnergy ) const override;
+    void crossSectionIsotropicMany( CachePtr&, const double* ekin,
+                                    std::size_t N, double* out_xs ) const override;
+    unsigned capabilities() const noexcept override { return CapBatchCrossSection; }
     ScatterOutcomeIsotropic sampleScatterIsotropic(CachePtr&, RNG&, NeutronEnergy ) const override;
+    void sampleScatterIsotropicRepeated( CachePtr&, RNG&, NeutronEnergy,
+                                         std::size_t N, ScatterOutcomeIsotropic* out ) const override;
 
     virtual ~FreeGas();
 
@@ -73,9 +73,17 @@ namespace NCrystal {
     //Get the cross-section:
     CrossSect crossSection( NeutronEnergy ekin ) const;
 
+    //Batched version (ekin and out_xs arrays must hold N entries):
+    void crossSectionMany( const double* ekin, std::size_t N, double* out_xs ) const;
+
     //Evaluate (1+1/(2a^2))*erf(a)+exp(-a^2)/(sqrt(pi)*a) (used internally, but
-    //exposed here for testing):
+    //exposed here for testing). In the intermediate region, 0.01<a^2<36, this
+    //is not evaluated directly, but with a precomputed table of piecewise
+    //Chebyshev polynomials (shared by all instances, since there is no
+    //dependency on mass or temperature), which reproduces the direct
+    //evaluation in evalXSShapeASqExact to a relative precision of ~1e-14:
     static double evalXSShapeASq(double a_squared);
+    static double evalXSShapeASqExact(double a_squared);
 
     SigmaFree sigmaFree() const { return SigmaFree{ m_sigmaFree }; }
   private:
@@ -106,8 +114,97 @@ namespace NCrystal {
 
   private:
     double m_c, m_kT, m_sqrtAc, m_invA, m_Adiv4, m_normfact, m_c_real;
+    //Initial beta sampling interval (or maximal energy loss at extremely high
+    //energies, where the beta distribution is approximated as flat):
+    double m_aa = 0.0, m_bb = 0.0, m_elossmax = 0.0;
+    void initBetaRange();
+    //For TabulatedFreeGasSampler (setup for alpha sampling only, and
+    //calculation of the quantiles of the beta distribution):
+    friend class TabulatedFreeGasSampler;
+    struct no_beta_init_t {};
+    FreeGasSampler( NeutronEnergy, Temperature, AtomMass, no_beta_init_t );
+    PairDD sampleAlphaGivenBeta( double beta, RNG& ) const;
+    void calcBetaQuantiles( const double * levels, std::size_t nlevels, double * out ) const;
+  };
+
+  class FreeGasSamplerCache {
+  public:
+
+    //Keeps the FreeGasSampler of the most recently requested neutron energy,
+    //for usage in the CachePtr objects of processes. Thus, the setup cost of
+    //the sampler is avoided when sampling repeatedly at the same energy
+    //(e.g. within rejection loops, or when callers sample many scatterings of
+    //monochromatic neutrons):
+    const FreeGasSampler& get( NeutronEnergy, Temperature, AtomMass );
+    void invalidate() { m_sampler.reset(); }
+
+  private:
+    Optional<FreeGasSampler> m_sampler;
+    double m_ekin = -1.0;
   };
 
+  class TabulatedFreeGasSampler final : private NoCopyMove {
+  public:
+
+    //Tabulated (alpha,beta) sampling in the free-gas model at a given
+    //temperature and target mass, for a range of neutron energies. This is
+    //intended for high-energy tails of scattering kernels, where a new
+    //FreeGasSampler would otherwise be needed for each sampled scattering
+    //(since the energy is different each time), and where the rejection
+    //sampling of beta dominates the cost. At each point of a logarithmic grid
+    //of energies, quantiles of the beta distribution are found by numerical
+    //integration of f(beta|A,E). When sampling, quantiles of the two grid
+    //points surrounding the energy are linearly interpolated (in energy, which
+    //preserves the kinematic limit beta>-E/kT), and alpha is afterwards
+    //sampled as in FreeGasSampler. Thus, the cost of sampling does not depend
+    //on the energy. As in FreeGasSampler, regions where the beta distribution
+    //is below 1e-6 of its value at beta=0 are ignored.
+    //
+    //The tables cover energies from 5kT to 20MeV, but stop earlier for light
+    //targets if FreeGasSampler switches to the (cheap) approximation of a flat
+    //beta distribution at lower energies. As an accuracy bound, the maximal
+    //deviation between interpolated quantiles and those calculated directly
+    //at the midpoints of all grid intervals is estimated upon construction
+    //(relative to the width of the beta distribution).
+    //
+    //Instances should normally be obtained with getTabulatedFreeGasSampler
+    //below, so they are shared.
+
+    TabulatedFreeGasSampler( Temperature, AtomMass );
+    ~TabulatedFreeGasSampler();
+
+    //Energy range covered (FreeGasSampler must be used outside):
+    bool covers( NeutronEnergy ekin ) const noexcept { return ekin.dbl() >= m_egrid.front() && ekin.dbl() <= m_egrid.back(); }
+    NeutronEnergy emin() const noexcept { return NeutronEnergy{ m_egrid.front() }; }
+    NeutronEnergy emax() const noexcept { return NeutronEnergy{ m_egrid.back() }; }
+
+    //Sample (alpha,beta) at energy inside the covered range:
+    PairDD sampleAlphaBeta( NeutronEnergy, RNG& ) const;
+
+    //Estimated max deviation of interpolated beta quantiles:
+    double estimatedMaxError() const noexcept { return m_maxError; }
+
+    //Approximate memory footprint in bytes:
+    std::size_t memoryFootprint() const noexcept;
+
+  private:
+    //Quantiles at levels j/nquantiles, except that the first and last of these
+    //bins are further divided into nsubquantiles (since the tails of the beta
+    //distribution would otherwise be badly represented):
+    static constexpr unsigned nquantiles = 128;
+    static constexpr unsigned nsubquantiles = 32;
+    static constexpr unsigned nlevels = nquantiles + 2 * nsubquantiles - 1;
+    Temperature m_t;
+    AtomMass m_m;
+    VectD m_egrid;
+    VectD m_quantiles;//nlevels values per grid point
+    double m_invLogStep;
+    double m_maxError;
+  };
+
+  //Shared instances (cached per temperature and mass):
+  shared_obj<const TabulatedFreeGasSampler> getTabulatedFreeGasSampler( Temperature, AtomMass );
+
 }
 
 
@@ -123,6 +220,15 @@ namespace NCrystal {
     return CrossSect{ m_sigmaFree * evalXSShapeASq( m_ca * ekin.dbl() ) };
   }
 
+  inline const FreeGasSampler& FreeGasSamplerCache::get( NeutronEnergy ekin, Temperature t, AtomMass m )
+  {
+    if ( !m_sampler.has_value() || ekin.dbl() != m_ekin ) {
+      m_sampler.emplace( ekin, t, m );
+      m_ekin = ekin.dbl();
+    }
+    return m_sampler.value();
+  }
+
   inline double FreeGasSampler::sampleDeltaE( RNG& rng ) const
   {
     return sampleBeta(rng)*m_kT;
@@ -130,7 +236,11 @@ namespace NCrystal {
 
   inline PairDD FreeGasSampler::sampleAlphaBeta( RNG& rng ) const
   {
-    double beta = sampleBeta(rng);
+    return sampleAlphaGivenBeta( sampleBeta(rng), rng );
+  }
+
+  inline PairDD FreeGasSampler::sampleAlphaGivenBeta( double beta, RNG& rng ) const
+  {
     if ( beta < -m_c || muIsotropicAtBeta(beta,m_c) ) {
       nc_assert( beta >= -m_c_real*1.001 );
       //close to kinematical end-point, or neutron has such an extreme energy
@@ -0,0 +1,79 @@
+#ifndef NCrystal_GaussKronrod_hh
+#define NCrystal_GaussKronrod_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "NCrystal/NCDefs.hh"
+
+namespace NCrystal {
+
+  class GaussKronrod {
+  public:
+
+    //Adaptive integration based on the 15-point Gauss-Kronrod rule, in which
+    //the 7-point Gauss rule is embedded. As in QUADPACK's QAG routine, the
+    //interval with the largest error estimate is bisected until the total
+    //error estimate is acceptable. The error estimate of each interval is
+    //found by scaling the Gauss-Kronrod difference as in QUADPACK (but with a
+    //smaller safety factor, see NCGaussKronrod.cc), since the difference itself
+    //is closer to the error of the Gauss result than of the returned Kronrod
+    //result. For a smooth integrand, a single 15-point evaluation is usually
+    //enough, while more difficult integrands will be refined only where needed.
+    GaussKronrod(){}
+    virtual ~GaussKronrod(){}
+
+    //In the simplest use-case, override and implement your function in the evalFunc method:
+    virtual double evalFunc(double) const = 0;
+
+    //The function is always evaluated at all 15 nodes of an interval in one
+    //go. The nodes are symmetric around the center of the interval, which
+    //might make it more efficient to evaluate them in a coherent manner (e.g.
+    //cos(c+-d) can be found from cos(c), sin(c), cos(d) and sin(d)). In case
+    //this is desired, override evalFuncNodes, which must fill fvals[0] with
+    //f(center), and fvals[2k-1] and fvals[2k] with f(center-halfwidth*x_k)
+    //and f(center+halfwidth*x_k) respectively, for k=1..7 (nodes(k-1)=x_k are
+    //increasing, all in (0,1)). Like for Romberg, evalFunc will still have to
+    //be implemented, but that can be a dummy implementation:
+    static constexpr unsigned nnodes = 15;
+    static double node( unsigned i );//x_(i+1) for i=0..6
+    virtual void evalFuncNodes( double center, double halfwidth, double* fvals ) const;
+
+    //Users should override this in order to change heuristics of when to stop
+    //integration because the result is precise enough. The default is to
+    //require a relative error estimate below 1e-8:
+    virtual bool accept( double estimate, double error_estimate, double a, double b ) const;
+
+    //Default behaviour in case the error estimate is not accepted after the
+    //maximal number of bisections (63) is to throw an exception. Client code
+    //can override this method to change this behaviour (if the overriding
+    //methods returns without exceptions, integration will return the best
+    //estimate which may or may not be useful):
+    virtual void convergenceError(double a, double b) const;
+
+    //Perform integration:
+    double integrate(double a, double b) const;
+
+  };
+
+}
+
+#endif
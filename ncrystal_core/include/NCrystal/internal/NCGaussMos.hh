@@ -54,6 +54,19 @@ namespace NCrystal {
 
     void setDSpacingSpread(double);//Enable dspacing deviation in non-ideal crystal [default value of 0.0 means no deviation]
 
+    //Optionally skip contributions from the tails of the mosaicity
+    //distribution, by discarding all normals for which the density of the
+    //Gaussian nowhere on the relevant circle of the sphere exceeds the given
+    //fraction of its peak value. This corresponds to using a tighter angle,
+    //sigma*sqrt(-2*log(fraction)), in the initial truncation tests, while
+    //circle integrals of the surviving normals and the normalisation of the
+    //distribution are unaffected. The default value of 0.0 disables the
+    //screening (as do values for which the screening angle would exceed the
+    //truncation angle). Cross sections are reduced by at most the
+    //contribution of the discarded tails, so values which are large compared
+    //to the precision parameter trade accuracy for speed:
+    void setScreening(double);
+
     //Access parameters of Gaussian mosaicity distribution:
     MosaicityFWHM mosaicityFWHM() const;
     MosaicitySigma mosaicityGaussSigma() const;
@@ -63,6 +76,10 @@ namespace NCrystal {
     double mosaicityCosTruncationAngle() const;
     double mosaicitySinTruncationAngle() const;
     double precision() const;
+    double screening() const;
+    double mosaicityScreeningAngle() const;//equals truncation angle when screening is disabled
+    double mosaicityCosScreeningAngle() const;
+    double mosaicitySinScreeningAngle() const;
     const GaussOnSphere& gos() const { return m_gos; }
 
     //Before calculating cross-sections, the relevant interaction parameters for
@@ -88,21 +105,82 @@ namespace NCrystal {
     //have been first set with a call to setInteractionParameters). This method
     //DOES implement the Gauss truncation internally (and exactly). Return value
     //is the total cross-section for scattering on any of the passed
-    //demi-normals. Intermediate results for individual deminormals with
+    //demi-normals (minus those discarded by any screening, see
+    //setScreening above). Intermediate results for individual deminormals with
     //non-zero contributions will be appended to the passed-in cache vector,
     //while the commulative values of the corresponding individual
     //cross-sections will be appended to the passed in xs_commul vector. This
     //setup allows the caller to subsequently select a plane to scatter on with
     //a binary search in the xs_commul vector, and subsequently use the
     //ScatCache object at the same index in the cache vector, to generate
-    //scatterings:
+    //scatterings. The demi-normals are kept in a structure-of-arrays layout,
+    //which allows the initial truncation test (which usually rejects almost
+    //all of them) to be carried out in a vectorisable loop:
     class ScatCache;
+    class DemiNormals;
+    double calcCrossSections( InteractionPars& ip,
+                              const Vector& neutron_indir,
+                              const DemiNormals& deminormals,
+                              std::vector<ScatCache>& cache,
+                              VectD& xs_commul ) const;
+
+    //Same, but only considering the demi-normals at the given (increasing)
+    //indices. Results are identical to those of the full version, if the
+    //skipped demi-normals are all outside the truncation window:
     double calcCrossSections( InteractionPars& ip,
                               const Vector& neutron_indir,
-                              const std::vector<Vector>& deminormals,
+                              const DemiNormals& deminormals,
+                              const uint32_t* indices,
+                              std::size_t nindices,
                               std::vector<ScatCache>& cache,
                               VectD& xs_commul ) const;
 
+    class DemiNormals {
+    public:
+      DemiNormals() = default;
+      DemiNormals( DemiNormals&& ) noexcept;
+      DemiNormals& operator=( DemiNormals&& ) noexcept;
+      DemiNormals( const DemiNormals& ) = delete;
+      DemiNormals& operator=( const DemiNormals& ) = delete;
+      void reserve( std::size_t n ) { m_x.reserve(n); m_y.reserve(n); m_z.reserve(n); sync(); }
+      void clear() { m_x.clear(); m_y.clear(); m_z.clear(); sync(); }
+      void push_back( const Vector& v ) { m_x.push_back(v[0]); m_y.push_back(v[1]); m_z.push_back(v[2]); sync(); }
+      std::size_t size() const { return m_n; }
+      bool empty() const { return !m_n; }
+      Vector operator[]( std::size_t i ) const { return { m_px[i], m_py[i], m_pz[i] }; }
+      const double * xData() const { return m_px; }
+      const double * yData() const { return m_py; }
+      const double * zData() const { return m_pz; }
+
+      //Once a set of DemiNormals objects is complete, their data can be
+      //relocated into a single contiguous block (with each array starting at
+      //a cache line boundary), releasing their individual allocations. The
+      //objects can no longer be modified afterwards, and the returned Arena
+      //must outlive them:
+      class Arena;
+      static Arena pack( const std::vector<DemiNormals*>& );
+    private:
+      VectD m_x, m_y, m_z;
+      const double * m_px = nullptr;
+      const double * m_py = nullptr;
+      const double * m_pz = nullptr;
+      std::size_t m_n = 0;
+      void sync() { m_px = m_x.data(); m_py = m_y.data(); m_pz = m_z.data(); m_n = m_x.size(); }
+    };
+
+    class DemiNormals::Arena : private MoveOnly {
+    public:
+      Arena() = default;
+      Arena( Arena&& ) = default;
+      Arena& operator=( Arena&& ) = default;
+      std::size_t size() const { return m_size; }//number of doubles (including padding)
+    private:
+      friend class DemiNormals;
+      struct Deleter { void operator()( double * p ) const { std::free( p ); } };
+      std::unique_ptr<double,Deleter> m_data;
+      std::size_t m_size = 0;
+    };
+
     //Scatterings can only be generated once appropriate info has been found via
     //previous calls to cross-section methods, and with relevant info embedded
     //into ScatCache objects (of course, they will only be relevant for the
@@ -136,8 +214,18 @@ namespace NCrystal {
     MosaicitySigma m_mos_sigma = MosaicitySigma{-99};
     double m_prec;
     double m_delta_d = 0.0;
+    double m_screen = 0.0;
+    double m_screenangle = 0.0;
+    double m_cos_screenangle = 0.0;
+    double m_sin_screenangle = 0.0;
     void updateDerivedValues();
     double calcRawCrossSectionValueInit( InteractionPars&, double ) const;
+    //Add contributions of up to 64 demi-normals (at the given indices, with
+    //the given dot products) which passed the initial truncation test:
+    void addNormalPairContribs( InteractionPars&, const DemiNormals&,
+                                const uint32_t * indices, const double * dots, std::size_t n,
+                                double xsoffset, double& xssum,
+                                std::vector<ScatCache>& cache, VectD& xs_commul ) const;
   };
 
   class GaussMos::InteractionPars {
@@ -178,6 +266,10 @@ namespace NCrystal {
   inline double GaussMos::mosaicityCosTruncationAngle() const { return m_gos.getCosTruncangle(); }
   inline double GaussMos::mosaicitySinTruncationAngle() const { return m_gos.getSinTruncangle(); }
   inline double GaussMos::precision() const { return m_gos.getPrecisionParameter(); }
+  inline double GaussMos::screening() const { return m_screen; }
+  inline double GaussMos::mosaicityScreeningAngle() const { return m_screenangle; }
+  inline double GaussMos::mosaicityCosScreeningAngle() const { return m_cos_screenangle; }
+  inline double GaussMos::mosaicitySinScreeningAngle() const { return m_sin_screenangle; }
 
   inline GaussMos::InteractionPars::InteractionPars(double wl, double inv2dsp, double xsfact)
   {
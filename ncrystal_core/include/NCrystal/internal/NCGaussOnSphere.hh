@@ -102,6 +102,14 @@ namespace NCrystal {
     //and with an opening angle of alpha.
     double circleIntegral( double cosgamma, double singamma, double cosalpha, double sinalpha ) const;
 
+    //Evaluate n circle integrals sharing the same cone opening angle,
+    //producing results identical to those of circleIntegral. The closed-form
+    //approximation is prepared for all entries in branch-free loops, which
+    //the compiler can vectorise, leaving only the table lookups and any
+    //special cases for a final pass:
+    void circleIntegralMany( std::size_t n, const double * cosgamma, const double * singamma,
+                             double cosalpha, double sinalpha, double * out ) const;
+
     //Generate random point on circle, according to the density there. Returns
     //false in case of vanishing density everywhere on circle. The ct=cos(t) and
     //st=sin(t) values can be used to construct the coordinate of the chosen
@@ -124,6 +132,8 @@ namespace NCrystal {
 
   private:
     double circleIntegralSlow( double cacg, double sasg, double ca, double sa ) const;
+    bool genPointOnCircleGaussEnv( RNG&, double cd, double sasg, double smax2, double sigma_s2,
+                                   double& cost, double& sint ) const;
     double m_cta;
     double m_circleint_k1;
     double m_circleint_k2;
@@ -136,6 +146,7 @@ namespace NCrystal {
     SplinedLookupTable m_lt_evalcosx;
     double m_prec;//for reference
     double m_sta;//for reference
+    bool m_gaussenv = false;//whether genPointOnCircle can use Gaussian envelopes
     //Enable sampling efficiency report when NCRYSTAL_DEBUG_GAUSSONSPHERE is set (only in debug builds):
     void produceStatReport(const char *);
 #ifndef NDEBUG
@@ -0,0 +1,136 @@
+#ifndef NCrystal_GridIndex_hh
+#define NCrystal_GridIndex_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCDefs.hh"
+#include <cstring>
+
+namespace NCrystal {
+
+  class GridIndex final {
+  public:
+
+    // Acceleration structure for repeated std::upper_bound (or lower_bound)
+    // lookups in a fixed (sorted) grid of strictly positive values, such as
+    // energy grids. The range [grid.front(),grid.back()] is divided into
+    // buckets which are uniform in the IEEE-754 bit patterns of the values
+    // (i.e. approximately uniform in log(x)), each of which maps directly to a
+    // short window of the grid which is then searched. The bucket table has a
+    // size comparable to that of the grid itself. Lookups give results
+    // identical to those of std::upper_bound/lower_bound. Instances are
+    // immutable after construction, and can be safely used from multiple
+    // threads.
+    //
+    // Note that the grid itself is not kept, but must be provided in lookups
+    // (since it is usually already kept by the owner of the GridIndex). For
+    // grids with non-positive or infinite values, or grids which are too
+    // large, no buckets are created and lookups simply fall back to
+    // std::upper_bound over the entire grid.
+
+    GridIndex() = default;
+    explicit GridIndex( const VectD& grid );
+
+    //Single precision grids are also supported (query values are rounded to
+    //float before finding their bucket, which is consistent since rounding is
+    //monotonic - lookups are still exact):
+    explicit GridIndex( const std::vector<float>& grid );
+
+    //Returns std::upper_bound(grid.begin(),grid.end(),x)-grid.begin(), where
+    //grid must be the same as the one passed to the constructor:
+    template<class TVect>
+    std::size_t upperBoundIdx( const TVect& grid, double x ) const;
+
+    //Same for std::lower_bound:
+    template<class TVect>
+    std::size_t lowerBoundIdx( const TVect& grid, double x ) const;
+
+    std::size_t nbuckets() const { return m_bucketBegin.empty() ? 0 : m_bucketBegin.size() - 1; }
+
+    //Approximate memory footprint in bytes:
+    std::size_t memoryFootprint() const noexcept { return sizeof(GridIndex) + m_bucketBegin.capacity() * sizeof(uint32_t); }
+
+  private:
+    std::vector<uint32_t> m_bucketBegin;
+    std::uint64_t m_keyMin = 0;
+    unsigned m_shift = 0;
+    template<class TVect> void init( const TVect& );
+    static std::uint64_t key( double x )
+    {
+      static_assert(sizeof(double)==sizeof(std::uint64_t),"");
+      std::uint64_t k;
+      std::memcpy( &k, &x, sizeof(double) );
+      return k;
+    }
+    static std::uint64_t key( float x )
+    {
+      static_assert(sizeof(float)==sizeof(std::uint32_t),"");
+      std::uint32_t k;
+      std::memcpy( &k, &x, sizeof(float) );
+      return k;
+    }
+    template<class TValue>
+    std::size_t bucketIdx( double x ) const
+    {
+      return static_cast<std::size_t>( ( key( static_cast<TValue>(x) ) - m_keyMin ) >> m_shift );
+    }
+  };
+
+}
+
+
+////////////////////////////
+// Inline implementations //
+////////////////////////////
+
+template<class TVect>
+inline std::size_t NCrystal::GridIndex::upperBoundIdx( const TVect& grid, double x ) const
+{
+  if ( m_bucketBegin.empty() )
+    return std::upper_bound( grid.begin(), grid.end(), x ) - grid.begin();
+  nc_assert( grid.size() == m_bucketBegin.back() );
+  if ( x < grid.front() )
+    return 0;
+  if ( !( x < grid.back() ) )
+    return grid.size();//also NaN, as for std::upper_bound
+  const std::size_t b = bucketIdx<typename TVect::value_type>( x );
+  nc_assert( b + 1 < m_bucketBegin.size() );
+  auto itB = grid.begin();
+  return std::upper_bound( itB + m_bucketBegin[b], itB + m_bucketBegin[b+1], x ) - itB;
+}
+
+template<class TVect>
+inline std::size_t NCrystal::GridIndex::lowerBoundIdx( const TVect& grid, double x ) const
+{
+  if ( m_bucketBegin.empty() )
+    return std::lower_bound( grid.begin(), grid.end(), x ) - grid.begin();
+  nc_assert( grid.size() == m_bucketBegin.back() );
+  if ( !( x > grid.front() ) )
+    return 0;//also NaN, as for std::lower_bound
+  if ( x > grid.back() )
+    return grid.size();
+  const std::size_t b = bucketIdx<typename TVect::value_type>( x );
+  nc_assert( b + 1 < m_bucketBegin.size() );
+  auto itB = grid.begin();
+  return std::lower_bound( itB + m_bucketBegin[b], itB + m_bucketBegin[b+1], x ) - itB;
+}
+
+#endif
@@ -74,6 +74,15 @@ namespace NCrystal {
     PointwiseDist m_pwdist;
     NeutronEnergy m_ekinMax;
     double m_normFact;
+
+    //Guide table, which for equal-width cells in Q provide the first grid bin
+    //overlapping each cell. With it, calcQIofQIntegral finds its bin with O(1)
+    //table reads rather than with a binary search over the full Q grid (for
+    //sampleQValue, the same is done by the PointwiseDist itself):
+    std::vector<unsigned> m_qGuide;
+    double m_qGuideScale;
+    void initGuideTables();
+    double commulIntegral( double q ) const;
     struct internal_t;
     IofQHelper( internal_t );
   };
@@ -95,14 +104,19 @@ inline double NCrystal::IofQHelper::calcQIofQIntegral( NeutronEnergy ekin ) cons
     return m_normFact;
   constexpr double kkk = 4.0 * ekin2ksq(1.0);
   const double twok = std::sqrt( kkk * ekin.dbl() );
-  return m_pwdist.commulIntegral( twok ) * m_normFact;
+  return commulIntegral( twok ) * m_normFact;
 }
 
 inline double NCrystal::IofQHelper::sampleQValue( RNG& rng, NeutronEnergy ekin ) const
 {
+  //Sample the percentile of the untruncated distribution directly, so only
+  //the truncation at Q=2k depends on the energy:
+  const double r = rng.generate();
+  if ( ekin >= m_ekinMax )
+    return m_pwdist.percentile( r );
   constexpr double kkk = 4.0 * ekin2ksq(1.0);
-  const double twok = std::sqrt( kkk * std::min<double>(m_ekinMax.dbl(),ekin.dbl()) );
-  return m_pwdist.sampleBelow( rng, twok );
+  const double twok = std::sqrt( kkk * ekin.dbl() );
+  return m_pwdist.percentile( r * commulIntegral( twok ) );
 }
 
 #endif
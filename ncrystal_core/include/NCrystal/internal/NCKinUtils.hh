@@ -40,6 +40,15 @@ namespace NCrystal {
   //Get kinematically accessible alpha region for given ekin/kT and beta:
   PairDD getAlphaLimits( double ekin_div_kT, double beta );
 
+  //Array versions of the above, giving identical results. The loops contain
+  //no data-dependent branches, which allows vectorisation. For
+  //convertAlphaBetaToDeltaEMuMany, the neutron energies are given in the ekin
+  //array, and no entries can be in the limit where muIsotropicAtBeta is true:
+  void getAlphaLimitsMany( double ekin_div_kT, const double* beta, std::size_t n,
+                           double* out_alow, double* out_aupp );
+  void convertAlphaBetaToDeltaEMuMany( const double* alpha, const double* beta, const double* ekin,
+                                       std::size_t n, double kT, double* out_deltae, double* out_mu );
+
   //Near kinematic endpoint. alpha-, alpha, and alpha+ might become numerically
   //indistinguishable at floating point precision, but mu=cos(scattering_angle)
   //should be sampled isotropically in this limit (since
@@ -33,6 +33,11 @@ namespace NCrystal {
   class LCBragg final : public ProcImpl::ScatterAnisotropicMat {
   public:
 
+    //Special value of the mode parameter (and the lcmode cfg parameter)
+    //selecting tabulated cross sections (see below). It is far beyond the
+    //values of nsample which are practically usable for the reference models:
+    static constexpr int xsTableMode = 1000000000;
+
     //This class models the Bragg diffraction in a layered crystal such as
     //pyrolytic graphite. The lcaxis is the axis (in the crystal frame) around
     //which the crystallites are randomly rotated. The mode parameter can be
@@ -40,10 +45,20 @@ namespace NCrystal {
     //crystal:
     //
     //     mode=0: LCHelper
+    //     mode=xsTableMode: LCHelper, but with cross sections from an LCXSTable
     //     mode>0: LCBraggRef(nsample=mode)
     //     mode<0: LCBraggRndmRef(nsample=-mode)
     //
-    //For a description of the prec and ntrunc parameters, see NCGaussMos.hh.
+    //In the xsTableMode, the cross sections are interpolated from a table
+    //(with a relative tolerance given by prec), which is much faster when
+    //cross sections are needed much more often than scatterings (e.g. for
+    //filters), while scatterings are still generated by the LCHelper. The
+    //table is expensive to build, and is therefore only created by the warmup
+    //method (until then cross sections are provided directly by the
+    //LCHelper, exactly as for mode=0).
+    //
+    //For a description of the prec, ntrunc and screening parameters, see
+    //NCGaussMos.hh.
     LCBragg( const Info&,
              const SCOrientation&,
              MosaicityFWHM,
@@ -52,7 +67,8 @@ namespace NCrystal {
              double delta_d = 0,
              PlaneProvider * plane_provider = 0,
              double prec=1e-3,
-             double ntrunc=0.0 );
+             double ntrunc=0.0,
+             double screening=0.0 );
 
     const char * name() const noexcept final { return "LCBragg"; }
 
@@ -65,6 +81,13 @@ namespace NCrystal {
     CrossSect crossSection(CachePtr&, NeutronEnergy, const NeutronDirection& ) const final;
     ScatterOutcome sampleScatter(CachePtr&, RNG&, NeutronEnergy, const NeutronDirection& ) const final;
 
+    //In the xsTableMode, this builds the cross section table (using up to
+    //getNumberOfThreads() threads) unless the domain is entirely above the
+    //Bragg threshold:
+    void warmup( EnergyDomain, WarmupLevel = WarmupLevel::Essential ) const override;
+
+    std::size_t memoryFootprint() const override;
+
   private:
     struct pimpl;
     std::unique_ptr<pimpl> m_pimpl;
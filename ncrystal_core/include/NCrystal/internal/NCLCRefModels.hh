@@ -24,6 +24,7 @@
 #include "NCrystal/NCProcImpl.hh"
 #include "NCrystal/internal/NCVector.hh"
 #include "NCrystal/internal/NCRotMatrix.hh"
+#include "NCrystal/internal/NCScratchArena.hh"
 
 namespace NCrystal {
 
@@ -31,18 +32,29 @@ namespace NCrystal {
   public:
     //Simple but very slow implementation of layered crystals. Mainly provided
     //as a reference (should give increasingly better result with higher
-    //nsample).
+    //nsample). All crystallite orientations share the single SCBragg instance
+    //(and thus its reflection families), since the rotations around the
+    //lcaxis are applied to the neutron directions instead of to the
+    //crystal. Memory usage is therefore independent of nsample, apart from
+    //the O(nsample) temporary buffers used in sampleScatter.
     LCBraggRef(ProcImpl::ProcPtr scbragg, LCAxis lcaxis_lab, unsigned nsample = 1000);
 
     const char * name() const noexcept override { return "LCBraggRef"; }
     CrossSect crossSection(CachePtr&, NeutronEnergy, const NeutronDirection& ) const override;
     EnergyDomain domain() const noexcept override;
     ScatterOutcome sampleScatter(CachePtr&, RNG&, NeutronEnergy, const NeutronDirection& ) const override;
+    std::size_t memoryFootprint() const override { return sizeof(*this) + m_sc->memoryFootprint(); }
   private:
     ProcImpl::ProcPtr m_sc;
     Vector m_lcaxislab;
     unsigned m_nsample;
     unsigned m_nsampleprime;
+    class Cache : public CacheBase {
+    public:
+      CachePtr sc_cacheptr;//for passing to m_sc
+      ScratchArena scratch;//for temporary buffers in sampleScatter
+      void invalidateCache() override {}
+    };
   };
 
   class LCBraggRndmRot final : public ProcImpl::ScatterAnisotropicMat {
@@ -59,6 +71,7 @@ namespace NCrystal {
     CrossSect crossSection(CachePtr&, NeutronEnergy, const NeutronDirection& ) const override;
     EnergyDomain domain() const noexcept override;
     ScatterOutcome sampleScatter(CachePtr&, RNG&, NeutronEnergy, const NeutronDirection& ) const override;
+    std::size_t memoryFootprint() const override { return sizeof(*this) + m_sc->memoryFootprint(); }
   private:
     ProcImpl::ProcPtr m_sc;
     Vector m_lcaxislab;
@@ -24,7 +24,9 @@
 #include "NCrystal/NCDefs.hh"
 #include "NCrystal/internal/NCGaussMos.hh"
 #include "NCrystal/internal/NCVector.hh"
+#include "NCrystal/internal/NCScratchArena.hh"
 #include "NCrystal/NCTypes.hh"
+#include <atomic>
 
 namespace NCrystal {
 
@@ -108,8 +110,9 @@ namespace NCrystal {
     //wrapped appropriately. Note that this class does NOT apply any truncation
     //cut, which is assumed to take place in the calling code.
   public:
-    //Constructor takes same parameters as GaussMos.
-    LCStdFrame(MosaicityFWHM, double prec = 1e-3, double ntrunc = 0.0 );
+    //Constructor takes same parameters as GaussMos (the screening parameter
+    //is passed on to GaussMos::setScreening).
+    LCStdFrame(MosaicityFWHM, double prec = 1e-3, double ntrunc = 0.0, double screening = 0.0 );
 
     //For reference, we provide const access to underlying GaussMos object
     const GaussMos& gaussMos() const { return m_gm; }
@@ -151,13 +154,15 @@ namespace NCrystal {
                   double cosphi, double sinphi, Vector& outdir ) const;
 
   private:
-    const GaussMos m_gm;
+    GaussMos m_gm;
   };
 
   class LCHelper : private MoveOnly {
     //Class which can provide cross-sections and scatterings for planes with
-    //normals not parallel to the lcaxis. Prec and ntrunc parameters will be
-    //passed on directly to the internal GaussMos object.
+    //normals not parallel to the lcaxis. Prec, ntrunc and screening
+    //parameters will be passed on directly to the internal GaussMos object
+    //(the screening narrows the ranges of crystallite rotations considered
+    //for off-axis normals).
   public:
     LCHelper( LCAxis lcaxis_crystalframe,
               LCAxis lcaxis_labframe,
@@ -165,12 +170,21 @@ namespace NCrystal {
               double unitcell_volume_times_natoms,
               PlaneProvider * pp,
               double prec = 1e-3,
-              double ntrunc = 0.0 );
+              double ntrunc = 0.0,
+              double screening = 0.0 );
+    ~LCHelper();
 
     //Usage happens via Cache objects (allowing users of the class to decide
     //upon caching strategies themselves). One should not share Cache objects
     //between different LCHelper instances, except if the cache is first reset
     //via a call to Cache::reset().
+    //
+    //Since the cached information depends only on the discretised (wavelength,
+    //c3) values, it is also published in a table shared by all Cache objects
+    //of the LCHelper (e.g. those of different threads), once a given
+    //(wavelength,c3) combination has been encountered more than once. The
+    //table has a fixed capacity and uses lock-free lookups and insertions.
+    //Set NCRYSTAL_LCHELPER_NOSHAREDCACHE=1 to disable it.
     class Cache;
     bool isValid(Cache&, double wavelength, double c3 ) const;
     bool isValid(Cache&, double wavelength, const Vector& indir) const;
@@ -178,6 +192,7 @@ namespace NCrystal {
 
     //Valid caches can be used to get cross-sections or generate scatterings:
     double crossSection( Cache&, double wavelength, const Vector& indir ) const;
+    double crossSection( Cache&, double wavelength, double c3 ) const;//c3=dot(indir,lcaxis)
     void genScatter( Cache&, RNG&, double wavelength, const Vector& indir, Vector& outdir ) const;
 
     //Access without cache.
@@ -186,26 +201,32 @@ namespace NCrystal {
 
     double braggThreshold() const;//max wavelength, beyond which all cross-sections will be 0.
 
-    const GaussMos& gaussMos() { return m_lcstdframe.gaussMos(); }
+    const GaussMos& gaussMos() const { return m_lcstdframe.gaussMos(); }
+
+    //Plane sets, sorted by dspacing (largest first):
+    const std::vector<LCPlaneSet>& planeSets() const { return m_planes; }
+
+    //Approximate memory footprint in bytes (incl. the shared table):
+    std::size_t memoryFootprint() const;
 
   private:
     Vector m_lcaxislab;
     std::vector<LCPlaneSet> m_planes;//sorted by dspacing, largest first.
     LCStdFrame m_lcstdframe;
     double m_xsfact;
+    struct SharedEntry;
+    class SharedTable;
+    std::unique_ptr<SharedTable> m_sharedTable;//null if disabled
+    void ensureValidC3( Cache&, double wavelength, double c3 ) const;
     void forceUpdateCache( Cache&, uint64_t discr_wl, uint64_t discr_c3 ) const;
-    struct Overlay : private MoveOnly {
+    void findROIs( double wl, double c3, double s3, std::vector<LCROI>&, VectD& roixs_commul ) const;
+    struct Overlay {
+      //Overlays are arrays of ndata commulative values:
       static const unsigned ndata = 8;
-      Overlay();
-      ~Overlay();
-      void clear();
-      void prepareNullArray();
-      float * data;
-      double nonCommulVal(unsigned i) const;
-      Overlay(Overlay&& o);
-      Overlay& operator=(Overlay&& o);
+      static double nonCommulVal(const float * data, unsigned i);
     };
-  static void genPhiVal(RNG& rand, const LCROI& roi, const Overlay& overlay, double& phi, double& overlay_at_phi);
+    void fillOverlay( const LCROI&, const LCStdFrame::NeutronPars&, float * data ) const;
+    static void genPhiVal(RNG& rand, const LCROI& roi, const float * overlay, double& phi, double& overlay_at_phi);
 
   public:
     class Cache : public CacheBase {
@@ -221,8 +242,53 @@ namespace NCrystal {
       double m_s3;//sqrt(1-m_c3*m_c3)
       std::vector<LCROI> m_roilist;
       VectD m_roixs_commul;//for selecting
-      std::vector<Overlay> m_roi_overlays;//for selecting
+      std::vector<float*> m_roi_overlays;//for selecting (null until prepared)
+      ScratchArena m_scratch;//holds the m_roi_overlays data, reset with the signature
+      const SharedEntry * m_shared;//if set, used instead of the three lists above
+    };
+  };
+
+  class LCXSTable : private MoveOnly {
+    //Lookup table providing approximate cross sections of an LCHelper as a
+    //function of wavelength and c3=dot(indir,lcaxis), via linear
+    //interpolation. The table is organised in rows of fixed
+    //theta3=acos(|c3|), spaced uniformly at a small fraction of the
+    //mosaicity. Within each row, the wavelength points are chosen adaptively
+    //so linear interpolation reproduces the cross sections within the
+    //requested relative tolerance, starting from a uniform grid augmented
+    //with points around the edges of the Bragg bands of all plane sets. Rows
+    //are never built inside crossSection calls, but only by explicit calls to
+    //buildRows (which can be expensive, typically taking ~0.1s per row for
+    //thousands of rows, and is thus intended for initialisation e.g. via the
+    //warmup method of the processes). Until then, and for wavelengths below a
+    //fraction of the Bragg threshold, the LCHelper is used directly.
+  public:
+    LCXSTable( const LCHelper&, double tolerance );
+    ~LCXSTable();
+    double crossSection( LCHelper::Cache&, double wavelength, double c3 ) const;
+    //Build all missing rows, using up to nthreads threads. Can be called
+    //concurrently with crossSection calls:
+    void buildRows( unsigned nthreads ) const;
+    //Wavelength range covered by the table:
+    double wavelengthMin() const { return m_wlmin; }
+    double wavelengthMax() const { return m_wlmax; }
+    //Approximate memory footprint in bytes (of the rows built so far):
+    std::size_t memoryFootprint() const;
+  private:
+    struct Row {
+      std::vector<float> wl;
+      std::vector<float> xs;
+      double eval( double wl ) const;
     };
+    const LCHelper& m_lchelper;
+    double m_tol;
+    double m_wlmin;
+    double m_wlmax;
+    double m_dtheta;
+    double m_invdtheta;
+    std::size_t m_nrows;
+    std::unique_ptr<std::atomic<Row*>[]> m_rows;
+    std::unique_ptr<Row> buildRow( double theta3 ) const;
   };
 }
 
@@ -266,17 +332,11 @@ namespace NCrystal {
 
   inline LCHelper::Cache::Cache() : m_signature(std::numeric_limits<uint64_t>::max(),
                                                 std::numeric_limits<uint64_t>::max()),
-                                    m_wl(-99), m_c3(-99), m_s3(-99)
+                                    m_wl(-99), m_c3(-99), m_s3(-99), m_shared(nullptr)
   {
     //Starts in same state as after calling Cache::reset()
   }
-  inline LCHelper::Overlay::Overlay() : data(0) {}
-  inline LCHelper::Overlay::~Overlay() { delete[] data; }
-  inline void LCHelper::Overlay::clear() { delete[] data; data = 0; }
-  inline void LCHelper::Overlay::prepareNullArray() { if (!data) { data = new float[ndata]; } std::memset(data,0,sizeof(float)*ndata); }
-  inline double LCHelper::Overlay::nonCommulVal(unsigned i) const { nc_assert(i<ndata); return i ? data[i]-(double)data[i-1] : (double)data[i]; }
-  inline LCHelper::Overlay::Overlay(LCHelper::Overlay&& o) { std::swap(data,o.data); }
-  inline LCHelper::Overlay& LCHelper::Overlay::operator=(LCHelper::Overlay&& o) { std::swap(data,o.data); return *this; }
+  inline double LCHelper::Overlay::nonCommulVal(const float * data, unsigned i) { nc_assert(i<ndata); return i ? data[i]-(double)data[i-1] : (double)data[i]; }
 
 }
 
@@ -29,7 +29,7 @@ namespace NCrystal {
   struct MatrixAllowCopy_t {};
   constexpr MatrixAllowCopy_t MatrixAllowCopy = MatrixAllowCopy_t{};
 
-  class Matrix : private MoveOnly {
+  class NCRYSTAL_API Matrix : private MoveOnly {
   public:
 
     Matrix() ;
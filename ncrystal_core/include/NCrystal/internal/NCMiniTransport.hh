@@ -0,0 +1,127 @@
+#ifndef NCrystal_MiniTransport_hh
+#define NCrystal_MiniTransport_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCProc.hh"
+
+namespace NCrystal {
+
+  namespace MiniTransport {
+
+    //Simple built-in Monte Carlo transport of neutrons through a single
+    //volume of a given material, with simple geometries, implementing the
+    //stepping loop usually found in client codes (intersect the geometry,
+    //evaluate cross sections, sample a step length, sample a scattering, and
+    //repeat). Neutrons are propagated in batches with the batched process
+    //methods, and batches can be processed in parallel threads.
+    //
+    //Lengths are in meters, and all volumes are centred at the origin.
+
+    struct NCRYSTAL_API Geometry {
+      enum class Shape { Slab, Box, Cylinder, Sphere };
+      Shape shape = Shape::Slab;
+      double dx = 0.0;//full extent along x (Box)
+      double dy = 0.0;//full extent along y (Box, Cylinder height)
+      double dz = 0.0;//full extent along z (Slab thickness, Box)
+      double radius = 0.0;//Sphere, Cylinder
+
+      //Slabs are infinite in x and y, cylinders have their axis along y:
+      static Geometry slab( double thickness );
+      static Geometry box( double dx, double dy, double dz );
+      static Geometry cylinder( double radius, double height );
+      static Geometry sphere( double radius );
+
+      //Throws BadInput if dimensions are not positive and finite:
+      void validate() const;
+
+      //Intersect the line pos+t*dir with the volume. Returns false if it
+      //misses, otherwise the entry and exit values t0<t1 (t0<0 when pos is
+      //inside):
+      bool intersect( const double* pos, const double* dir, double& t0, double& t1 ) const;
+    };
+
+    enum class AbsorptionMode {
+      None,       //ignore absorption
+      Weight,     //continuous reduction of neutron weights
+      Terminate   //absorption as discrete events, terminating the neutrons
+    };
+
+    struct NCRYSTAL_API Config {
+      Geometry geometry;
+      AbsorptionMode absorptionMode = AbsorptionMode::Weight;
+      unsigned maxScatterings = 1000;//neutrons are abandoned after this many
+      unsigned nthreads = 1;
+      uint64_t rngStreamIndexOffset = 0;//batch k uses RNG stream offset+k
+    };
+
+    struct NeutronState {
+      double pos[3];
+      double dir[3];//must be a unit vector
+      double ekin;//eV
+      double weight;
+    };
+
+    enum class Status {//NB: numerical values are used in the C API
+      Exited = 0,        //left the volume
+      Missed = 1,        //never entered the volume
+      Absorbed = 2,      //absorbed (only with AbsorptionMode::Terminate)
+      MaxScatterings = 3 //abandoned inside the volume after maxScatterings
+    };
+
+    struct ExitState {
+      NeutronState state;//state at exit, absorption, or abandonment
+      unsigned nscat;//number of scatterings
+      Status status;
+    };
+
+    struct NCRYSTAL_API Tallies {
+      //Summed weights of exiting neutrons by number of scatterings (the last
+      //bin collects all neutrons with at least exitWeightByNScat.size()-1
+      //scatterings), and summed weights of the other categories. In the
+      //AbsorptionMode::Weight mode, absorbedWeight is the total weight lost
+      //along the paths:
+      std::vector<double> exitWeightByNScat;
+      double absorbedWeight = 0.0;
+      double missedWeight = 0.0;
+      double abandonedWeight = 0.0;
+      std::uint64_t nScatterings = 0;
+
+      explicit Tallies( unsigned nbins_nscat = 10 ) : exitWeightByNScat( std::max(1u,nbins_nscat), 0.0 ) {}
+      void add( const Tallies& );
+    };
+
+    //Propagate N neutrons, starting inside or outside the volume. The
+    //material is given by the scattering and (optional) absorption processes,
+    //and the number density. Neutrons are handled in batches of fixed size,
+    //batch k using a clone of the scatter object with RNG stream
+    //cfg.rngStreamIndexOffset+k, so results do not depend on the number of
+    //threads. Tallies are optional (their binning is kept), and are added to
+    //any existing content:
+    NCRYSTAL_API void propagate( Scatter&, const Absorption*, NumberDensity,
+                                 const Config&, const NeutronState* in, std::size_t N,
+                                 ExitState* out, Tallies* tallies = nullptr );
+
+  }
+
+}
+
+#endif
@@ -23,10 +23,11 @@
 
 #include "NCrystal/NCInfo.hh"
 #include "NCrystal/NCProcImpl.hh"
+#include "NCrystal/internal/NCGridIndex.hh"
 
 namespace NCrystal {
 
-  class PCBragg final : public ProcImpl::ScatterIsotropicMat {
+  class NCRYSTAL_API PCBragg final : public ProcImpl::ScatterIsotropicMat {
   public:
 
     //Calculates Bragg diffraction in a powdered (or non-textured
@@ -51,29 +52,131 @@ namespace NCrystal {
     EnergyDomain domain() const noexcept final;
 
     CrossSect crossSectionIsotropic(CachePtr&, NeutronEnergy ) const final;
+    void crossSectionIsotropicMany( CachePtr&, const double* ekin,
+                                    std::size_t N, double* out_xs ) const final;
     ScatterOutcomeIsotropic sampleScatterIsotropic(CachePtr&, RNG&, NeutronEnergy ) const final;
+    void sampleScatterIsotropicMany( CachePtr&, RNG&, const double* ekin,
+                                     std::size_t N, ScatterOutcomeIsotropic* out ) const final;
+    unsigned capabilities() const noexcept final { return CapBatchCrossSection | CapBatchSampling | CapStateless; }
+
+    //Biased sampling for applications where only scatterings with
+    //mu=cos(scattering angle) in [mu_min,mu_max] are of interest (e.g. small
+    //detectors). Only planes scattering into the window are sampled (still
+    //proportionally to their contributions), and the returned weight is the
+    //fraction of the cross section contributed by them, by which the
+    //statistical weight of the neutron must be multiplied. If no planes
+    //scatter into the window, the weight is 0 and the outcome (which is then
+    //an unscattered neutron) should be discarded:
+    std::pair<ScatterOutcomeIsotropic,double> sampleScatterIsotropicInWindow( CachePtr&, RNG&, NeutronEnergy,
+                                                                              double mu_min, double mu_max ) const;
 
     //Two PCBragg instances can be merged by merging the plane lists:
     std::shared_ptr<Process> createMerged( const Process& other,
                                            double scale_self,
                                            double scale_other ) const override;
 
+    std::size_t memoryFootprint() const override;
 
     //Empty, no planes:
     PCBragg( no_init_t ) {}
 
+    //Plane tables in double precision, regardless of the storage (see
+    //below). Cross sections are fdm_commul[i]/ekin, with i being the index of
+    //the last entry in v2dE which is not above ekin:
+    VectD get2dE() const;
+    VectD getFDMCommul() const;
+
   protected:
     Optional<std::string> specificJSONDescription() const override;
   private:
     CosineScatAngle genScatterMu(RNG&, NeutronEnergy ekin) const;
-    std::size_t findLastValidPlaneIdx( NeutronEnergy ekin) const;
     NeutronEnergy m_threshold = NeutronEnergy{kInfinity};
-    VectD m_2dE;
-    VectD m_fdm_commul;
+
+    //The plane tables (2d-spacings in energy units, increasing, and the
+    //commulative contributions of the planes), along with bucket indices for
+    //quick lookups in them. By default they are kept in single precision,
+    //which halves the memory footprint. This is done only when all values are
+    //within the normal range of floats, so each value is then stored with a
+    //relative precision of 2^-24 (~6e-8), and cross sections and Bragg edge
+    //positions are affected at that level - far below any physical
+    //uncertainty. Each merge (createMerged) can at most add another such
+    //deviation to the commulative contributions. Set the environment variable
+    //NCRYSTAL_PCBRAGG_FULLPRECISION=1 to opt out and keep double precision:
+    template<class TValue>
+    struct Tables {
+      std::vector<TValue> v2dE, fdm_commul;
+      GridIndex index_2dE, index_fdm_commul;
+      std::size_t findLastValidPlaneIdx( double ekin ) const;
+      double crossSection( double ekin ) const;
+      void crossSectionMany( double threshold, const double* ekin,
+                             std::size_t N, double* out_xs ) const;
+      double genSinThetaBraggSq( RNG&, double ekin ) const;
+      double genSinThetaBraggSqInWindow( RNG&, double ekin, double x_low, double x_high,
+                                         double& weight ) const;
+      void set( const VectD& v2dE, const VectD& fdm_commul );
+      std::size_t memoryFootprint() const;
+    };
+    Tables<double> m_tabD;
+    Tables<float> m_tabF;
+    bool m_compact = false;
+    void setTables( VectD&& v2dE, VectD&& fdm_commul );
+
     void init( const StructureInfo&, VectDFM&& );
     void init( double v0_times_natoms, VectDFM&& );
   };
 
+  class NCRYSTAL_API PCBraggStrained final : public ProcImpl::ScatterIsotropicMat {
+  public:
+
+    //Cheap view of a PCBragg process, for a material whose d-spacings are all
+    //scaled by the same factor (isotropic strain, d -> dspacingScale*d, which
+    //also scales the unit cell volume by dspacingScale^3). Both the
+    //2d-spacings in energy units and the plane contributions of the plane
+    //tables then scale as 1/dspacingScale^2, so cross sections and scattering
+    //angles at ekin are simply those of the original process at
+    //ekin*dspacingScale^2, and no tables have to be rebuilt. This is intended
+    //for applications like Bragg-edge strain mapping, where many slightly
+    //rescaled lattices must be evaluated. Note that number densities of the
+    //strained material must be adjusted by the callers themselves.
+    //
+    //Per-axis strains are not supported, since planes with the same d-spacing
+    //(but different hkl indices) are merged in the PCBragg plane tables.
+
+    const char * name() const noexcept final { return "PCBraggStrained"; }
+
+    PCBraggStrained( shared_obj<const PCBragg>, double dspacingScale );
+
+    const PCBragg& original() const noexcept { return *m_orig; }
+    const shared_obj<const PCBragg>& originalSO() const noexcept { return m_orig; }
+    double dspacingScale() const noexcept { return m_dspacingScale; }
+
+    EnergyDomain domain() const noexcept final;
+
+    CrossSect crossSectionIsotropic(CachePtr&, NeutronEnergy ) const final;
+    void crossSectionIsotropicMany( CachePtr&, const double* ekin,
+                                    std::size_t N, double* out_xs ) const final;
+    ScatterOutcomeIsotropic sampleScatterIsotropic(CachePtr&, RNG&, NeutronEnergy ) const final;
+    void sampleScatterIsotropicMany( CachePtr&, RNG&, const double* ekin,
+                                     std::size_t N, ScatterOutcomeIsotropic* out ) const final;
+    unsigned capabilities() const noexcept final { return CapBatchCrossSection | CapBatchSampling | CapStateless; }
+
+    std::size_t memoryFootprint() const override;
+
+  protected:
+    Optional<std::string> specificJSONDescription() const override;
+  private:
+    shared_obj<const PCBragg> m_orig;
+    double m_dspacingScale;
+    double m_ekinScale;//dspacingScale^2
+  };
+
+  //Apply an isotropic d-spacing scale factor to all PCBragg components of a
+  //process (which can be a ProcComposition, in which case a new composition
+  //is returned), by wrapping them in PCBraggStrained views (or adjusting the
+  //scale of existing views). Other processes are left unchanged, and the
+  //process itself is returned if dspacingScale is 1:
+  NCRYSTAL_API ProcImpl::ProcPtr applyDSpacingScale( ProcImpl::ProcPtr, double dspacingScale );
+
 }
 
 #endif
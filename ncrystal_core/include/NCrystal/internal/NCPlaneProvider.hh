@@ -60,6 +60,28 @@ namespace NCrystal {
     //return value here usually indicates incomplete information for normals to
     //be provided:
     virtual bool canProvide() const = 0;
+
+    //Providers for which the planes are known to come in groups of
+    //symmetry-equivalent planes, can optionally provide those groups rather
+    //than the individual planes. Each group is given by a representative
+    //(h,k,l) index, which is expanded by symmetry()->getEquivalentReflections
+    //(giving ndeminormals entries). The demi-normals are the normalised
+    //reciprocal lattice vectors of the expanded (h,k,l) indices, in the
+    //crystal frame of getReciprocalLatticeRot (cf. NCLatticeUtils.hh), and
+    //the order of the planes is the same as in loops with getNextPlane (after
+    //calling prepareLoop, loops must use only one of the methods):
+    struct SymGroup {
+      double dspacing, fsq;
+      HKL hkl;
+      unsigned ndeminormals;
+    };
+    virtual const EqRefl* symmetry() const { return nullptr; }//nullptr if groups are not available
+    virtual Optional<SymGroup> getNextSymGroup();
+
+    //Providers which discard planes (e.g. weak reflections pruned for
+    //efficiency) can report the discarded fraction of the orientation-averaged
+    //Bragg diffraction cross section (the worst case over all wavelengths):
+    virtual double discardedFraction() const { return 0.0; }
   };
 
   //Creates standard plane provider from Info object, which will attempt various
@@ -90,6 +112,8 @@ namespace NCrystal {
 
     bool canExpand( HKLInfoType ) const;
 
+    const EqRefl* symmetry() const { return m_sym.has_value() ? &m_sym.value() : nullptr; }
+
   private:
     Optional<EqRefl> m_sym;
     Optional<EqRefl::EquivReflList> m_list;
@@ -22,6 +22,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "NCrystal/NCDefs.hh"
+#include "NCrystal/internal/NCSpan.hh"
 
 namespace NCrystal {
 
@@ -29,6 +30,14 @@ namespace NCrystal {
   // linear distribution function. The function is defined by its non-negative
   // values on a given set of points, which must form a proper grid of
   // increasing non-identical values.
+  //
+  // For fast sampling, the constructor also sets up a guide table (Chen and
+  // Asau 1974), which for each of N equal-width cells in [0,1] holds the index
+  // of the first CDF value not below the lower edge of the cell (N being the
+  // number of bins). Percentiles are then found by searching only the few CDF
+  // values inside a single cell, rather than by a binary search over the full
+  // CDF. Results are identical to those of a full search. Small distributions
+  // (below 32 points) do not get a guide table.
 
   class PointwiseDist {
   public:
@@ -41,6 +50,10 @@ namespace NCrystal {
     //Sample:
     double sample(RNG& rng) const { return percentileWithIndex(rng()).first; }
 
+    //Sample many values at once, filling the provided buffer (the random
+    //numbers are generated in a single RNG call):
+    void sampleMany( RNG& rng, Span<double> out ) const;
+
     const VectD& getXVals() const { return m_x; }
     const VectD& getYVals() const { return m_y; }
 
@@ -52,6 +65,15 @@ namespace NCrystal {
     //(i.e returns (value,idx) where value will lie in interval
     //[getXVals().at(idx),getXVals().at(idx+1)]):
     std::pair<double,unsigned> percentileWithIndex( double percentile_value ) const;
+
+    //Same, but operating on n points of externally stored data, laid out like
+    //getXVals(), getYVals() and getCDF() (thus allowing clients to keep the
+    //data in more compact storage):
+    static std::pair<double,unsigned> percentileWithIndex( const double * x,
+                                                           const double * y,
+                                                           const double * cdf,
+                                                           std::size_t n,
+                                                           double percentile_value );
     std::pair<double,unsigned> sampleWithIndex( RNG& rng ) const { return percentileWithIndex(rng()); }
 
     //Sample distribution, truncated at some value (throws BadInput exception if
@@ -73,6 +95,9 @@ namespace NCrystal {
     VectD m_cdf;
     VectD m_x;
     VectD m_y;
+    std::vector<unsigned> m_guide;
+    void initGuide();
+    std::size_t findCDFBin( double p ) const;
   };
 }
 
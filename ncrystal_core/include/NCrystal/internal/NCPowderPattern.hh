@@ -0,0 +1,76 @@
+#ifndef NCrystal_PowderPattern_hh
+#define NCrystal_PowderPattern_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCProcImpl.hh"
+#include "NCrystal/internal/NCSpan.hh"
+
+namespace NCrystal {
+
+  //Deterministic calculation of the scattering angle distribution of neutrons
+  //with a given incident spectrum in a non-oriented material, as an
+  //alternative to histogramming scattering angles from Monte Carlo sampling
+  //in the design of powder diffractometers.
+  //
+  //The incident spectrum is given as a list of neutron energies with
+  //weights, and the result in each bin of scattering angle is the sum over
+  //the spectrum of weight*sigma_bin, where sigma_bin is the cross section
+  //[barn] for scattering into the bin. The process is split into its
+  //(scaled) components, with nested ProcComposition objects flattened. The
+  //contributions of powder Bragg diffraction components (PCBragg, as well as
+  //PCBraggStrained) are calculated analytically from the plane tables, where
+  //each plane contributes at the exact Bragg angle. Other components (e.g.
+  //inelastic or incoherent scattering) are treated as a background, which is
+  //estimated by sampling nSamplesBackground scattering angles per incident
+  //energy, using RNG streams which depend only on the chunk of energies
+  //being processed (so results do not depend on the number of threads). The
+  //background is left out if nSamplesBackground is 0.
+
+  struct NCRYSTAL_API PowderPatternCfg {
+    VectD binEdges;//scattering angle bin edges [rad], increasing and in [0,pi]
+    unsigned nSamplesBackground = 0;
+    uint64_t seed = 0;//seed of the RNG streams used for the background
+    unsigned nthreads = 1;
+  };
+
+  struct NCRYSTAL_API PowderPattern {
+    struct Component {
+      std::string name;//process name
+      bool analytic;//true for Bragg components
+      VectD values;//one per bin
+    };
+    std::vector<Component> components;
+    VectD total;//sum of all component values
+    VectD totalBragg;//sum of analytic components
+    VectD totalBackground;//sum of sampled components
+  };
+
+  //Throws BadInput for oriented processes, invalid bin edges, or if
+  //weights do not have the same size as ekin:
+  NCRYSTAL_API PowderPattern calcPowderPattern( ProcImpl::ProcPtr scatter,
+                                                Span<const double> ekin,
+                                                Span<const double> weights,
+                                                const PowderPatternCfg& );
+
+}
+
+#endif
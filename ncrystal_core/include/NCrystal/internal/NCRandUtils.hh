@@ -37,6 +37,23 @@ namespace NCrystal {
   NeutronDirection randIsotropicNeutronDirection( RNG& );
   NeutronDirection randNeutronDirectionGivenScatterMu( RNG&, double mu, const Vector& in );
 
+  //Batched version of randDirectionGivenScatterMu for n neutrons, with the
+  //direction components in separate arrays (the output arrays can be the
+  //same as the input arrays). Input directions need not be normalised. No
+  //rejection sampling is done: the outgoing directions are constructed in
+  //a basis perpendicular to each input direction (found without branches
+  //as in T. Duff et al., JCGT 6(1), 2017), and azimuthal angles are sampled
+  //directly with a table of 4096 (cos,sin) values. With
+  //AzimuthPrecision::Full, table values are refined with the angle addition
+  //formulas (and Taylor expansions in the remaining tiny angle) to full
+  //double precision. With AzimuthPrecision::Table, they are used directly,
+  //so azimuthal angles are discretised in steps of 2pi/4096:
+  enum class AzimuthPrecision { Full, Table };
+  void randDirectionsGivenScatterMu( RNG&, std::size_t n, const double * mu,
+                                     const double * in_x, const double * in_y, const double * in_z,
+                                     double * out_x, double * out_y, double * out_z,
+                                     AzimuthPrecision = AzimuthPrecision::Full );
+
   //Sample a random point on the unit circle:
   PairDD randPointOnUnitCircle( RNG& );
 
@@ -44,6 +61,11 @@ namespace NCrystal {
   double randNorm( RNG& );
   void randNorm( RNG&, double&g1, double&g2);
 
+  //Fill out[0..n-1] with independent values from a unit Gaussian. The
+  //uniform numbers needed are as far as possible obtained in bulk from
+  //RNG::generateMany (results thus differ from those of n randNorm calls):
+  void randNormMany( RNG&, double* out, std::size_t n );
+
   //sample gaussian tail (tail>=0!), like sampling randNorm until result is
   //>=tail (but more efficient):
   double randNormTail(double tail, RNG& rng);
@@ -53,6 +75,22 @@ namespace NCrystal {
 
   //Sample exponential:
   double randExp( RNG& rng );//sample non-negative value from exp(-x)
+  void randExpMany( RNG&, double* out, std::size_t n );//bulk version (cf. randNormMany)
+
+  //By default, the randNorm and randExp functions above (and randNormTail and
+  //randExpDivSqrt) use the classic methods (ratio-of-uniforms or polar method
+  //for the Gaussian, and -log(R) for the exponential). If
+  //NCRYSTAL_RAND_ZIGGURAT=1 is set in the environment, or if NCrystal is
+  //built with NCRYSTAL_RANDUTILS_ZIGGURAT defined, they instead use the
+  //faster ziggurat method of Marsaglia and Tsang (J. Stat. Soft. 5(8), 2000,
+  //doi:10.18637/jss.v005.i08), which most of the time needs just a single
+  //uniform number and no transcendental functions (but which of course
+  //results in different random streams). Direct access to both is provided
+  //for testing and benchmarking:
+  double randNormZiggurat( RNG& );
+  double randExpZiggurat( RNG& );
+  double randNormClassic( RNG& );
+  double randExpClassic( RNG& );
   double randExpInterval( RNG& rng, double a, double b, double c );//sample value in [a,b] from exp(-c*x)
 
   class RandExpIntervalSampler {
@@ -107,6 +145,53 @@ namespace NCrystal {
     state_t m_s;
   };
 
+  class RandPhiloxImpl {
+    //Counter-based generator implementing Philox4x32-10 due to J. Salmon et
+    //al. (Proc. SC11, doi:10.1145/2063384.2063405). Output is a pure function
+    //of a 64 bit key, a 64 bit stream index and a 64 bit position counter, so
+    //independent streams can be created in O(1) for any (key,stream) pair, and
+    //positions can be set directly. Each evaluation provides 128 random bits,
+    //which are used as two 64 bit numbers. Unlike xoroshiro128+ all output
+    //bits are of good quality.
+  public:
+    RandPhiloxImpl( uint64_t key = 0, uint64_t stream = 0, uint64_t position = 0 );
+
+    double generate();// uniformly in ]0,1]
+    uint64_t genUInt64();//uniformly over 0..uint64max (i.e. all bits randomised)
+    uint32_t genUInt32();//uniformly over 0..uint32max (i.e. all bits randomised)
+    bool coinflip();
+
+    uint64_t key() const noexcept { return m_key; }
+    uint64_t stream() const noexcept { return m_stream; }
+    uint64_t position() const noexcept { return m_pos; }//counts 64 bit outputs
+
+    //The underlying bijection (exposed for unit tests):
+    using block_t = std::array<uint32_t,4>;
+    static block_t philox4x32_10( block_t ctr, uint64_t key );
+  private:
+    uint64_t m_key, m_stream, m_pos;
+    uint64_t m_buf[2];
+    void fillBuffer();
+  };
+
+  class RandPhiloxSubstream final : public RNG {
+    //The streams of the builtin counter-based RNG as produced by
+    //RNGProducer::produceByIdx for createBuiltinCounterRNG(seed), i.e. with
+    //stream index 1+idx. Unlike those, instances are cheap to reset to the
+    //beginning of a new stream without any allocations, allowing a dedicated
+    //stream for each neutron in a batch:
+  public:
+    RandPhiloxSubstream( uint64_t seed = 0, uint64_t idx = 0 ) : m_impl( seed, idx + 1 ) {}
+    void reset( uint64_t seed, uint64_t idx ) { m_impl = RandPhiloxImpl( seed, idx + 1 ); }
+    bool coinflip() override { return m_impl.coinflip(); }
+    uint64_t generate64RndmBits() override { return m_impl.genUInt64(); }
+    uint32_t generate32RndmBits() override { return m_impl.genUInt32(); }
+  protected:
+    double actualGenerate() override { return m_impl.generate(); }
+  private:
+    RandPhiloxImpl m_impl;
+  };
+
 }
 
 
@@ -136,7 +221,7 @@ inline NCrystal::NeutronDirection NCrystal::randNeutronDirectionGivenScatterMu(
   return randDirectionGivenScatterMu(rng,mu,in).as<NeutronDirection>();
 }
 
-inline double NCrystal::randExp( RNG& rng )
+inline double NCrystal::randExpClassic( RNG& rng )
 {
   return - std::log(rng.generate());
 }
@@ -212,6 +297,28 @@ inline uint32_t NCrystal::RandXRSRImpl::genUInt32()
   return static_cast<uint32_t>(genUInt64WithBadLowerBits() >> 32);
 }
 
+inline uint64_t NCrystal::RandPhiloxImpl::genUInt64()
+{
+  if ( !(m_pos&1) )
+    fillBuffer();
+  return m_buf[(m_pos++)&1];
+}
+
+inline double NCrystal::RandPhiloxImpl::generate()
+{
+  return randUInt64ToFP01( genUInt64() );
+}
+
+inline uint32_t NCrystal::RandPhiloxImpl::genUInt32()
+{
+  return static_cast<uint32_t>( genUInt64() >> 32 );
+}
+
+inline bool NCrystal::RandPhiloxImpl::coinflip()
+{
+  return genUInt64() & 0x8000000000000000ull;
+}
+
 inline bool NCrystal::RandXRSRImpl::coinflip()
 {
   //Test one of the high bits, stay far away from the 3 lowest:
@@ -26,7 +26,7 @@
 
 namespace NCrystal {
 
-  class RotMatrix final : public Matrix {
+  class NCRYSTAL_API RotMatrix final : public Matrix {
   public:
 
     //Specialised Matrix which always has dimensions of 3x3 and which can
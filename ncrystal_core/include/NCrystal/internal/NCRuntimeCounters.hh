@@ -0,0 +1,132 @@
+#ifndef NCrystal_RuntimeCounters_hh
+#define NCrystal_RuntimeCounters_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCProcImpl.hh"
+#include <atomic>
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Optional runtime counters, for finding out why simulations with a given   //
+// material are slow. They are only compiled in when NCrystal is built with   //
+// -DENABLE_RUNTIME_COUNTERS=ON (which defines                                //
+// NCRYSTAL_ENABLE_RUNTIME_COUNTERS for the library sources). Otherwise the   //
+// macros at the bottom of this file expand to nothing.                       //
+//                                                                            //
+// Counters are kept per process instance (using relaxed atomics). Calls to   //
+// instrumented processes are marked with NCRYSTAL_RTCOUNTER_SCOPE(_N), which //
+// also makes that process the "active" one in the current thread, so that  //
+// NCRYSTAL_RTCOUNT in helper code (cache lookups, rejection loops, RNG       //
+// draws, ...) is attributed to it. Outside of such scopes, NCRYSTAL_RTCOUNT  //
+// does nothing. When enabled, the counters also appear under the key         //
+// "runtime_counters" in Process::jsonDescription().                          //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+namespace NCrystal {
+
+  namespace RuntimeCounters {
+
+    enum class Counter : unsigned {
+      XSCalls,             //calls to crossSection(..) methods
+      SampleCalls,         //calls to sampleScatter(..) methods
+      CacheHits,           //cache lookups not needing an update
+      CacheMisses,         //cache lookups triggering an update
+      RejectionIterations, //iterations of rejection sampling loops
+      RNGDraws,            //random numbers drawn from built-in RNG streams
+      NCounters
+    };
+    constexpr unsigned nCounters = static_cast<unsigned>( Counter::NCounters );
+
+    //Whether counters are compiled in:
+    constexpr bool isEnabled() noexcept
+    {
+#ifdef NCRYSTAL_ENABLE_RUNTIME_COUNTERS
+      return true;
+#else
+      return false;
+#endif
+    }
+
+    //JSON dictionary with all non-vanishing counters for all processes (which
+    //might since have been deleted), keyed by the process uid:
+    std::string jsonSummary();
+
+    //JSON dictionary with the counters of a given process (NullOpt if it was
+    //never counted, or if counters are not compiled in):
+    Optional<std::string> jsonForProcess( UniqueIDValue );
+
+    //Reset all counters to zero:
+    void reset();
+
+    //Implementation details:
+    struct Block {
+      UniqueIDValue uid;
+      std::string name;
+      std::atomic<uint64_t> values[nCounters];
+      void add( Counter c, uint64_t n = 1 ) noexcept
+      {
+        values[static_cast<unsigned>(c)].fetch_add( n, std::memory_order_relaxed );
+      }
+    };
+    Block& blockFor( const ProcImpl::Process& );
+    Block*& activeBlock();
+
+    class ProcessScope : private NoCopyMove {
+    public:
+      ProcessScope( const ProcImpl::Process& proc, Counter callCounter, uint64_t ncalls = 1 )
+        : m_prev( activeBlock() )
+      {
+        auto& b = blockFor( proc );
+        b.add( callCounter, ncalls );
+        activeBlock() = &b;
+      }
+      ~ProcessScope() { activeBlock() = m_prev; }
+    private:
+      Block* m_prev;
+    };
+
+    inline void countActive( Counter c, uint64_t n = 1 )
+    {
+      Block* b = activeBlock();
+      if ( b )
+        b->add( c, n );
+    }
+  }
+
+}
+
+#ifdef NCRYSTAL_ENABLE_RUNTIME_COUNTERS
+#  define NCRYSTAL_RTCOUNTER_SCOPE(proc,callcounter)                    \
+  ::NCrystal::RuntimeCounters::ProcessScope nc_rtcounter_scope( proc, ::NCrystal::RuntimeCounters::Counter::callcounter )
+#  define NCRYSTAL_RTCOUNTER_SCOPE_N(proc,callcounter,n)                \
+  ::NCrystal::RuntimeCounters::ProcessScope nc_rtcounter_scope( proc, ::NCrystal::RuntimeCounters::Counter::callcounter, n )
+#  define NCRYSTAL_RTCOUNT(counter) ::NCrystal::RuntimeCounters::countActive( ::NCrystal::RuntimeCounters::Counter::counter )
+#  define NCRYSTAL_RTCOUNT_N(counter,n) ::NCrystal::RuntimeCounters::countActive( ::NCrystal::RuntimeCounters::Counter::counter, n )
+#else
+#  define NCRYSTAL_RTCOUNTER_SCOPE(proc,callcounter) do {} while(0)
+#  define NCRYSTAL_RTCOUNTER_SCOPE_N(proc,callcounter,n) do {} while(0)
+#  define NCRYSTAL_RTCOUNT(counter) do {} while(0)
+#  define NCRYSTAL_RTCOUNT_N(counter,n) do {} while(0)
+#endif
+
+#endif
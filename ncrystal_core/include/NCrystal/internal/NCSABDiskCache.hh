@@ -0,0 +1,101 @@
+#ifndef NCrystal_SABDiskCache_hh
+#define NCrystal_SABDiskCache_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCSABData.hh"
+#include "NCrystal/internal/NCDiskCacheUtils.hh"
+
+namespace NCrystal {
+
+  namespace SABDiskCache {
+
+    // Opt-in persistent on-disk cache of scattering kernels which are
+    // expensive to construct (e.g. those expanded from VDOS curves), intended
+    // to avoid repeating such expansions in many processes (e.g. MPI ranks)
+    // working with the same materials. It is enabled by setting the
+    // NCRYSTAL_SAB_CACHEDIR environment variable to the path of an existing
+    // writable directory. Alternatively, setting NCRYSTAL_NODE_SHARED_CACHE=1
+    // places the cache in node-local shared memory (see nodeSharedCacheDir in
+    // NCFileUtils.hh), so independent processes on a node share the entries
+    // without any disk I/O.
+    //
+    // Entries are keyed by a byte string describing all inputs of the
+    // calculation (the "key material"), which is stored in full in the files
+    // and verified upon loading. Files are written atomically (via a
+    // temporary file and a rename), so concurrent processes can safely
+    // share the cache directory. Any problems with reading or writing files
+    // simply results in the cache not being used.
+    //
+    // The file format is a fixed header of 8-byte fields, followed by the key
+    // material (padded to a multiple of 8 bytes) and the alpha, beta and
+    // S(alpha,beta) arrays as raw doubles in native byte order. Files written
+    // with a different format version, NCrystal version or byte order are
+    // ignored.
+    //
+    // Setting NCRYSTAL_SAB_CACHE_FLOAT32=1 makes newly written files store the
+    // S(alpha,beta) values as floats instead, halving their size. Such values
+    // are promoted to doubles when loaded (and can therefore not be shared
+    // between processes via memory mapping), and values below the float range
+    // are flushed to zero. This is intended for kernels where the accuracy is
+    // anyway limited by the input data. Since a stored entry is always
+    // returned as loaded, all processes see identical values either way.
+    //
+    // Files are memory mapped read-only where supported (POSIX platforms), and
+    // the S(alpha,beta) values of the returned SABData objects refer directly
+    // to the mapped memory. Thus, all processes on a given machine using the
+    // same cache entry will share a single physical copy of the data. The
+    // same is done for the large derived arrays of log(S) values and alpha
+    // integrals needed for sampling, which are kept in separate ".derived"
+    // files next to the main files.
+
+    bool isEnabled();
+
+    //Runtime override of the cache directory, initially taken from the
+    //NCRYSTAL_SAB_CACHEDIR environment variable (an empty string disables the
+    //cache):
+    void setCacheDir( std::string );
+    std::string getCacheDir();
+
+    using KeyMaterial = DiskCacheKeyMaterial;
+
+    //Returns nullptr if there is no (valid) cache entry:
+    std::shared_ptr<const SABData> load( const KeyMaterial& );
+
+    //Store entry, and return the result of a subsequent load (thus returning
+    //nullptr if the cache is not enabled or data could not be written):
+    std::shared_ptr<const SABData> store( const KeyMaterial&, const SABData& );
+
+    //Derived arrays, which can only be cached for SABData objects which were
+    //themselves returned by the load or store functions above:
+    struct DerivedArrays {
+      ImmutableDblArray logsab, alphaintegrals_cumul;
+    };
+    Optional<DerivedArrays> loadDerived( const SABData& );
+    Optional<DerivedArrays> storeDerived( const SABData&,
+                                          const VectD& logsab,
+                                          const VectD& alphaintegrals_cumul );
+
+  }
+
+}
+
+#endif
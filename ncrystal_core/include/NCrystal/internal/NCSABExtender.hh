@@ -23,6 +23,7 @@
 
 #include "NCrystal/NCDefs.hh"
 #include "NCrystal/internal/NCFreeGasUtils.hh"
+#include <functional>
 
 namespace NCrystal {
 
@@ -46,6 +47,13 @@ namespace NCrystal {
       //at given incident neutron energy:
       virtual CrossSect crossSection(NeutronEnergy) const = 0;
       virtual PairDD sampleAlphaBeta(RNG&, NeutronEnergy) const = 0;
+
+      //Sample repeatedly at the same energy, until the discard function
+      //returns false for a sampled value (which is then returned). The default
+      //implementation simply calls sampleAlphaBeta in a loop, but derived
+      //classes can reimplement it to reuse any setup depending on the energy:
+      using DiscardFct = std::function<bool(RNG&,const PairDD&)>;
+      virtual PairDD sampleAlphaBetaUntilKept(RNG&, NeutronEnergy, const DiscardFct& ) const;
     };
 
     class SABFGExtender : public SABExtender {
@@ -56,10 +64,16 @@ namespace NCrystal {
       virtual ~SABFGExtender();
       CrossSect crossSection(NeutronEnergy) const override;
       PairDD sampleAlphaBeta(RNG&, NeutronEnergy) const override;
+      PairDD sampleAlphaBetaUntilKept(RNG&, NeutronEnergy, const DiscardFct& ) const override;
     private:
       FreeGasXSProvider m_xsprovider;
       Temperature m_t;
       AtomMass m_m;
+      //Sampling uses a (shared) TabulatedFreeGasSampler where possible, which
+      //is set up upon first usage (unless NCRYSTAL_SAB_EXACT_FGTAIL is set):
+      struct TabulatedTail;
+      std::unique_ptr<TabulatedTail> m_tail;
+      const TabulatedFreeGasSampler * tabulatedSampler( NeutronEnergy ) const;
     };
 
   }
@@ -30,12 +30,30 @@ namespace NCrystal {
 
     //Direct factory function with no caching:
     std::unique_ptr<const SABScatterHelper> createScatterHelper( shared_obj<const SABData>,
-                                                                 std::shared_ptr<const VectD> energyGrid = nullptr );
+                                                                 std::shared_ptr<const VectD> energyGrid = nullptr,
+                                                                 SamplerAlg = SamplerAlg::Alg1 );
 
     //Same with caching:
     void clearScatterHelperCache();
     shared_obj<const SABScatterHelper> createScatterHelperWithCache( shared_obj<const SABData>,
-                                                                     std::shared_ptr<const VectD> energyGrid = nullptr );
+                                                                     std::shared_ptr<const VectD> energyGrid = nullptr,
+                                                                     SamplerAlg = SamplerAlg::Alg1 );
+
+    //Adapt an energy grid specification (in the format of
+    //DI_ScatKnl::energyGrid()) to the requested density of points, as selected
+    //with the "sabgrid" cfg parameter. For EGridDensity::Default, or when a
+    //complete grid is provided, the grid is returned unchanged. Otherwise the
+    //result is a specification {emin,emax,npts}, in which npts (explicit or
+    //the default of egridDefaultNPoints) is scaled down by a factor of 5 or up
+    //by a factor of 3 for the Coarse and Fine settings respectively. For the
+    //Adaptive setting, npts is replaced by -3*npts, and a negative value
+    //instructs the SABIntegrator to refine a coarse grid where needed, using at
+    //most -npts points (see SABIntegrator.hh):
+    constexpr unsigned egridDefaultNPoints = 300;
+    std::shared_ptr<const VectD> applyEGridDensity( std::shared_ptr<const VectD> energyGrid, EGridDensity );
+
+    //EGridDensity corresponding to a value of the "sabgrid" cfg parameter:
+    EGridDensity egridDensityFromCfgValue( const std::string& sabgrid );
 
     //For caching reasons, we keep a database of energy grid's and an associated
     //unique id. Note that it is expected that most energy grids specified will
@@ -0,0 +1,125 @@
+#ifndef NCrystal_SABFixedEnergy_hh
+#define NCrystal_SABFixedEnergy_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCSABData.hh"
+
+namespace NCrystal {
+
+  namespace SAB {
+
+    //Double differential scattering cross section, d^2sigma/dE'dmu
+    //[barn/eV], at neutron energies ekin[i], final energies eprime[i] and
+    //mu[i]=cos(scattering_angle), evaluated directly from the S(alpha,beta)
+    //table:
+    //
+    //   d^2sigma/dE'dmu = (sigma_bound/(2kT)) * sqrt(E'/E) * S(alpha,beta)
+    //
+    //The S values are interpolated log-linearly in alpha on the two
+    //surrounding beta rows, and linearly in beta between those. Points outside
+    //the (alpha,beta) grid or with E' outside [0,infinity[ give 0 (i.e. no
+    //SABExtender is applied, so results are only complete for neutron
+    //energies well below SABData::suggestedEmax()). Divide by 2pi to get
+    //d^2sigma/dOmegadE'.
+    void doubleDifferentialCrossSection( const SABData&,
+                                         const double* ekin, const double* eprime,
+                                         const double* mu, std::size_t n,
+                                         double* out_ddxs );
+
+    struct SABFixedEnergyTableCfg {
+      unsigned nmu = 200;//number of (equidistant) mu bins
+      unsigned eprimeSubdivisions = 1;//number of E' bins per beta grid interval
+    };
+
+    class SABFixedEnergyTables final {
+    public:
+
+      //Precomputed tables for exact inverse-CDF sampling of (E',mu) at a
+      //fixed list of incident neutron energies, intended for simulations with
+      //monochromatic incident beams (e.g. time-of-flight spectrometers), where
+      //SABSampler would otherwise repeat the rejection sampling at the same
+      //energy for every neutron.
+      //
+      //For each energy, E, the double differential cross section is evaluated
+      //with the function above at the nodes of a rectangular (E',mu) grid,
+      //covering the entire kinematically accessible region [0,Emax'] x
+      //[-1,1]. The E' nodes are the points of the beta grid (with E'>0, and
+      //with each interval optionally subdivided), along with E'=0, and the
+      //mu nodes are equidistant. The sampled density is the bilinear
+      //interpolation of the node values, which is sampled exactly by first
+      //choosing a grid cell from the cumulative distribution of the cell
+      //integrals, and then sampling E' and mu in the cell from the linear
+      //marginal and conditional distributions. The same interpolated density
+      //(normalised to the integrated cross section) is available from the
+      //doubleDifferentialCrossSection method, so detector response can be
+      //calculated deterministically and consistently with the sampling.
+
+      SABFixedEnergyTables( shared_obj<const SABData>,
+                            VectD energies,
+                            const SABFixedEnergyTableCfg& = SABFixedEnergyTableCfg() );
+
+      std::size_t nEnergies() const { return m_tables.size(); }
+      NeutronEnergy energy( std::size_t ie ) const;
+      //Index of energy (throws BadInput if not one of the tabulated values):
+      std::size_t energyIndex( NeutronEnergy ) const;
+
+      const SABData& data() const { return *m_data; }
+
+      //Integrated cross section of the table at the given energy [barn]:
+      CrossSect crossSection( std::size_t ie ) const;
+
+      //Sample (deltaE,mu)=(E'-E,mu) at the given energy:
+      PairDD sampleDeltaEMu( std::size_t ie, RNG& ) const;
+      void sampleDeltaEMuMany( std::size_t ie, RNG&, std::size_t n,
+                               double* out_deltae, double* out_mu ) const;
+
+      //Bilinearly interpolated d^2sigma/dE'dmu [barn/eV] of the table at the
+      //given energy (zero outside the table):
+      void doubleDifferentialCrossSection( std::size_t ie, const double* eprime,
+                                           const double* mu, std::size_t n,
+                                           double* out_ddxs ) const;
+
+      //Grids of the table at the given energy, and values at the nodes
+      //(ddxs[ieprime*nmu+imu]):
+      const VectD& eprimeGrid( std::size_t ie ) const;
+      const VectD& muGrid() const { return m_mugrid; }
+      const VectD& nodeValues( std::size_t ie ) const;
+
+      std::size_t memoryFootprint() const;
+
+    private:
+      struct Table {
+        double ekin;
+        VectD eprime, ddxs, cellcumul;
+        double xs;
+      };
+      shared_obj<const SABData> m_data;
+      VectD m_mugrid;
+      std::vector<Table> m_tables;
+      const Table& table( std::size_t ie ) const;
+    };
+
+  }
+
+}
+
+#endif
@@ -37,10 +37,22 @@ namespace NCrystal {
       //If a specific energy grid is not can be supplied, one will be
       //automatically determined based on an analysis of the scattering kernel
       //in question (see ncmat_doc.md for details of how to specify an energy
-      //grid vector).
+      //grid vector). As an extension, a negative number of points, -n, in a
+      //grid specification {emin,emax,-n} requests an adaptive grid: starting
+      //from a coarse grid, intervals are split in three (in log(E)) as long as
+      //linear interpolation of the cross section deviates by more than 0.1% at
+      //either of the two dividing points, using at most n points.
       //
       //If a SABExtender is not provided, a default single-target free gas
       //extender will be used.
+      //
+      //The SamplerAlg selects the implementation used for sampling at each
+      //energy grid point (see NCSABSampler.hh).
+      //
+      //If the NCRYSTAL_SAB_LAZY environment variable is set to 1, samplers
+      //for each energy grid point are only created upon first usage rather
+      //than upfront (cross sections are still tabulated upfront). This makes
+      //initialisation faster when only a narrow range of energies is used.
 
       //Both constructors and destructors of the SABIntegrator are light-weight,
       //and it is safe and recommended to end the life of SABIntegrator after
@@ -52,17 +64,27 @@ namespace NCrystal {
       ~SABIntegrator();
       SABIntegrator( shared_obj<const SABData>,
                      const VectD* egrid = nullptr,
-                     std::shared_ptr<const SABExtender> sabextender = nullptr );
+                     std::shared_ptr<const SABExtender> sabextender = nullptr,
+                     SamplerAlg = SamplerAlg::Alg1 );
 
       SABXSProvider createXSProvider() { SABXSProvider o; doit(&o,nullptr); return o; }
       SABSampler createSampler() { SABSampler o; doit(nullptr,&o); return o; }
       SABScatterHelper createScatterHelper()
       {
-        SABScatterHelper o;
-        doit(&o.xsprovider,&o.sampler,&o.specificJSONDescription);
-        return o;
+        SABXSProvider xp;
+        SABSampler sp;
+        Optional<std::string> json;
+        doit(&xp,&sp,&json);
+        return SABScatterHelper( std::move(xp), std::move(sp), std::move(json) );
       }
 
+      //Create helper for a kernel which is identical to the one of an existing
+      //helper, except for the value of boundXS. No integration is needed in
+      //this case, since cross sections simply scale with boundXS, and the
+      //sampler of the existing helper is shared:
+      SABScatterHelper createScaledScatterHelper( const SABScatterHelper& reference,
+                                                  SigmaBound referenceBoundXS );
+
     private:
       struct Impl;
       Pimpl<Impl> m_impl;
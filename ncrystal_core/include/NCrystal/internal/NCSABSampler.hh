@@ -23,9 +23,19 @@
 
 #include "NCrystal/NCSABData.hh"
 #include "NCrystal/internal/NCSABExtender.hh"
+#include "NCrystal/internal/NCGridIndex.hh"
+#include <functional>
 
 namespace NCrystal {
 
+  namespace SAB {
+    //Choice of SABSamplerAtE implementation (cf. NCSABSamplerModels.hh):
+    enum class SamplerAlg : unsigned { Alg1 = 0, Alias = 1 };
+    //Density of the energy grid on which cross sections and samplers are
+    //prepared (cf. applyEGridDensity in NCSABFactory.hh):
+    enum class EGridDensity : unsigned { Coarse = 0, Default = 1, Fine = 2, Adaptive = 3 };
+  }
+
   class SABSamplerAtE : private NoCopyMove {
     //For sampling (alpha,beta) values at a given energy, Ei, or lower. This
     //is intended to be implemented with the rejection method, taking
@@ -34,10 +44,19 @@ namespace NCrystal {
     //energy. Due to acceptance-rate consideration of the MC rejection method,
     //implementations are expected to be better performing when ekin is not
     //too much lower than Ei (which is why we need a whole grid of Ei values,
-    //rather than just one with Ei=Emax).
+    //rather than just one with Ei=Emax). Returned values must lie inside the
+    //kinematically accessible region at the requested ekin_div_kT, which is
+    //assumed to be no higher than Ei.
   public:
     virtual PairDD sampleAlphaBeta(double ekin_div_kT, RNG&) const = 0;
     virtual ~SABSamplerAtE() = default;
+
+    //Approximate memory footprint in bytes of the data belonging to this
+    //sampler. Data shared between samplers is not included, but is instead
+    //returned by sharedDataFootprint along with an address identifying it, so
+    //it can be counted just once:
+    virtual std::size_t memoryFootprint() const { return 64; }
+    virtual std::pair<const void*,std::size_t> sharedDataFootprint() const { return { nullptr, 0 }; }
   };
 
   class SABSampler final : private MoveOnly {
@@ -55,7 +74,18 @@ namespace NCrystal {
                 std::shared_ptr<const SAB::SABExtender>,
                 double xsAtEmax );
 
-    SABSampler() = default;//invalid instance.
+    //Alternatively, the SABSamplerAtE instances can be created lazily, upon
+    //first usage at a given energy grid point. The factory function will be
+    //invoked with the egrid value, and must be MT-safe (concurrent creation
+    //is resolved by keeping the first instance published):
+    using SamplerFactory = std::function<std::unique_ptr<SABSamplerAtE>(double)>;
+    void setData( Temperature temperature,
+                  VectD&& egrid,
+                  SamplerFactory,
+                  std::shared_ptr<const SAB::SABExtender>,
+                  double xsAtEmax );
+
+    SABSampler();//invalid instance.
     ~SABSampler();
 
     //Sample (alpha,beta) values directly:
@@ -64,13 +94,34 @@ namespace NCrystal {
     //Convenience (calls sampleAlphaBeta, then converts):
     PairDD sampleDeltaEMu( NeutronEnergy, RNG& rng) const;
 
+    //Same for n neutrons with energies ekin[i]. The (alpha,beta) values are
+    //sampled one at a time, and then converted in batches. The random numbers
+    //are consumed in the same order as by repeated calls to sampleDeltaEMu,
+    //so results are identical:
+    void sampleDeltaEMuMany( const double* ekin, std::size_t n, RNG& rng,
+                             double* out_deltae, double* out_mu ) const;
+
+    //In lazy mode, create all samplers which might be used for energies in
+    //[emin,emax] upfront, using up to nthreads threads (does nothing if not
+    //in lazy mode):
+    void createSamplers( double emin, double emax, unsigned nthreads ) const;
+
+    //Approximate memory footprint in bytes (in lazy mode, this only includes
+    //the samplers created so far):
+    std::size_t memoryFootprint() const;
+
     //Move ok:
-    SABSampler( SABSampler&& ) = default;
-    SABSampler& operator=( SABSampler&& ) = default;
+    SABSampler( SABSampler&& );
+    SABSampler& operator=( SABSampler&& );
 
   private:
     VectD m_egrid;
+    GridIndex m_egridIndex;
     std::vector<std::unique_ptr<SABSamplerAtE>> m_samplers;
+    struct LazySamplers;
+    std::unique_ptr<LazySamplers> m_lazySamplers;//only in lazy mode
+    const SABSamplerAtE& getSampler( std::size_t iegrid ) const;
+    void setDataCommon( Temperature, VectD&&, std::shared_ptr<const SAB::SABExtender>, double );
     double m_kT = 0.0;
     std::shared_ptr<const SAB::SABExtender> m_extender;
     double m_xsAtEmax = 0.0, m_k1 = 0.0, m_k2 = 0.0;
@@ -22,33 +22,74 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "NCrystal/internal/NCSABSampler.hh"
-#include "NCrystal/internal/NCPointwiseDist.hh"
 #include "NCrystal/internal/NCMath.hh"
 
 namespace NCrystal {
   namespace SAB {
 
-    class SABSamplerAtE_Alg1 : public SABSamplerAtE {
+    class SABAlphaSampleInfo  {
+      //Class able to sample alpha for a given energy and beta-value.
+    public:
+      struct SAPoint {
+        double alpha = 0, sval = 0, logsval = 0;
+      };
+      SAPoint pt_front, pt_back;
+      double prob_front = 0;//1.0 means narrow, 2.0 means 0 cross-section at value, sample linearly in [pt_front.alpha,pt_back.alpha]
+      double prob_notback = 0;//prob_front+prob_middle
+      //The grid idx by which the front/back tail is bounded (kept outside
+      //SAPoint to avoid padding, since many instances are kept in memory):
+      uint32_t alpha_idx_front = 0, alpha_idx_back = 0;
+    };
+
+    struct SABSamplerDataArena {
+      //Contiguous storage for the per-energy data of the samplers below, which
+      //refer to their data by offsets into the arena. Each sampler is created
+      //with its own arena, but the data of all samplers in a given SABSampler
+      //should be moved into a single shared arena with packSamplerData(..),
+      //to avoid heap fragmentation and improve memory locality.
+      struct Offsets { std::size_t dbls = 0, infos = 0, idxs = 0; };
+      //(large buffers, see largeBufferAlloc in NCMem.hh):
+      std::vector<double,LargeBufferAllocator<double>> dbls;
+      std::vector<SABAlphaSampleInfo,LargeBufferAllocator<SABAlphaSampleInfo>> infos;
+      std::vector<uint32_t,LargeBufferAllocator<uint32_t>> idxs;
+      Offsets sizes() const { Offsets o; o.dbls = dbls.size(); o.infos = infos.size(); o.idxs = idxs.size(); return o; }
+    };
+
+    class SABSamplerAtE_ArenaBased : public SABSamplerAtE {
+      //Common base class for samplers keeping their data in a
+      //SABSamplerDataArena.
+    protected:
+      SABSamplerAtE_ArenaBased( std::shared_ptr<const SABSamplerDataArena> );
+      const double * arenaDbls() const noexcept { return m_arena->dbls.data() + m_offsets.dbls; }
+      const SABAlphaSampleInfo * arenaInfos() const noexcept { return m_arena->infos.data() + m_offsets.infos; }
+      const uint32_t * arenaIdxs() const noexcept { return m_arena->idxs.data() + m_offsets.idxs; }
+      const SABSamplerDataArena::Offsets& arenaSizes() const noexcept { return m_sizes; }
+    public:
+      //The part of the (possibly shared) arena used by this sampler:
+      std::size_t memoryFootprint() const override;
+    private:
+      friend void packSamplerData( std::vector<std::unique_ptr<SABSamplerAtE>>& );
+      std::shared_ptr<const SABSamplerDataArena> m_arena;
+      SABSamplerDataArena::Offsets m_offsets, m_sizes;
+    };
+
+    //Move the data of all arena based samplers in the list into a single
+    //shared arena (other samplers are left untouched):
+    void packSamplerData( std::vector<std::unique_ptr<SABSamplerAtE>>& );
+
+    class SABSamplerAtE_Alg1 : public SABSamplerAtE_ArenaBased {
       //A sampler which implements Algorithm1 of the Algorithm 1. of the
       //sampling paper (https://doi.org/10.1016/j.jcp.2018.11.043).
     public:
       PairDD sampleAlphaBeta(double ekin_div_kT, RNG&) const final;
+      std::pair<const void*,std::size_t> sharedDataFootprint() const final;
 
       struct CommonCache {
         const std::shared_ptr<const SABData> data;
-        const VectD logsab, alphaintegrals_cumul;
-      };
-      class AlphaSampleInfo  {
-        //Class able to sample alpha for a given energy and beta-value.
-      public:
-        struct SAPoint {
-          double alpha = 0, sval = 0, logsval = 0;
-          unsigned alpha_idx = 0;//the grid idx by which the front/back tail is bounded.
-        };
-        SAPoint pt_front, pt_back;
-        double prob_front = 0;//1.0 means narrow, 2.0 means 0 cross-section at value, sample linearly in [pt_front.alpha,pt_back.alpha]
-        double prob_notback = 0;//prob_front+prob_middle
+        const ImmutableDblArray logsab, alphaintegrals_cumul;
+        std::size_t memoryFootprint() const;
       };
+      using AlphaSampleInfo = SABAlphaSampleInfo;
 
       SABSamplerAtE_Alg1( std::shared_ptr<const CommonCache>,
                           VectD&& betaVals,
@@ -58,16 +99,58 @@ namespace NCrystal {
 
     private:
       //Sample beta from P(beta|Ei) (line 4 of Alg. 1 in the sampling paper):
-      double sampleBeta(RNG&) const;
+      std::pair<double,unsigned> sampleBetaWithIndex(RNG&) const;
       // Sample alpha from F(alpha|beta_j,Ei) (line 7-8 of Alg. 1 in the sampling
       // paper). NB: this needs to work with a single random number, the
       // percentile, for purposes of interpolating between two beta-rows:
       double sampleAlpha(std::size_t ibeta, double rand_percentile) const;
 
-      //Data:
+      //Data (in arena: nbeta beta values, normalised weights, and CDF values,
+      //followed by nbeta-1 AlphaSampleInfo objects):
+      std::shared_ptr<const CommonCache> m_common;
+      std::size_t m_nbeta;
+      std::size_t m_ibetaOffset;
+    };
+
+    class SABSamplerAtE_Alias : public SABSamplerAtE_ArenaBased {
+      //A sampler implementing the same algorithm as SABSamplerAtE_Alg1, but
+      //avoiding the binary searches. Beta bins are picked in constant time via
+      //Walker/Vose alias tables, and alpha bins are located via guide tables
+      //(which unlike alias tables preserve the monotonic mapping of the
+      //random percentile to alpha, needed for interpolating between beta
+      //rows). For a given beta bin and percentile, the alpha values are
+      //identical to those of SABSamplerAtE_Alg1.
+    public:
+      PairDD sampleAlphaBeta(double ekin_div_kT, RNG&) const final;
+      std::pair<const void*,std::size_t> sharedDataFootprint() const final;
+
+      using AlphaSampleInfo = SABAlphaSampleInfo;
+
+      struct CommonCache {
+        //Guide tables, with (nguide+1) alpha indices for each beta row,
+        //indicating where in the row of cumulative alpha integrals the values
+        //k*(total/nguide), k=0..nguide, are exceeded:
+        std::shared_ptr<const SABSamplerAtE_Alg1::CommonCache> base;
+        std::size_t nguide;
+        std::vector<uint16_t> alphaguides;
+        CommonCache( std::shared_ptr<const SABSamplerAtE_Alg1::CommonCache> );
+        std::size_t memoryFootprint() const;
+      };
+
+      SABSamplerAtE_Alias( std::shared_ptr<const CommonCache>,
+                           VectD&& betaVals,
+                           VectD&& betaWeights,
+                           std::vector<AlphaSampleInfo>&&,
+                           std::size_t ibetaOffset );
+
+    private:
+      //Sample beta bin and value (in that bin) from P(beta|Ei):
+      std::pair<double,unsigned> sampleBetaWithIndex(RNG&) const;
+
+      //Data (in arena: nbeta beta values and weights, nbeta-1 alias
+      //probabilities, alias indices and AlphaSampleInfo objects):
       std::shared_ptr<const CommonCache> m_common;
-      PointwiseDist m_betaSampler;
-      std::vector<AlphaSampleInfo> m_alphaSamplerInfos;
+      std::size_t m_nbeta;
       std::size_t m_ibetaOffset;
     };
 
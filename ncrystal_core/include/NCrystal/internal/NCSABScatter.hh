@@ -22,6 +22,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "NCrystal/NCProcImpl.hh"
+#include "NCrystal/internal/NCSABSampler.hh"
 
 namespace NCrystal {
 
@@ -49,11 +50,15 @@ namespace NCrystal {
     //
     //The vdoslux parameter has no effect if input is not a VDOS. The same goes
     //for the special vdos2sabExcludeFlag parameter (the meaning of which is
-    //documented in NCDynInfoUtils.hh).
+    //documented in NCDynInfoUtils.hh). The samplerAlg parameter selects the
+    //sampling implementation (see NCSABSampler.hh), and egridDensity the
+    //density of the energy grid (see SAB::applyEGridDensity).
     SABScatter( const DI_ScatKnl&,
                 unsigned vdoslux = 3,
                 bool useCache = true,
-                uint32_t vdos2sabExcludeFlag = 0 );
+                uint32_t vdos2sabExcludeFlag = 0,
+                SAB::SamplerAlg samplerAlg = SAB::SamplerAlg::Alg1,
+                SAB::EGridDensity egridDensity = SAB::EGridDensity::Default );
     SABScatter( SABData &&,
                 const VectD& energyGrid = VectD() );
     SABScatter( shared_obj<const SABData>,
@@ -62,18 +67,68 @@ namespace NCrystal {
     explicit SABScatter( std::unique_ptr<const SAB::SABScatterHelper> );
     SABScatter( SAB::SABScatterHelper&& );
 
+    //Deferred construction: the scatter helper (and thus any expansion of a
+    //VDOS into a scattering kernel) is only created by invoking the producer
+    //upon the first call to a cross section or sampling method. If
+    //backgroundWarmup is set, the creation is additionally queued as a
+    //background task (see queueBackgroundTask in NCThreadUtils.hh), so it is
+    //usually ready before it is needed. Errors in the producer surface at
+    //first use. The producer must keep any objects it refers to alive, and
+    //is released once it succeeded:
+    using HelperProducer = std::function<shared_obj<const SAB::SABScatterHelper>()>;
+    SABScatter( HelperProducer, bool backgroundWarmup = false );
+
+    //The scatter helper which the DI_ScatKnl constructor uses:
+    static shared_obj<const SAB::SABScatterHelper> createHelper( const DI_ScatKnl&,
+                                                                 unsigned vdoslux = 3,
+                                                                 bool useCache = true,
+                                                                 uint32_t vdos2sabExcludeFlag = 0,
+                                                                 SAB::SamplerAlg samplerAlg = SAB::SamplerAlg::Alg1,
+                                                                 SAB::EGridDensity egridDensity = SAB::EGridDensity::Default );
+
+    //Whether or not the scatter helper has been created:
+    bool isInitialised() const noexcept { return m_sh.load( std::memory_order_acquire ) != nullptr; }
+
     virtual ~SABScatter();
 
     CrossSect crossSectionIsotropic(CachePtr&, NeutronEnergy ) const final;
+    void crossSectionIsotropicMany( CachePtr&, const double* ekin,
+                                    std::size_t N, double* out_xs ) const final;
     ScatterOutcomeIsotropic sampleScatterIsotropic(CachePtr&, RNG&, NeutronEnergy ) const final;
+    void sampleScatterIsotropicMany( CachePtr&, RNG&, const double* ekin,
+                                     std::size_t N, ScatterOutcomeIsotropic* out ) const final;
+    unsigned capabilities() const noexcept final { return CapBatchCrossSection | CapBatchSampling | CapStateless; }
+
+    //Creates the scatter helper, and for WarmupLevel::Complete also all lazily
+    //created samplers in the energy range (in parallel):
+    void warmup( EnergyDomain, WarmupLevel = WarmupLevel::Essential ) const override;
+
+    std::size_t memoryFootprint() const override;
 
   protected:
     Optional<std::string> specificJSONDescription() const override;
     struct Impl;
     Pimpl<Impl> m_impl;
-    const SAB::SABScatterHelper * m_sh;
+    mutable std::atomic<const SAB::SABScatterHelper *> m_sh;
+    const SAB::SABScatterHelper& helper() const;
+    const SAB::SABScatterHelper& initHelper() const;
   };
 
 }
 
+
+////////////////////////////
+// Inline implementations //
+////////////////////////////
+
+namespace NCrystal {
+
+  inline const SAB::SABScatterHelper& SABScatter::helper() const
+  {
+    auto sh = m_sh.load( std::memory_order_acquire );
+    return sh ? *sh : initHelper();
+  }
+
+}
+
 #endif
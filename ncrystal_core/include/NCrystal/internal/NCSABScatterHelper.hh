@@ -41,17 +41,44 @@ namespace NCrystal {
                         SABSampler&&sp,
                         Optional<std::string> json = NullOpt )
         : xsprovider(std::move(xp)),
-          sampler(std::move(sp)),
-          specificJSONDescription(std::move(json))
+          specificJSONDescription(std::move(json)),
+          m_sampler(std::make_shared<const SABSampler>(std::move(sp)))
       {
       }
+
+      //The sampler can also be shared with other helpers. This is used for
+      //kernels which only differ in their overall cross section scale, since
+      //the sampling is independent of that scale:
+      SABScatterHelper( SABXSProvider&& xp,
+                        std::shared_ptr<const SABSampler> sp,
+                        Optional<std::string> json = NullOpt )
+        : xsprovider(std::move(xp)),
+          specificJSONDescription(std::move(json)),
+          m_sampler(std::move(sp))
+      {
+        nc_assert_always(m_sampler!=nullptr);
+      }
+
       SABScatterHelper() = default;//incomplete
       SABScatterHelper( SABScatterHelper&& ) = default;
       SABScatterHelper& operator=( SABScatterHelper&& ) = default;
       SABXSProvider xsprovider;
-      SABSampler sampler;
       Optional<std::string> specificJSONDescription;
 
+      const SABSampler& sampler() const { nc_assert(m_sampler!=nullptr); return *m_sampler; }
+      const std::shared_ptr<const SABSampler>& sharedSampler() const { return m_sampler; }
+
+      //Approximate memory footprint in bytes (a shared sampler is included in
+      //the footprint of all helpers using it):
+      std::size_t memoryFootprint() const
+      {
+        return sizeof(SABScatterHelper) + xsprovider.memoryFootprint()
+          + ( m_sampler ? m_sampler->memoryFootprint() : 0 )
+          + ( specificJSONDescription.has_value() ? specificJSONDescription.value().size() : 0 );
+      }
+
+    private:
+      std::shared_ptr<const SABSampler> m_sampler;
     };
 
   }
@@ -0,0 +1,98 @@
+#ifndef NCrystal_SABTempGridScatter_hh
+#define NCrystal_SABTempGridScatter_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/internal/NCSABScatterHelper.hh"
+
+namespace NCrystal {
+
+  class VDOSData;
+  class MatCfg;
+
+  class SABTempGridScatter final : private MoveOnly {
+  public:
+
+    //Provides cross sections and scatterings based on S(alpha,beta) kernels
+    //which are available at a grid of temperatures, for a material whose
+    //temperature is specified in each call (anywhere within the range of the
+    //grid). This allows for instance coupled thermal simulations to use a
+    //continuum of temperatures, without having to initialise a separate
+    //material for each distinct temperature value.
+    //
+    //At each temperature, the material might consist of several components
+    //(e.g. one kernel per element), weighted by their fractions. Cross
+    //sections are linearly interpolated in temperature between the two
+    //bracketing grid points. Scatterings are sampled from one of the kernels
+    //at those two grid points, selected randomly with probabilities
+    //proportional to their contribution to the interpolated cross section. The
+    //sampled distributions are thus consistent with the interpolated cross
+    //sections.
+    //
+    //Temperatures outside the range of the grid result in BadInput exceptions.
+
+    using Component = std::pair<double,shared_obj<const SAB::SABScatterHelper>>;//(fraction,kernel)
+    using Entry = std::pair<Temperature,std::vector<Component>>;
+    SABTempGridScatter( std::vector<Entry> );
+
+    //Construct from material configuration, which is loaded at each of the
+    //requested temperatures (ignoring any temperature in the cfg) via the
+    //usual factories and caches. All dynamic information entries of the
+    //material must be scattering kernels or VDOS curves (sterile entries are
+    //ignored), and the kernels are created with the vdoslux, sablux and
+    //sampling algorithm settings of the cfg:
+    static SABTempGridScatter createFromCfg( const MatCfg&,
+                                             const std::vector<Temperature>& );
+
+    //Construct directly from a VDOS (the temperature of the VDOSData object
+    //itself is ignored), expanding it at each of the requested temperatures
+    //(see createScatteringKernels in NCVDOSToScatKnl.hh):
+    static SABTempGridScatter createFromVDOS( const VDOSData&,
+                                              const std::vector<Temperature>&,
+                                              unsigned vdoslux = 3,
+                                              SAB::SamplerAlg = SAB::SamplerAlg::Alg1 );
+
+    std::size_t nTemperatures() const { return m_temps.size(); }
+    Temperature temperatureMin() const { return Temperature{ m_temps.front() }; }
+    Temperature temperatureMax() const { return Temperature{ m_temps.back() }; }
+
+    CrossSect crossSection( NeutronEnergy, Temperature ) const;
+    ScatterOutcomeIsotropic sampleScatter( RNG&, NeutronEnergy, Temperature ) const;
+
+    //Batched versions, for N (ekin,temperature) pairs. The ekin, temperature
+    //and out arrays must all hold N entries:
+    void crossSectionMany( const double* ekin, const double* temperature,
+                           std::size_t N, double* out_xs ) const;
+    void sampleScatterMany( RNG&, const double* ekin, const double* temperature,
+                            std::size_t N, ScatterOutcomeIsotropic* out ) const;
+
+  private:
+    VectD m_temps;
+    std::vector<std::vector<Component>> m_components;//indexed by temperature
+    struct Bracket { std::size_t idx; double w; };
+    Bracket findBracket( double temperature ) const;
+    double crossSectionAt( std::size_t itemp, NeutronEnergy ) const;
+    ScatterOutcomeIsotropic sampleImpl( RNG&, double ekin, double temperature ) const;
+  };
+
+}
+
+#endif
@@ -23,6 +23,7 @@
 
 #include "NCrystal/NCDefs.hh"
 #include "NCrystal/internal/NCSABExtender.hh"
+#include "NCrystal/internal/NCGridIndex.hh"
 
 namespace NCrystal {
 
@@ -36,6 +37,14 @@ namespace NCrystal {
     ~SABXSProvider();
     CrossSect crossSection(NeutronEnergy) const;
 
+    //Evaluate N cross sections at once. Monotonic (increasing or decreasing)
+    //input energies are handled by stepping through the energy grid along
+    //with the input, rather than by a new lookup for each energy:
+    void crossSectionMany( const double* ekin, std::size_t N, double* out_xs ) const;
+
+    //Approximate memory footprint in bytes:
+    std::size_t memoryFootprint() const;
+
     //Move ok:
     SABXSProvider( SABXSProvider&& ) = default;
     SABXSProvider& operator=( SABXSProvider&& ) = default;
@@ -45,8 +54,10 @@ namespace NCrystal {
     const VectD & internalXSGrid() const { return m_xs; }
   private:
     VectD m_egrid, m_xs;
+    GridIndex m_egridIndex;
     std::shared_ptr<const SAB::SABExtender> m_extender;
     double m_kExtension;
+    double crossSectionAtIdx( double ekin, std::size_t iupper ) const;
   };
 
 }
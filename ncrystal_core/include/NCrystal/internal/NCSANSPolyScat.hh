@@ -0,0 +1,126 @@
+#ifndef NCrystal_SANSPolyScat_hh
+#define NCrystal_SANSPolyScat_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCProcImpl.hh"
+#include "NCrystal/internal/NCSANSUtils.hh"
+#include "NCrystal/internal/NCIofQHelper.hh"
+
+namespace NCrystal {
+
+  struct SANSParticleModel {
+    //Description of a population of dilute nano particles (again assuming no
+    //particle-particle interactions, i.e. S(Q)=1). All lengths are in
+    //Angstrom. Defined outside SANSPolydisperseScatter due to
+    //https://stackoverflow.com/questions/17430377/.
+
+    enum class Shape {
+      Sphere,           //Homogeneous spheres of the given radius.
+      CoreShellSphere,  //Spheres of the given (core) radius, with a shell of
+                        //thickness shell_thickness. The SLD contrast of the
+                        //SANSScaleFactor is that of the shell, and the core
+                        //has a contrast of core_contrast_ratio times that.
+      Cylinder          //Randomly oriented cylinders of the given radius and
+                        //length.
+    };
+    enum class SizeDist {
+      Monodisperse,     //All particles have the given radius.
+      LogNormal,        //log(radius) is normally distributed, with the given
+                        //radius as median and a standard deviation of width.
+      Schulz            //Schulz distribution with the given radius as mean and
+                        //width as relative standard deviation (in (0,1)).
+    };
+
+    Shape shape = Shape::Sphere;
+    SizeDist sizeDist = SizeDist::Monodisperse;
+    double radius = 0.0;
+    double width = 0.0;//ignored for monodisperse distributions
+    double length = 0.0;//cylinders only
+    double shell_thickness = 0.0;//core-shell spheres only
+    double core_contrast_ratio = 0.0;//core-shell spheres only
+
+    //Throws BadInput in case of invalid parameters:
+    void validate() const;
+
+    bool operator==( const SANSParticleModel& ) const;
+  };
+
+  struct SANSPolydisperseCfg {
+    //Discretisation used when integrating the effective I(Q) at construction:
+    unsigned nQ = 2000;//log-spaced Q points
+    unsigned nRadii = 65;//points in the size distribution (polydisperse only)
+  };
+
+  class SANSPolydisperseScatter final : public ProcImpl::ScatterIsotropicMat {
+  public:
+
+    // SANS model for one or more populations of nano particles (also see
+    // NCSANSUtils.hh). For each, the effective form factor:
+    //
+    //   Vp*P(Q) -> <Vp^2*P(Q)>/<Vp>
+    //
+    // with averages over the number distribution of particle sizes, is
+    // integrated once at construction. The sum over all populations (including
+    // their C_sans scale factors) is then kept in an IofQHelper, so cross
+    // sections and samplings only involve table lookups. Compared to
+    // composing many SANSSphereScatter instances, a single instance of this
+    // class can thus describe any number of populations.
+    //
+    // For monodisperse spheres, results agree with those of SANSSphereScatter
+    // up to the discretisation of the I(Q) table.
+
+    const char * name() const noexcept final { return "SANSPolydisperseScatter"; }
+
+    using Population = std::pair<SANSScaleFactor,SANSParticleModel>;
+    using PopulationList = std::vector<Population>;
+
+    SANSPolydisperseScatter( SANSScaleFactor C_sans, const SANSParticleModel&,
+                             const SANSPolydisperseCfg& = SANSPolydisperseCfg() );
+    SANSPolydisperseScatter( PopulationList, const SANSPolydisperseCfg& = SANSPolydisperseCfg() );
+
+    const PopulationList& populations() const noexcept { return m_populations; }
+
+    CrossSect crossSectionIsotropic(CachePtr&, NeutronEnergy ) const final;
+    ScatterOutcomeIsotropic sampleScatterIsotropic(CachePtr&, RNG&, NeutronEnergy ) const final;
+    unsigned capabilities() const noexcept final { return CapStateless; }
+
+    //Merge by combining the lists of populations (populations with identical
+    //particle models are combined, and the table is integrated anew):
+    std::shared_ptr<Process> createMerged( const Process& other,
+                                           double scale_self,
+                                           double scale_other ) const override;
+
+  protected:
+    Optional<std::string> specificJSONDescription() const override;
+  private:
+    PopulationList m_populations;
+    SANSPolydisperseCfg m_cfg;
+    double m_qmin;//first Q value in table
+    double m_iofqmin;//effective I(Q) at m_qmin
+    IofQHelper m_iofq;
+    struct Table;
+    SANSPolydisperseScatter( PopulationList, const SANSPolydisperseCfg&, Table&& );
+  };
+
+}
+
+#endif
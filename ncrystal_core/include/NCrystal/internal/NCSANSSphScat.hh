@@ -53,6 +53,7 @@ namespace NCrystal {
 
     CrossSect crossSectionIsotropic(CachePtr&, NeutronEnergy ) const final;
     ScatterOutcomeIsotropic sampleScatterIsotropic(CachePtr&, RNG&, NeutronEnergy ) const final;
+    unsigned capabilities() const noexcept final { return CapStateless; }
 
     //Simple additive merge:
     std::shared_ptr<Process> createMerged( const Process& other,
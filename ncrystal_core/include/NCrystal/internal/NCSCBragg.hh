@@ -29,7 +29,7 @@ namespace NCrystal {
 
   class PlaneProvider;
 
-  class SCBragg final : public ProcImpl::ScatterAnisotropicMat {
+  class NCRYSTAL_API SCBragg final : public ProcImpl::ScatterAnisotropicMat {
   public:
 
     //Calculates Bragg diffraction in a single crystals with given orientation
@@ -43,13 +43,15 @@ namespace NCrystal {
     //initialisation in the constructor, and the SCBragg instance will *not*
     //assume ownership of it.
     //
-    //For a description of the prec and ntrunc parameters, see NCGaussMos.hh.
+    //For a description of the prec, ntrunc and screening parameters, see
+    //NCGaussMos.hh.
     SCBragg( const Info&,
              const SCOrientation&,
              MosaicityFWHM,
              double delta_d = 0,
              PlaneProvider * plane_provider = nullptr,
-             double prec = 1e-3, double ntrunc = 0.0 );
+             double prec = 1e-3, double ntrunc = 0.0,
+             double screening = 0.0 );
 
     const char * name() const noexcept final { return "SCBragg"; }
 
@@ -61,6 +63,60 @@ namespace NCrystal {
 
     CrossSect crossSection(CachePtr&, NeutronEnergy, const NeutronDirection& ) const final;
     ScatterOutcome sampleScatter(CachePtr&, RNG&, NeutronEnergy, const NeutronDirection& ) const final;
+    void sampleScatterRepeated( CachePtr&, RNG&, NeutronEnergy, const NeutronDirection&,
+                                std::size_t N, ScatterOutcome* out ) const final;
+
+    std::size_t memoryFootprint() const override;
+
+    //Fraction of the orientation-averaged Bragg cross section discarded by the
+    //plane provider (e.g. when pruning weak reflections with scprune):
+    double discardedFraction() const;
+
+    //Biased sampling for applications where only neutrons scattered into a
+    //cone (e.g. towards a small detector) are of interest. Only reflections
+    //which can scatter neutrons into the cone are sampled (still
+    //proportionally to their contributions), and the returned weight is the
+    //fraction of the cross section contributed by them, by which the
+    //statistical weight of the neutron must be multiplied. The weight is 0
+    //(and the outcome, which is then an unscattered neutron, should be
+    //discarded) if no such reflections exist, or if the sampled direction
+    //ended up outside the cone. Reflections are selected using the mosaicity
+    //truncation angle, so results are unbiased:
+    std::pair<ScatterOutcome,double> sampleScatterInCone( CachePtr&, RNG&, NeutronEnergy,
+                                                          const NeutronDirection& indir,
+                                                          const NeutronDirection& conedir,
+                                                          double halfangle ) const;
+
+    //Optional preparation for crystals which only see neutrons with
+    //directions inside a narrow cone (e.g. monochromator or analyser crystals
+    //in a beam), and optionally a limited range of energies. The planes which
+    //can possibly satisfy the Bragg condition for such neutrons are then
+    //found once and for all, so cache updates for neutrons inside the cone
+    //and energy range will only have to consider those planes. Results are
+    //not affected in any way, and neutrons outside the cone or energy range
+    //are simply treated as usual. This must be called before the object is
+    //used (it is not thread-safe), and has no effect for crystals using the
+    //compact representation of planes, or when the cone is so wide that most
+    //planes are candidates anyway. Calling it again replaces the previous
+    //cone:
+    void prepareForDirectionCone( const NeutronDirection& dir, double halfangle,
+                                  NeutronEnergy emin = NeutronEnergy{0.0},
+                                  NeutronEnergy emax = NeutronEnergy{kInfinity} );
+
+    //Opt-in memoisation of cross sections, for applications with many queries
+    //at nearly identical neutron states (e.g. transmission calculations for
+    //quasi-parallel beams). Cross sections are then evaluated at the centres
+    //of cells in (log(wavelength),direction) space, with the given width in
+    //log(wavelength) and in each of the components of the (normalised)
+    //direction, and kept in a per-thread table with at most maxEntries
+    //entries (cleared when full). Thus, cross sections become approximate,
+    //and the tolerance should be well below the mosaicity (in radians) and
+    //the relative d-spacing spread. Scattering sampling is not affected. A
+    //tolerance of 0 disables the memoisation, and the default is taken from
+    //the NCRYSTAL_SCBRAGG_XSMEMO_TOL environment variable (similarly
+    //NCRYSTAL_SCBRAGG_XSMEMO_SIZE for maxEntries). This must be called
+    //before the object is used (it is not thread-safe):
+    void enableCrossSectionMemoisation( double tolerance, unsigned maxEntries = 4096 );
 
   protected:
     Optional<std::string> specificJSONDescription() const override;
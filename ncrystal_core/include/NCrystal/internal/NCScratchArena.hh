@@ -0,0 +1,132 @@
+#ifndef NCrystal_ScratchArena_hh
+#define NCrystal_ScratchArena_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCDefs.hh"
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace NCrystal {
+
+  class ScratchArena : private NoCopyMove {
+  public:
+
+    //Bump allocator for temporary buffers needed while carrying out a
+    //calculation (e.g. sampling a scattering). Arenas are intended to be
+    //placed in the cache objects of processes, which are never shared between
+    //threads, so no locking is needed. Memory is taken from chunks which are
+    //kept when the arena is reset, and if more than one chunk was needed they
+    //are merged into one upon reset. Thus, once the arena has grown to the
+    //size needed by the largest calculation, no further heap allocations take
+    //place. Objects in the arena must be trivially destructible (destructors
+    //are never called), and must not be used after the arena was reset.
+
+    ScratchArena() = default;
+
+    //Allocate room for n default-initialised objects of type T:
+    template<class T>
+    T* allocate( std::size_t n );
+
+    //Release all objects at once (keeping the memory for later use):
+    void reset();
+
+    //Total size of the chunks:
+    std::size_t capacity() const noexcept { return m_ntotblocks * blocksize; }
+
+    //Reset the arena when going out of scope:
+    class Scope : private NoCopyMove {
+      ScratchArena& m_arena;
+    public:
+      Scope( ScratchArena& a ) : m_arena(a) {}
+      ~Scope() { m_arena.reset(); }
+    };
+
+  private:
+    static constexpr std::size_t blocksize = sizeof(std::max_align_t);
+    static constexpr std::size_t minChunkBlocks = 4096 / blocksize;
+    struct Chunk {
+      std::unique_ptr<std::max_align_t[]> data;
+      std::size_t nblocks;
+    };
+    std::vector<Chunk> m_chunks;
+    std::size_t m_ichunk = 0;
+    std::size_t m_used = 0;//blocks used in m_chunks[m_ichunk]
+    std::size_t m_ntotblocks = 0;
+    void * allocateBytes( std::size_t );
+  };
+
+}
+
+
+////////////////////////////
+// Inline implementations //
+////////////////////////////
+
+namespace NCrystal {
+
+  template<class T>
+  inline T* ScratchArena::allocate( std::size_t n )
+  {
+    static_assert( std::is_trivially_destructible<T>::value, "ScratchArena objects must be trivially destructible" );
+    static_assert( alignof(T) <= alignof(std::max_align_t), "ScratchArena does not support over-aligned types" );
+    T * p = static_cast<T*>( allocateBytes( n * sizeof(T) ) );
+    for ( std::size_t i = 0; i < n; ++i )
+      ::new(static_cast<void*>(p+i)) T;
+    return p;
+  }
+
+  inline void * ScratchArena::allocateBytes( std::size_t nbytes )
+  {
+    const std::size_t nb = std::max<std::size_t>( 1, ( nbytes + blocksize - 1 ) / blocksize );
+    for ( ; m_ichunk < m_chunks.size(); ++m_ichunk, m_used = 0 ) {
+      Chunk& c = m_chunks[m_ichunk];
+      if ( nb <= c.nblocks - m_used ) {
+        void * p = c.data.get() + m_used;
+        m_used += nb;
+        return p;
+      }
+    }
+    //Need a new chunk (at least doubling the capacity):
+    const std::size_t nbnew = std::max( nb, std::max( minChunkBlocks, m_ntotblocks ) );
+    m_chunks.push_back( Chunk{ std::unique_ptr<std::max_align_t[]>( new std::max_align_t[nbnew] ), nbnew } );
+    m_ntotblocks += nbnew;
+    m_ichunk = m_chunks.size() - 1;
+    m_used = nb;
+    return m_chunks.back().data.get();
+  }
+
+  inline void ScratchArena::reset()
+  {
+    if ( m_chunks.size() > 1 ) {
+      //Replace with a single chunk with room for everything:
+      m_chunks.clear();
+      m_chunks.push_back( Chunk{ std::unique_ptr<std::max_align_t[]>( new std::max_align_t[m_ntotblocks] ), m_ntotblocks } );
+    }
+    m_ichunk = 0;
+    m_used = 0;
+  }
+
+}
+
+#endif
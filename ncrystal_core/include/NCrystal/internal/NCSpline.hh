@@ -26,28 +26,52 @@
 
 namespace NCrystal {
 
-  class CubicSpline {
+  //Cubic splines and splined lookup tables. The spline data (function values
+  //and second derivatives at the grid points) is kept in two separate arrays
+  //(rather than as an array of pairs), and batched evaluation is provided via
+  //the evalMany methods, which simply loop over the points in a manner which
+  //compilers can vectorise.
+  //
+  //The data can be stored as either double or float precision values, the
+  //latter halving the memory footprint (and cache pressure) of large tables
+  //whose accuracy requirements allows it (float has a relative precision of
+  //~6e-8). Spline coefficients are always calculated, and evaluations always
+  //carried out, in double precision.
+
+  template<class TValue>
+  class SplinedLookupTableT;
+
+  template<class TValue>
+  class CubicSplineT {
   public:
-    CubicSpline();//default constructed instance is invalid until ::set() is called.
-    CubicSpline( const VectD& y,
-                 double derivative_y_left = 0.0,
-                 double derivative_y_right = 0.0 );
-    ~CubicSpline();
+    CubicSplineT();//default constructed instance is invalid until ::set() is called.
+    CubicSplineT( const VectD& y,
+                  double derivative_y_left = 0.0,
+                  double derivative_y_right = 0.0 );
+    ~CubicSplineT();
     void set( const VectD& y,
               double derivative_y_left = 0.0,
               double derivative_y_right = 0.0 );
     double evalWithAssert(double x) const;
     double evalUnbounded(double x) const;
-    void swap(CubicSpline&o);
+    //Batched evalWithAssert (all x values must be in [0,npoints-1]):
+    void evalMany( const double * x, std::size_t n, double * out ) const;
+    void swap(CubicSplineT&o);
+    std::size_t memoryFootprint() const;
   private:
-    friend class SplinedLookupTable;
+    friend class SplinedLookupTableT<TValue>;
     std::size_t m_nm2;
-    std::vector<PairDD > m_data;
+    std::vector<TValue> m_y;
+    std::vector<TValue> m_y2;
   };
 
-  class SplinedLookupTable {
+  using CubicSpline = CubicSplineT<double>;
+  using CubicSplineF = CubicSplineT<float>;
+
+  template<class TValue>
+  class SplinedLookupTableT {
   public:
-    SplinedLookupTable();//default constructed instance is invalid until ::set() is called.
+    SplinedLookupTableT();//default constructed instance is invalid until ::set() is called.
 
     //Setup splined lookuptable. The parameters name and description are
     //optional, and will only be used if the environment variable
@@ -55,24 +79,27 @@ namespace NCrystal {
     //about the spline will be created (supposedly for later inspection by
     //NCrystal developers). Avoid spaces and special characters in name.
 
-    SplinedLookupTable( const VectD& fvals,double a,double b,double fprime_a, double fprime_b,
-                        const std::string& name="", const std::string& description="" );
-    SplinedLookupTable( const Fct1D* thefct,double a,double b,double fprime_a, double fprime_b,unsigned npts = 1000,
-                        const std::string& name="", const std::string& description="" );
-    ~SplinedLookupTable();
+    SplinedLookupTableT( const VectD& fvals,double a,double b,double fprime_a, double fprime_b,
+                         const std::string& name="", const std::string& description="" );
+    SplinedLookupTableT( const Fct1D* thefct,double a,double b,double fprime_a, double fprime_b,unsigned npts = 1000,
+                         const std::string& name="", const std::string& description="" );
+    ~SplinedLookupTableT();
     void set( const VectD& fvals,double a,double b,double fprime_a, double fprime_b,
               const std::string& name="", const std::string& description="" );
     void set( const Fct1D* thefct,double a,double b,double fprime_a, double fprime_b,unsigned npts = 1000,
               const std::string& name="", const std::string& description="" );
     double eval(double x) const;//<-- query the resulting lookup table
-    void swap(SplinedLookupTable&o);
+    //Batched eval (x values outside [getLower(),getUpper()] are clamped to it):
+    void evalMany( const double * x, std::size_t n, double * out ) const;
+    void swap(SplinedLookupTableT&o);
     double getLower() const { return m_a; }
     double getUpper() const { return m_b; }
     double getInvDelta() const { return m_invdelta; }
+    std::size_t memoryFootprint() const { return sizeof(*this) - sizeof(m_spline) + m_spline.memoryFootprint(); }
   private:
     double m_a;
     double m_invdelta;
-    CubicSpline m_spline;
+    CubicSplineT<TValue> m_spline;
     double m_b;//only used in getUpper
     void producefile( const Fct1D* thefct,
                       double fprime_a, double fprime_b,
@@ -80,6 +107,9 @@ namespace NCrystal {
 
   };
 
+  using SplinedLookupTable = SplinedLookupTableT<double>;
+  using SplinedLookupTableF = SplinedLookupTableT<float>;
+
 }
 
 
@@ -87,63 +117,111 @@ namespace NCrystal {
 // Inline implementations //
 ////////////////////////////
 
-inline NCrystal::CubicSpline::CubicSpline() : m_nm2(0) {}
-inline NCrystal::CubicSpline::CubicSpline( const VectD& y, double ypa, double ypb ) { set(y,ypa,ypb); }
-inline NCrystal::CubicSpline::~CubicSpline(){}
-inline double NCrystal::CubicSpline::evalWithAssert(double x) const {
+template<class TValue>
+inline NCrystal::CubicSplineT<TValue>::CubicSplineT() : m_nm2(0) {}
+template<class TValue>
+inline NCrystal::CubicSplineT<TValue>::CubicSplineT( const VectD& y, double ypa, double ypb ) { set(y,ypa,ypb); }
+template<class TValue>
+inline NCrystal::CubicSplineT<TValue>::~CubicSplineT(){}
+template<class TValue>
+inline double NCrystal::CubicSplineT<TValue>::evalWithAssert(double x) const {
   nc_assert(x>=0.0&&x<=m_nm2+1);
   return evalUnbounded(x);
 }
-inline double NCrystal::CubicSpline::evalUnbounded(double x) const {
+template<class TValue>
+inline double NCrystal::CubicSplineT<TValue>::evalUnbounded(double x) const {
   nc_assert(m_nm2>0);//will fail if default constructed and set() was never called
   std::size_t idx = ncmin(static_cast<std::size_t>(x),m_nm2);
   double b = x-idx;//fraction inside bin
   double a = 1.0-b;
-  nc_assert(idx+1<m_data.size());
-  std::vector<PairDD >::const_iterator it = m_data.begin()+idx;
-  double tmp = a * (it->first);
-  double tmp2 = (a*a*a-a) * (it->second);
-  ++it;
-  tmp += b*(it->first);
-  tmp2 += (b*b*b-b) * (it->second);
+  nc_assert(idx+1<m_y.size());
+  const TValue * y = m_y.data() + idx;
+  const TValue * y2 = m_y2.data() + idx;
+  double tmp = a * y[0] + b * y[1];
+  double tmp2 = (a*a*a-a) * y2[0] + (b*b*b-b) * y2[1];
   return tmp + 0.166666666666666666666666666666666666666666666666666667 * tmp2;
 }
 
+template<class TValue>
+inline void NCrystal::CubicSplineT<TValue>::evalMany( const double * x, std::size_t n, double * out ) const {
+  nc_assert(m_nm2>0);
+  const TValue * y = m_y.data();
+  const TValue * y2 = m_y2.data();
+  const double xmax = static_cast<double>(m_nm2);
+  for ( std::size_t i = 0; i < n; ++i ) {
+    nc_assert(x[i]>=0.0&&x[i]<=m_nm2+1);
+    //Clamp before converting to a (signed) integer, which unlike ncmin on
+    //unsigned integers is friendly to vectorisation:
+    const std::size_t idx = static_cast<std::size_t>( static_cast<std::int64_t>( x[i] < xmax ? x[i] : xmax ) );
+    const double b = x[i]-idx;
+    const double a = 1.0-b;
+    const double tmp = a * y[idx] + b * y[idx+1];
+    const double tmp2 = (a*a*a-a) * y2[idx] + (b*b*b-b) * y2[idx+1];
+    out[i] = tmp + 0.166666666666666666666666666666666666666666666666666667 * tmp2;
+  }
+}
 
-inline NCrystal::SplinedLookupTable::SplinedLookupTable() : m_a(0), m_invdelta(0), m_b(0) {}
-inline NCrystal::SplinedLookupTable::SplinedLookupTable( const VectD& fvals,
-                                                         double a,double b,
-                                                         double fprime_a, double fprime_b,
-                                                         const std::string& name,
-                                                         const std::string& desc )
+template<class TValue>
+inline std::size_t NCrystal::CubicSplineT<TValue>::memoryFootprint() const {
+  return sizeof(*this) + ( m_y.capacity() + m_y2.capacity() ) * sizeof(TValue);
+}
+
+template<class TValue>
+inline NCrystal::SplinedLookupTableT<TValue>::SplinedLookupTableT() : m_a(0), m_invdelta(0), m_b(0) {}
+template<class TValue>
+inline NCrystal::SplinedLookupTableT<TValue>::SplinedLookupTableT( const VectD& fvals,
+                                                                   double a,double b,
+                                                                   double fprime_a, double fprime_b,
+                                                                   const std::string& name,
+                                                                   const std::string& desc )
 {
   set(fvals,a,b,fprime_a,fprime_b,name,desc);
 }
-inline NCrystal::SplinedLookupTable::~SplinedLookupTable(){}
-inline NCrystal::SplinedLookupTable::SplinedLookupTable( const Fct1D* thefct,
-                                                         double a,double b,
-                                                         double fprime_a, double fprime_b,
-                                                         unsigned npts,
-                                                         const std::string& name,
-                                                         const std::string& desc )
+template<class TValue>
+inline NCrystal::SplinedLookupTableT<TValue>::~SplinedLookupTableT(){}
+template<class TValue>
+inline NCrystal::SplinedLookupTableT<TValue>::SplinedLookupTableT( const Fct1D* thefct,
+                                                                   double a,double b,
+                                                                   double fprime_a, double fprime_b,
+                                                                   unsigned npts,
+                                                                   const std::string& name,
+                                                                   const std::string& desc )
 {
   set(thefct,a,b,fprime_a,fprime_b,npts,name,desc);
 }
 
-inline double NCrystal::SplinedLookupTable::eval(double x) const {
+template<class TValue>
+inline double NCrystal::SplinedLookupTableT<TValue>::eval(double x) const {
   return m_spline.evalUnbounded((x-m_a)*m_invdelta);
 }
 
-inline void NCrystal::SplinedLookupTable::swap(NCrystal::SplinedLookupTable&o) {
+template<class TValue>
+inline void NCrystal::SplinedLookupTableT<TValue>::evalMany( const double * x, std::size_t n, double * out ) const {
+  //Transform in place in the output buffer, so no temporary buffer is needed:
+  const double a = m_a;
+  const double invdelta = m_invdelta;
+  const double umax = m_spline.m_nm2 + 1;
+  for ( std::size_t i = 0; i < n; ++i ) {
+    const double u = (x[i]-a)*invdelta;
+    //Protect against rounding at the edges:
+    out[i] = ( u > 0.0 ? ( u < umax ? u : umax ) : 0.0 );
+  }
+  m_spline.evalMany( out, n, out );
+}
+
+template<class TValue>
+inline void NCrystal::SplinedLookupTableT<TValue>::swap(NCrystal::SplinedLookupTableT<TValue>&o) {
   std::swap(m_a,o.m_a);
   std::swap(m_b,o.m_b);
   std::swap(m_invdelta,o.m_invdelta);
   m_spline.swap(o.m_spline);
 }
 
-inline void NCrystal::CubicSpline::swap(NCrystal::CubicSpline&o) {
+template<class TValue>
+inline void NCrystal::CubicSplineT<TValue>::swap(NCrystal::CubicSplineT<TValue>&o) {
   std::swap(m_nm2,o.m_nm2);
-  std::swap(m_data,o.m_data);
+  std::swap(m_y,o.m_y);
+  std::swap(m_y2,o.m_y2);
 }
 
 #endif
@@ -124,6 +124,10 @@ namespace NCrystal {
   std::string bytes2hexstr(const std::vector<uint8_t>& v);
   std::vector<uint8_t> hexstr2bytes(const std::string& v);
 
+  //Decode base64 strings (standard alphabet of RFC 4648, with optional
+  //padding). Throws BadInput in case of invalid input:
+  std::vector<uint8_t> base64str2bytes(const std::string& v);
+
   //Common access to environment variables - will always be prefixed with
   //NCRYSTAL_. Unset variables means that the default values will be
   //returned. The _dbl/_int versions throws BadInput exceptions in case of
@@ -0,0 +1,136 @@
+#ifndef NCrystal_TabulatedXS_hh
+#define NCrystal_TabulatedXS_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCProcImpl.hh"
+
+namespace NCrystal {
+
+  //Export of the cross sections of isotropic scattering processes to compact
+  //binary files, for fast reuse by codes which only need cross sections
+  //(e.g. deterministic transport codes), and which should not have to pay for
+  //a full initialisation of the materials.
+  //
+  //The processes are split into their (scaled) components, with nested
+  //ProcComposition objects flattened and null processes dropped. The cross
+  //sections of all components are evaluated exactly at the points of a
+  //common energy grid, which is the adaptive grid of
+  //ProcComposition::createTabulated. The 2d-spacings of any PCBragg components
+  //(in energy units, see PCBragg::get2dE) are added to the initial grid,
+  //along with the largest doubles below them, so Bragg edges are represented
+  //as exact steps. Cross sections are linearly interpolated between grid
+  //points. Error bounds are estimated by comparing interpolated and exact
+  //values at several interior points of all grid intervals, and are stored
+  //in the tables.
+  //
+  //The file format is a fixed header of 8-byte fields, followed by the
+  //cfg-string and the null-terminated component names (each padded to a
+  //multiple of 8 bytes), the energy grid [eV], the cross sections [barn] of
+  //each component at the grid points, and the estimated maximal absolute
+  //error [barn] of each component. Numbers are stored in native byte order,
+  //and files written on machines with a different byte order are rejected.
+
+  struct NCRYSTAL_API TabulatedXSData {
+    std::string cfgstr;//for recreating the full process (might be empty)
+    VectD egrid;
+    struct Component {
+      std::string name;//name of the process
+      VectD xs;//cross sections (including scale factors) at egrid points
+      double maxAbsError = 0.0;
+    };
+    std::vector<Component> components;
+    //Requested tolerance, and the estimated max deviation relative to the total
+    //cross section (both are 0 if all components are exactly represented):
+    double tolerance = 0.0;
+    double maxRelError = 0.0;
+
+    //Total cross sections at the egrid points, and the range of the table:
+    VectD totalXS() const;
+    double emin() const { return egrid.empty() ? 0.0 : egrid.front(); }
+    double emax() const { return egrid.empty() ? 0.0 : egrid.back(); }
+  };
+
+  constexpr unsigned tabulatedXSFormatVersion = 1;
+
+  //Tabulate the cross sections of a process (the cfg-string is simply stored
+  //in the result):
+  NCRYSTAL_API TabulatedXSData tabulateXS( ProcImpl::ProcPtr,
+                                           const ProcImpl::ProcCompTabulationCfg& = ProcImpl::ProcCompTabulationCfg(),
+                                           std::string cfgstr = std::string() );
+
+  //Tabulate the scattering cross sections of the material, and write them to
+  //a file:
+  NCRYSTAL_API void exportTabulatedXS( const std::string& cfgstr, const std::string& filename,
+                                       const ProcImpl::ProcCompTabulationCfg& = ProcImpl::ProcCompTabulationCfg() );
+
+  //Read and write files (throwing exceptions on errors):
+  NCRYSTAL_API void writeTabulatedXS( const TabulatedXSData&, const std::string& filename );
+  NCRYSTAL_API TabulatedXSData readTabulatedXS( const std::string& filename );
+
+  class NCRYSTAL_API TabulatedXSProcess final : public ProcImpl::ScatterIsotropicMat {
+  public:
+
+    //Scattering process with cross sections given by the tables. Inside the
+    //tabulated energy range, cross sections are given by a binary search and
+    //a linear interpolation. Scattering sampling, as well as cross sections
+    //outside the tabulated range, are delegated to the full process, which is
+    //created from the cfg-string upon first use (so the data files of the
+    //material will be needed at that point). An exception is thrown in case
+    //the table holds no cfg-string.
+
+    const char * name() const noexcept final { return "TabulatedXSProcess"; }
+
+    TabulatedXSProcess( TabulatedXSData&& );
+    TabulatedXSProcess( TabulatedXSData&&, ProcImpl::ProcPtr fullProcess );
+    ~TabulatedXSProcess();
+
+    const TabulatedXSData& data() const noexcept { return m_data; }
+
+    CrossSect crossSectionIsotropic( CachePtr&, NeutronEnergy ) const final;
+    void crossSectionIsotropicMany( CachePtr&, const double* ekin,
+                                    std::size_t N, double* out_xs ) const final;
+    ScatterOutcomeIsotropic sampleScatterIsotropic( CachePtr&, RNG&, NeutronEnergy ) const final;
+    ScatterOutcome sampleScatter( CachePtr&, RNG&, NeutronEnergy, const NeutronDirection& ) const final;
+    void sampleScatterIsotropicMany( CachePtr&, RNG&, const double* ekin,
+                                     std::size_t N, ScatterOutcomeIsotropic* out ) const final;
+    void sampleScatterMany( CachePtr&, RNG&, const double* ekin, const NeutronDirection* dirs,
+                            std::size_t N, ScatterOutcome* out ) const final;
+    unsigned capabilities() const noexcept final { return CapBatchCrossSection | CapBatchSampling; }
+
+    std::size_t memoryFootprint() const override;
+
+  protected:
+    Optional<std::string> specificJSONDescription() const override;
+  private:
+    TabulatedXSData m_data;
+    VectD m_total;
+    struct Delegate;
+    std::unique_ptr<Delegate> m_delegate;
+    const Process& fullProcess() const;
+  };
+
+  //Convenience function for creating a TabulatedXSProcess from a file:
+  NCRYSTAL_API shared_obj<const TabulatedXSProcess> loadTabulatedXS( const std::string& filename );
+
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef NCrystal_TextDataLines_hh
+#define NCrystal_TextDataLines_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCTextData.hh"
+#include "NCrystal/internal/NCStrView.hh"
+
+namespace NCrystal {
+
+  class TextDataLines {
+  public:
+
+    //Zero-copy alternative to TextData::Iterator, presenting each line as a
+    //StrView pointing directly into the RawStrData of the TextData object
+    //(line endings are excluded, and the views are not null-terminated). The
+    //rules concerning line endings are identical to those of
+    //TextData::Iterator, including the BadInput error upon encountering
+    //pre-OSX Mac line endings.
+    //
+    //The TextDataLines object holds a (cheap) copy of the RawStrData, which
+    //keeps the underlying buffer alive. Thus, the line views remain valid for
+    //as long as either the TextDataLines object or the TextData object is
+    //alive. Usage:
+    //
+    //   for ( auto line : TextDataLines(mytextdata) ) {...}
+
+    explicit TextDataLines( const TextData& td ) : m_data(td.rawData()) {}
+    explicit TextDataLines( RawStrData rd ) : m_data(std::move(rd)) {}
+
+    class Iterator {
+    public:
+      using value_type = StrView;
+      Iterator& operator++();
+      const value_type* operator->() const noexcept { return &m_line; }
+      const value_type& operator*() const noexcept { return m_line; }
+      bool operator==(const Iterator& o) const noexcept { return m_data == o.m_data; }
+      bool operator!=(const Iterator& o) const noexcept { return m_data != o.m_data; }
+      bool operator<(const Iterator& o) const noexcept { return m_data < o.m_data; }
+    private:
+      friend class TextDataLines;
+      Iterator(const char *);
+      struct is_end_t{};
+      Iterator(const char *, is_end_t );
+      void setup();
+      const char * m_data;
+      const char * m_nextData;
+      StrView m_line;
+    };
+
+    Iterator begin() const { return Iterator( m_data.begin() ); }
+    Iterator end() const { return Iterator( m_data.end(), Iterator::is_end_t() ); }
+
+    const RawStrData& rawData() const noexcept { return m_data; }
+
+  private:
+    RawStrData m_data;
+  };
+
+}
+
+
+////////////////////////////
+// Inline implementations //
+////////////////////////////
+
+namespace NCrystal {
+
+  inline TextDataLines::Iterator::Iterator( const char * data, is_end_t )
+    : m_data(data), m_nextData(data), m_line(data,0)
+  {
+  }
+
+  inline TextDataLines::Iterator::Iterator( const char * data )
+    : m_data(data)
+  {
+    setup();
+  }
+
+  inline TextDataLines::Iterator& TextDataLines::Iterator::operator++()
+  {
+    m_data = m_nextData;
+    setup();
+    return *this;
+  }
+
+}
+
+#endif
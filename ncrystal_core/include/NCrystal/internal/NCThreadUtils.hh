@@ -0,0 +1,122 @@
+#ifndef NCrystal_ThreadUtils_hh
+#define NCrystal_ThreadUtils_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCDefs.hh"
+#include <functional>
+#ifndef NCRYSTAL_DISABLE_THREADS
+#  include <thread>
+#  include <exception>
+#endif
+
+namespace NCrystal {
+
+  //Evaluate fct(i) for all i in [0,n), using up to nthreads threads (the
+  //calling thread included). The number of threads is capped at the value of
+  //std::thread::hardware_concurrency(), and if threads can not be started
+  //(e.g. due to resource limits) the remaining work happens in the calling
+  //thread. The work is split into contiguous chunks of indices, so for
+  //deterministic results each call should only write to storage associated
+  //with its own index. If an exception is thrown in any call, the first such
+  //exception is rethrown in the calling thread once all threads have
+  //finished. With nthreads<=1 (or when NCRYSTAL_DISABLE_THREADS is defined),
+  //everything happens in the calling thread. Nested calls (i.e. from inside
+  //fct) also run in the calling thread, to avoid oversubscription:
+  template<class TFct>
+  void parallelForIndex( std::size_t n, unsigned nthreads, TFct&& fct );
+
+  //Queue a task for execution in a global pool of background threads, which
+  //is grown as needed up to maxThreads threads (at least one thread is always
+  //used). Tasks are started in the order in which they are queued, and must
+  //handle any exceptions themselves. Tasks not yet started when the programme
+  //ends are discarded, and running tasks are not waited for (so tasks should
+  //not do anything which must complete). When NCRYSTAL_DISABLE_THREADS is
+  //defined, the task is instead executed immediately in the calling thread:
+  void queueBackgroundTask( std::function<void()> task, unsigned maxThreads );
+
+  namespace detail {
+#ifndef NCRYSTAL_DISABLE_THREADS
+    inline bool& insideParallelForIndex()
+    {
+      static thread_local bool s_inside = false;
+      return s_inside;
+    }
+#endif
+  }
+
+}
+
+
+////////////////////////////
+// Inline implementations //
+////////////////////////////
+
+template<class TFct>
+inline void NCrystal::parallelForIndex( std::size_t n, unsigned nthreads, TFct&& fct )
+{
+#ifndef NCRYSTAL_DISABLE_THREADS
+  const unsigned nthreads_max = std::max<unsigned>( 1, std::thread::hardware_concurrency() );
+  const std::size_t nchunks = std::min<std::size_t>( std::min( nthreads, nthreads_max ), n );
+  if ( nchunks > 1 && !detail::insideParallelForIndex() ) {
+    std::vector<std::exception_ptr> errors( nchunks );
+    auto runChunk = [n,nchunks,&fct,&errors]( std::size_t ichunk )
+    {
+      const std::size_t ibegin = ( n * ichunk ) / nchunks;
+      const std::size_t iend = ( n * ( ichunk + 1 ) ) / nchunks;
+      bool& inside = detail::insideParallelForIndex();
+      const bool inside_orig = inside;
+      inside = true;
+      try {
+        for ( std::size_t i = ibegin; i < iend; ++i )
+          fct( i );
+      } catch (...) {
+        errors[ichunk] = std::current_exception();
+      }
+      inside = inside_orig;
+    };
+    std::vector<std::thread> threads;
+    try {
+      threads.reserve( nchunks - 1 );
+      for ( std::size_t ichunk = 1; ichunk < nchunks; ++ichunk )
+        threads.emplace_back( runChunk, ichunk );
+    } catch (...) {
+      //Could not start all threads, the chunks of the missing ones are handled
+      //below (and the started ones must be joined in any case):
+    }
+    runChunk( 0 );
+    for ( std::size_t ichunk = threads.size() + 1; ichunk < nchunks; ++ichunk )
+      runChunk( ichunk );
+    for ( auto& t : threads )
+      t.join();
+    for ( auto& e : errors )
+      if ( e )
+        std::rethrow_exception( e );
+    return;
+  }
+#else
+  (void)nthreads;
+#endif
+  for ( std::size_t i = 0; i < n; ++i )
+    fct( i );
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef NCrystal_TraceZones_hh
+#define NCrystal_TraceZones_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCTrace.hh"
+#include <atomic>
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Internal helpers for marking zones for the tracing hooks of NCTrace.hh.    //
+// The initialisation stages are marked through InitProfileScope (see         //
+// NCFactoryUtils.hh), while hot code paths are marked with                   //
+// NCRYSTAL_TRACE_SAMPLING_ZONE. The hooks are only invoked when              //
+// NCRYSTAL_ENABLE_TRACING is defined for the library sources (with           //
+// -DENABLE_TRACING=ON), otherwise the macro expands to nothing.              //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+namespace NCrystal {
+
+  namespace Trace {
+
+    namespace detail {
+
+      struct Hooks {
+        BeginZoneFct beginZone;
+        EndZoneFct endZone;
+        void * userdata;
+        bool includeSamplingZones;
+      };
+
+      //Installed hooks are never deleted, so zones can keep using them after
+      //they have been replaced:
+      extern std::atomic<const Hooks*> s_activeHooks;
+      inline const Hooks* activeHooks() noexcept
+      {
+#ifdef NCRYSTAL_ENABLE_TRACING
+        return s_activeHooks.load( std::memory_order_acquire );
+#else
+        return nullptr;
+#endif
+      }
+
+      class SamplingZone : private NoCopyMove {
+      public:
+        SamplingZone( const char * zone ) noexcept
+          : m_zone( zone ), m_hooks( activeHooks() )
+        {
+          if ( m_hooks && !m_hooks->includeSamplingZones )
+            m_hooks = nullptr;
+          if ( m_hooks )
+            m_hooks->beginZone( m_zone, "", m_hooks->userdata );
+        }
+        ~SamplingZone()
+        {
+          if ( m_hooks )
+            m_hooks->endZone( m_zone, m_hooks->userdata );
+        }
+      private:
+        const char * m_zone;
+        const Hooks* m_hooks;
+      };
+
+    }
+  }
+}
+
+#ifdef NCRYSTAL_ENABLE_TRACING
+#  define NCRYSTAL_TRACE_SAMPLING_ZONE(zone) ::NCrystal::Trace::detail::SamplingZone nc_trace_sampling_zone( zone )
+#else
+#  define NCRYSTAL_TRACE_SAMPLING_ZONE(zone) do {} while(0)
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef NCrystal_Transmission_hh
+#define NCrystal_Transmission_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCInfo.hh"
+#include "NCrystal/NCProcImpl.hh"
+#include "NCrystal/internal/NCSpan.hh"
+
+namespace NCrystal {
+
+  //Transmission, T=exp(-n*sigma*t), of neutrons through slabs of a
+  //non-oriented material, for all combinations of the given wavelengths [Aa]
+  //and thicknesses t [m], with the results stored as
+  //out[ithickness*nwavelengths+iwavelength]. The number density, n, is taken
+  //from the Info object, and sigma is the total cross section of the
+  //scattering and (optional) absorption processes. Cross sections are
+  //evaluated only once for each wavelength, with the batched methods, and in
+  //up to nthreads threads for large numbers of wavelengths. Throws BadInput
+  //for oriented processes, for negative or non-finite thicknesses, or if out
+  //has the wrong size:
+  NCRYSTAL_API void calcTransmission( const Info&,
+                                      const ProcImpl::Process& scatter,
+                                      const ProcImpl::Process* absorption,
+                                      Span<const double> wavelengths,
+                                      Span<const double> thicknesses,
+                                      Span<double> out,
+                                      unsigned nthreads = 1 );
+
+  //Convenience version for a single thickness:
+  NCRYSTAL_API VectD calcTransmission( const Info&,
+                                       const ProcImpl::Process& scatter,
+                                       const ProcImpl::Process* absorption,
+                                       Span<const double> wavelengths,
+                                       double thickness,
+                                       unsigned nthreads = 1 );
+
+}
+
+#endif
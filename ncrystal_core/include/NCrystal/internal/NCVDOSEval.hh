@@ -46,6 +46,12 @@ namespace NCrystal {
     VDOSEval( const VDOSData& );
     ~VDOSEval();
 
+    //Construct with the same (already validated and normalised) density
+    //function as another instance, but at a different temperature. This is
+    //cheaper than constructing from scratch, since none of the checks or
+    //integrations in the main constructor depend on the temperature:
+    VDOSEval( const VDOSEval&, Temperature );
+
     //Basic parameters (npts from emin to emax, npts_extended from 0 to emax):
     struct GridInfo { double emin, emax; unsigned npts, npts_extended; };
     GridInfo getGridInfo() const;
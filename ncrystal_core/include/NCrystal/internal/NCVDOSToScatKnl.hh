@@ -45,6 +45,25 @@ namespace NCrystal {
   //G1 contribution should be reduced to take out sigma_coherent. In this case,
   //the scaling function should return sigma_incoh/(sigma_coh+sigma_incoh) for
   //the argument n==1, and 1.0 for n>1.
+  //
+  //The number of phonon orders is first chosen so the expansion reaches the
+  //kinematic curve of the target Emax, after which any trailing orders whose
+  //combined contribution to the integral of S(alpha,beta) over the final grid
+  //is bounded to be below a relative tolerance of 10^-(3+2*vdosluxlvl) are
+  //left out of the sum.
+
+  //Batched version, creating kernels for the same VDOS at several temperatures
+  //(the temperature of the VDOSData object itself is ignored). This is more
+  //efficient than separate calls, since the preparation of the density
+  //function is shared, and the various expansions are carried out
+  //concurrently (according to NCrystal::setNumberOfThreads). Results are
+  //returned in the same order as the temperatures:
+  std::vector<ScatKnlData> createScatteringKernels( const VDOSData&,
+                                                    const std::vector<Temperature>&,
+                                                    unsigned vdosluxlvl = 3,
+                                                    double targetEmax = 0.0,
+                                                    const VDOSGn::TruncAndThinningParams ttpars = VDOSGn::TruncAndThinningChoices::Default,
+                                                    ScaleGnContributionFct = nullptr );
 
   //Internal functions, exposed here for testing:
   VectD setupAlphaGrid( double kT, double msd, double alphaMax, unsigned npts );
@@ -49,6 +49,7 @@ extern "C" {
   typedef struct { void * internal; } ncrystal_scatter_t;
   typedef struct { void * internal; } ncrystal_absorption_t;
   typedef struct { void * internal; } ncrystal_atomdata_t;
+  typedef struct { void * internal; } ncrystal_cache_t;
 
   NCRYSTAL_API int  ncrystal_refcount( void* object );
   NCRYSTAL_API void ncrystal_ref( void* object );
@@ -111,6 +112,14 @@ extern "C" {
   /* from a given work-thread, in order to get a thread-safe scatter handle.       */
   NCRYSTAL_API ncrystal_scatter_t ncrystal_clone_scatter_rngforcurrentthread( ncrystal_scatter_t );
 
+  /* Clone function where all powder Bragg diffraction (PCBragg) components of the*/
+  /* resulting object are scaled cheaply to a lattice with all d-spacings scaled by*/
+  /* dspacing_scale (isotropic strain), without rebuilding any plane tables (see  */
+  /* PCBraggStrained in NCPCBragg.hh). Other components are unaffected, and so are*/
+  /* number densities. This is intended for e.g. Bragg-edge strain mapping:       */
+  NCRYSTAL_API ncrystal_scatter_t ncrystal_clone_scatter_dspacingscaled( ncrystal_scatter_t,
+                                                                        double dspacing_scale );
+
   /* Convenience function which creates objects directly from a data string        */
   /* rather than an on-disk or in-memory file. Such usage obviously precludes      */
   /* proper caching behind the scenes, and is intended for scenarios where the     */
@@ -142,6 +151,10 @@ extern "C" {
   /*Determine if process is non-oriented (normally) or not (single-crystal):       */
   NCRYSTAL_API int ncrystal_isnonoriented(ncrystal_process_t);
 
+  /*Determine if process is stateless (1) or not (0). Stateless processes never    */
+  /*use a cache, and cache handles (see below) are not bound when used with them:  */
+  NCRYSTAL_API int ncrystal_isstateless(ncrystal_process_t);
+
   /*Access cross sections [barn] by neutron kinetic energy [eV]:                   */
   NCRYSTAL_API void ncrystal_crosssection_nonoriented( ncrystal_process_t,
                                                        double ekin,
@@ -153,6 +166,31 @@ extern "C" {
   NCRYSTAL_API void ncrystal_domain( ncrystal_process_t,
                                      double* ekin_low, double* ekin_high);
 
+  /*Pre-create lazily initialised structures needed for neutron energies in        */
+  /*[ekin_low,ekin_high] (in eV), so they are not created inside the event loop    */
+  /*of the application (call e.g. at the start of a run). If complete is 0, only   */
+  /*essential structures are created, otherwise also all energy dependent ones     */
+  /*(which can take longer, and might use several threads):                        */
+  NCRYSTAL_API void ncrystal_warmup( ncrystal_process_t,
+                                     double ekin_low, double ekin_high,
+                                     int complete );
+
+  /*If the cross section of the process has pure 1/v scaling, this returns 1 and  */
+  /*sets coefficient [barn*sqrt(eV)] so that xs(ekin)=coefficient/sqrt(ekin) can  */
+  /*be evaluated directly by the caller (otherwise 0 is returned):                 */
+  NCRYSTAL_API int ncrystal_analytic_oov_coefficient( ncrystal_process_t,
+                                                      double* coefficient );
+
+  /*Access scattering and absorption cross sections [barn] in a single call     */
+  /*(absorption processes must be non-oriented, and the absorption handle can be */
+  /*a NULL handle, resulting in a vanishing absorption cross section):           */
+  NCRYSTAL_API void ncrystal_crosssection_scatabs( ncrystal_process_t scat,
+                                                   ncrystal_process_t abs,
+                                                   double ekin,
+                                                   const double (*direction)[3],
+                                                   double* result_scat,
+                                                   double* result_abs );
+
   /*Generate random scatterings (neutron kinetic energy is in eV). The isotropic   */
   /*functions can only be called whe ncrystal_isnonoriented returns true (1).      */
   NCRYSTAL_API void ncrystal_samplescatterisotropic( ncrystal_scatter_t,
@@ -166,6 +204,52 @@ extern "C" {
                                             double* ekin_final,
                                             double (*direction_final)[3] );
 
+  /*Get the cross section [barn] and sample a scattering at the same neutron     */
+  /*state in a single call (more efficient than calling ncrystal_crosssection    */
+  /*and ncrystal_samplescatter separately):                                      */
+  NCRYSTAL_API void ncrystal_crosssection_and_samplescatter( ncrystal_scatter_t,
+                                                             double ekin,
+                                                             const double (*direction)[3],
+                                                             double* result_xs,
+                                                             double* ekin_final,
+                                                             double (*direction_final)[3] );
+
+  /*Variants using explicit cache handles. Process handles hold their own cache    */
+  /*internally, which means that a given handle can not be used concurrently in    */
+  /*several threads. Instead, threads can share a single process or scatter        */
+  /*handle, as long as each thread creates its own cache handle and passes it to   */
+  /*the functions below. A given cache handle must only be used with a single      */
+  /*physics process (or its clones). The rng argument must return numbers          */
+  /*uniformly in [0,1), and it can be NULL, in which case a RNG stream owned by    */
+  /*the cache handle will be used. That stream is set aside for the thread upon    */
+  /*first usage (cf. ncrystal_clone_scatter_rngforcurrentthread), so the cache     */
+  /*handle should be created and used in the same thread. Cache handles must be    */
+  /*cleaned up by calling ncrystal_unref.                                          */
+  NCRYSTAL_API ncrystal_cache_t ncrystal_create_cache();
+
+  NCRYSTAL_API void ncrystal_crosssection_nonoriented_c( ncrystal_process_t,
+                                                         ncrystal_cache_t,
+                                                         double ekin,
+                                                         double* result );
+  NCRYSTAL_API void ncrystal_crosssection_c( ncrystal_process_t,
+                                             ncrystal_cache_t,
+                                             double ekin,
+                                             const double (*direction)[3],
+                                             double* result );
+  NCRYSTAL_API void ncrystal_samplescatterisotropic_c( ncrystal_scatter_t,
+                                                       ncrystal_cache_t,
+                                                       double (*rng)(),
+                                                       double ekin,
+                                                       double* ekin_final,
+                                                       double* cos_scat_angle );
+  NCRYSTAL_API void ncrystal_samplescatter_c( ncrystal_scatter_t,
+                                              ncrystal_cache_t,
+                                              double (*rng)(),
+                                              double ekin,
+                                              const double (*direction)[3],
+                                              double* ekin_final,
+                                              double (*direction_final)[3] );
+
   /*============================================================================== */
   /*============================================================================== */
   /*==                                                                          == */
@@ -209,6 +293,14 @@ extern "C" {
   /*All HKL indices in a given group (returns first value h[0]==k[0]==l[0]==0 if not possible). */
   NCRYSTAL_API void ncrystal_info_gethkl_allindices( ncrystal_info_t, int idx,
                                                      int* h, int* k, int* l );/* arrays of length multiplicity/2 */
+  /*Bulk versions, extracting the entries [start,start+n) in a single call. The  */
+  /*first fills arrays of length n, the second fills arrays with the indices of */
+  /*all the entries concatenated (total length sum(multiplicity/2)):            */
+  NCRYSTAL_API void ncrystal_info_gethkl_many( ncrystal_info_t, int start, int n,
+                                               int* h, int* k, int* l, int* multiplicity,
+                                               double * dspacing, double* fsquared );
+  NCRYSTAL_API void ncrystal_info_gethkl_allindices_many( ncrystal_info_t, int start, int n,
+                                                          int* h, int* k, int* l );
 
   NCRYSTAL_API double ncrystal_info_braggthreshold( ncrystal_info_t ); /* [Aa], -1 when not available */
   NCRYSTAL_API int ncrystal_info_hklinfotype( ncrystal_info_t ); /* integer casted value of HKLInfoType */
@@ -249,6 +341,24 @@ extern "C" {
                                                       const double** betagrid,
                                                       const double** sab );
 
+  /* As ncrystal_dyninfo_extract_scatknl, but the kernel is not kept alive by a    */
+  /* global list which is emptied by ncrystal_clear_caches. Instead, a reference   */
+  /* is returned in keepalive, and the arrays stay valid (allowing callers to use  */
+  /* them without copying) until it is released with ncrystal_release_scatknl:     */
+  NCRYSTAL_API void ncrystal_dyninfo_extract_scatknl_ref( ncrystal_info_t,
+                                                          unsigned idyninfo,
+                                                          unsigned vdoslux,
+                                                          double* suggestedEmax,
+                                                          unsigned* negrid,
+                                                          unsigned* nalpha,
+                                                          unsigned* nbeta,
+                                                          const double** egrid,
+                                                          const double** alphagrid,
+                                                          const double** betagrid,
+                                                          const double** sab,
+                                                          void** keepalive );
+  NCRYSTAL_API void ncrystal_release_scatknl( void* keepalive );
+
   /* Access vdos data for ditype 3.                                                */
   NCRYSTAL_API void ncrystal_dyninfo_extract_vdos( ncrystal_info_t,
                                                    unsigned idyninfo,
@@ -270,8 +380,48 @@ extern "C" {
                                                          unsigned* vdos_ndensity,
                                                          const double ** vdos_density );
 
+  /*Double differential scattering cross sections, d^2sigma/dE'dmu [barn/eV], at  */
+  /*n points (ekin[i],eprime[i],mu[i]) for ditype 2,3,4 (see NCSABFixedEnergy.hh).*/
+  /*Results are -1 in case of non-halting errors:                                 */
+  NCRYSTAL_API void ncrystal_dyninfo_ddxs( ncrystal_info_t,
+                                           unsigned idyninfo,
+                                           unsigned vdoslux,
+                                           unsigned long n,
+                                           const double * ekin,
+                                           const double * eprime,
+                                           const double * mu,
+                                           double * results );
+
+  /*Sample n (deltaE,mu) values at a fixed neutron energy for ditype 2,3,4, with  */
+  /*exact inverse-CDF sampling from a precomputed table with nmu mu bins (see     */
+  /*NCSABFixedEnergy.hh), using a builtin RNG stream depending only on the seed.  */
+  /*The integrated cross section of the table [barn] is returned in xs. Results   */
+  /*are -1 in case of non-halting errors:                                         */
+  NCRYSTAL_API void ncrystal_dyninfo_sample_fixedekin( ncrystal_info_t,
+                                                       unsigned idyninfo,
+                                                       unsigned vdoslux,
+                                                       double ekin,
+                                                       unsigned nmu,
+                                                       unsigned long n,
+                                                       unsigned long seed,
+                                                       double * xs,
+                                                       double * results_deltae,
+                                                       double * results_mu );
+
   /* Convenience:                                                                  */
   NCRYSTAL_API double ncrystal_info_dspacing_from_hkl( ncrystal_info_t, int h, int k, int l );
+  /*Batched version, for n Miller indices given in arrays h, k and l:              */
+  NCRYSTAL_API void ncrystal_info_dspacing_from_hkl_many( ncrystal_info_t, unsigned long n,
+                                                          const int* h, const int* k, const int* l,
+                                                          double* out_dspacing );
+  /*Index of HKL list entry containing the given Miller index (or -1 if not        */
+  /*found). Symmetry equivalent indices are found if the entries can be expanded   */
+  /*(see ncrystal_info_gethkl_allindices), and (-h,-k,-l) always finds the same    */
+  /*entry as (h,k,l). A lookup table is built on first usage:                      */
+  NCRYSTAL_API int ncrystal_info_findhkl( ncrystal_info_t, int h, int k, int l );
+  NCRYSTAL_API void ncrystal_info_findhkl_many( ncrystal_info_t, unsigned long n,
+                                                const int* h, const int* k, const int* l,
+                                                int* out_idx );
 
 
   /* Composition (always >=1 component):                                           */
@@ -279,6 +429,13 @@ extern "C" {
   NCRYSTAL_API void ncrystal_info_getcomponent( ncrystal_info_t, unsigned icomponent,
                                                 unsigned* atomdataindex,
                                                 double* fraction );
+  /* Composition flattened into natural elements and isotopes, with composite atoms*/
+  /* recursively broken down. Entries are sorted by (Z,A) with A=0 for natural     */
+  /* elements. The flattening is done once, and cached on the Info object. The     */
+  /* arrays must have length ncrystal_info_nflatcomponents:                        */
+  NCRYSTAL_API unsigned ncrystal_info_nflatcomponents( ncrystal_info_t );
+  NCRYSTAL_API void ncrystal_info_getflatcomponents( ncrystal_info_t, unsigned* Z, unsigned* A,
+                                                     double* fraction );
 
 
   /* Turn returned atomdata_idx's from calls above into actual ncrystal_atomdata_t */
@@ -329,7 +486,8 @@ extern "C" {
   NCRYSTAL_API int ncrystal_setquietonerror(int);/* returns old value */
 
   /*If not halting on error, these functions can be used to access information     */
-  /*about errors encountered:                                                      */
+  /*about errors encountered (the error state is kept separately for each thread,  */
+  /*and refers to errors in calls made from the calling thread):                   */
   NCRYSTAL_API int ncrystal_error();/* returns 1 if an error condition occurred. */
   NCRYSTAL_API const char * ncrystal_lasterror();/* returns description of last error (NULL if none) */
   NCRYSTAL_API const char * ncrystal_lasterrortype();/* returns description of last error (NULL if none) */
@@ -341,6 +499,52 @@ extern "C" {
   /*each error:                                                                    */
   NCRYSTAL_API void ncrystal_seterrhandler(void (*handler)(char*,char*));
 
+  /*Alternative versions of the most frequently called functions, which return a   */
+  /*status code (0 on success, 1 on errors) rather than using the error handling   */
+  /*described above. Errors in these functions never result in printouts, calls    */
+  /*to the custom error handler, or termination of the programme. They are only    */
+  /*recorded in the error state of the calling thread, so ncrystal_lasterror etc.  */
+  /*can be used to get more information. Output values are as for the original     */
+  /*functions (i.e. they are set to invalid values like -1 on errors).             */
+  NCRYSTAL_API int ncrystal_crosssection_nonoriented_st( ncrystal_process_t,
+                                                         double ekin,
+                                                         double* result );
+  NCRYSTAL_API int ncrystal_crosssection_st( ncrystal_process_t,
+                                             double ekin,
+                                             const double (*direction)[3],
+                                             double* result );
+  NCRYSTAL_API int ncrystal_samplescatterisotropic_st( ncrystal_scatter_t,
+                                                       double ekin,
+                                                       double* ekin_final,
+                                                       double* cos_scat_angle );
+  NCRYSTAL_API int ncrystal_samplescatter_st( ncrystal_scatter_t,
+                                              double ekin,
+                                              const double (*direction)[3],
+                                              double* ekin_final,
+                                              double (*direction_final)[3] );
+  NCRYSTAL_API int ncrystal_crosssection_nonoriented_c_st( ncrystal_process_t,
+                                                           ncrystal_cache_t,
+                                                           double ekin,
+                                                           double* result );
+  NCRYSTAL_API int ncrystal_crosssection_c_st( ncrystal_process_t,
+                                               ncrystal_cache_t,
+                                               double ekin,
+                                               const double (*direction)[3],
+                                               double* result );
+  NCRYSTAL_API int ncrystal_samplescatterisotropic_c_st( ncrystal_scatter_t,
+                                                         ncrystal_cache_t,
+                                                         double (*rng)(),
+                                                         double ekin,
+                                                         double* ekin_final,
+                                                         double* cos_scat_angle );
+  NCRYSTAL_API int ncrystal_samplescatter_c_st( ncrystal_scatter_t,
+                                                ncrystal_cache_t,
+                                                double (*rng)(),
+                                                double ekin,
+                                                const double (*direction)[3],
+                                                double* ekin_final,
+                                                double (*direction_final)[3] );
+
   /*============================================================================== */
   /*============================================================================== */
   /*==                                                                          == */
@@ -489,6 +693,29 @@ extern "C" {
   /* Clear various caches employed inside NCrystal:                                */
   NCRYSTAL_API void ncrystal_clear_caches();
 
+  /* Approximate memory footprint in bytes of Info object (incl. any phases), and  */
+  /* statistics (incl. footprints) of the factory caches as a JSON list (must be   */
+  /* deallocated with ncrystal_dealloc_string). Footprints of processes are        */
+  /* included in the JSON returned by ncrystal_dbg_process:                        */
+  NCRYSTAL_API double ncrystal_info_memoryfootprint( ncrystal_info_t );
+  NCRYSTAL_API char * ncrystal_factory_stats_json();
+
+  /* Create or load material snapshots (see createSnapshot and loadSnapshot in     */
+  /* NCFact.hh). The list of cfg-strings returned when loading must be             */
+  /* deallocated by a call to ncrystal_dealloc_stringlist:                         */
+  NCRYSTAL_API void ncrystal_create_snapshot( unsigned ncfgs, const char ** cfgstrs,
+                                              const char * dirname );
+  NCRYSTAL_API void ncrystal_load_snapshot( const char * dirname, unsigned* ncfgs, char*** cfgstrs );
+
+  /* Export the scattering cross sections of a non-oriented material to a binary   */
+  /* file, tabulated in [emin,emax] to the given relative tolerance, or load such  */
+  /* a file as a scatter handle (see NCTabulatedXS.hh). Loading does not need the  */
+  /* data files of the material, unless the handle is used for sampling or for     */
+  /* energies outside the tabulated range:                                         */
+  NCRYSTAL_API void ncrystal_export_xstable( const char * cfgstr, const char * filename,
+                                             double tolerance, double emin, double emax );
+  NCRYSTAL_API ncrystal_scatter_t ncrystal_load_xstable( const char * filename );
+
   /* Get list of plugins. Resulting string list must be deallocated by a call to   */
   /* ncrystal_dealloc_stringlist by, and contains entries in the format            */
   /* pluginname0,filename0,plugintype0,pluginname1,filename1,plugintype1,...:      */
@@ -530,6 +757,9 @@ extern "C" {
   /*============================================================================== */
   /*============================================================================== */
 
+  /*Sampling at a single neutron state repeatedly (ncrystal_samplescatter_many,   */
+  /*or ncrystal_samplescatterisotropic_many with n_ekin=1) lets the models        */
+  /*carry out their setup for that state only once:                               */
   NCRYSTAL_API void ncrystal_samplescatterisotropic_many( ncrystal_scatter_t,
                                                           const double * ekin,
                                                           unsigned long n_ekin,
@@ -552,6 +782,152 @@ extern "C" {
                                                             unsigned long repeat,
                                                             double* results );
 
+  /*Structure-of-arrays versions, handling n neutrons with individual energies    */
+  /*and directions in a single call (all arrays must have length n):              */
+  NCRYSTAL_API void ncrystal_crosssection_soa( ncrystal_process_t,
+                                               unsigned long n,
+                                               const double * ekin,
+                                               const double * dirx,
+                                               const double * diry,
+                                               const double * dirz,
+                                               double* results );
+
+  NCRYSTAL_API void ncrystal_samplescatter_soa( ncrystal_scatter_t,
+                                                unsigned long n,
+                                                const double * ekin,
+                                                const double * dirx,
+                                                const double * diry,
+                                                const double * dirz,
+                                                double* results_ekin,
+                                                double * results_dirx,
+                                                double * results_diry,
+                                                double * results_dirz );
+
+  /*Multi-threaded version of ncrystal_samplescatter_soa, using up to nthreads    */
+  /*threads. The neutrons are handled in fixed chunks of 4096, with chunk k       */
+  /*using a clone of the scatter handle with the RNG stream index given by        */
+  /*rngstreamidx_offset+k (cf. ncrystal_clone_scatter_rngbyidx). Thus, results    */
+  /*do not depend on nthreads. As streams with a given index keep their state,    */
+  /*repeated calls with the same offset continue (rather than repeat) the         */
+  /*random sequences:                                                             */
+  NCRYSTAL_API void ncrystal_samplescatter_soa_mt( ncrystal_scatter_t,
+                                                   unsigned nthreads,
+                                                   unsigned long rngstreamidx_offset,
+                                                   unsigned long n,
+                                                   const double * ekin,
+                                                   const double * dirx,
+                                                   const double * diry,
+                                                   const double * dirz,
+                                                   double* results_ekin,
+                                                   double * results_dirx,
+                                                   double * results_diry,
+                                                   double * results_dirz );
+
+  /*Like ncrystal_samplescatter_soa_mt, but with a dedicated RNG stream for each   */
+  /*neutron, so the results are bit-identical regardless of the number of threads  */
+  /*and of how neutrons are split over calls. Neutron i in the arrays is given     */
+  /*the index neutronid_offset+i, and its stream is the one with that index in     */
+  /*the builtin counter-based RNG with the given seed (the RNG stream of the       */
+  /*scatter handle is not used):                                                   */
+  NCRYSTAL_API void ncrystal_samplescatter_soa_byidx( ncrystal_scatter_t,
+                                                      unsigned nthreads,
+                                                      unsigned long seed,
+                                                      unsigned long neutronid_offset,
+                                                      unsigned long n,
+                                                      const double * ekin,
+                                                      const double * dirx,
+                                                      const double * diry,
+                                                      const double * dirz,
+                                                      double* results_ekin,
+                                                      double * results_dirx,
+                                                      double * results_diry,
+                                                      double * results_dirz );
+
+  /*Built-in Monte Carlo transport of n neutrons through a single volume of a     */
+  /*material, with a simple shape centred at the origin (lengths in meters):      */
+  /*                                                                              */
+  /*  shape=0 : slab infinite in x and y, shapeparams={thickness}                 */
+  /*  shape=1 : box, shapeparams={dx,dy,dz}                                       */
+  /*  shape=2 : cylinder with axis along y, shapeparams={radius,height}           */
+  /*  shape=3 : sphere, shapeparams={radius}                                      */
+  /*                                                                              */
+  /*The neutrons can start inside or outside the volume, and their states (x,y,z, */
+  /*ux,uy,uz,ekin,weight) are updated in place to those at exit, absorption or    */
+  /*abandonment (after maxscat scatterings). The status values are 0 (exited), 1  */
+  /*(missed the volume), 2 (absorbed) and 3 (abandoned), and nscat holds the      */
+  /*number of scatterings. Cross sections are converted to inverse mean free      */
+  /*paths with the number density [atoms/Aa^3], and the absorption handle may     */
+  /*have internal=NULL. Absorption is ignored (absmode=0), reduces the weights    */
+  /*continuously (absmode=1), or terminates neutrons (absmode=2). If tallies is   */
+  /*not NULL, it must hold ntallybins+3 entries, which are set to the summed      */
+  /*weights of exiting neutrons with 0,1,..,ntallybins-1 scatterings (the last    */
+  /*bin including also higher numbers), followed by the absorbed, missed and      */
+  /*abandoned weights. Batches of 4096 neutrons are processed in up to nthreads   */
+  /*threads, using RNG streams as in ncrystal_samplescatter_soa_mt. In case of    */
+  /*non-halting errors, all status values are set to -1:                          */
+  NCRYSTAL_API void ncrystal_minitransport_mt( ncrystal_scatter_t,
+                                               ncrystal_absorption_t,
+                                               double numberdensity,
+                                               int shape,
+                                               const double * shapeparams,
+                                               int absmode,
+                                               unsigned maxscat,
+                                               unsigned nthreads,
+                                               unsigned long rngstreamidx_offset,
+                                               unsigned long n,
+                                               double * x, double * y, double * z,
+                                               double * ux, double * uy, double * uz,
+                                               double * ekin, double * weight,
+                                               unsigned * nscat, int * status,
+                                               unsigned ntallybins,
+                                               double * tallies );
+
+  /*Transmission, T=exp(-n*sigma*t), of neutrons through slabs of a non-oriented  */
+  /*material, for all combinations of nwl wavelengths [Aa] and nthick thicknesses */
+  /*t [m]. The results array must hold nwl*nthick entries, and is filled with     */
+  /*results[ithick*nwl+iwl]. The number density, n, is taken from the info handle,*/
+  /*and sigma is the total cross section of the scatter and absorption handles    */
+  /*(the latter may have internal=NULL). Wavelengths are processed in chunks in   */
+  /*up to nthreads threads. In case of non-halting errors, results are set to -1: */
+  NCRYSTAL_API void ncrystal_calc_transmission( ncrystal_info_t,
+                                                ncrystal_scatter_t,
+                                                ncrystal_absorption_t,
+                                                unsigned long nwl,
+                                                const double * wavelengths,
+                                                unsigned long nthick,
+                                                const double * thicknesses,
+                                                unsigned nthreads,
+                                                double * results );
+
+  /*Deterministic calculation of the scattering angle distribution in a           */
+  /*non-oriented material, for an incident spectrum given by nekin energies with  */
+  /*weights (see NCPowderPattern.hh). For each of the nbins bins of scattering    */
+  /*angle (with nbins+1 increasing edges in [0,pi]), the sums over the spectrum of*/
+  /*weight*sigma_bin [barn] are placed in results_bragg for powder Bragg          */
+  /*diffraction, which is calculated analytically from the plane tables, and in   */
+  /*results_background for all other components. The latter is estimated from     */
+  /*nsamples_background sampled scatterings per energy (0 disables it), with      */
+  /*builtin RNG streams depending only on the seed. Energies are processed in     */
+  /*chunks in up to nthreads threads. Results are -1 in case of non-halting errors:*/
+  NCRYSTAL_API void ncrystal_calc_powder_pattern( ncrystal_scatter_t,
+                                                  unsigned long nekin,
+                                                  const double * ekin,
+                                                  const double * weights,
+                                                  unsigned long nbins,
+                                                  const double * bin_edges,
+                                                  unsigned nsamples_background,
+                                                  unsigned long seed,
+                                                  unsigned nthreads,
+                                                  double * results_bragg,
+                                                  double * results_background );
+
+  /*Export non-oriented scatter handle as a flat array of doubles, which can be   */
+  /*copied directly to devices such as GPUs (see the NCFlatExport.hh header for   */
+  /*the layout). The array must be deallocated with ncrystal_dealloc_doublearray: */
+  NCRYSTAL_API double* ncrystal_export_flat_tables( ncrystal_scatter_t,
+                                                    unsigned long* length );
+  NCRYSTAL_API void ncrystal_dealloc_doublearray( double* );
+
   /*============================================================================== */
   /*============================================================================== */
   /*==                                                                          == */
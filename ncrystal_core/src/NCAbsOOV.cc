@@ -40,7 +40,7 @@ NC::AbsOOV::AbsOOV( SigmaAbsorption sigabs)
 
 NC::CrossSect NC::AbsOOV::crossSectionIsotropic(CachePtr&, NeutronEnergy ekin ) const
 {
-  return CrossSect{ ekin.dbl() ? m_c / std::sqrt(ekin.dbl()) : kInfinity };
+  return crossSectionOOV( ekin );
 }
 
 std::shared_ptr<NC::ProcImpl::Process> NC::AbsOOV::createMerged( const Process& oraw,
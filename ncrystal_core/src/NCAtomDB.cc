@@ -19,12 +19,12 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "NCrystal/internal/NCAtomDB.hh"
-#include "NCrystal/internal/NCFactoryUtils.hh"
 #include "NCrystal/internal/NCAtomUtils.hh"
 #include "NCrystal/internal/NCString.hh"
 #include <cstdlib>
 #include <iostream>
 #include <iomanip>
+#include <array>
 
 namespace NC = NCrystal;
 
@@ -34,9 +34,10 @@ namespace NCrystal {
 
     //We keep the database in two internal layers. One is essentially a static
     //and memory efficient list containing all the raw numbers for elements and
-    //isotopes known to NCrystal, and the other is a standard CachedFactoryBase
-    //which delivers the actual OptionalAtomDataSP objects, with on-demand
-    //initialisation and cache-clearance as usual.
+    //isotopes known to NCrystal, and the other is a table of the actual
+    //AtomDataSP objects, built on first usage and indexed directly by Z (each Z
+    //having at most a handful of entries), so lookups are lock- and
+    //allocation-free.
 
     namespace internal {
 
@@ -104,49 +105,45 @@ namespace NCrystal {
         return s_db;
       }
 
-      const Entry* lookupEntry( AtomDBKey key )
-      {
-        const auto& db = internalDB();
-        auto it = std::lower_bound(db.begin(),db.end(),key);
-        if ( it == db.end() || it->key() != key )
-          return nullptr;
-        return &(*it);
-      }
-
-      //This template argument of base class is true, i.e. factory keeps strong
-      //not weak references.
-      class StdAtomDataFactory : public NC::CachedFactoryBase<AtomDBKey,AtomData,CachedFactory_KeepAllStrongRefs> {
+      class AtomDataTable : private NoCopyMove {
       public:
-        const char* factoryName() const final { return "StdAtomDataFactory"; }
-        std::string keyToString( const AtomDBKey& key ) const final
+        AtomDataTable()
         {
-          const unsigned Z = key.Z();
-          const unsigned A = key.A();
-          std::ostringstream ss;
-          ss<<"(Z="<<Z;
-          if (A==0) {
-            ss<<";natural)";
-          } else {
-            ss<<";A="<<A<<")";
+          const auto& db = internalDB();
+          nc_assert_always( db.size() < std::numeric_limits<uint16_t>::max() );
+          m_data.reserve( db.size() );
+          for ( auto& e : db )
+            m_data.emplace_back( e.createAtomDataSP() );
+          //Entries are sorted by (Z,A), so the entries of a given Z are found
+          //in [m_zbegin[Z],m_zbegin[Z+1]):
+          std::size_t idx = 0;
+          for ( auto Z : ncrange<unsigned>( m_zbegin.size() ) ) {
+            while ( idx < db.size() && db[idx].Z() < Z )
+              ++idx;
+            m_zbegin[Z] = static_cast<uint16_t>( idx );
           }
-          return ss.str();
         }
 
-      protected:
-        virtual OptionalAtomDataSP actualCreate( const AtomDBKey& key ) const final
+        OptionalAtomDataSP lookup( AtomDBKey key ) const
         {
-          auto entry = lookupEntry(key);
-          if ( !entry )
-            return nullptr;
-          nc_assert( key.Z() == entry->Z() && key.A() == entry->A() );
-          return entry->createAtomDataSP();
+          const auto& db = internalDB();
+          const unsigned Z = key.Z();
+          nc_assert( Z + 1 < m_zbegin.size() );
+          for ( unsigned i = m_zbegin[Z]; i < m_zbegin[Z+1]; ++i )
+            if ( db[i].key() == key )
+              return m_data[i];
+          return nullptr;
         }
+
+      private:
+        std::vector<AtomDataSP> m_data;//same order as internalDB()
+        std::array<uint16_t,151> m_zbegin;//Z<150 (cf. AtomDBKey::isZAValid)
       };
 
-      static StdAtomDataFactory& getStdAtomDBFact()
+      const AtomDataTable& atomDataTable()
       {
-        static StdAtomDataFactory s_stdAtomDBFact;
-        return s_stdAtomDBFact;
+        static AtomDataTable s_table;
+        return s_table;
       }
 
     }
@@ -157,7 +154,7 @@ NC::OptionalAtomDataSP NC::AtomDB::getNaturalElement( unsigned Z )
 {
   if (!internal::AtomDBKey::isZAValid(Z,0))
     return nullptr;
-  return internal::getStdAtomDBFact().create(internal::AtomDBKey(Z,0));
+  return internal::atomDataTable().lookup(internal::AtomDBKey(Z,0));
 }
 
 NC::OptionalAtomDataSP NC::AtomDB::getNaturalElement( const std::string& name )
@@ -166,14 +163,14 @@ NC::OptionalAtomDataSP NC::AtomDB::getNaturalElement( const std::string& name )
   unsigned Z = elementNameToZ(name);
   if (Z==0)
     return nullptr;
-  return internal::getStdAtomDBFact().create(internal::AtomDBKey(Z,0));
+  return internal::atomDataTable().lookup(internal::AtomDBKey(Z,0));
 }
 
 NC::OptionalAtomDataSP NC::AtomDB::getIsotope( unsigned Z, unsigned A )
 {
   if (!internal::AtomDBKey::isZAValid(Z,A))
     return nullptr;
-  return A>=Z ? internal::getStdAtomDBFact().create(internal::AtomDBKey(Z,A)) : nullptr;
+  return A>=Z ? internal::atomDataTable().lookup(internal::AtomDBKey(Z,A)) : nullptr;
 }
 
 NC::OptionalAtomDataSP NC::AtomDB::getIsotope( const std::string& name )
@@ -188,7 +185,7 @@ NC::OptionalAtomDataSP NC::AtomDB::getIsotopeOrNatElem( unsigned Z, unsigned A )
 {
   if (!internal::AtomDBKey::isZAValid(Z,A))
     return nullptr;
-  return internal::getStdAtomDBFact().create(internal::AtomDBKey(Z,A));
+  return internal::atomDataTable().lookup(internal::AtomDBKey(Z,A));
 }
 
 NC::OptionalAtomDataSP NC::AtomDB::getIsotopeOrNatElem( const std::string& name )
@@ -201,7 +198,7 @@ NC::OptionalAtomDataSP NC::AtomDB::getIsotopeOrNatElem( const std::string& name
   if (!internal::AtomDBKey::isZAValid(Z,A))
     return nullptr;
 
-  return internal::getStdAtomDBFact().create(internal::AtomDBKey(Z,A));
+  return internal::atomDataTable().lookup(internal::AtomDBKey(Z,A));
 }
 
 unsigned NC::AtomDB::getAllEntriesCount()
@@ -158,9 +158,15 @@ NC::OptionalAtomDataSP NC::AtomDBExtender::lookupAtomDataAllowMissing(const std:
   if (it!=m_db.end())
     return it->second;
   if (m_allowInbuiltDB) {
+    //Cache results to avoid parsing the same labels again:
+    auto itCache = m_inbuiltCache.find(lbl);
+    if ( itCache != m_inbuiltCache.end() )
+      return itCache->second;
     OptionalAtomDataSP ad = AtomDB::getIsotopeOrNatElem(lbl);
-    if ( ad != nullptr )
+    if ( ad != nullptr ) {
+      m_inbuiltCache.emplace( lbl, ad );
       return ad;
+    }
   }
   return nullptr;
 }
@@ -21,6 +21,7 @@
 #include "NCrystal/internal/NCAtomUtils.hh"
 #include "NCrystal/internal/NCString.hh"
 #include "NCrystal/internal/NCMath.hh"
+#include <array>
 namespace NC = NCrystal;
 
 namespace NCrystal {
@@ -38,13 +39,36 @@ namespace NCrystal {
       "Cf"_s, "Es"_s, "Fm"_s, "Md"_s, "No"_s, "Lr"_s, "Rf"_s, "Db"_s, "Sg"_s, "Bh"_s,
       "Hs"_s, "Mt"_s, "Ds"_s, "Rg"_s, "Cn"_s, "Nh"_s, "Fl"_s, "Mc"_s, "Lv"_s, "Ts"_s,
       "Og"_s };
-    static const std::map<std::string,unsigned> s_natelem_name2z_map = []()
+
+    //Element names are one upper case letter optionally followed by one lower
+    //case letter, which gives a perfect hash into a small table of Z values:
+    constexpr unsigned natelem_tablesize = 26*27;
+    inline unsigned natElemTableIndex( const std::string& name )
+    {
+      const std::size_t n = name.size();
+      if ( n < 1 || n > 2 || name[0] < 'A' || name[0] > 'Z' )
+        return natelem_tablesize;
+      unsigned idx = 27 * static_cast<unsigned>( name[0] - 'A' );
+      if ( n == 2 ) {
+        if ( name[1] < 'a' || name[1] > 'z' )
+          return natelem_tablesize;
+        idx += 1 + static_cast<unsigned>( name[1] - 'a' );
+      }
+      return idx;
+    }
+
+    static const std::array<uint8_t,natelem_tablesize> s_natelem_name2z_table = []()
     {
-      std::map<std::string,unsigned> mm;
+      std::array<uint8_t,natelem_tablesize> t;
+      t.fill(0);
       constexpr unsigned zmax = (sizeof(s_natelemlist)/sizeof(s_natelemlist[0]));
-      for (unsigned zm1 = 0; zm1<zmax; ++zm1)
-        mm[s_natelemlist[zm1]] = zm1+1;
-      return mm;
+      static_assert(zmax<256,"");
+      for (unsigned zm1 = 0; zm1<zmax; ++zm1) {
+        const unsigned idx = natElemTableIndex(s_natelemlist[zm1]);
+        nc_assert_always( idx < natelem_tablesize && t[idx] == 0 );
+        t[idx] = static_cast<uint8_t>(zm1+1);
+      }
+      return t;
     }();
 
   }
@@ -61,8 +85,8 @@ const std::string& NC::elementZToName(unsigned z)
 }
 
 unsigned NC::elementNameToZ(const std::string& name) {
-  auto it = s_natelem_name2z_map.find(name);
-  return ( it == s_natelem_name2z_map.end() ? 0 : it->second );
+  const unsigned idx = natElemTableIndex(name);
+  return ( idx < natelem_tablesize ? s_natelem_name2z_table[idx] : 0 );
 }
 
 void NC::AtomSymbol::longInit(const std::string& symbol)
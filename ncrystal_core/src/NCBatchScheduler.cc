@@ -0,0 +1,236 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCBatchScheduler.hh"
+#include "NCrystal/internal/NCMath.hh"
+#include <cstring>
+
+namespace NC = NCrystal;
+
+namespace NCrystal {
+  namespace {
+    //Coarse direction cells (8 per coordinate), used to group neutrons in
+    //oriented processes:
+    uint32_t directionCell( const NeutronDirection& dir )
+    {
+      auto bin = []( double u )
+      {
+        return static_cast<uint32_t>( ncclamp( std::floor( ( u + 1.0 ) * 4.0 ), 0.0, 7.0 ) );
+      };
+      return ( bin( dir[0] ) << 6 ) | ( bin( dir[1] ) << 3 ) | bin( dir[2] );
+    }
+  }
+}
+
+struct NC::BatchScheduler::Impl {
+  struct Proc {
+    ProcImpl::ProcPtr proc;
+    CachePtr cache;
+    bool oriented;
+  };
+  std::vector<Proc> procs;
+
+  //The queue:
+  std::vector<uint32_t> iproc;
+  VectD ekin;
+  std::vector<NeutronDirection> dirs;
+
+  //Scratch buffers, kept to avoid allocations in repeated evaluations:
+  struct SortEntry {
+    uint64_t key;//direction cell in the upper bits, energy in the lower
+    uint32_t idx;
+    bool operator<( const SortEntry& o ) const noexcept
+    {
+      return key != o.key ? key < o.key : idx < o.idx;
+    }
+  };
+  std::vector<SortEntry> sortbuf;
+  std::vector<uint32_t> order, groupbegin, runend;
+  VectD buf_ekin, buf_xs;
+  std::vector<NeutronDirection> buf_dirs;
+  std::vector<ScatterOutcome> buf_outcomes;
+
+  //Sort the queue, and call fct(proc,nstates) for the neutrons in each
+  //process. Neutrons are first bucketed by process, and then sorted by their
+  //energy (and direction cell, for oriented processes) within each bucket. Ties
+  //are resolved by queue position, so the order is always reproducible. Runs of
+  //adjacent neutrons in identical states are merged, so buf_ekin and buf_dirs
+  //hold nstates distinct states, and the neutrons in state j are found at
+  //order[runend[j-1]..runend[j]) (with runend[-1] being the start of the
+  //bucket):
+  template<class TFct>
+  void forEachGroup( TFct&& fct )
+  {
+    const std::size_t n = iproc.size();
+    const std::size_t np = procs.size();
+    groupbegin.assign( np + 1, 0 );
+    for ( auto ip : iproc )
+      ++groupbegin[ip+1];
+    for ( std::size_t ip = 0; ip < np; ++ip )
+      groupbegin[ip+1] += groupbegin[ip];
+    sortbuf.resize( n );
+    {
+      std::vector<uint32_t>& pos = order;//borrow as fill positions
+      pos.assign( groupbegin.begin(), groupbegin.end() - 1 );
+      for ( std::size_t i = 0; i < n; ++i ) {
+        const uint32_t ip = iproc[i];
+        //The bit patterns of non-negative doubles are ordered like their
+        //values. For oriented processes, the 9 bits of the direction cell go
+        //on top, and the lowest 9 mantissa bits of the energy are dropped:
+        uint64_t ebits;
+        std::memcpy( &ebits, &ekin[i], sizeof(ebits) );
+        uint64_t key = ebits;
+        if ( procs[ip].oriented )
+          key = ( uint64_t(directionCell( dirs[i] )) << 55 ) | ( ebits >> 9 );
+        sortbuf[pos[ip]++] = SortEntry{ key, static_cast<uint32_t>( i ) };
+      }
+    }
+    order.resize( n );
+    for ( std::size_t ip = 0; ip < np; ++ip ) {
+      const std::size_t i0 = groupbegin[ip];
+      const std::size_t i1 = groupbegin[ip+1];
+      if ( i0 == i1 )
+        continue;
+      std::sort( sortbuf.begin() + i0, sortbuf.begin() + i1 );
+      const bool oriented = procs[ip].oriented;
+      buf_ekin.clear();
+      buf_dirs.clear();
+      runend.clear();
+      for ( std::size_t i = i0; i < i1; ++i ) {
+        const uint32_t idx = sortbuf[i].idx;
+        order[i] = idx;
+        if ( !buf_ekin.empty() && buf_ekin.back() == ekin[idx]
+             && ( !oriented || buf_dirs.back() == dirs[idx] ) ) {
+          runend.back() = static_cast<uint32_t>( i + 1 );
+          continue;
+        }
+        buf_ekin.push_back( ekin[idx] );
+        buf_dirs.push_back( dirs[idx] );
+        runend.push_back( static_cast<uint32_t>( i + 1 ) );
+      }
+      fct( procs[ip], i0, buf_ekin.size() );
+    }
+  }
+};
+
+NC::BatchScheduler::BatchScheduler()
+  : m_impl(std::make_unique<Impl>())
+{
+}
+
+NC::BatchScheduler::~BatchScheduler() = default;
+NC::BatchScheduler::BatchScheduler( BatchScheduler&& ) = default;
+NC::BatchScheduler& NC::BatchScheduler::operator=( BatchScheduler&& ) = default;
+
+unsigned NC::BatchScheduler::addProcess( ProcImpl::ProcPtr proc )
+{
+  auto& procs = m_impl->procs;
+  for ( std::size_t i = 0; i < procs.size(); ++i )
+    if ( procs[i].proc == proc )
+      return static_cast<unsigned>( i );
+  const bool oriented = proc->isOriented();
+  procs.push_back( Impl::Proc{ std::move(proc), CachePtr(), oriented } );
+  return static_cast<unsigned>( procs.size() - 1 );
+}
+
+std::size_t NC::BatchScheduler::nProcesses() const noexcept
+{
+  return m_impl->procs.size();
+}
+
+void NC::BatchScheduler::add( unsigned iproc, NeutronEnergy ekin, const NeutronDirection& dir )
+{
+  if ( iproc >= m_impl->procs.size() )
+    NCRYSTAL_THROW2(BadInput,"BatchScheduler::add: invalid process index "<<iproc);
+  m_impl->iproc.push_back( iproc );
+  m_impl->ekin.push_back( ekin.dbl() );
+  m_impl->dirs.push_back( dir );
+}
+
+std::size_t NC::BatchScheduler::size() const noexcept
+{
+  return m_impl->iproc.size();
+}
+
+void NC::BatchScheduler::clear() noexcept
+{
+  m_impl->iproc.clear();
+  m_impl->ekin.clear();
+  m_impl->dirs.clear();
+}
+
+void NC::BatchScheduler::crossSections( double* out_xs )
+{
+  //Cross sections are evaluated once for each distinct neutron state:
+  auto& impl = *m_impl;
+  impl.forEachGroup( [&impl,out_xs]( Impl::Proc& p, std::size_t i0, std::size_t nstates )
+  {
+    impl.buf_xs.resize( nstates );
+    if ( p.oriented )
+      p.proc->crossSectionMany( p.cache, impl.buf_ekin.data(), impl.buf_dirs.data(),
+                                nstates, impl.buf_xs.data() );
+    else
+      p.proc->crossSectionIsotropicMany( p.cache, impl.buf_ekin.data(), nstates, impl.buf_xs.data() );
+    std::size_t i = i0;
+    for ( std::size_t j = 0; j < nstates; ++j )
+      for ( ; i < impl.runend[j]; ++i )
+        out_xs[impl.order[i]] = impl.buf_xs[j];
+  } );
+}
+
+void NC::BatchScheduler::sampleScatters( RNG& rng, ScatterOutcome* out )
+{
+  //Neutrons in distinct states are sampled with sampleScatterMany (in chunks
+  //of consecutive states), and runs of neutrons in identical states with
+  //sampleScatterRepeated:
+  auto& impl = *m_impl;
+  impl.forEachGroup( [&impl,&rng,out]( Impl::Proc& p, std::size_t i0, std::size_t nstates )
+  {
+    if ( p.proc->processType() != ProcessType::Scatter )
+      NCRYSTAL_THROW2(BadInput,"BatchScheduler::sampleScatters: neutrons queued in"
+                      " non-scattering process "<<p.proc->name());
+    auto& outcomes = impl.buf_outcomes;
+    const std::size_t ngroup = impl.runend.back() - i0;
+    if ( outcomes.size() < ngroup )
+      outcomes.resize( ngroup, ScatterOutcome{ NeutronEnergy{0.0}, NeutronDirection{0.0,0.0,1.0} } );
+    //Outcomes are produced in the sorted order, i.e. outcomes[i-i0] belongs to
+    //neutron order[i]:
+    std::size_t jsingle = 0;//first state of pending chunk of distinct states
+    auto runBegin = [&impl,i0]( std::size_t j ) -> std::size_t { return j ? impl.runend[j-1] : i0; };
+    auto flushSingles = [&]( std::size_t jend )
+    {
+      if ( jend > jsingle )
+        p.proc->sampleScatterMany( p.cache, rng, impl.buf_ekin.data() + jsingle, impl.buf_dirs.data() + jsingle,
+                                   jend - jsingle, outcomes.data() + ( runBegin( jsingle ) - i0 ) );
+    };
+    for ( std::size_t j = 0; j < nstates; ++j ) {
+      const std::size_t nrun = impl.runend[j] - runBegin( j );
+      if ( nrun == 1 )
+        continue;
+      flushSingles( j );
+      p.proc->sampleScatterRepeated( p.cache, rng, NeutronEnergy{ impl.buf_ekin[j] }, impl.buf_dirs[j],
+                                     nrun, outcomes.data() + ( runBegin( j ) - i0 ) );
+      jsingle = j + 1;
+    }
+    flushSingles( nstates );
+    for ( std::size_t i = i0; i < impl.runend.back(); ++i )
+      out[impl.order[i]] = outcomes[i-i0];
+  } );
+}
@@ -20,21 +20,109 @@
 
 #include "NCrystal/internal/NCBkgdExtCurve.hh"
 #include "NCrystal/internal/NCRandUtils.hh"
+#include "NCrystal/internal/NCMath.hh"
 
 namespace NC = NCrystal;
 
-NC::BkgdExtCurve::BkgdExtCurve( shared_obj<const Info> ci )
+NC::BkgdExtCurve::BkgdExtCurve( shared_obj<const Info> ci, double tolerance,
+                                NeutronEnergy emin, NeutronEnergy emax )
   : m_ci(std::move(ci))
 {
   if (!m_ci->providesNonBraggXSects())
     NCRYSTAL_THROW(MissingInfo,"BkgdExtCurve: Passed Info object lacks NonBraggXSects needed for cross sections.");
+  if ( !( tolerance > 0.0 ) )
+    return;
+  if ( !( emin.dbl() > 0.0 ) || !( emax > emin ) || !std::isfinite(emax.dbl()) )
+    NCRYSTAL_THROW(BadInput,"BkgdExtCurve: Invalid energy range for tabulation.");
+
+  //Start from a grid with 10 points per decade, and split intervals (at their
+  //logarithmic midpoint) as long as linear interpolation is not precise enough
+  //at any of several interior test points. Discontinuities are resolved down
+  //to a relative energy interval width of min_relwidth:
+  constexpr double min_relwidth = 1e-9;
+  constexpr unsigned ntestdiv = 8;
+  constexpr std::size_t npts_max = 100000;
+  auto exact = [this]( double e ) { return m_ci->xsectScatNonBragg( NeutronEnergy{e} ).get(); };
+  auto intervalIsOK = [&exact,tolerance]( double ea, double xa, double eb, double xb )
+  {
+    if ( eb - ea < min_relwidth * ea )
+      return true;
+    for ( unsigned k = 1; k < ntestdiv; ++k ) {
+      const double e = ea * std::pow( eb / ea, double(k) / ntestdiv );
+      const double xs = exact( e );
+      const double interp = xa + ( e - ea ) * ( xb - xa ) / ( eb - ea );
+      if ( !( ncabs( interp - xs ) <= tolerance * xs ) )
+        return false;
+    }
+    return true;
+  };
+  const double ndecades = std::log10( emax.dbl() / emin.dbl() );
+  VectD todo_e = logspace( std::log10( emin.dbl() ), std::log10( emax.dbl() ),
+                           std::max<unsigned>( 2, static_cast<unsigned>( std::ceil( ndecades * 10 ) ) + 1 ) );
+  todo_e.front() = emin.dbl();
+  todo_e.back() = emax.dbl();
+  //The todo lists hold points in decreasing order of energy, completed points
+  //are transferred to the table:
+  std::reverse( todo_e.begin(), todo_e.end() );
+  VectD todo_xs;
+  todo_xs.reserve( todo_e.size() );
+  for ( auto e : todo_e )
+    todo_xs.push_back( exact( e ) );
+  m_egrid.push_back( todo_e.back() );
+  m_xs.push_back( todo_xs.back() );
+  todo_e.pop_back();
+  todo_xs.pop_back();
+  while ( !todo_e.empty() ) {
+    const double ea = m_egrid.back();
+    const double xa = m_xs.back();
+    const double eb = todo_e.back();
+    const double xb = todo_xs.back();
+    if ( m_egrid.size() + todo_e.size() >= npts_max || intervalIsOK( ea, xa, eb, xb ) ) {
+      m_egrid.push_back( eb );
+      m_xs.push_back( xb );
+      todo_e.pop_back();
+      todo_xs.pop_back();
+    } else {
+      const double emid = std::sqrt( ea * eb );
+      todo_e.push_back( emid );
+      todo_xs.push_back( exact( emid ) );
+    }
+  }
+  m_egrid.shrink_to_fit();
+  m_xs.shrink_to_fit();
 }
 
 NC::BkgdExtCurve::~BkgdExtCurve() = default;
 
+double NC::BkgdExtCurve::evalXS( double ekin ) const
+{
+  if ( m_egrid.empty() || !( ekin >= m_egrid.front() ) || ekin > m_egrid.back() )
+    return m_ci->xsectScatNonBragg( NeutronEnergy{ekin} ).get();
+  auto it = std::upper_bound( m_egrid.begin(), m_egrid.end(), ekin );
+  if ( it == m_egrid.end() )
+    return m_xs.back();
+  const std::size_t i = std::distance( m_egrid.begin(), it );
+  nc_assert( i > 0 );
+  const double ea = m_egrid[i-1];
+  const double xa = m_xs[i-1];
+  return xa + ( ekin - ea ) * ( m_xs[i] - xa ) / ( m_egrid[i] - ea );
+}
+
 NC::CrossSect NC::BkgdExtCurve::crossSectionIsotropic(NC::CachePtr&, NC::NeutronEnergy ekin ) const
 {
-  return m_ci->xsectScatNonBragg(ekin);
+  return CrossSect{ evalXS( ekin.dbl() ) };
+}
+
+void NC::BkgdExtCurve::crossSectionIsotropicMany( NC::CachePtr&, const double* ekin,
+                                                   std::size_t N, double* out_xs ) const
+{
+  for ( std::size_t i = 0; i < N; ++i )
+    out_xs[i] = evalXS( ekin[i] );
+}
+
+std::size_t NC::BkgdExtCurve::memoryFootprint() const
+{
+  return sizeof(BkgdExtCurve) + sizeof(double) * ( m_egrid.capacity() + m_xs.capacity() );
 }
 
 NC::ScatterOutcomeIsotropic NC::BkgdExtCurve::sampleScatterIsotropic( CachePtr&,
@@ -50,3 +138,19 @@ NC::ScatterOutcome NC::BkgdExtCurve::sampleScatter( CachePtr&, RNG& rng, Neutron
   //Elastic, isotropic.
   return { ekin, randIsotropicNeutronDirection(rng) };
 }
+
+void NC::BkgdExtCurve::sampleScatterMany( CachePtr&, RNG& rng, const double* ekin, const NeutronDirection*,
+                                          std::size_t N, ScatterOutcome* out ) const
+{
+  //Elastic, isotropic (no need to go via mu values):
+  for ( std::size_t i = 0; i < N; ++i )
+    out[i] = { NeutronEnergy{ ekin[i] }, randIsotropicNeutronDirection(rng) };
+}
+
+void NC::BkgdExtCurve::sampleScatterIsotropicMany( CachePtr&, RNG& rng, const double* ekin,
+                                                   std::size_t N, ScatterOutcomeIsotropic* out ) const
+{
+  //Elastic, isotropic:
+  for ( std::size_t i = 0; i < N; ++i )
+    out[i] = { NeutronEnergy{ ekin[i] }, randIsotropicScatterMu( rng ) };
+}
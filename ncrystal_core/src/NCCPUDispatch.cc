@@ -0,0 +1,96 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/internal/NCCPUDispatch.hh"
+#include "NCrystal/internal/NCString.hh"
+#include <iostream>
+
+namespace NC = NCrystal;
+
+namespace NCrystal {
+  namespace CPUDispatch {
+    namespace {
+      ISA detectISA()
+      {
+#ifdef NCRYSTAL_SIMD_DISPATCH_X86
+        __builtin_cpu_init();
+        if ( __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") )
+          return ISA::AVX512;
+        if ( __builtin_cpu_supports("avx2") )
+          return ISA::AVX2;
+#endif
+        return ISA::Baseline;
+      }
+
+      ISA determineActiveISA()
+      {
+        const ISA supported = supportedISA();
+        const std::string req = ncgetenv("SIMD");
+        if ( req.empty() )
+          return supported;
+        ISA requested;
+        if ( req == "baseline" || req == "sse2" || req == "neon" || req == "generic" )
+          requested = ISA::Baseline;
+        else if ( req == "avx2" )
+          requested = ISA::AVX2;
+        else if ( req == "avx512" )
+          requested = ISA::AVX512;
+        else
+          NCRYSTAL_THROW2(BadInput,"Invalid value of environment variable NCRYSTAL_SIMD (expected"
+                          " \"baseline\", \"avx2\" or \"avx512\" but got \""<<req<<"\").");
+        if ( static_cast<unsigned>( requested ) > static_cast<unsigned>( supported ) ) {
+          std::cout<<"NCrystal WARNING: NCRYSTAL_SIMD="<<req<<" is not supported by the CPU (or"
+            " not compiled in), using "<<isaName(supported)<<" instead."<<std::endl;
+          return supported;
+        }
+        return requested;
+      }
+    }
+  }
+}
+
+NC::CPUDispatch::ISA NC::CPUDispatch::supportedISA()
+{
+  static const ISA s_isa = detectISA();
+  return s_isa;
+}
+
+NC::CPUDispatch::ISA NC::CPUDispatch::activeISA()
+{
+  static const ISA s_isa = determineActiveISA();
+  return s_isa;
+}
+
+const char * NC::CPUDispatch::isaName( ISA isa )
+{
+  switch ( isa ) {
+  case ISA::AVX512: return "avx512";
+  case ISA::AVX2: return "avx2";
+  case ISA::Baseline:
+#if defined(__x86_64__) || defined(_M_X64)
+    return "sse2";
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+    return "neon";
+#else
+    return "baseline";
+#endif
+  }
+  return "baseline";
+}
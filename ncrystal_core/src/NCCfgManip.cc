@@ -352,6 +352,17 @@ bool NC::Cfg::CfgManip::equal( const CfgData& a, const CfgData& b )
   return true;
 }
 
+NC::HashValue NC::Cfg::CfgManip::hash( const CfgData& data )
+{
+  HashValue h = calcHash( data().size() );
+  for ( auto& e : data() ) {
+    auto varid = static_cast<VarId>(e.metaData());
+    hash_combine( h, static_cast<std::uint32_t>(varid) );
+    hash_combine( h, varInfo( varid ).bufHash( e ) );
+  }
+  return h;
+}
+
 bool NC::Cfg::CfgManip::isSingleCrystal(const CfgData& data)
 {
   for ( auto& e : data() ) {
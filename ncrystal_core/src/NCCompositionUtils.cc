@@ -64,114 +64,185 @@ namespace NCrystal {
   }
 }
 
+namespace NCrystal {
+  namespace {
+    struct CheckedNatAbProvider {
+      //Wraps NaturalAbundanceProvider, checking and normalising the results:
+      const CU::NaturalAbundanceProvider& natabprov_raw;
+      std::vector<std::pair<unsigned,double>> operator()( unsigned Z ) const
+      {
+        auto natab = natabprov_raw(Z);
+        if ( natab.empty() )
+          NCRYSTAL_THROW2(CalcError,"Could not determine natural abundances for Z="<<Z);
+        StableSum sumnatab;
+        for (auto& Afrac : natab)
+          sumnatab.add(Afrac.second);
+        if ( std::abs(sumnatab.sum()-1.0)>1e-5 )
+          NCRYSTAL_THROW2(CalcError,"Invalid (does not add up to 1) natural abundances for Z="<<Z);
+        double corrfact = 1.0/sumnatab.sum();
+        for (auto& Afrac : natab)
+          Afrac.second *= corrfact;
+        return natab;
+      }
+    };
+
+    CU::FullBreakdown breakdownFromZAfrac( Flat_ZAfrac& zafrac,
+                                           const CheckedNatAbProvider& natabprov,
+                                           CU::ForceIsotopesChoice forceiso )
+    {
+      using CU::ForceIsotopes;
+      using CU::FullBreakdown;
+      //Ok, we now have everything in a flat structure of (Z,A,fraction) values. We
+      //now sort the zafrac vector. We don't need stable sort since identical entries
+      //are... identical.
+      std::sort(zafrac.begin(),zafrac.end());
+
+      //Do one pass where we expand any natural elements that must be expanded (not
+      //needed if we already forced iso expansion in collect_ZAfrac):
+
+      auto getZ = [&zafrac] ( unsigned i ) { nc_assert(i<zafrac.size()); return std::get<0>(zafrac[i]); };
+      auto getA = [&zafrac] ( unsigned i ) { nc_assert(i<zafrac.size()); return std::get<1>(zafrac[i]); };
+      auto getFrac = [&zafrac] ( unsigned i ) ->double& { nc_assert(i<zafrac.size()); return std::get<2>(zafrac[i]); };
+
+      if ( forceiso != ForceIsotopes ) {
+        //Bla loop via unsigned idx  and append any expanded isotopes at the end (while setting frac=0 for the A=0 entries that were expanded).
+        nc_assert_always(  (uint64_t)zafrac.size() < (uint64_t)(std::numeric_limits<unsigned>::max()) );
+        const unsigned nnzafrac = zafrac.size();
+        for (unsigned i = 0; i < nnzafrac; ) {
+          unsigned zval = getZ(i);
+          bool hasNonNat(false);
+          StableSum fractNat;
+          unsigned inext = i;
+          for ( ; (inext < nnzafrac && getZ(inext) == zval ); ++inext ) {
+            if ( getA(inext) == 0 ) {
+              fractNat.add( getFrac(inext) );
+              getFrac(inext) = 0.0;
+            } else {
+              hasNonNat = true;
+            }
+          }
+          if ( fractNat.sum() > 0.0 ) {
+            if ( !hasNonNat ) {
+              //oups, we nulled out the fractions of all (zval,A=0) entries when we
+              //shouldn't have. Restore.
+              assert( getA(i) == 0 && getFrac(i) == 0.0 );
+              getFrac(i) = fractNat.sum();
+            } else {
+              //We must split a natural element into isotopes and append (with
+              //weight fractNat):
+              for (auto& Afrac : natabprov(zval))
+                zafrac.emplace_back(zval,Afrac.first,Afrac.second*fractNat.sum());
+            }
+          }
+          i = inext;
+        }
+        //Resort:
+        std::sort(zafrac.begin(),zafrac.end());
+      }
+
+      //Now, loop through zafrac, combining adjacant isotopes with same Z,A values,
+      //and filling FullBreakdown result.. Remember to ignore entries with
+      //fraction=0. At this point, all Z entries must be either expanded in
+      //isotopes, or consist of just natural elements.
+
+      FullBreakdown result;
+
+      nc_assert_always(  (uint64_t)zafrac.size() < (uint64_t)(std::numeric_limits<unsigned>::max()) );
+      const unsigned nzafrac = zafrac.size();
+
+      for (unsigned i = 0; i < nzafrac; ) {
+        unsigned zval = getZ(i);
+        std::vector<std::pair<unsigned,StableSum>> current;
+        unsigned inext = i;
+        for ( ; (inext < nzafrac && getZ(inext) == zval ); ++inext ) {
+          if ( getFrac(inext) == 0.0 )
+            continue;
+          if ( current.empty() || current.back().first != getA(inext) ) {
+            StableSum newsum;
+            newsum.add(getFrac(inext));//Todo: StableSum constructor with initial value parameter?
+            current.emplace_back( getA(inext), newsum );
+          } else {
+            current.back().second.add( getFrac(inext) );
+          }
+        }
+        i = inext;
+
+        std::vector<std::pair<unsigned,double>> current_dbls;
+        current_dbls.reserve(current.size());
+        for (const auto& e : current)
+          current_dbls.emplace_back(e.first,e.second.sum());
+        result.emplace_back( zval, std::move(current_dbls) );
+      }
+      return result;
+    }
+  }
+}
+
 NC::CU::FullBreakdown NC::CU::createFullBreakdown( const Info::Composition& composition,
                                                    const NC::CU::NaturalAbundanceProvider& natabprov_raw,
                                                    NC::CU::ForceIsotopesChoice forceiso )
 {
   Flat_ZAfrac zafrac;
   zafrac.reserve( composition.size()*4 );
-
-  auto natabprov = [&natabprov_raw](unsigned Z)
-  {
-    auto natab = natabprov_raw(Z);
-    if ( natab.empty() )
-      NCRYSTAL_THROW2(CalcError,"Could not determine natural abundances for Z="<<Z);
-    StableSum sumnatab;
-    for (auto& Afrac : natab)
-      sumnatab.add(Afrac.second);
-    if ( std::abs(sumnatab.sum()-1.0)>1e-5 )
-      NCRYSTAL_THROW2(CalcError,"Invalid (does not add up to 1) natural abundances for Z="<<Z);
-    double corrfact = 1.0/sumnatab.sum();
-    for (auto& Afrac : natab)
-      Afrac.second *= corrfact;
-    return natab;
-  };
+  CheckedNatAbProvider natabprov{ natabprov_raw };
 
   for ( const auto& ce : composition) {
     nc_assert( ce.fraction > 0.0 && ce.fraction<= 1.0 );
     collect_ZAfrac( zafrac, ce.atom.data(), ce.fraction, natabprov, forceiso );
   }
+  return breakdownFromZAfrac( zafrac, natabprov, forceiso );
+}
 
-  //Ok, we now have everything in a flat structure of (Z,A,fraction) values. We
-  //now sort the zafrac vector. We don't need stable sort since identical entries
-  //are... identical.
-  std::sort(zafrac.begin(),zafrac.end());
-
-  //Do one pass where we expand any natural elements that must be expanded (not
-  //needed if we already forced iso expansion in collect_ZAfrac):
-
-  auto getZ = [&zafrac] ( unsigned i ) { nc_assert(i<zafrac.size()); return std::get<0>(zafrac[i]); };
-  auto getA = [&zafrac] ( unsigned i ) { nc_assert(i<zafrac.size()); return std::get<1>(zafrac[i]); };
-  auto getFrac = [&zafrac] ( unsigned i ) ->double& { nc_assert(i<zafrac.size()); return std::get<2>(zafrac[i]); };
-
-  if ( forceiso != ForceIsotopes ) {
-    //Bla loop via unsigned idx  and append any expanded isotopes at the end (while setting frac=0 for the A=0 entries that were expanded).
-    nc_assert_always(  (uint64_t)zafrac.size() < (uint64_t)(std::numeric_limits<unsigned>::max()) );
-    const unsigned nnzafrac = zafrac.size();
-    for (unsigned i = 0; i < nnzafrac; ) {
-      unsigned zval = getZ(i);
-      bool hasNonNat(false);
-      StableSum fractNat;
-      unsigned inext = i;
-      for ( ; (inext < nnzafrac && getZ(inext) == zval ); ++inext ) {
-        if ( getA(inext) == 0 ) {
-          fractNat.add( getFrac(inext) );
-          getFrac(inext) = 0.0;
-        } else {
-          hasNonNat = true;
-        }
-      }
-      if ( fractNat.sum() > 0.0 ) {
-        if ( !hasNonNat ) {
-          //oups, we nulled out the fractions of all (zval,A=0) entries when we
-          //shouldn't have. Restore.
-          assert( getA(i) == 0 && getFrac(i) == 0.0 );
-          getFrac(i) = fractNat.sum();
-        } else {
-          //We must split a natural element into isotopes and append (with
-          //weight fractNat):
-          for (auto& Afrac : natabprov(zval))
-            zafrac.emplace_back(zval,Afrac.first,Afrac.second*fractNat.sum());
-        }
-      }
-      i = inext;
+NC::CU::FullBreakdown NC::CU::createFullBreakdown( const Info& info,
+                                                   const NC::CU::NaturalAbundanceProvider& natabprov_raw,
+                                                   NC::CU::ForceIsotopesChoice forceiso )
+{
+  const Info::FlatComposition& flatcomp = info.getFlatComposition();
+  Flat_ZAfrac zafrac;
+  zafrac.reserve( flatcomp.size()*4 );
+  CheckedNatAbProvider natabprov{ natabprov_raw };
+  for ( const auto& e : flatcomp ) {
+    if ( e.A == 0 && forceiso == ForceIsotopes ) {
+      for (auto& Afrac : natabprov(e.Z))
+        zafrac.emplace_back(e.Z,Afrac.first,Afrac.second*e.fraction);
+    } else {
+      zafrac.emplace_back(e.Z,e.A,e.fraction);
     }
-    //Resort:
-    std::sort(zafrac.begin(),zafrac.end());
   }
+  return breakdownFromZAfrac( zafrac, natabprov, forceiso );
+}
 
-  //Now, loop through zafrac, combining adjacant isotopes with same Z,A values,
-  //and filling FullBreakdown result.. Remember to ignore entries with
-  //fraction=0. At this point, all Z entries must be either expanded in
-  //isotopes, or consist of just natural elements.
-
-  FullBreakdown result;
-
-  nc_assert_always(  (uint64_t)zafrac.size() < (uint64_t)(std::numeric_limits<unsigned>::max()) );
-  const unsigned nzafrac = zafrac.size();
-
-  for (unsigned i = 0; i < nzafrac; ) {
-    unsigned zval = getZ(i);
-    std::vector<std::pair<unsigned,StableSum>> current;
-    unsigned inext = i;
-    for ( ; (inext < nzafrac && getZ(inext) == zval ); ++inext ) {
-      if ( getFrac(inext) == 0.0 )
-        continue;
-      if ( current.empty() || current.back().first != getA(inext) ) {
-        StableSum newsum;
-        newsum.add(getFrac(inext));//Todo: StableSum constructor with initial value parameter?
-        current.emplace_back( getA(inext), newsum );
-      } else {
-        current.back().second.add( getFrac(inext) );
-      }
-    }
-    i = inext;
+NC::Info::FlatComposition NC::CU::flattenComposition( const Info::Composition& composition )
+{
+  Flat_ZAfrac zafrac;
+  zafrac.reserve( composition.size()*4 );
+  //Natural elements are kept as they are, so the abundance provider is never
+  //needed:
+  auto no_natabprov = []( unsigned ) -> std::vector<std::pair<unsigned,double>>
+  {
+    nc_assert_always(false);
+    return {};
+  };
+  for ( const auto& ce : composition) {
+    nc_assert( ce.fraction > 0.0 && ce.fraction<= 1.0 );
+    collect_ZAfrac( zafrac, ce.atom.data(), ce.fraction, no_natabprov, PreferNaturalElements );
+  }
+  std::sort(zafrac.begin(),zafrac.end());
 
-    std::vector<std::pair<unsigned,double>> current_dbls;
-    current_dbls.reserve(current.size());
-    for (const auto& e : current)
-      current_dbls.emplace_back(e.first,e.second.sum());
-    result.emplace_back( zval, std::move(current_dbls) );
+  //Combine entries with identical (Z,A) values:
+  Info::FlatComposition result;
+  result.reserve( zafrac.size() );
+  for ( std::size_t i = 0; i < zafrac.size(); ) {
+    const unsigned zval = std::get<0>(zafrac[i]);
+    const unsigned aval = std::get<1>(zafrac[i]);
+    StableSum fraction;
+    for ( ; i < zafrac.size() && std::get<0>(zafrac[i]) == zval && std::get<1>(zafrac[i]) == aval; ++i )
+      fraction.add( std::get<2>(zafrac[i]) );
+    Info::FlatCompositionEntry e;
+    e.Z = zval;
+    e.A = aval;
+    e.fraction = fraction.sum();
+    result.push_back( e );
   }
   return result;
 }
@@ -282,6 +353,23 @@ NC::CU::ElementBreakdownLW::ElementBreakdownLW(const NC::CU::FullElementBreakdow
   nc_assert(valid());
 }
 
+namespace NCrystal {
+  namespace {
+    CU::LWBreakdown fullToLWBreakdown( const CU::FullBreakdown& bd )
+    {
+      CU::LWBreakdown lwbd;
+      lwbd.reserve(bd.size());
+      for (const auto& e : bd) {
+        StableSum totfrac;
+        for (auto af: e.second)
+          totfrac.add( af.second );
+        lwbd.emplace_back(totfrac.sum(),CU::ElementBreakdownLW(e));
+      }
+      return lwbd;
+    }
+  }
+}
+
 NC::CU::LWBreakdown NC::CU::createLWBreakdown( const Info::Composition& a,
                                                const NaturalAbundanceProvider& b,
                                                ForceIsotopesChoice c )
@@ -290,14 +378,12 @@ NC::CU::LWBreakdown NC::CU::createLWBreakdown( const Info::Composition& a,
   //fractions (esp in ElementBreakdownLW constructor)? That could reduce chances
   //that tiny numerical issues in fraction calculations could spoil caching. It
   //is, however, likely to be a rather rare issue...
-  FullBreakdown bd = createFullBreakdown(a,b,c);
-  LWBreakdown lwbd;
-  lwbd.reserve(bd.size());
-  for (const auto& e : bd) {
-    StableSum totfrac;
-    for (auto af: e.second)
-      totfrac.add( af.second );
-    lwbd.emplace_back(totfrac.sum(),ElementBreakdownLW(e));
-  }
-  return lwbd;
+  return fullToLWBreakdown( createFullBreakdown(a,b,c) );
+}
+
+NC::CU::LWBreakdown NC::CU::createLWBreakdown( const Info& a,
+                                               const NaturalAbundanceProvider& b,
+                                               ForceIsotopesChoice c )
+{
+  return fullToLWBreakdown( createFullBreakdown(a,b,c) );
 }
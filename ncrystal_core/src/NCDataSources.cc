@@ -20,8 +20,14 @@
 
 #include "NCrystal/NCDataSources.hh"
 #include "NCrystal/NCFactImpl.hh"
+#include "NCrystal/NCParseNCMAT.hh"
 #include "NCrystal/internal/NCString.hh"
 #include "NCrystal/internal/NCFileUtils.hh"
+#include "NCrystal/NCMem.hh"
+#include "NCrystal/internal/NCThreadUtils.hh"
+#include "NCrystal/NCFact.hh"
+#include <unordered_set>
+#include <map>
 #include "NCrystal/NCPluginMgmt.hh"
 
 namespace NC = NCrystal;
@@ -116,6 +122,116 @@ namespace NCrystal {
       return out;
     }
 
+    //Cache of directory listings, used to resolve relative paths in search
+    //directories without reading the directories for every lookup. Before a
+    //listing is relied upon, the modification time of the directory is
+    //checked (see findInDirs), so lookups in unchanged directories cost a
+    //single stat call per directory, and listings are refreshed when files are
+    //added or removed. Can be disabled by setting NCRYSTAL_DISABLE_DIRCACHE,
+    //and is cleared by NCrystal::clearCaches() and
+    //DataSources::removeAllDataSources():
+    class DirIndexCache : private NoCopyMove {
+    public:
+      DirIndexCache()
+        : m_enabled( !ncgetenv_bool("DISABLE_DIRCACHE") )
+      {
+        registerCacheCleanupFunction([this](){ clear(); });
+      }
+
+      //Check if relpath exists inside dir. If recheck is true, the cached
+      //listings are refreshed first if the directories have been modified:
+      bool exists( const std::string& dir, const std::string& relpath, bool recheck )
+      {
+        if ( !m_enabled )
+          return file_exists( path_join( dir, relpath ) );
+        auto parts = split2( relpath, 0, '/' );
+        for ( auto& e : parts ) {
+          if ( e.empty() || e == "." || contains( e, '\\' ) )
+            return file_exists( path_join( dir, relpath ) );//unusual, don't cache
+        }
+        std::string curdir = dir;
+        for ( std::size_t i = 0; i < parts.size(); ++i ) {
+          auto idx = getIndex( curdir, recheck );
+          if ( !idx->entries.count( parts.at(i) ) )
+            return false;
+          if ( i + 1 < parts.size() )
+            curdir = path_join( curdir, parts.at(i) );
+        }
+        return true;
+      }
+
+      void clear()
+      {
+        NCRYSTAL_LOCK_GUARD(m_mtx);
+        m_db.clear();
+      }
+
+    private:
+      struct DirIndex {
+        std::unordered_set<std::string> entries;
+        Optional<int64_t> mtime;
+      };
+      using DirIndexSP = std::shared_ptr<const DirIndex>;
+      std::mutex m_mtx;
+      std::map<std::string,DirIndexSP> m_db;
+      const bool m_enabled;
+
+      DirIndexSP getIndex( const std::string& dir, bool recheck )
+      {
+        NCRYSTAL_LOCK_GUARD(m_mtx);
+        auto it = m_db.find( dir );
+        if ( it != m_db.end() && !recheck )
+          return it->second;
+        //Get mtime before listing, so changes happening while listing will
+        //always trigger another listing on the next recheck:
+        auto mtime = fileModificationTime( dir );
+        if ( it != m_db.end() && mtime.has_value() && it->second->mtime == mtime )
+          return it->second;
+        auto idx = std::make_shared<DirIndex>();
+        idx->mtime = std::move(mtime);
+        auto listing = listDirectory( dir );
+        if ( listing.has_value() ) {
+          for ( auto& e : listing.value() )
+            idx->entries.insert( std::move(e) );
+        }
+        DirIndexSP res = std::move(idx);
+        m_db[dir] = res;
+        return res;
+      }
+    };
+
+    DirIndexCache& dirIndexCache() { static DirIndexCache db; return db; }
+
+    //Find index of first directory (as returned by getDir(i) for i in
+    //[0,n)) containing relpath, or n if not found. The (possibly outdated)
+    //cached listings are only used to find a candidate directory, after which
+    //that directory and all directories before it are rechecked, so files
+    //recently added to earlier directories (or removed from the candidate)
+    //are taken into account. Without a candidate, all directories are
+    //rechecked:
+    template<class TGetDir>
+    std::size_t findInDirs( std::size_t n, TGetDir getDir, const std::string& relpath )
+    {
+      auto& db = dirIndexCache();
+      std::size_t nrecheck = n;
+      for ( std::size_t i = 0; i < n; ++i ) {
+        if ( db.exists( getDir(i), relpath, false ) ) {
+          nrecheck = i + 1;
+          break;
+        }
+      }
+      for ( std::size_t i = 0; i < nrecheck; ++i )
+        if ( db.exists( getDir(i), relpath, true ) )
+          return i;
+      if ( nrecheck == n )
+        return n;
+      //Candidate was removed, recheck remaining directories as well:
+      for ( std::size_t i = nrecheck; i < n; ++i )
+        if ( db.exists( getDir(i), relpath, true ) )
+          return i;
+      return n;
+    }
+
     class TDFact_RelPath final : public FactImpl::TextDataFactory {
       std::string resolve( const TextDataPath& p ) const {
         if ( path_is_absolute( p.path() ) )
@@ -159,12 +275,10 @@ namespace NCrystal {
         //potentially legal but highly dubious use-cases).
         if ( contains( p.path(), ".." ) )
           return {};
-        for ( auto& dir : m_dirList ) {
-          std::string s = path_join( dir, p.path() );
-          if ( file_exists(s) )
-            return s;
-        }
-        return {};
+        auto i = findInDirs( m_dirList.size(),
+                             [this](std::size_t j) -> const std::string& { return m_dirList[j]; },
+                             p.path() );
+        return i < m_dirList.size() ? path_join( m_dirList[i], p.path() ) : std::string();
       }
     public:
       TDFact_DirList( VectS&& dirs, std::string name, Priority priority )
@@ -214,11 +328,11 @@ namespace NCrystal {
           return { Priority::Unable, {} };
         auto & cdl = getCustomDirList();
         NCRYSTAL_LOCK_GUARD(cdl.mtx);
-        for ( auto& e : cdl.dirList ) {
-          std::string s = path_join( e.second, p.path() );
-          if ( file_exists(s) )
-            return {e.first,s};
-        }
+        auto i = findInDirs( cdl.dirList.size(),
+                             [&cdl](std::size_t j) -> const std::string& { return cdl.dirList[j].second; },
+                             p.path() );
+        if ( i < cdl.dirList.size() )
+          return { cdl.dirList[i].first, path_join( cdl.dirList[i].second, p.path() ) };
         return { Priority::Unable, {} };
       }
     public:
@@ -270,10 +384,18 @@ namespace NCrystal {
   //registerEmbeddedNCMAT with the virtual filenames and addresses of the
   //embedded data.
   namespace AutoGenNCMAT { void registerStdNCMAT(); }//fwd declared - linked in elsewhere
+#  ifdef NCRYSTAL_STDCMAKECFG_EMBED_PREPARSED_ON
+  //With -DEMBED_DATA_PREPARSED=ON, an additional autogenerated function
+  //NCrystal::AutoGenNCMAT::registerStdNCMATPreParsed will invoke
+  //registerEmbeddedPreParsedNCMAT with binary encoded NCMATData objects (made
+  //at build time by ncrystal_ncmat2bin), to avoid parsing at runtime:
+  namespace AutoGenNCMAT { void registerStdNCMATPreParsed(); }//fwd declared - linked in elsewhere
+#  endif
 
   namespace DataSources {
     struct StdDataLibInMemDB {
       std::map<std::string,TextDataSource> virtFileMap;
+      std::map<std::string,const char*> staticDataPtrs;
       std::mutex mtx;
     };
     StdDataLibInMemDB& getStdDataLibInMemDB()
@@ -292,7 +414,23 @@ namespace NCrystal {
       NCRYSTAL_LOCK_GUARD(db.mtx);
       nc_map_force_emplace( db.virtFileMap, name,
                             TextDataSource::createFromInMemData( RawStrData( RawStrData::static_data_ptr_t(), static_data) ) );
+      db.staticDataPtrs[name] = static_data;
     }
+#  ifdef NCRYSTAL_STDCMAKECFG_EMBED_PREPARSED_ON
+    void registerEmbeddedPreParsedNCMAT( const char* name, const unsigned char* static_data, std::size_t len )
+    {
+      const char * static_text_data = nullptr;
+      {
+        auto& db = NCD::getStdDataLibInMemDB();
+        NCRYSTAL_LOCK_GUARD(db.mtx);
+        auto it = db.staticDataPtrs.find( name );
+        if ( it != db.staticDataPtrs.end() )
+          static_text_data = it->second;
+      }
+      if ( static_text_data )
+        registerPreParsedNCMATData( static_text_data, static_data, len );
+    }
+#  endif
   }
 #else
   //On-disk standard data library:
@@ -359,6 +497,9 @@ void NCD::enableStandardDataLibrary( bool doEnable, Optional<std::string> reques
       if ( first ) {
         first = false;
         AutoGenNCMAT::registerStdNCMAT();//trigger db.virtFileMap filling
+#  ifdef NCRYSTAL_STDCMAKECFG_EMBED_PREPARSED_ON
+        AutoGenNCMAT::registerStdNCMATPreParsed();//must come after registerStdNCMAT
+#  endif
       }
     }
     NCRYSTAL_LOCK_GUARD(db.mtx);
@@ -536,12 +677,20 @@ namespace NCrystal {
                                     Priority priority )
     {
       validateVirtFilename(virtualFilename);
-      auto& vfs = virtualFilesSharedData();
-      NCRYSTAL_LOCK_GUARD(vfs.mtx);
-      const bool was_empty = vfs.virtualFiles.empty();
-      nc_map_force_emplace( vfs.virtualFiles, virtualFilename, std::move(tsd), priority );
-      if ( was_empty )
-        FactImpl::registerFactory(std::make_unique<TDFact_VirtualFiles>());
+      bool replaced = false;
+      {
+        auto& vfs = virtualFilesSharedData();
+        NCRYSTAL_LOCK_GUARD(vfs.mtx);
+        const bool was_empty = vfs.virtualFiles.empty();
+        replaced = vfs.virtualFiles.count( virtualFilename ) > 0;
+        nc_map_force_emplace( vfs.virtualFiles, virtualFilename, std::move(tsd), priority );
+        if ( was_empty )
+          FactImpl::registerFactory(std::make_unique<TDFact_VirtualFiles>());
+      }
+      //Objects created from the old data can no longer be requested, so
+      //release them (leaving caches of other materials untouched):
+      if ( replaced )
+        FactImpl::evictFromCachesByDataSourceName( virtualFilename );
     }
   }
 
@@ -723,8 +872,26 @@ void NCD::removeAllDataSources()
     NCRYSTAL_LOCK_GUARD(vfs.mtx);
     vfs.virtualFiles.clear();
   }
-  ::NCrystal::clearCaches();
+  //Only objects created from input data are affected (caches of data
+  //independent objects, like Debye model kernels, are kept):
+  FactImpl::evictFromCachesByDataSourceName( std::string() );
+  dirIndexCache().clear();
   //NB: We do not clear out the extensionsDB(), as the Info factories are not
   //unloaded and users might add new data sources. If stdlib is embedded we also
   //leave it alone, so it can be enabled again.
 }
+
+std::vector<NC::TextDataSP> NCD::resolveMany( const VectS& names )
+{
+  std::vector<OptionalTextDataSP> tmp( names.size() );
+  parallelForIndex( names.size(), getNumberOfThreads(),
+                    [&names,&tmp]( std::size_t i )
+                    {
+                      tmp[i] = FactImpl::createTextData( names[i] );
+                    } );
+  std::vector<TextDataSP> result;
+  result.reserve( names.size() );
+  for ( auto& td : tmp )
+    result.emplace_back( std::move(td) );
+  return result;
+}
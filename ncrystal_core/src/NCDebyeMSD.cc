@@ -20,7 +20,6 @@
 
 #include "NCrystal/internal/NCDebyeMSD.hh"
 #include "NCrystal/internal/NCMath.hh"
-#include "NCrystal/internal/NCRomberg.hh"
 
 namespace NC = NCrystal;
 
@@ -46,24 +45,48 @@ double NC::calcDebyeMSDScale( DebyeTemperature dt, AtomMass am )
 }
 
 namespace NCrystal {
-  class DebyeMSDShapeIntegral : public Romberg {
-  public:
-    //Integrate function f(x)=x/(exp(x)-1)
-    DebyeMSDShapeIntegral() {}
-    virtual ~DebyeMSDShapeIntegral() {}
-    virtual double evalFunc(double x) const {
-      if (ncabs(x)<1e-4) {
-        //evaluate via Taylor expansion for numerical stability
-        double x2=x*x;
-        return 1-x*0.5+x2*0.08333333333333333333333333333333-x2*x2*0.00138888888888888888888888888888888889;
-      }
-      return x / std::expm1(x);
-    }
-    virtual bool accept(unsigned lvl, double prev_estimate, double estimate,double,double) const
+  namespace {
+    double debyeMSDShapeIntegral( double u )
     {
-      return lvl>11 || (lvl > 7 && ncabs(estimate-prev_estimate)<1e-10);
+      //Evaluates integral_{0}^{u}[x/(exp(x)-1)]dx to machine precision with
+      //rapidly converging series rather than numerical integration (this is
+      //called for each atom of each material loaded, and repeatedly during
+      //debyeTempFromIsotropicMSD). For small u, the integrand is expanded with
+      //the Bernoulli numbers, x/(exp(x)-1)=1-x/2+sum_m B_2m*x^2m/(2m)!, which
+      //converges for u<2pi. For larger u, the integral is pi^2/6 minus the
+      //tail, which for each term in 1/(exp(x)-1)=sum_k exp(-kx) can be
+      //integrated analytically:
+      nc_assert( u >= 0.0 );
+      if ( u < 2.0 ) {
+        //Coefficients B_2m/((2m+1)*(2m)!) for m=1..16:
+        static constexpr double c[16] = {  0.027777777777777776, -0.00027777777777777778,
+                                           4.7241118669690098e-06, -9.1857730746619641e-08,
+                                           1.8978869988971001e-09, -4.0647616451442256e-11,
+                                           8.9216910204564523e-13, -1.9939295860721074e-14,
+                                           4.5189800296199183e-16, -1.0356517612181247e-17,
+                                           2.395218621026187e-19, -5.581785874325009e-21,
+                                           1.3091507554183213e-22, -3.0874198024267403e-24,
+                                           7.3159756527022029e-26, -1.7408456572340009e-27 };
+        const double u2 = u * u;
+        double series = c[15];
+        for ( int m = 14; m >= 0; --m )
+          series = c[m] + u2 * series;
+        return u * ( 1.0 - 0.25 * u + u2 * series );
+      }
+      //sum_k exp(-ku)*(u/k+1/k^2), with at most 20 terms needed for u>=2:
+      const double expmu = std::exp( -u );
+      double tail = 0.0;
+      double expmku = 1.0;
+      for ( unsigned k = 1; k <= 40; ++k ) {
+        expmku *= expmu;
+        const double term = expmku * ( u + 1.0 / k ) / k;
+        tail += term;
+        if ( term < 1e-18 * tail )
+          break;
+      }
+      return kPiSq / 6.0 - tail;
     }
-  };
+  }
 }
 
 double NC::calcDebyeMSDShape( double x )
@@ -71,8 +94,7 @@ double NC::calcDebyeMSDShape( double x )
   nc_assert_always(x>=0.0);
   if (x<1e-50)
     return 0.25;
-  DebyeMSDShapeIntegral integral;
-  return 0.25 + x * x * integral.integrate( 0.0, 1.0 / x );
+  return 0.25 + x * x * debyeMSDShapeIntegral( 1.0 / x );
 }
 
 NC::DebyeTemperature NC::debyeTempFromIsotropicMSD( double msd, Temperature t, AtomMass am )
@@ -63,3 +63,9 @@ NCrystal::UniqueID::UniqueID()
 }
 
 NCrystal::RNG::~RNG() = default;
+
+void NCrystal::RNG::actualGenerateMany( double* out, std::size_t n )
+{
+  for ( std::size_t i = 0; i < n; ++i )
+    out[i] = actualGenerate();
+}
@@ -0,0 +1,178 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/internal/NCDiskCacheUtils.hh"
+#include "NCrystal/internal/NCFileUtils.hh"
+#include "NCrystal/internal/NCString.hh"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#ifndef NCRYSTAL_DISABLE_THREADS
+#  include <thread>
+#endif
+#if defined(__unix__) || (defined (__APPLE__) && defined (__MACH__))
+#  include <unistd.h>
+#  define NCRYSTAL_DISKCACHEUTILS_HAS_GETPID
+#endif
+
+namespace NC = NCrystal;
+
+NC::DiskCacheKeyMaterial& NC::DiskCacheKeyMaterial::add( const char * s )
+{
+  m_data.append( s, std::strlen(s) + 1 );
+  return *this;
+}
+
+NC::DiskCacheKeyMaterial& NC::DiskCacheKeyMaterial::add( double val )
+{
+  m_data.append( reinterpret_cast<const char*>(&val), sizeof(val) );
+  return *this;
+}
+
+NC::DiskCacheKeyMaterial& NC::DiskCacheKeyMaterial::add( uint64_t val )
+{
+  m_data.append( reinterpret_cast<const char*>(&val), sizeof(val) );
+  return *this;
+}
+
+NC::DiskCacheKeyMaterial& NC::DiskCacheKeyMaterial::add( const VectD& v )
+{
+  add( static_cast<uint64_t>( v.size() ) );
+  if ( !v.empty() )
+    m_data.append( reinterpret_cast<const char*>(&v[0]), v.size() * sizeof(double) );
+  return *this;
+}
+
+uint64_t NC::DiskCacheKeyMaterial::hash() const
+{
+  return fnv1a64( m_data );
+}
+
+uint64_t NC::fnv1a64( const std::string& s )
+{
+  uint64_t h = 0xcbf29ce484222325ull;
+  for ( auto c : s ) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+std::string NC::diskCacheFileName( const std::string& dir,
+                                   const char * prefix,
+                                   const DiskCacheKeyMaterial& km )
+{
+  std::ostringstream ss;
+  ss << prefix << std::hex << km.hash() << ".bin";
+  return path_join( dir, ss.str() );
+}
+
+namespace NCrystal {
+  namespace {
+    std::string uniqueTmpSuffix()
+    {
+      //Process id, thread id, time, a per-process counter and a random number
+      //(in case pids are reused or shared between e.g. containers):
+      static std::atomic<uint64_t> s_counter{0};
+      static const uint64_t s_random = []()
+      {
+        try {
+          std::random_device rd;
+          return ( static_cast<uint64_t>( rd() ) << 32 ) ^ static_cast<uint64_t>( rd() );
+        } catch ( std::exception& ) {
+          return uint64_t(0);
+        }
+      }();
+      std::ostringstream ss;
+      ss << ".tmp" << std::hex;
+#ifdef NCRYSTAL_DISKCACHEUTILS_HAS_GETPID
+      ss << static_cast<long>( ::getpid() ) << '_';
+#endif
+#ifndef NCRYSTAL_DISABLE_THREADS
+      ss << std::hash<std::thread::id>()( std::this_thread::get_id() ) << '_';
+#endif
+      ss << std::chrono::high_resolution_clock::now().time_since_epoch().count()
+         << '_' << s_counter++ << '_' << s_random;
+      return ss.str();
+    }
+
+    const std::string *& currentThreadDirOverride()
+    {
+      static thread_local const std::string * s_dir = nullptr;
+      return s_dir;
+    }
+  }
+}
+
+bool NC::writeFileAtomically( const std::string& fn,
+                              const std::function<void(std::ostream&)>& writefct )
+{
+  const std::string fn_tmp = fn + uniqueTmpSuffix();
+  {
+    std::ofstream fh( fn_tmp, std::ios::binary | std::ios::trunc );
+    if ( !fh.good() )
+      return false;
+    writefct( fh );
+    fh.close();
+    if ( !fh.good() ) {
+      std::remove( fn_tmp.c_str() );
+      return false;
+    }
+  }
+  if ( std::rename( fn_tmp.c_str(), fn.c_str() ) != 0 ) {
+    std::remove( fn_tmp.c_str() );
+    return false;
+  }
+  return true;
+}
+
+NC::DiskCacheDirSetting::DiskCacheDirSetting( const char * envname )
+  : m_dir( initialCacheDirSetting( envname ) )
+{
+}
+
+std::string NC::DiskCacheDirSetting::get() const
+{
+  if ( currentThreadDirOverride() != nullptr )
+    return *currentThreadDirOverride();
+  NCRYSTAL_LOCK_GUARD(m_mtx);
+  return m_dir;
+}
+
+void NC::DiskCacheDirSetting::set( std::string dir )
+{
+  NCRYSTAL_LOCK_GUARD(m_mtx);
+  m_dir = std::move(dir);
+}
+
+NC::DiskCacheDirScope::DiskCacheDirScope( std::string dir )
+  : m_dir( std::move(dir) ),
+    m_prev( currentThreadDirOverride() )
+{
+  currentThreadDirOverride() = &m_dir;
+}
+
+NC::DiskCacheDirScope::~DiskCacheDirScope()
+{
+  currentThreadDirOverride() = m_prev;
+}
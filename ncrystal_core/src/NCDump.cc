@@ -470,5 +470,11 @@ void NCrystal::dump( const Info&c, DumpVerbosity verbosityVal )
     }
   }
 
+  if ( verbose ) {
+    //Not in the default output, which should remain stable:
+    printf("%s", hr);
+    std::cout<<"Approximate memory footprint: "<<fmt( c.memoryFootprint() / 1048576.0, "%.3g" )<<" MB"<<std::endl;
+  }
+
   std::cout<<hr<<std::flush;
 }
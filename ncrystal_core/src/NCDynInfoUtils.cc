@@ -23,6 +23,8 @@
 #include "NCrystal/internal/NCMath.hh"
 #include "NCrystal/internal/NCVDOSToScatKnl.hh"
 #include "NCrystal/internal/NCSABUtils.hh"
+#include "NCrystal/internal/NCSABDiskCache.hh"
+#include "NCrystal/NCFactImpl.hh"
 namespace NC = NCrystal;
 
 namespace NCrystal {
@@ -74,9 +76,34 @@ namespace NCrystal {
                SigmaBound{std::get<2>(key)*0.001} };
     }
 
+    //The expanded Debye model kernels only depend on the boundXS and the
+    //element mass in a trivial manner: S(alpha,beta) does not depend on
+    //boundXS at all, and since the expansion is carried out in terms of
+    //x=alpha*(2*m_n*kT*msd/hbar^2) with msd proportional to 1/mass, the
+    //kernel for one mass is the kernel for another mass with the alpha grid
+    //scaled by the mass ratio. Kernels are therefore expanded once for a
+    //reference mass, and shared (with rescaled alpha grids) by all elements
+    //with masses in [mref,mref*2^(1/8)). Using the lower edge of the bin as the
+    //reference mass means that the kinematic reach of the reduced kernel (which
+    //grows as the mass decreases) is sufficient for all masses in the bin:
+    using ReducedDebyeKey = std::tuple<unsigned,uint64_t,uint64_t,int>;//(reduced vdoslux 0..2, rounded T and TDebye as in VDOSDebyeKey, mass bin)
+    constexpr double reducedDebyeMassBinsPerOctave = 8.0;
+    ReducedDebyeKey getReducedKey( const VDOSDebyeKey& key )
+    {
+      const double mass = std::get<1>(key)*0.001;
+      nc_assert_always( mass > 0.0 );
+      const int massbin = static_cast<int>( std::floor( reducedDebyeMassBinsPerOctave * std::log2( mass ) ) );
+      return ReducedDebyeKey( std::get<0>(key), std::get<3>(key), std::get<4>(key), massbin );
+    }
+    AtomMass reducedKeyRefMass( const ReducedDebyeKey& key )
+    {
+      return AtomMass{ std::exp2( std::get<3>(key) / reducedDebyeMassBinsPerOctave ) };
+    }
+
     //Actual worker functions producing results:
     std::shared_ptr<const SABData> extractFromDIVDOSNoCache( unsigned vdoslux, uint32_t vdos2sabExcludeFlag, const DI_VDOS& );
-    std::shared_ptr<const SABData> extractFromDIVDOSDebyeNoCache( const VDOSDebyeKey& );
+    std::shared_ptr<const SABData> extractFromDIVDOSDebyeNoCache( const VDOSDebyeKey&, bool useReducedCache );
+    std::shared_ptr<const SABData> extractReducedDebyeNoCache( const ReducedDebyeKey& );
 
     //Factories:
     class VDOS2SABFactory : public NC::CachedFactoryBase<VDOSKey,SABData,10> {
@@ -120,15 +147,54 @@ namespace NCrystal {
     protected:
       virtual ShPtr actualCreate( const VDOSDebyeKey& key ) const final
       {
-        return extractFromDIVDOSDebyeNoCache(key);
+        return extractFromDIVDOSDebyeNoCache(key,true);
+      }
+    };
+
+    class ReducedDebyeFactory : public NC::CachedFactoryBase<ReducedDebyeKey,SABData,10> {
+    public:
+      const char* factoryName() const final { return "ReducedDebyeKernelFactory"; }
+      std::string keyToString( const ReducedDebyeKey& key ) const final
+      {
+        std::ostringstream ss;
+        ss<<"(reduced_vdoslux="<<std::get<0>(key)
+          <<";T="<<Temperature{std::get<1>(key)*0.001}
+          <<";TDebye="<<DebyeTemperature{std::get<2>(key)*0.001}
+          <<";Mref="<<reducedKeyRefMass(key)<<")";
+        return ss.str();
+      }
+    protected:
+      virtual ShPtr actualCreate( const ReducedDebyeKey& key ) const final
+      {
+        return extractReducedDebyeNoCache(key);
       }
     };
 
     static VDOS2SABFactory s_vdos2sabfactory;
     static VDOSDebye2SABFactory s_vdosdebye2sabfactory;
+    static ReducedDebyeFactory s_reduceddebyefactory;
+
+    std::size_t evictFromVDOS2SABCache( FactImpl::CacheEvictionRequest& req )
+    {
+      //Kernels of evicted DI_VDOS objects (the Debye model caches are not
+      //associated with specific materials, and are left untouched):
+      std::set<UniqueIDValue> evictedSAB;
+      std::size_t n = s_vdos2sabfactory.evict( [&req,&evictedSAB]( const VDOSKey& key, const SABData* sab )
+      {
+        if ( !req.dynInfoUIDs.count( UniqueIDValue{ std::get<0>(key) } ) )
+          return false;
+        if ( sab )
+          evictedSAB.insert( sab->getUniqueID() );
+        return true;
+      } );
+      req.sabDataUIDs.insert( evictedSAB.begin(), evictedSAB.end() );
+      return n;
+    }
 
     std::shared_ptr<const SABData> extractFromDIVDOS( unsigned vdoslux, uint32_t vdos2sabExcludeFlag, const DI_VDOS& di )
     {
+      static bool s_evictionRegistered = ( FactImpl::registerCacheEvictionFunction( evictFromVDOS2SABCache ), true );
+      (void)s_evictionRegistered;
       VDOSKey key( di.getUniqueID().value, vdoslux, vdos2sabExcludeFlag, &di );
       return s_vdos2sabfactory.create(key);
     }
@@ -155,7 +221,7 @@ std::shared_ptr<const NC::SABData> NC::extractSABDataFromVDOSDebyeModel( DebyeTe
   unsigned reduced_vdoslux = static_cast<unsigned>(std::max<int>(0,static_cast<int>(vdoslux)-3));//nb: replicated below
   auto key = DICache::getKey(reduced_vdoslux,temperature,debyeTemperature,boundXS,elementMassAMU);
   if (!useCache)
-    return DICache::extractFromDIVDOSDebyeNoCache(key);
+    return DICache::extractFromDIVDOSDebyeNoCache(key,false);
   return DICache::extractFromDIVDOSDebye(key);
 }
 
@@ -170,7 +236,7 @@ std::shared_ptr<const NC::SABData> NC::extractSABDataFromDynInfo( const NC::DI_S
     unsigned reduced_vdoslux = static_cast<unsigned>(std::max<int>(0,static_cast<int>(vdoslux)-3));//nb: replicated above
     auto key = DICache::getKey(reduced_vdoslux,*di_vdosdebye);
     if (!useCache)
-      return DICache::extractFromDIVDOSDebyeNoCache(key);
+      return DICache::extractFromDIVDOSDebyeNoCache(key,false);
     return DICache::extractFromDIVDOSDebye(key);
   }
 
@@ -196,6 +262,7 @@ void NC::clearSABDataFromDynInfoCaches()
 {
   DICache::s_vdos2sabfactory.cleanup();
   DICache::s_vdosdebye2sabfactory.cleanup();
+  DICache::s_reduceddebyefactory.cleanup();
 }
 
 std::shared_ptr<const NC::SABData> NC::DICache::extractFromDIVDOSNoCache( unsigned vdoslux, uint32_t vdos2sabExcludeFlag, const DI_VDOS& di  )
@@ -244,22 +311,88 @@ std::shared_ptr<const NC::SABData> NC::DICache::extractFromDIVDOSNoCache( unsign
       scaleGnFct = [scalefact,low,high](unsigned n) { return ( n >= low && n<= high ) ? scalefact : 1.0; };
     }
   }
+
+  //Check the (opt-in) persistent disk cache. The key must describe all inputs
+  //used in the expansion below:
+  Optional<SABDiskCache::KeyMaterial> diskCacheKey;
+  if ( SABDiskCache::isEnabled() ) {
+    diskCacheKey.emplace( "VDOS" );
+    diskCacheKey.value().add( static_cast<uint64_t>(vdoslux) )
+      .add( static_cast<uint64_t>(vdos2sabExcludeFlag) )
+      .add( requested_Emax )
+      .add( vd.vdos_egrid().first ).add( vd.vdos_egrid().second )
+      .add( vd.vdos_density() )
+      .add( vd.temperature().dbl() )
+      .add( vd.boundXS().dbl() )
+      .add( vd.elementMassAMU().dbl() );
+    if ( vdos2sabExcludeFlag > 0 )
+      diskCacheKey.value().add( di.atomData().scatteringXS().dbl() )
+        .add( di.atomData().coherentXS().dbl() )
+        .add( di.atomData().incoherentXS().dbl() );
+    auto cached = SABDiskCache::load( diskCacheKey.value() );
+    if ( cached != nullptr )
+      return cached;
+  }
+
   SABData sabdata = SABUtils::transformKernelToStdFormat( createScatteringKernel( vd, vdoslux, requested_Emax,
                                                                                   VDOSGn::TruncAndThinningChoices::Default,
                                                                                   scaleGnFct ) );
+  if ( diskCacheKey.has_value() ) {
+    //Return the stored (memory mapped) version, to share it with other processes:
+    auto stored = SABDiskCache::store( diskCacheKey.value(), sabdata );
+    if ( stored != nullptr )
+      return stored;
+  }
   return std::make_shared<const SABData>(std::move(sabdata));
 }
 
-std::shared_ptr<const NC::SABData> NC::DICache::extractFromDIVDOSDebyeNoCache( const VDOSDebyeKey& key )
+std::shared_ptr<const NC::SABData> NC::DICache::extractFromDIVDOSDebyeNoCache( const VDOSDebyeKey& key, bool useReducedCache )
 {
   auto param = debyekey2params( key );
+  auto rkey = getReducedKey( key );
+  auto reduced = ( useReducedCache
+                   ? s_reduceddebyefactory.create( rkey )
+                   : extractReducedDebyeNoCache( rkey ) );
+  //Rescale alpha grid to actual mass, and share the S(alpha,beta) values:
+  const double alphaScale = param.elementMass.dbl() / reducedKeyRefMass( rkey ).dbl();
+  auto alphaGrid = vectorTrf( reduced->alphaGrid(), [alphaScale](double a) { return a * alphaScale; } );
+  VectD betaGrid = reduced->betaGrid();
+  return std::make_shared<const SABData>( std::move(alphaGrid), std::move(betaGrid), reduced->sab(),
+                                          param.temperature, param.boundXS, param.elementMass,
+                                          reduced->suggestedEmax() );
+}
+
+std::shared_ptr<const NC::SABData> NC::DICache::extractReducedDebyeNoCache( const ReducedDebyeKey& key )
+{
+  const unsigned reduced_vdoslux = std::get<0>(key);
+  const Temperature temperature{ std::get<1>(key)*0.001 };
+  const DebyeTemperature debyeTemperature{ std::get<2>(key)*0.001 };
+  const AtomMass refMass = reducedKeyRefMass( key );
+  const SigmaBound refBoundXS{ 1.0 };//has no effect on S(alpha,beta)
+
+  Optional<SABDiskCache::KeyMaterial> diskCacheKey;
+  if ( SABDiskCache::isEnabled() ) {
+    diskCacheKey.emplace( "VDOSDebyeReduced" );
+    diskCacheKey.value().add( static_cast<uint64_t>( reduced_vdoslux ) )
+      .add( std::get<1>(key) ).add( std::get<2>(key) )
+      .add( static_cast<double>( std::get<3>(key) ) );
+    auto cached = SABDiskCache::load( diskCacheKey.value() );
+    if ( cached != nullptr )
+      return cached;
+  }
 
   //Setup VDOS data from Debye Model. We only specify points in the upper 50% of
   //[0,debye_energy], to benefit from the quadratic scaling below the first grid
   //point implemented in VDOSEval (i.e. we get a more precise G1 function
   //constructed):
-  auto vdosdata = createVDOSDebye( param.debyeTemperature, param.temperature, param.boundXS, param.elementMass );
-  SABData sabdata = SABUtils::transformKernelToStdFormat( createScatteringKernel( vdosdata, param.reduced_vdoslux ) );
+  auto vdosdata = createVDOSDebye( debyeTemperature, temperature, refBoundXS, refMass );
+  SABData sabdata = SABUtils::transformKernelToStdFormat( createScatteringKernel( vdosdata, reduced_vdoslux ) );
+  if ( diskCacheKey.has_value() ) {
+    //Return the stored (memory mapped) version, to share it with other processes:
+    auto stored = SABDiskCache::store( diskCacheKey.value(), sabdata );
+    if ( stored != nullptr )
+      return stored;
+  }
   return std::make_shared<const SABData>(std::move(sabdata));
 }
 
@@ -168,6 +168,7 @@ NC::ElIncScatter::ElIncScatter( const Info& info, const ElIncScatterCfg& cfg )
   m_elincxs = std::make_unique<ElIncXS>( std::move(res.value().msd),
                                          std::move(res.value().bixs),
                                          std::move(res.value().scale) );
+  m_elincxs->setTabulatedMuSampling( cfg.use_tabulated_mu_sampling );
 }
 
 NC::ElIncScatter::ElIncScatter( const VectD& elements_meanSqDisp,
@@ -184,6 +185,12 @@ NC::CrossSect NC::ElIncScatter::crossSectionIsotropic( CachePtr&, NeutronEnergy
   return m_elincxs->evaluate( ekin );
 }
 
+void NC::ElIncScatter::crossSectionIsotropicMany( CachePtr&, const double* ekin,
+                                                 std::size_t N, double* out_xs ) const
+{
+  m_elincxs->evaluateMany( ekin, N, out_xs );
+}
+
 NC::ScatterOutcomeIsotropic NC::ElIncScatter::sampleScatterIsotropic( CachePtr&, RNG& rng, NeutronEnergy ekin ) const
 {
   return { ekin, m_elincxs->sampleMu( rng, ekin ) };
@@ -21,6 +21,7 @@
 #include "NCrystal/internal/NCElIncXS.hh"
 #include "NCrystal/internal/NCMath.hh"
 #include "NCrystal/internal/NCRandUtils.hh"
+#include "NCrystal/internal/NCCPUDispatch.hh"
 
 namespace NC = NCrystal;
 
@@ -31,35 +32,101 @@ NC::ElIncXS::ElIncXS( const VectD& elm_msd,
   set( elm_msd, elm_bixs, elm_scale );
 }
 
+namespace NCrystal {
+  namespace {
+    NCRYSTAL_SIMD_INLINE double eval_1mexpmtdivt_impl( double t )
+    {
+      //safe eval of (1-exp(-t))/t for t>=0.0. This is written without
+      //data-dependent branches or calls to std::expm1, which makes it faster
+      //also in scalar code, and allows compilers to vectorise loops calling it
+      //(when built without strict FP trapping semantics).
+      //
+      //At small t<0.01, a Taylor expansion is used for numerical stability
+      //(gives 10 sign. digits at t=0.01). At large t>24, the limiting behaviour
+      //1/t is used (~10 significant digits after t>-ln(1e-10)~=23). At
+      //intermediate t, expm1(-t) is evaluated as expm1(-t/n) with n=2^8
+      //followed by 8 applications of expm1(2x)=expm1(x)*(expm1(x)+2), which
+      //(unlike exp(-t)-1) suffers from no cancellations:
+      nc_assert(t>=0.0);
+      const double tlow = ( t < 0.01 ? 0.01 : t );
+      const double tc = ( tlow > 24.0 ? 24.0 : tlow );
+      double m = expm1_smallarg_approx( tc * ( -1.0 / 256.0 ) );
+      m *= ( m + 2.0 ); m *= ( m + 2.0 ); m *= ( m + 2.0 ); m *= ( m + 2.0 );
+      m *= ( m + 2.0 ); m *= ( m + 2.0 ); m *= ( m + 2.0 ); m *= ( m + 2.0 );
+      //Both branches are always evaluated, with arguments kept in their valid
+      //ranges, so the final selection can be done with a blend instruction:
+      const double ts = ( t < 0.01 ? t : 0.01 );
+      const double taylor = 1 + ts * (  -0.5 + ts * 0.16666666666666666666666666666666666666666667 * ( 1.-0.25*ts ) );
+      const double r = ( t > 24.0 ? 1.0 : -m ) / tlow;
+      return t < 0.01 ? taylor : r;
+    }
+  }
+}
+
+double NC::ElIncXS::eval_1mexpmtdivt(double t)
+{
+  return eval_1mexpmtdivt_impl( t );
+}
+
 NC::CrossSect NC::ElIncXS::evaluate(NeutronEnergy ekin) const
 {
   //NB: The cross-section code here must be consistent with code in
-  //evaluateMonoAtomic() and sampleMu(..)
+  //evaluateMonoAtomic(), evaluateMany(..) and sampleMu(..)
   constexpr double kkk = 16.0 * kPiSq * ekin2wlsqinv(1.0);
   double e = kkk*ekin.dbl();
   double xs = 0.0;
-  for ( auto& elmdata : m_elm_data )
-    xs += elmdata.second * eval_1mexpmtdivt( elmdata.first * e );
+  const std::size_t nelem = m_msd.size();
+  const double * msd = m_msd.data();
+  const double * wxs = m_wxs.data();
+  for ( std::size_t i = 0; i < nelem; ++i )
+    xs += wxs[i] * eval_1mexpmtdivt( msd[i] * e );
   return CrossSect{ xs };
 }
 
-double NC::ElIncXS::eval_1mexpmtdivt(double t)
-{
-  //safe eval of (1-exp(-t))/t for t>=0.0
-  nc_assert(t>=0.0);
-  if ( t < 0.01 ) {
-    //evaluate with Taylor expansion - for numerical stability (gives 10 sign. digits at t=0.01):
-    return ( 1 + t * (  -0.5 + t * 0.16666666666666666666666666666666666666666667 * ( 1.-0.25*t ) ) );
+namespace NCrystal {
+  namespace {
+    //Variants of the inner loop of ElIncXS::evaluateMany for each instruction
+    //set (cf. NCCPUDispatch.hh):
+    constexpr double elIncXS_kkk = 16.0 * kPiSq * ekin2wlsqinv(1.0);
+    void elIncXSKernelBaseline( double msd, double wxs, const double* ekin, std::size_t N, double* out_xs )
+    {
+      for ( std::size_t j = 0; j < N; ++j )
+        out_xs[j] += wxs * eval_1mexpmtdivt_impl( msd * ( elIncXS_kkk * ekin[j] ) );
+    }
+#ifdef NCRYSTAL_SIMD_DISPATCH_X86
+    NCRYSTAL_TARGET_AVX2 void elIncXSKernelAVX2( double msd, double wxs, const double* ekin,
+                                                 std::size_t N, double* out_xs )
+    {
+      for ( std::size_t j = 0; j < N; ++j )
+        out_xs[j] += wxs * eval_1mexpmtdivt_impl( msd * ( elIncXS_kkk * ekin[j] ) );
+    }
+    NCRYSTAL_TARGET_AVX512 void elIncXSKernelAVX512( double msd, double wxs, const double* ekin,
+                                                     std::size_t N, double* out_xs )
+    {
+      for ( std::size_t j = 0; j < N; ++j )
+        out_xs[j] += wxs * eval_1mexpmtdivt_impl( msd * ( elIncXS_kkk * ekin[j] ) );
+    }
+#endif
   }
-  if ( t > 24.0 ) {
-    //limiting behaviour at t->inf (~10 significant digits after t>-ln(1e-10)~=23, no need for exp)
-    return 1.0 / t;
+}
+
+void NC::ElIncXS::evaluateMany( const double* ekin, std::size_t N, double* out_xs ) const
+{
+  //NB: The cross-section code here must be consistent with code in
+  //evaluate(..). Elements are looped over in the outer loop, so the inner loop
+  //over energies can be vectorised:
+  std::fill( out_xs, out_xs + N, 0.0 );
+  auto kernel = &elIncXSKernelBaseline;
+#ifdef NCRYSTAL_SIMD_DISPATCH_X86
+  switch ( CPUDispatch::activeISA() ) {
+  case CPUDispatch::ISA::AVX512: kernel = &elIncXSKernelAVX512; break;
+  case CPUDispatch::ISA::AVX2: kernel = &elIncXSKernelAVX2; break;
+  case CPUDispatch::ISA::Baseline: break;
   }
-  //evaluate at intermediate t using actual formula (in principle no need for
-  //std::expm1 from C++11 for reasons of precision since t>0.01, but it seems to
-  //be significantly faster):
-  t = -t;
-  return std::expm1(t) / t;
+#endif
+  const std::size_t nelem = m_msd.size();
+  for ( std::size_t i = 0; i < nelem; ++i )
+    kernel( m_msd[i], m_wxs[i], ekin, N, out_xs );
 }
 
 NC::CrossSect NC::ElIncXS::evaluateMonoAtomic(NeutronEnergy ekin, double meanSqDisp, SigmaBound bound_incoh_xs)
@@ -84,10 +151,14 @@ void NC::ElIncXS::set( const VectD& elm_msd,
     nc_assert_always(elm_scale.at(i)>=0.0&&elm_scale.at(i)<=1e6);
   }
 
-  m_elm_data.clear();//releases all memory since it is SmallVector
-  m_elm_data.reserve_hint(elm_bixs.size());
-  for ( auto i : ncrange( elm_msd.size() ) )
-    m_elm_data.emplace_back( elm_msd[i], elm_bixs[i]*elm_scale[i] );
+  m_msd.clear();//releases all memory since it is SmallVector
+  m_wxs.clear();
+  m_msd.reserve_hint(elm_bixs.size());
+  m_wxs.reserve_hint(elm_bixs.size());
+  for ( auto i : ncrange( elm_msd.size() ) ) {
+    m_msd.push_back( elm_msd[i] );
+    m_wxs.push_back( elm_bixs[i]*elm_scale[i] );
+  }
 }
 
 NC::CosineScatAngle NC::ElIncXS::sampleMuMonoAtomic( RNG& rng, NeutronEnergy ekin, double meanSqDisp )
@@ -126,12 +197,92 @@ NC::CosineScatAngle NC::ElIncXS::sampleMuMonoAtomic( RNG& rng, NeutronEnergy eki
   }
 }
 
+namespace NCrystal {
+  namespace {
+
+    class NegLog1mTable {
+    public:
+      //Evaluates -log(1-y) for y in [0,1) without calls to std::log. The
+      //function f(m)=-log(m)/(1-m) is smooth and in [1,2*log(2)] for m in
+      //[0.5,1], and is tabulated for linear interpolation. For y<0.5 we use
+      //-log(1-y)=y*f(1-y), and otherwise 1-y=m*2^e (exact), and
+      //-log(1-y)=-e*log(2)+(1-m)*f(m). Since all terms are positive and exact
+      //apart from f, the relative precision of the result is that of f. The
+      //table size is chosen so this is better than 1e-7 (verified below):
+      static constexpr unsigned nbins = 1024;
+
+      NegLog1mTable()
+      {
+        auto f = []( double m ) { return m < 1.0 ? -std::log1p( m - 1.0 ) / ( 1.0 - m ) : 1.0; };
+        for ( unsigned i = 0; i <= nbins; ++i )
+          m_f[i] = f( 0.5 + i * ( 0.5 / nbins ) );
+        double maxrelerr = 0.0;
+        for ( unsigned i = 0; i < nbins; ++i ) {
+          double m = 0.5 + ( i + 0.5 ) * ( 0.5 / nbins );
+          maxrelerr = std::max( maxrelerr, std::fabs( evalF( m ) / f( m ) - 1.0 ) );
+        }
+        nc_assert_always( maxrelerr < 1e-7 );
+      }
+
+      double operator()( double y ) const
+      {
+        nc_assert( y >= 0.0 && y < 1.0 );
+        if ( y < 0.5 )
+          return y * evalF( 1.0 - y );
+        int e;
+        const double m = std::frexp( 1.0 - y, &e );
+        return -e * kLn2 + ( 1.0 - m ) * evalF( m );
+      }
+
+    private:
+      double m_f[nbins+1];
+      static constexpr double kLn2 = 0.693147180559945309417232121458176568;
+
+      double evalF( double m ) const
+      {
+        nc_assert( m >= 0.5 && m <= 1.0 );
+        const double x = ( m - 0.5 ) * ( 2.0 * nbins );
+        const unsigned i = std::min<unsigned>( static_cast<unsigned>( x ), nbins - 1 );
+        const double t = x - i;
+        return m_f[i] + t * ( m_f[i+1] - m_f[i] );
+      }
+    };
+
+  }
+}
+
+NC::CosineScatAngle NC::ElIncXS::sampleMuMonoAtomicTabulated( RNG& rng, NeutronEnergy ekin, double meanSqDisp )
+{
+  nc_assert(ekin.dbl()>=0.0&&meanSqDisp>=0.0);
+  constexpr double kkk = 8.0 * kPiSq * ekin2wlsqinv(1.0);
+  double a = kkk * ekin.dbl() * meanSqDisp;
+  if ( a < 0.01 )
+    return sampleMuMonoAtomic( rng, ekin, meanSqDisp );//rejection method uses no transcendental functions
+
+  //Same transformation method as in sampleMuMonoAtomic, but rewritten in terms
+  //of 1-mu=s/a, where s=-log(1-R*c) is exponentially distributed on [0,2a],
+  //and c=1-exp(-2a). Here c is evaluated with eval_1mexpmtdivt (which also
+  //involves no transcendental functions), and log with the table:
+  static const NegLog1mTable s_neglog1m;
+  const double c = 2.0 * a * eval_1mexpmtdivt( 2.0 * a );
+  const double y = rng.generate() * c;
+  if ( !( y < 1.0 ) )
+    return CosineScatAngle{ -1.0 };
+  return CosineScatAngle{ ncclamp( 1.0 - s_neglog1m( y ) / a, -1.0, 1.0 ) };
+}
+
 NC::CosineScatAngle NC::ElIncXS::sampleMu( RNG& rng, NeutronEnergy ekin )
 {
-  const std::size_t nelem = m_elm_data.size();
+  const std::size_t nelem = m_msd.size();
   nc_assert(nelem!=0);
+  auto sampleMono = [this,&rng,ekin]( double msd )
+  {
+    return ( m_tabulatedMu
+             ? sampleMuMonoAtomicTabulated( rng, ekin, msd )
+             : sampleMuMonoAtomic( rng, ekin, msd ) );
+  };
   if ( nelem == 1 )
-    return sampleMuMonoAtomic( rng, ekin, m_elm_data.front().first );
+    return sampleMono( m_msd.front() );
 
   //Calculate per-element contribution and select accordingly.
 
@@ -154,49 +305,49 @@ NC::CosineScatAngle NC::ElIncXS::sampleMu( RNG& rng, NeutronEnergy ekin )
   constexpr double kkk = 16.0 * kPiSq * ekin2wlsqinv(1.0);
   double e = kkk*ekin.dbl();
   double xs = 0.0;
-  auto itXS = elem_xs.begin();
-  auto it = m_elm_data.begin();
-  auto itE = m_elm_data.end();
-  for (;it!=itE;++it,++itXS)
-    *itXS = (xs += it->second * eval_1mexpmtdivt(it->first * e));
+  for ( std::size_t i = 0; i < nelem; ++i )
+    elem_xs[i] = (xs += m_wxs[i] * eval_1mexpmtdivt(m_msd[i] * e));
 
   auto choiceidx = pickRandIdxByWeight( rng, elem_xs );//pick index according to weights (values must be commulative)
   nc_assert(choiceidx<nelem);
-  return sampleMuMonoAtomic( rng, ekin, m_elm_data[choiceidx].first );
+  return sampleMono( m_msd[choiceidx] );
 }
 
 NC::ElIncXS::ElIncXS( const ElIncXS& a, double scale_a, const ElIncXS& b, double scale_b )
 {
-  //m_elm_data is (msd,boundincohxs*scale)
+  //Collect (msd,boundincohxs*scale) pairs:
   nc_assert(scale_a>=0.0);
-  using ElmDataVector = decltype(m_elm_data);
+  using ElmDataVector = SmallVector<PairDD,16>;
   ElmDataVector tmp;
-  tmp.reserve_hint( a.m_elm_data.size() + b.m_elm_data.size() );
-  auto addData = [&tmp](const ElmDataVector& data, double scale )
+  tmp.reserve_hint( a.m_msd.size() + b.m_msd.size() );
+  auto addData = [&tmp](const ElIncXS& data, double scale )
   {
-    for ( auto& e : data ) {
-      double strength = e.second * scale;
+    for ( auto i : ncrange( data.m_msd.size() ) ) {
+      double strength = data.m_wxs[i] * scale;
       if (strength)
-        tmp.emplace_back( e.first, strength );
+        tmp.emplace_back( data.m_msd[i], strength );
     }
   };
-  addData(a.m_elm_data,scale_a);
-  addData(b.m_elm_data,scale_b);
+  addData(a,scale_a);
+  addData(b,scale_b);
   std::sort(tmp.begin(),tmp.end());
-  ElmDataVector result;
-  result.reserve_hint(tmp.size());
+  m_msd.reserve_hint(tmp.size());
+  m_wxs.reserve_hint(tmp.size());
 
   for ( const auto& e : tmp ) {
-    if ( result.empty() || !floateq(result.back().first,e.first,1e-15) )
-      result.emplace_back( e );
-    else
-      result.back().second += e.second;
+    if ( m_msd.empty() || !floateq(m_msd.back(),e.first,1e-15) ) {
+      m_msd.push_back( e.first );
+      m_wxs.push_back( e.second );
+    } else {
+      m_wxs.back() += e.second;
+    }
   }
-  result.shrink_to_fit();
-  std::swap(m_elm_data,result);
+  m_msd.shrink_to_fit();
+  m_wxs.shrink_to_fit();
+  m_tabulatedMu = a.m_tabulatedMu && b.m_tabulatedMu;
 }
 
 std::size_t NC::ElIncXS::nElements() const
 {
-  return m_elm_data.size();
+  return m_msd.size();
 }
@@ -21,94 +21,217 @@
 #include "NCrystal/internal/NCEqRefl.hh"
 namespace NC = NCrystal;
 
-struct NC::EqRefl::Helper {
+namespace NCrystal {
+  namespace {
 
-  using ERL = EquivReflList;
+    //Point group operations (h,k,l)->M*(h,k,l) of the Laue classes, as rows of
+    //integer 3x3 matrices. Since (h,k,l) and (-h,-k,-l) are trivially
+    //equivalent, only half of the operations of each Laue class are listed.
+    using SymOp = EqRefl::SymOp;
 
-  static ERL calc_Triclinic_1_2(int h, int k, int l)
-  {
-    ERL e; e.add(h,k,l);
-    return e;
-  }
+    //Space groups 1 to 2 (Laue class -1):
+    struct OpsTriclinic {
+      static constexpr SymOp ops[] = {
+        {{  1, 0, 0,    0, 1, 0,    0, 0, 1 }}
+      };
+    };
+    constexpr SymOp OpsTriclinic::ops[];
 
-  static ERL calc_Monoclinic_3_15(int h, int k, int l)
-  {
-    ERL e; e.add(h,k,l);
-    e.add(h,-k,l);
-    return e;
-  }
+    //Space groups 3 to 15 (Laue class 2/m):
+    struct OpsMonoclinic {
+      static constexpr SymOp ops[] = {
+        {{  1, 0, 0,    0, 1, 0,    0, 0, 1 }},
+        {{  1, 0, 0,    0,-1, 0,    0, 0, 1 }}
+      };
+    };
+    constexpr SymOp OpsMonoclinic::ops[];
 
-  static ERL calc_Orthorhombic_16_74(int h, int k, int l)
-  {
-    ERL e; e.add(h,k,l);
-    e.add(h,-k,-l); e.add(h,-k,l); e.add(h,k,-l);
-    return e;
-  }
+    //Space groups 16 to 74 (Laue class mmm):
+    struct OpsOrthorhombic {
+      static constexpr SymOp ops[] = {
+        {{  1, 0, 0,    0, 1, 0,    0, 0, 1 }},
+        {{  1, 0, 0,    0,-1, 0,    0, 0,-1 }},
+        {{  1, 0, 0,    0,-1, 0,    0, 0, 1 }},
+        {{  1, 0, 0,    0, 1, 0,    0, 0,-1 }}
+      };
+    };
+    constexpr SymOp OpsOrthorhombic::ops[];
 
-  static ERL calc_Tetragonal_75_88(int h, int k, int l)
-  {
-    ERL e; e.add(h,k,l);
-    e.add(k,-h,-l); e.add(h,k,-l); e.add(k,-h,l);
-    return e;
-  }
+    //Space groups 75 to 88 (Laue class 4/m):
+    struct OpsTetragonalLow {
+      static constexpr SymOp ops[] = {
+        {{  1, 0, 0,    0, 1, 0,    0, 0, 1 }},
+        {{  0, 1, 0,   -1, 0, 0,    0, 0,-1 }},
+        {{  1, 0, 0,    0, 1, 0,    0, 0,-1 }},
+        {{  0, 1, 0,   -1, 0, 0,    0, 0, 1 }}
+      };
+    };
+    constexpr SymOp OpsTetragonalLow::ops[];
 
-  static ERL calc_Tetragonal_89_142(int h, int k, int l)
-  {
-    ERL e; e.add(h,k,l);
-    e.add(k,h,l); e.add(k,-h,-l); e.add(h,k,-l);
-    e.add(k,-h,l); e.add(h,-k,-l); e.add(k,h,-l); e.add(h,-k,l);
-    return e;
-  }
+    //Space groups 89 to 142 (Laue class 4/mmm):
+    struct OpsTetragonalHigh {
+      static constexpr SymOp ops[] = {
+        {{  1, 0, 0,    0, 1, 0,    0, 0, 1 }},
+        {{  0, 1, 0,    1, 0, 0,    0, 0, 1 }},
+        {{  0, 1, 0,   -1, 0, 0,    0, 0,-1 }},
+        {{  1, 0, 0,    0, 1, 0,    0, 0,-1 }},
+        {{  0, 1, 0,   -1, 0, 0,    0, 0, 1 }},
+        {{  1, 0, 0,    0,-1, 0,    0, 0,-1 }},
+        {{  0, 1, 0,    1, 0, 0,    0, 0,-1 }},
+        {{  1, 0, 0,    0,-1, 0,    0, 0, 1 }}
+      };
+    };
+    constexpr SymOp OpsTetragonalHigh::ops[];
 
-  static ERL calc_Trigonal_143_148(int h, int k, int l)
-  {
-    ERL e; e.add(h,k,l);
-    e.add(h+k,-h,-l); e.add(k,-h-k,l);
-    return e;
-  }
+    //Space groups 143 to 148 (Laue class -3):
+    struct OpsTrigonalLow {
+      static constexpr SymOp ops[] = {
+        {{  1, 0, 0,    0, 1, 0,    0, 0, 1 }},
+        {{  1, 1, 0,   -1, 0, 0,    0, 0,-1 }},
+        {{  0, 1, 0,   -1,-1, 0,    0, 0, 1 }}
+      };
+    };
+    constexpr SymOp OpsTrigonalLow::ops[];
 
-  static ERL calc_Trigonal_149_167(int h, int k, int l)
-  {
-    ERL e; e.add(h,k,l);
-    e.add(h+k,-h,-l); e.add(k,-h-k,l); e.add(k,h,-l); e.add(h+k,-k,l); e.add(h,-h-k,-l);
-    return e;
-  }
+    //Space groups 149 to 167 (Laue class -3m):
+    struct OpsTrigonalHigh {
+      static constexpr SymOp ops[] = {
+        {{  1, 0, 0,    0, 1, 0,    0, 0, 1 }},
+        {{  1, 1, 0,   -1, 0, 0,    0, 0,-1 }},
+        {{  0, 1, 0,   -1,-1, 0,    0, 0, 1 }},
+        {{  0, 1, 0,    1, 0, 0,    0, 0,-1 }},
+        {{  1, 1, 0,    0,-1, 0,    0, 0, 1 }},
+        {{  1, 0, 0,   -1,-1, 0,    0, 0,-1 }}
+      };
+    };
+    constexpr SymOp OpsTrigonalHigh::ops[];
+
+    //Space groups 168 to 176 (Laue class 6/m):
+    struct OpsHexagonalLow {
+      static constexpr SymOp ops[] = {
+        {{  1, 0, 0,    0, 1, 0,    0, 0, 1 }},
+        {{  1, 0, 0,    0, 1, 0,    0, 0,-1 }},
+        {{  0, 1, 0,   -1,-1, 0,    0, 0,-1 }},
+        {{  0, 1, 0,   -1,-1, 0,    0, 0, 1 }},
+        {{  1, 1, 0,   -1, 0, 0,    0, 0, 1 }},
+        {{  1, 1, 0,   -1, 0, 0,    0, 0,-1 }}
+      };
+    };
+    constexpr SymOp OpsHexagonalLow::ops[];
+
+    //Space groups 177 to 194 (Laue class 6/mmm):
+    struct OpsHexagonalHigh {
+      static constexpr SymOp ops[] = {
+        {{  1, 0, 0,    0, 1, 0,    0, 0, 1 }},
+        {{  0, 1, 0,   -1,-1, 0,    0, 0,-1 }},
+        {{  1, 1, 0,   -1, 0, 0,    0, 0,-1 }},
+        {{  1, 0, 0,    0, 1, 0,    0, 0,-1 }},
+        {{  0, 1, 0,   -1,-1, 0,    0, 0, 1 }},
+        {{  1, 1, 0,   -1, 0, 0,    0, 0, 1 }},
+        {{  0, 1, 0,    1, 0, 0,    0, 0, 1 }},
+        {{  1, 1, 0,    0,-1, 0,    0, 0, 1 }},
+        {{  1, 0, 0,   -1,-1, 0,    0, 0, 1 }},
+        {{  0, 1, 0,    1, 0, 0,    0, 0,-1 }},
+        {{  1, 1, 0,    0,-1, 0,    0, 0,-1 }},
+        {{  1, 0, 0,   -1,-1, 0,    0, 0,-1 }}
+      };
+    };
+    constexpr SymOp OpsHexagonalHigh::ops[];
+
+    //Space groups 195 to 206 (Laue class m-3):
+    struct OpsCubicLow {
+      static constexpr SymOp ops[] = {
+        {{  1, 0, 0,    0, 1, 0,    0, 0, 1 }},
+        {{  1, 0, 0,    0,-1, 0,    0, 0,-1 }},
+        {{  1, 0, 0,    0,-1, 0,    0, 0, 1 }},
+        {{  1, 0, 0,    0, 1, 0,    0, 0,-1 }},
+        {{  0, 1, 0,    0, 0, 1,    1, 0, 0 }},
+        {{  0, 1, 0,    0, 0,-1,   -1, 0, 0 }},
+        {{  0, 1, 0,    0, 0,-1,    1, 0, 0 }},
+        {{  0, 1, 0,    0, 0, 1,   -1, 0, 0 }},
+        {{  0, 0, 1,    1, 0, 0,    0, 1, 0 }},
+        {{  0, 0, 1,   -1, 0, 0,    0,-1, 0 }},
+        {{  0, 0, 1,   -1, 0, 0,    0, 1, 0 }},
+        {{  0, 0, 1,    1, 0, 0,    0,-1, 0 }}
+      };
+    };
+    constexpr SymOp OpsCubicLow::ops[];
+
+    //Space groups 207 to 230 (Laue class m-3m):
+    struct OpsCubicHigh {
+      static constexpr SymOp ops[] = {
+        {{  1, 0, 0,    0, 1, 0,    0, 0, 1 }},
+        {{  1, 0, 0,    0,-1, 0,    0, 0,-1 }},
+        {{  1, 0, 0,    0,-1, 0,    0, 0, 1 }},
+        {{  1, 0, 0,    0, 1, 0,    0, 0,-1 }},
+        {{  0, 1, 0,    0, 0, 1,    1, 0, 0 }},
+        {{  0, 1, 0,    0, 0,-1,   -1, 0, 0 }},
+        {{  0, 1, 0,    0, 0,-1,    1, 0, 0 }},
+        {{  0, 1, 0,    0, 0, 1,   -1, 0, 0 }},
+        {{  0, 0, 1,    1, 0, 0,    0, 1, 0 }},
+        {{  0, 0, 1,   -1, 0, 0,    0,-1, 0 }},
+        {{  0, 0, 1,   -1, 0, 0,    0, 1, 0 }},
+        {{  0, 0, 1,    1, 0, 0,    0,-1, 0 }},
+        {{  0, 1, 0,    1, 0, 0,    0, 0, 1 }},
+        {{  0, 1, 0,   -1, 0, 0,    0, 0,-1 }},
+        {{  0, 1, 0,   -1, 0, 0,    0, 0, 1 }},
+        {{  0, 1, 0,    1, 0, 0,    0, 0,-1 }},
+        {{  0, 0, 1,    0, 1, 0,    1, 0, 0 }},
+        {{  0, 0, 1,    0,-1, 0,   -1, 0, 0 }},
+        {{  0, 0, 1,    0,-1, 0,    1, 0, 0 }},
+        {{  0, 0, 1,    0, 1, 0,   -1, 0, 0 }},
+        {{  1, 0, 0,    0, 0, 1,    0, 1, 0 }},
+        {{  1, 0, 0,    0, 0,-1,    0,-1, 0 }},
+        {{  1, 0, 0,    0, 0,-1,    0, 1, 0 }},
+        {{  1, 0, 0,    0, 0, 1,    0,-1, 0 }}
+      };
+    };
+    constexpr SymOp OpsCubicHigh::ops[];
 
-  static ERL calc_Hexagonal_168_176(int h, int k, int l)
-  {
-    ERL e; e.add(h,k,l);
-    e.add(h,k,-l); e.add(k,-h-k,-l); e.add(k,-h-k,l); e.add(h+k,-h,l); e.add(h+k,-h,-l);
-    return e;
   }
+}
 
-  static ERL calc_Hexagonal_177_194(int h, int k, int l)
+struct NC::EqRefl::Helper {
+
+  using ERL = EquivReflList;
+
+  template<class TOps>
+  static constexpr std::size_t nops() { return sizeof(TOps::ops)/sizeof(SymOp); }
+
+  //The operations are compile-time constants, allowing the compiler to unroll
+  //the loops below and fold away the (mostly zero) matrix elements:
+
+  template<class TOps>
+  static ERL calc( int h, int k, int l )
   {
-    ERL e; e.add(h,k,l);
-    e.add(k,-h-k,-l); e.add(h+k,-h,-l); e.add(h,k,-l); e.add(k,-h-k,l);
-    e.add(h+k,-h,l); e.add(k,h,l); e.add(h+k,-k,l); e.add(h,-h-k,l);
-    e.add(k,h,-l); e.add(h+k,-k,-l); e.add(h,-h-k,-l);
+    ERL e;
+    const HKL hkl( h, k, l );
+    for ( auto& op : TOps::ops )
+      e.add( op.apply( hkl ) );
     return e;
   }
 
-  static ERL calc_Cubic_195_206(int h, int k, int l)
+  template<class TOps>
+  static HKL calcRepr( int h, int k, int l )
   {
-    ERL e; e.add(h,k,l);
-    e.add(h,-k,-l); e.add(h,-k,l); e.add(h,k,-l);
-    e.add(k,l,h); e.add(k,-l,-h); e.add(k,-l,h); e.add(k,l,-h);
-    e.add(l,h,k); e.add(l,-h,-k); e.add(l,-h,k); e.add(l,h,-k);
-    return e;
+    //Lowest entry of calc<TOps>(h,k,l), without filling a list:
+    const HKL hkl( h, k, l );
+    HKL best = EqRefl::normalise( TOps::ops[0].apply( hkl ) );
+    for ( std::size_t i = 1; i < nops<TOps>(); ++i ) {
+      HKL a = EqRefl::normalise( TOps::ops[i].apply( hkl ) );
+      if ( a < best )
+        best = a;
+    }
+    return best;
   }
 
-  static ERL calc_Cubic_207_230(int h, int k, int l)
+  template<class TOps>
+  static void setup( EqRefl& eq )
   {
-    ERL e; e.add(h,k,l);
-    e.add(h,-k,-l); e.add(h,-k,l); e.add(h,k,-l);
-    e.add(k,l,h); e.add(k,-l,-h); e.add(k,-l,h); e.add(k,l,-h);
-    e.add(l,h,k); e.add(l,-h,-k); e.add(l,-h,k); e.add(l,h,-k);
-    e.add(k,h,l); e.add(k,-h,-l); e.add(k,-h,l); e.add(k,h,-l);
-    e.add(l,k,h); e.add(l,-k,-h); e.add(l,-k,h); e.add(l,k,-h);
-    e.add(h,l,k); e.add(h,-l,-k); e.add(h,-l,k); e.add(h,l,-k);
-    return e;
+    eq.m_calc = &calc<TOps>;
+    eq.m_calcRepr = &calcRepr<TOps>;
+    eq.m_ops = &TOps::ops[0];
+    eq.m_nops = nops<TOps>();
   }
 };
 
@@ -119,32 +242,32 @@ NC::EqRefl::EqRefl(int sg)
   if (sg<149) {
     if (sg<75) {
       if (sg<3)
-        m_calc = &Helper::calc_Triclinic_1_2;
+        Helper::setup<OpsTriclinic>(*this);
       else if (sg<16)
-        m_calc = &Helper::calc_Monoclinic_3_15;
+        Helper::setup<OpsMonoclinic>(*this);
       else
-        m_calc = &Helper::calc_Orthorhombic_16_74;
+        Helper::setup<OpsOrthorhombic>(*this);
     } else {
       if (sg<89)
-        m_calc = &Helper::calc_Tetragonal_75_88;
+        Helper::setup<OpsTetragonalLow>(*this);
       else if (sg<143)
-        m_calc = &Helper::calc_Tetragonal_89_142;
+        Helper::setup<OpsTetragonalHigh>(*this);
       else
-        m_calc = &Helper::calc_Trigonal_143_148;
+        Helper::setup<OpsTrigonalLow>(*this);
     }
   } else {
     if (sg<195) {
       if (sg<168)
-        m_calc = &Helper::calc_Trigonal_149_167;
+        Helper::setup<OpsTrigonalHigh>(*this);
       else if (sg<177)
-        m_calc = &Helper::calc_Hexagonal_168_176;
+        Helper::setup<OpsHexagonalLow>(*this);
       else
-        m_calc = &Helper::calc_Hexagonal_177_194;
+        Helper::setup<OpsHexagonalHigh>(*this);
     } else {
       if (sg<207)
-        m_calc = &Helper::calc_Cubic_195_206;
+        Helper::setup<OpsCubicLow>(*this);
       else
-        m_calc = &Helper::calc_Cubic_207_230;
+        Helper::setup<OpsCubicHigh>(*this);
     }
   }
 }
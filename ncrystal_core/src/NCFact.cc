@@ -22,6 +22,24 @@
 #include "NCrystal/NCFactImpl.hh"
 #include "NCrystal/NCDataSources.hh"
 #include "NCrystal/NCRNG.hh"
+#include "NCrystal/NCVersion.hh"
+#include "NCrystal/internal/NCString.hh"
+#include "NCrystal/internal/NCThreadUtils.hh"
+#include "NCrystal/internal/NCFillHKL.hh"
+#include "NCrystal/internal/NCSABDiskCache.hh"
+#include "NCrystal/internal/NCDiskCacheUtils.hh"
+#include "NCrystal/internal/NCFileUtils.hh"
+#include "NCrystal/internal/NCFactoryUtils.hh"
+#include <atomic>
+#include <fstream>
+#include <cstdio>
+#ifndef NCRYSTAL_DISABLE_THREADS
+#  include <thread>
+#endif
+#if defined(__linux__)
+#  include <unistd.h>
+#  include <sys/syscall.h>
+#endif
 
 namespace NC = NCrystal;
 
@@ -52,6 +70,214 @@ NC::Scatter NC::createScatter_RNGForCurrentThread( const MatCfg& cfg )
                   FactImpl::createScatter( cfg ) );
 }
 
+unsigned NC::numberOfNUMANodes()
+{
+  static const unsigned s_n = []()
+  {
+    unsigned n = 1;
+#if defined(__linux__)
+    //List of online nodes, like "0" or "0-3" or "0,2-3":
+    std::ifstream f( "/sys/devices/system/node/online" );
+    std::string line;
+    if ( f && std::getline( f, line ) ) {
+      unsigned count = 0;
+      for ( auto& part : split2( trim2( line ), 0, ',' ) ) {
+        auto range = split2( part, 1, '-' );
+        int32_t a, b;
+        if ( !safe_str2int( range.front(), a ) || !safe_str2int( range.back(), b ) || a < 0 || b < a ) {
+          count = 0;
+          break;
+        }
+        count += static_cast<unsigned>( b - a + 1 );
+      }
+      if ( count > 0 )
+        n = count;
+    }
+#endif
+    return n;
+  }();
+  return s_n;
+}
+
+unsigned NC::currentNUMANode()
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+  if ( numberOfNUMANodes() > 1 ) {
+    unsigned cpu(0), node(0);
+    if ( syscall( SYS_getcpu, &cpu, &node, nullptr ) == 0 )
+      return node;
+  }
+#endif
+  return 0;
+}
+
+NC::Scatter NC::createScatter_NUMALocal( const MatCfg& cfg )
+{
+  if ( numberOfNUMANodes() < 2 )
+    return createScatter_RNGForCurrentThread( cfg );
+  //Objects for node N are kept in cache replica domain N+1:
+  CacheReplicaScope replicaScope( currentNUMANode() + 1 );
+  return createScatter_RNGForCurrentThread( cfg );
+}
+
+std::vector<NC::Scatter> NC::createScatterMany( const std::vector<MatCfg>& cfgs )
+{
+  //Create the heavy objects concurrently (one material per task):
+  std::vector<Optional<ProcImpl::ProcPtr>> procs( cfgs.size() );
+  parallelForIndex( cfgs.size(), getNumberOfThreads(),
+                    [&cfgs,&procs]( std::size_t i )
+                    {
+                      procs[i] = FactImpl::createScatter( cfgs[i] );
+                    } );
+
+  //Wrap up serially, to assign RNG streams deterministically:
+  std::vector<Scatter> result;
+  result.reserve( cfgs.size() );
+  auto rngproducer = getDefaultRNGProducer();
+  for ( auto& p : procs ) {
+    auto rng = rngproducer->produce();
+    result.emplace_back( rngproducer, std::move(rng), std::move(p.value()) );
+  }
+  return result;
+}
+
+namespace NCrystal {
+  namespace {
+    template<class TResult, class TFct>
+    std::future<TResult> createAsync( TFct fct )
+    {
+      auto promise = std::make_shared<std::promise<TResult>>();
+      auto fut = promise->get_future();
+      queueBackgroundTask( [promise,fct]()
+                           {
+                             try {
+                               promise->set_value( fct() );
+                             } catch (...) {
+                               promise->set_exception( std::current_exception() );
+                             }
+                           }, getNumberOfThreads() );
+      return fut;
+    }
+  }
+}
+
+std::future<NC::shared_obj<const NC::Info>> NC::createInfoAsync( const MatCfg& cfg )
+{
+  return createAsync<shared_obj<const Info>>( [cfg]() { return FactImpl::createInfo( cfg ); } );
+}
+
+std::future<NC::Scatter> NC::createScatterAsync( const MatCfg& cfg )
+{
+  //Assign RNG stream now, for reproducibility:
+  auto rngproducer = getDefaultRNGProducer();
+  auto rng = rngproducer->produce();
+  return createAsync<Scatter>( [cfg,rngproducer,rng]()
+                               {
+                                 return Scatter( rngproducer, rng, FactImpl::createScatter( cfg ) );
+                               } );
+}
+
+std::future<NC::Absorption> NC::createAbsorptionAsync( const MatCfg& cfg )
+{
+  return createAsync<Absorption>( [cfg]() { return Absorption( FactImpl::createAbsorption( cfg ) ); } );
+}
+
+namespace NCrystal {
+  namespace {
+    constexpr const char * snapshotManifestName = "ncrystal_snapshot.txt";
+    constexpr const char * snapshotManifestMagic = "NCrystalSnapshot";
+    constexpr int32_t snapshotFormatVersion = 1;
+
+    void setSnapshotCacheDirs( std::string hkldir, std::string sabdir )
+    {
+      setHKLDiskCacheDir( std::move(hkldir) );
+      SABDiskCache::setCacheDir( std::move(sabdir) );
+    }
+
+    unsigned newSnapshotCacheReplicaDomain()
+    {
+      //Far above the domains used for NUMA nodes (see createScatter_NUMALocal):
+      static std::atomic<unsigned> s_next{ 0x80000000u };
+      return s_next++;
+    }
+  }
+}
+
+void NC::createSnapshot( const std::vector<MatCfg>& cfgs, const std::string& dirname )
+{
+  if ( dirname.empty() || !file_exists( path_join( dirname, "." ) ) )
+    NCRYSTAL_THROW2(FileNotFound,"Snapshot directory does not exist: \""<<dirname<<"\"");
+
+  //Make sure everything is actually created (and therefore stored), by using a
+  //fresh cache replica domain rather than the normal in-memory caches. The
+  //disk caches are only directed to the snapshot directory in the threads
+  //doing the work, so concurrent usage elsewhere is unaffected:
+  const unsigned domain = newSnapshotCacheReplicaDomain();
+  parallelForIndex( cfgs.size(), getNumberOfThreads(),
+                    [&cfgs,&dirname,domain]( std::size_t i )
+                    {
+                      DiskCacheDirScope dirScope( dirname );
+                      CacheReplicaScope replicaScope( domain );
+                      FactImpl::createInfo( cfgs[i] );
+                      FactImpl::createScatter( cfgs[i] );
+                      FactImpl::createAbsorption( cfgs[i] );
+                    } );
+
+  //Write manifest (atomically via a uniquely named temporary file):
+  const std::string fn = path_join( dirname, snapshotManifestName );
+  auto writefct = [&cfgs]( std::ostream& os )
+  {
+    os << snapshotManifestMagic << ' ' << snapshotFormatVersion << '\n';
+    os << "ncrystal_version " << NCRYSTAL_VERSION << '\n';
+    for ( auto& cfg : cfgs )
+      os << "cfg " << cfg.toStrCfg() << '\n';
+  };
+  if ( !writeFileAtomically( fn, writefct ) )
+    NCRYSTAL_THROW2(CalcError,"Could not write snapshot manifest file: \""<<fn<<"\"");
+}
+
+std::vector<std::string> NC::loadSnapshot( const std::string& dirname )
+{
+  const std::string fn = path_join( dirname, snapshotManifestName );
+  auto content = readEntireFileToString( fn );
+  if ( !content.has_value() )
+    NCRYSTAL_THROW2(FileNotFound,"Snapshot manifest file not found: \""<<fn<<"\"");
+  std::vector<std::string> cfgs;
+  bool headerok = false;
+  bool versionok = false;
+  std::size_t ilineno = 0;
+  for ( auto& line : split2( content.value(), 0, '\n' ) ) {
+    ++ilineno;
+    if ( line.empty() )
+      continue;
+    auto parts = split2( line, 1, ' ' );
+    if ( ilineno == 1 ) {
+      int32_t fmtversion = 0;
+      headerok = ( parts.size() == 2 && parts.at(0) == snapshotManifestMagic
+                   && safe_str2int( parts.at(1), fmtversion ) && fmtversion == snapshotFormatVersion );
+      if ( !headerok )
+        break;
+    } else if ( ilineno == 2 ) {
+      int32_t version = 0;
+      versionok = ( parts.size() == 2 && parts.at(0) == "ncrystal_version"
+                    && safe_str2int( parts.at(1), version ) && version == NCRYSTAL_VERSION );
+      if ( !versionok )
+        break;
+    } else if ( parts.size() == 2 && parts.at(0) == "cfg" ) {
+      cfgs.push_back( parts.at(1) );
+    } else {
+      headerok = false;
+      break;
+    }
+  }
+  if ( !headerok )
+    NCRYSTAL_THROW2(BadInput,"Invalid or unsupported snapshot manifest file: \""<<fn<<"\"");
+  if ( !versionok )
+    NCRYSTAL_THROW2(BadInput,"Snapshot in \""<<dirname<<"\" was created by a different NCrystal version");
+  setSnapshotCacheDirs( dirname, dirname );
+  return cfgs;
+}
+
 NC::Absorption NC::createAbsorption( const MatCfg& cfg )
 {
   return Absorption( FactImpl::createAbsorption( cfg ) );
@@ -75,3 +301,62 @@ void NC::registerInMemoryStaticFileData( std::string virtualFileName,
   DataSources::registerInMemoryStaticFileData( std::move(virtualFileName),
                                                static_data );
 }
+
+namespace NCrystal {
+  namespace {
+    unsigned actualNThreads( unsigned n )
+    {
+#ifndef NCRYSTAL_DISABLE_THREADS
+      if ( n == 0 )
+        n = std::thread::hardware_concurrency();
+      return std::max<unsigned>( 1, n );
+#else
+      (void)n;
+      return 1;
+#endif
+    }
+    std::atomic<unsigned>& nThreadsSetting()
+    {
+      static std::atomic<unsigned> s_nthreads( []()
+      {
+        int n = ncgetenv_int("NTHREADS",1);
+        if ( n < 0 )
+          NCRYSTAL_THROW2(BadInput,"Invalid value of NCRYSTAL_NTHREADS environment variable: "<<n);
+        return actualNThreads( static_cast<unsigned>( n ) );
+      }() );
+      return s_nthreads;
+    }
+  }
+}
+
+void NC::setNumberOfThreads( unsigned n )
+{
+  nThreadsSetting() = actualNThreads( n );
+}
+
+unsigned NC::getNumberOfThreads()
+{
+  return nThreadsSetting();
+}
+
+std::size_t NC::evictFromCaches( const MatCfg& cfg )
+{
+  FactImpl::CacheEvictionRequest req;
+  if ( cfg.isSinglePhase() )
+    req.textDataUIDs.insert( cfg.textDataUID() );
+  for ( auto& ph : cfg.phases() )
+    req.textDataUIDs.insert( ph.second.textDataUID() );
+  return FactImpl::evictFromCaches( std::move(req) );
+}
+
+std::size_t NC::evictInfo( UniqueIDValue uid )
+{
+  FactImpl::CacheEvictionRequest req;
+  req.infoUIDs.insert( uid );
+  return FactImpl::evictFromCaches( std::move(req) );
+}
+
+std::size_t NC::evictInfo( const Info& info )
+{
+  return evictInfo( info.detail_getUnderlyingUniqueID() );
+}
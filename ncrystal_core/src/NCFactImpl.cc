@@ -25,6 +25,8 @@
 #include "NCrystal/internal/NCFileUtils.hh"
 #include "NCrystal/NCInfoBuilder.hh"
 #include "NCrystal/internal/NCCfgManip.hh"
+#include "NCrystal/internal/NCThreadUtils.hh"
+#include "NCrystal/NCFact.hh"
 #include <list>
 
 namespace NC = NCrystal;
@@ -79,11 +81,17 @@ namespace NCrystal {
         ShPtr loadPluginsAndCreate(const key_type& key)
         {
           Plugins::ensurePluginsLoaded();
+          //Trigger loading of lazy plugins before the cache lookup, to avoid
+          //invalidating the cache entry while under construction:
+          Plugins::loadLazyPluginsForDataType( FactDef::dataTypeForLazyPlugins(key) );
+          InitProfileScope profileScope( FactDef::name(), [&key](){ return key.toString(); } );
+          InitProfileScope::setNote( "cache hit" );//changed in actualCreate on cache misses
           return this->create(key);
         }
       protected:
         ShPtr actualCreate(const key_type& key) const final
         {
+          InitProfileScope::setNote( "cache miss" );
           return FactDef::transformTProdRVToShPtr( searchAndCreateTProdRV(key) );
         }
 
@@ -158,6 +166,8 @@ namespace NCrystal {
                 return f->produce(key.getUserFactoryKey());
               }
             }
+            if ( Plugins::loadAllLazyPlugins() )
+              return searchAndCreateTProdRV(key);//requested factory might now be available
             FactDef::produceCustomNoSpecificFactAvail( key, requested.specificRequest() );
             NCRYSTAL_THROW2(BadInput,"Specific "<<FactDef::name()<<" factory requested which is unavailable: \""
                             <<requested.specificRequest()<<"\"");
@@ -190,6 +200,8 @@ namespace NCrystal {
             }
           }
           if ( best == nullptr ) {
+            if ( Plugins::loadAllLazyPlugins() )
+              return searchAndCreateTProdRV(key);//try again with all plugins available
             FactDef::produceCustomNoFactFoundError( key );//give possibility to throw custom msg
             NCRYSTAL_THROW2(BadInput,"Could not find factory to service "<<FactDef::name()
                             <<" creation request for \""<<key.toString()<<"\" ("<<db.size()<<" factories considered)");
@@ -223,11 +235,13 @@ namespace NCrystal {
         bool hasFactory(const std::string& name)
         {
           Plugins::ensurePluginsLoaded();
-          NCRYSTAL_LOCK_GUARD(m_dbmutex);//lock while accessing m_db
-          for ( auto& e : m_db )
-            if ( name == e->name() )
-              return true;
-          return false;
+          {
+            NCRYSTAL_LOCK_GUARD(m_dbmutex);//lock while accessing m_db
+            for ( auto& e : m_db )
+              if ( name == e->name() )
+                return true;
+          }
+          return Plugins::loadAllLazyPlugins() ? hasFactory(name) : false;
         }
 
         std::vector<FactoryClassShPtr> getFactoryList() const {
@@ -317,6 +331,7 @@ namespace NCrystal {
         using produced_type = TextDataSource;
         using pubfactory_type = TextDataFactory;
         static bool isSuitableForKey( const pubfactory_type&, const key_type& ) { return true; }
+        static std::string dataTypeForLazyPlugins( const key_type& key ) { return getfileext( key.getUserFactoryKey().path() ); }
         static Cfg::FactNameRequest extractRequestedFactory( const key_type& key )
         {
           std::string specific = key.getUserFactoryKey().fact();
@@ -363,6 +378,7 @@ namespace NCrystal {
         using produced_type = Info;
         using pubfactory_type = FactImpl::InfoFactory;
         static bool isSuitableForKey( const pubfactory_type&, const key_type& ) { return true; }
+        static const std::string& dataTypeForLazyPlugins( const key_type& key ) { return key.getUserFactoryKey().getDataType(); }
         static Cfg::FactNameRequest extractRequestedFactory( const key_type& key )
         {
           auto fnrstr = key.getUserFactoryKey().get_infofactory();
@@ -391,6 +407,8 @@ namespace NCrystal {
         using key_type = DBKey_ScatterRequest;
         using produced_type = ProcImpl::Process;
         using pubfactory_type = FactImpl::ScatterFactory;
+        //Lazy plugins are triggered by the data type when creating Info objects:
+        static std::string dataTypeForLazyPlugins( const key_type& ) { return {}; }
         static bool isSuitableForKey( const pubfactory_type& pf, const key_type& key )
         {
           return singleMultiPhaseSuitability(pf.multiPhaseCapability(),key.getUserFactoryKey());
@@ -415,6 +433,7 @@ namespace NCrystal {
         using key_type = DBKey_AbsorptionRequest;
         using produced_type = ProcImpl::Process;
         using pubfactory_type = FactImpl::AbsorptionFactory;
+        static std::string dataTypeForLazyPlugins( const key_type& ) { return {}; }
         static bool isSuitableForKey( const pubfactory_type& pf, const key_type& key )
         {
           return singleMultiPhaseSuitability(pf.multiPhaseCapability(),key.getUserFactoryKey());
@@ -482,8 +501,11 @@ namespace NCrystal {
 
 NC::shared_obj<const NC::TextData> NCF::createTextData( const TextDataPath& path )
 {
+  InitProfileScope profileScope( "TextData", [&path](){ return path.path(); } );
   //Always recheck the source without cache (file might have changed on-disk,
   //process might have changed working directory, ...):
+  Plugins::ensurePluginsLoaded();
+  Plugins::loadLazyPluginsForDataType( FactDefTextData::dataTypeForLazyPlugins( path ) );
   auto textDataSource = textDataDB().searchAndCreateTProdRV( path );
 
   //But whenever identical (and possible given memory constraints of caching),
@@ -497,6 +519,22 @@ namespace NCrystal {
 
     namespace {
 
+      std::vector<Optional<InfoPtr>> createPhaseInfos( const MatCfg::PhaseList& cfg_phases )
+      {
+        //Create the Info objects of the (single-phase) phases of a multi-phase
+        //cfg concurrently, using up to getNumberOfThreads() threads:
+        std::vector<Optional<InfoPtr>> infos( cfg_phases.size() );
+        parallelForIndex( cfg_phases.size(), getNumberOfThreads(),
+                          [&cfg_phases,&infos]( std::size_t i )
+                          {
+                            const auto& cfg = cfg_phases[i].second;
+                            nc_assert_always(!cfg.isMultiPhase());
+                            nc_assert( cfg.isSinglePhase() );
+                            infos[i] = FactImpl::createInfo(cfg);
+                          } );
+        return infos;
+      }
+
       template<typename TRequest>
       class CfgLvlMPProc_Key {
       public:
@@ -515,20 +553,27 @@ namespace NCrystal {
           //state) cfg objects to TRequest constructors.
           nc_assert(cfg_phases.size()>=2);
           m_data.reserve(cfg_phases.size());
+          //Always get number density of phases via their Info objects, to handle
+          //density overrides, phase-choices, etc. The phases are independent,
+          //so their Info objects are created concurrently:
+          auto infos = createPhaseInfos( cfg_phases );
           StableSum combinedNumberDensity;
-          for ( auto& e : cfg_phases ) {
-            const double volfrac = e.first;
-            const auto& cfg = e.second;
-            nc_assert_always(!cfg.isMultiPhase());
-            nc_assert( cfg.isSinglePhase() );
-            //Always get number density of phase like this, to handle density
-            //overrides, phase-choices, etc.:
-            auto info = FactImpl::createInfo(cfg);
+          for ( auto i : ncrange(cfg_phases.size()) ) {
+            const double volfrac = cfg_phases[i].first;
+            auto& info = infos[i].value();
             const double numdens_contrib = volfrac * info->getNumberDensity().dbl();
-            m_data.emplace_back( numdens_contrib,//<--will be normalised below
-                                 TRequest{info} );
-            nc_assert(!m_data.back().second.isThinned());
             combinedNumberDensity.add( numdens_contrib );
+            //Phases resulting in identical requests are merged by summing
+            //their contributions, to avoid duplicate work and components:
+            TRequest request{info};
+            nc_assert(!request.isThinned());
+            auto it = std::find_if( m_data.begin(), m_data.end(),
+                                    [&request]( const value_type& e ) { return e.second == request; } );
+            if ( it != m_data.end() )
+              it->first += numdens_contrib;
+            else
+              m_data.emplace_back( numdens_contrib,//<--will be normalised below
+                                   std::move(request) );
           }
           const double totnd = combinedNumberDensity.sum();
           if ( !(totnd>0.0) ) {
@@ -627,21 +672,53 @@ namespace NCrystal {
                                                 : ProcessType::Absorption );
           if ( key.empty() )
             return ProcImpl::getGlobalNullProcess(processType);
+          //Phases are independent, so create their processes concurrently:
+          const std::size_t nphases = static_cast<std::size_t>( key.end() - key.begin() );
+          std::vector<Optional<ProcImpl::ProcPtr>> procs( nphases );
+          parallelForIndex( nphases, getNumberOfThreads(),
+                            [&key,&procs]( std::size_t i )
+                            {
+                              procs[i] = FactImpl::create( key.begin()[i].second );
+                            } );
           ProcImpl::ProcComposition::ComponentList proclist;
-          for ( auto& e : key )
-            proclist.push_back( ProcImpl::ProcComposition::Component{ e.first, FactImpl::create( e.second ) } );
+          for ( auto i : ncrange(nphases) )
+            proclist.push_back( ProcImpl::ProcComposition::Component{ key.begin()[i].first,
+                                                                      std::move(procs[i].value()) } );
           return ProcImpl::ProcComposition::consumeAndCombine( std::move(proclist), processType );
         }
       };
 
+      template<class TRequest>
+      MPProcCacheDB<TRequest>& mpProcCacheDB() { static MPProcCacheDB<TRequest> db; return db; }
+
       template<ProcessType processType, class TRequest>
       ProcImpl::ProcPtr createProcFromMPCfg(const MatCfg::PhaseList& cfg_phases)
       {
         nc_assert_always(cfg_phases.size()>=2);
         //Create via cache:
         CfgLvlMPProc_Key<TRequest> key(cfg_phases);
-        static MPProcCacheDB<TRequest> s_db;
-        return s_db.create(key);
+        return mpProcCacheDB<TRequest>().create(key);
+      }
+
+      //Epoch for the processes memoised on MatCfg objects (cf.
+      //MatCfg::getProcMemo), changed whenever any of the factory caches are
+      //invalidated (including when factories are added or removed). It must be
+      //read before the process to be memoised is created:
+      std::atomic<std::uint64_t> s_procMemoEpoch( 1 );
+      std::uint64_t procMemoEpoch()
+      {
+        static bool registered = []()
+        {
+          std::function<void()> fct_bump = [](){ ++s_procMemoEpoch; };
+          registerCacheCleanupFunction(fct_bump);
+          textDataDB().registerCleanupCallback(fct_bump);
+          infoDB().registerCleanupCallback(fct_bump);
+          scatterDB().registerCleanupCallback(fct_bump);
+          absorptionDB().registerCleanupCallback(fct_bump);
+          return true;
+        }();
+        (void)registered;
+        return s_procMemoEpoch.load();
       }
 
       //Mini-factory for the creation of Info objects from MatCfg objects with
@@ -729,8 +806,9 @@ namespace NCrystal {
         InfoBuilder::MultiPhaseBuilder mp_builder;
         const auto& cfg_phases = cfg.phases();
         mp_builder.phases.reserve(cfg_phases.size());
-        for ( auto& cfg_ph : cfg_phases )
-          mp_builder.phases.emplace_back(cfg_ph.first,FactImpl::createInfo(cfg_ph.second));
+        auto infos = createPhaseInfos( cfg_phases );
+        for ( auto i : ncrange(cfg_phases.size()) )
+          mp_builder.phases.emplace_back(cfg_phases[i].first,std::move(infos[i].value()));
 
         auto res = InfoBuilder::buildInfoPtr( std::move(mp_builder) );
 
@@ -790,6 +868,7 @@ NC::ProcImpl::ProcPtr NCF::createAbsorption( const AbsorptionRequest& cfg )
 
 NC::shared_obj<const NC::Info> NCF::createInfo( const MatCfg& cfg )
 {
+  InitProfileScope profileScope( "createInfo", [&cfg](){ return cfg.toStrCfg(); } );
   ///////////////////////////////////////////////////////////////////////////////////////////////
   // First deal with phase-choices (before all other things, which is in line
   // with the documentation's promise that the effect of phase-choice parameter
@@ -799,7 +878,7 @@ NC::shared_obj<const NC::Info> NCF::createInfo( const MatCfg& cfg )
   // objects):
   MatCfg::PhaseChoices phaseChoices = cfg.getPhaseChoices();
   if ( !phaseChoices.empty() ) {
-    auto info = createInfo( cfg.cloneWithoutPhaseChoices() );
+    auto info = FactImpl::createInfo( cfg.cloneWithoutPhaseChoices() );
     //Recursively zoom in to specific chosen phase:
     for ( auto iphasechoice : phaseChoices ) {
       if ( ! info->isMultiPhase() || !( iphasechoice < info->getPhases().size() ) )
@@ -814,7 +893,7 @@ NC::shared_obj<const NC::Info> NCF::createInfo( const MatCfg& cfg )
 
   if ( cfg.hasDensityOverride() ) {
     using DType = DensityState::Type;
-    auto info_underlying = createInfo( cfg.cloneWithoutDensityState() );
+    auto info_underlying = FactImpl::createInfo( cfg.cloneWithoutDensityState() );
     auto ds = cfg.get_density();
     if ( info_underlying->isSinglePhase() ) {
       //Single phase => Simply override or scale the density:
@@ -867,39 +946,74 @@ NC::shared_obj<const NC::Info> NCF::createInfo( const MatCfg& cfg )
   return InfoBuilder::recordCfgDataOnInfoObject( std::move(info), cfg.rawCfgData() );
 }
 
+namespace NCrystal {
+  namespace FactImpl {
+    namespace {
+      ProcImpl::ProcPtr createScatterNoMemo( const MatCfg& cfg )
+      {
+        if ( cfg.hasDensityOverride() )
+          return createScatterNoMemo( cfg.cloneWithoutDensityState() );//never matters for a process
+        MatCfg::PhaseChoices phaseChoices = cfg.getPhaseChoices();
+        if ( !phaseChoices.empty() ) {
+          //Let createInfo deal with phasechoices, and let us just transform it into a scatter request:
+          return FactImpl::create( ScatterRequest(FactImpl::createInfo(cfg)) );
+        }
+        nc_assert_always( cfg.getPhaseChoices().empty() );
+        nc_assert_always( !cfg.hasDensityOverride() );
+        auto cfg_phases = cfg.phases();
+        nc_assert_always( cfg_phases.size() != 1 );
+        return ( cfg_phases.empty()
+                 ? create( ScatterRequest(cfg) )
+                 : createProcFromMPCfg<ProcessType::Scatter,ScatterRequest>(cfg_phases) );
+      }
+
+      ProcImpl::ProcPtr createAbsorptionNoMemo( const MatCfg& cfg )
+      {
+        if ( cfg.hasDensityOverride() )
+          return createAbsorptionNoMemo( cfg.cloneWithoutDensityState() );//never matters for a process
+
+        MatCfg::PhaseChoices phaseChoices = cfg.getPhaseChoices();
+        if ( !phaseChoices.empty() ) {
+          //Let createInfo deal with phasechoices, and let us just transform it into a scatter request:
+          return FactImpl::create( AbsorptionRequest(FactImpl::createInfo(cfg) ));
+        }
+        auto cfg_phases = cfg.phases();
+        nc_assert_always( cfg_phases.size() != 1 );
+        return ( cfg_phases.empty()
+                 ? create( AbsorptionRequest(cfg) )
+                 : createProcFromMPCfg<ProcessType::Absorption,AbsorptionRequest>(cfg_phases) );
+      }
+    }
+  }
+}
+
 NC::ProcImpl::ProcPtr NCF::createScatter( const MatCfg& cfg )
 {
-  if ( cfg.hasDensityOverride() )
-    return createScatter( cfg.cloneWithoutDensityState() );//never matters for a process
-  MatCfg::PhaseChoices phaseChoices = cfg.getPhaseChoices();
-  if ( !phaseChoices.empty() ) {
-    //Let createInfo deal with phasechoices, and let us just transform it into a scatter request:
-    return FactImpl::create( ScatterRequest(createInfo(cfg)) );
-  }
-  nc_assert_always( cfg.getPhaseChoices().empty() );
-  nc_assert_always( !cfg.hasDensityOverride() );
-  auto cfg_phases = cfg.phases();
-  nc_assert_always( cfg_phases.size() != 1 );
-  return ( cfg_phases.empty()
-           ? create( ScatterRequest(cfg) )
-           : createProcFromMPCfg<ProcessType::Scatter,ScatterRequest>(cfg_phases) );
+  InitProfileScope profileScope( "createScatter", [&cfg](){ return cfg.toStrCfg(); } );
+  //Repeated requests with the same cfg object (or copies of it) are served
+  //from the memo, without constructing requests and keys for the caches. The
+  //memo does not know about cache replica domains, so they bypass it:
+  if ( detail::currentCacheReplicaDomain() )
+    return createScatterNoMemo( cfg );
+  const std::uint64_t epoch = procMemoEpoch();
+  if ( auto memo = cfg.getProcMemo( ProcessType::Scatter, epoch ) )
+    return memo;
+  auto res = createScatterNoMemo( cfg );
+  cfg.setProcMemo( ProcessType::Scatter, epoch, res.getsp() );
+  return res;
 }
 
 NC::ProcImpl::ProcPtr NCF::createAbsorption( const MatCfg& cfg )
 {
-  if ( cfg.hasDensityOverride() )
-    return createAbsorption( cfg.cloneWithoutDensityState() );//never matters for a process
-
-  MatCfg::PhaseChoices phaseChoices = cfg.getPhaseChoices();
-  if ( !phaseChoices.empty() ) {
-    //Let createInfo deal with phasechoices, and let us just transform it into a scatter request:
-    return FactImpl::create( AbsorptionRequest(createInfo(cfg) ));
-  }
-  auto cfg_phases = cfg.phases();
-  nc_assert_always( cfg_phases.size() != 1 );
-  return ( cfg_phases.empty()
-           ? create( AbsorptionRequest(cfg) )
-           : createProcFromMPCfg<ProcessType::Absorption,AbsorptionRequest>(cfg_phases) );
+  InitProfileScope profileScope( "createAbsorption", [&cfg](){ return cfg.toStrCfg(); } );
+  if ( detail::currentCacheReplicaDomain() )
+    return createAbsorptionNoMemo( cfg );
+  const std::uint64_t epoch = procMemoEpoch();
+  if ( auto memo = cfg.getProcMemo( ProcessType::Absorption, epoch ) )
+    return memo;
+  auto res = createAbsorptionNoMemo( cfg );
+  cfg.setProcMemo( ProcessType::Absorption, epoch, res.getsp() );
+  return res;
 }
 
 NC::ProcImpl::ProcPtr NCF::ScatterFactory::globalCreateScatter( const ScatterRequest& req ) const
@@ -932,3 +1046,169 @@ std::string NCF::guessDataType( const RawStrData& data,
     return lowerCase(ext);
   return {};
 }
+
+namespace NCrystal {
+  namespace FactImpl {
+    //Fwd declare fct implemented in NCTDProd.cc:
+    std::set<TextDataUID> evictFromTextDataStore( const std::function<bool(const TextData&)>& );
+    namespace {
+      struct CacheEvictionRegistry {
+        std::mutex mtx;
+        std::vector<std::function<std::size_t(CacheEvictionRequest&)>> fcts;
+      };
+      CacheEvictionRegistry& cacheEvictionRegistry() { static CacheEvictionRegistry db; return db; }
+
+      void addEvictedInfo( const Info& info, CacheEvictionRequest& req )
+      {
+        req.infoUIDs.insert( info.getUniqueID() );
+        req.infoUIDs.insert( info.detail_getUnderlyingUniqueID() );
+        if ( info.isMultiPhase() ) {
+          for ( auto& ph : info.getPhases() )
+            addEvictedInfo( ph.second, req );
+          return;
+        }
+        for ( auto& di : info.getDynamicInfoList() )
+          req.dynInfoUIDs.insert( di->getUniqueID() );
+      }
+
+      bool infoIsAffected( const Info& info, const CacheEvictionRequest& req )
+      {
+        if ( req.infoUIDs.count( info.getUniqueID() ) || req.infoUIDs.count( info.detail_getUnderlyingUniqueID() ) )
+          return true;
+        for ( auto& ph : info.getPhases() )
+          if ( infoIsAffected( ph.second, req ) )
+            return true;
+        return false;
+      }
+
+      FactDB<FactDefScatter>& processDB( const ScatterRequest* ) { return scatterDB(); }
+      FactDB<FactDefAbsorption>& processDB( const AbsorptionRequest* ) { return absorptionDB(); }
+
+      template<class TRequest>
+      std::size_t evictProcesses( CacheEvictionRequest& req )
+      {
+        auto requestIsAffected = [&req]( const TRequest& r ) { return req.infoUIDs.count( r.infoUID() ) > 0; };
+        std::size_t n = processDB( static_cast<const TRequest*>(nullptr) ).evict( [&requestIsAffected]( const DBKey_XXXRequest<TRequest>& key,
+                                                                                                        const ProcImpl::Process* )
+        {
+          return requestIsAffected( key.getUserFactoryKey() );
+        } );
+        n += mpProcCacheDB<TRequest>().evict( [&requestIsAffected]( const CfgLvlMPProc_Key<TRequest>& key, const ProcImpl::Process* )
+        {
+          for ( auto& e : key )
+            if ( requestIsAffected( e.second ) )
+              return true;
+          return false;
+        } );
+        return n;
+      }
+
+      std::size_t evictFactImplEntries( CacheEvictionRequest& req )
+      {
+        //Info objects (collecting the IDs of evicted objects in a separate
+        //request, to not modify the request while it is in use):
+        CacheEvictionRequest evicted;
+        auto textDataIsAffected = [&req]( const TextDataUID& uid )
+        {
+          return req.allTextData || req.textDataUIDs.count( uid ) > 0;
+        };
+        std::size_t n = infoDB().evict( [&]( const DBKey_InfoRequest& key, const Info* info )
+        {
+          const auto& ir = key.getUserFactoryKey();
+          const bool affected = ( textDataIsAffected( ir.textDataUID() )
+                                  || req.dataSourceNames.count( ir.dataSourceName().str() ) > 0
+                                  || ( info && infoIsAffected( *info, req ) ) );
+          if ( affected && info )
+            addEvictedInfo( *info, evicted );
+          return affected;
+        } );
+
+        //Info objects from multiphase MatCfg objects:
+        {
+          std::vector<InfoPtr> released;//released after unlocking
+          auto& cache = getMultiPhaseMatCfgCache();
+          NCRYSTAL_LOCK_GUARD(cache.mtx);
+          for ( auto it = cache.db.begin(); it != cache.db.end(); ) {
+            bool affected = false;
+            for ( auto& ph : it->first.phases() )
+              affected = ( affected || textDataIsAffected( ph.second.textDataUID() )
+                           || req.dataSourceNames.count( ph.second.getDataSourceName().str() ) > 0 );
+            auto info = it->second.lock();
+            if ( !affected && info != nullptr )
+              affected = infoIsAffected( *info, req );
+            if ( !affected ) {
+              ++it;
+              continue;
+            }
+            ++n;
+            if ( info != nullptr ) {
+              addEvictedInfo( *info, evicted );
+              cache.strong_refs.remove( info );
+              released.push_back( std::move(info) );
+            }
+            it = cache.db.erase(it);
+          }
+        }
+        req.infoUIDs.insert( evicted.infoUIDs.begin(), evicted.infoUIDs.end() );
+        req.dynInfoUIDs.insert( evicted.dynInfoUIDs.begin(), evicted.dynInfoUIDs.end() );
+
+        //Processes:
+        n += evictProcesses<ScatterRequest>( req );
+        n += evictProcesses<AbsorptionRequest>( req );
+        return n;
+      }
+    }
+  }
+}
+
+std::size_t NCF::CacheEvictionRequest::size() const
+{
+  return ( ( allTextData ? 1 : 0 ) + textDataUIDs.size() + dataSourceNames.size() + infoUIDs.size()
+           + dynInfoUIDs.size() + sabDataUIDs.size() );
+}
+
+void NCF::registerCacheEvictionFunction( std::function<std::size_t(CacheEvictionRequest&)> fct )
+{
+  auto& reg = cacheEvictionRegistry();
+  NCRYSTAL_LOCK_GUARD(reg.mtx);
+  reg.fcts.push_back( std::move(fct) );
+}
+
+std::size_t NCF::evictFromCaches( CacheEvictionRequest req )
+{
+  decltype(CacheEvictionRegistry::fcts) fcts;
+  {
+    auto& reg = cacheEvictionRegistry();
+    NCRYSTAL_LOCK_GUARD(reg.mtx);
+    fcts = reg.fcts;
+  }
+  //The TextData objects themselves:
+  std::size_t n = evictFromTextDataStore( [&req]( const TextData& td )
+  {
+    return ( req.allTextData || req.textDataUIDs.count( td.dataUID() ) > 0
+             || req.dataSourceNames.count( td.dataSourceName().str() ) > 0 );
+  } ).size();
+  //Evicted objects might have been used to derive other cached objects, so
+  //repeat until no more such objects are found:
+  while ( true ) {
+    const std::size_t reqsize = req.size();
+    n += evictFactImplEntries( req );
+    for ( auto& fct : fcts )
+      n += fct( req );
+    if ( req.size() == reqsize )
+      break;
+  }
+  if ( n > 0 )
+    ++s_procMemoEpoch;
+  return n;
+}
+
+std::size_t NCF::evictFromCachesByDataSourceName( const std::string& dsn )
+{
+  CacheEvictionRequest req;
+  if ( dsn.empty() )
+    req.allTextData = true;
+  else
+    req.dataSourceNames.insert( dsn );
+  return evictFromCaches( std::move(req) );
+}
@@ -74,6 +74,13 @@ NCF::InfoRequest::InfoRequest( const MatCfg& cfg )
                    cfg.rawCfgData(),
                    [](Cfg::detail::VarId varid){ return Cfg::varGroup(varid) == Cfg::VarGroupId::Info; } );
   checkParamConsistency();
+  updateDataHash();
+}
+
+void NCF::InfoRequest::updateDataHash()
+{
+  m_dataHash = calcHash( m_dataSourceName.str() );
+  hash_combine( m_dataHash, CfgManip::hash( m_data ) );
 }
 
 bool NCF::InfoRequest::cmpDataLT( const InfoRequest& o ) const
@@ -162,6 +169,14 @@ NCF::ProcessRequestBase<TRequest>::ProcessRequestBase( internal_t, InfoPtr infop
   if ( opt_data )
     CfgManip::apply( m_data, *opt_data, TRequest::varIsApplicable );
   static_cast<const TRequest*>(this)->checkParamConsistency();
+  updateDataHash();
+}
+
+template<typename TRequest>
+void NCF::ProcessRequestBase<TRequest>::updateDataHash()
+{
+  m_dataHash = calcHash( m_dataSourceName.str() );
+  hash_combine( m_dataHash, CfgManip::hash( m_data ) );
 }
 
 template<typename TRequest>
@@ -193,6 +208,7 @@ TRequest NCF::ProcessRequestBase<TRequest>::createChildRequest( unsigned ichild
                                                   //this here due to the
                                                   //detail_copyUnderlying(..)
                                                   //usage)
+  child_request.updateDataHash();
   return child_request;
 }
 
@@ -241,6 +257,7 @@ TRequest NCF::ProcessRequestBase<TRequest>::modified( internal_t, const char*str
                     <<"\" (only settings applicable to the process type are allowed in this context)");
   auto res = TRequest( *static_cast<const TRequest*>(this) );
   CfgManip::apply( res.m_data, tmpdata );
+  res.updateDataHash();
   return res;
 }
 
@@ -258,16 +275,21 @@ TRequest NCF::ProcessRequestBase<TRequest>::modified( const char* cstr ) const
 }
 
 int NCF::ScatterRequest::get_vdoslux() const { return CfgManip::get_vdoslux(rawCfgData()); }
+int NCF::ScatterRequest::get_sabsampler() const { return CfgManip::get_sabsampler(rawCfgData()); }
+int NCF::ScatterRequest::get_elincsampler() const { return CfgManip::get_elincsampler(rawCfgData()); }
 bool NCF::ScatterRequest::get_coh_elas() const { return CfgManip::get_coh_elas(rawCfgData()); }
 bool NCF::ScatterRequest::get_incoh_elas() const { return CfgManip::get_incoh_elas(rawCfgData()); }
 bool NCF::ScatterRequest::get_sans() const { return CfgManip::get_sans(rawCfgData()); }
+std::string NCF::ScatterRequest::get_sabgrid() const { return CfgManip::get_sabgrid(rawCfgData()).to_string(); }
 std::string NCF::ScatterRequest::get_inelas() const { return CfgManip::get_inelas(rawCfgData()).to_string(); }
 std::string NCF::ScatterRequest::get_scatfactory() const { return CfgManip::get_scatfactory(rawCfgData()).to_string(); }
 NC::MosaicityFWHM NCF::ScatterRequest::get_mos() const { return CfgManip::get_mos(rawCfgData()); }
 NC::OrientDir NCF::ScatterRequest::get_dir1() const { return CfgManip::get_dir1(rawCfgData()); }
 NC::OrientDir NCF::ScatterRequest::get_dir2() const { return CfgManip::get_dir2(rawCfgData()); }
 double NCF::ScatterRequest::get_mosprec() const { return CfgManip::get_mosprec(rawCfgData()); }
+double NCF::ScatterRequest::get_mosscreen() const { return CfgManip::get_mosscreen(rawCfgData()); }
 double NCF::ScatterRequest::get_sccutoff() const { return CfgManip::get_sccutoff(rawCfgData()); }
+double NCF::ScatterRequest::get_scprune() const { return CfgManip::get_scprune(rawCfgData()); }
 double NCF::ScatterRequest::get_dirtol() const { return CfgManip::get_dirtol(rawCfgData()); }
 const NC::LCAxis& NCF::ScatterRequest::get_lcaxis() const { return CfgManip::get_lcaxis(rawCfgData()); }
 std::int_least32_t NCF::ScatterRequest::get_lcmode() const { return CfgManip::get_lcmode(rawCfgData()); }
@@ -20,6 +20,8 @@
 
 #include "NCrystal/internal/NCFactoryUtils.hh"
 #include "NCrystal/internal/NCString.hh"
+#include <iomanip>
+#include <sstream>
 
 namespace NC = NCrystal;
 
@@ -29,6 +31,15 @@ namespace NCrystal {
                                                  || ncgetenv_bool("DEBUGFACTORY")
                                                  || ncgetenv_bool("DEBUG_FACT")
                                                  || ncgetenv_bool("DEBUGFACT") );
+    std::size_t initialFactoryMemoryBudget()
+    {
+      double mb = ncgetenv_dbl("FACTORY_MEMORY_BUDGET_MB",0.0);
+      if ( !(mb>=0.0) || !(mb<1e12) )
+        NCRYSTAL_THROW2(BadInput,"Invalid value of NCRYSTAL_FACTORY_MEMORY_BUDGET_MB environment variable: "<<mb);
+      return static_cast<std::size_t>( mb * 1048576.0 );
+    }
+    static std::atomic<std::size_t> s_factoryMemoryBudget( initialFactoryMemoryBudget() );
+    static std::atomic<std::size_t> s_factoryStrongRefBytes( 0 );
   }
 }
 
@@ -42,6 +53,194 @@ bool NC::getFactoryVerbosity()
   return s_factoryVerbosity;
 }
 
+void NC::setFactoryMemoryBudget( std::size_t bytes )
+{
+  s_factoryMemoryBudget = bytes;
+}
+
+std::size_t NC::getFactoryMemoryBudget()
+{
+  return s_factoryMemoryBudget;
+}
+
+std::size_t NC::getFactoryStrongRefBytes()
+{
+  return s_factoryStrongRefBytes;
+}
+
+void NC::detail::registerFactoryStrongRefBytes( std::size_t added, std::size_t removed )
+{
+  if ( added )
+    s_factoryStrongRefBytes += added;
+  if ( removed ) {
+    nc_assert( s_factoryStrongRefBytes.load() >= removed );
+    s_factoryStrongRefBytes -= removed;
+  }
+}
+
+bool NC::detail::factoryMemoryBudgetExceeded()
+{
+  const std::size_t budget = s_factoryMemoryBudget.load();
+  return budget > 0 && s_factoryStrongRefBytes.load() > budget;
+}
+
+namespace NCrystal {
+  namespace {
+    using FactoryStatsFct = std::function<std::pair<std::string,FactoryStats>()>;
+    struct FactoryStatsRegistry {
+      std::mutex mtx;
+      std::vector<FactoryStatsFct> fcts;
+    };
+    FactoryStatsRegistry& factoryStatsRegistry()
+    {
+      static FactoryStatsRegistry s_reg;
+      return s_reg;
+    }
+  }
+}
+
+void NC::detail::registerFactoryStatsFunction( FactoryStatsFct f )
+{
+  auto& reg = factoryStatsRegistry();
+  NCRYSTAL_LOCK_GUARD(reg.mtx);
+  reg.fcts.push_back( std::move(f) );
+}
+
+unsigned NC::detail::currentThreadFactoryShard()
+{
+  static std::atomic<unsigned> s_nextShard{0};
+  static thread_local unsigned s_shard = s_nextShard.fetch_add( 1 );
+  return s_shard;
+}
+
+namespace NCrystal {
+  namespace {
+    static thread_local unsigned s_cacheReplicaDomain = 0;
+  }
+}
+
+unsigned NC::detail::currentCacheReplicaDomain()
+{
+  return s_cacheReplicaDomain;
+}
+
+NC::CacheReplicaScope::CacheReplicaScope( unsigned domain )
+  : m_prev( s_cacheReplicaDomain )
+{
+  s_cacheReplicaDomain = domain;
+}
+
+NC::CacheReplicaScope::~CacheReplicaScope()
+{
+  s_cacheReplicaDomain = m_prev;
+}
+
+std::vector<std::pair<std::string,NC::FactoryStats>> NC::getAllFactoryStats()
+{
+  //Invoke the functions without holding the registry lock, since they lock
+  //the factory mutexes (which are held while registering):
+  std::vector<FactoryStatsFct> fcts;
+  {
+    auto& reg = factoryStatsRegistry();
+    NCRYSTAL_LOCK_GUARD(reg.mtx);
+    fcts = reg.fcts;
+  }
+  std::vector<std::pair<std::string,FactoryStats>> res;
+  res.reserve( fcts.size() );
+  for ( auto& f : fcts )
+    res.push_back( f() );
+  return res;
+}
+
+namespace NCrystal {
+  namespace {
+    static std::atomic<bool> s_initProfiling( ncgetenv_bool("PROFILE_INIT") );
+
+    struct InitProfileRecord {
+      const char * label;
+      std::string details;
+      const char * note = nullptr;
+      std::chrono::steady_clock::time_point t0;
+      double dt = 0.0;//seconds
+      std::vector<InitProfileRecord> children;
+    };
+
+    std::vector<InitProfileRecord>& initProfileStack()
+    {
+#ifndef NCRYSTAL_DISABLE_THREADS
+      static thread_local std::vector<InitProfileRecord> s_stack;
+#else
+      static std::vector<InitProfileRecord> s_stack;
+#endif
+      return s_stack;
+    }
+
+    void printInitProfileRecord( std::ostream& os, const InitProfileRecord& r,
+                                 const std::string& prefix, unsigned depth )
+    {
+      os << prefix << std::string( 2 * depth, ' ' ) << r.label;
+      if ( r.note )
+        os << " (" << r.note << ")";
+      os << " : " << std::fixed << std::setprecision(3) << r.dt * 1000.0 << " ms";
+      if ( !r.details.empty() )
+        os << " [" << r.details << "]";
+      os << '\n';
+      for ( auto& c : r.children )
+        printInitProfileRecord( os, c, prefix, depth + 1 );
+    }
+  }
+}
+
+void NC::enableInitProfiling( bool status )
+{
+  s_initProfiling = status;
+}
+
+bool NC::getInitProfiling()
+{
+  return s_initProfiling;
+}
+
+void NC::InitProfileScope::setNote( const char * note )
+{
+  if ( !s_initProfiling )
+    return;
+  auto& stack = initProfileStack();
+  if ( !stack.empty() )
+    stack.back().note = note;
+}
+
+void NC::InitProfileScope::begin( const char * label, std::string&& details )
+{
+  auto& stack = initProfileStack();
+  stack.emplace_back();
+  auto& r = stack.back();
+  r.label = label;
+  r.details = std::move(details);
+  r.t0 = std::chrono::steady_clock::now();
+}
+
+void NC::InitProfileScope::end()
+{
+  auto& stack = initProfileStack();
+  nc_assert_always( !stack.empty() );
+  InitProfileRecord r = std::move( stack.back() );
+  stack.pop_back();
+  r.dt = std::chrono::duration<double>( std::chrono::steady_clock::now() - r.t0 ).count();
+  if ( !stack.empty() ) {
+    stack.back().children.push_back( std::move(r) );
+    return;
+  }
+  //Top-level scope finished, print everything in one go:
+  std::ostringstream ss;
+  std::ostringstream prefix;
+  prefix << "NCrystal::InitProfile (thread_" << thread_details::currentThreadIDForPrint() << ") ";
+  printInitProfileRecord( ss, r, prefix.str(), 0 );
+  static std::mutex s_printmtx;
+  NCRYSTAL_LOCK_GUARD(s_printmtx);
+  std::cout << ss.str() << std::flush;
+}
+
 #ifndef NCRYSTAL_DISABLE_THREADS
 namespace NCrystal {
   namespace detail {
@@ -132,7 +331,6 @@ namespace NCrystal {
     }
     void registerThreadAsFinishedWaiting( std::thread::id thrid )
     {
-      std::cout<<"registerThreadAsFinished :"<<thrid<<std::endl;
       auto& db = getDeadLockDB();
       NCRYSTAL_LOCK_GUARD(db.mtx);
       auto& ts = db.getThreadStatus( thrid );
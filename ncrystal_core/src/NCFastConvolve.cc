@@ -21,144 +21,183 @@
 #include "NCrystal/NCDefs.hh"
 #include "NCrystal/internal/NCFastConvolve.hh"
 #include <cstdlib>
+#include <complex>
+#include <array>
 
 namespace NC = NCrystal;
 
-//Temporarily uncomment the following define to test with safer but slower code:
-//#define NCRYSTAL_FASTCONVOLVE_EXTRASAFEMATH
-
 NC::FastConvolve::FastConvolve() = default;
 NC::FastConvolve::~FastConvolve() = default;
 
+namespace NCrystal {
+  namespace {
 
-void NC::FastConvolve::initWTable( unsigned n_size )
-{
-  //round n_size up to next power of 2:
-  unsigned n_size_pow2 = 1;
-  while (n_size_pow2<n_size)
-    n_size_pow2 *= 2;
-  unsigned n=0;
-  unsigned tmp = 1;
-  while ( tmp < n_size_pow2 ) {
-    n+=1;
-    tmp *= 2;
-  }
-  nc_assert(tmp==n_size_pow2);
-
-  m_w.clear();
-  m_w.reserve(n_size_pow2);
-  for( unsigned i = 0; i < n_size_pow2; ++i ) {
-    NC::PairDD res = NC::FastConvolve::calcPhase(i, n);
-    m_w.emplace_back(std::complex<double>(res.first,res.second));
-  }
-}
-
-void NC::FastConvolve::fftconv( const NC::VectD& a1, const NC::VectD& a2, NC::VectD& y, double dt )
-{
-  const int minimum_out_size = a1.size() + a2.size() - 1;
-
-  std::vector<std::complex<double> > b1(a1.begin(),a1.end());
-  fftd(b1,FT_forward,minimum_out_size);
-  std::vector<std::complex<double> > b2(a2.begin(),a2.end());
-  fftd(b2,FT_forward,minimum_out_size);
+    using Cplx = std::complex<double>;
 
+    const Cplx* twiddleTable( unsigned log2N )
+    {
+      //Returns table of w_k=exp(i*2pi*k/N) for k=0..N/2-1, where N=2^log2N. The
+      //tables are built on first request and kept for the lifetime of the
+      //process. Since they are never modified afterwards, it is safe to use
+      //them without holding the lock. The tables are intentionally never
+      //destroyed, since background threads (see queueBackgroundTask) might
+      //still be using them while static objects are destroyed at exit.
+      nc_assert_always(log2N<32);
+      static std::mutex s_mtx;
+      static auto& s_tables = *new std::array<std::unique_ptr<std::vector<Cplx>>,32>();
+      NCRYSTAL_LOCK_GUARD(s_mtx);
+      auto& table = s_tables.at(log2N);
+      if ( !table ) {
+        const std::size_t nhalf = ( std::size_t(1) << log2N ) / 2;
+        auto t = std::make_unique<std::vector<Cplx>>();
+        t->reserve( std::max<std::size_t>(1,nhalf) );
+        for ( std::size_t k = 0; k < nhalf; ++k ) {
+          PairDD res = FastConvolve::calcPhase( static_cast<unsigned>(k), log2N );
+          t->emplace_back( res.first, res.second );
+        }
+        if ( t->empty() )
+          t->emplace_back( 1.0, 0.0 );
+        table = std::move(t);
+      }
+      return table->data();
+    }
 
-  nc_assert(b1.size()==b2.size());
-  std::vector<std::complex<double> >::iterator itb1(b1.begin()), itb1E(b1.end()), itb2(b2.begin());
-  while (itb1!=itb1E)
-    *itb1++ *= *itb2++;
+    //In-place radix-2 complex FFT of data with M entries (M must be a power of
+    //2). The twiddle factors exp(i*2pi*j/M) must be available as
+    //w[j*wstride]. The forward transform uses exp(-i*...) and the inverse
+    //exp(+i*...). The inverse transform is not normalised.
+    void fftInPlace( Cplx* data, std::size_t M, const Cplx* w, std::size_t wstride, bool inverse )
+    {
+      //Bit-reversal permutation:
+      for ( std::size_t i = 1, j = 0; i < M; ++i ) {
+        std::size_t bit = M >> 1;
+        for ( ; j & bit; bit >>= 1 )
+          j ^= bit;
+        j ^= bit;
+        if ( i < j )
+          std::swap( data[i], data[j] );
+      }
+      //Butterflies (std::complex<> multiplication is slow since it takes care
+      //of proper inf/nan/overflow, so we do the arithmetics by hand):
+      const double sign = ( inverse ? 1.0 : -1.0 );
+      for ( std::size_t len = 2; len <= M; len <<= 1 ) {
+        const std::size_t half = len / 2;
+        const std::size_t step = ( M / len ) * wstride;
+        for ( std::size_t i = 0; i < M; i += len ) {
+          Cplx* d0 = data + i;
+          Cplx* d1 = d0 + half;
+          for ( std::size_t k = 0; k < half; ++k ) {
+            const Cplx& wk = w[k*step];
+            const double c(wk.real()), s(sign*wk.imag());
+            const double a(d1[k].real()), b(d1[k].imag());
+            const double vr(a*c-b*s);
+            const double vi(a*s+b*c);
+            const double ur(d0[k].real()), ui(d0[k].imag());
+            d0[k] = Cplx( ur + vr, ui + vi );
+            d1[k] = Cplx( ur - vr, ui - vi );
+          }
+        }
+      }
+    }
 
-  fftd(b1,FT_inverse,minimum_out_size);
+    //Real-to-complex FFT of the real input x (zero-padded to length N=2^log2N,
+    //N>=2), producing the N/2+1 non-redundant coefficients X[k]=sum_n
+    //x[n]*exp(-i*2pi*k*n/N) in out. The even and odd entries of x are packed
+    //into a complex array of length N/2, which is transformed and finally
+    //unpacked.
+    void fftRealForward( const VectD& x, unsigned log2N, const Cplx* wN, std::vector<Cplx>& out )
+    {
+      const std::size_t N = std::size_t(1) << log2N;
+      const std::size_t M = N / 2;
+      nc_assert( M >= 1 && x.size() <= N );
+      std::vector<Cplx> z( M );
+      const std::size_t nx = x.size();
+      for ( std::size_t m = 0; m < M; ++m ) {
+        const std::size_t i0 = 2*m;
+        z[m] = Cplx( i0 < nx ? x[i0] : 0.0, i0+1 < nx ? x[i0+1] : 0.0 );
+      }
+      fftInPlace( z.data(), M, wN, 2, false );
+      out.resize( M + 1 );
+      for ( std::size_t k = 0; k <= M; ++k ) {
+        const Cplx& zk = z[ k == M ? 0 : k ];
+        const Cplx& zc = z[ k == 0 ? 0 : M - k ];//to be conjugated
+        //Fe=(zk+conj(zc))/2, Fo=(zk-conj(zc))/(2i)
+        const double fer = 0.5*(zk.real()+zc.real());
+        const double fei = 0.5*(zk.imag()-zc.imag());
+        const double for_ = 0.5*(zk.imag()+zc.imag());
+        const double foi = -0.5*(zk.real()-zc.real());
+        //X = Fe + exp(-i*2pi*k/N)*Fo:
+        const double c = ( k == M ? -1.0 : wN[k].real() );
+        const double s = ( k == M ? 0.0 : -wN[k].imag() );
+        out[k] = Cplx( fer + (for_*c-foi*s), fei + (for_*s+foi*c) );
+      }
+    }
 
-  y.resize(minimum_out_size);
-  const double k = dt/b1.size();
-  nc_assert(b1.size()==b2.size());
-  nc_assert(y.size()<=b1.size());
-  VectD::iterator ity(y.begin()), ityE(y.end());
-  itb1 = b1.begin();
-  for(;ity!=ityE;++ity,++itb1) {
-#ifdef NCRYSTAL_FASTCONVOLVE_EXTRASAFEMATH
-    //use std::abs which calls std::hypot behind the scenes (expensive but can avoid overflows)
-    *ity = k * std::abs(*itb1);
-#else
-    //naive and simple, avoids std::hypot
-    double a(itb1->real());
-    double b(itb1->imag());
-    *ity = std::sqrt(a*a+b*b)*k;
-#endif
+    //Inverse of fftRealForward (not normalised, i.e. the result is N times the
+    //original input). Input is the N/2+1 coefficients X[k] of a real sequence,
+    //and the output (of length N) is placed in z, packed as even/odd entries in
+    //the real/imaginary parts of its N/2 entries.
+    void fftRealInverse( const std::vector<Cplx>& X, unsigned log2N, const Cplx* wN, std::vector<Cplx>& z )
+    {
+      const std::size_t N = std::size_t(1) << log2N;
+      const std::size_t M = N / 2;
+      nc_assert( X.size() == M + 1 );
+      z.resize( M );
+      for ( std::size_t k = 0; k < M; ++k ) {
+        const Cplx& xk = X[k];
+        const Cplx& xc = X[M-k];//to be conjugated
+        //E=xk+conj(xc), O=(xk-conj(xc))*exp(i*2pi*k/N), Z=E+i*O:
+        const double er = xk.real()+xc.real();
+        const double ei = xk.imag()-xc.imag();
+        const double dr = xk.real()-xc.real();
+        const double di = xk.imag()+xc.imag();
+        const double c = wN[k].real();
+        const double s = wN[k].imag();
+        const double orr = dr*c - di*s;
+        const double oi = dr*s + di*c;
+        z[k] = Cplx( er - oi, ei + orr );
+      }
+      fftInPlace( z.data(), M, wN, 2, true );
+    }
   }
 }
 
-void NC::FastConvolve::fftd( std::vector<std::complex< double> > &data, FastConvolve::caltype ct,
-                             unsigned minimum_output_size )
+void NC::FastConvolve::fftconv( const NC::VectD& a1, const NC::VectD& a2, NC::VectD& y, double dt )
 {
-  double output_log_size_fp = std::ceil(std::log2(minimum_output_size));
-  nc_assert_always(output_log_size_fp<32);
-  const int output_log_size = output_log_size_fp;
-  const int output_size = ( 1 << output_log_size );//this is now minimum_output_size rounded up to next power of 2
+  nc_assert_always( !a1.empty() && !a2.empty() );
+  const std::size_t minimum_out_size = a1.size() + a2.size() - 1;
 
-  const unsigned wTableSizeNeeded = std::max<unsigned>(output_size,data.size());
-  if ( m_w.size() < wTableSizeNeeded )
-    initWTable( wTableSizeNeeded );
+  //Transform size, N=2^log2N, is minimum_out_size rounded up to next power of 2
+  //(but at least 2, as needed by the real-valued transforms):
+  unsigned log2N = 1;
+  while ( ( std::size_t(1) << log2N ) < minimum_out_size )
+    ++log2N;
+  nc_assert_always(log2N<32);
+  const std::size_t N = std::size_t(1) << log2N;
+  const Cplx * wN = twiddleTable( log2N );
 
-  nc_assert_always( data.size() <= (std::size_t)output_size );
-  if( data.size() != (size_t)output_size )
-    data.resize(output_size,std::complex<double>());
+  std::vector<Cplx> b1, b2;
+  fftRealForward( a1, log2N, wN, b1 );
+  fftRealForward( a2, log2N, wN, b2 );
 
-  for(int j=1;j<output_size-1;++j)
-    {
-      int i=0;
-      for(int k=1,tmp=j; k<output_size; i=(i<<1)|(tmp&1),k<<=1,tmp>>=1)
-        {
-        }
-      if(j<i)
-        swap(data[i],data[j]);
-    }
+  nc_assert(b1.size()==b2.size());
+  for ( std::size_t k = 0; k < b1.size(); ++k ) {
+    const double a(b1[k].real()), b(b1[k].imag()), c(b2[k].real()), d(b2[k].imag());
+    b1[k] = Cplx( a*c-b*d, a*d+b*c );
+  }
 
-  const int jump = m_w.size()/output_size;
-#ifndef NCRYSTAL_FASTCONVOLVE_EXTRASAFEMATH
-  const double convfact = (ct==FT_inverse?-1.0:1.0);
-#endif
+  std::vector<Cplx>& z = b2;//reuse memory
+  fftRealInverse( b1, log2N, wN, z );
 
-  for(int i=0;i<output_log_size;++i){
-    int z=0;
-    const int i1 = (1<<i);
-    const int i1m1 = i1-1;
-    const int i2 = 1<<(output_log_size-i-1);
-    for(int j=0;j<output_size;++j){
-      if((j/i1)%2){
-        std::complex<double>& data_j = data[j];
-        std::complex<double>& data_sympos = data[j-i1];
-#ifdef NCRYSTAL_FASTCONVOLVE_EXTRASAFEMATH
-        //std::complex<> multiplication is slow since it takes care of proper inf/nan/overflow
-        data_j *= (ct==inverse?std::conj(m_w[z*jump]):m_w[z*jump]);
-        //and the -=,+= operators seems to carry significant overhead for some reason:
-        std::complex<double> temp = data_sympos;
-        data_sympos += data_j;
-        temp -= data_j;
-        data_j = temp;
-#else
-        //naive and simple is faster:
-        const std::complex<double>& w_zjump = m_w[z*jump];
-        const double a(data_j.real()), b(data_j.imag()), c(w_zjump.real()), d(convfact * w_zjump.imag());
-        const double jr(a*c-b*d);
-        const double ji(a*d+b*c);
-        const double sr(data_sympos.real());//no by-ref access to real/imag parts
-        const double si(data_sympos.imag());
-        data_j.real( sr - jr );
-        data_j.imag( si - ji );
-        data_sympos.real( sr + jr );
-        data_sympos.imag( si + ji );
-#endif
-        z += i2;
-      } else {
-        z = 0;
-        //will be the same result for the next i1-1 loops, so skip ahead:
-        j += i1m1;
-      }
-    }
+  //The results are real, so |b| is simply the absolute value of the real-valued
+  //IFFT. Entry i is found in the real (i even) or imaginary (i odd) part of z[i/2]:
+  y.resize(minimum_out_size);
+  const double k = dt/N;
+  nc_assert(y.size()<=N);
+  for ( std::size_t i = 0; i < minimum_out_size; ++i ) {
+    const Cplx& zz = z[i/2];
+    y[i] = std::fabs( i%2 ? zz.imag() : zz.real() ) * k;
   }
-
 }
 
 NC::PairDD NC::FastConvolve::calcPhase(unsigned k, unsigned n)
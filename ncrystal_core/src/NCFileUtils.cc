@@ -45,6 +45,39 @@ std::string NC::tryRealPath( const std::string& ) { return {}; }
 #endif
 
 
+#if defined(__linux__)
+#include <cerrno>
+#include <sys/stat.h>
+#include <unistd.h>
+std::string NC::nodeSharedCacheDir()
+{
+  const std::string shmroot = "/dev/shm";
+  struct stat st;
+  if ( ::stat( shmroot.c_str(), &st ) != 0 || !S_ISDIR(st.st_mode) )
+    return {};
+  const uid_t uid = ::getuid();
+  const std::string dir = shmroot + "/ncrystal_cache_" + std::to_string( static_cast<unsigned long>(uid) );
+  if ( ::mkdir( dir.c_str(), 0700 ) != 0 && errno != EEXIST )
+    return {};
+  //Refuse to use anything but a private directory of the user (NB: lstat, so
+  //symlinks planted by others are not followed):
+  if ( ::lstat( dir.c_str(), &st ) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != uid
+       || ( st.st_mode & ( S_IWGRP | S_IWOTH ) ) )
+    return {};
+  return dir;
+}
+#else
+std::string NC::nodeSharedCacheDir() { return {}; }
+#endif
+
+std::string NC::initialCacheDirSetting( const std::string& envname )
+{
+  std::string dir = ncgetenv( envname );
+  if ( dir.empty() && ncgetenv_bool("NODE_SHARED_CACHE") )
+    dir = nodeSharedCacheDir();
+  return dir;
+}
+
 NC::Optional<std::string> NC::readEntireFileToString( const std::string& path )
 {
   //Read entire file into a string while protecting against someone mistakenly
@@ -74,6 +107,94 @@ NC::Optional<std::string> NC::readEntireFileToString( const std::string& path )
   return Optional<std::string>(std::move(out));
 }
 
+#if defined(__unix__) || (defined (__APPLE__) && defined (__MACH__))
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+namespace NCrystal {
+  namespace {
+    struct MappedFileStamp {
+      dev_t dev;
+      ino_t ino;
+      off_t size;
+      int64_t mtime;
+      MappedFileStamp( const struct stat& st )
+        : dev(st.st_dev), ino(st.st_ino), size(st.st_size),
+          mtime( static_cast<int64_t>( st.st_mtime ) * 1000000000 )
+      {
+#if defined(__linux__)
+        mtime += static_cast<int64_t>( st.st_mtim.tv_nsec );
+#elif defined (__APPLE__) && defined (__MACH__)
+        mtime += static_cast<int64_t>( st.st_mtimespec.tv_nsec );
+#endif
+      }
+      bool operator==( const MappedFileStamp& o ) const
+      {
+        return dev == o.dev && ino == o.ino && size == o.size && mtime == o.mtime;
+      }
+    };
+
+    //Unmaps the data, and holds the file stamp (found via std::get_deleter):
+    struct MappedFileDeleter {
+      std::size_t size;
+      std::string path;
+      MappedFileStamp stamp;
+      void operator()( const void * p ) const { ::munmap( const_cast<void*>(p), size ); }
+    };
+  }
+}
+
+NC::Optional<NC::RawStrData> NC::tryMapFileToRawStrData( const std::string& path, std::size_t minsize )
+{
+  static const bool s_disabled = ncgetenv_bool("DISABLE_MMAP");
+  if ( s_disabled )
+    return NullOpt;
+  int fd = ::open( path.c_str(), O_RDONLY );
+  if ( fd < 0 )
+    return NullOpt;
+  struct stat st;
+  if ( ::fstat( fd, &st ) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 ) {
+    ::close(fd);
+    return NullOpt;
+  }
+  const std::size_t size = static_cast<std::size_t>( st.st_size );
+  const long pagesize = ::sysconf( _SC_PAGESIZE );
+  if ( size < minsize || pagesize <= 0 || size % static_cast<std::size_t>( pagesize ) == 0 ) {
+    //Too small to be worth it, or no room for the terminating null char (the
+    //remainder of the last mapped page is otherwise guaranteed to be zero):
+    ::close(fd);
+    return NullOpt;
+  }
+  void * addr = ::mmap( nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  ::close(fd);//mapping stays valid
+  if ( addr == MAP_FAILED )
+    return NullOpt;
+  std::shared_ptr<const void> owner( addr, MappedFileDeleter{ size, path, MappedFileStamp( st ) } );
+  const char * b = static_cast<const char*>( addr );
+  return RawStrData( RawStrData::external_owner_t{}, std::move(owner), b, b + size, path.c_str() );
+}
+
+bool NC::mappedFileIsUnchanged( const RawStrData& data )
+{
+  auto deleter = std::get_deleter<MappedFileDeleter>( data.externalOwner() );
+  if ( !deleter )
+    return true;
+  struct stat st;
+  return ::stat( deleter->path.c_str(), &st ) == 0 && MappedFileStamp( st ) == deleter->stamp;
+}
+#else
+NC::Optional<NC::RawStrData> NC::tryMapFileToRawStrData( const std::string&, std::size_t )
+{
+  return NullOpt;
+}
+
+bool NC::mappedFileIsUnchanged( const RawStrData& )
+{
+  return true;
+}
+#endif
+
 bool NC::path_is_absolute( const std::string& p )
 {
   if (p.empty())
@@ -141,6 +262,25 @@ NC::VectS NC::ncglob(const std::string& pattern) {
   std::sort(result.begin(),result.end());
   return result;
 }
+NC::Optional<NC::VectS> NC::listDirectory( const std::string& dirname ) {
+  VectS result;
+  WIN32_FIND_DATA fdata;
+  HANDLE fh = FindFirstFileA(path_join(dirname,"*").c_str(), &fdata);
+  if (fh == INVALID_HANDLE_VALUE)
+    return NullOpt;
+  while (true) {
+    std::string name(fdata.cFileName);
+    if ( name != "." && name != ".." )
+      result.push_back(std::move(name));
+    if (!FindNextFileA(fh, &fdata))
+      break;
+  }
+  FindClose(fh);
+  return result;
+}
+NC::Optional<int64_t> NC::fileModificationTime( const std::string& ) {
+  return NullOpt;
+}
 //Windows getcwd:
 std::string NC::ncgetcwd() {
     char buff[MAX_PATH];
@@ -171,6 +311,33 @@ NC::VectS NC::ncglob(const std::string& pattern) {
   globfree(&pglob);
   return result;
 }
+#include <dirent.h>
+#include <sys/stat.h>
+NC::Optional<NC::VectS> NC::listDirectory( const std::string& dirname ) {
+  DIR * dir = ::opendir( dirname.c_str() );
+  if ( !dir )
+    return NullOpt;
+  VectS result;
+  while ( struct dirent * ent = ::readdir( dir ) ) {
+    std::string name( ent->d_name );
+    if ( name != "." && name != ".." )
+      result.push_back( std::move(name) );
+  }
+  ::closedir( dir );
+  return result;
+}
+NC::Optional<int64_t> NC::fileModificationTime( const std::string& path ) {
+  struct stat st;
+  if ( ::stat( path.c_str(), &st ) != 0 )
+    return NullOpt;
+  int64_t t = static_cast<int64_t>( st.st_mtime ) * 1000000000;
+#if defined(__linux__)
+  t += static_cast<int64_t>( st.st_mtim.tv_nsec );
+#elif defined (__APPLE__) && defined (__MACH__)
+  t += static_cast<int64_t>( st.st_mtimespec.tv_nsec );
+#endif
+  return t;
+}
 //POSIX getcwd:
 #include <unistd.h>
 std::string NC::ncgetcwd() {
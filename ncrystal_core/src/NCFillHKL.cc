@@ -23,9 +23,21 @@
 #include "NCrystal/internal/NCRotMatrix.hh"
 #include "NCrystal/internal/NCLatticeUtils.hh"
 #include "NCrystal/internal/NCString.hh"
+#include "NCrystal/internal/NCFactoryUtils.hh"
 #include "NCrystal/internal/NCEqRefl.hh"
+#include "NCrystal/internal/NCThreadUtils.hh"
+#include "NCrystal/internal/NCFileUtils.hh"
+#include "NCrystal/internal/NCDiskCacheUtils.hh"
+#include "NCrystal/NCFact.hh"
+#include "NCrystal/NCVersion.hh"
+#include "NCrystal/NCMem.hh"
 #include <cstdlib>
+#include <cstdio>
+#include <cstring>
 #include <bitset>
+#ifndef NCRYSTAL_DISABLE_THREADS
+#  include <thread>
+#endif
 
 namespace NC = NCrystal;
 
@@ -50,78 +62,13 @@ namespace NCrystal {
   }
 }
 
-#if ( defined(__clang__) || !defined(__GNUC__) || __GNUC__ >= 5 )
-//Use mempool in C++11 (but not gcc 4.x.y)
-#  define NCRYSTAL_NCMAT_USE_MEMPOOL
-#endif
-
-#ifdef NCRYSTAL_NCMAT_USE_MEMPOOL
-#include <stdexcept>
-#include <type_traits>
-#include <scoped_allocator>
 namespace NCrystal {
   //We use a simple expanding-only memory pool for the temporary multimap used
   //to detect hkl families. This results in better cache locality and should
-  //hopefully reduce memory fragmentation. TODO: Consider moving this pool
-  //infrastructure to common utilities.
-  class MemPool {
-  public:
-    explicit MemPool(std::size_t s) : m_size(s), m_offset(s+1) { m_chunks.reserve(64); }
-    MemPool(MemPool const &) = delete;
-    MemPool & operator=(MemPool const &) = delete;
-    ~MemPool() { for (auto& e: m_chunks) ::operator delete(e); }
-    void deallocate(void *, std::size_t) {}//ignore
-    void * allocate(std::size_t n, std::size_t alignment)
-    {
-      nc_assert(n&&n<m_size);
-      m_offset = ((m_offset + alignment - 1) / alignment ) * alignment;//move up to alignment
-      if (m_offset + n > m_size) {//must grow
-        m_chunks.push_back(m_data = static_cast<unsigned char *>(::operator new(m_size)));
-        m_offset = 0;
-      }
-      void * result = m_data + m_offset;
-      m_offset += n;
-      return result;
-    }
-  private:
-    unsigned char * m_data;
-    std::size_t const m_size;
-    std::size_t m_offset;
-    std::vector<unsigned char*> m_chunks;
-  };
-
-  template <typename T>
-  struct MemPoolAllocator {
-    //Boiler-plate needed to make stl container use our MemPool:
-    template <typename U> friend struct MemPoolAllocator;
-    using value_type = T;
-    using pointer = T *;
-    using propagate_on_container_copy_assignment = std::true_type;
-    using propagate_on_container_move_assignment = std::true_type;
-    using propagate_on_container_swap = std::true_type;
-    explicit MemPoolAllocator(MemPool * a) : m_pool(a) {}
-    template <typename U> MemPoolAllocator(MemPoolAllocator<U> const & rhs) : m_pool(rhs.m_pool) {}
-    pointer allocate(std::size_t n)
-    {
-      return static_cast<pointer>(m_pool->allocate(n * sizeof(T), alignof(T)));
-    }
-    void deallocate(pointer /*p*/, std::size_t /*n*/)
-    {
-      //if MemPool deallocate was not no-op, we should call it here: m_pool->deallocate(p, n * sizeof(T));
-    }
-    template <typename U> bool operator==(MemPoolAllocator<U> const & rhs) const { return m_pool == rhs.m_pool; }
-    template <typename U> bool operator!=(MemPoolAllocator<U> const & rhs) const { return m_pool != rhs.m_pool; }
-  private:
-    MemPool * m_pool;
-  };
-  typedef std::multimap<FamKeyType, size_t, std::less<const FamKeyType>,
-                        std::scoped_allocator_adaptor<MemPoolAllocator<std::pair<const FamKeyType, size_t>>>> FamMap;
-}
-#else
-namespace NCrystal {
-  typedef std::multimap<FamKeyType,size_t> FamMap;
+  //hopefully reduce memory fragmentation.
+  typedef std::multimap<FamKeyType, size_t, std::less<FamKeyType>,
+                        MemPoolAllocator<std::pair<const FamKeyType, size_t>>> FamMap;
 }
-#endif
 
 namespace NCrystal {
   namespace {
@@ -151,10 +98,19 @@ namespace NCrystal {
     constexpr const double fsquarecut_lowest_possible_value = 1.0e-300;
   }
   namespace detail {
+    struct PlaneTable;
     NC::HKLList calculateHKLPlanesWithSymEqRefl( const StructureInfo&,
                                                  const AtomInfoList&,
                                                  FillHKLCfg,
-                                                 bool no_forceunitdebyewallerfactor );
+                                                 bool no_forceunitdebyewallerfactor,
+                                                 const PlaneTable* reuse,
+                                                 PlaneTable* record );
+    NC::HKLList calculateHKLPlanesNoSymEqRefl( const StructureInfo&,
+                                               const AtomInfoList&,
+                                               FillHKLCfg,
+                                               bool no_forceunitdebyewallerfactor,
+                                               const PlaneTable* reuse,
+                                               PlaneTable* record );
 
     struct PreCalc {
       SmallVector<SmallVector<Vector,32>,4> atomic_pos;//atomic coordinates
@@ -223,6 +179,506 @@ namespace NCrystal {
       res.dcut_interval = { clampNormal(cfg.dcutoff), clampNormal(cfg.dcutoffup) };
       return res;
     }
+
+    //Table of all candidate (h,k,l) points passing the d-spacing preselection
+    //along with the temperature independent part of their structure factors
+    //(the sums of cos and sin of the phases for each atom type, stored
+    //consecutively in the sums vector). Keeping this allows new HKL lists to be
+    //produced for other mean-squared-displacements (i.e. temperatures) without
+    //redoing the plane enumeration and phase calculations:
+    struct PlaneTable {
+      std::size_t nsums = 0;//2 per atom type
+      std::vector<HKL> hkl;
+      VectD ksq;
+      VectD sums;
+    };
+
+    //Candidate (h,k,l) points are collected in batches during the loops over
+    //h,k,l, and their structure factors (which is where the time is spent) are
+    //then evaluated concurrently. Results are afterwards handed back serially
+    //and in the original loop order, making the resulting HKL lists
+    //independent of the number of threads used. If a PlaneTable is provided,
+    //all candidates are recorded in it as well:
+    class FSquaredBatch : private NoCopyMove {
+    public:
+      FSquaredBatch( const PreCalc& pc, bool no_forceunitdebyewallerfactor,
+                     double fsquarecut, PlaneTable* record = nullptr )
+        : m_pc(pc),
+          m_nthreads( getNumberOfThreads() ),
+          m_no_forceunitdebyewallerfactor( no_forceunitdebyewallerfactor ),
+          m_fsquarecut( fsquarecut ),
+          m_record( record )
+      {
+        if ( m_nthreads > 1 ) {
+          m_hkl.reserve( s_batchSize );
+          m_ksq.reserve( s_batchSize );
+          m_fsq.resize( s_batchSize );
+          if ( m_record )
+            m_sums.resize( s_batchSize * 2 * pc.csl.size() );
+        }
+        if ( m_record ) {
+          m_record->nsums = 2 * pc.csl.size();
+          m_recordSums.resize( m_record->nsums );
+        }
+        m_scratch = std::unique_ptr<Scratch[]>( new Scratch[m_nthreads] );
+        for ( unsigned i = 0; i < m_nthreads; ++i ) {
+          m_scratch[i].whkl = SmallVectD( SVAllowCopy, pc.whkl );
+          m_scratch[i].cache_factors = SmallVectD( SVAllowCopy, pc.cache_factors );
+        }
+      }
+
+      //Add candidate. The fct(hkl,ksq,fsquared) callback is invoked (possibly
+      //at a later point) for all candidates passing the fsquarecut, in the
+      //order they were added:
+      template<class TFct>
+      void add( const HKL& hkl, double ksq, TFct&& fct )
+      {
+        if ( m_nthreads == 1 ) {
+          //No batching needed:
+          double fsq;
+          if ( m_record ) {
+            calcSums( hkl, m_recordSums.data() );
+            fsq = calcFSquaredFromSums( m_scratch[0], ksq, m_recordSums.data() );
+            m_record->hkl.push_back( hkl );
+            m_record->ksq.push_back( ksq );
+            m_record->sums.insert( m_record->sums.end(), m_recordSums.begin(), m_recordSums.end() );
+          } else {
+            fsq = calcFSquared( m_scratch[0], hkl, ksq );
+          }
+          if ( fsq >= m_fsquarecut )
+            fct( hkl, ksq, fsq );
+          return;
+        }
+        m_hkl.push_back( hkl );
+        m_ksq.push_back( ksq );
+        if ( m_hkl.size() >= s_batchSize )
+          flush( fct );
+      }
+
+      //Evaluate all pending candidates, invoke fct(hkl,ksq,fsquared) in order
+      //for those which pass the fsquarecut, and clear the batch:
+      template<class TFct>
+      void flush( TFct&& fct )
+      {
+        const std::size_t n = m_hkl.size();
+        if ( !n )
+          return;
+        const std::size_t nchunks = ( n < 1024 ? 1 : m_nthreads );
+        parallelForIndex( nchunks, m_nthreads, [this,n,nchunks]( std::size_t ichunk )
+        {
+          nc_assert( ichunk < m_nthreads );
+          Scratch& scratch = m_scratch[ichunk];
+          const std::size_t iend = ( n * ( ichunk + 1 ) ) / nchunks;
+          for ( std::size_t i = ( n * ichunk ) / nchunks; i < iend; ++i ) {
+            if ( m_record ) {
+              double * sums = &m_sums[ i * m_record->nsums ];
+              calcSums( m_hkl[i], sums );
+              m_fsq[i] = calcFSquaredFromSums( scratch, m_ksq[i], sums );
+            } else {
+              m_fsq[i] = calcFSquared( scratch, m_hkl[i], m_ksq[i] );
+            }
+          }
+        } );
+        if ( m_record ) {
+          m_record->hkl.insert( m_record->hkl.end(), m_hkl.begin(), m_hkl.end() );
+          m_record->ksq.insert( m_record->ksq.end(), m_ksq.begin(), m_ksq.end() );
+          m_record->sums.insert( m_record->sums.end(), m_sums.begin(),
+                                 std::next( m_sums.begin(), n * m_record->nsums ) );
+        }
+        for ( std::size_t i = 0; i < n; ++i ) {
+          //skip weak or impossible reflections:
+          if ( m_fsq[i] >= m_fsquarecut )
+            fct( m_hkl[i], m_ksq[i], m_fsq[i] );
+        }
+        m_hkl.clear();
+        m_ksq.clear();
+      }
+
+      //Instead of adding candidates, invoke fct(hkl,ksq,fsquared) in order for
+      //all entries in a previously recorded table which pass the fsquarecut:
+      template<class TFct>
+      void replay( const PlaneTable& table, TFct&& fct )
+      {
+        nc_assert_always( table.nsums == 2 * m_pc.csl.size() );
+        nc_assert_always( table.ksq.size() == table.hkl.size() );
+        nc_assert_always( table.sums.size() == table.hkl.size() * table.nsums );
+        const double * sums = table.sums.data();
+        for ( auto i : ncrange( table.hkl.size() ) ) {
+          const double fsq = calcFSquaredFromSums( m_scratch[0], table.ksq[i], sums );
+          sums += table.nsums;
+          if ( fsq >= m_fsquarecut )
+            fct( table.hkl[i], table.ksq[i], fsq );
+        }
+      }
+
+    private:
+      static constexpr std::size_t s_batchSize = 16384;
+      struct Scratch {
+        SmallVectD whkl;
+        SmallVectD cache_factors;
+      };
+      const PreCalc& m_pc;
+      const unsigned m_nthreads;
+      const bool m_no_forceunitdebyewallerfactor;
+      const double m_fsquarecut;
+      PlaneTable * m_record;
+      std::vector<HKL> m_hkl;
+      VectD m_ksq;
+      VectD m_fsq;
+      VectD m_sums;
+      VectD m_recordSums;
+      std::unique_ptr<Scratch[]> m_scratch;
+
+      //Fill scratch.cache_factors with the scattering length and Debye-Waller
+      //factors of each atom type (zero when negligible), and return the
+      //resulting cheap upper limit on sqrt(fsquared/2):
+      double calcFactors( Scratch& scratch, double ksq ) const
+      {
+        const PreCalc& cache = m_pc;
+        if (m_no_forceunitdebyewallerfactor) {
+          nclikely fillHKL_getWhkl(scratch.whkl, ksq, cache.msd);
+        }
+
+        //calculate |F|^2
+        double real_or_imag_upper_limit(0.0);
+        for( unsigned i=0; i < scratch.whkl.size(); ++i ) {
+          if ( scratch.whkl[i] > cache.whkl_thresholds[i]) {
+            scratch.cache_factors[i] = 0.0;
+            continue;//Abort early to save exp/cos/sin calls. Note that
+                     //O(fsquarecut) here corresponds to O(fsquarecut^2)
+                     //contributions to final FSquared - for which we demand
+                     //>fsquarecut below. We only do this when fsquarecut<1e-2
+                     //(see calculations for whkl_thresholds above).
+          } else {
+            double factor = cache.csl[i]*std::exp(-scratch.whkl[i]);
+            scratch.cache_factors[i] = factor;
+            //Assuming cos(phase)*factor=sin(phase)*factor=|factor| gives us a cheap upper limit on
+            //fsquared:
+            real_or_imag_upper_limit += cache.atomic_pos[i].size()*ncabs( factor );
+          }
+        }
+        return real_or_imag_upper_limit;
+      }
+
+      //Sum up cos and sin of the phases for each atom type:
+      void calcSums( const HKL& hklpt, double * out_sums ) const
+      {
+        const Vector hkl(hklpt.h,hklpt.k,hklpt.l);
+        for ( auto& positions : m_pc.atomic_pos ) {
+          StableSum cpsum, spsum;
+          for ( auto& pos : positions ) {
+            double sp,cp;
+            std::tie(sp,cp) = sincos_2pix(hkl.dot(pos));
+            cpsum.add(cp);
+            spsum.add(sp);
+          }
+          *out_sums++ = cpsum.sum();
+          *out_sums++ = spsum.sum();
+        }
+      }
+
+      //Same results as calcFSquared, but based on sums from calcSums:
+      double calcFSquaredFromSums( Scratch& scratch, double ksq, const double * sums ) const
+      {
+        const double real_or_imag_upper_limit = calcFactors( scratch, ksq );
+        if(real_or_imag_upper_limit*real_or_imag_upper_limit*2.0<m_fsquarecut)
+          return -kInfinity;
+        StableSum real, imag;
+        for( unsigned i=0 ; i < scratch.whkl.size(); ++i ) {
+          double factor = scratch.cache_factors[i];
+          if ( factor ) {
+            real.add(sums[2*i] * factor);
+            imag.add(sums[2*i+1] * factor);
+          }
+        }
+        return ncsquare( real.sum() ) + ncsquare( imag.sum() );
+      }
+
+      //Returns fsquared, or -kInfinity if a cheap upper limit is already below
+      //fsquarecut:
+      double calcFSquared( Scratch& scratch, const HKL& hklpt, double ksq ) const
+      {
+        const double real_or_imag_upper_limit = calcFactors( scratch, ksq );
+
+        //If the upper limit on fsq is below fsquarecut, we can skip already and
+        //avoid needless calculations further down:
+        if(real_or_imag_upper_limit*real_or_imag_upper_limit*2.0<m_fsquarecut)
+          return -kInfinity;
+
+        //Time to calculate phases and sum up contributions. Use numerically
+        //stable summation, for better results on low-symmetry crystals (the
+        //main cost here is anyway the phase calculations, not the summation):
+        const Vector hkl(hklpt.h,hklpt.k,hklpt.l);
+        StableSum real, imag;
+        for( unsigned i=0 ; i < scratch.whkl.size(); ++i ) {
+          double factor = scratch.cache_factors[i];
+          if (!factor)
+            continue;
+          StableSum cpsum, spsum;
+          for ( auto& pos : m_pc.atomic_pos[i] ) {
+            //Phase is hkl.dot(pos)*2pi. We speed up the expensive
+            //calculation of sin+cos by a factor of 3 by shifting the phase to
+            //[0,2pi] (easily done by simply NOT multiplying with 2pi) and using
+            //our own fast sincos_02pi through sincos_2pix. Since typically 99%
+            //of the hkl initialisation time is spent calculating sin+cos here,
+            //that actually translates into an overall speedup of a factor of 3
+            //(measured in NCrystal v2.7.0)!
+            const double phase_div2pi = hkl.dot(pos);
+            double sp,cp;
+            std::tie(sp,cp) = sincos_2pix(phase_div2pi);
+            cpsum.add(cp);
+            spsum.add(sp);
+          }
+          real.add(cpsum.sum() * factor);
+          imag.add(spsum.sum() * factor);
+        }
+
+        return ncsquare( real.sum() ) + ncsquare( imag.sum() );
+      }
+    };
+  }
+}
+
+namespace NCrystal {
+  namespace {
+
+    //Opt-in persistent on-disk cache of calculated HKL lists, enabled by
+    //setting the NCRYSTAL_HKL_CACHEDIR environment variable to the path of an
+    //existing writable directory (or NCRYSTAL_NODE_SHARED_CACHE=1 for a
+    //directory in node-local shared memory). Entries are keyed by a byte string
+    //describing all inputs of the calculation (note that the temperature enters
+    //via the mean-squared-displacements), which is stored in full in the files
+    //and verified upon loading. Files are written atomically via a temporary
+    //file and a rename, and any problems with reading or writing files simply
+    //results in the cache not being used. The format is a header of 8-byte
+    //fields, followed by the key and the entries in native byte order.
+
+    namespace HKLDiskCache {
+
+      constexpr char magic[8] = { 'N','C','H','K','L','C','\0','\0' };
+      constexpr uint64_t formatVersion = 1;
+      constexpr uint64_t byteOrderMarker = 0x0102030405060708ull;
+
+      struct FileHeader {
+        char magic[8];
+        uint64_t formatVersion;
+        uint64_t ncrystalVersion;
+        uint64_t byteOrderMarker;
+        uint64_t keySize;
+        uint64_t nentries;
+      };
+      static_assert( sizeof(FileHeader) == 6*8, "" );
+
+      struct EntryHeader {
+        int32_t h, k, l;
+        uint32_t multiplicity;
+        double dspacing;
+        double fsquared;
+        uint64_t nexplicit;//number of explicit HKL values (~0 if none)
+      };
+      static_assert( sizeof(EntryHeader) == 5*8, "" );
+
+      DiskCacheDirSetting& cacheDirSetting()
+      {
+        static DiskCacheDirSetting s_setting("HKL_CACHEDIR");
+        return s_setting;
+      }
+
+      std::string cacheDir() { return cacheDirSetting().get(); }
+
+      bool isEnabled() { return !cacheDir().empty(); }
+
+      using KeyMaterial = DiskCacheKeyMaterial;
+
+      std::string cacheFileName( const KeyMaterial& km )
+      {
+        return diskCacheFileName( cacheDir(), "nchkllist_", km );
+      }
+
+      Optional<HKLList> load( const KeyMaterial& km )
+      {
+        Optional<std::string> content;
+        try {
+          content = readEntireFileToString( cacheFileName( km ) );
+        } catch ( Error::Exception& ) {
+          return NullOpt;
+        }
+        if ( !content.has_value() )
+          return NullOpt;
+        const std::string& data = content.value();
+        std::size_t offset = 0;
+        auto read = [&data,&offset]( void * dest, std::size_t n )
+        {
+          if ( n > data.size() - offset )
+            return false;
+          std::memcpy( dest, data.data() + offset, n );
+          offset += n;
+          return true;
+        };
+
+        FileHeader hdr;
+        if ( !read( &hdr, sizeof(hdr) )
+             || std::memcmp( hdr.magic, magic, sizeof(magic) ) != 0
+             || hdr.formatVersion != formatVersion
+             || hdr.ncrystalVersion != static_cast<uint64_t>(NCRYSTAL_VERSION)
+             || hdr.byteOrderMarker != byteOrderMarker
+             || hdr.keySize != km.str().size()
+             || km.str().size() > data.size() - offset
+             || std::memcmp( data.data() + offset, km.str().data(), km.str().size() ) != 0
+             || hdr.nentries > data.size() )
+          return NullOpt;
+        offset += km.str().size();
+
+        HKLList res;
+        res.reserve( hdr.nentries );
+        for ( uint64_t ientry = 0; ientry < hdr.nentries; ++ientry ) {
+          EntryHeader eh;
+          if ( !read( &eh, sizeof(eh) ) )
+            return NullOpt;
+          HKLInfo hi;
+          hi.hkl = HKL{ eh.h, eh.k, eh.l };
+          hi.multiplicity = eh.multiplicity;
+          hi.dspacing = eh.dspacing;
+          hi.fsquared = eh.fsquared;
+          if ( eh.nexplicit != ~uint64_t(0) ) {
+            if ( eh.nexplicit > data.size() )
+              return NullOpt;
+            std::vector<HKL> v;
+            v.reserve( eh.nexplicit );
+            for ( uint64_t i = 0; i < eh.nexplicit; ++i ) {
+              int32_t vals[3];
+              if ( !read( vals, sizeof(vals) ) )
+                return NullOpt;
+              v.emplace_back( vals[0], vals[1], vals[2] );
+            }
+            hi.explicitValues = std::make_unique<HKLInfo::ExplicitVals>();
+            hi.explicitValues->list = std::move(v);
+          }
+          res.emplace_back( std::move(hi) );
+        }
+        if ( offset != data.size() )
+          return NullOpt;
+        return res;
+      }
+
+      void store( const KeyMaterial& km, const HKLList& hkllist )
+      {
+        std::string data;
+        auto write = [&data]( const void * src, std::size_t n )
+        {
+          data.append( static_cast<const char*>(src), n );
+        };
+        FileHeader hdr;
+        std::memcpy( hdr.magic, magic, sizeof(magic) );
+        hdr.formatVersion = formatVersion;
+        hdr.ncrystalVersion = static_cast<uint64_t>(NCRYSTAL_VERSION);
+        hdr.byteOrderMarker = byteOrderMarker;
+        hdr.keySize = km.str().size();
+        hdr.nentries = hkllist.size();
+        write( &hdr, sizeof(hdr) );
+        write( km.str().data(), km.str().size() );
+        for ( auto& hi : hkllist ) {
+          const std::vector<HKL> * v = nullptr;
+          if ( hi.explicitValues != nullptr ) {
+            //We only ever produce lists of explicit HKL values:
+            nc_assert_always( hi.explicitValues->list.has_value<std::vector<HKL>>() );
+            v = &hi.explicitValues->list.get<std::vector<HKL>>();
+          }
+          EntryHeader eh;
+          eh.h = hi.hkl.h;
+          eh.k = hi.hkl.k;
+          eh.l = hi.hkl.l;
+          eh.multiplicity = hi.multiplicity;
+          eh.dspacing = hi.dspacing;
+          eh.fsquared = hi.fsquared;
+          eh.nexplicit = ( v ? v->size() : ~uint64_t(0) );
+          write( &eh, sizeof(eh) );
+          if ( v ) {
+            for ( auto& e : *v ) {
+              const int32_t vals[3] = { e.h, e.k, e.l };
+              write( vals, sizeof(vals) );
+            }
+          }
+        }
+
+        writeFileAtomically( cacheFileName( km ),
+                             [&data]( std::ostream& os ) { os.write( data.data(), data.size() ); } );
+      }
+    }
+
+    //In-memory cache of recently produced plane tables, keyed by a byte string
+    //describing all inputs of the calculation except the
+    //mean-squared-displacements. This makes it cheap to produce HKL lists for
+    //the same material at different temperatures (e.g. in temperature scans),
+    //since only the Debye-Waller factors must then be reevaluated. Setting the
+    //NCRYSTAL_FILLHKL_NOPLANECACHE environment variable disables this cache.
+
+    namespace PlaneTableCache {
+
+      using detail::PlaneTable;
+      constexpr std::size_t maxEntries = 4;
+      constexpr std::size_t maxTableSums = 4194304;//32MB of doubles per table
+
+      struct Entry {
+        std::string key;
+        std::shared_ptr<const PlaneTable> table;
+      };
+
+      struct Cache {
+        std::mutex mtx;
+        std::vector<Entry> entries;//most recently used last
+        Cache()
+        {
+          registerCacheCleanupFunction( [this]()
+          {
+            NCRYSTAL_LOCK_GUARD(this->mtx);
+            this->entries.clear();
+          } );
+        }
+      };
+
+      Cache& getCache()
+      {
+        static Cache s_cache;
+        return s_cache;
+      }
+
+      bool isEnabled()
+      {
+        static const bool s_enabled = !std::getenv("NCRYSTAL_FILLHKL_NOPLANECACHE");
+        return s_enabled;
+      }
+
+      std::shared_ptr<const PlaneTable> get( const std::string& key )
+      {
+        auto& c = getCache();
+        NCRYSTAL_LOCK_GUARD(c.mtx);
+        for ( auto it = c.entries.begin(); it != c.entries.end(); ++it ) {
+          if ( it->key == key ) {
+            std::rotate( it, std::next(it), c.entries.end() );
+            return c.entries.back().table;
+          }
+        }
+        return nullptr;
+      }
+
+      void add( std::string key, std::unique_ptr<PlaneTable> table )
+      {
+        if ( table->sums.size() > maxTableSums )
+          return;
+        table->hkl.shrink_to_fit();
+        table->ksq.shrink_to_fit();
+        table->sums.shrink_to_fit();
+        auto& c = getCache();
+        NCRYSTAL_LOCK_GUARD(c.mtx);
+        for ( auto& e : c.entries )
+          if ( e.key == key )
+            return;//added concurrently by another thread
+        if ( c.entries.size() >= maxEntries )
+          c.entries.erase( c.entries.begin() );
+        c.entries.push_back( Entry{ std::move(key), std::move(table) } );
+      }
+    }
   }
 }
 
@@ -230,6 +686,7 @@ NC::HKLList NC::calculateHKLPlanes( const StructureInfo& structureInfo,
                                     const AtomInfoList& atomList,
                                     FillHKLCfg cfg )
 {
+  InitProfileScope profileScope( "calculateHKLPlanes" );
   if ( atomList.empty() )
     NCRYSTAL_THROW(BadInput,"calculateHKLPlanes needs a non-empty AtomInfoList");
   for ( auto& ai : atomList ) {
@@ -257,11 +714,84 @@ NC::HKLList NC::calculateHKLPlanes( const StructureInfo& structureInfo,
     no_forceunitdebyewallerfactor = !(std::getenv("NCRYSTAL_FILLHKL_FORCEUNITDEBYEWALLERFACTOR"));
   }
 
-  if ( structureInfo.spacegroup != 0 )
-    return detail::calculateHKLPlanesWithSymEqRefl( structureInfo,
-                                                    atomList,
-                                                    std::move(cfg),
-                                                    no_forceunitdebyewallerfactor );
+  //Key material describing all inputs used in the calculations, optionally
+  //leaving out the mean-squared-displacements:
+  auto createKey = [&]( bool include_msd )
+  {
+    HKLDiskCache::KeyMaterial km;
+    km.add( static_cast<uint64_t>( structureInfo.spacegroup ) )
+      .add( structureInfo.lattice_a ).add( structureInfo.lattice_b ).add( structureInfo.lattice_c )
+      .add( structureInfo.alpha ).add( structureInfo.beta ).add( structureInfo.gamma )
+      .add( cfg.dcutoff ).add( cfg.dcutoffup ).add( cfg.fsquarecut ).add( cfg.merge_tolerance )
+      .add( static_cast<uint64_t>( no_forceunitdebyewallerfactor ) )
+      .add( static_cast<uint64_t>( env_ignorefsqcut ) )
+      .add( static_cast<uint64_t>( atomList.size() ) );
+    for ( auto& ai : atomList ) {
+      if ( include_msd )
+        km.add( ai.msd().value() );
+      km.add( ai.atomData().coherentScatLen() )
+        .add( static_cast<uint64_t>( ai.unitCellPositions().size() ) );
+      for ( const auto& pos : ai.unitCellPositions() )
+        km.add( pos[0] ).add( pos[1] ).add( pos[2] );
+    }
+    return km;
+  };
+
+  //We do not bother caching results for hkl selections requested via env var:
+  const bool allow_caching = !std::getenv("NCRYSTAL_FILLHKL_SELECTHKL");
+
+  //Check the (opt-in) persistent disk cache:
+  Optional<HKLDiskCache::KeyMaterial> diskCacheKey;
+  if ( allow_caching && HKLDiskCache::isEnabled() ) {
+    diskCacheKey = createKey( true );
+    auto cached = HKLDiskCache::load( diskCacheKey.value() );
+    if ( cached.has_value() )
+      return std::move( cached.value() );
+  }
+
+  //Check for a plane table from the same material at another temperature,
+  //otherwise record one:
+  std::string planeTableKey;
+  std::shared_ptr<const detail::PlaneTable> reuseTable;
+  std::unique_ptr<detail::PlaneTable> recordTable;
+  if ( allow_caching && PlaneTableCache::isEnabled() ) {
+    planeTableKey = createKey( false ).str();
+    reuseTable = PlaneTableCache::get( planeTableKey );
+    if ( !reuseTable )
+      recordTable = std::make_unique<detail::PlaneTable>();
+  }
+
+  HKLList hkllist = ( structureInfo.spacegroup != 0
+                      ? detail::calculateHKLPlanesWithSymEqRefl( structureInfo,
+                                                                 atomList,
+                                                                 std::move(cfg),
+                                                                 no_forceunitdebyewallerfactor,
+                                                                 reuseTable.get(),
+                                                                 recordTable.get() )
+                      : detail::calculateHKLPlanesNoSymEqRefl( structureInfo,
+                                                               atomList,
+                                                               std::move(cfg),
+                                                               no_forceunitdebyewallerfactor,
+                                                               reuseTable.get(),
+                                                               recordTable.get() ) );
+  if ( recordTable != nullptr )
+    PlaneTableCache::add( std::move(planeTableKey), std::move(recordTable) );
+  if ( diskCacheKey.has_value() )
+    HKLDiskCache::store( diskCacheKey.value(), hkllist );
+  return hkllist;
+}
+
+NC::HKLList NC::detail::calculateHKLPlanesNoSymEqRefl( const StructureInfo& structureInfo,
+                                                       const AtomInfoList& atomList,
+                                                       FillHKLCfg cfg,
+                                                       bool no_forceunitdebyewallerfactor,
+                                                       const PlaneTable* reuse,
+                                                       PlaneTable* record )
+{
+  nc_assert_always(structureInfo.spacegroup==0);
+
+  const bool env_ignorefsqcut = std::getenv("NCRYSTAL_FILLHKL_IGNOREFSQCUT");
+  nc_assert( !env_ignorefsqcut || cfg.fsquarecut == 0.0 );//due to logic in calling function
 
   //For now we allow selection of a particular hkl value via an env var (a hacky
   //workarond required for certain validation plots - we should support this in
@@ -290,141 +820,87 @@ NC::HKLList NC::calculateHKLPlanes( const StructureInfo& structureInfo,
   //is an integer composed from Fsquared and d-spacing, and although clashes are
   //allowed, it should only clash rarely or efficiency is compromised):
 
-#ifdef NCRYSTAL_NCMAT_USE_MEMPOOL
-  MemPool pool(10000000);
-  MemPoolAllocator<void> poolalloc(&pool);
-  FamMap fsq2hklidx(poolalloc);
-#else
-  FamMap fsq2hklidx;
-#endif
+  MemPool pool(1048576);
+  FamMap fsq2hklidx{ MemPoolAllocator<void>(&pool) };
 
   HKLList hkllist;
 
-  for( int loop_h=0;loop_h<=cache.max_h;++loop_h ) {
-    for( int loop_k=(loop_h?-cache.max_k:0);loop_k<=cache.max_k;++loop_k ) {
-      for( int loop_l=-cache.max_l;loop_l<=cache.max_l;++loop_l ) {
-        const Vector hkl(loop_h,loop_k,loop_l);
-
-        //calculate waveVector, wave number and dspacing:
-        Vector waveVector = rec_lat*hkl;
-        const double ksq = waveVector.mag2();
-        if ( !valueInInterval(cache.ksq_preselect_interval,ksq))
-          continue;
-
-        if (no_forceunitdebyewallerfactor) {
-          nclikely fillHKL_getWhkl(cache.whkl, ksq, cache.msd);
-        }
-
-        //calculate |F|^2
-        double real_or_imag_upper_limit(0.0);
-        for( unsigned i=0; i < cache.whkl.size(); ++i ) {
-          if ( cache.whkl[i] > cache.whkl_thresholds[i]) {
-            cache.cache_factors[i] = 0.0;
-            continue;//Abort early to save exp/cos/sin calls. Note that
-                     //O(fsquarecut) here corresponds to O(fsquarecut^2)
-                     //contributions to final FSquared - for which we demand
-                     //>fsquarecut below. We only do this when fsquarecut<1e-2
-                     //(see calculations for whkl_thresholds above).
-          } else {
-            double factor = cache.csl[i]*std::exp(-cache.whkl[i]);
-            cache.cache_factors[i] = factor;
-            //Assuming cos(phase)*factor=sin(phase)*factor=|factor| gives us a cheap upper limit on
-            //fsquared:
-            real_or_imag_upper_limit += cache.atomic_pos[i].size()*ncabs( factor );
-          }
+  //Merge d-spacing and fsquared compatible points into families. This is done
+  //serially and in the same order as the loops below, making the resulting
+  //families independent of the batching:
+  auto addToFamilies = [&]( const HKL& hklpt, double ksq, double FSquared )
+  {
+    //Calculate d-spacing and recheck cut:
+    const double kval = std::sqrt( ksq );
+    const double invkval = 1.0 / kval;
+    const double dspacing = k2Pi * invkval;
+
+    if ( !valueInInterval( cache.dcut_interval, dspacing ) )
+      return;
+
+    //Key for our fsq2hklidx multimap:
+    FamKeyType searchkey(keygen(FSquared,dspacing));
+
+    FamMap::iterator itSearchLB = fsq2hklidx.lower_bound(searchkey);
+    FamMap::iterator itSearch(itSearchLB), itSearchE(fsq2hklidx.end());
+    for ( ; itSearch!=itSearchE && itSearch->first == searchkey; ++itSearch ) {
+      nc_assert(itSearch->second<hkllist.size());
+      HKLInfo& hi = hkllist[itSearch->second];
+      if ( ncabs(FSquared-hi.fsquared) < cfg.merge_tolerance*(FSquared+hi.fsquared )
+           && ncabs(dspacing-hi.dspacing) < cfg.merge_tolerance*(dspacing+hi.dspacing ) )
+        {
+          //Compatible with existing family, simply add HKL point to it.
+          hi.multiplicity += 2;
+          nc_assert(hi.explicitValues->list.has_value<std::vector<HKL>>());
+          hi.explicitValues->list.get<std::vector<HKL>>().push_back(hklpt);
+          return;
         }
+    }
 
-        //If the upper limit on fsq is below fsquarecut, we can skip already and
-        //avoid needless calculations further down:
-        if(real_or_imag_upper_limit*real_or_imag_upper_limit*2.0<cfg.fsquarecut)
-          continue;
+    //Not fitting in existing group, set up new.
+    if ( hkllist.size()>1000000 && !env_ignorefsqcut )//guard against crazy setups
+      NCRYSTAL_THROW2(CalcError,"Combinatorics too great to reach requested dcutoff = "<<cfg.dcutoff<<" Aa");
+    HKLInfo hi;
+    hi.hkl = hklpt;
+    hi.multiplicity = 2;
+    hi.fsquared = FSquared;
+    hi.dspacing = dspacing;
+    hi.explicitValues = std::make_unique<HKLInfo::ExplicitVals>();
+    hi.explicitValues->list.emplace<std::vector<HKL>>();
+    hi.explicitValues->list.get<std::vector<HKL>>().reserve(24);//shrinked below
+    hi.explicitValues->list.get<std::vector<HKL>>().push_back(hklpt);
+    fsq2hklidx.insert(itSearchLB,FamMap::value_type(searchkey,hkllist.size()));
+    hkllist.emplace_back(std::move(hi));
+  };
 
-        if ( loop_h==0 && loop_k==0 && loop_l<=0)
-          continue;
+  detail::FSquaredBatch batch( cache, no_forceunitdebyewallerfactor, cfg.fsquarecut, record );
 
-        if ( do_select && (loop_h!=select_h||loop_k!=select_k||loop_l!=select_l) )
+  if ( reuse ) {
+    nc_assert( !do_select );
+    batch.replay( *reuse, addToFamilies );
+  } else {
+    for( int loop_h=0;loop_h<=cache.max_h;++loop_h ) {
+      for( int loop_k=(loop_h?-cache.max_k:0);loop_k<=cache.max_k;++loop_k ) {
+        for( int loop_l=-cache.max_l;loop_l<=cache.max_l;++loop_l ) {
+          if ( loop_h==0 && loop_k==0 && loop_l<=0)
             continue;
 
-        //Time to calculate phases and sum up contributions. Use numerically
-        //stable summation, for better results on low-symmetry crystals (the
-        //main cost here is anyway the phase calculations, not the summation):
-        StableSum real, imag;
-        for( unsigned i=0 ; i < cache.whkl.size(); ++i ) {
-          double factor = cache.cache_factors[i];
-          if (!factor)
+          if ( do_select && (loop_h!=select_h||loop_k!=select_k||loop_l!=select_l) )
+              continue;
+
+          //calculate waveVector, wave number and dspacing:
+          const Vector hkl(loop_h,loop_k,loop_l);
+          Vector waveVector = rec_lat*hkl;
+          const double ksq = waveVector.mag2();
+          if ( !valueInInterval(cache.ksq_preselect_interval,ksq))
             continue;
-          StableSum cpsum, spsum;
-          for ( auto& pos : cache.atomic_pos[i] ) {
-            //Phase is hkl.dot(pos)*2pi. We speed up the expensive
-            //calculation of sin+cos by a factor of 3 by shifting the phase to
-            //[0,2pi] (easily done by simply NOT multiplying with 2pi) and using
-            //our own fast sincos_02pi through sincos_2pix. Since typically 99%
-            //of the hkl initialisation time is spent calculating sin+cos here,
-            //that actually translates into an overall speedup of a factor of 3
-            //(measured in NCrystal v2.7.0)!
-            const double phase_div2pi = hkl.dot(pos);
-            double sp,cp;
-            std::tie(sp,cp) = sincos_2pix(phase_div2pi);
-            cpsum.add(cp);
-            spsum.add(sp);
-          }
-          real.add(cpsum.sum() * factor);
-          imag.add(spsum.sum() * factor);
-        }
 
-        const double FSquared = ncsquare( real.sum() ) + ncsquare( imag.sum() );
-
-        //skip weak or impossible reflections:
-        if(FSquared<cfg.fsquarecut)
-          continue;
-
-        //Calculate d-spacing and recheck cut:
-        const double kval = std::sqrt( ksq );
-        const double invkval = 1.0 / kval;
-        const double dspacing = k2Pi * invkval;
-
-        if ( !valueInInterval( cache.dcut_interval, dspacing ) )
-          continue;
-
-        //Key for our fsq2hklidx multimap:
-        FamKeyType searchkey(keygen(FSquared,dspacing));
-
-        FamMap::iterator itSearchLB = fsq2hklidx.lower_bound(searchkey);
-        FamMap::iterator itSearch(itSearchLB), itSearchE(fsq2hklidx.end());
-        bool isnewfamily = true;
-        for ( ; itSearch!=itSearchE && itSearch->first == searchkey; ++itSearch ) {
-          nc_assert(itSearch->second<hkllist.size());
-          HKLInfo& hi = hkllist[itSearch->second];
-          if ( ncabs(FSquared-hi.fsquared) < cfg.merge_tolerance*(FSquared+hi.fsquared )
-               && ncabs(dspacing-hi.dspacing) < cfg.merge_tolerance*(dspacing+hi.dspacing ) )
-            {
-              //Compatible with existing family, simply add HKL point to it.
-              hi.multiplicity += 2;
-              nc_assert(hi.explicitValues->list.has_value<std::vector<HKL>>());
-              hi.explicitValues->list.get<std::vector<HKL>>().emplace_back(loop_h,loop_k,loop_l);
-              isnewfamily = false;
-              break;
-            }
-        }
-        if (isnewfamily) {
-          //Not fitting in existing group, set up new.
-          if ( hkllist.size()>1000000 && !env_ignorefsqcut )//guard against crazy setups
-            NCRYSTAL_THROW2(CalcError,"Combinatorics too great to reach requested dcutoff = "<<cfg.dcutoff<<" Aa");
-          HKLInfo hi;
-          hi.hkl = HKL{ loop_h, loop_k, loop_l };
-          hi.multiplicity = 2;
-          hi.fsquared = FSquared;
-          hi.dspacing = dspacing;
-          hi.explicitValues = std::make_unique<HKLInfo::ExplicitVals>();
-          hi.explicitValues->list.emplace<std::vector<HKL>>();
-          hi.explicitValues->list.get<std::vector<HKL>>().reserve(24);//shrinked below
-          hi.explicitValues->list.get<std::vector<HKL>>().emplace_back(loop_h,loop_k,loop_l);
-          fsq2hklidx.insert(itSearchLB,FamMap::value_type(searchkey,hkllist.size()));
-          hkllist.emplace_back(std::move(hi));
-        }
-      }//loop_l
-    }//loop_k
-  }//loop_h
+          batch.add( HKL{ loop_h, loop_k, loop_l }, ksq, addToFamilies );
+        }//loop_l
+      }//loop_k
+    }//loop_h
+    batch.flush( addToFamilies );
+  }
 
   //Sort explicit HKL entries and use first as representative index:
   for ( auto& hi : hkllist ) {
@@ -533,7 +1009,9 @@ namespace NCrystal {
 NC::HKLList NC::detail::calculateHKLPlanesWithSymEqRefl( const StructureInfo& structureInfo,
                                                          const AtomInfoList& atomList,
                                                          FillHKLCfg cfg,
-                                                         bool no_forceunitdebyewallerfactor )
+                                                         bool no_forceunitdebyewallerfactor,
+                                                         const PlaneTable* reuse,
+                                                         PlaneTable* record )
 {
   nc_assert_always(structureInfo.spacegroup!=0);
 
@@ -578,109 +1056,63 @@ NC::HKLList NC::detail::calculateHKLPlanesWithSymEqRefl( const StructureInfo& st
   NC::HKLList hkllist;
   hkllist.reserve( 4096 );
 
-  //We now conduct a brute-force loop over h,k,l indices, adding calculated info
-  //in the following containers along the way. For reasons of symmetry we ignore
-  //roughly half (but not all since the sym_key's might have sign flips).
-
-  for( int loop_h = 0 ; loop_h <= cache.max_h; ++loop_h ) {
-    for( int loop_k = (loop_h?-cache.max_k:0); loop_k <= cache.max_k; ++loop_k ) {
-      for( int loop_l = -cache.max_l; loop_l <= cache.max_l; ++loop_l ) {
-
-        auto sym_key = sym_findrepval( loop_h, loop_k, loop_l );
-        if (!symSeenTracker.isFirstCheck(sym_key))
-          continue;//Already seen this sym_key once.
-
-        //calculate waveVector at the cost of a matrix multiplication, and
-        //preselect on its squared magnitude:
-        const Vector hkl(sym_key.h,sym_key.k,sym_key.l);
-        Vector waveVector = rec_lat*hkl;
-        const double ksq = waveVector.mag2();
-        if ( ! valueInInterval( cache.ksq_preselect_interval , ksq ) )
-          continue;
-
-        if (no_forceunitdebyewallerfactor) {
-          nclikely fillHKL_getWhkl( cache.whkl, ksq, cache.msd);
-        }
-
-        //calculate |F|^2
-        double real_or_imag_upper_limit(0.0);
-        for( unsigned i=0; i < cache.whkl.size(); ++i ) {
-          if ( cache.whkl[i] > cache.whkl_thresholds[i]) {
-            cache.cache_factors[i] = 0.0;
-            continue;//Abort early to save exp/cos/sin calls. Note that
-                     //O(fsquarecut) here corresponds to O(fsquarecut^2)
-                     //contributions to final FSquared - for which we demand
-                     //>fsquarecut below. We only do this when fsquarecut<1e-2
-                     //(see calculations for whkl_thresholds above).
-          } else {
-            double factor = cache.csl[i]*std::exp(-cache.whkl[i]);
-            cache.cache_factors[i] = factor;
-            //Assuming cos(phase)*factor=sin(phase)*factor=|factor| gives us a cheap upper limit on
-            //fsquared:
-            real_or_imag_upper_limit += cache.atomic_pos[i].size()*ncabs( factor );
-          }
-        }
-
-        //If the upper limit on fsq is below fsquarecut, we can skip already and
-        //avoid needless calculations further down:
-        if(real_or_imag_upper_limit*real_or_imag_upper_limit*2.0<cfg.fsquarecut)
-          continue;
-
-        //Time to calculate phases and sum up contributions. Use numerically
-        //stable summation, for better results on low-symmetry crystals (the
-        //main cost here is anyway the phase calculations, not the summation):
-        StableSum real, imag;
-        for( unsigned i=0 ; i < cache.whkl.size(); ++i ) {
-          double factor = cache.cache_factors[i];
-          if (!factor)
-            continue;
-          StableSum cpsum, spsum;
-          for ( auto& pos : cache.atomic_pos[i] ) {
-            //Phase is hkl.dot(pos)*2pi. We speed up the expensive
-            //calculation of sin+cos by a factor of 3 by shifting the phase to
-            //[0,2pi] (easily done by simply NOT multiplying with 2pi) and using
-            //our own fast sincos_02pi through sincos_2pix. Since typically 99%
-            //of the hkl initialisation time is spent calculating sin+cos here,
-            //that actually translates into an overall speedup of a factor of 3
-            //(measured in NCrystal v2.7.0)!
-            const double phase_div2pi = hkl.dot(pos);
-            double sp,cp;
-            std::tie(sp,cp) = sincos_2pix(phase_div2pi);
-            cpsum.add(cp);
-            spsum.add(sp);
-          }
-          real.add(cpsum.sum() * factor);
-          imag.add(spsum.sum() * factor);
-        }
-
-        const double FSquared = ncsquare( real.sum() ) + ncsquare( imag.sum() );
-
-        //skip weak or impossible reflections:
-        if(FSquared<cfg.fsquarecut)
-          continue;
-
-        //Calculate d-spacing and recheck cut:
-        const double dspacing = k2Pi / std::sqrt( ksq );
+  auto addEntry = [&]( const HKL& sym_key, double ksq, double FSquared )
+  {
+    //Calculate d-spacing and recheck cut:
+    const double dspacing = k2Pi / std::sqrt( ksq );
+
+    if ( !valueInInterval( cache.dcut_interval, dspacing ) )
+      return;
+
+    if ( hkllist.size()> 1000000 && !env_ignorefsqcut )//guard against crazy setups
+      NCRYSTAL_THROW2(CalcError,"Combinatorics too great to reach requested dcutoff = "<<cfg.dcutoff<<" Aa");
+
+    hkllist.emplace_back();
+    auto& entry = hkllist.back();
+    entry.dspacing = dspacing;
+    entry.fsquared = FSquared;
+    auto sym_list = sym.getEquivalentReflections( sym_key );
+    entry.hkl = sym_list.front();
+    entry.multiplicity = sym_list.size() * 2;
+  };
 
-        if ( !valueInInterval( cache.dcut_interval, dspacing ) )
-          continue;
+  detail::FSquaredBatch batch( cache, no_forceunitdebyewallerfactor, cfg.fsquarecut, record );
 
-        if ( do_select.has_value() && !(sym_key == do_select.value()) )
+  if ( reuse ) {
+    //Plane enumeration already done at another temperature:
+    nc_assert( !do_select.has_value() );
+    batch.replay( *reuse, addEntry );
+  } else {
+    //We now conduct a brute-force loop over h,k,l indices, adding calculated
+    //info in the following containers along the way. For reasons of symmetry
+    //we ignore roughly half (but not all since the sym_key's might have sign
+    //flips).
+
+    for( int loop_h = 0 ; loop_h <= cache.max_h; ++loop_h ) {
+      for( int loop_k = (loop_h?-cache.max_k:0); loop_k <= cache.max_k; ++loop_k ) {
+        for( int loop_l = -cache.max_l; loop_l <= cache.max_l; ++loop_l ) {
+
+          auto sym_key = sym_findrepval( loop_h, loop_k, loop_l );
+          if (!symSeenTracker.isFirstCheck(sym_key))
+            continue;//Already seen this sym_key once.
+
+          if ( do_select.has_value() && !(sym_key == do_select.value()) )
+              continue;
+
+          //calculate waveVector at the cost of a matrix multiplication, and
+          //preselect on its squared magnitude:
+          const Vector hkl(sym_key.h,sym_key.k,sym_key.l);
+          Vector waveVector = rec_lat*hkl;
+          const double ksq = waveVector.mag2();
+          if ( ! valueInInterval( cache.ksq_preselect_interval , ksq ) )
             continue;
 
-        if ( hkllist.size()> 1000000 && !env_ignorefsqcut )//guard against crazy setups
-          NCRYSTAL_THROW2(CalcError,"Combinatorics too great to reach requested dcutoff = "<<cfg.dcutoff<<" Aa");
-
-        hkllist.emplace_back();
-        auto& entry = hkllist.back();
-        entry.dspacing = dspacing;
-        entry.fsquared = FSquared;
-        auto sym_list = sym.getEquivalentReflections( sym_key );
-        entry.hkl = sym_list.front();
-        entry.multiplicity = sym_list.size() * 2;
-      }//loop_l
-    }//loop_k
-  }//loop_h
+          batch.add( sym_key, ksq, addEntry );
+        }//loop_l
+      }//loop_k
+    }//loop_h
+    batch.flush( addEntry );
+  }
 
   //NB: Not sorting by dspace (InfoBuilder will anyway do it and it is slightly
   //complicated to do consistently).
@@ -688,3 +1120,13 @@ NC::HKLList NC::detail::calculateHKLPlanesWithSymEqRefl( const StructureInfo& st
   hkllist.shrink_to_fit();
   return hkllist;
 }
+
+void NC::setHKLDiskCacheDir( std::string dir )
+{
+  HKLDiskCache::cacheDirSetting().set( std::move(dir) );
+}
+
+std::string NC::getHKLDiskCacheDir()
+{
+  return HKLDiskCache::cacheDir();
+}
@@ -0,0 +1,367 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/internal/NCFlatExport.hh"
+#include "NCrystal/internal/NCFlatEval.hh"
+#include "NCrystal/internal/NCPCBragg.hh"
+#include "NCrystal/internal/NCMath.hh"
+#include "NCrystal/internal/NCRandUtils.hh"
+#include "NCrystal/NCRNG.hh"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace NC = NCrystal;
+namespace NCPI = NCrystal::ProcImpl;
+
+namespace NCrystal {
+  namespace {
+    void collectComponents( const NCPI::ProcPtr& proc, double scale,
+                            std::vector<NCPI::ProcComposition::Component>& out )
+    {
+      auto pc = dynamic_cast<const NCPI::ProcComposition*>( proc.get() );
+      if ( pc ) {
+        for ( auto& c : pc->components() )
+          collectComponents( c.process, scale * c.scale, out );
+        return;
+      }
+      if ( !proc->isNull() && scale > 0.0 )
+        out.emplace_back( scale, proc );
+    }
+  }
+}
+
+NC::VectD NC::exportFlatIsotropic( ProcImpl::ProcPtr proc, const FlatExportCfg& cfg )
+{
+  if ( proc->isOriented() )
+    NCRYSTAL_THROW(BadInput,"exportFlatIsotropic can only be used with isotropic processes");
+  if ( cfg.bank_ndecade < 1 || cfg.bank_nsamples < 1 )
+    NCRYSTAL_THROW(BadInput,"exportFlatIsotropic: invalid bank_ndecade or bank_nsamples values");
+
+  std::vector<NCPI::ProcComposition::Component> components;
+  collectComponents( proc, 1.0, components );
+
+  //Energy grid from the tabulation of the full process:
+  VectD egrid;
+  if ( !components.empty() )
+    egrid = NCPI::ProcComposition::createTabulated( proc, cfg.tabulation )->tabulatedEnergyGrid();
+
+  VectD out;
+  out.push_back( flatExportVersion );
+  out.push_back( components.size() );
+  out.push_back( egrid.size() );
+  out.insert( out.end(), egrid.begin(), egrid.end() );
+
+  //Cross sections are evaluated exactly at the grid points:
+  for ( auto& c : components ) {
+    CachePtr cacheptr;
+    for ( auto e : egrid )
+      out.push_back( c.scale * c.process->crossSectionIsotropic( cacheptr, NeutronEnergy{e} ).dbl() );
+  }
+
+  //Sampling data:
+  const double emin = cfg.tabulation.emin.dbl();
+  const double emax = cfg.tabulation.emax.dbl();
+  const unsigned nbank = std::max<unsigned>( 2, static_cast<unsigned>( std::ceil( std::log10( emax / emin ) * cfg.bank_ndecade ) ) + 1 );
+  auto rng = createBuiltinRNG( 123456789 );
+  for ( auto& c : components ) {
+    auto pcbragg = dynamic_cast<const PCBragg*>( c.process.get() );
+    if ( pcbragg ) {
+      const VectD v2dE = pcbragg->get2dE();
+      const VectD fdm_commul = pcbragg->getFDMCommul();
+      nc_assert_always( v2dE.size() == fdm_commul.size() );
+      out.push_back( 1 );
+      out.push_back( v2dE.size() );
+      out.insert( out.end(), v2dE.begin(), v2dE.end() );
+      for ( auto f : fdm_commul )
+        out.push_back( c.scale * f );
+      continue;
+    }
+    //Generic component, sample a bank of outcomes at each point of a log grid:
+    const VectD bankegrid = logspace( std::log10( emin ), std::log10( emax ), nbank );
+    out.push_back( 2 );
+    out.push_back( nbank );
+    out.push_back( cfg.bank_nsamples );
+    out.insert( out.end(), bankegrid.begin(), bankegrid.end() );
+    CachePtr cacheptr;
+    for ( auto e : bankegrid ) {
+      for ( unsigned i = 0; i < cfg.bank_nsamples; ++i ) {
+        auto outcome = c.process->sampleScatterIsotropic( cacheptr, rng, NeutronEnergy{e} );
+        out.push_back( outcome.ekin.dbl() / e );
+        out.push_back( outcome.mu.dbl() );
+      }
+    }
+  }
+  return out;
+}
+
+NC::FlatBatchBackend::~FlatBatchBackend() = default;
+
+namespace NCrystal {
+  namespace {
+
+    class ReferenceFlatBatchBackend final : public FlatBatchBackend {
+    public:
+      const char * name() const override { return "reference"; }
+
+      Handle upload( const VectD& tables ) override
+      {
+        FlatEval::Tables t;
+        if ( tables.size() < 3 || !FlatEval::decode( tables.data(), t ) )
+          NCRYSTAL_THROW(BadInput,"ReferenceFlatBatchBackend: unsupported tables");
+        std::lock_guard<std::mutex> guard( m_mutex );
+        const Handle h = ++m_lastHandle;
+        m_tables[h] = tables;
+        return h;
+      }
+
+      void release( Handle h ) override
+      {
+        std::lock_guard<std::mutex> guard( m_mutex );
+        m_tables.erase( h );
+      }
+
+      void crossSectionMany( Handle h, const double* ekin, std::size_t N, double* out_xs ) override
+      {
+        const FlatEval::Tables t = tables( h );
+        for ( std::size_t i = 0; i < N; ++i )
+          out_xs[i] = FlatEval::crossSection( t, ekin[i] );
+      }
+
+      void sampleScatterMany( Handle h, std::uint64_t seed, const double* ekin,
+                              std::size_t N, double* out_ekin, double* out_mu ) override
+      {
+        const FlatEval::Tables t = tables( h );
+        auto rng = createBuiltinRNG( seed );
+        auto rand = [&rng]() { return rng->generate(); };
+        for ( std::size_t i = 0; i < N; ++i ) {
+          if ( !FlatEval::sampleScatter( t, ekin[i], rand, out_ekin[i], out_mu[i] ) )
+            out_ekin[i] = -1.0;
+        }
+      }
+
+    private:
+      FlatEval::Tables tables( Handle h )
+      {
+        std::lock_guard<std::mutex> guard( m_mutex );
+        auto it = m_tables.find( h );
+        nc_assert_always( it != m_tables.end() );
+        FlatEval::Tables t;
+        FlatEval::decode( it->second.data(), t );
+        return t;//NB: the vector stays in the map until released.
+      }
+      std::mutex m_mutex;
+      Handle m_lastHandle = 0;
+      std::map<Handle,VectD> m_tables;
+    };
+
+    struct FlatBackendDB {
+      std::mutex mtx;
+      std::shared_ptr<FlatBatchBackend> backend;
+      //Serialises exports (which are potentially slow, so mtx is not held
+      //during them), to avoid concurrent first uses of a process all
+      //exporting it:
+      std::mutex exportmtx;
+    };
+    FlatBackendDB& flatBackendDB()
+    {
+      static FlatBackendDB db;
+      return db;
+    }
+    std::atomic<bool> s_flatBackendActive( false );
+    //Incremented whenever the backend is replaced, invalidating all uploads:
+    std::atomic<std::uint64_t> s_flatBackendGeneration( 0 );
+
+    //Exporting evaluates processes, which must not dispatch to the backend
+    //while doing so:
+    thread_local bool t_inFlatExport = false;
+  }
+
+  namespace detail {
+    //Record of the tables of a ProcComposition uploaded to a backend. It is
+    //owned by the process itself, so the handle is released when the process
+    //is destroyed (or when the record is replaced after the backend changed or
+    //components were added). The handle is none if the process could not be
+    //exported:
+    struct FlatBackendUpload : private NoCopyMove {
+      std::shared_ptr<FlatBatchBackend> backend;
+      std::uint64_t generation;
+      unsigned nHistory;
+      Optional<FlatBatchBackend::Handle> handle;
+
+      FlatBackendUpload( std::shared_ptr<FlatBatchBackend> be, std::uint64_t gen,
+                         unsigned nh, Optional<FlatBatchBackend::Handle> h )
+        : backend(std::move(be)), generation(gen), nHistory(nh), handle(h)
+      {
+      }
+
+      ~FlatBackendUpload()
+      {
+        if ( handle.has_value() )
+          backend->release( handle.value() );
+      }
+
+      static std::shared_ptr<const FlatBackendUpload> get( const NCPI::ProcComposition& pc )
+      {
+        return std::atomic_load( &pc.m_flatUpload );
+      }
+
+      static void set( const NCPI::ProcComposition& pc, std::shared_ptr<const FlatBackendUpload> u )
+      {
+        std::atomic_store( &pc.m_flatUpload, std::move( u ) );
+      }
+
+      static unsigned historyOf( const NCPI::ProcComposition& pc ) { return pc.m_nHistory; }
+    };
+  }
+
+  namespace {
+    //Uploaded tables of the process (null if not available). The mutexes are
+    //only needed for the first use of a process (or after the backend was
+    //replaced), and the global one is not held during the export:
+    std::shared_ptr<const detail::FlatBackendUpload> flatBackendUpload( const NCPI::ProcComposition& pc )
+    {
+      using detail::FlatBackendUpload;
+      if ( !s_flatBackendActive.load() || t_inFlatExport || pc.materialType() != MaterialType::Isotropic )
+        return nullptr;
+      const unsigned nhist = FlatBackendUpload::historyOf( pc );
+      auto isValid = [nhist]( const std::shared_ptr<const FlatBackendUpload>& r )
+      {
+        return r && r->generation == s_flatBackendGeneration.load() && r->nHistory == nhist;
+      };
+      auto rec = FlatBackendUpload::get( pc );
+      if ( !isValid( rec ) ) {
+        auto& db = flatBackendDB();
+        std::lock_guard<std::mutex> exportguard( db.exportmtx );
+        rec = FlatBackendUpload::get( pc );
+        if ( isValid( rec ) )
+          return rec->handle.has_value() ? rec : nullptr;
+        std::shared_ptr<FlatBatchBackend> backend;
+        std::uint64_t generation;
+        {
+          std::lock_guard<std::mutex> guard( db.mtx );
+          backend = db.backend;
+          generation = s_flatBackendGeneration.load();
+        }
+        if ( !backend )
+          return nullptr;
+        Optional<FlatBatchBackend::Handle> h;
+        t_inFlatExport = true;
+        try {
+          //A copy of the composition, since the export needs shared ownership:
+          auto proc = NCPI::ProcComposition::combine( pc.components(), pc.processType() );
+          h = backend->upload( exportFlatIsotropic( proc ) );
+        } catch ( Error::Exception& ) {
+          //Process not supported, keep using the host.
+        }
+        t_inFlatExport = false;
+        rec = std::make_shared<const FlatBackendUpload>( std::move( backend ), generation, nhist, h );
+        FlatBackendUpload::set( pc, rec );
+      }
+      if ( !rec->handle.has_value() )
+        return nullptr;
+      return rec;
+    }
+  }
+}
+
+void NC::setFlatBatchBackend( std::shared_ptr<FlatBatchBackend> backend )
+{
+  auto& db = flatBackendDB();
+  std::lock_guard<std::mutex> guard( db.mtx );
+  db.backend = std::move( backend );
+  ++s_flatBackendGeneration;
+  s_flatBackendActive = ( db.backend != nullptr );
+}
+
+std::shared_ptr<NC::FlatBatchBackend> NC::getFlatBatchBackend()
+{
+  auto& db = flatBackendDB();
+  std::lock_guard<std::mutex> guard( db.mtx );
+  return db.backend;
+}
+
+std::shared_ptr<NC::FlatBatchBackend> NC::createReferenceFlatBatchBackend()
+{
+  return std::make_shared<ReferenceFlatBatchBackend>();
+}
+
+bool NC::detail::flatBackendCrossSectionMany( const ProcImpl::ProcComposition& pc, CachePtr& cacheptr,
+                                              const double* ekin, std::size_t N, double* out_xs )
+{
+  auto rec = flatBackendUpload( pc );
+  if ( !rec )
+    return false;
+  rec->backend->crossSectionMany( rec->handle.value(), ekin, N, out_xs );
+  for ( std::size_t i = 0; i < N; ++i )
+    if ( out_xs[i] < 0.0 )
+      out_xs[i] = pc.crossSectionIsotropic( cacheptr, NeutronEnergy{ ekin[i] } ).dbl();
+  return true;
+}
+
+bool NC::detail::flatBackendSampleScatterMany( const ProcImpl::ProcComposition& pc, CachePtr& cacheptr, RNG& rng,
+                                               const double* ekin, std::size_t N, ScatterOutcomeIsotropic* out )
+{
+  auto rec = flatBackendUpload( pc );
+  if ( !rec )
+    return false;
+  VectD out_ekin( N ), out_mu( N );
+  rec->backend->sampleScatterMany( rec->handle.value(), rng.generate64RndmBits(), ekin, N, out_ekin.data(), out_mu.data() );
+  for ( std::size_t i = 0; i < N; ++i ) {
+    if ( out_ekin[i] < 0.0 )
+      out[i] = pc.sampleScatterIsotropic( cacheptr, rng, NeutronEnergy{ ekin[i] } );
+    else
+      out[i] = ScatterOutcomeIsotropic{ NeutronEnergy{ out_ekin[i] }, CosineScatAngle{ ncclamp( out_mu[i], -1.0, 1.0 ) } };
+  }
+  return true;
+}
+
+bool NC::detail::flatBackendSampleScatterMany( const ProcImpl::ProcComposition& pc, CachePtr& cacheptr, RNG& rng,
+                                               const double* ekin, const NeutronDirection* dirs,
+                                               std::size_t N, ScatterOutcome* out )
+{
+  if ( !flatBackendUpload( pc ) )
+    return false;
+  //As ScatterIsotropicMat::sampleScatterMany, converting chunks of mu values
+  //to directions:
+  constexpr std::size_t chunksize = 128;
+  ScatterOutcomeIsotropic buf_iso[chunksize];
+  double mu[chunksize], x[chunksize], y[chunksize], z[chunksize];
+  for ( std::size_t ioffset = 0; ioffset < N; ioffset += chunksize ) {
+    const std::size_t n = std::min<std::size_t>( chunksize, N - ioffset );
+    if ( !flatBackendSampleScatterMany( pc, cacheptr, rng, ekin + ioffset, n, buf_iso ) )
+      return false;
+    for ( std::size_t j = 0; j < n; ++j ) {
+      const auto& d = dirs[ioffset+j];
+      mu[j] = buf_iso[j].mu.dbl();
+      x[j] = d[0];
+      y[j] = d[1];
+      z[j] = d[2];
+    }
+    randDirectionsGivenScatterMu( rng, n, mu, x, y, z, x, y, z );
+    for ( std::size_t j = 0; j < n; ++j ) {
+      auto& o = out[ioffset+j];
+      o.ekin = buf_iso[j].ekin;
+      o.direction = NeutronDirection{ x[j], y[j], z[j] };
+    }
+  }
+  return true;
+}
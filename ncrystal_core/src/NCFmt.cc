@@ -23,6 +23,14 @@ namespace NC = NCrystal;
 
 #include <streambuf>
 #include <istream>
+#if __cplusplus >= 201703L && defined(__has_include)
+#  if __has_include(<charconv>)
+#    include <charconv>
+#  endif
+#endif
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#  define NCRYSTAL_FMT_USE_FROM_CHARS
+#endif
 
 namespace NCrystal {
   namespace detail {
@@ -44,10 +52,83 @@ namespace NCrystal {
       {
       }
     };
+    bool fast_str2dbl( const char * c, const char * cE, double& result )
+    {
+      //Fast path for plain decimal numbers like "-1.2345e-05", in which the
+      //digits form an integer m<2^53 and the decimal exponent, e, is in
+      //[-22,22]. Both m and 10^e are then exactly representable, and the
+      //correctly rounded result is obtained with a single multiplication or
+      //division (Clinger's algorithm). Returns false for anything else:
+      static constexpr double pow10[23] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+      constexpr std::uint64_t mlimit = std::uint64_t(1) << 53;
+      bool negative = false;
+      if ( c != cE && ( *c == '-' || *c == '+' ) )
+        negative = ( *c++ == '-' );
+      std::uint64_t m = 0;
+      int e = 0;
+      unsigned ndigits = 0;
+      for ( ; c != cE && *c >= '0' && *c <= '9'; ++c, ++ndigits ) {
+        m = 10 * m + static_cast<unsigned>( *c - '0' );
+        if ( m >= mlimit )
+          return false;
+      }
+      if ( c != cE && *c == '.' ) {
+        for ( ++c; c != cE && *c >= '0' && *c <= '9'; ++c, ++ndigits ) {
+          m = 10 * m + static_cast<unsigned>( *c - '0' );
+          if ( m >= mlimit )
+            return false;
+          --e;
+        }
+      }
+      if ( !ndigits )
+        return false;
+      if ( c != cE && ( *c == 'e' || *c == 'E' ) ) {
+        ++c;
+        bool eneg = false;
+        if ( c != cE && ( *c == '-' || *c == '+' ) )
+          eneg = ( *c++ == '-' );
+        if ( c == cE )
+          return false;
+        int ee = 0;
+        for ( ; c != cE && *c >= '0' && *c <= '9'; ++c ) {
+          ee = 10 * ee + ( *c - '0' );
+          if ( ee > 1000 )
+            return false;
+        }
+        e += ( eneg ? -ee : ee );
+      }
+      if ( c != cE || e < -22 || e > 22 )
+        return false;
+      double v = static_cast<double>( m );
+      v = ( e < 0 ? v / pow10[-e] : v * pow10[e] );
+      result = ( negative ? -v : v );
+      return true;
+    }
+
     Optional<double> raw_str2dbl( const char * s_data, std::size_t s_size ) {
-      //Using streams so we can specify the locale (TODO in c++17 we can possibly
-      //use std::from_chars instead!). Using custom stream buffers to reduce need
-      //for allocations:
+      //Most numbers are handled by the fast path or (when available)
+      //std::from_chars. The latter is only used for input starting like a
+      //number, since it would otherwise accept strings like "infinity" which
+      //are rejected by the stream-based fallback:
+      {
+        double val;
+        if ( fast_str2dbl( s_data, s_data + s_size, val ) )
+          return val;
+      }
+#ifdef NCRYSTAL_FMT_USE_FROM_CHARS
+      if ( s_size > 0 ) {
+        const char c0 = ( s_data[0] == '-' && s_size > 1 ? s_data[1] : s_data[0] );
+        if ( ( c0 >= '0' && c0 <= '9' ) || c0 == '.' ) {
+          double val;
+          auto res = std::from_chars( s_data, s_data + s_size, val );
+          if ( res.ec == std::errc() && res.ptr == s_data + s_size )
+            return val;
+        }
+      }
+#endif
+      //Using streams so we can specify the locale. Using custom stream buffers
+      //to reduce need for allocations:
       detail::nc_imemstream ss(s_data,s_size);
       ss.std::istream::imbue(std::locale::classic());
       double val;
@@ -57,7 +138,31 @@ namespace NCrystal {
       else
         return NullOpt;
     }
+    bool fast_str2int64( const char * c, const char * cE, std::int64_t& result )
+    {
+      //Fast path for plain integers like "-1234" with at most 18 digits (which
+      //can not overflow). Returns false for anything else:
+      bool negative = false;
+      if ( c != cE && ( *c == '-' || *c == '+' ) )
+        negative = ( *c++ == '-' );
+      if ( c == cE || cE - c > 18 )
+        return false;
+      std::int64_t v = 0;
+      for ( ; c != cE; ++c ) {
+        if ( !( *c >= '0' && *c <= '9' ) )
+          return false;
+        v = 10 * v + ( *c - '0' );
+      }
+      result = ( negative ? -v : v );
+      return true;
+    }
+
     Optional<std::int64_t> raw_str2int64( const char * s_data, std::size_t s_size ) {
+      {
+        std::int64_t val;
+        if ( fast_str2int64( s_data, s_data + s_size, val ) )
+          return val;
+      }
       //Using streams so we can specify the locale (TODO in c++17 we can possibly
       //use std::from_chars instead!). Using custom stream buffers to reduce need
       //for allocations:
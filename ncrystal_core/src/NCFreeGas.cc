@@ -22,6 +22,7 @@
 #include "NCrystal/internal/NCRandUtils.hh"
 #include "NCrystal/internal/NCFreeGasUtils.hh"
 #include "NCrystal/internal/NCString.hh"
+#include "NCrystal/internal/NCRuntimeCounters.hh"
 
 namespace NC = NCrystal;
 
@@ -64,16 +65,48 @@ NC::FreeGas::~FreeGas() = default;
 
 NC::CrossSect NC::FreeGas::crossSectionIsotropic(CachePtr&, NeutronEnergy ekin ) const
 {
+  NCRYSTAL_RTCOUNTER_SCOPE(*this,XSCalls);
   return CrossSect{ m_impl->m_xsprovider.crossSection(ekin) };
 }
 
-NC::ScatterOutcomeIsotropic NC::FreeGas::sampleScatterIsotropic(CachePtr&, RNG& rng, NeutronEnergy ekin ) const
+void NC::FreeGas::crossSectionIsotropicMany( CachePtr&, const double* ekin,
+                                            std::size_t N, double* out_xs ) const
 {
+  NCRYSTAL_RTCOUNTER_SCOPE_N(*this,XSCalls,N);
+  m_impl->m_xsprovider.crossSectionMany( ekin, N, out_xs );
+}
+
+namespace NCrystal {
+  namespace {
+    class FreeGasCache final : public CacheBase {
+    public:
+      void invalidateCache() override { samplerCache.invalidate(); }
+      FreeGasSamplerCache samplerCache;
+    };
+  }
+}
+
+NC::ScatterOutcomeIsotropic NC::FreeGas::sampleScatterIsotropic(CachePtr& cp, RNG& rng, NeutronEnergy ekin ) const
+{
+  NCRYSTAL_RTCOUNTER_SCOPE(*this,SampleCalls);
+  auto& sampler = accessCache<FreeGasCache>(cp).samplerCache.get( ekin, m_impl->m_temperature, m_impl->m_target_mass_amu );
   double delta_ekin, mu;
-  std::tie(delta_ekin,mu) = FreeGasSampler(ekin,m_impl->m_temperature,m_impl->m_target_mass_amu).sampleDeltaEMu(rng);
+  std::tie(delta_ekin,mu) = sampler.sampleDeltaEMu(rng);
   return { NeutronEnergy{ncmax(0.0,ekin.get()+delta_ekin)}, CosineScatAngle{mu} };
 }
 
+void NC::FreeGas::sampleScatterIsotropicRepeated( CachePtr& cp, RNG& rng, NeutronEnergy ekin,
+                                                  std::size_t N, ScatterOutcomeIsotropic* out ) const
+{
+  NCRYSTAL_RTCOUNTER_SCOPE_N(*this,SampleCalls,N);
+  auto& sampler = accessCache<FreeGasCache>(cp).samplerCache.get( ekin, m_impl->m_temperature, m_impl->m_target_mass_amu );
+  for ( std::size_t i = 0; i < N; ++i ) {
+    double delta_ekin, mu;
+    std::tie(delta_ekin,mu) = sampler.sampleDeltaEMu(rng);
+    out[i] = { NeutronEnergy{ncmax(0.0,ekin.get()+delta_ekin)}, CosineScatAngle{mu} };
+  }
+}
+
 NC::Optional<std::string> NC::FreeGas::specificJSONDescription() const
 {
   auto sigmafree = m_impl->m_xsprovider.sigmaFree();
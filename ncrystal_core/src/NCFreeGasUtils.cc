@@ -21,6 +21,10 @@
 #include "NCrystal/internal/NCFreeGasUtils.hh"
 #include "NCrystal/internal/NCMath.hh"
 #include "NCrystal/internal/NCRandUtils.hh"
+#include "NCrystal/internal/NCRuntimeCounters.hh"
+#include "NCrystal/internal/NCFactoryUtils.hh"
+#include "NCrystal/internal/NCThreadUtils.hh"
+#include "NCrystal/NCFact.hh"
 namespace NC=NCrystal;
 
 #define NCRYSTAL_FREEGASUTILS_ENABLEEXTRADEBUGGING 0
@@ -61,26 +65,126 @@ NC::FreeGasXSProvider::FreeGasXSProvider( Temperature temp_kelvin,
 
 NC::FreeGasXSProvider::~FreeGasXSProvider() = default;
 
+namespace NCrystal {
+  namespace {
+
+    inline double freeGasXSShapeLowA( double a, double a_squared )
+    {
+      if (a==0.0)
+        return kInfinity;
+      constexpr double c1 = 2.0/3.0;
+      constexpr double c2 = 1.0/15.0;
+      constexpr double c3 = 1.0/105.0;
+      constexpr double c4 = 1.0/756.0;
+      constexpr double c5 = 1.0/5940.0;
+      const double a2 = a_squared;
+      return kInvSqrtPi * ( 2.0 / a +  a *( c1- a2*(c2-a2*(c3-a2*(c4-a2*c5)))));
+    }
+
+    class FreeGasXSShapeTable {
+      //Tabulates K(x)=a*f(a) for x=a^2 in [0,36], where f(a) is the
+      //cross-section shape, (1+1/(2a^2))*erf(a)+exp(-a^2)/(sqrt(pi)*a). Unlike
+      //f, K(x) is an entire function of x and thus very well suited for
+      //piecewise polynomial approximation. With nintervals=72 and degree=8,
+      //the relative deviation from the direct evaluation is at the level of
+      //numerical round-off (~3e-15).
+      static constexpr unsigned nintervals = 72;
+      static constexpr unsigned degree = 8;
+      static constexpr unsigned ncoeffs = degree + 1;
+      static constexpr double xmax = 36.0;
+      double m_coeffs[nintervals*ncoeffs];
+    public:
+      FreeGasXSShapeTable()
+      {
+        //Chebyshev interpolation at the Chebyshev nodes of each interval:
+        const double w = xmax / nintervals;
+        double fvals[ncoeffs];
+        for ( unsigned i = 0; i < nintervals; ++i ) {
+          for ( unsigned k = 0; k < ncoeffs; ++k ) {
+            const double t = std::cos( kPi*(k+0.5)/ncoeffs );
+            const double x = w * ( i + 0.5*(t+1.0) );
+            fvals[k] = ( x > 0.0
+                         ? std::sqrt(x) * FreeGasXSProvider::evalXSShapeASqExact(x)
+                         : 2.0*kInvSqrtPi );
+          }
+          for ( unsigned j = 0; j < ncoeffs; ++j ) {
+            double s = 0.0;
+            for ( unsigned k = 0; k < ncoeffs; ++k )
+              s += fvals[k] * std::cos( kPi*j*(k+0.5)/ncoeffs );
+            m_coeffs[i*ncoeffs+j] = s * ( j == 0 ? 1.0 : 2.0 ) / ncoeffs;
+          }
+        }
+      }
+
+      double evalK( double x ) const
+      {
+        nc_assert( x >= 0.0 && x <= xmax );
+        constexpr double invw = nintervals / xmax;
+        const double xrel = x * invw;
+        const unsigned ibin = std::min<unsigned>( static_cast<unsigned>(xrel), nintervals - 1 );
+        const double t = 2.0 * ( xrel - ibin ) - 1.0;
+        const double twot = 2.0 * t;
+        const double * c = &m_coeffs[ibin*ncoeffs];
+        //Clenshaw recurrence:
+        double b1 = 0.0, b2 = 0.0;
+        for ( unsigned j = degree; j >= 1; --j ) {
+          const double b = twot * b1 - b2 + c[j];
+          b2 = b1;
+          b1 = b;
+        }
+        return t * b1 - b2 + c[0];
+      }
+    };
+
+    const FreeGasXSShapeTable& freeGasXSShapeTable()
+    {
+      static const FreeGasXSShapeTable s_table;
+      return s_table;
+    }
+  }
+}
+
 double NC::FreeGasXSProvider::evalXSShapeASq(double a_squared)
 {
   //a^2 = A*E/kT.
   if (a_squared>36.0)
     return 1.0 + 0.5 / a_squared;
   const double a = std::sqrt(a_squared);
-  if (a<0.1) {
-    if (a==0.0)
-      return kInfinity;
-    constexpr double c1 = 2.0/3.0;
-    constexpr double c2 = 1.0/15.0;
-    constexpr double c3 = 1.0/105.0;
-    constexpr double c4 = 1.0/756.0;
-    constexpr double c5 = 1.0/5940.0;
-    const double a2 = a_squared;
-    return kInvSqrtPi * ( 2.0 / a +  a *( c1- a2*(c2-a2*(c3-a2*(c4-a2*c5)))));
-  };
-  //intermediate region, fall-back to full formula (slow):
+  if (a<0.1)
+    return freeGasXSShapeLowA( a, a_squared );
+  //intermediate region, use tabulated version of a*f(a):
+  return freeGasXSShapeTable().evalK( a_squared ) / a;
+}
+
+double NC::FreeGasXSProvider::evalXSShapeASqExact(double a_squared)
+{
+  //a^2 = A*E/kT.
+  if (a_squared>36.0)
+    return 1.0 + 0.5 / a_squared;
+  const double a = std::sqrt(a_squared);
+  if (a<0.1)
+    return freeGasXSShapeLowA( a, a_squared );
+  //intermediate region, full formula (slow):
   const double inva = 1.0 / a;
-  return ( 1.0 + 0.5*inva*inva ) * std::erf(a) + kInvSqrtPi * std::exp(-a_squared)*inva;
+  return ( 1.0 + 0.5*inva*inva ) * std::erf(a) + kInvSqrtPi * ncexp(-a_squared)*inva;
+}
+
+void NC::FreeGasXSProvider::crossSectionMany( const double* ekin, std::size_t N, double* out_xs ) const
+{
+  const auto& table = freeGasXSShapeTable();
+  const double sigmaFree = m_sigmaFree;
+  const double ca = m_ca;
+  for ( std::size_t i = 0; i < N; ++i ) {
+    const double a_squared = ca * ekin[i];
+    double shape;
+    if ( a_squared > 36.0 ) {
+      shape = 1.0 + 0.5 / a_squared;
+    } else {
+      const double a = std::sqrt(a_squared);
+      shape = ( a < 0.1 ? freeGasXSShapeLowA( a, a_squared ) : table.evalK( a_squared ) / a );
+    }
+    out_xs[i] = sigmaFree * shape;
+  }
 }
 
 namespace NCrystal {
@@ -187,7 +291,7 @@ namespace NCrystal {
     {
       //beta<-700 check is to ignore exp(largeval) overflow:
       if (m_expmbeta<0)
-        m_expmbeta = m_beta<-700.0 ? 0.0 : std::exp(-m_beta);
+        m_expmbeta = m_beta<-700.0 ? 0.0 : ncexp(-m_beta);
     }
 
     double evalExact()
@@ -313,7 +417,7 @@ namespace NCrystal {
                     const double exparg = (x-xmax)/(x*xmax)-c*(x-xmax);
                     if (exparg>=706.0)
                       return 1.0;//hopefully this only happens near function maximum
-                    const double fval = exparg < -745.1 ? 0.0 : std::exp(exparg)*std::sqrt(xmax/x);
+                    const double fval = exparg < -745.1 ? 0.0 : ncexp(exparg)*std::sqrt(xmax/x);
                     nc_assert( fval < 1.00001 );
                     return fval;
                   };
@@ -422,6 +526,7 @@ namespace NCrystal {
     //Start sampling loop:
 
     while (true) {
+      NCRYSTAL_RTCOUNT(RejectionIterations);
       bool do_flat(single_side?always_left:(rng.generate()<probability_flat));
       if (do_flat) {
         //==> Sampling with flat overlay in [xm,xswitch]
@@ -481,7 +586,7 @@ namespace NCrystal {
         double xgen = randExpDivSqrt( rng, c, xswitch, xp );
 
         nc_assert(xgen>=xswitch&&xgen<=xp);
-        if ( rng.generate() < std::exp((xgen-xp)/(xgen*xp)))
+        if ( rng.generate() < ncexp((xgen-xp)/(xgen*xp)))
           return xgen;
       }
     }
@@ -489,7 +594,19 @@ namespace NCrystal {
 
 }
 
+namespace NCrystal {
+  namespace {
+    constexpr double fgsampler_fcutoff_limit = 1e-6;
+  }
+}
+
 NC::FreeGasSampler::FreeGasSampler(NeutronEnergy ekin, Temperature temp_kelvin, AtomMass target_mass_amu)
+  : FreeGasSampler(ekin,temp_kelvin,target_mass_amu,no_beta_init_t())
+{
+  initBetaRange();
+}
+
+NC::FreeGasSampler::FreeGasSampler(NeutronEnergy ekin, Temperature temp_kelvin, AtomMass target_mass_amu, no_beta_init_t)
   : m_c(ncmin(1e14,ncmax(1e-10,ekin.get()/(temp_kelvin.kT())))),
     //nb: we constrain m_c for numerical safety (1.16e13 is 1GeV neutron on 1Kelvin material)
     m_kT(temp_kelvin.kT()),
@@ -516,19 +633,12 @@ NC::FreeGasSampler::FreeGasSampler(NeutronEnergy ekin, Temperature temp_kelvin,
 
 NC::FreeGasSampler::~FreeGasSampler() = default;
 
-void NC::FreeGasSampler::testBetaDistEval (double beta, double & f_exact, double & f_lb, double& f_ub )
+void NC::FreeGasSampler::initBetaRange()
 {
-  if ( beta <= -m_c ) {
-    f_lb = f_ub = f_exact = 0.0;
-    return;
-  }
-  FGEvalBetaDistHelper eval_helper(m_c, m_invA, m_sqrtAc, beta, m_normfact);
-  std::tie(f_lb, f_ub) = eval_helper.evalQuickBounds();
-  f_exact = eval_helper.evalExact();
-}
+  //Setup which depends only on the neutron energy is carried out here rather
+  //than in sampleBeta, so it is reused when sampling repeatedly with the same
+  //FreeGasSampler object.
 
-double NC::FreeGasSampler::sampleBeta( RNG& rng ) const
-{
   if (m_c_real>1e4) {
     //At extremely high energy the neutron will to a very good approximation
     //experience an energy-loss which is uniformly distributed from deltaE=0 to
@@ -541,11 +651,70 @@ double NC::FreeGasSampler::sampleBeta( RNG& rng ) const
     const double c_highe_threshold = 1e4*ncmin(1000.0*A,A2*A2*A2);
     if ( m_c_real > c_highe_threshold ) {
       double am1_div_ap1 = (1.0-m_invA)/(1.0+m_invA);// (A-1)/(A+1);
-      double elossmax = m_c_real * (1.0-am1_div_ap1*am1_div_ap1);
-      return -elossmax*rng.generate();
+      m_elossmax = m_c_real * (1.0-am1_div_ap1*am1_div_ap1);
+      return;
     }
   }
 
+  //Start by sampling in [-E/kT,bmax] where bmax is chosen so exp(-bmax) is
+  //negligible. And use -m_c_real instead of -m_c as lower sampling limit for
+  //extremely low-energy neutrons to not violate kinematic constraints:
+  double aa(ncmax(-m_c_real,-m_c)), bb(13.815510557964274);//bb=-log(fcutoff_limit)
+  nc_assert(aa>=-m_c_real);
+  nc_assert(floateq(std::exp(-bb),fgsampler_fcutoff_limit));
+
+  //At high energies and A values, f is more narrowly peaked around beta=0, so
+  //we gain efficiency by narrowing the initial interval more strongly than the
+  //dynamic narrowing in sampleBeta would do:
+
+  if ( m_invA <= 1.0/10.0 ) {//only for A>=10
+    if (m_c>10.1) {
+      //lower limit - don't bother for low-energy particles.
+      while (true) {
+        double aa_new = aa*0.2;//stepsize tuned
+        if (aa_new>-1e-99)
+          break;
+        double fval = FGEvalBetaDistHelper(m_c, m_invA, m_sqrtAc, aa_new, m_normfact).evalExact();
+        if ( fval > fgsampler_fcutoff_limit )
+          break;
+        aa = aa_new;
+      }
+    }
+    //Same for bb (but can use quick upper bound for beta>0):
+    {
+      while (true) {
+        double bb_new = bb*0.25;//stepsize tuned
+        if ( bb_new<1e-99 )
+          break;
+        double fval_upperbound = FGEvalBetaDistHelper(m_c, m_invA, m_sqrtAc, bb_new, m_normfact).evalQuickBounds().second;
+        if ( fval_upperbound > fgsampler_fcutoff_limit )
+          break;
+        bb = bb_new;
+      }
+    }
+  }
+  m_aa = aa;
+  m_bb = bb;
+}
+
+void NC::FreeGasSampler::testBetaDistEval (double beta, double & f_exact, double & f_lb, double& f_ub )
+{
+  if ( beta <= -m_c ) {
+    f_lb = f_ub = f_exact = 0.0;
+    return;
+  }
+  FGEvalBetaDistHelper eval_helper(m_c, m_invA, m_sqrtAc, beta, m_normfact);
+  std::tie(f_lb, f_ub) = eval_helper.evalQuickBounds();
+  f_exact = eval_helper.evalExact();
+}
+
+double NC::FreeGasSampler::sampleBeta( RNG& rng ) const
+{
+  if ( m_elossmax > 0.0 ) {
+    //Extremely high energy, see initBetaRange:
+    return -m_elossmax*rng.generate();
+  }
+
   ////////////////////////////////////////////////////////////////////////////////
   //
   //The idea is to sample f(beta) with the rejection method, using an overlay
@@ -634,45 +803,11 @@ double NC::FreeGasSampler::sampleBeta( RNG& rng ) const
   constexpr double Tlim_k2 = 274./315.;//integral of T(x) from 0 to Tlim=2.
 
   //The fcutoff_limit:
-  const double fcutoff_limit = 1e-6;
-
-  //Start by sampling in [-E/kT,bmax] where bmax is chosen so exp(-bmax) is
-  //negligible. And use -m_c_real instead of -m_c as lower sampling limit for
-  //extremely low-energy neutrons to not violate kinematic constraints:
-  double aa(ncmax(-m_c_real,-m_c)), bb(13.815510557964274);//bb=-log(fcutoff_limit)
-  nc_assert(aa>=-m_c_real);
-  nc_assert(floateq(std::exp(-bb),fcutoff_limit));
+  const double fcutoff_limit = fgsampler_fcutoff_limit;
 
-  //At high energies and A values, f is more narrowly peaked around beta=0, so
-  //we gain efficiency by narrowing the initial interval more strongly than the
-  //dynamic narrowing below would do:
+  //Initial interval, already narrowed by initBetaRange:
+  const double aa(m_aa), bb(m_bb);
 
-  if ( m_invA <= 1.0/10.0 ) {//only for A>=10
-    if (m_c>10.1) {
-      //lower limit - don't bother for low-energy particles.
-      while (true) {
-        double aa_new = aa*0.2;//stepsize tuned
-        if (aa_new>-1e-99)
-          break;
-        double fval = FGEvalBetaDistHelper(m_c, m_invA, m_sqrtAc, aa_new, m_normfact).evalExact();
-        if ( fval > fcutoff_limit )
-          break;
-        aa = aa_new;
-      }
-    }
-    //Same for bb (but can use quick upper bound for beta>0):
-    {
-      while (true) {
-        double bb_new = bb*0.25;//stepsize tuned
-        if ( bb_new<1e-99 )
-          break;
-        double fval_upperbound = FGEvalBetaDistHelper(m_c, m_invA, m_sqrtAc, bb_new, m_normfact).evalQuickBounds().second;
-        if ( fval_upperbound > fcutoff_limit )
-          break;
-        bb = bb_new;
-      }
-    }
-  }
   if (!(bb>aa))
     return aa;
 
@@ -698,7 +833,7 @@ double NC::FreeGasSampler::sampleBeta( RNG& rng ) const
                    area_closetail =  b * (1.0+b*(c2+b*(c3+b*(c4+b*(c5+b*(c6+b*c7))))));
                    nc_assert(area_closetail>=0.0&&area_closetail<=Tlim_k2);
                  } else {
-                   area_fartail = Tlim_k1 - std::exp(-bbb);
+                   area_fartail = Tlim_k1 - ncexp(-bbb);
                    nc_assert(area_fartail>=0.0);
                    area_closetail = Tlim_k2;
                  }
@@ -720,6 +855,7 @@ double NC::FreeGasSampler::sampleBeta( RNG& rng ) const
   //Sampling loop:
 
   while (true) {
+    NCRYSTAL_RTCOUNT(RejectionIterations);
     double beta, foverlay;
 
     //////////////////////////////
@@ -739,7 +875,7 @@ double NC::FreeGasSampler::sampleBeta( RNG& rng ) const
           expsampler.set(Tlim,b,1.0);
         beta = expsampler.sample(rng);
         nc_assert(beta>=Tlim&&beta<=b*1.000001);
-        foverlay = std::exp(-beta);
+        foverlay = ncexp(-beta);
       } else {
         //close tail, f_overlay(beta)=T(beta).
         //Generate with rejection method, using flat overlay.
@@ -899,6 +1035,7 @@ double NC::FreeGasSampler::sampleAlpha( double beta, RNG& rng ) const
     const double xxm(am*inv4A), xxp(ap*inv4A);
     NCRYSTAL_DEBUGONLY(unsigned iloop(0));
     while (true) {
+      NCRYSTAL_RTCOUNT(RejectionIterations);
       //sample xx from exp(-x)/sqrt(x)
       const double xx = randExpDivSqrt( rng, 1.0, xxm, xxp );
       double alpha = xx * fourA;
@@ -929,3 +1066,198 @@ double NC::FreeGasSampler::sampleAlpha( double beta, RNG& rng ) const
     return ncclamp(x*t,am,ap);
   }
 }
+
+void NC::FreeGasSampler::calcBetaQuantiles( const double * levels, std::size_t nlevels, double * out ) const
+{
+  //Find quantiles of the beta distribution at the given (increasing) levels
+  //in [0,1], by integrating f(beta) over the sampling interval of
+  //initBetaRange (with the trapezoidal rule on grids on each side of beta=0,
+  //where f is not smooth). As in sampleBeta, regions with
+  //f(beta)<fcutoff_limit at the ends of the interval are ignored:
+  nc_assert_always( nlevels >= 2 );
+  if ( m_elossmax > 0.0 || !( m_bb > m_aa ) ) {
+    //Flat distribution in [-m_elossmax,0], or a single value:
+    const double a = ( m_elossmax > 0.0 ? -m_elossmax : m_aa );
+    const double b = ( m_elossmax > 0.0 ? 0.0 : m_aa );
+    for ( std::size_t j = 0; j < nlevels; ++j )
+      out[j] = a + ( b - a ) * levels[j];
+    return;
+  }
+  constexpr unsigned nside = 1024;
+  VectD betas, fvals;
+  betas.reserve( 2*nside+1 );
+  fvals.reserve( 2*nside+1 );
+  auto addPoint = [this,&betas,&fvals]( double beta )
+  {
+    betas.push_back( beta );
+    fvals.push_back( beta <= -m_c ? 0.0 : ncmax( 0.0, FGEvalBetaDistHelper(m_c, m_invA, m_sqrtAc, beta, m_normfact).evalExact() ) );
+  };
+  if ( m_aa < 0.0 ) {
+    for ( unsigned i = 0; i < nside; ++i )
+      addPoint( m_aa * ( 1.0 - double(i) / nside ) );
+  }
+  addPoint( 0.0 );
+  for ( unsigned i = 1; i <= nside; ++i )
+    addPoint( m_bb * double(i) / nside );
+
+  //Crop negligible ends (keeping one point below the cutoff on each side):
+  std::size_t ifirst = 0, ilast = betas.size() - 1;
+  while ( ifirst + 1 < ilast && fvals[ifirst+1] < fgsampler_fcutoff_limit )
+    ++ifirst;
+  while ( ilast > ifirst + 1 && fvals[ilast-1] < fgsampler_fcutoff_limit )
+    --ilast;
+  VectD cdf;
+  cdf.reserve( ilast - ifirst + 1 );
+  cdf.push_back( 0.0 );
+  for ( std::size_t i = ifirst + 1; i <= ilast; ++i )
+    cdf.push_back( cdf.back() + 0.5 * ( fvals[i] + fvals[i-1] ) * ( betas[i] - betas[i-1] ) );
+  const double tot = cdf.back();
+  nc_assert_always( tot > 0.0 );
+
+  //Invert (linearly inside each interval):
+  std::size_t k = 1;
+  for ( std::size_t j = 0; j < nlevels; ++j ) {
+    const double target = tot * levels[j];
+    while ( k + 1 < cdf.size() && cdf[k] < target )
+      ++k;
+    const double dc = cdf[k] - cdf[k-1];
+    const double t = ( dc > 0.0 ? ncclamp( ( target - cdf[k-1] ) / dc, 0.0, 1.0 ) : 0.5 );
+    out[j] = betas[ifirst+k-1] + t * ( betas[ifirst+k] - betas[ifirst+k-1] );
+    if ( j > 0 )
+      out[j] = ncmax( out[j], out[j-1] );
+  }
+}
+
+NC::TabulatedFreeGasSampler::TabulatedFreeGasSampler( Temperature temp, AtomMass mass )
+  : m_t(DoValidate,temp),
+    m_m(DoValidate,mass)
+{
+  //Energy range (in units of kT), ending where FreeGasSampler uses a flat beta
+  //distribution (cf. FreeGasSampler::initBetaRange):
+  const double kT = m_t.kT();
+  const double A = m_m.relativeToNeutronMass();
+  const double A2 = A*A;
+  const double c_highe_threshold = 1e4*ncmin(1000.0*A,A2*A2*A2);
+  const double c_min = 5.0;
+  const double c_max = ncmax( 2.0 * c_min, ncmin( 2e7 / kT, c_highe_threshold ) );
+  constexpr double npts_per_decade = 16.0;
+  const std::size_t ngrid = 1 + static_cast<std::size_t>( std::ceil( std::log10( c_max / c_min ) * npts_per_decade ) );
+  m_egrid = logspace( std::log10( c_min * kT ), std::log10( c_max * kT ), static_cast<unsigned>( ngrid ) );
+  m_egrid.front() = c_min * kT;
+  m_egrid.back() = c_max * kT;
+  m_invLogStep = ( ngrid - 1 ) / std::log( c_max / c_min );
+
+  //Levels of quantiles:
+  std::array<double,nlevels> levels;
+  {
+    constexpr double dq = 1.0 / nquantiles;
+    constexpr double dsub = dq / nsubquantiles;
+    std::size_t k = 0;
+    for ( unsigned i = 0; i <= nsubquantiles; ++i )
+      levels[k++] = i * dsub;
+    for ( unsigned i = 2; i + 1 < nquantiles; ++i )
+      levels[k++] = i * dq;
+    for ( unsigned i = 0; i < nsubquantiles; ++i )
+      levels[k++] = 1.0 - dq + i * dsub;
+    levels[k++] = 1.0;
+    nc_assert_always( k == nlevels );
+  }
+
+  //Tabulate quantiles at the grid points, and at the midpoints of the grid
+  //intervals for estimating the interpolation error:
+  m_quantiles.resize( ngrid * nlevels );
+  VectD midpoint_quantiles( ( ngrid - 1 ) * nlevels );
+  parallelForIndex( 2*ngrid - 1, getNumberOfThreads(),
+                    [this,&midpoint_quantiles,&levels]( std::size_t i )
+                    {
+                      const std::size_t idx = i / 2;
+                      const bool is_midpoint = ( i % 2 == 1 );
+                      const double e = ( is_midpoint ? 0.5 * ( m_egrid[idx] + m_egrid[idx+1] ) : m_egrid[idx] );
+                      FreeGasSampler( NeutronEnergy{e}, m_t, m_m )
+                        .calcBetaQuantiles( levels.data(), nlevels,
+                                            ( is_midpoint ? &midpoint_quantiles[idx*nlevels] : &m_quantiles[idx*nlevels] ) );
+                    } );
+
+  m_maxError = 0.0;
+  for ( std::size_t i = 0; i + 1 < ngrid; ++i ) {
+    const double * q0 = &m_quantiles[i*nlevels];
+    const double * q1 = q0 + nlevels;
+    const double * qmid = &midpoint_quantiles[i*nlevels];
+    const double width = qmid[nlevels-1] - qmid[0];
+    if ( !( width > 0.0 ) )
+      continue;
+    for ( unsigned j = 0; j < nlevels; ++j )
+      m_maxError = ncmax( m_maxError, std::fabs( 0.5 * ( q0[j] + q1[j] ) - qmid[j] ) / width );
+  }
+}
+
+NC::TabulatedFreeGasSampler::~TabulatedFreeGasSampler() = default;
+
+std::size_t NC::TabulatedFreeGasSampler::memoryFootprint() const noexcept
+{
+  return sizeof(TabulatedFreeGasSampler) + ( m_egrid.capacity() + m_quantiles.capacity() ) * sizeof(double);
+}
+
+NC::PairDD NC::TabulatedFreeGasSampler::sampleAlphaBeta( NeutronEnergy ekin, RNG& rng ) const
+{
+  const double e = ekin.dbl();
+  nc_assert( covers(ekin) );
+  const std::size_t nlast = m_egrid.size() - 1;
+  std::size_t i = static_cast<std::size_t>( ncmax( 0.0, std::log( e / m_egrid.front() ) * m_invLogStep ) );
+  i = ncmin( i, nlast - 1 );
+  //Correct for numerical imprecision in the index calculation:
+  if ( i > 0 && e < m_egrid[i] )
+    --i;
+  else if ( i + 1 < nlast && e > m_egrid[i+1] )
+    ++i;
+  const double w = ncclamp( ( e - m_egrid[i] ) / ( m_egrid[i+1] - m_egrid[i] ), 0.0, 1.0 );
+
+  //Find quantile bin (see layout of levels in constructor):
+  const double x = rng.generate() * nquantiles;
+  const unsigned j = ncmin( static_cast<unsigned>( x ), nquantiles - 1 );
+  double t = x - j;
+  std::size_t ilevel;
+  if ( j == 0 || j + 1 == nquantiles ) {
+    const double y = t * nsubquantiles;
+    const unsigned k = ncmin( static_cast<unsigned>( y ), nsubquantiles - 1 );
+    t = y - k;
+    ilevel = ( j == 0 ? k : nsubquantiles + nquantiles - 2 + k );
+  } else {
+    ilevel = nsubquantiles + j - 1;
+  }
+  const double * q0 = &m_quantiles[ i * nlevels + ilevel ];
+  const double * q1 = q0 + nlevels;
+  const double beta0 = q0[0] + t * ( q0[1] - q0[0] );
+  const double beta1 = q1[0] + t * ( q1[1] - q1[0] );
+
+  FreeGasSampler fgs( ekin, m_t, m_m, FreeGasSampler::no_beta_init_t() );
+  const double beta = ncmax( beta0 + w * ( beta1 - beta0 ), -fgs.m_c_real );
+  return fgs.sampleAlphaGivenBeta( beta, rng );
+}
+
+namespace NCrystal {
+  namespace {
+    using TabFGKey = std::pair<double,double>;//(temperature, mass)
+    class TabulatedFreeGasSamplerFactory : public CachedFactoryBase<TabFGKey,TabulatedFreeGasSampler> {
+    public:
+      const char* factoryName() const final { return "TabulatedFreeGasSamplerFactory"; }
+      std::string keyToString( const TabFGKey& key ) const final
+      {
+        std::ostringstream ss;
+        ss<<"(T="<<Temperature{key.first}<<";M="<<AtomMass{key.second}<<")";
+        return ss.str();
+      }
+    protected:
+      virtual ShPtr actualCreate( const TabFGKey& key ) const final
+      {
+        return std::make_shared<const TabulatedFreeGasSampler>( Temperature{key.first}, AtomMass{key.second} );
+      }
+    };
+    static TabulatedFreeGasSamplerFactory s_tabfgfact;
+  }
+}
+
+NC::shared_obj<const NC::TabulatedFreeGasSampler> NC::getTabulatedFreeGasSampler( Temperature temp, AtomMass mass )
+{
+  return s_tabfgfact.create( TabFGKey( temp.dbl(), mass.dbl() ) );
+}
@@ -0,0 +1,150 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "NCrystal/internal/NCGaussKronrod.hh"
+#include "NCrystal/internal/NCMath.hh"
+#include <limits>
+
+namespace NC = NCrystal;
+
+namespace NCrystal {
+  namespace {
+    //Positive nodes of the 15-point Kronrod rule (the Gauss nodes are at odd
+    //indices), and the weights of the center and of each of the positive
+    //nodes:
+    constexpr double gk_x[7] = { 0.207784955007898467600689403773245, 0.405845151377397166906606412076961,
+                                        0.586087235467691130294144845693013, 0.741531185599394439863864773280788,
+                                        0.864864423359769072789712788640926, 0.949107912342758524526189684047851,
+                                        0.991455371120812639206854697526329 };
+    constexpr double gk_wk0 = 0.209482141084727828012999174891714;
+    constexpr double gk_wk[7] = { 0.204432940075298892414161999234649, 0.190350578064785409913256402421014,
+                                         0.169004726639267902826583426598550, 0.140653259715525918745189590510238,
+                                         0.104790010322250183839876322541518, 0.063092092629978553290700663189204,
+                                         0.022935322010529224963732008058970 };
+    constexpr double gk_wg0 = 0.417959183673469387755102040816327;
+    constexpr double gk_wg[3] = { 0.381830050505118944950369775488975, 0.279705391489276667901467771423780,
+                                         0.129484966168869693270611432679082 };
+
+    struct GKInterval {
+      double a, b, result, error;
+    };
+
+    GKInterval evalGK15( const GaussKronrod& gk, double a, double b )
+    {
+      const double center = 0.5 * ( a + b );
+      const double halfwidth = 0.5 * ( b - a );
+      double f[GaussKronrod::nnodes];
+      gk.evalFuncNodes( center, halfwidth, f );
+      double resk = gk_wk0 * f[0];
+      double resg = gk_wg0 * f[0];
+      double resabs = ncabs( resk );
+      for ( unsigned k = 0; k < 7; ++k ) {
+        const double fsum = f[2*k+1] + f[2*k+2];
+        resk += gk_wk[k] * fsum;
+        resabs += gk_wk[k] * ( ncabs( f[2*k+1] ) + ncabs( f[2*k+2] ) );
+        if ( k % 2 == 1 )
+          resg += gk_wg[k/2] * fsum;
+      }
+      const double reskh = 0.5 * resk;
+      double resasc = gk_wk0 * ncabs( f[0] - reskh );
+      for ( unsigned k = 0; k < 7; ++k )
+        resasc += gk_wk[k] * ( ncabs( f[2*k+1] - reskh ) + ncabs( f[2*k+2] - reskh ) );
+      resabs *= halfwidth;
+      resasc *= halfwidth;
+      //The Gauss-Kronrod difference is an estimate of the error of the Gauss
+      //result, which for smooth functions is much larger than the error of the
+      //Kronrod result. As in QUADPACK's QK15, the estimate is therefore scaled
+      //by (err/resasc)^0.5, but here without QUADPACK's additional safety factor
+      //of 200^1.5, which makes it very conservative at the moderate precisions
+      //(~1e-3) typical for NCrystal. For Gaussian peaks spanning the interval,
+      //the resulting estimates still exceed the actual errors by factors of
+      //more than 1000:
+      double err = ncabs( ( resk - resg ) * halfwidth );
+      if ( resasc != 0.0 && err != 0.0 )
+        err = resasc * ncmin( 1.0, std::pow( err / resasc, 1.5 ) );
+      constexpr double eps50 = 50.0 * std::numeric_limits<double>::epsilon();
+      if ( resabs > std::numeric_limits<double>::min() / eps50 )
+        err = ncmax( eps50 * resabs, err );
+      return { a, b, resk * halfwidth, err };
+    }
+  }
+}
+
+double NC::GaussKronrod::node( unsigned i )
+{
+  nc_assert( i < 7 );
+  return gk_x[i];
+}
+
+void NC::GaussKronrod::evalFuncNodes( double center, double halfwidth, double* fvals ) const
+{
+  fvals[0] = evalFunc( center );
+  for ( unsigned k = 0; k < 7; ++k ) {
+    const double d = halfwidth * gk_x[k];
+    fvals[2*k+1] = evalFunc( center - d );
+    fvals[2*k+2] = evalFunc( center + d );
+  }
+}
+
+bool NC::GaussKronrod::accept( double estimate, double error_estimate, double, double ) const
+{
+  return error_estimate <= 1e-8 * ncabs( estimate );
+}
+
+void NC::GaussKronrod::convergenceError( double a, double b ) const
+{
+  NCRYSTAL_THROW2( CalcError, "Gauss-Kronrod integration over ["<<a<<", "<<b<<"] did not converge." );
+}
+
+double NC::GaussKronrod::integrate( double a, double b ) const
+{
+  GKInterval first = evalGK15( *this, a, b );
+  if ( accept( first.result, first.error, a, b ) )
+    return first.result;
+
+  constexpr unsigned maxintervals = 64;
+  GKInterval intervals[maxintervals];
+  intervals[0] = first;
+  unsigned n = 1;
+  while ( true ) {
+    //Bisect the interval with the largest error estimate:
+    unsigned iworst = 0;
+    for ( unsigned i = 1; i < n; ++i )
+      if ( intervals[i].error > intervals[iworst].error )
+        iworst = i;
+    const GKInterval worst = intervals[iworst];
+    const double mid = 0.5 * ( worst.a + worst.b );
+    intervals[iworst] = evalGK15( *this, worst.a, mid );
+    intervals[n++] = evalGK15( *this, mid, worst.b );
+
+    StableSum result, error;
+    for ( unsigned i = 0; i < n; ++i ) {
+      result.add( intervals[i].result );
+      error.add( intervals[i].error );
+    }
+    if ( accept( result.sum(), error.sum(), a, b ) )
+      return result.sum();
+    if ( n == maxintervals ) {
+      convergenceError( a, b );
+      return result.sum();//convergenceError() did not throw, so return best estimate.
+    }
+  }
+}
@@ -69,6 +69,29 @@ void NC::GaussMos::updateDerivedValues()
   if ( ! (truncangle < kPiHalf) )
     NCRYSTAL_THROW(BadInput,"Mosaicity too large, truncation angle (sigma*Ntrunc) must be less than pi/2");
   m_gos.set(m_mos_sigma.dbl(), truncangle, m_prec );
+  //Screening angle (with exactly the truncation values when disabled, so
+  //results are unchanged):
+  m_screenangle = m_gos.getTruncangle();
+  m_cos_screenangle = m_gos.getCosTruncangle();
+  m_sin_screenangle = m_gos.getSinTruncangle();
+  if ( m_screen > 0.0 ) {
+    const double a = m_gos.getSigma() * std::sqrt( -2.0 * std::log( m_screen ) );
+    if ( a < m_screenangle ) {
+      m_screenangle = a;
+      m_cos_screenangle = std::cos( a );
+      m_sin_screenangle = std::sin( a );
+    }
+  }
+}
+
+void NC::GaussMos::setScreening( double fraction )
+{
+  if ( !( fraction >= 0.0 && fraction < 1.0 ) )
+    NCRYSTAL_THROW2(BadInput,"GaussMos screening fraction must be in range [0,1) (got "<<fraction<<")");
+  if ( m_screen != fraction ) {
+    m_screen = fraction;
+    updateDerivedValues();
+  }
 }
 
 void NC::GaussMos::setMosaicity( MosaicityFWHM mosaicity )
@@ -148,51 +171,173 @@ double NC::GaussMos::calcRawCrossSectionValueInit(InteractionPars& ip, double co
 
 double NC::GaussMos::calcCrossSections( InteractionPars& ip,
                                         const NC::Vector& indir,
-                                        const std::vector<NC::Vector>& deminormals,
+                                        const DemiNormals& deminormals,
                                         std::vector<NC::GaussMos::ScatCache>& cache,
                                         VectD& xs_commul ) const
 {
   nc_assert(ip.isValid()&&ip.m_wl>0);
   nc_assert(indir.isUnitVector());
-  std::vector<Vector>::const_iterator it(deminormals.begin()), itE(deminormals.end());
   double xsoffset = xs_commul.empty() ? 0.0 : xs_commul.back();
   double xssum(0.0);
   const double cptsq = ip.m_cos_perfect_theta_sq;
-  const double cta = m_gos.getCosTruncangle();
-  for(;it!=itE;++it) {
-    const Vector& normal = *it;
-    const double dot = normal.dot(indir);
-    double sdotcptsq = (1.0 - dot * dot)*cptsq;
-    double ds = dot * ip.m_sin_perfect_theta;
-
-    //First a combined check, which usually allows us to skip both normal and
-    //anti-normal:
-    double A0 = ncmax( 0.0, cta - ncabs(ds) );
-    if ( sdotcptsq <= A0*A0 )
-      continue;
+  const double spt = ip.m_sin_perfect_theta;
+  const double cta = m_cos_screenangle;
+  const double ix = indir[0];
+  const double iy = indir[1];
+  const double iz = indir[2];
+  const double * nx = deminormals.xData();
+  const double * ny = deminormals.yData();
+  const double * nz = deminormals.zData();
+
+  //The normals are processed in chunks. First the dot products and the
+  //combined check (which usually allows us to skip both normal and
+  //anti-normal) are calculated for the whole chunk in a branch-free loop which
+  //the compiler can vectorise, after which the few surviving normals are
+  //treated together:
+  constexpr std::size_t chunksize = 64;
+  double dots[chunksize];
+  double accept[chunksize];
+  uint32_t sel_idx[chunksize];
+  double sel_dots[chunksize];
+  const std::size_t n = deminormals.size();
+  for ( std::size_t ichunk = 0; ichunk < n; ichunk += chunksize ) {
+    const std::size_t m = std::min<std::size_t>( chunksize, n - ichunk );
+    const double * cx = nx + ichunk;
+    const double * cy = ny + ichunk;
+    const double * cz = nz + ichunk;
+    for ( std::size_t i = 0; i < m; ++i ) {
+      const double dot = cx[i]*ix+cy[i]*iy+cz[i]*iz;
+      const double sdotcptsq = (1.0 - dot * dot)*cptsq;
+      //NB: A0=max(0,t) written as 0.5*(t+|t|), which gives exactly the same
+      //values but allows vectorisation:
+      const double t = cta - ncabs(dot * spt);
+      const double A0 = 0.5 * ( t + ncabs(t) );
+      dots[i] = dot;
+      accept[i] = ( sdotcptsq > A0*A0 ? 1.0 : 0.0 );
+    }
+    std::size_t nsel(0);
+    for ( std::size_t i = 0; i < m; ++i ) {
+      if ( accept[i] ) {
+        sel_idx[nsel] = static_cast<uint32_t>( ichunk + i );
+        sel_dots[nsel++] = dots[i];
+      }
+    }
+    if ( nsel )
+      addNormalPairContribs( ip, deminormals, sel_idx, sel_dots, nsel, xsoffset, xssum, cache, xs_commul );
+  }
+  return xssum;
+}
 
-    //At least one of the two normals should contribute, so deal with them:
+double NC::GaussMos::calcCrossSections( InteractionPars& ip,
+                                        const NC::Vector& indir,
+                                        const DemiNormals& deminormals,
+                                        const uint32_t* indices,
+                                        std::size_t nindices,
+                                        std::vector<NC::GaussMos::ScatCache>& cache,
+                                        VectD& xs_commul ) const
+{
+  nc_assert(ip.isValid()&&ip.m_wl>0);
+  nc_assert(indir.isUnitVector());
+  double xsoffset = xs_commul.empty() ? 0.0 : xs_commul.back();
+  double xssum(0.0);
+  const double cptsq = ip.m_cos_perfect_theta_sq;
+  const double spt = ip.m_sin_perfect_theta;
+  const double cta = m_cos_screenangle;
+  const double * nx = deminormals.xData();
+  const double * ny = deminormals.yData();
+  const double * nz = deminormals.zData();
+  constexpr std::size_t chunksize = 64;
+  uint32_t sel_idx[chunksize];
+  double sel_dots[chunksize];
+  std::size_t nsel(0);
+  for ( std::size_t j = 0; j < nindices; ++j ) {
+    //Same calculations as in the full version above:
+    const std::size_t i = indices[j];
+    nc_assert( i < deminormals.size() );
+    nc_assert( j == 0 || indices[j-1] < i );
+    const double dot = nx[i]*indir[0]+ny[i]*indir[1]+nz[i]*indir[2];
+    const double sdotcptsq = (1.0 - dot * dot)*cptsq;
+    const double t = cta - ncabs(dot * spt);
+    const double A0 = 0.5 * ( t + ncabs(t) );
+    if ( sdotcptsq > A0*A0 ) {
+      sel_idx[nsel] = static_cast<uint32_t>( i );
+      sel_dots[nsel++] = dot;
+      if ( nsel == chunksize ) {
+        addNormalPairContribs( ip, deminormals, sel_idx, sel_dots, nsel, xsoffset, xssum, cache, xs_commul );
+        nsel = 0;
+      }
+    }
+  }
+  if ( nsel )
+    addNormalPairContribs( ip, deminormals, sel_idx, sel_dots, nsel, xsoffset, xssum, cache, xs_commul );
+  return xssum;
+}
+
+void NC::GaussMos::addNormalPairContribs( InteractionPars& ip, const DemiNormals& deminormals,
+                                          const uint32_t * indices, const double * dots, std::size_t n,
+                                          double xsoffset, double& xssum,
+                                          std::vector<ScatCache>& cache, VectD& xs_commul ) const
+{
+  //At least one of the two normals of each demi-normal should contribute.
+  //First find those which do (anti-normal first) and the cosines of their
+  //angles with indir, then evaluate the corresponding circle integrals
+  //together:
+  nc_assert( n <= 64 );
+  const double cptsq = ip.m_cos_perfect_theta_sq;
+  const double cta = m_cos_screenangle;
+  double cosvals[128];
+  double xsvals[128];
+  uint32_t entries[128];//2*(index in input arrays) + (1 if normal, 0 if anti-normal)
+  std::size_t ne(0);
+  for ( std::size_t i = 0; i < n; ++i ) {
+    const double dot = dots[i];
+    const double sdotcptsq = (1.0 - dot * dot)*cptsq;
+    const double ds = dot * ip.m_sin_perfect_theta;
     double Am = ncmax( 0.0, cta - ds );
     if ( sdotcptsq > Am*Am ) {
       //anti-normal is within truncated Gauss
-      double xs = calcRawCrossSectionValue(ip, dot );
-      if (xs) {
-        xs_commul.push_back(xsoffset + (xssum += xs));
-        cache.emplace_back(-normal, ip.m_inv2dsp);
-      }
+      cosvals[ne] = dot;
+      entries[ne++] = static_cast<uint32_t>( 2*i );
     }
     double Ap = ncmax( 0.0, cta + ds );
     if ( sdotcptsq > Ap*Ap ) {
       //normal is within truncated Gauss
-      double xs = calcRawCrossSectionValue(ip, -dot );
-      if (xs) {
-        xs_commul.push_back(xsoffset + (xssum += xs));
-        cache.emplace_back(normal, ip.m_inv2dsp);
-      }
+      cosvals[ne] = -dot;
+      entries[ne++] = static_cast<uint32_t>( 2*i+1 );
     }
+  }
+  if ( !ne )
+    return;
 
+  std::size_t ibatch(0);
+  if ( !(ip.m_Q>0.) ) {
+    //The first evaluation initialises the interaction parameters, and
+    //possibly detects that the cross sections are trivially 0 or infinite:
+    xsvals[0] = calcRawCrossSectionValue( ip, cosvals[0] );
+    ibatch = 1;
+  }
+  if ( ip.m_Q>0. ) {
+    double sinvals[128];
+    for ( std::size_t i = ibatch; i < ne; ++i )
+      sinvals[i] = std::sqrt(1.0-cosvals[i]*cosvals[i]);//>0 since angle is in 0..pi.
+    m_gos.circleIntegralMany( ne - ibatch, cosvals + ibatch, sinvals + ibatch,
+                              ip.m_sin_perfect_theta, ip.m_cos_perfect_theta, xsvals + ibatch );
+    const double Q = ip.m_Q;
+    for ( std::size_t i = ibatch; i < ne; ++i )
+      xsvals[i] *= Q;
+  } else {
+    for ( std::size_t i = ibatch; i < ne; ++i )
+      xsvals[i] = calcRawCrossSectionValue( ip, cosvals[i] );
+  }
+
+  for ( std::size_t ie = 0; ie < ne; ++ie ) {
+    const double xs = xsvals[ie];
+    if (xs) {
+      xs_commul.push_back(xsoffset + (xssum += xs));
+      const Vector normal = deminormals[ indices[ entries[ie] >> 1 ] ];
+      cache.emplace_back( ( entries[ie] & 1 ) ? normal : -normal, ip.m_inv2dsp);
+    }
   }
-  return xssum;
 }
 
 void NC::GaussMos::genScat( RNG& rng, const ScatCache& cache, double wl_raw, const NC::Vector& indir, NC::Vector& outdir) const
@@ -280,3 +425,62 @@ void NC::GaussMos::InteractionPars::set(double wl_raw, double inv2dsp_raw, doubl
   m_Q = m_Qprime = m_cos_perfect_theta = -1;//invalidate
   m_alpha = -99;//invalidate
 }
+
+NC::GaussMos::DemiNormals::DemiNormals( DemiNormals&& o ) noexcept
+  : m_x(std::move(o.m_x)), m_y(std::move(o.m_y)), m_z(std::move(o.m_z)),
+    m_px(o.m_px), m_py(o.m_py), m_pz(o.m_pz), m_n(o.m_n)
+{
+  o.m_px = o.m_py = o.m_pz = nullptr;
+  o.m_n = 0;
+}
+
+NC::GaussMos::DemiNormals& NC::GaussMos::DemiNormals::operator=( DemiNormals&& o ) noexcept
+{
+  if ( this != &o ) {
+    m_x = std::move(o.m_x);
+    m_y = std::move(o.m_y);
+    m_z = std::move(o.m_z);
+    m_px = o.m_px;
+    m_py = o.m_py;
+    m_pz = o.m_pz;
+    m_n = o.m_n;
+    o.m_px = o.m_py = o.m_pz = nullptr;
+    o.m_n = 0;
+  }
+  return *this;
+}
+
+NC::GaussMos::DemiNormals::Arena NC::GaussMos::DemiNormals::pack( const std::vector<DemiNormals*>& dns )
+{
+  //Each array is padded to a multiple of 64 bytes, so all arrays start at a
+  //cache line boundary:
+  constexpr std::size_t line = 64 / sizeof(double);
+  auto padded = []( std::size_t n ) { return ( ( n + line - 1 ) / line ) * line; };
+  Arena arena;
+  for ( auto dn : dns )
+    arena.m_size += 3 * padded( dn->m_n );
+  if ( !arena.m_size )
+    return arena;
+  arena.m_data.reset( static_cast<double*>( largeBufferAlloc( arena.m_size * sizeof(double) ) ) );
+  double * p = arena.m_data.get();
+  for ( auto dn : dns ) {
+    if ( !dn->m_n )
+      continue;
+    const std::size_t n = dn->m_n;
+    const std::size_t np = padded( n );
+    std::copy( dn->m_px, dn->m_px + n, p );
+    std::fill( p + n, p + np, 0.0 );
+    std::copy( dn->m_py, dn->m_py + n, p + np );
+    std::fill( p + np + n, p + 2 * np, 0.0 );
+    std::copy( dn->m_pz, dn->m_pz + n, p + 2 * np );
+    std::fill( p + 2 * np + n, p + 3 * np, 0.0 );
+    dn->m_px = p;
+    dn->m_py = p + np;
+    dn->m_pz = p + 2 * np;
+    VectD().swap( dn->m_x );
+    VectD().swap( dn->m_y );
+    VectD().swap( dn->m_z );
+    p += 3 * np;
+  }
+  return arena;
+}
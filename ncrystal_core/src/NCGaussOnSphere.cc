@@ -155,7 +155,7 @@ namespace NCrystal {
     {
       nc_assert(ncabs(cosx)<1.000001);
       double x = std::acos(ncmin(1.0,ncmax(-1.0,cosx)));
-      return m_norm * std::exp(m_expval*x*x);
+      return m_norm * ncexp(m_expval*x*x);
     }
   };
   class SLTFct_SofCosD : public Fct1D {
@@ -170,7 +170,7 @@ namespace NCrystal {
       nc_assert(ncabs(cosd)<1.000001);
       double d = std::acos(ncmin(1.0,ncmax(-1.0,cosd)));
       double d2 = d*d;
-      return m_k * std::exp(m_expfact*d2) * std::erf(std::sqrt(ncmax(0.0,-m_expfact*(m_tasq-d2))));
+      return m_k * ncexp(m_expfact*d2) * std::erf(std::sqrt(ncmax(0.0,-m_expfact*(m_tasq-d2))));
     }
   };
 
@@ -277,6 +277,10 @@ void NC::GaussOnSphere::set(double sigma, double trunc_angle, double prec ) {
   unsigned nlt = 0;
   m_truncangle=trunc_angle;
   m_sigma=sigma;
+  //The Gaussian envelopes in genPointOnCircle overestimate the density at the
+  //truncation angle by a factor of roughly exp(trunc_angle^4/(24*sigma^2)),
+  //so they are only used where that factor is modest:
+  m_gaussenv = ( trunc_angle*trunc_angle*trunc_angle*trunc_angle < 24.0*sigma*sigma );
   m_prec=prec;
   sincos(trunc_angle,m_cta,m_sta);
   m_expfact = -0.5/(sigma*sigma);
@@ -373,6 +377,47 @@ void NC::GaussOnSphere::set(double sigma, double trunc_angle, double prec ) {
   m_lt_evalcosx.swap(lt_evalcosx);
 }
 
+void NC::GaussOnSphere::circleIntegralMany( std::size_t n, const double * cg, const double * sg,
+                                            double ca, double sa, double * out ) const
+{
+  nc_assert(isValid());
+  nc_assert(ncabs(ca*ca+sa*sa-1.0)<1e-6);
+  constexpr std::size_t chunksize = 64;
+  double cds[chunksize];
+  double fast[chunksize];
+  double sof[chunksize];
+  const double cta = m_cta;
+  const double k1 = m_circleint_k1;
+  const double k2 = m_circleint_k2;
+  for ( std::size_t ichunk = 0; ichunk < n; ichunk += chunksize ) {
+    const std::size_t m = std::min<std::size_t>( chunksize, n - ichunk );
+    const double * cgc = cg + ichunk;
+    const double * sgc = sg + ichunk;
+    double * outc = out + ichunk;
+    //Same conditions and factors as in circleIntegral (the square root is
+    //only used where the approximation applies, which implies sg>0, so sg is
+    //merely protected against division by zero):
+    for ( std::size_t i = 0; i < m; ++i ) {
+      const double sasg = sa*sgc[i];
+      const double cacg = ca*cgc[i];
+      const double cd = cacg+sasg;
+      cds[i] = cd;
+      fast[i] = ( ( cd>cta ) & ( sasg>=1e-14 ) & ( k2 > k1*sasg+cacg ) ) ? 1.0 : 0.0;
+      outc[i] = std::sqrt(sa/( sgc[i] > 1e-300 ? sgc[i] : 1e-300 ));
+    }
+    //Batched lookups (values for the points not using the approximation are
+    //simply ignored, and evalMany clamps them to the table range):
+    m_lt_sofcosd.evalMany( cds, m, sof );
+    for ( std::size_t i = 0; i < m; ++i ) {
+      nc_assert(ncabs(cgc[i]*cgc[i]+sgc[i]*sgc[i]-1.0)<1e-6);
+      if ( fast[i] )
+        outc[i] *= sof[i];
+      else
+        outc[i] = circleIntegralSlow( cgc[i], sgc[i], ca, sa );
+    }
+  }
+}
+
 double NC::GaussOnSphere::circleIntegralSlow( double cg, double sg, double ca, double sa ) const
 {
   const double sasg = sa*sg; nc_assert(sasg>=0.0);
@@ -457,6 +502,23 @@ bool NC::GaussOnSphere::genPointOnCircle( RNG& rng, double cg, double sg, double
   double cos_tmax =  (m_cta-cacg)/sasg;
   if (cos_tmax>=1.0)//vanishing length of circle inside truncation zone
     return false;
+
+  //With s=sin(t/2), the cosine of the angular distance to the Gaussian center
+  //is cos(delta)=cd-2*sasg*s^2. Since delta^2>=2(1-cos(delta)), the density is
+  //bounded by norm*exp(-(1-cos(delta))/sigma^2), which is a Gaussian in s of
+  //width sigma_s=sigma/(2*sqrt(sasg)). Including the Jacobian, dt/ds =
+  //2/sqrt(1-s^2), the density in s is thus bounded by a truncated Gaussian,
+  //which is a tight envelope whenever the circle is much longer than
+  //sigma_s within the truncation zone (as is the case for small
+  //mosaicities). For small mosaicities the acceptance rate is then at least
+  //~0.68*cos(tmax/2)>=0.34, regardless of the mosaicity and of the
+  //geometry. Otherwise (large mosaicities, short circle segments, or segments
+  //extending towards t=pi), the density is sampled with a flat envelope in t
+  //instead:
+  const double smax2 = ( cos_tmax<=-1.0 ? 1.0 : 0.5*(1.0-cos_tmax) );
+  const double sigma_s2 = m_sigma*m_sigma/(4.0*sasg);
+  if ( m_gaussenv && smax2 > sigma_s2 && smax2 <= 0.75 )
+    return genPointOnCircleGaussEnv( rng, cd, sasg, smax2, sigma_s2, ct, st );
   double tmax = ( cos_tmax<=-1.0 ? kPi : std::acos(cos_tmax) );
 
   //The highest contribution is at t=0, at which cos(delta) = cd. Generate t via MC-rejection.
@@ -503,6 +565,69 @@ bool NC::GaussOnSphere::genPointOnCircle( RNG& rng, double cg, double sg, double
   return true;
 }
 
+bool NC::GaussOnSphere::genPointOnCircleGaussEnv( RNG& rng, double cd, double sasg,
+                                                  double smax2, double sigma_s2,
+                                                  double& ct, double& st ) const
+{
+  //See comments in genPointOnCircle. The envelope in s is
+  //  env(s) = norm*exp(-(1-cd)/sigma^2) * exp(-s^2/(2*sigma_s^2)) / sqrt(1-smax^2)
+  //which is sampled as |z|*sigma_s for unit Gaussian z (rejecting s>smax):
+  const double sigma_s = std::sqrt(sigma_s2);
+  const double smax = std::sqrt(smax2);
+  const double cmax = std::sqrt(1.0-smax2);
+  //2*m_expfact=-1/sigma^2. The overlay factor protects against lookup table
+  //values slightly above the exact density:
+  constexpr double overlay = 1.001;
+  const double envnorm = overlay * m_norm * ncexp( 2.0 * m_expfact * ( 1.0 - cd ) );
+  const int maxtriesplus1(1001);//expected number of tries is always below ~3
+  int triesleft = maxtriesplus1;
+  double s = 0.0;
+  while (--triesleft) {
+    s = ncabs( randNorm( rng ) ) * sigma_s;
+    if ( s >= smax )
+      continue;
+    const double z2 = s*s/sigma_s2;
+    const double env = envnorm * ncexp( -0.5*z2 ) / ncmax( cmax, 1e-300 ) * std::sqrt( 1.0 - s*s );
+    //NB: env above is the envelope divided by the Jacobian, so it can be
+    //compared directly with the density in t:
+    const double density = evalCosXInRange( ncmax( m_cta, cd - 2.0*sasg*s*s ) );
+    if ( density > env ) {
+      static bool first = true;
+      if (first) {
+        first = false;
+        std::cout<<"NCrystal WARNING: Problems sampling with rejection method during GaussOnSphere::genPointOnCircle "
+          "invocation. Gaussian envelope was not larger than actual cross-section value at sampled point "
+          "(overshot by factor of "<<density/env<<"). Further warnings of this type will not be emitted."<<std::endl;
+      }
+    }
+    if ( density > env * rng.generate() )
+      break;
+  }
+#ifndef NDEBUG
+  if (m_stats.genpointworst) {
+    ++m_stats.genpointcalled;
+    uint64_t triesused = maxtriesplus1-triesleft;
+    m_stats.genpointtries += triesused;;
+    m_stats.genpointworst = std::max<uint64_t>(m_stats.genpointworst,triesused);
+  }
+#endif
+  if (triesleft<=0) {
+    static bool first = true;
+    if (first) {
+      first = false;
+      std::cout<<"NCrystal WARNING: Problems sampling with rejection method during GaussOnSphere::genPointOnCircle "
+        "invocation. Did not accept sampled value after "<<maxtriesplus1-1<<" attempts. Further warnings"
+        " of this type will not be emitted."<<std::endl;
+    }
+    return false;
+  }
+  //t=2*asin(s), so cos(t)=1-2s^2 and sin(t)=2s*sqrt(1-s^2):
+  ct = 1.0 - 2.0*s*s;
+  st = 2.0*s*std::sqrt(1.0-s*s);
+  st = (rng.coinflip()?st:-st);//pick t in [-pi,pi], not just in [0,pi]
+  return true;
+}
+
 double NC::GaussOnSphere::estimateNTruncFromPrec( double prec, double minval, double maxval )
 {
   nc_assert(minval>0&&maxval>minval&&prec>=0.0);
@@ -0,0 +1,67 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/internal/NCGridIndex.hh"
+
+namespace NC = NCrystal;
+
+NC::GridIndex::GridIndex( const VectD& grid )
+{
+  init( grid );
+}
+
+NC::GridIndex::GridIndex( const std::vector<float>& grid )
+{
+  init( grid );
+}
+
+template<class TVect>
+void NC::GridIndex::init( const TVect& grid )
+{
+  using TValue = typename TVect::value_type;
+  const std::size_t n = grid.size();
+  nc_assert( std::is_sorted( grid.begin(), grid.end() ) );
+  if ( n < 2 || !( grid.front() > 0.0 ) || std::isinf( grid.back() )
+       || n >= std::numeric_limits<uint32_t>::max() )
+    return;//no buckets, fall back to plain std::upper_bound
+
+  //Bit patterns of positive floating point numbers are monotonically
+  //increasing, so the bucket index is as well. Pick the smallest bucket width (a power of two in
+  //key space) which gives at most ~2 buckets per grid point:
+  m_keyMin = key( grid.front() );
+  const std::uint64_t keyRange = key( grid.back() ) - m_keyMin;
+  const std::uint64_t nbuckets_max = std::max<std::uint64_t>( 1, 2 * n );
+  m_shift = 0;
+  while ( ( keyRange >> m_shift ) >= nbuckets_max )
+    ++m_shift;
+  const std::size_t nbuckets = static_cast<std::size_t>( keyRange >> m_shift ) + 1;
+
+  //m_bucketBegin[b] is the number of grid points in buckets below b. Since
+  //bucketIdx is monotonic, the upper_bound (and lower_bound) of any x in bucket b is then in
+  //[m_bucketBegin[b],m_bucketBegin[b+1]]:
+  m_bucketBegin.resize( nbuckets + 1 );
+  std::size_t i = 0;
+  for ( std::size_t b = 0; b <= nbuckets; ++b ) {
+    while ( i < n && bucketIdx<TValue>( grid[i] ) < b )
+      ++i;
+    m_bucketBegin[b] = static_cast<uint32_t>( i );
+  }
+  nc_assert_always( m_bucketBegin.back() == n );
+}
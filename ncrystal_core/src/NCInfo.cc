@@ -20,12 +20,27 @@
 
 #include "NCrystal/NCInfo.hh"
 #include "NCrystal/internal/NCMath.hh"
+#include "NCrystal/internal/NCContentPool.hh"
+#include <unordered_map>
 namespace NC=NCrystal;
 
 namespace NCrystal {
   static_assert(std::is_nothrow_move_constructible<AtomInfo>::value,"");
 }
 
+struct NC::Info::Data::HKLIndex {
+  struct Hash {
+    std::size_t operator()( const HKL& hkl ) const noexcept
+    {
+      HashValue hv = calcHash( hkl.h );
+      hash_combine( hv, hkl.k );
+      hash_combine( hv, hkl.l );
+      return hv;
+    }
+  };
+  std::unordered_map<HKL,std::size_t,Hash> idx;
+};
+
 //TODO: why not always provide eqv_hkl from .ncmat factories and remove
 //demi_normals from the interface? The memory usage is 4 times lower and the
 //added initialisation time is likely negligible.
@@ -156,6 +171,47 @@ void NC::Info::singlePhaseOnlyRaiseError(const char*fctname) const
 }
 
 
+std::size_t NC::Info::memoryFootprint() const
+{
+  std::size_t res = sizeof(Info) + sizeof(Data);
+  if ( isMultiPhase() ) {
+    for ( auto& ph : getPhases() )
+      res += sizeof(Phase) + ph.second->memoryFootprint();
+    return res;
+  }
+  const Data& d = *m_data;
+  if ( !d.detail_hkllist_needs_init.load() && d.detail_hklList != nullptr ) {
+    //NB: Lists shared with other Info objects are counted for each of them:
+    for ( auto& hi : *d.detail_hklList ) {
+      res += sizeof(HKLInfo);
+      if ( hi.explicitValues ) {
+        auto& evl = hi.explicitValues->list;
+        res += sizeof(HKLInfo::ExplicitVals);
+        if ( evl.has_value<std::vector<HKL>>() )
+          res += evl.get<std::vector<HKL>>().size() * sizeof(HKL);
+        if ( evl.has_value<std::vector<HKLInfo::Normal>>() )
+          res += evl.get<std::vector<HKLInfo::Normal>>().size() * sizeof(HKLInfo::Normal);
+      }
+    }
+  }
+  if ( !d.detail_flatcomp_needs_init.load() )
+    res += d.detail_flatComposition.size() * sizeof(FlatCompositionEntry);
+  if ( !d.detail_hklindex_needs_init.load() && d.detail_hklIndex != nullptr )
+    res += d.detail_hklIndex->idx.size() * ( sizeof(HKL) + sizeof(std::size_t) + 2 * sizeof(void*) );//rough estimate
+  for ( auto& ai : d.atomlist )
+    res += sizeof(AtomInfo) + ai.unitCellPositions().size() * sizeof(AtomInfo::Pos);
+  res += d.dyninfolist.size() * ( sizeof(DynamicInfo) + 64 );//rough estimate
+  for ( auto& c : d.custom ) {
+    res += c.first.size();
+    for ( auto& line : c.second )
+      for ( auto& word : line )
+        res += sizeof(std::string) + word.size();
+  }
+  for ( auto& lbl : d.displayLabels )
+    res += sizeof(std::string) + lbl.size();
+  return res;
+}
+
 void NC::AtomInfo::detail_setupLink( DynamicInfo* di )
 {
   nc_assert_always(di!=nullptr);
@@ -219,25 +275,81 @@ void NC::Info::Data::doInitHKLList() const
 {
   nc_assert(hkl_dlower_and_dupper.has_value());
   nc_assert(hkl_ondemand_fct!=nullptr);
-  //Do actual work (time consuming)
-  auto res = hkl_ondemand_fct(hkl_dlower_and_dupper.value());
-  //Now we must register the result - unless someone else beat us too it (using
-  //global mtx is OK for the few instructions below):
-  static std::mutex s_mtx;
-  NCRYSTAL_LOCK_GUARD(s_mtx);
+  //Hold the lock of this object while doing the actual (time consuming) work,
+  //so concurrent first accesses wait for the result rather than repeating
+  //the calculation:
+  NCRYSTAL_LOCK_GUARD(detail_hkllist_mtx);
   if (!detail_hkllist_needs_init.load())
-    return;//someone beat us to it - return (discarding our own result)
-  detail_hklList = std::move(res);
+    return;//someone beat us to it
+  auto res = hkl_ondemand_fct(hkl_dlower_and_dupper.value());
+  detail_hklList = internHKLList( std::move(res) );
 
   //Take this chance to update Bragg threshold / HKLInfoType fields:
-  double bt = detail_hklList.empty() ? 0.0 : detail_hklList.front().dspacing * 2.0;
-  auto tp = enumAsInt(detail_hklList.empty() ? HKLInfoType::Minimal : detail_hklList.front().type() );
+  const HKLList& hkllist = *detail_hklList;
+  double bt = hkllist.empty() ? 0.0 : hkllist.front().dspacing * 2.0;
+  auto tp = enumAsInt(hkllist.empty() ? HKLInfoType::Minimal : hkllist.front().type() );
   atomic_setValueIfHasValue( detail_braggthreshold, bt, -1.0 );
   atomic_setValueIfHasValue( detail_hklInfoType, tp, hKLInfoTypeInt_unsetval );
 
   detail_hkllist_needs_init = false;
 }
 
+namespace NCrystal {
+  namespace {
+    struct HKLListEqual {
+      template<class TVect>
+      static bool explicitListEqual( const HKLInfo::ExplicitVals& a, const HKLInfo::ExplicitVals& b )
+      {
+        if ( a.list.has_value<TVect>() != b.list.has_value<TVect>() )
+          return false;
+        return !a.list.has_value<TVect>() || a.list.get<TVect>() == b.list.get<TVect>();
+      }
+      bool operator()( const HKLList& a, const HKLList& b ) const
+      {
+        if ( a.size() != b.size() )
+          return false;
+        for ( auto i : ncrange( a.size() ) ) {
+          const HKLInfo& ha = a[i];
+          const HKLInfo& hb = b[i];
+          if ( ha.dspacing != hb.dspacing || ha.fsquared != hb.fsquared
+               || ha.multiplicity != hb.multiplicity || !( ha.hkl == hb.hkl )
+               || bool(ha.explicitValues) != bool(hb.explicitValues) )
+            return false;
+          if ( ha.explicitValues ) {
+            if ( !explicitListEqual<std::vector<HKL>>( *ha.explicitValues, *hb.explicitValues )
+                 || !explicitListEqual<std::vector<HKLInfo::Normal>>( *ha.explicitValues, *hb.explicitValues ) )
+              return false;
+          }
+        }
+        return true;
+      }
+    };
+
+    HashValue hashHKLList( const HKLList& hkllist )
+    {
+      //Explicit values are left out (they are anyway rarely what makes lists
+      //differ), leaving only a cheap pass over the main fields:
+      HashValue h = calcHash( hkllist.size() );
+      for ( auto& hi : hkllist ) {
+        hash_combine( h, hi.dspacing );
+        hash_combine( h, hi.fsquared );
+        hash_combine( h, hi.multiplicity );
+        hash_combine( h, hi.hkl.h );
+        hash_combine( h, hi.hkl.k );
+        hash_combine( h, hi.hkl.l );
+      }
+      return h;
+    }
+  }
+}
+
+std::shared_ptr<const NC::HKLList> NC::Info::Data::internHKLList( HKLList&& hkllist )
+{
+  static ContentPool<HKLList,HKLListEqual> s_pool;
+  const HashValue h = hashHKLList( hkllist );
+  return s_pool.intern( std::move(hkllist), h );
+}
+
 NC::HKLInfoType NC::Info::hklInfoType() const
 {
   singlePhaseOnly(__func__);
@@ -341,3 +453,71 @@ double NC::Info::dspacingFromHKL( int h, int k, int l ) const
   return ::NC::dspacingFromHKL( h,k,l, rec_lat );
 }
 
+void NC::Info::dspacingFromHKL( const HKL* hkls, std::size_t n, double* out_dspacings ) const
+{
+  singlePhaseOnly(__func__);
+  if (!hasStructureInfo())
+    NCRYSTAL_THROW(MissingInfo,"Info object lacks Structure information.");
+  const StructureInfo & si = getStructureInfo();
+  RotMatrix rec_lat = getReciprocalLatticeRot( si.lattice_a, si.lattice_b, si.lattice_c,
+                                               si.alpha*kDeg, si.beta*kDeg, si.gamma*kDeg );
+  for ( std::size_t i = 0; i < n; ++i )
+    out_dspacings[i] = ::NC::dspacingFromHKL( hkls[i].h, hkls[i].k, hkls[i].l, rec_lat );
+}
+
+#include "NCrystal/NCCompositionUtils.hh"//Needed for flattenComposition
+void NC::Info::Data::doInitFlatComposition() const
+{
+  NCRYSTAL_LOCK_GUARD(detail_flatcomp_mtx);
+  if (!detail_flatcomp_needs_init.load())
+    return;//someone beat us to it
+  detail_flatComposition = CompositionUtils::flattenComposition( composition );
+  detail_flatcomp_needs_init = false;
+}
+
+#include "NCrystal/internal/NCPlaneProvider.hh"//Needed for ExpandHKLHelper
+
+void NC::Info::Data::doInitHKLIndex() const
+{
+  const HKLList& hkllist = hklList();
+  NCRYSTAL_LOCK_GUARD(detail_hklindex_mtx);
+  if (!detail_hklindex_needs_init.load())
+    return;//someone beat us to it
+  auto res = std::make_shared<HKLIndex>();
+  const unsigned sg = structinfo.has_value() ? structinfo.value().spacegroup : 0;
+  ExpandHKLHelper expandhelper( static_cast<int>( sg ) );
+  const bool canExpand = !hkllist.empty() && expandhelper.canExpand( hkllist.front().type() );
+  auto add = [&res]( const HKL& hkl, std::size_t i )
+  {
+    //NB: emplace keeps existing entries, so the first one wins in case of
+    //duplicates:
+    res->idx.emplace( hkl, i );
+    res->idx.emplace( hkl.flipped(), i );
+  };
+  for ( auto i : ncrange( hkllist.size() ) ) {
+    const HKLInfo& hi = hkllist[i];
+    if ( canExpand ) {
+      for ( auto& hkl : expandhelper.expand( hi ) )
+        add( hkl, i );
+    } else {
+      add( hi.hkl, i );
+    }
+  }
+  detail_hklIndex = std::move(res);
+  detail_hklindex_needs_init = false;
+}
+
+const NC::HKLInfo* NC::Info::findHKL( const HKL& hkl ) const
+{
+  singlePhaseOnly(__func__);
+  if ( !hasHKLInfo() )
+    return nullptr;
+  const Data& d = *m_data;
+  if ( d.detail_hklindex_needs_init.load() )
+    d.doInitHKLIndex();
+  nc_assert( d.detail_hklIndex != nullptr );
+  auto& idx = d.detail_hklIndex->idx;
+  auto it = idx.find( hkl );
+  return it == idx.end() ? nullptr : &d.hklList()[it->second];
+}
+
@@ -22,6 +22,7 @@
 #include "NCrystal/internal/NCLatticeUtils.hh"
 #include "NCrystal/internal/NCMath.hh"
 #include "NCrystal/internal/NCString.hh"
+#include "NCrystal/internal/NCFactoryUtils.hh"
 #include "NCrystal/internal/NCIter.hh"
 #include "NCrystal/internal/NCCfgManip.hh"
 
@@ -794,9 +795,10 @@ namespace NCrystal {
           if ( hkl.source.has_value<HKLList>() ) {
             //List is provided directly:
             out.detail_hkllist_needs_init = false;
-            out.detail_hklList = std::move( hkl.source.get<HKLList>() );
-            out.detail_braggthreshold = ( out.detail_hklList.empty() ? 0.0 : out.detail_hklList.front().dspacing * 2.0 );
-            out.detail_hklInfoType = enumAsInt( out.detail_hklList.empty()  ? HKLInfoType::Minimal : out.detail_hklList.front().type() );
+            out.detail_hklList = Info::Data::internHKLList( std::move( hkl.source.get<HKLList>() ) );
+            const HKLList& hkllist = *out.detail_hklList;
+            out.detail_braggthreshold = ( hkllist.empty() ? 0.0 : hkllist.front().dspacing * 2.0 );
+            out.detail_hklInfoType = enumAsInt( hkllist.empty()  ? HKLInfoType::Minimal : hkllist.front().type() );
           } else {
             //Delayed init via generator function. We wrap the genfct call to
             //take care of StructureInfo/AtomInfoList arguments + make sure we
@@ -989,6 +991,7 @@ NC::InfoPtr NC::InfoBuilder::buildInfoPtr( InfoPtr orig, NumberDensity numberDen
 
 NC::Info NC::InfoBuilder::buildInfo( SinglePhaseBuilder&& input )
 {
+  InitProfileScope profileScope( "InfoBuilder::buildInfo" );
   InfoBuilder::detail::validateAndCompleteSinglePhaseInput(input);
   auto dataptr = makeSO<Info::Data>();
   Info::Data& data = *dataptr;
@@ -999,6 +1002,7 @@ NC::Info NC::InfoBuilder::buildInfo( SinglePhaseBuilder&& input )
 
 NC::Info NC::InfoBuilder::buildInfo( MultiPhaseBuilder&& input )
 {
+  InitProfileScope profileScope( "InfoBuilder::buildInfo", [](){ return std::string("multiphase"); } );
   //NB: Apart from recognising that all phases are the same, we do not in
   //general merge identical phases in the input.phases list. This is because it
   //could potentially screw up with SANS physics.
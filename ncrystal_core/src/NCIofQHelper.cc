@@ -35,6 +35,62 @@ NC::IofQHelper::IofQHelper( internal_t data )
     m_ekinMax( NeutronEnergy{ ksq2ekin( ncsquare( 0.5 * m_pwdist.getXVals().back() ) ) } ),
     m_normFact(data.normFact)
 {
+  initGuideTables();
+}
+
+void NC::IofQHelper::initGuideTables()
+{
+  const VectD& x = m_pwdist.getXVals();
+  nc_assert_always( x.size() >= 2 && x.size() < std::numeric_limits<unsigned>::max() );
+  const unsigned nbins = static_cast<unsigned>( x.size() - 1 );
+  const unsigned ncells = nbins;
+  auto binIdx = [nbins]( std::ptrdiff_t i )
+  {
+    return static_cast<unsigned>( std::min<std::ptrdiff_t>( std::max<std::ptrdiff_t>( i, 0 ), nbins - 1 ) );
+  };
+  //Q guide: bin containing the lower edge of each cell (last entry is for
+  //the upper edge of the last cell):
+  m_qGuideScale = ncells / x.back();
+  m_qGuide.resize( ncells + 1 );
+  for ( unsigned c = 0; c <= ncells; ++c ) {
+    auto it = std::upper_bound( x.begin(), x.end(), c / m_qGuideScale );
+    m_qGuide[c] = binIdx( std::distance( x.begin(), it ) - 1 );
+  }
+}
+
+double NC::IofQHelper::commulIntegral( double q ) const
+{
+  //Same as m_pwdist.commulIntegral(q), but using the guide table to find the
+  //bin:
+  const VectD& xv = m_pwdist.getXVals();
+  if ( q <= xv.front() )
+    return 0.0;
+  if ( q >= xv.back() )
+    return 1.0;
+  const double * x = xv.data();
+  const std::size_t ncells = m_qGuide.size() - 1;
+  const std::size_t c = std::min<std::size_t>( static_cast<std::size_t>( q * m_qGuideScale ), ncells - 1 );
+  std::size_t lo = m_qGuide[c];
+  while ( lo > 0 && x[lo] > q )
+    --lo;//guard against rounding in q*m_qGuideScale
+  const std::size_t hi = m_qGuide[c+1];
+  const std::size_t i0 = std::distance( x, std::upper_bound( x + lo, x + hi + 1, q ) ) - 1;
+  nc_assert( i0 + 1 < xv.size() && x[i0] <= q && q < x[i0+1] );
+
+  //Find contribution in this bin as as
+  //<length in bin>*<average height in bin over used part>:
+  const VectD& yv = m_pwdist.getYVals();
+  const double x1 = x[i0];
+  const double y1 = yv[i0];
+  const double x2 = x[i0+1];
+  const double y2 = yv[i0+1];
+  nc_assert( x2 - x1 > 0.0 );
+  const double dx = q-x1;
+  const double slope = ( y2-y1 ) / (x2-x1);
+  const double last_bin_contrib = dx * ( y1 + 0.5 * dx * slope );
+
+  //Combine with preceding bins from the CDF:
+  return m_pwdist.getCDF()[i0] + last_bin_contrib;
 }
 
 NC::IofQHelper::IofQHelper( const VectD& Q, const VectD& IofQ )
@@ -57,3 +57,41 @@ NC::PairDD NC::convertAlphaBetaToDeltaEMu(double alpha, double beta, NeutronEner
   mu = ncclamp(mu,-1.0, 1.0);
   return std::make_pair( delta_e, mu );
 }
+
+void NC::getAlphaLimitsMany( double ekin_div_kT, const double* beta, std::size_t n,
+                             double* out_alow, double* out_aupp )
+{
+  nc_assert(ekin_div_kT >= 0.0);
+  for ( std::size_t i = 0; i < n; ++i ) {
+    nc_assert(!ncisnan(beta[i]));
+    const double kk = ekin_div_kT + beta[i];
+    const bool forbidden = !(kk >= 0.0);
+    const double a = kk + ekin_div_kT;
+    double b = std::sqrt( ekin_div_kT * ncmax( 0.0, kk ) );
+    b += b;
+    out_alow[i] = forbidden ? 1.0 : ncmax(0.0,a - b);
+    out_aupp[i] = forbidden ? -1.0 : a + b;
+  }
+}
+
+void NC::convertAlphaBetaToDeltaEMuMany( const double* alpha, const double* beta, const double* ekin,
+                                         std::size_t n, double kT, double* out_deltae, double* out_mu )
+{
+  nc_assert( kT > 0.0 );
+  bool anyInvalid = false;
+  for ( std::size_t i = 0; i < n; ++i ) {
+    nc_assert( ekin[i] >= 0.0 );
+    nc_assert( alpha[i] >= 0.0 );
+    nc_assert( beta[i]*kT >= -ekin[i] );
+    const double delta_e = beta[i] * kT;
+    const double ekinfinal = ekin[i] + delta_e;
+    const double denom = 2.0*std::sqrt(ekin[i] * ekinfinal);
+    anyInvalid |= !denom;
+    const double mu = ( ekin[i] + ekinfinal - alpha[i]*kT ) / denom;
+    nc_assert( !denom || ncabs(mu)<1.001 );
+    out_deltae[i] = delta_e;
+    out_mu[i] = ncclamp(mu,-1.0, 1.0);
+  }
+  if ( anyInvalid )
+    NCRYSTAL_THROW(CalcError,"convertAlphaBetaToDeltaEMuMany invalid for beta=-E/kT (calling code should revert to flat alpha/mu distribution near that limit)");
+}
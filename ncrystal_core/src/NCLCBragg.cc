@@ -27,6 +27,8 @@
 #include "NCrystal/internal/NCLatticeUtils.hh"
 #include "NCrystal/internal/NCOrientUtils.hh"
 #include "NCrystal/internal/NCPlaneProvider.hh"
+#include "NCrystal/internal/NCRuntimeCounters.hh"
+#include "NCrystal/NCFact.hh"
 
 namespace NC = NCrystal;
 
@@ -36,7 +38,7 @@ namespace NCrystal{
 
     pimpl(LCBragg * lcbragg, LCAxis lcaxis, int mode,
           SCOrientation sco, const Info& cinfo, PlaneProvider * plane_provider,
-          MosaicityFWHM mosaicity, double delta_d, double prec,double ntrunc)
+          MosaicityFWHM mosaicity, double delta_d, double prec,double ntrunc, double screening)
       : m_ekin_low(-1)
     {
       nc_assert_always(lcbragg);
@@ -49,8 +51,8 @@ namespace NCrystal{
       RotMatrix cry2lab = getCrystal2LabRot( sco, reci_lattice );
       LCAxis lcaxis_labframe = (cry2lab * lcaxis.as<Vector>()).unit().as<LCAxis>();
 
-      if (mode==0) {
-        nc_assert_always(delta_d==0);//mode=0 does not currently support delta_d!=0
+      if (mode==0||mode==xsTableMode) {
+        nc_assert_always(delta_d==0);//mode=0,xsTableMode does not currently support delta_d!=0
 
         std::unique_ptr<PlaneProvider> stdpp;
         if (!plane_provider) {
@@ -63,12 +65,17 @@ namespace NCrystal{
                                                  mosaicity,
                                                  si.volume * si.n_atoms,
                                                  plane_provider,
-                                                 prec, ntrunc);
+                                                 prec, ntrunc, screening);
 
         m_ekin_low = wl2ekin( m_lchelper->braggThreshold() );
 
+        if (mode==xsTableMode) {
+          m_lcaxislab = lcaxis_labframe.as<Vector>().unit();
+          m_xstable = std::make_unique<LCXSTable>( *m_lchelper, prec );
+        }
+
       } else {
-        auto scbragg = makeSO<SCBragg>(cinfo,sco,mosaicity,delta_d,plane_provider,prec, ntrunc);
+        auto scbragg = makeSO<SCBragg>(cinfo,sco,mosaicity,delta_d,plane_provider,prec, ntrunc, screening);
         if (mode>0) {
           m_scmodel = std::make_shared<LCBraggRef>(scbragg, lcaxis_labframe, mode);
         } else {
@@ -87,6 +94,8 @@ namespace NCrystal{
 
     double m_ekin_low;
     std::unique_ptr<LCHelper> m_lchelper;
+    std::unique_ptr<LCXSTable> m_xstable;//xsTableMode only (NB: declared after m_lchelper, which it refers to)
+    Vector m_lcaxislab;
     ProcImpl::OptionalProcPtr m_scmodel;
   };
 
@@ -94,8 +103,8 @@ namespace NCrystal{
 
 NC::LCBragg::LCBragg( const Info& ci, const SCOrientation& sco, MosaicityFWHM mosaicity,
                       const LCAxis& lcaxis, int mode, double delta_d, PlaneProvider * plane_provider,
-                      double prec, double ntrunc)
-  : m_pimpl(std::make_unique<pimpl>(this,lcaxis,mode,sco,ci,plane_provider,mosaicity,delta_d,prec,ntrunc))
+                      double prec, double ntrunc, double screening)
+  : m_pimpl(std::make_unique<pimpl>(this,lcaxis,mode,sco,ci,plane_provider,mosaicity,delta_d,prec,ntrunc,screening))
 {
   nc_assert_always(bool(m_pimpl->m_lchelper)!=bool(m_pimpl->m_scmodel!=nullptr));
 }
@@ -107,8 +116,24 @@ NC::EnergyDomain NC::LCBragg::domain() const noexcept
   return { NeutronEnergy{m_pimpl->m_ekin_low}, NeutronEnergy{kInfinity} };
 }
 
+std::size_t NC::LCBragg::memoryFootprint() const
+{
+  return sizeof(LCBragg) + sizeof(pimpl)
+    + ( m_pimpl->m_lchelper ? m_pimpl->m_lchelper->memoryFootprint() : 0 )
+    + ( m_pimpl->m_xstable ? m_pimpl->m_xstable->memoryFootprint() : 0 )
+    + ( m_pimpl->m_scmodel ? m_pimpl->m_scmodel->memoryFootprint() : 0 );
+}
+
+void NC::LCBragg::warmup( EnergyDomain edom, WarmupLevel level ) const
+{
+  if ( m_pimpl->m_xstable && edom.elow.dbl() < wl2ekin( m_pimpl->m_xstable->wavelengthMax() ) )
+    m_pimpl->m_xstable->buildRows( getNumberOfThreads() );
+  ProcImpl::ScatterAnisotropicMat::warmup( edom, level );
+}
+
 NC::CrossSect NC::LCBragg::crossSection(NC::CachePtr& cp, NC::NeutronEnergy ekin, const NC::NeutronDirection& indir ) const
 {
+  NCRYSTAL_RTCOUNTER_SCOPE(*this,XSCalls);
   if ( ekin.get() < m_pimpl->m_ekin_low )
     return CrossSect{ 0.0 };
 
@@ -117,6 +142,9 @@ NC::CrossSect NC::LCBragg::crossSection(NC::CachePtr& cp, NC::NeutronEnergy ekin
     if (!(wl.get()>0.0))
       return CrossSect{ 0.0 };
     const Vector& indirv = indir.as<Vector>().unit();
+    if ( m_pimpl->m_xstable )
+      return CrossSect{ m_pimpl->m_xstable->crossSection( accessCache<LCHelper::Cache>(cp), wl.get(),
+                                                          m_pimpl->m_lcaxislab.dot(indirv) ) };
     return CrossSect{ m_pimpl->m_lchelper->crossSection( accessCache<LCHelper::Cache>(cp), wl.get(), indirv ) };
   } else {
     return CrossSect{ m_pimpl->m_scmodel->crossSection( cp, ekin, indir ) };
@@ -125,6 +153,7 @@ NC::CrossSect NC::LCBragg::crossSection(NC::CachePtr& cp, NC::NeutronEnergy ekin
 
 NC::ScatterOutcome NC::LCBragg::sampleScatter(NC::CachePtr& cp, NC::RNG& rng, NC::NeutronEnergy ekin, const NC::NeutronDirection& indir ) const
 {
+  NCRYSTAL_RTCOUNTER_SCOPE(*this,SampleCalls);
   if ( ekin.get() < m_pimpl->m_ekin_low )
     return { ekin, indir };
 
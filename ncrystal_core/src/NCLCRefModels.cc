@@ -43,12 +43,13 @@ NC::CrossSect NC::LCBraggRef::crossSection(CachePtr& cp, NeutronEnergy ekin, con
   const Vector indir = indir_nd.as<Vector>().unit();
   const Vector lccross = m_lcaxislab.cross(indir);
   const double lcdot = m_lcaxislab.dot(indir);
+  auto& sc_cp = accessCache<Cache>(cp).sc_cacheptr;
   StableSum sumxs;
   double dphi = k2Pi / m_nsampleprime;
   for (unsigned i = 0; i<m_nsampleprime; ++i) {
     const PhiRot phirot( i * dphi - kPi );
     auto ndir = phirot.rotateVectorAroundAxis( indir, m_lcaxislab, lccross, lcdot ).as<NeutronDirection>();
-    sumxs.add(m_sc->crossSection(cp,ekin,ndir).get());
+    sumxs.add(m_sc->crossSection(sc_cp,ekin,ndir).get());
   }
   return CrossSect{ sumxs.sum()/m_nsampleprime };
 }
@@ -59,20 +60,21 @@ NC::ScatterOutcome NC::LCBraggRef::sampleScatter(CachePtr& cp, RNG& rng, Neutron
   const Vector lccross = m_lcaxislab.cross(indir);
   const double lcdot = m_lcaxislab.dot(indir);
 
-  VectD xs;
-  std::vector<PhiRot> pr;
-  xs.reserve(m_nsample);
-  pr.reserve(m_nsample);
+  //Temporary buffers are taken from the scratch arena of the cache, so no
+  //heap allocations are needed in the steady state:
+  auto& cache = accessCache<Cache>(cp);
+  ScratchArena::Scope scratchScope( cache.scratch );
+  double * xs = cache.scratch.allocate<double>( m_nsample );
+  double * cosphis = cache.scratch.allocate<double>( m_nsample );
+  double * sinphis = cache.scratch.allocate<double>( m_nsample );
 
   double sumxs = 0.0;
 
   //Get cross-sections at nsample random phi rotations:
   for (unsigned i = 0; i<m_nsample; ++i) {
-    double cosphi,sinphi;
-    std::tie(cosphi,sinphi) = randPointOnUnitCircle( rng );
-    pr.emplace_back(cosphi,sinphi);
-    auto ndir = pr.back().rotateVectorAroundAxis( indir, m_lcaxislab, lccross, lcdot ).as<NeutronDirection>();
-    xs.push_back( sumxs += m_sc->crossSection(cp,ekin,ndir).get() );
+    std::tie(cosphis[i],sinphis[i]) = randPointOnUnitCircle( rng );
+    auto ndir = PhiRot(cosphis[i],sinphis[i]).rotateVectorAroundAxis( indir, m_lcaxislab, lccross, lcdot ).as<NeutronDirection>();
+    xs[i] = ( sumxs += m_sc->crossSection(cache.sc_cacheptr,ekin,ndir).get() );
   }
 
   if (!sumxs) {
@@ -80,11 +82,13 @@ NC::ScatterOutcome NC::LCBraggRef::sampleScatter(CachePtr& cp, RNG& rng, Neutron
     return { ekin, indir_nd };
   }
   //Select one phi rotation at random:
-  const PhiRot& phirot = pr.at(pickRandIdxByWeight(rng,xs));
+  const std::size_t idx = pickRandIdxByWeight( rng, Span<const double>( xs, xs + m_nsample ) );
+  nc_assert_always( idx < m_nsample );
+  const PhiRot phirot( cosphis[idx], sinphis[idx] );
 
   //Scatter!
   auto ndir = phirot.rotateVectorAroundAxis( indir, m_lcaxislab, lccross, lcdot ).as<NeutronDirection>();
-  auto scatoutcome = m_sc->sampleScatter( cp, rng, ekin, ndir );
+  auto scatoutcome = m_sc->sampleScatter( cache.sc_cacheptr, rng, ekin, ndir );
   auto outdir = phirot.rotateVectorAroundAxis( scatoutcome.direction.as<Vector>(),
                                                m_lcaxislab, true/*reverse*/).as<NeutronDirection>();
   return { ekin, outdir };
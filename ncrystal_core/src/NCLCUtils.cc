@@ -22,9 +22,12 @@
 #include "NCrystal/internal/NCLCUtils.hh"
 #include "NCrystal/internal/NCPlaneProvider.hh"
 #include "NCrystal/internal/NCGaussMos.hh"
-#include "NCrystal/internal/NCRomberg.hh"
+#include "NCrystal/internal/NCGaussKronrod.hh"
 #include "NCrystal/internal/NCRandUtils.hh"
 #include "NCrystal/internal/NCRotMatrix.hh"
+#include "NCrystal/internal/NCString.hh"
+#include "NCrystal/internal/NCRuntimeCounters.hh"
+#include "NCrystal/internal/NCThreadUtils.hh"
 #include <iostream>
 #include <functional>//std::greater
 
@@ -52,18 +55,136 @@ namespace NCrystal {
     return dvalue * ( 1.0 / NCRYSTAL_LCUTILS_DISCRFACT );
   }
   typedef std::pair<uint64_t,uint64_t> LCInitKey;//discretised (dspacing,alpha)
-  typedef std::map<LCInitKey,LCPlaneSet,std::greater<LCInitKey> > LCInitMap;
+  typedef std::map<LCInitKey,LCPlaneSet,std::greater<LCInitKey>,
+                   MemPoolAllocator<std::pair<const LCInitKey,LCPlaneSet>> > LCInitMap;
 }
 
+struct NC::LCHelper::SharedEntry : private NC::MoveOnly {
+  //Immutable cache contents for a given signature, except for the overlays
+  //which are filled on demand (first writer wins):
+  std::pair<uint64_t,uint64_t> signature;
+  std::vector<LCROI> roilist;
+  VectD roixs_commul;
+  std::unique_ptr<std::atomic<float*>[]> overlays;
+  ~SharedEntry()
+  {
+    if ( overlays ) {
+      for ( auto i : ncrange( roilist.size() ) )
+        delete[] overlays[i].load();
+    }
+  }
+};
+
+class NC::LCHelper::SharedTable : private NC::MoveOnly {
+public:
+  //Open addressing hash table with a fixed number of slots, into which
+  //entries can be inserted concurrently (but never removed, until the table
+  //is destroyed together with the LCHelper). In order to avoid filling the
+  //table with entries which will never be reused (e.g. in the common case of
+  //continuous neutron spectra), callers should only insert entries for
+  //signatures for which seenBefore() returns true.
+
+  SharedTable()
+  {
+    for ( auto& e : m_slots )
+      e.store( nullptr, std::memory_order_relaxed );
+    for ( auto& e : m_seen )
+      e.store( 0, std::memory_order_relaxed );
+  }
+
+  ~SharedTable()
+  {
+    for ( auto& e : m_slots )
+      delete e.load();
+  }
+
+  const SharedEntry * find( const std::pair<uint64_t,uint64_t>& sig ) const
+  {
+    const std::size_t h = hash( sig );
+    for ( std::size_t i = 0; i < maxprobe; ++i ) {
+      const SharedEntry * e = m_slots[ ( h + i ) % nslots ].load( std::memory_order_acquire );
+      if ( !e )
+        return nullptr;
+      if ( e->signature == sig )
+        return e;
+    }
+    return nullptr;
+  }
+
+  //Returns the entry in the table, which might have been inserted
+  //concurrently by another thread (in which case entry is left untouched). If
+  //the table is full, nullptr is returned (and entry is also left untouched):
+  const SharedEntry * insert( std::unique_ptr<SharedEntry>& entry )
+  {
+    nc_assert( entry );
+    const std::size_t h = hash( entry->signature );
+    for ( std::size_t i = 0; i < maxprobe; ++i ) {
+      auto& slot = m_slots[ ( h + i ) % nslots ];
+      SharedEntry * expected = nullptr;
+      if ( slot.compare_exchange_strong( expected, entry.get(), std::memory_order_acq_rel ) )
+        return entry.release();
+      if ( expected->signature == entry->signature )
+        return expected;
+    }
+    return nullptr;
+  }
+
+  //Records the signature, and returns whether it was (probably) recorded
+  //before:
+  bool seenBefore( const std::pair<uint64_t,uint64_t>& sig )
+  {
+    const std::size_t h = hash( sig );
+    const uint64_t tag = ( uint64_t(h) | 1 );//never 0
+    return m_seen[ h % nseen ].exchange( tag, std::memory_order_relaxed ) == tag;
+  }
+
+  std::size_t memoryFootprint() const
+  {
+    std::size_t res = sizeof(SharedTable);
+    for ( auto& slot : m_slots ) {
+      const SharedEntry * e = slot.load( std::memory_order_acquire );
+      if ( !e )
+        continue;
+      res += sizeof(SharedEntry) + e->roilist.capacity() * sizeof(LCROI)
+        + e->roixs_commul.capacity() * sizeof(double);
+      if ( e->overlays ) {
+        for ( auto i : ncrange( e->roilist.size() ) ) {
+          res += sizeof(std::atomic<float*>);
+          if ( e->overlays[i].load( std::memory_order_acquire ) )
+            res += Overlay::ndata * sizeof(float);
+        }
+      }
+    }
+    return res;
+  }
+
+private:
+  static constexpr std::size_t nslots = 1024;
+  static constexpr std::size_t nseen = 4096;
+  static constexpr std::size_t maxprobe = 16;
+  std::atomic<SharedEntry*> m_slots[nslots];
+  std::atomic<uint64_t> m_seen[nseen];
+  static std::size_t hash( const std::pair<uint64_t,uint64_t>& sig )
+  {
+    uint64_t h = sig.first * 0x9E3779B97F4A7C15ull;
+    h ^= ( sig.second + 0x7F4A7C159E3779B9ull + ( h << 6 ) + ( h >> 2 ) );
+    h ^= ( h >> 29 );
+    return static_cast<std::size_t>( h * 0xBF58476D1CE4E5B9ull >> 16 );
+  }
+};
+
+NC::LCHelper::~LCHelper() = default;
+
 NC::LCHelper::LCHelper( NC::LCAxis lcaxis,
                         NC::LCAxis lcaxis_labframe,
                         MosaicityFWHM mosaicity_fwhm,
                         double unitcell_volume_times_natoms,
                         PlaneProvider* pp,
                         double prec,
-                        double ntrunc )
+                        double ntrunc,
+                        double screening )
   : m_lcaxislab(lcaxis_labframe.as<Vector>().unit()),
-    m_lcstdframe(mosaicity_fwhm,prec,ntrunc),
+    m_lcstdframe(mosaicity_fwhm,prec,ntrunc,screening),
     m_xsfact( 1.0 / unitcell_volume_times_natoms )
 {
   nc_assert(pp);
@@ -75,7 +196,8 @@ NC::LCHelper::LCHelper( NC::LCAxis lcaxis,
 
   //Collect planes into temporary map, in order to merge those with similar
   //(angle2lcaxis,dspacing) values:
-  LCInitMap initmap;
+  MemPool pool;
+  LCInitMap initmap{ MemPoolAllocator<void>(&pool) };
   pp->prepareLoop();
   {
     Optional<PlaneProvider::Plane> opt_plane;
@@ -128,6 +250,9 @@ NC::LCHelper::LCHelper( NC::LCAxis lcaxis,
   LCInitMap::iterator it(initmap.begin()),itE(initmap.end());
   for (;it!=itE;++it)
     m_planes.push_back(it->second);
+
+  if ( !ncgetenv_bool("LCHELPER_NOSHAREDCACHE") )
+    m_sharedTable = std::make_unique<SharedTable>();
 }
 
 NC::LCPlaneSet::LCPlaneSet(double dspacing, double thealpha,
@@ -156,6 +281,12 @@ double NC::LCHelper::braggThreshold() const
   return m_planes.empty() ? 0.0 : m_planes.begin()->twodsp;
 }
 
+std::size_t NC::LCHelper::memoryFootprint() const
+{
+  return sizeof(LCHelper) + m_planes.capacity() * sizeof(LCPlaneSet)
+    + ( m_sharedTable ? m_sharedTable->memoryFootprint() : 0 );
+}
+
 NC::LCROIFinder::LCROIFinder(double wl, double c3, double cta, double sta)
   : m_wl(wl),
     m_c3(ncabs(c3)),//ncabs, to ensure alpha_neutron < pi/2 (rotation symmetry guarantees same results)
@@ -333,12 +464,19 @@ void NC::LCHelper::ensureValid(NC::LCHelper::Cache& cache, double wl, const NC::
 {
   nc_assert(wl>0.0);
   nc_assert(indir.isUnitVector());
-  double c3 = m_lcaxislab.dot(indir);
+  ensureValidC3(cache,wl,m_lcaxislab.dot(indir));
+}
+
+void NC::LCHelper::ensureValidC3(NC::LCHelper::Cache& cache, double wl, double c3) const
+{
   nc_assert(wl>=0&&wl<1e7&&c3>=-1.0&&c3<=1.0);
   uint64_t discrwl = LCdiscretizeValue(wl);
   uint64_t discrc3 = LCdiscretizeValue(ncabs(c3));
-  if ( cache.m_signature.first == discrwl && cache.m_signature.second == discrc3 )
+  if ( cache.m_signature.first == discrwl && cache.m_signature.second == discrc3 ) {
+    NCRYSTAL_RTCOUNT(CacheHits);
     return;
+  }
+  NCRYSTAL_RTCOUNT(CacheMisses);
   forceUpdateCache(cache,discrwl,discrc3);
 }
 
@@ -355,25 +493,56 @@ void NC::LCHelper::forceUpdateCache( NC::LCHelper::Cache& cache, uint64_t discr_
   cache.m_roilist.clear();
   cache.m_roixs_commul.clear();
   cache.m_roi_overlays.clear();
-  const double wl(cache.m_wl), c3(cache.m_c3), s3(cache.m_s3);
+  cache.m_scratch.reset();
+  cache.m_shared = nullptr;
+
+  if ( m_sharedTable ) {
+    //Use results published by other caches if possible, and publish results
+    //for signatures which were seen before:
+    cache.m_shared = m_sharedTable->find( cache.m_signature );
+    if ( cache.m_shared )
+      return;
+    if ( m_sharedTable->seenBefore( cache.m_signature ) ) {
+      auto entry = std::make_unique<SharedEntry>();
+      entry->signature = cache.m_signature;
+      findROIs( cache.m_wl, cache.m_c3, cache.m_s3, entry->roilist, entry->roixs_commul );
+      entry->overlays = std::unique_ptr<std::atomic<float*>[]>( new std::atomic<float*>[entry->roilist.size()] );
+      for ( auto i : ncrange( entry->roilist.size() ) )
+        entry->overlays[i].store( nullptr, std::memory_order_relaxed );
+      cache.m_shared = m_sharedTable->insert( entry );
+      if ( !cache.m_shared ) {
+        //Table is full, keep results in the cache itself:
+        cache.m_roilist = std::move( entry->roilist );
+        cache.m_roixs_commul = std::move( entry->roixs_commul );
+      }
+      return;
+    }
+  }
+  findROIs( cache.m_wl, cache.m_c3, cache.m_s3, cache.m_roilist, cache.m_roixs_commul );
+}
 
-  const double cta = m_lcstdframe.gaussMos().mosaicityCosTruncationAngle();
-  const double sta = m_lcstdframe.gaussMos().mosaicitySinTruncationAngle();
+void NC::LCHelper::findROIs( double wl, double c3, double s3, std::vector<LCROI>& roilist, VectD& roixs_commul ) const
+{
+  nc_assert( roilist.empty() && roixs_commul.empty() );
+  //NB: Using the screening angle, which equals the truncation angle unless
+  //tails are screened away:
+  const double cta = m_lcstdframe.gaussMos().mosaicityCosScreeningAngle();
+  const double sta = m_lcstdframe.gaussMos().mosaicitySinScreeningAngle();
   LCROIFinder roifinder(wl,c3,cta,sta);
   std::vector<LCPlaneSet>::const_iterator it(m_planes.begin()),itE(m_planes.end());
   for (;it!=itE;++it) {
     if ( wl > it->twodsp )
       break;//done, no other planes can contribute, since m_planes is sorted by dspacing
 #ifndef NDEBUG
-    std::size_t nold = cache.m_roilist.size();
+    std::size_t nold = roilist.size();
 #endif
-    roifinder.findROIs(&(*it),cache.m_roilist);
+    roifinder.findROIs(&(*it),roilist);
 #ifndef NDEBUG
     {
       //sanity check of ROI ranges:
       Vector vneutron(s3,0.,c3);
-      for (std::size_t ii = nold; ii<cache.m_roilist.size(); ++ii) {
-        LCROI & roi = cache.m_roilist.at(ii);
+      for (std::size_t ii = nold; ii<roilist.size(); ++ii) {
+        LCROI & roi = roilist.at(ii);
         if (roi.isDegenerate())
           continue;
         LCStdFrame::NormalPars normal(roi.planeset,roi.normal_sign);
@@ -387,28 +556,28 @@ void NC::LCHelper::forceUpdateCache( NC::LCHelper::Cache& cache, uint64_t discr_
 #endif
 #if defined(NCRYSTAL_LCUTILS_ANTINORMALS_ONLY) || defined(NCRYSTAL_LCUTILS_ANTINORMALS_EXCLUDED)
     {
-      decltype(cache.m_roilist) modified_roilist;
+      decltype(roilist) modified_roilist;
       //    double normal_sign;//1.0 for normal(s), -1.0 for anti-normal(s).
 #  ifdef NCRYSTAL_LCUTILS_ANTINORMALS_ONLY
       constexpr double modify_target_normsign = -1.0;
 #  else
       constexpr double modify_target_normsign = 1.0;
 #  endif
-      for (const auto& e: cache.m_roilist) {
+      for (const auto& e: roilist) {
         if (e.normal_sign == modify_target_normsign)
           modified_roilist.emplace_back(e);
       }
-      cache.m_roilist.swap(modified_roilist);
+      roilist.swap(modified_roilist);
     }
 #endif
   }
 
-  if (cache.m_roilist.empty())
+  if (roilist.empty())
     return;
 
-  cache.m_roixs_commul.reserve(cache.m_roilist.size());
+  roixs_commul.reserve(roilist.size());
   double sumxs = 0.0;
-  std::vector<LCROI>::const_iterator itROI(cache.m_roilist.begin()),itROIE(cache.m_roilist.end());
+  std::vector<LCROI>::const_iterator itROI(roilist.begin()),itROIE(roilist.end());
 
   LCStdFrame::NeutronPars neutron(wl,c3,s3);
 
@@ -432,16 +601,24 @@ void NC::LCHelper::forceUpdateCache( NC::LCHelper::Cache& cache, uint64_t discr_
       roi_xs = m_lcstdframe.calcXSIntegral(neutron,normal,itROI->rotmin,itROI->rotmax) * kInvPi;
     }
     nc_assert(roi_xs>0);//otherwise it should not have been a ROI!
-    cache.m_roixs_commul.push_back(sumxs += roi_xs);
+    roixs_commul.push_back(sumxs += roi_xs);
   }
 
-  nc_assert(cache.m_roixs_commul.size()==cache.m_roilist.size());
+  nc_assert(roixs_commul.size()==roilist.size());
 }
 
 double NC::LCHelper::crossSection( NC::LCHelper::Cache& cache, double wl, const NC::Vector& indir ) const
 {
-  ensureValid(cache,wl,indir);
-  return cache.m_roixs_commul.empty() ? 0.0 : (m_xsfact * cache.m_roixs_commul.back());
+  nc_assert(indir.isUnitVector());
+  return crossSection( cache, wl, m_lcaxislab.dot(indir) );
+}
+
+double NC::LCHelper::crossSection( NC::LCHelper::Cache& cache, double wl, double c3 ) const
+{
+  nc_assert(wl>0.0);
+  ensureValidC3(cache,wl,ncclamp(c3,-1.0,1.0));
+  const VectD& roixs_commul = cache.m_shared ? cache.m_shared->roixs_commul : cache.m_roixs_commul;
+  return roixs_commul.empty() ? 0.0 : (m_xsfact * roixs_commul.back());
 }
 
 void NC::LCHelper::Cache::reset()
@@ -451,13 +628,16 @@ void NC::LCHelper::Cache::reset()
   m_wl = m_c3 = m_s3 = -99.0;
   m_roilist.clear();
   m_roixs_commul.clear();
+  m_roi_overlays.clear();
+  m_scratch.reset();
+  m_shared = nullptr;
 }
 
 namespace NCrystal {
-  class LCStdFrameIntegrator : public Romberg {
+  class LCStdFrameIntegrator : public GaussKronrod {
   public:
     LCStdFrameIntegrator(const GaussMos* gm, const LCStdFrame::NormalPars& normal, const LCStdFrame::NeutronPars& neutron)
-      : Romberg(),
+      : GaussKronrod(),
         m_ip(neutron.wl, normal.planeset->inv_twodsp, normal.planeset->fsq),
         m_gm(gm),
         m_sinnormalmults3(normal.planeset->sinalpha*neutron.s3*normal.sign),//include normal.sign here, since it should multiply cos(phi) in evalFunc
@@ -468,42 +648,45 @@ namespace NCrystal {
       nc_assert(gm&&neutron.wl>0);
     }
 
-    virtual bool accept(unsigned /*level*/, double prev_estimate, double estimate,double,double) const
+    bool accept(double estimate, double error_estimate, double, double) const final
     {
-      return ncabs(estimate-prev_estimate) <= m_acc*ncabs(estimate);
+      return error_estimate <= m_acc*ncabs(estimate);
     }
 
-    virtual double evalFunc(double) const {
+    double evalFunc(double) const final {
       //Must be implemented, but should never be called since we provide
-      //evalFuncMany+evalFuncManySum.
+      //evalFuncNodes.
       nc_assert_always(false);
     }
 
-    virtual void evalFuncMany(double* fvals, unsigned n, double offset, double delta) const
+    void evalFuncNodes(double center, double halfwidth, double* fvals) const final
     {
-      nc_assert(offset>=0&&offset<kPi*1.00001);
-      nc_assert(delta>0&&delta*(n-1)<=kPi*1.00001);
-      CosSinGridGen grid(n,offset,delta);
-      unsigned i = 0;
-      do {
-        double cosgamma = m_sinnormalmults3 * grid.current_cosval() + m_cosnormalmultc3;
-        nc_assert(NC::ncabs(cosgamma)<1.000000001);
-        fvals[i++] = m_gm->calcRawCrossSectionValue(m_ip,cosgamma);
-      } while (grid.step());
+      //Nodes are at phi=center+-d, so cos(phi)=cos(center)cos(d)-+sin(center)sin(d):
+      nc_assert(center>=0&&center<=kPi*1.00001);
+      nc_assert(halfwidth>0&&halfwidth<=kPiHalf*1.00001);
+      double cosc, sinc;
+      sincos_0pi(ncmin(center,kPi),cosc,sinc);
+      fvals[0] = evalAtCosPhi( cosc );
+      for ( unsigned k = 0; k < 7; ++k ) {
+        double cosd, sind;
+        sincos_mpi2pi2(ncmin(halfwidth*node(k),kPiHalf),cosd,sind);
+        const double a = cosc*cosd;
+        const double b = sinc*sind;
+        fvals[2*k+1] = evalAtCosPhi( a + b );
+        fvals[2*k+2] = evalAtCosPhi( a - b );
+      }
     }
 
-    virtual double evalFuncManySum(unsigned n, double offset, double delta) const
+    //Evaluate at n equally spaced points (for overlays):
+    void evalFuncMany(double* fvals, unsigned n, double offset, double delta) const
     {
       nc_assert(offset>=0&&offset<kPi*1.00001);
-      nc_assert(delta>0&&delta*n<=kPi*1.00001);
+      nc_assert(delta>0&&delta*(n-1)<=kPi*1.00001);
       CosSinGridGen grid(n,offset,delta);
-      double sum(0.);
+      unsigned i = 0;
       do {
-        double cosgamma = m_sinnormalmults3 * grid.current_cosval() + m_cosnormalmultc3;
-        nc_assert(NC::ncabs(cosgamma)<1.000000001);
-        sum += m_gm->calcRawCrossSectionValue(m_ip,cosgamma);
+        fvals[i++] = evalAtCosPhi(grid.current_cosval());
       } while (grid.step());
-      return sum;
     }
 
   private:
@@ -512,24 +695,61 @@ namespace NCrystal {
     const double m_sinnormalmults3;
     const double m_cosnormalmultc3;
     const double m_acc;
+    double evalAtCosPhi(double cosphi) const
+    {
+      double cosgamma = m_sinnormalmults3 * cosphi + m_cosnormalmultc3;
+      nc_assert(NC::ncabs(cosgamma)<1.000000001);
+      return m_gm->calcRawCrossSectionValue(m_ip,cosgamma);
+    }
   };
 }
 
-void NC::LCHelper::genPhiVal(RNG& rng, const LCROI& roi, const Overlay& overlay, double& phi, double& overlay_at_phi)
+void NC::LCHelper::genPhiVal(RNG& rng, const LCROI& roi, const float * overlay, double& phi, double& overlay_at_phi)
 {
-  const float* it = std::lower_bound( overlay.data, overlay.data+Overlay::ndata, overlay.data[Overlay::ndata-1] * rng.generate() );
-  unsigned ichoice = std::min<unsigned>((unsigned)(it - overlay.data),Overlay::ndata-1);
-  overlay_at_phi = overlay.nonCommulVal(ichoice);
+  const float* it = std::lower_bound( overlay, overlay+Overlay::ndata, overlay[Overlay::ndata-1] * rng.generate() );
+  unsigned ichoice = std::min<unsigned>((unsigned)(it - overlay),Overlay::ndata-1);
+  overlay_at_phi = Overlay::nonCommulVal(overlay,ichoice);
   double rel_phi_pos = (ichoice + rng.generate())/Overlay::ndata;
   phi = roi.rotmin + rel_phi_pos*roi.length();
 }
 
+void NC::LCHelper::fillOverlay( const LCROI& roi, const LCStdFrame::NeutronPars& neutron, float * data ) const
+{
+  //Prepare overlay by sampling xs values at edges of overlay histogram bins
+  //(For convenience and consistency, use the integrator class to do this):
+  LCStdFrame::NormalPars normal(roi.planeset,roi.normal_sign);
+  double tmp[Overlay::ndata+1];
+  LCStdFrameIntegrator integrator(&m_lcstdframe.gaussMos(), normal,neutron);
+  integrator.evalFuncMany(&tmp[0], Overlay::ndata+1, roi.rotmin, roi.length()/Overlay::ndata);
+
+  //Adding 2% of maxval to all bins significantly increases safety
+  //of non-central bins, with low impact on the acceptance rate:
+  double * it(&tmp[0]);
+  double * itLast(it+Overlay::ndata);
+  double * itE(itLast+1);
+  double maxval = 0.0;
+  for (;it!=itE;++it)
+    maxval = ncmax(maxval,*it);
+  double safety_offset = 0.02 * maxval;
+
+  //And a multiplicative factor ensures that the overlay function will
+  //never be too small in central bins:
+  const double safety_factor = 1.7;
+
+  //Finally, put into data as commulative array:
+  float * itData = data;
+  float sum(0.0);
+  for (it = &tmp[0]; it!=itLast ; ++it, ++itData )
+    *itData = ( sum += (ncmax(*it,*(it+1)) * safety_factor+safety_offset) );
+}
+
 void NC::LCHelper::genScatter( LCHelper::Cache& cache, RNG& rng, double wl, const Vector& indir, Vector& outdir ) const
 {
 
   ensureValid(cache,wl,indir);
 
-  double roixssum = cache.m_roixs_commul.empty() ? 0.0 : cache.m_roixs_commul.back();
+  const VectD& roixs_commul = cache.m_shared ? cache.m_shared->roixs_commul : cache.m_roixs_commul;
+  double roixssum = roixs_commul.empty() ? 0.0 : roixs_commul.back();
   if (!roixssum) {
     //scattering not possible here.
     outdir = indir;
@@ -537,9 +757,10 @@ void NC::LCHelper::genScatter( LCHelper::Cache& cache, RNG& rng, double wl, cons
   }
 
   //Choose ROI, according to cross-section of each ROI:
-  std::size_t idx = pickRandIdxByWeight(rng,cache.m_roixs_commul);
-  nc_assert(idx<cache.m_roilist.size());
-  const LCROI& roi = cache.m_roilist[idx];
+  const std::vector<LCROI>& roilist = cache.m_shared ? cache.m_shared->roilist : cache.m_roilist;
+  std::size_t idx = pickRandIdxByWeight(rng,roixs_commul);
+  nc_assert(idx<roilist.size());
+  const LCROI& roi = roilist[idx];
 
   //Now, generate the scattering in the chosen ROI. In case of on-Axis ROI, this
   //can go straight ahead. In case of off-Axis, one must first decide upon the
@@ -561,42 +782,35 @@ void NC::LCHelper::genScatter( LCHelper::Cache& cache, RNG& rng, double wl, cons
       cosphi = cos_mpipi(phi);
     } else {
 
-      //Find overlay object:
-      if (cache.m_roi_overlays.empty())
-        cache.m_roi_overlays.resize(cache.m_roilist.size());
-      nc_assert(idx<cache.m_roi_overlays.size());
-      Overlay& overlay = cache.m_roi_overlays[idx];
-
-      if (!overlay.data) {
-
-        //Didn't scatter on this normal before, prepare overlay by sampling xs
-        //values at edges of overlay histogram bins (For convenience and
-        //consistency, use the integrator class to do this):
-        double tmp[Overlay::ndata+1];
-        LCStdFrameIntegrator integrator(&m_lcstdframe.gaussMos(), normal,neutron);
-        integrator.evalFuncMany(&tmp[0], Overlay::ndata+1, roi.rotmin, roi.length()/Overlay::ndata);
-
-        //Adding 2% of maxval to all bins significantly increases safety
-        //of non-central bins, with low impact on the acceptance rate:
-        double * it(&tmp[0]);
-        double * itLast(it+Overlay::ndata);
-        double * itE(itLast+1);
-        double maxval = 0.0;
-        for (;it!=itE;++it)
-          maxval = ncmax(maxval,*it);
-        double safety_offset = 0.02 * maxval;
-
-        //And a multiplicative factor ensures that the overlay function will
-        //never be too small in central bins:
-        const double safety_factor = 1.7;
-
-        //Finally, put into overlay.data as commulative array:
-        overlay.prepareNullArray();
-        float * itData = overlay.data;
-        float sum(0.0);
-        for (it = &tmp[0]; it!=itLast ; ++it, ++itData )
-          *itData = ( sum += (ncmax(*it,*(it+1)) * safety_factor+safety_offset) );
-
+      //Find overlay object (preparing it if we didn't scatter on this normal
+      //before):
+      const float * overlay;
+      if ( cache.m_shared ) {
+        std::atomic<float*>& slot = cache.m_shared->overlays[idx];
+        float * data = slot.load( std::memory_order_acquire );
+        if ( !data ) {
+          float * newdata = new float[Overlay::ndata];
+          fillOverlay( roi, neutron, newdata );
+          if ( slot.compare_exchange_strong( data, newdata, std::memory_order_acq_rel ) ) {
+            data = newdata;
+          } else {
+            delete[] newdata;//another thread was faster, use its (identical) data
+          }
+        }
+        overlay = data;
+      } else {
+        if (cache.m_roi_overlays.empty())
+          cache.m_roi_overlays.resize(cache.m_roilist.size(),nullptr);
+        nc_assert(idx<cache.m_roi_overlays.size());
+        float *& ov = cache.m_roi_overlays[idx];
+        if (!ov) {
+          //Memory from the scratch arena of the cache is reused after the
+          //cache signature changes, avoiding heap allocations:
+          ov = cache.m_scratch.allocate<float>(Overlay::ndata);
+          std::memset(ov,0,sizeof(float)*Overlay::ndata);
+          fillOverlay( roi, neutron, ov );
+        }
+        overlay = ov;
       }
       const int maxtries = 1000;
       int triesleft = maxtries;
@@ -627,7 +841,7 @@ void NC::LCHelper::genScatter( LCHelper::Cache& cache, RNG& rng, double wl, cons
             unsigned overlay_bin = std::min<unsigned>(Overlay::ndata-1,(unsigned)(overlay_relphi*Overlay::ndata));
             ofs << sampleoverlay.at(i).first << " " << sampleoverlay.at(i).second << " "
                 << ph << " " << m_lcstdframe.calcXS(neutron,normal,std::cos(ph)) << " "
-                << overlay.nonCommulVal(overlay_bin) << "\n";
+                << Overlay::nonCommulVal(overlay,overlay_bin) << "\n";
           }
         }
       }
@@ -684,9 +898,10 @@ void NC::LCHelper::genScatter( LCHelper::Cache& cache, RNG& rng, double wl, cons
   outdir *= -1.0;
 }
 
-NC::LCStdFrame::LCStdFrame(MosaicityFWHM mosaicity, double prec, double ntrunc)
+NC::LCStdFrame::LCStdFrame(MosaicityFWHM mosaicity, double prec, double ntrunc, double screening)
   : m_gm(mosaicity,prec,ntrunc)
 {
+  m_gm.setScreening(screening);
 }
 
 double NC::LCStdFrame::calcXS_OnAxis( const NC::LCStdFrame::NeutronPars& neutron,
@@ -766,3 +981,164 @@ void NC::LCStdFrame::genScat( RNG& rng,
   Vector indir_stdframe(-neutron.s3,0.,-neutron.c3);
   m_gm.genScat( rng, scatcache, neutron.wl, indir_stdframe, outdir );
 }
+
+NC::LCXSTable::LCXSTable( const LCHelper& lchelper, double tolerance )
+  : m_lchelper(lchelper),
+    m_tol(ncclamp(tolerance,1e-6,0.1)),
+    m_wlmin(lchelper.braggThreshold()/32.0),
+    m_wlmax(lchelper.braggThreshold())
+{
+  //Features in the theta3 direction have widths comparable to the
+  //mosaicity, so rows are spaced at a fraction of the truncation angle (which
+  //is several times the mosaicity). The interpolation errors between rows
+  //scale with the square of the spacing, and are ~tol at this spacing:
+  const double ta = lchelper.gaussMos().mosaicityTruncationAngle();
+  const double target_dtheta = 0.02 * ta * std::sqrt( m_tol / 1e-3 );
+  m_nrows = std::min<std::size_t>( std::max<std::size_t>( static_cast<std::size_t>( kPiHalf / target_dtheta ) + 2, 65 ), 16385 );
+  m_dtheta = kPiHalf / ( m_nrows - 1 );
+  m_invdtheta = 1.0 / m_dtheta;
+  m_rows = std::unique_ptr<std::atomic<Row*>[]>( new std::atomic<Row*>[m_nrows] );
+  for ( auto i : ncrange( m_nrows ) )
+    m_rows[i].store( nullptr, std::memory_order_relaxed );
+}
+
+NC::LCXSTable::~LCXSTable()
+{
+  for ( auto i : ncrange( m_nrows ) )
+    delete m_rows[i].load();
+}
+
+std::size_t NC::LCXSTable::memoryFootprint() const
+{
+  std::size_t res = sizeof(LCXSTable) + m_nrows * sizeof(std::atomic<Row*>);
+  for ( auto i : ncrange( m_nrows ) ) {
+    const Row * row = m_rows[i].load( std::memory_order_acquire );
+    if ( row )
+      res += sizeof(Row) + ( row->wl.capacity() + row->xs.capacity() ) * sizeof(float);
+  }
+  return res;
+}
+
+double NC::LCXSTable::Row::eval( double x ) const
+{
+  nc_assert( wl.size() >= 2 );
+  std::size_t i = std::upper_bound( wl.begin(), wl.end(), static_cast<float>( x ) ) - wl.begin();
+  i = std::min<std::size_t>( std::max<std::size_t>( i, 1 ), wl.size() - 1 );
+  const double a = wl[i-1];
+  const double b = wl[i];
+  const double f = ncclamp( ( x - a ) / ( b - a ), 0.0, 1.0 );
+  return xs[i-1] + f * ( double(xs[i]) - double(xs[i-1]) );
+}
+
+void NC::LCXSTable::buildRows( unsigned nthreads ) const
+{
+  parallelForIndex( m_nrows, nthreads, [this]( std::size_t irow )
+  {
+    auto& slot = m_rows[irow];
+    Row * row = slot.load( std::memory_order_acquire );
+    if ( row )
+      return;
+    //Build the row and publish it (if another thread was faster, keep its
+    //identical row instead):
+    auto newrow = buildRow( irow * m_dtheta );
+    if ( slot.compare_exchange_strong( row, newrow.get(), std::memory_order_acq_rel ) )
+      newrow.release();
+  } );
+}
+
+std::unique_ptr<NC::LCXSTable::Row> NC::LCXSTable::buildRow( double theta3 ) const
+{
+  const double c3 = std::cos( theta3 );
+  LCHelper::Cache cache;
+  auto f = [this,&cache,c3]( double wl ) { return m_lchelper.crossSection( cache, wl, c3 ); };
+
+  //Seed points: Uniform grid, plus points around the edges of the Bragg band
+  //of each plane set, where the neutron-normal angle is |theta3-alpha| or
+  //theta3+alpha, and the band edges are smeared by the mosaicity:
+  VectD seeds;
+  constexpr unsigned nuniform = 256;
+  seeds.reserve( nuniform + 1 );
+  for ( auto i : ncrange( nuniform + 1 ) )
+    seeds.push_back( m_wlmin + ( m_wlmax - m_wlmin ) * i / nuniform );
+  const double ta = m_lchelper.gaussMos().mosaicityTruncationAngle();
+  for ( auto& ps : m_lchelper.planeSets() ) {
+    const double alpha = std::atan2( ps.sinalpha, ps.cosalpha );
+    for ( double edge : { ncabs( theta3 - alpha ), theta3 + alpha } ) {
+      for ( int k = -12; k <= 12; ++k ) {
+        //NB: Skip a~=0, where the wavelength is 2*dspacing and the cross
+        //section diverges:
+        const double a = edge + k * ( ta / 8.0 );
+        if ( a < 1e-6 || a >= kPiHalf )
+          continue;
+        const double wl = ps.twodsp * std::cos( a );
+        if ( wl > m_wlmin && wl < m_wlmax )
+          seeds.push_back( wl );
+      }
+    }
+  }
+  std::sort( seeds.begin(), seeds.end() );
+  seeds.erase( std::unique( seeds.begin(), seeds.end() ), seeds.end() );
+
+  VectD seedvals;
+  seedvals.reserve( seeds.size() );
+  double maxval = 0.0;
+  for ( auto wl : seeds ) {
+    seedvals.push_back( f( wl ) );
+    maxval = ncmax( maxval, seedvals.back() );
+  }
+
+  //Refine intervals by bisection, until linear interpolation at the midpoint
+  //is precise enough (relative to the local value, but ignoring deviations
+  //which are tiny compared to the largest values in the row):
+  const double floorval = 1e-3 * maxval;
+  auto row = std::make_unique<Row>();
+  row->wl.reserve( 2 * seeds.size() );
+  row->xs.reserve( 2 * seeds.size() );
+  auto append = [&row]( double wl, double xs )
+  {
+    //Points are stored in single precision, so skip points which would
+    //coincide with the previous one:
+    const float fwl = static_cast<float>( wl );
+    if ( row->wl.empty() || fwl > row->wl.back() ) {
+      row->wl.push_back( fwl );
+      row->xs.push_back( static_cast<float>( xs ) );
+    }
+  };
+  std::function<void(double,double,double,double,unsigned)> refine;
+  refine = [&]( double a, double fa, double b, double fb, unsigned depth )
+  {
+    const double m = 0.5 * ( a + b );
+    const double fm = f( m );
+    if ( depth < 12 && ncabs( fm - 0.5 * ( fa + fb ) ) > m_tol * ( fm + floorval ) ) {
+      refine( a, fa, m, fm, depth + 1 );
+      refine( m, fm, b, fb, depth + 1 );
+    } else {
+      append( m, fm );
+      append( b, fb );
+    }
+  };
+  append( seeds.front(), seedvals.front() );
+  for ( auto i : ncrange( std::size_t(1), seeds.size() ) )
+    refine( seeds[i-1], seedvals[i-1], seeds[i], seedvals[i], 0 );
+  row->wl.shrink_to_fit();
+  row->xs.shrink_to_fit();
+  return row;
+}
+
+double NC::LCXSTable::crossSection( LCHelper::Cache& cache, double wl, double c3 ) const
+{
+  if ( !( wl > m_wlmin && wl < m_wlmax ) )
+    return wl >= m_wlmax ? 0.0 : m_lchelper.crossSection( cache, wl, c3 );//NB: Above Bragg threshold or not tabulated
+  //Interpolate linearly between the two rows around theta3:
+  const double theta3 = std::acos( ncmin( 1.0, ncabs( c3 ) ) );
+  const double x = theta3 * m_invdtheta;
+  const std::size_t irow = std::min<std::size_t>( static_cast<std::size_t>( x ), m_nrows - 2 );
+  const double f = x - irow;
+  const Row * row0 = m_rows[irow].load( std::memory_order_acquire );
+  const Row * row1 = row0 ? m_rows[irow+1].load( std::memory_order_acquire ) : nullptr;
+  if ( !row1 )
+    return m_lchelper.crossSection( cache, wl, c3 );
+  const double v0 = row0->eval( wl );
+  const double v1 = row1->eval( wl );
+  return v0 + f * ( v1 - v0 );
+}
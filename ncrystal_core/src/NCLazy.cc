@@ -20,6 +20,7 @@
 
 #include "NCLazy.hh"
 #include "NCrystal/internal/NCStrView.hh"
+#include "NCrystal/internal/NCTextDataLines.hh"
 #include "NCrystal/internal/NCLatticeUtils.hh"
 #include "NCrystal/internal/NCAtomUtils.hh"
 #include "NCrystal/internal/NCEqRefl.hh"
@@ -372,14 +373,14 @@ NC::Lazy::ParsedLazyData NC::Lazy::parseLazyTextData( const TextData& td, const
   };
 
   bool header_done(false);
-  for ( auto& line_str : td ) {
-    auto l = StrView(line_str).trimmed();
+  for ( auto line : TextDataLines(td) ) {
+    auto l = line.trimmed();
     if ( l.empty() )
       continue;//just an empty line (after trimming)
     if ( l.startswith('#') ) {
       if (header_done)
         continue;//just a comment, not part of the initial header
-      parse_hdr_line(line_str);
+      parse_hdr_line(line);
     } else {
       header_done = true;
       auto n = l.find('#');
@@ -28,18 +28,32 @@
 #include "NCrystal/internal/NCRotMatrix.hh"
 #include "NCrystal/internal/NCLatticeUtils.hh"
 #include "NCrystal/internal/NCString.hh"
+#include "NCrystal/internal/NCFactoryUtils.hh"
 #include "NCrystal/internal/NCDebyeMSD.hh"
 #include "NCrystal/internal/NCIter.hh"
 #include "NCrystal/internal/NCCfgManip.hh"
 #include "NCrystal/internal/NCSABUtils.hh"
 #include "NCrystal/internal/NCScatKnlData.hh"
 #include "NCrystal/internal/NCVDOSEval.hh"
+#include "NCrystal/internal/NCContentPool.hh"
 #include <iostream>
 
 namespace NC = NCrystal;
 
 namespace NCrystal {
 
+  namespace {
+    //Energy grids and VDOS curves are frequently identical between Info
+    //objects loaded from the same file (e.g. in temperature scans), so share
+    //them:
+    std::shared_ptr<const VectD> internVectD( VectD&& v )
+    {
+      static ContentPool<VectD> s_pool;
+      const HashValue h = hashContainer( v );
+      return s_pool.intern( std::move(v), h );
+    }
+  }
+
   class DI_ScatKnlImpl final : public DI_ScatKnlDirect {
   public:
     virtual ~DI_ScatKnlImpl(){}
@@ -52,7 +66,7 @@ namespace NCrystal {
         m_inputdata(std::make_unique<ScatKnlData>(std::move(data)))
     {
       if (!egrid.empty())
-        m_egrid = std::make_shared<const VectD>(std::move(egrid));
+        m_egrid = internVectD(std::move(egrid));
     }
 
     std::shared_ptr<const VectD> energyGrid() const final {return m_egrid;}
@@ -88,24 +102,24 @@ namespace NCrystal {
                  VectD&& orig_vdos_density)
       : DI_VDOS(fraction,std::move(atom),temperature),
         m_vdosdata(std::move(data)),
-        m_vdosOrigEgrid(orig_vdos_egrid),
-        m_vdosOrigDensity(orig_vdos_density)
+        m_vdosOrigEgrid(internVectD(std::move(orig_vdos_egrid))),
+        m_vdosOrigDensity(internVectD(std::move(orig_vdos_density)))
     {
       if (!egrid.empty())
-        m_egrid = std::make_shared<const VectD>(std::move(egrid));
+        m_egrid = internVectD(std::move(egrid));
     }
 
     std::shared_ptr<const VectD> energyGrid() const final {return m_egrid;}
     const VDOSData& vdosData() const final { return m_vdosdata; }
 
-    const VectD& vdosOrigEgrid() const final { return m_vdosOrigEgrid; }
-    const VectD& vdosOrigDensity() const final { return m_vdosOrigDensity; }
+    const VectD& vdosOrigEgrid() const final { return *m_vdosOrigEgrid; }
+    const VectD& vdosOrigDensity() const final { return *m_vdosOrigDensity; }
 
   private:
     VDOSData m_vdosdata;
     std::shared_ptr<const VectD> m_egrid;
-    VectD m_vdosOrigEgrid;
-    VectD m_vdosOrigDensity;
+    std::shared_ptr<const VectD> m_vdosOrigEgrid;
+    std::shared_ptr<const VectD> m_vdosOrigDensity;
   };
 
 }
@@ -165,6 +179,7 @@ NC::Info NC::loadNCMAT( const FactImpl::InfoRequest& cfg )
 NC::Info NC::loadNCMAT( NCMATData&& data,
                         NC::NCMATCfgVars&& cfgvars )
 {
+  InitProfileScope profileScope( "loadNCMAT", [&data](){ return data.sourceDescription.str(); } );
   const bool verbose = ncgetenv_bool("DEBUGINFO");
 
   if (verbose) {
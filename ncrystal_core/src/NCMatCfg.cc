@@ -23,6 +23,7 @@
 #include "NCrystal/NCFactImpl.hh"
 #include "NCrystal/NCSCOrientation.hh"
 #include "NCrystal/internal/NCCfgManip.hh"
+#include "NCrystal/NCMem.hh"
 #include <sstream>
 namespace NC = NCrystal;
 
@@ -132,6 +133,38 @@ public:
   std::shared_ptr<PhaseList> m_phases;//set if multiphase
   Cfg::CfgData m_cfgdata;//Variables (if single phase)
 
+  //Memoised processes (cf. MatCfg::getProcMemo). These are never copied along
+  //with the other data, and must be discarded upon any modification, which is
+  //why all modifications must go through Impl::modify(..):
+  class ProcMemo {
+  public:
+    ProcMemo() = default;
+    ProcMemo( const ProcMemo& ) {}
+    ProcMemo& operator=( const ProcMemo& ) { clear(); return *this; }
+    struct Entry {
+      std::weak_ptr<const ProcImpl::Process> proc;
+      std::uint64_t epoch = 0;
+    };
+    Entry& entry( ProcessType pt ) { return pt == ProcessType::Scatter ? m_scatter : m_absorption; }
+    void clear()
+    {
+      NCRYSTAL_LOCK_GUARD(mtx);
+      m_scatter = Entry();
+      m_absorption = Entry();
+    }
+    std::mutex mtx;
+  private:
+    Entry m_scatter, m_absorption;
+  };
+  mutable ProcMemo m_procMemo;
+
+  static COWPimpl<Impl>::Modifier modify( COWPimpl<Impl>& impl )
+  {
+    auto mod = impl.modify();
+    mod->m_procMemo.clear();
+    return mod;
+  }
+
   static PhaseList clonePhaseList( const PhaseList& pl )
   {
     PhaseList out;
@@ -142,6 +175,7 @@ public:
   }
 
   static std::string extractEmbeddedCfgStr( const DataSourceName&, const TextData& );
+  static MatCfg createFromCfgStr( const std::string& );
   static PhaseList cleanupAndCheckPhases( PhaseList&&, unsigned& );
   bool isMultiPhase() const noexcept { return m_phases != nullptr; }
 
@@ -157,7 +191,7 @@ public:
       Cfg::CfgData tmp;
       setfct( tmp, val );
       for ( auto& ph : *m_phases )
-        CfgManip::apply( ph.second.m_impl.modify()->m_cfgdata, tmp );
+        CfgManip::apply( Impl::modify(ph.second.m_impl)->m_cfgdata, tmp );
     }
   }
 
@@ -289,7 +323,7 @@ public:
         //Transfer common parameters to each daughter object (Note that this
         //does NOT transfer the topvll NB: this does on purpose NOT transfer the
         //common_toplvlvars parameters:
-        CfgManip::apply( phaselist.back().second.m_impl.modify()->m_cfgdata,  common_cfgdata );
+        CfgManip::apply( Impl::modify(phaselist.back().second.m_impl)->m_cfgdata,  common_cfgdata );
       }
     }
 
@@ -480,32 +514,32 @@ void NC::MatCfg::checkConsistency() const
 
 void NC::MatCfg::set_dir1( const OrientDir& od )
 {
-  m_impl.modify()->setVar( od, &CfgManip::set_dir1 );
+  Impl::modify(m_impl)->setVar( od, &CfgManip::set_dir1 );
 }
 
 void NC::MatCfg::set_dir2( const OrientDir& od )
 {
-  m_impl.modify()->setVar( od, &CfgManip::set_dir2 );
+  Impl::modify(m_impl)->setVar( od, &CfgManip::set_dir2 );
 }
 
 void NC::MatCfg::set_dir1( const HKLPoint& c, const LabAxis& l )
 {
-  m_impl.modify()->setVar( OrientDir{ c, l }, &CfgManip::set_dir1 );
+  Impl::modify(m_impl)->setVar( OrientDir{ c, l }, &CfgManip::set_dir1 );
 }
 
 void NC::MatCfg::set_dir1( const CrystalAxis& c, const LabAxis& l )
 {
-  m_impl.modify()->setVar( OrientDir{ c, l }, &CfgManip::set_dir1 );
+  Impl::modify(m_impl)->setVar( OrientDir{ c, l }, &CfgManip::set_dir1 );
 }
 
 void NC::MatCfg::set_dir2( const HKLPoint& c, const LabAxis& l )
 {
-  m_impl.modify()->setVar( OrientDir{c, l}, &CfgManip::set_dir2 );
+  Impl::modify(m_impl)->setVar( OrientDir{c, l}, &CfgManip::set_dir2 );
 }
 
 void NC::MatCfg::set_dir2( const CrystalAxis& c, const LabAxis& l )
 {
-  m_impl.modify()->setVar( OrientDir{c, l}, &CfgManip::set_dir2 );
+  Impl::modify(m_impl)->setVar( OrientDir{c, l}, &CfgManip::set_dir2 );
 }
 
 NC::OrientDir NC::MatCfg::get_dir1() const
@@ -552,14 +586,14 @@ void NC::MatCfg::setOrientation( const SCOrientation& sco )
 {
   if (!sco.isComplete())
     NCRYSTAL_THROW(BadInput,"setOrientation called with incomplete SCOrientation object");
-  m_impl.modify()->setVar( sco.getData(), &doSetSCOrient );
+  Impl::modify(m_impl)->setVar( sco.getData(), &doSetSCOrient );
 }
 
 void NC::MatCfg::apply( const Cfg::CfgData& cfgData )
 {
   if ( CfgManip::empty(cfgData) )
     return;
-  auto mod = m_impl.modify();
+  auto mod = Impl::modify(m_impl);
   if ( isMultiPhase() ) {
     for ( auto& ph : *mod->m_phases )
       ph.second.apply(cfgData);
@@ -573,6 +607,28 @@ bool NC::MatCfg::isTrivial() const
   return m_impl2->m_phaseChoices.empty() && m_impl->m_phases==nullptr && !hasDensityOverride();
 }
 
+std::shared_ptr<const NC::ProcImpl::Process> NC::MatCfg::getProcMemo( ProcessType pt, std::uint64_t epoch ) const
+{
+  if ( !m_impl2->m_phaseChoices.empty() )
+    return nullptr;
+  auto& memo = m_impl->m_procMemo;
+  NCRYSTAL_LOCK_GUARD(memo.mtx);
+  auto& e = memo.entry(pt);
+  return e.epoch == epoch ? e.proc.lock() : nullptr;
+}
+
+void NC::MatCfg::setProcMemo( ProcessType pt, std::uint64_t epoch,
+                              const std::shared_ptr<const ProcImpl::Process>& proc ) const
+{
+  if ( !m_impl2->m_phaseChoices.empty() )
+    return;
+  auto& memo = m_impl->m_procMemo;
+  NCRYSTAL_LOCK_GUARD(memo.mtx);
+  auto& e = memo.entry(pt);
+  e.proc = proc;
+  e.epoch = epoch;
+}
+
 void NC::MatCfg::applyStrCfg( const std::string& str )
 {
   Cfg::CfgData cfgData;
@@ -611,8 +667,56 @@ NC::MatCfg::MatCfg( const PhaseList& phases )
 {
 }
 
-NC::MatCfg::MatCfg( const std::string& datafile_and_parameters )
-  : MatCfg( [&datafile_and_parameters]() -> constructor_args
+namespace NCrystal {
+  namespace {
+    //Batch jobs often construct MatCfg objects from the same cfg-strings over
+    //and over (e.g. "Al_sg225.ncmat;temp=200K" in a loop). The data name must
+    //always be resolved anew (files might have changed on-disk, etc.), but once
+    //that gives the same TextData object as before, we can return a copy of a
+    //previously constructed MatCfg object (sharing its immutable internal
+    //representation), rather than parsing the cfg string and scanning the data
+    //for embedded cfg strings again:
+    class MatCfgStrCache {
+      std::mutex m_mtx;
+      std::map<std::pair<TextDataUID,std::string>,MatCfg> m_db;
+      static constexpr std::size_t max_entries = 128;
+    public:
+      MatCfgStrCache()
+      {
+        registerCacheCleanupFunction( [this](){ this->clear(); } );
+      }
+      void clear()
+      {
+        NCRYSTAL_LOCK_GUARD(m_mtx);
+        m_db.clear();
+      }
+      Optional<MatCfg> lookup( const std::pair<TextDataUID,std::string>& key )
+      {
+        NCRYSTAL_LOCK_GUARD(m_mtx);
+        auto it = m_db.find( key );
+        if ( it == m_db.end() )
+          return NullOpt;
+        return it->second;
+      }
+      void add( std::pair<TextDataUID,std::string>&& key, const MatCfg& cfg )
+      {
+        NCRYSTAL_LOCK_GUARD(m_mtx);
+        if ( m_db.size() >= max_entries )
+          m_db.clear();
+        m_db.emplace( std::move(key), cfg );
+      }
+    };
+    MatCfgStrCache& getMatCfgStrCache()
+    {
+      static MatCfgStrCache s_cache;
+      return s_cache;
+    }
+  }
+}
+
+NC::MatCfg NC::MatCfg::Impl::createFromCfgStr( const std::string& datafile_and_parameters )
+{
+  constructor_args args = [&datafile_and_parameters]() -> constructor_args
   {
     auto input = StrView(datafile_and_parameters);
 
@@ -659,7 +763,24 @@ NC::MatCfg::MatCfg( const std::string& datafile_and_parameters )
     constructor_args args;
     args.cfg = constructor_args::SinglePhase{ std::move(td), cfgstr, dataname};
     return args;
-  }())
+  }();
+
+  if ( !args.cfg.has_value<constructor_args::SinglePhase>() )
+    return MatCfg( std::move(args) );
+
+  auto& cache = getMatCfgStrCache();
+  auto key = std::make_pair( args.cfg.get<constructor_args::SinglePhase>().td->dataUID(),
+                             datafile_and_parameters );
+  auto cached = cache.lookup( key );
+  if ( cached.has_value() )
+    return std::move( cached.value() );
+  MatCfg cfg( std::move(args) );
+  cache.add( std::move(key), cfg );
+  return cfg;
+}
+
+NC::MatCfg::MatCfg( const std::string& datafile_and_parameters )
+  : MatCfg( Impl::createFromCfgStr( datafile_and_parameters ) )
 {
 }
 
@@ -910,38 +1031,48 @@ double NC::MatCfg::get_dcutoff() const { return CfgManip::get_dcutoff( m_impl->r
 double NC::MatCfg::get_dcutoffup() const { return CfgManip::get_dcutoffup( m_impl->readVar(Cfg::VarId::dcutoffup) ); }
 NC::MosaicityFWHM NC::MatCfg::get_mos() const { return CfgManip::get_mos( m_impl->readVar(Cfg::VarId::mos) ); }
 double NC::MatCfg::get_mosprec() const { return CfgManip::get_mosprec( m_impl->readVar(Cfg::VarId::mosprec) ); }
+double NC::MatCfg::get_mosscreen() const { return CfgManip::get_mosscreen( m_impl->readVar(Cfg::VarId::mosscreen) ); }
 double NC::MatCfg::get_sccutoff() const { return CfgManip::get_sccutoff( m_impl->readVar(Cfg::VarId::sccutoff) ); }
+double NC::MatCfg::get_scprune() const { return CfgManip::get_scprune( m_impl->readVar(Cfg::VarId::scprune) ); }
 double NC::MatCfg::get_dirtol() const { return CfgManip::get_dirtol( m_impl->readVar(Cfg::VarId::dirtol) ); }
 bool NC::MatCfg::get_coh_elas() const { return CfgManip::get_coh_elas( m_impl->readVar(Cfg::VarId::coh_elas) ); }
 bool NC::MatCfg::get_incoh_elas() const { return CfgManip::get_incoh_elas( m_impl->readVar(Cfg::VarId::incoh_elas) ); }
 bool NC::MatCfg::get_sans() const { return CfgManip::get_sans( m_impl->readVar(Cfg::VarId::sans) ); }
 
 std::string NC::MatCfg::get_inelas() const { return CfgManip::get_inelas( m_impl->readVar(Cfg::VarId::inelas) ).to_string(); }
+std::string NC::MatCfg::get_sabgrid() const { return CfgManip::get_sabgrid( m_impl->readVar(Cfg::VarId::sabgrid) ).to_string(); }
 std::string NC::MatCfg::get_infofactory() const { return CfgManip::get_infofactory( m_impl->readVar(Cfg::VarId::infofactory) ).to_string(); }
 std::string NC::MatCfg::get_scatfactory() const { return CfgManip::get_scatfactory( m_impl->readVar(Cfg::VarId::scatfactory) ).to_string(); }
 std::string NC::MatCfg::get_absnfactory() const { return CfgManip::get_absnfactory( m_impl->readVar(Cfg::VarId::absnfactory) ).to_string(); }
 const NC::LCAxis& NC::MatCfg::get_lcaxis() const { return CfgManip::get_lcaxis( m_impl->readVar(Cfg::VarId::lcaxis) ); }
 
-void NC::MatCfg::set_temp( Temperature v ) { m_impl.modify()->setVar( v, &CfgManip::set_temp ); }
-void NC::MatCfg::set_dcutoff( double v ) { m_impl.modify()->setVar( v, &CfgManip::set_dcutoff ); }
-void NC::MatCfg::set_dcutoffup( double v ) { m_impl.modify()->setVar( v, &CfgManip::set_dcutoffup ); }
-void NC::MatCfg::set_mos( MosaicityFWHM v ) { m_impl.modify()->setVar( v, &CfgManip::set_mos ); }
-void NC::MatCfg::set_mosprec( double v ) { m_impl.modify()->setVar( v, &CfgManip::set_mosprec ); }
-void NC::MatCfg::set_sccutoff( double v ) { m_impl.modify()->setVar( v, &CfgManip::set_sccutoff ); }
-void NC::MatCfg::set_dirtol( double v ) { m_impl.modify()->setVar( v, &CfgManip::set_dirtol ); }
-void NC::MatCfg::set_coh_elas( bool v ) { m_impl.modify()->setVar( v, &CfgManip::set_coh_elas ); }
-void NC::MatCfg::set_incoh_elas( bool v ) { m_impl.modify()->setVar( v, &CfgManip::set_incoh_elas ); }
-void NC::MatCfg::set_sans( bool v ) { m_impl.modify()->setVar( v, &CfgManip::set_sans ); }
-void NC::MatCfg::set_inelas( const std::string& v ) { m_impl.modify()->setVar( v, &CfgManip::set_inelas_stdstr ); }
-void NC::MatCfg::set_infofactory( const std::string& v ) { m_impl.modify()->setVar( v, &CfgManip::set_infofactory_stdstr ); }
-void NC::MatCfg::set_scatfactory( const std::string& v ) { m_impl.modify()->setVar( v, &CfgManip::set_scatfactory_stdstr ); }
-void NC::MatCfg::set_absnfactory( const std::string& v ) { m_impl.modify()->setVar( v, &CfgManip::set_absnfactory_stdstr ); }
-void NC::MatCfg::set_lcmode( std::int_least32_t v ) { m_impl.modify()->setVar( v, &CfgManip::set_lcmode ); }
-void NC::MatCfg::set_vdoslux( int v ) { m_impl.modify()->setVar( v, &CfgManip::set_vdoslux ); }
-void NC::MatCfg::set_lcaxis( const LCAxis& axis ) { m_impl.modify()->setVar( axis, &CfgManip::set_lcaxis ); }
-void NC::MatCfg::set_atomdb( const std::string& v ) { m_impl.modify()->setVar( v, &CfgManip::set_atomdb_stdstr ); }
+void NC::MatCfg::set_temp( Temperature v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_temp ); }
+void NC::MatCfg::set_dcutoff( double v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_dcutoff ); }
+void NC::MatCfg::set_dcutoffup( double v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_dcutoffup ); }
+void NC::MatCfg::set_mos( MosaicityFWHM v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_mos ); }
+void NC::MatCfg::set_mosprec( double v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_mosprec ); }
+void NC::MatCfg::set_mosscreen( double v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_mosscreen ); }
+void NC::MatCfg::set_sccutoff( double v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_sccutoff ); }
+void NC::MatCfg::set_scprune( double v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_scprune ); }
+void NC::MatCfg::set_dirtol( double v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_dirtol ); }
+void NC::MatCfg::set_coh_elas( bool v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_coh_elas ); }
+void NC::MatCfg::set_incoh_elas( bool v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_incoh_elas ); }
+void NC::MatCfg::set_sans( bool v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_sans ); }
+void NC::MatCfg::set_inelas( const std::string& v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_inelas_stdstr ); }
+void NC::MatCfg::set_sabgrid( const std::string& v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_sabgrid_stdstr ); }
+void NC::MatCfg::set_infofactory( const std::string& v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_infofactory_stdstr ); }
+void NC::MatCfg::set_scatfactory( const std::string& v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_scatfactory_stdstr ); }
+void NC::MatCfg::set_absnfactory( const std::string& v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_absnfactory_stdstr ); }
+void NC::MatCfg::set_lcmode( std::int_least32_t v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_lcmode ); }
+void NC::MatCfg::set_vdoslux( int v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_vdoslux ); }
+void NC::MatCfg::set_sabsampler( int v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_sabsampler ); }
+void NC::MatCfg::set_elincsampler( int v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_elincsampler ); }
+void NC::MatCfg::set_lcaxis( const LCAxis& axis ) { Impl::modify(m_impl)->setVar( axis, &CfgManip::set_lcaxis ); }
+void NC::MatCfg::set_atomdb( const std::string& v ) { Impl::modify(m_impl)->setVar( v, &CfgManip::set_atomdb_stdstr ); }
 std::int_least32_t NC::MatCfg::get_lcmode() const { return CfgManip::get_lcmode( m_impl->readVar(Cfg::VarId::lcmode) ); }
 int NC::MatCfg::get_vdoslux() const { return CfgManip::get_vdoslux( m_impl->readVar(Cfg::VarId::vdoslux) ); }
+int NC::MatCfg::get_sabsampler() const { return CfgManip::get_sabsampler( m_impl->readVar(Cfg::VarId::sabsampler) ); }
+int NC::MatCfg::get_elincsampler() const { return CfgManip::get_elincsampler( m_impl->readVar(Cfg::VarId::elincsampler) ); }
 std::string NC::MatCfg::get_atomdb() const { return CfgManip::get_atomdb( m_impl->readVar(Cfg::VarId::atomdb) ).to_string(); }
 std::vector<NC::VectS> NC::MatCfg::get_atomdb_parsed() const { return CfgManip::get_atomdb_parsed( m_impl->readVar(Cfg::VarId::atomdb) ); }
 
@@ -1002,7 +1133,7 @@ NC::MatCfg NC::MatCfg::cloneThinned() const
   cfg.m_textDataSP.reset();
   if ( cfg.m_impl->m_phases != nullptr ) {
     //must detach in order to thin phases.
-    auto mod = cfg.m_impl.modify();
+    auto mod = Impl::modify(cfg.m_impl);
     nc_assert(mod->m_phases!=nullptr);
     for ( auto& ph : *mod->m_phases )
       ph.second = ph.second.cloneThinned();
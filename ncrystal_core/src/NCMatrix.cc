@@ -80,9 +80,7 @@ void NCrystal::Matrix::inv(double epsilon  )
   unsigned tmp_colcount = m_colcount*2;
   decltype(m_data) new_data;
   const auto newsize = m_rowcount*tmp_colcount;
-  new_data.reserve_hint(newsize);
-  for ( unsigned i = 0; i < newsize; ++i )
-    new_data.emplace_back();
+  new_data.resize(newsize);//zero-initialised, without intermediate reallocations
 
   for (unsigned i = 0; i < m_rowcount; ++i) {
     for (unsigned j = 0; j < m_colcount ; ++j) {
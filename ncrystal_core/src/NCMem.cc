@@ -20,8 +20,12 @@
 
 #include "NCrystal/NCMem.hh"
 #include "NCrystal/NCDefs.hh"
+#include "NCrystal/internal/NCString.hh"
 #include <vector>
 #include <mutex>
+#if defined(__linux__)
+#  include <sys/mman.h>
+#endif
 
 namespace NC = NCrystal;
 
@@ -45,6 +49,44 @@ void NC::registerCacheCleanupFunction( std::function<void()> f )
   s_cacheCleanerMutexFcts.emplace_back(f);
 }
 
+namespace NCrystal {
+  namespace {
+    static std::atomic<int> s_hugePages( -1 );//-1 means not yet initialised from environment
+  }
+}
+
+void NC::enableHugePages( bool status )
+{
+  s_hugePages.store( status ? 1 : 0 );
+}
+
+bool NC::getHugePagesEnabled()
+{
+  int v = s_hugePages.load();
+  if ( v < 0 ) {
+    int expected = -1;
+    s_hugePages.compare_exchange_strong( expected, ncgetenv_bool("HUGEPAGES") ? 1 : 0 );
+    v = s_hugePages.load();
+  }
+  return v == 1;
+}
+
+void * NC::largeBufferAlloc( std::size_t size )
+{
+  constexpr std::size_t hugePageSize = 2*1024*1024;
+  if ( !size )
+    size = 1;//size 0 malloc is UB
+  if ( size >= 2*hugePageSize && getHugePagesEnabled() ) {
+    void * p = alignedAlloc( hugePageSize, size );
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    //Only advisory, so failures (e.g. THP disabled in the kernel) are ignored:
+    (void)madvise( p, size, MADV_HUGEPAGE );
+#endif
+    return p;
+  }
+  return alignedAlloc( 64, size );
+}
+
 void * NC::detail::bigAlignedAlloc( std::size_t alignment, std::size_t size )
 {
   void * result = nullptr;
@@ -0,0 +1,361 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/internal/NCTabulatedXS.hh"
+#include "NCrystal/internal/NCMiniTransport.hh"
+#include "NCrystal/internal/NCThreadUtils.hh"
+#include "NCrystal/internal/NCMath.hh"
+#include "NCrystal/NCRNG.hh"
+
+namespace NC = NCrystal;
+namespace NCMT = NCrystal::MiniTransport;
+
+namespace NCrystal {
+  namespace MiniTransport {
+    namespace {
+
+      //Neutrons are propagated in batches of this size:
+      constexpr std::size_t batch_size = 4096;
+
+      //Restrict [tmin,tmax] to the values where |p+t*u|<half. Returns false if
+      //the result is empty:
+      bool clipToSlab( double p, double u, double half, double& tmin, double& tmax )
+      {
+        if ( u == 0.0 )
+          return std::fabs(p) < half;
+        double a = ( -half - p ) / u;
+        double b = ( half - p ) / u;
+        if ( a > b )
+          std::swap(a,b);
+        tmin = std::max(tmin,a);
+        tmax = std::min(tmax,b);
+        return tmin < tmax;
+      }
+
+      //Values of t where the 2D line (p1,p2)+t*(u1,u2) is inside a circle:
+      bool clipToCircle( double p1, double p2, double u1, double u2, double r, double& tmin, double& tmax )
+      {
+        const double a = u1*u1 + u2*u2;
+        const double c = p1*p1 + p2*p2 - r*r;
+        if ( a == 0.0 )
+          return c < 0.0;
+        const double b = ( p1*u1 + p2*u2 ) / a;
+        const double disc = b*b - c / a;
+        if ( !(disc > 0.0) )
+          return false;
+        const double s = std::sqrt(disc);
+        tmin = std::max(tmin,-b-s);
+        tmax = std::min(tmax,-b+s);
+        return tmin < tmax;
+      }
+
+      void moveAlong( NeutronState& s, double t )
+      {
+        s.pos[0] += t * s.dir[0];
+        s.pos[1] += t * s.dir[1];
+        s.pos[2] += t * s.dir[2];
+      }
+
+      void reduceWeight( NeutronState& s, double mu_abs, double dist, Tallies& tallies )
+      {
+        const double w = s.weight * std::exp( - mu_abs * dist );
+        tallies.absorbedWeight += s.weight - w;
+        s.weight = w;
+      }
+
+      void propagateBatch( Scatter& sc, Absorption* abs, double xs2mu, const Config& cfg,
+                           const NeutronState* in, std::size_t n, ExitState* out, Tallies& tallies )
+      {
+        const Geometry& geom = cfg.geometry;
+        const bool terminate = ( cfg.absorptionMode == AbsorptionMode::Terminate );
+        const bool weighted = ( cfg.absorptionMode == AbsorptionMode::Weight );
+        if ( cfg.absorptionMode == AbsorptionMode::None )
+          abs = nullptr;
+        const std::size_t nrand = terminate ? 2 : 1;
+        const std::size_t ilastbin = tallies.exitWeightByNScat.size() - 1;
+
+        //Enter the volume:
+        std::vector<std::size_t> active;
+        active.reserve( n );
+        for ( std::size_t i = 0; i < n; ++i ) {
+          ExitState& e = out[i];
+          e.state = in[i];
+          e.nscat = 0;
+          e.status = Status::Exited;
+          double t0, t1;
+          if ( !geom.intersect( e.state.pos, e.state.dir, t0, t1 ) || !( t1 > 0.0 ) ) {
+            e.status = Status::Missed;
+            tallies.missedWeight += e.state.weight;
+            continue;
+          }
+          if ( t0 > 0.0 )
+            moveAlong( e.state, t0 );
+          active.push_back( i );
+        }
+
+        //Step until all neutrons are done:
+        std::vector<double> ekin, xs_scat, xs_abs, rand;
+        std::vector<NeutronDirection> dirs;
+        std::vector<ScatterOutcome> outcomes;
+        std::vector<std::size_t> toscatter;
+        ekin.reserve( active.size() );
+        dirs.reserve( active.size() );
+        toscatter.reserve( active.size() );
+        auto gather = [&ekin,&dirs,out]( const std::vector<std::size_t>& indices )
+        {
+          ekin.clear();
+          dirs.clear();
+          for ( auto i : indices ) {
+            const NeutronState& s = out[i].state;
+            ekin.push_back( s.ekin );
+            dirs.emplace_back( s.dir[0], s.dir[1], s.dir[2] );
+          }
+        };
+
+        while ( !active.empty() ) {
+          const std::size_t na = active.size();
+          gather( active );
+          xs_scat.resize( na );
+          sc.crossSectionMany( ekin.data(), dirs.data(), na, xs_scat.data() );
+          if ( abs ) {
+            xs_abs.resize( na );
+            abs->crossSectionMany( ekin.data(), dirs.data(), na, xs_abs.data() );
+          }
+          rand.resize( na * nrand );
+          sc.rng().generateMany( rand.data(), rand.size() );
+
+          toscatter.clear();
+          for ( std::size_t k = 0; k < na; ++k ) {
+            ExitState& e = out[active[k]];
+            NeutronState& s = e.state;
+            const double mu_scat = xs2mu * xs_scat[k];
+            const double mu_abs = abs ? xs2mu * xs_abs[k] : 0.0;
+            const double mu_step = terminate ? mu_scat + mu_abs : mu_scat;
+            double t0, t1;
+            const double dist_exit = geom.intersect( s.pos, s.dir, t0, t1 ) ? std::max( 0.0, t1 ) : 0.0;
+            const double dist = mu_step > 0.0 ? -std::log( rand[k*nrand] ) / mu_step : kInfinity;
+            if ( !( dist < dist_exit ) ) {
+              moveAlong( s, dist_exit );
+              if ( weighted && mu_abs > 0.0 )
+                reduceWeight( s, mu_abs, dist_exit, tallies );
+              tallies.exitWeightByNScat[ std::min<std::size_t>( e.nscat, ilastbin ) ] += s.weight;
+              continue;
+            }
+            moveAlong( s, dist );
+            if ( weighted && mu_abs > 0.0 ) {
+              reduceWeight( s, mu_abs, dist, tallies );
+            } else if ( terminate && rand[k*nrand+1] * mu_step <= mu_abs ) {
+              e.status = Status::Absorbed;
+              tallies.absorbedWeight += s.weight;
+              continue;
+            }
+            toscatter.push_back( active[k] );
+          }
+
+          active.clear();
+          if ( toscatter.empty() )
+            break;
+          const std::size_t ns = toscatter.size();
+          gather( toscatter );
+          if ( outcomes.size() < ns )
+            outcomes.resize( ns, ScatterOutcome{ NeutronEnergy{0.0}, NeutronDirection{0.0,0.0,1.0} } );
+          sc.sampleScatterMany( ekin.data(), dirs.data(), ns, outcomes.data() );
+          tallies.nScatterings += ns;
+          for ( std::size_t k = 0; k < ns; ++k ) {
+            ExitState& e = out[toscatter[k]];
+            NeutronState& s = e.state;
+            s.ekin = outcomes[k].ekin.dbl();
+            s.dir[0] = outcomes[k].direction[0];
+            s.dir[1] = outcomes[k].direction[1];
+            s.dir[2] = outcomes[k].direction[2];
+            if ( ++e.nscat >= cfg.maxScatterings ) {
+              e.status = Status::MaxScatterings;
+              tallies.abandonedWeight += s.weight;
+            } else {
+              active.push_back( toscatter[k] );
+            }
+          }
+        }
+      }
+
+    }
+  }
+}
+
+NCMT::Geometry NCMT::Geometry::slab( double thickness )
+{
+  Geometry g;
+  g.shape = Shape::Slab;
+  g.dz = thickness;
+  g.validate();
+  return g;
+}
+
+NCMT::Geometry NCMT::Geometry::box( double dx, double dy, double dz )
+{
+  Geometry g;
+  g.shape = Shape::Box;
+  g.dx = dx;
+  g.dy = dy;
+  g.dz = dz;
+  g.validate();
+  return g;
+}
+
+NCMT::Geometry NCMT::Geometry::cylinder( double radius, double height )
+{
+  Geometry g;
+  g.shape = Shape::Cylinder;
+  g.radius = radius;
+  g.dy = height;
+  g.validate();
+  return g;
+}
+
+NCMT::Geometry NCMT::Geometry::sphere( double radius )
+{
+  Geometry g;
+  g.shape = Shape::Sphere;
+  g.radius = radius;
+  g.validate();
+  return g;
+}
+
+void NCMT::Geometry::validate() const
+{
+  auto check = []( double val, const char * name )
+  {
+    if ( !(val > 0.0) || ncisinf(val) )
+      NCRYSTAL_THROW2(BadInput,"MiniTransport geometry has invalid "<<name<<" (must be positive and finite): "<<val);
+  };
+  switch ( shape ) {
+  case Shape::Slab:
+    check(dz,"thickness");
+    return;
+  case Shape::Box:
+    check(dx,"dx");
+    check(dy,"dy");
+    check(dz,"dz");
+    return;
+  case Shape::Cylinder:
+    check(radius,"radius");
+    check(dy,"height");
+    return;
+  case Shape::Sphere:
+    check(radius,"radius");
+    return;
+  };
+  NCRYSTAL_THROW(BadInput,"MiniTransport geometry has invalid shape");
+}
+
+bool NCMT::Geometry::intersect( const double* p, const double* u, double& t0, double& t1 ) const
+{
+  t0 = -kInfinity;
+  t1 = kInfinity;
+  switch ( shape ) {
+  case Shape::Slab:
+    return clipToSlab( p[2], u[2], 0.5*dz, t0, t1 );
+  case Shape::Box:
+    return ( clipToSlab( p[0], u[0], 0.5*dx, t0, t1 )
+             && clipToSlab( p[1], u[1], 0.5*dy, t0, t1 )
+             && clipToSlab( p[2], u[2], 0.5*dz, t0, t1 ) );
+  case Shape::Cylinder:
+    return ( clipToSlab( p[1], u[1], 0.5*dy, t0, t1 )
+             && clipToCircle( p[0], p[2], u[0], u[2], radius, t0, t1 ) );
+  case Shape::Sphere:
+    {
+      const double b = p[0]*u[0] + p[1]*u[1] + p[2]*u[2];
+      const double c = p[0]*p[0] + p[1]*p[1] + p[2]*p[2] - radius*radius;
+      const double disc = b*b - c;
+      if ( !(disc > 0.0) )
+        return false;
+      const double s = std::sqrt(disc);
+      t0 = -b - s;
+      t1 = -b + s;
+      return true;
+    }
+  };
+  return false;
+}
+
+void NCMT::Tallies::add( const Tallies& o )
+{
+  if ( o.exitWeightByNScat.size() != exitWeightByNScat.size() )
+    NCRYSTAL_THROW(LogicError,"MiniTransport::Tallies::add called with tallies of different binning");
+  for ( std::size_t i = 0; i < exitWeightByNScat.size(); ++i )
+    exitWeightByNScat[i] += o.exitWeightByNScat[i];
+  absorbedWeight += o.absorbedWeight;
+  missedWeight += o.missedWeight;
+  abandonedWeight += o.abandonedWeight;
+  nScatterings += o.nScatterings;
+}
+
+void NCMT::propagate( Scatter& sc, const Absorption* abs, NumberDensity nd,
+                      const Config& cfg, const NeutronState* in, std::size_t N,
+                      ExitState* out, Tallies* tallies )
+{
+  cfg.geometry.validate();
+  if ( !(nd.dbl() >= 0.0) || ncisinf(nd.dbl()) )
+    NCRYSTAL_THROW2(BadInput,"MiniTransport::propagate got invalid number density: "<<nd);
+  if ( cfg.maxScatterings == 0 )
+    NCRYSTAL_THROW(BadInput,"MiniTransport::propagate requires maxScatterings>0");
+  if ( N == 0 )
+    return;
+
+  //Factor for converting cross sections [barn] to inverse mean free paths [1/m]:
+  const double xs2mu = 100.0 * nd.dbl();
+  const unsigned nbins = tallies ? static_cast<unsigned>( tallies->exitWeightByNScat.size() ) : 1u;
+
+  //Like in the batched C functions, clones are created in the calling thread
+  //in the order of the batches, for a limited number of batches at a time:
+  const std::size_t nbatches = ( N + batch_size - 1 ) / batch_size;
+  const std::size_t ngroup = 16 * std::max<std::size_t>( 1, cfg.nthreads );
+  std::vector<Scatter> clones;
+  std::vector<Absorption> absclones;
+  std::vector<Tallies> batchtallies;
+  clones.reserve( std::min( ngroup, nbatches ) );
+  for ( std::size_t igroup = 0; igroup < nbatches; igroup += ngroup ) {
+    clones.clear();
+    absclones.clear();
+    batchtallies.clear();
+    const std::size_t ngroupbatches = std::min( ngroup, nbatches - igroup );
+    for ( std::size_t i = 0; i < ngroupbatches; ++i ) {
+      clones.push_back( sc.cloneByIdx( RNGStreamIndex{ cfg.rngStreamIndexOffset + igroup + i } ) );
+      if ( abs )
+        absclones.push_back( abs->clone() );
+      batchtallies.emplace_back( nbins );
+    }
+    //RNG streams used in all threads are shared by the clones, so the batches
+    //must then be processed sequentially:
+    auto rngstream = dynamic_cast<const RNGStream*>( &clones.front().rng() );
+    const unsigned nthreads_group = ( rngstream && rngstream->useInAllThreads() ) ? 1 : cfg.nthreads;
+    parallelForIndex( ngroupbatches, nthreads_group, [&]( std::size_t i )
+    {
+      const std::size_t ioffset = ( igroup + i ) * batch_size;
+      const std::size_t nbatch = std::min<std::size_t>( batch_size, N - ioffset );
+      propagateBatch( clones[i], abs ? &absclones[i] : nullptr, xs2mu, cfg,
+                      in + ioffset, nbatch, out + ioffset, batchtallies[i] );
+    } );
+    if ( tallies ) {
+      for ( auto& t : batchtallies )
+        tallies->add( t );
+    }
+  }
+}
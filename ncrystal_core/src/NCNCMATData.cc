@@ -276,7 +276,7 @@ void NC::NCMATData::validateOtherPhases() const
 
 void NC::NCMATData::validateElementNameByVersion(const std::string& s, unsigned theversion)
 {
-  nc_assert_always(theversion>0&&theversion<=6);
+  nc_assert_always(theversion>0&&theversion<=7);
   AtomSymbol atomsymbol(s);
   if ( atomsymbol.isInvalid() )
     NCRYSTAL_THROW2(BadInput,"Invalid element name \""<<s<<"\"");//invalid in any version
@@ -365,7 +365,7 @@ void NC::NCMATData::validateDensity() const
 
 void NC::NCMATData::validate() const
 {
-  if ( ! ( version>=1 && version<=6 ) )
+  if ( ! ( version>=1 && version<=7 ) )
     NCRYSTAL_THROW2(BadInput,sourceDescription<<" unsupported NCMAT format version "<<version);
 
   std::set<std::string> allElementNames;
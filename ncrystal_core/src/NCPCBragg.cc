@@ -29,6 +29,25 @@ namespace NCrystal
 {
   namespace {
     constexpr double dspacing_merge_tolerance = 1e-11;
+    bool pcbraggUseCompactTables()
+    {
+      static const bool s_compact = !ncgetenv_bool("PCBRAGG_FULLPRECISION");
+      return s_compact;
+    }
+    bool isExactInFloatPrecision( const VectD& v )
+    {
+      //Check that all values are representable within a relative precision of
+      //2^-24 as floats (i.e. they are zero or normal floats):
+      for ( auto x : v ) {
+        if ( x == 0.0 )
+          continue;
+        const double ax = ncabs(x);
+        if ( !( ax >= std::numeric_limits<float>::min() )
+             || !( ax <= std::numeric_limits<float>::max() ) )
+          return false;
+      }
+      return true;
+    }
   }
 }
 
@@ -75,15 +94,63 @@ void NC::PCBragg::init( double v0_times_natoms, VectDFM&& origdata )
   if (fdm_commul.empty()||fdm_commul.back()<=0.0) {
     fdm_commul.clear();
     v2dE.clear();
-  } else {
-    m_threshold = NeutronEnergy{ *(v2dE.begin()) };
   }
-  //Transfer while squeezing memory:
-  VectD(fdm_commul.begin(),fdm_commul.end()).swap(m_fdm_commul);
-  VectD(v2dE.begin(),v2dE.end()).swap(m_2dE);
+  setTables( std::move(v2dE), std::move(fdm_commul) );
   nc_assert( m_threshold.get() > 0.0 );
 }
 
+template<class TValue>
+void NC::PCBragg::Tables<TValue>::set( const VectD& a, const VectD& b )
+{
+  //Transfer while squeezing memory:
+  nc_assert( a.size() == b.size() );
+  std::vector<TValue>(a.begin(),a.end()).swap(v2dE);
+  std::vector<TValue>(b.begin(),b.end()).swap(fdm_commul);
+  //Bucket indices for O(1) lookups of plane indices from energies (in v2dE)
+  //and from sampled cumulative contributions (in fdm_commul):
+  index_2dE = v2dE.empty() ? GridIndex() : GridIndex( v2dE );
+  index_fdm_commul = fdm_commul.empty() ? GridIndex() : GridIndex( fdm_commul );
+}
+
+void NC::PCBragg::setTables( VectD&& v2dE, VectD&& fdm_commul )
+{
+  nc_assert( v2dE.size() == fdm_commul.size() );
+  m_tabD = Tables<double>();
+  m_tabF = Tables<float>();
+  m_compact = ( pcbraggUseCompactTables()
+                && isExactInFloatPrecision( v2dE )
+                && isExactInFloatPrecision( fdm_commul ) );
+  if ( m_compact )
+    m_tabF.set( v2dE, fdm_commul );
+  else
+    m_tabD.set( v2dE, fdm_commul );
+  //Threshold from the value actually stored, to be consistent with lookups:
+  m_threshold = NeutronEnergy{ v2dE.empty() ? kInfinity
+                               : ( m_compact ? double(m_tabF.v2dE.front()) : m_tabD.v2dE.front() ) };
+}
+
+NC::VectD NC::PCBragg::get2dE() const
+{
+  return m_compact ? VectD( m_tabF.v2dE.begin(), m_tabF.v2dE.end() ) : m_tabD.v2dE;
+}
+
+NC::VectD NC::PCBragg::getFDMCommul() const
+{
+  return m_compact ? VectD( m_tabF.fdm_commul.begin(), m_tabF.fdm_commul.end() ) : m_tabD.fdm_commul;
+}
+
+template<class TValue>
+std::size_t NC::PCBragg::Tables<TValue>::memoryFootprint() const
+{
+  return ( v2dE.capacity() + fdm_commul.capacity() ) * sizeof(TValue)
+    + index_2dE.memoryFootprint() + index_fdm_commul.memoryFootprint();
+}
+
+std::size_t NC::PCBragg::memoryFootprint() const
+{
+  return sizeof(PCBragg) + m_tabD.memoryFootprint() + m_tabF.memoryFootprint();
+}
+
 NC::PCBragg::PCBragg( const StructureInfo& si, VectDFM&&  data)
 {
   init(si,std::move(data));
@@ -122,41 +189,157 @@ NC::EnergyDomain NC::PCBragg::domain() const noexcept
   return { m_threshold, NeutronEnergy{kInfinity} };
 }
 
-std::size_t NC::PCBragg::findLastValidPlaneIdx( NC::NeutronEnergy ekin) const {
-  //Quick binary search to find index of the plane with the smallest d-spacing
+template<class TValue>
+std::size_t NC::PCBragg::Tables<TValue>::findLastValidPlaneIdx( double ekin ) const
+{
+  //Quick lookup to find index of the plane with the smallest d-spacing
   //satisfying wl<=2d, but in energy-space: Finding the index of the plane with
-  //the largest value of ekin2wl(2d) satisfying ekin>=ekin2wl(2d).  We already
-  //know that ekin>=m_2dE[0], so we search from one past this entry:
-  nc_assert( !ncisnan(ekin.dbl()) );
-  nc_assert( ekin >= m_threshold );
-  return (std::upper_bound(m_2dE.begin() + 1,m_2dE.end(),ekin.get()) - m_2dE.begin()) - 1;
+  //the largest value of ekin2wl(2d) satisfying ekin>=ekin2wl(2d). We already
+  //know that ekin>=v2dE[0], so the upper_bound is at least 1:
+  nc_assert( !ncisnan(ekin) );
+  nc_assert( !v2dE.empty() && ekin >= v2dE.front() );
+  const std::size_t iupper = index_2dE.upperBoundIdx( v2dE, ekin );
+  nc_assert( iupper >= 1 );
+  return iupper - 1;
 }
 
+template<class TValue>
+double NC::PCBragg::Tables<TValue>::crossSection( double ekin ) const
+{
+  std::size_t idx = findLastValidPlaneIdx(ekin);
+  nc_assert(idx<fdm_commul.size());
+  return fdm_commul[idx] / ekin;
+}
+
+template<class TValue>
+void NC::PCBragg::Tables<TValue>::crossSectionMany( double threshold, const double* ekin,
+                                                    std::size_t N, double* out_xs ) const
+{
+  //Monotonic input (e.g. the energy or wavelength grids of cross section
+  //curves) is handled in a single merge walk through the input and v2dE,
+  //moving the plane index one step at a time. Otherwise each point is looked
+  //up independently:
+  const std::size_t nplanes = v2dE.size();
+  if ( N > 1 && std::is_sorted( ekin, ekin + N ) ) {
+    std::size_t i = 0;
+    for ( ; i < N && ekin[i] < threshold; ++i )
+      out_xs[i] = 0.0;
+    if ( i == N )
+      return;
+    std::size_t idx = findLastValidPlaneIdx( ekin[i] );
+    for ( ; i < N; ++i ) {
+      const double e = ekin[i];
+      while ( idx + 1 < nplanes && v2dE[idx+1] <= e )
+        ++idx;
+      out_xs[i] = fdm_commul[idx] / e;
+    }
+  } else if ( N > 1 && std::is_sorted( ekin, ekin + N, std::greater<double>() ) ) {
+    std::size_t idx = nplanes;//not initialised
+    for ( std::size_t i = 0; i < N; ++i ) {
+      const double e = ekin[i];
+      if ( e < threshold ) {
+        std::fill( out_xs + i, out_xs + N, 0.0 );
+        return;
+      }
+      if ( idx == nplanes )
+        idx = findLastValidPlaneIdx( e );
+      while ( v2dE[idx] > e )
+        --idx;//terminates since v2dE[0] is the threshold
+      out_xs[i] = fdm_commul[idx] / e;
+    }
+  } else {
+    for ( std::size_t i = 0; i < N; ++i ) {
+      const double e = ekin[i];
+      out_xs[i] = ( e < threshold ? 0.0 : crossSection( e ) );
+    }
+  }
+}
+
+template<class TValue>
+double NC::PCBragg::Tables<TValue>::genSinThetaBraggSq( RNG& rng, double ekin ) const
+{
+  std::size_t idx = findLastValidPlaneIdx(ekin);
+  nc_assert(idx<fdm_commul.size());
+
+  //randomly select one plane by contribution. Since the target value is at
+  //most fdm_commul[idx], a lower_bound search in the full fdm_commul array
+  //gives the same result as one restricted to [0,idx]:
+  const double target = rng.generate() * fdm_commul[idx];
+  std::size_t idx_rand = std::min<std::size_t>( idx, index_fdm_commul.lowerBoundIdx( fdm_commul, target ) );
+  nc_assert(idx_rand<v2dE.size());
+  return v2dE[idx_rand] / ekin;
+}
+
+template<class TValue>
+double NC::PCBragg::Tables<TValue>::genSinThetaBraggSqInWindow( RNG& rng, double ekin,
+                                                               double x_low, double x_high,
+                                                               double& weight ) const
+{
+  //Planes with sin^2(theta_bragg)=v2dE[i]/ekin in [x_low,x_high] form a
+  //contiguous range [ia,ib) of plane indices:
+  std::size_t idx = findLastValidPlaneIdx(ekin);
+  nc_assert(idx<fdm_commul.size());
+  const std::size_t ia = std::lower_bound( v2dE.begin(), v2dE.begin() + idx + 1, x_low * ekin ) - v2dE.begin();
+  const std::size_t ib = std::upper_bound( v2dE.begin() + ia, v2dE.begin() + idx + 1, x_high * ekin ) - v2dE.begin();
+  if ( ia >= ib ) {
+    weight = 0.0;
+    return 0.0;
+  }
+  const double base = ( ia ? double(fdm_commul[ia-1]) : 0.0 );
+  const double contrib = double(fdm_commul[ib-1]) - base;
+  weight = contrib / fdm_commul[idx];
+  const double target = base + rng.generate() * contrib;
+  std::size_t idx_rand = std::lower_bound( fdm_commul.begin() + ia, fdm_commul.begin() + ib, target ) - fdm_commul.begin();
+  idx_rand = std::min<std::size_t>( idx_rand, ib - 1 );
+  return v2dE[idx_rand] / ekin;
+}
+
+std::pair<NC::ScatterOutcomeIsotropic,double> NC::PCBragg::sampleScatterIsotropicInWindow( CachePtr&, RNG& rng,
+                                                                                          NeutronEnergy ekin,
+                                                                                          double mu_min,
+                                                                                          double mu_max ) const
+{
+  if ( !( mu_min <= mu_max ) || !( mu_min >= -1.0 ) || !( mu_max <= 1.0 ) )
+    NCRYSTAL_THROW2(BadInput,"PCBragg::sampleScatterIsotropicInWindow: invalid window ["<<mu_min<<", "<<mu_max<<"]");
+  ScatterOutcomeIsotropic unscattered{ ekin, CosineScatAngle{1.0} };
+  if ( ekin < m_threshold )
+    return { unscattered, 0.0 };
+  //mu = 1-2*sin^2(theta_bragg), so the window in x=sin^2(theta_bragg) is:
+  const double x_low = 0.5 * ( 1.0 - mu_max );
+  const double x_high = 0.5 * ( 1.0 - mu_min );
+  double weight;
+  const double x = ( m_compact
+                     ? m_tabF.genSinThetaBraggSqInWindow( rng, ekin.dbl(), x_low, x_high, weight )
+                     : m_tabD.genSinThetaBraggSqInWindow( rng, ekin.dbl(), x_low, x_high, weight ) );
+  if ( !( weight > 0.0 ) )
+    return { unscattered, 0.0 };
+  return { ScatterOutcomeIsotropic{ ekin, CosineScatAngle{ ncclamp( 1.0 - 2.0 * x, -1.0, 1.0 ) } }, weight };
+}
 
 NC::CrossSect NC::PCBragg::crossSectionIsotropic( NC::CachePtr&, NC::NeutronEnergy ekin ) const
 {
   if ( ekin < m_threshold)
     return CrossSect{0.0};
-  std::size_t idx = findLastValidPlaneIdx(ekin);
-  nc_assert(idx<m_fdm_commul.size());
-  return CrossSect{ m_fdm_commul[idx] / ekin.get() };
+  return CrossSect{ m_compact ? m_tabF.crossSection( ekin.dbl() ) : m_tabD.crossSection( ekin.dbl() ) };
+}
+
+void NC::PCBragg::crossSectionIsotropicMany( NC::CachePtr&, const double* ekin,
+                                            std::size_t N, double* out_xs ) const
+{
+  //Same as crossSectionIsotropic, but exploiting any ordering of the input
+  //energies (see Tables::crossSectionMany):
+  if ( m_compact )
+    m_tabF.crossSectionMany( m_threshold.dbl(), ekin, N, out_xs );
+  else
+    m_tabD.crossSectionMany( m_threshold.dbl(), ekin, N, out_xs );
 }
 
 NC::CosineScatAngle NC::PCBragg::genScatterMu( RNG& rng, NeutronEnergy ekin) const
 {
   nc_assert( ekin >= m_threshold );
-
-  std::size_t idx = findLastValidPlaneIdx(ekin);
-  nc_assert(idx<m_fdm_commul.size());
-
-  //randomly select one plane by contribution:
-  VectD::const_iterator itFCUpper = std::next( m_fdm_commul.begin(), idx );
-  VectD::const_iterator itFC = std::lower_bound( m_fdm_commul.begin(),
-                                                 itFCUpper,
-                                                 rng.generate() * (*itFCUpper) );
-  std::size_t idx_rand = (std::size_t)( itFC - m_fdm_commul.begin() );
-  nc_assert(idx_rand<m_2dE.size());
-  double sin_theta_bragg_squared = m_2dE[idx_rand] / ekin.get();
+  double sin_theta_bragg_squared = ( m_compact
+                                     ? m_tabF.genSinThetaBraggSq( rng, ekin.dbl() )
+                                     : m_tabD.genSinThetaBraggSq( rng, ekin.dbl() ) );
 
   //scatter angle A=2*theta_bragg, so with x=sin^2(theta_bragg), we have:
   //   x = sin^2(A/2)= (1-cosA)/2 => 1-2x = cosA = mu
@@ -178,6 +361,19 @@ NC::ScatterOutcomeIsotropic NC::PCBragg::sampleScatterIsotropic( NC::CachePtr&,
   }
 }
 
+void NC::PCBragg::sampleScatterIsotropicMany( NC::CachePtr&,
+                                             NC::RNG& rng,
+                                             const double* ekin,
+                                             std::size_t N,
+                                             NC::ScatterOutcomeIsotropic* out ) const
+{
+  for ( std::size_t i = 0; i < N; ++i ) {
+    NeutronEnergy e{ ekin[i] };
+    out[i].ekin = e;
+    out[i].mu = ( e < m_threshold ? CosineScatAngle{1.0} : genScatterMu(rng,e) );
+  }
+}
+
 std::shared_ptr<NC::ProcImpl::Process> NC::PCBragg::createMerged( const Process& oraw, double scale1, double scale2 ) const
 {
   nc_assert(scale1>0.0);
@@ -187,18 +383,19 @@ std::shared_ptr<NC::ProcImpl::Process> NC::PCBragg::createMerged( const Process&
     return nullptr;
   auto& o = *optr;
 
-  auto result = std::make_shared<PCBragg>( no_init );//empty instance
-  auto fixThreshold = [&result]() { result->m_threshold = NeutronEnergy{ result->m_2dE.front() }; };
-
   //transfer "a" (2dE) and "b" (fdm_commul) vectors, sorted by a:
-  VectD& new_a = result->m_2dE;
-  VectD& new_b = result->m_fdm_commul;
-  nc_assert( new_a.empty() && new_b.empty() );
-
-  const auto& old1_a = this->m_2dE;
-  const auto& old1_b = this->m_fdm_commul;
-  const auto& old2_a = o.m_2dE;
-  const auto& old2_b = o.m_fdm_commul;
+  VectD new_a, new_b;
+  auto finish = [&new_a,&new_b]()
+  {
+    auto result = std::make_shared<PCBragg>( no_init );//empty instance
+    result->setTables( std::move(new_a), std::move(new_b) );
+    return result;
+  };
+
+  const VectD old1_a = this->get2dE();
+  const VectD old1_b = this->getFDMCommul();
+  const VectD old2_a = o.get2dE();
+  const VectD old2_b = o.getFDMCommul();
   nc_assert(old1_a.size()==old1_b.size());
   nc_assert(old2_a.size()==old2_b.size());
   new_a.reserve(old1_a.size()+old2_a.size());
@@ -208,15 +405,15 @@ std::shared_ptr<NC::ProcImpl::Process> NC::PCBragg::createMerged( const Process&
   if ( old1_a.empty() ) {
     new_a = old2_a;
     new_b = vectorTrf(old2_b, [scale2](double x) {return x*scale2;});
-    return fixThreshold(), result;
+    return finish();
   }
   if ( old2_a.empty() ) {
     new_a = old1_a;
     new_b = vectorTrf(old1_b, [scale1](double x) {return x*scale1;});
-    return fixThreshold(), result;
+    return finish();
   }
 
-  //Merge lists, sort so m_2dE is ordered by increasing magnitude. And keep in
+  //Merge lists, sort so new_a is ordered by increasing magnitude. And keep in
   //mind that the fdm (_b) vectors are commulative! Try to do it without
   //numerical issues related to subtraction.
   std::size_t i1(0), i1E(old1_a.size());
@@ -280,31 +477,125 @@ std::shared_ptr<NC::ProcImpl::Process> NC::PCBragg::createMerged( const Process&
     ++i2;
   }
 
-  new_a.shrink_to_fit();
-  new_b.shrink_to_fit();
-
-  return fixThreshold(), result;
+  return finish();
 }
 
 NC::Optional<std::string> NC::PCBragg::specificJSONDescription() const
 {
-  //Determine max_contrib by looking at the peaks m_2dE:
+  //Determine max_contrib by looking at the peaks:
+  const VectD v2dE = get2dE();
+  const VectD fdm_commul = getFDMCommul();
   double max_contrib(0.0);
-  nc_assert(m_2dE.size()==m_fdm_commul.size());
-  for ( auto i : ncrange(m_2dE.size()) )
-    max_contrib = std::max<double>( max_contrib,m_fdm_commul.at(i) / m_2dE.at(i) );
+  nc_assert(v2dE.size()==fdm_commul.size());
+  for ( auto i : ncrange(v2dE.size()) )
+    max_contrib = std::max<double>( max_contrib,fdm_commul.at(i) / v2dE.at(i) );
 
   std::ostringstream ss;
   {
     std::ostringstream tmp;
-    nc_assert(!m_2dE.empty());
-    tmp << "nplanes="<<m_2dE.size()
+    nc_assert(!v2dE.empty());
+    tmp << "nplanes="<<v2dE.size()
         <<";2dmax="<<m_threshold.wavelength()
         << ";max_contrib="<<CrossSect{max_contrib};
     streamJSONDictEntry( ss, "summarystr", tmp.str(), JSONDictPos::FIRST );
   }
-  streamJSONDictEntry( ss, "nhkl", m_2dE.size() );
+  streamJSONDictEntry( ss, "nhkl", v2dE.size() );
   streamJSONDictEntry( ss, "max_contrib", max_contrib );
   streamJSONDictEntry( ss, "2dmax", m_threshold.wavelength().dbl(), JSONDictPos::LAST );
   return ss.str();
 }
+
+NC::PCBraggStrained::PCBraggStrained( shared_obj<const PCBragg> orig, double dspacingScale )
+  : m_orig(std::move(orig)),
+    m_dspacingScale(dspacingScale),
+    m_ekinScale(dspacingScale*dspacingScale)
+{
+  if ( !(dspacingScale>0.0) || ncisinf(dspacingScale) )
+    NCRYSTAL_THROW2(BadInput,"Invalid d-spacing scale factor (must be positive and finite): "<<dspacingScale);
+}
+
+NC::EnergyDomain NC::PCBraggStrained::domain() const noexcept
+{
+  return { NeutronEnergy{ m_orig->domain().elow.dbl() / m_ekinScale }, NeutronEnergy{kInfinity} };
+}
+
+NC::CrossSect NC::PCBraggStrained::crossSectionIsotropic( NC::CachePtr& cp, NC::NeutronEnergy ekin ) const
+{
+  return m_orig->crossSectionIsotropic( cp, NeutronEnergy{ ekin.dbl() * m_ekinScale } );
+}
+
+void NC::PCBraggStrained::crossSectionIsotropicMany( NC::CachePtr& cp, const double* ekin,
+                                                     std::size_t N, double* out_xs ) const
+{
+  //Scaled energies can be prepared directly in the output buffer:
+  for ( std::size_t i = 0; i < N; ++i )
+    out_xs[i] = ekin[i] * m_ekinScale;
+  m_orig->crossSectionIsotropicMany( cp, out_xs, N, out_xs );
+}
+
+NC::ScatterOutcomeIsotropic NC::PCBraggStrained::sampleScatterIsotropic( NC::CachePtr& cp,
+                                                                         NC::RNG& rng,
+                                                                         NC::NeutronEnergy ekin ) const
+{
+  auto res = m_orig->sampleScatterIsotropic( cp, rng, NeutronEnergy{ ekin.dbl() * m_ekinScale } );
+  res.ekin = ekin;//elastic
+  return res;
+}
+
+void NC::PCBraggStrained::sampleScatterIsotropicMany( NC::CachePtr& cp,
+                                                      NC::RNG& rng,
+                                                      const double* ekin,
+                                                      std::size_t N,
+                                                      NC::ScatterOutcomeIsotropic* out ) const
+{
+  constexpr std::size_t nbuf = 256;
+  double buf[nbuf];
+  for ( std::size_t ioffset = 0; ioffset < N; ioffset += nbuf ) {
+    const std::size_t n = std::min<std::size_t>( nbuf, N - ioffset );
+    for ( std::size_t i = 0; i < n; ++i )
+      buf[i] = ekin[ioffset+i] * m_ekinScale;
+    m_orig->sampleScatterIsotropicMany( cp, rng, buf, n, out + ioffset );
+    for ( std::size_t i = 0; i < n; ++i )
+      out[ioffset+i].ekin = NeutronEnergy{ ekin[ioffset+i] };//elastic
+  }
+}
+
+std::size_t NC::PCBraggStrained::memoryFootprint() const
+{
+  return sizeof(PCBraggStrained);//the original process is not owned exclusively
+}
+
+NC::Optional<std::string> NC::PCBraggStrained::specificJSONDescription() const
+{
+  std::ostringstream ss;
+  {
+    std::ostringstream tmp;
+    tmp << "dspacing_scale="<<m_dspacingScale;
+    streamJSONDictEntry( ss, "summarystr", tmp.str(), JSONDictPos::FIRST );
+  }
+  streamJSONDictEntry( ss, "dspacing_scale", m_dspacingScale, JSONDictPos::LAST );
+  return ss.str();
+}
+
+NC::ProcImpl::ProcPtr NC::applyDSpacingScale( ProcImpl::ProcPtr proc, double dspacingScale )
+{
+  if ( !(dspacingScale>0.0) || ncisinf(dspacingScale) )
+    NCRYSTAL_THROW2(BadInput,"Invalid d-spacing scale factor (must be positive and finite): "<<dspacingScale);
+  if ( dspacingScale == 1.0 )
+    return proc;
+  auto pcbragg = proc.tryDynCast<const PCBragg>();
+  if ( pcbragg )
+    return makeSO<PCBraggStrained>( shared_obj<const PCBragg>( std::move(pcbragg) ), dspacingScale );
+  auto strained = dynamic_cast<const PCBraggStrained*>( proc.get() );
+  if ( strained ) {
+    return makeSO<PCBraggStrained>( strained->originalSO(), strained->dspacingScale() * dspacingScale );
+  }
+  auto pc = dynamic_cast<const ProcImpl::ProcComposition*>( proc.get() );
+  if ( pc ) {
+    ProcImpl::ProcComposition::ComponentList components;
+    for ( auto& c : pc->components() )
+      components.emplace_back( c.scale, applyDSpacingScale( c.process, dspacingScale ) );
+    return ProcImpl::ProcComposition::consumeAndCombine( std::move(components), pc->processType() );
+  }
+  return proc;
+}
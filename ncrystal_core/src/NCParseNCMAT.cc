@@ -21,9 +21,12 @@
 #include "NCrystal/NCParseNCMAT.hh"
 #include "NCrystal/NCException.hh"
 #include "NCrystal/internal/NCString.hh"
+#include "NCrystal/internal/NCTextDataLines.hh"
+#include "NCrystal/internal/NCFactoryUtils.hh"
 #include "NCrystal/internal/NCMath.hh"
 #include <iostream>
 #include <sstream>
+#include <cstring>
 #if __cplusplus >= 201703L
 #  include <functional>//for std::invoke
 #else
@@ -51,11 +54,15 @@ namespace NCrystal {
 
   private:
 
-    typedef VectS Parts;
-    void parseFile( TextData::Iterator itLine, TextData::Iterator itLineE );
-    void parseLine( const std::string&, Parts&, unsigned linenumber ) const;
-    void validateElementName(const std::string& s, unsigned lineno) const;
-    double str2dbl_withfractions(const std::string&) const;
+    //Lines are split into views pointing directly into the input data (which
+    //is kept alive by the TextDataLines object for the duration of the
+    //parsing), so only the final data is copied out of the input buffer:
+    typedef SmallVector<StrView,16> Parts;
+    void parseFile( TextDataLines::Iterator itLine, TextDataLines::Iterator itLineE );
+    void parseLine( StrView, Parts&, unsigned linenumber ) const;
+    void validateElementName(StrView s, unsigned lineno) const;
+    double str2dbl_withfractions(StrView) const;
+    static VectS partsToVectS( const Parts& );
 
     //Section handling:
     typedef void (NCMATParser::*handleSectionDataFn)(const Parts&,unsigned);
@@ -79,6 +86,13 @@ namespace NCrystal {
     VectD * m_dyninfo_active_vector_field;
     bool m_dyninfo_active_vector_field_allownegative;
 
+    //Base64 encoded payload of active vector field (NCMAT v7+), which is
+    //collected and only decoded once the field ends:
+    bool m_dyninfo_active_vector_field_base64 = false;
+    std::string m_dyninfo_base64_payload;
+    unsigned m_dyninfo_base64_lineno = 0;
+    void finishBase64VectorField();
+
     //Handle "cubic" keyword in @CELL section:
     Optional<double> m_cell_cubic;
 
@@ -94,8 +108,117 @@ namespace NCrystal {
     }
   };
 
+  namespace {
+    struct PreParsedDB {
+      std::mutex mtx;
+      std::map<const char*,std::pair<const unsigned char*,std::size_t>> entries;
+    };
+    PreParsedDB& getPreParsedDB()
+    {
+      static PreParsedDB s_db;
+      return s_db;
+    }
+
+    Optional<NCMATData> tryDecodePreParsed( const TextData& text )
+    {
+      std::pair<const unsigned char*,std::size_t> blob{ nullptr, 0 };
+      {
+        auto& db = getPreParsedDB();
+        NCRYSTAL_LOCK_GUARD(db.mtx);
+        if ( db.entries.empty() )
+          return NullOpt;
+        auto it = db.entries.find( text.rawData().begin() );
+        if ( it == db.entries.end() )
+          return NullOpt;
+        blob = it->second;
+      }
+      try {
+        NCMATData data = decodeNCMATDataBinary( reinterpret_cast<const char*>( blob.first ), blob.second );
+        data.sourceDescription = text.dataSourceName();
+        return Optional<NCMATData>( std::move(data) );
+      } catch ( Error::BadInput& ) {
+        return NullOpt;
+      }
+    }
+
+    constexpr char ncmatbin_magic[8] = { 'N','C','M','A','T','B','I','N' };
+    constexpr uint32_t ncmatbin_formatVersion = 1;
+    constexpr uint32_t ncmatbin_byteOrderMarker = 0x01020304u;
+
+    class BinWriter {
+    public:
+      void raw( const void * d, std::size_t n ) { m_data.append( static_cast<const char*>(d), n ); }
+      void u32( uint32_t v ) { raw( &v, sizeof(v) ); }
+      void i32( int32_t v ) { raw( &v, sizeof(v) ); }
+      void u64( uint64_t v ) { raw( &v, sizeof(v) ); }
+      void dbl( double v ) { raw( &v, sizeof(v) ); }
+      void str( const std::string& v ) { u64( v.size() ); raw( v.data(), v.size() ); }
+      void strs( const VectS& v ) { u64( v.size() ); for ( auto& e : v ) str( e ); }
+      void dbls( const VectD& v ) { u64( v.size() ); if ( !v.empty() ) raw( &v[0], v.size()*sizeof(double) ); }
+      std::string& data() { return m_data; }
+    private:
+      std::string m_data;
+    };
+
+    class BinReader {
+    public:
+      BinReader( const char * d, std::size_t n ) : m_it(d), m_itE(d+n) {}
+      void raw( void * d, std::size_t n )
+      {
+        if ( static_cast<std::size_t>( m_itE - m_it ) < n )
+          NCRYSTAL_THROW(BadInput,"Truncated or invalid binary NCMAT data");
+        std::memcpy( d, m_it, n );
+        m_it += n;
+      }
+      uint32_t u32() { uint32_t v; raw( &v, sizeof(v) ); return v; }
+      int32_t i32() { int32_t v; raw( &v, sizeof(v) ); return v; }
+      uint64_t u64() { uint64_t v; raw( &v, sizeof(v) ); return v; }
+      double dbl() { double v; raw( &v, sizeof(v) ); return v; }
+      std::size_t count( std::size_t minbytes_per_entry )
+      {
+        //Read count, and protect against huge allocations from invalid data:
+        uint64_t n = u64();
+        if ( n > static_cast<uint64_t>( m_itE - m_it ) / std::max<std::size_t>( 1, minbytes_per_entry ) )
+          NCRYSTAL_THROW(BadInput,"Truncated or invalid binary NCMAT data");
+        return static_cast<std::size_t>( n );
+      }
+      std::string str()
+      {
+        std::string v( count(1), '\0' );
+        if ( !v.empty() )
+          raw( &v[0], v.size() );
+        return v;
+      }
+      VectS strs()
+      {
+        VectS v( count(8) );
+        for ( auto& e : v )
+          e = str();
+        return v;
+      }
+      VectD dbls()
+      {
+        VectD v( count(sizeof(double)) );
+        if ( !v.empty() )
+          raw( &v[0], v.size()*sizeof(double) );
+        return v;
+      }
+      bool atEnd() const { return m_it == m_itE; }
+    private:
+      const char * m_it;
+      const char * m_itE;
+    };
+  }
+
   NCMATData parseNCMATData( const TextData& text, bool doFinalValidation )
   {
+    InitProfileScope profileScope( "parseNCMATData", [&text](){ return text.dataSourceName().str(); } );
+    auto preparsed = tryDecodePreParsed( text );
+    if ( preparsed.has_value() ) {
+      if ( doFinalValidation )
+        preparsed.value().validate();
+      return std::move( preparsed.value() );
+    }
     NCMATParser parser( text );
     if (!doFinalValidation)
       return parser.getData();
@@ -106,16 +229,24 @@ namespace NCrystal {
 
 }
 
-double NC::NCMATParser::str2dbl_withfractions(const std::string& ss) const
+NC::VectS NC::NCMATParser::partsToVectS( const Parts& parts )
+{
+  VectS res;
+  res.reserve(parts.size());
+  for ( auto& e : parts )
+    res.emplace_back(e.to_string());
+  return res;
+}
+
+double NC::NCMATParser::str2dbl_withfractions(StrView ss) const
 {
-if (!contains(ss,'/'))
+if (!ss.contains('/'))
   return str2dbl(ss);
  if (m_data.version==1)
    NCRYSTAL_THROW2(BadInput,"specification with fractions not supported in"
                    " NCMAT v1 files (offending parameter is \""<<ss<<"\")");
 
- VectS parts;
- split(parts,ss,0,'/');
+ auto parts = ss.split<2>('/');
  if (parts.size()!=2)
    NCRYSTAL_THROW2(BadInput,"multiple fractions in numbers are not supported so could not parse \""<<ss<<"\"");
  for (auto&e: parts)
@@ -139,16 +270,17 @@ NC::NCMATParser::NCMATParser( const TextData& input )
   m_data.sourceDescription = input.dataSourceName();
 
   //Inspect first line to ensure format is NCMAT and extract version:
-  auto itLine = input.begin();
+  TextDataLines lines(input);
+  auto itLine = lines.begin();
 
-  if ( itLine == input.end() )
+  if ( itLine == lines.end() )
     NCRYSTAL_THROW2(BadInput,"Empty data: "<<descr());
-  const std::string& line = *itLine;
+  StrView line = *itLine;
 
   //First line is special, we want the file to start with "NCMAT" with no
   //whitespace in front, so we explicitly test this before invoking the more
   //generic parseLine machinery below:
-  if (!startswith(line,"NCMAT"))
+  if (!line.startswith("NCMAT"))
     NCRYSTAL_THROW2(BadInput,descr()<<": is not in NCMAT format: The first 5 characters in the first line must be \"NCMAT\"");
 
   //Parse first line to get file format version:
@@ -157,7 +289,7 @@ NC::NCMATParser::NCMATParser( const TextData& input )
   if ( parts.size() == 2 ) {
     if ( parts.at(1) == "v1" ) {
       m_data.version = 1;
-      if (contains(line,'#'))
+      if (line.contains('#'))
         NCRYSTAL_THROW2(BadInput,descr()<<": has comments in the first line, which is not allowed in the NCMAT v1 format");
     } else if ( parts.at(1) == "v2" ) {
       m_data.version = 2;
@@ -169,6 +301,8 @@ NC::NCMATParser::NCMATParser( const TextData& input )
       m_data.version = 5;
     } else if ( parts.at(1) == "v6" ) {
       m_data.version = 6;
+    } else if ( parts.at(1) == "v7" ) {
+      m_data.version = 7;
     } else {
       NCRYSTAL_THROW2(BadInput,descr()<<": is in an NCMAT format version, \""<<parts.at(1)<<"\", which is not recognised by this installation of NCrystal");
     }
@@ -177,7 +311,7 @@ NC::NCMATParser::NCMATParser( const TextData& input )
     NCRYSTAL_THROW2(BadInput,descr()<<": is missing clear NCMAT format version designation in the first line, which should look like e.g. \"NCMAT v1\".");
 
   //Initial song and dance to classify source and format is now done, so proceed to parse rest of file:
-  parseFile( ++itLine, input.end() );
+  parseFile( ++itLine, lines.end() );
 
   //Unalias element names:
   m_data.unaliasElementNames();
@@ -194,7 +328,7 @@ NC::NCMATParser::NCMATParser( const TextData& input )
 
 }
 
-void NC::NCMATParser::parseFile( TextData::Iterator itLine, TextData::Iterator itLineE )
+void NC::NCMATParser::parseFile( TextDataLines::Iterator itLine, TextDataLines::Iterator itLineE )
 {
   //Setup map which will be used to delegate parsing of individual sections (NB:
   //Must also update error reporting code below when adding/remove section names
@@ -229,14 +363,13 @@ void NC::NCMATParser::parseFile( TextData::Iterator itLine, TextData::Iterator i
   //Actual parsing (starting from the second line of input in this function):
   unsigned lineno(1);
   Parts parts;
-  parts.reserve(16);
 
   bool sawAnySection = false;
   for ( ; itLine != itLineE; ++itLine ) {
-    const std::string& line = *itLine;
+    StrView line = *itLine;
     parseLine(line,parts,++lineno);
 
-    if (m_data.version==1 && contains(line,'#')) {
+    if (m_data.version==1 && line.contains('#')) {
       if (sawAnySection||(!parts.empty()&&parts.at(0)[0]=='@')||line.at(0)!='#')
         NCRYSTAL_THROW2(BadInput,descr()<<": has comments in a place which "
                         "is not allowed in the NCMAT v1 format"" (must only appear "
@@ -258,7 +391,7 @@ void NC::NCMATParser::parseFile( TextData::Iterator itLine, TextData::Iterator i
         NCRYSTAL_THROW2(BadInput,descr()<<": should not have whitespace before a section marker"
                         " (problem with indented \""<<parts.at(0)<<"\" in line "<<lineno<<")");
 
-      std::string new_section(&parts.at(0)[1]);
+      std::string new_section = parts.at(0).substr(1).to_string();
       if (new_section.empty())
         NCRYSTAL_THROW2(BadInput,descr()<<": has missing section name after '@' symbol in line "<<lineno<<")");
 
@@ -284,7 +417,7 @@ void NC::NCMATParser::parseFile( TextData::Iterator itLine, TextData::Iterator i
       std::swap(current_section,new_section);
       itSection = section2handler.find( is_custom_section ? "CUSTOM"_s : current_section );
 
-      nc_assert( m_data.version>=1 && m_data.version <= 6 );
+      nc_assert( m_data.version>=1 && m_data.version <= 7 );
       if ( itSection == section2handler.end() ) {
         //Unsupported section name. For better error messages, first check if it
         //is due to file version:
@@ -336,7 +469,7 @@ void NC::NCMATParser::parseFile( TextData::Iterator itLine, TextData::Iterator i
 }
 
 
-void NC::NCMATParser::parseLine( const std::string& line,
+void NC::NCMATParser::parseLine( StrView line,
                                  Parts& parts,
                                  unsigned lineno ) const
 {
@@ -364,7 +497,7 @@ void NC::NCMATParser::parseLine( const std::string& line,
   //127-255: forbidden (127 is control char, others are not ASCII but could indicate UTF-8 multibyte char)
 
   parts.clear();
-  const char * c = &line[0];
+  const char * c = line.data();
   const char * cE = c + line.size();
   const char * partbegin = nullptr;
   for (;c!=cE;++c) {
@@ -420,7 +553,7 @@ void NC::NCMATParser::parseLine( const std::string& line,
       if (*c=='\r') {
         if ( (c+1)!=cE && *(c+1)!='\n' ) {
           NCRYSTAL_THROW2(BadInput,descr()<<": contains invalid character at position "
-                          <<(c-&line[0])<<" in line "<<lineno<<". Carriage return codes (aka \\r) "
+                          <<(c-line.data())<<" in line "<<lineno<<". Carriage return codes (aka \\r) "
                           " are not allowed unless used as part of DOS line endings.");
         }
       }
@@ -429,7 +562,7 @@ void NC::NCMATParser::parseLine( const std::string& line,
     }
     //Only reach here in case of errors:
     NCRYSTAL_THROW2(BadInput,descr()<<": contains invalid character at position "
-                    <<(c-&line[0])<<" in line "<<lineno<<". Only regular ASCII characters"
+                    <<(c-line.data())<<" in line "<<lineno<<". Only regular ASCII characters"
                     " (including spaces) are allowed outside comments (comments can be UTF-8)");
   }
   if (partbegin) {
@@ -448,7 +581,7 @@ void NC::NCMATParser::parseLine( const std::string& line,
     if (*c=='\r') {
       if ( (c+1)!=cE && *(c+1)!='\n' ) {
         NCRYSTAL_THROW2(BadInput,descr()<<": contains invalid character at position "
-                        <<(c-&line[0])<<" in line "<<lineno<<". Carriage return codes (aka \\r) "
+                        <<(c-line.data())<<" in line "<<lineno<<". Carriage return codes (aka \\r) "
                         " are not allowed unless used as part of DOS line endings.");
       }
       continue;
@@ -545,10 +678,10 @@ void NC::NCMATParser::handleSectionData_CELL(const Parts& parts, unsigned lineno
   }
 }
 
-void NC::NCMATParser::validateElementName(const std::string& s, unsigned lineno) const
+void NC::NCMATParser::validateElementName(StrView s, unsigned lineno) const
 {
   try{
-    NCMATData::validateElementNameByVersion(s,m_data.version);
+    NCMATData::validateElementNameByVersion(s.to_string(),m_data.version);
   } catch (Error::BadInput&e) {
     NCRYSTAL_THROW2(BadInput,descr()<<": "<<e.what()<<" [in line "<<lineno<<"]");
   }
@@ -577,7 +710,7 @@ void NC::NCMATParser::handleSectionData_ATOMPOSITIONS(const Parts& parts, unsign
       NCRYSTAL_THROW2(BadInput,descr()<<": problem while decoding position parameter #"<<i+1<<" for element \""<<parts.at(0)<<"\" in line "<<lineno<<" : "<<e.what());
     }
   }
-  m_data.atompos.emplace_back(parts.at(0),v);
+  m_data.atompos.emplace_back(parts.at(0).to_string(),v);
 }
 
 void NC::NCMATParser::handleSectionData_SPACEGROUP(const Parts& parts, unsigned lineno)
@@ -640,7 +773,7 @@ void NC::NCMATParser::handleSectionData_DEBYETEMPERATURE(const Parts& parts, uns
     } catch (Error::BadInput&e) {
       NCRYSTAL_THROW2(BadInput,descr()<<": problem while decoding debye temperature for element \""<<parts.at(0)<<"\" in line "<<lineno<<" : "<<e.what());
     }
-    m_data.debyetemp_perelement.emplace_back(parts.at(0),dt);
+    m_data.debyetemp_perelement.emplace_back(parts.at(0).to_string(),dt);
   } else {
     NCRYSTAL_THROW2(BadInput,descr()<<": wrong number of data entries in line "<<lineno);
   }
@@ -649,6 +782,15 @@ void NC::NCMATParser::handleSectionData_DEBYETEMPERATURE(const Parts& parts, uns
 void NC::NCMATParser::handleSectionData_DYNINFO(const Parts& parts, unsigned lineno)
 {
   std::string e1 = descr();
+  if ( m_dyninfo_active_vector_field_base64 ) {
+    if ( parts.size() == 1 ) {
+      //Continuation line of base64 payload (keyword lines always have at
+      //least two parts, so there is no ambiguity):
+      m_dyninfo_base64_payload.append( parts.front().data(), parts.front().size() );
+      return;
+    }
+    finishBase64VectorField();
+  }
   if (parts.empty()) {
     if (!m_active_dyninfo)
       NCRYSTAL_THROW2(BadInput,e1<<": no input found in @DYNINFO section (expected in line "<<lineno<<")");
@@ -677,11 +819,12 @@ void NC::NCMATParser::handleSectionData_DYNINFO(const Parts& parts, unsigned lin
 
   VectD * parse_target = nullptr;
   NCMATData::DynInfo& di = *m_active_dyninfo;
-  Parts::const_iterator itParseToVect(parts.begin()), itParseToVectE(parts.end());
-  const std::string& p0 = parts.at(0);
+  const StrView * itParseToVect(parts.begin());
+  const StrView * itParseToVectE(parts.end());
+  const StrView p0 = parts.at(0);
 
   static_assert('A'<'a'&&'0'<'a'&&'_'<'a',"");
-  if ( p0[0] >= 'a' && contains_only(p0,"abcdefghijklmnopqrstuvwxyz_") ) {
+  if ( p0[0] >= 'a' && p0.contains_only("abcdefghijklmnopqrstuvwxyz_") ) {
 
     ////////////////////////////
     //line begins with a keyword
@@ -692,7 +835,7 @@ void NC::NCMATParser::handleSectionData_DYNINFO(const Parts& parts, unsigned lin
     m_dyninfo_active_vector_field = nullptr;//new keyword, deactivate active field.
     m_dyninfo_active_vector_field_allownegative = false;//forbid negative numbers except where we explicitly allow them
     ++itParseToVect;//skip keyword if later parsing values into vector
-    const std::string& p1 = parts.at(1);
+    const StrView p1 = parts.at(1);
 
     if ( isOneOf(p0,"fraction","element","type") ) {
       itParseToVect = itParseToVectE;//handle argument parsing here
@@ -720,7 +863,7 @@ void NC::NCMATParser::handleSectionData_DYNINFO(const Parts& parts, unsigned lin
         di.fraction = fr;
       } else if ( p0 == "element" ) {
         validateElementName(p1,lineno);
-        di.element_name = p1;
+        di.element_name = p1.to_string();
       } else if ( p0 == "type" ) {
         if ( p1 == "scatknl" )
           di.dyninfo_type = NCMATData::DynInfo::ScatKnl;
@@ -742,12 +885,12 @@ void NC::NCMATParser::handleSectionData_DYNINFO(const Parts& parts, unsigned lin
     //////////////////////////////////////////////////////////////
     //Not a common field, parse into generic DynInfo::fields map :
 
-    if ( di.fields.find(p0) != di.fields.end() )
+    std::string fieldname = p0.to_string();
+    if ( di.fields.find(fieldname) != di.fields.end() )
       NCRYSTAL_THROW2(BadInput,e1<<": keyword \""<<p0<<"\" is specified a second time in line "<<lineno);
 
     //Setup new vector for parsing into:
-    di.fields[p0] = VectD();
-    parse_target = &di.fields[p0];
+    parse_target = &di.fields[std::move(fieldname)];
     //Check if supports entry over multiple lines (mostly for keywords
     //potentially needing large number of arguments):
     if ( isOneOf(p0,"sab","sab_scaled","sqw","alphagrid","betagrid","qgrid",
@@ -758,6 +901,18 @@ void NC::NCMATParser::handleSectionData_DYNINFO(const Parts& parts, unsigned lin
                         <<lineno<<" is not yet supported (but is planned for inclusion in later NCMAT format versions)");
       m_dyninfo_active_vector_field = parse_target;
       m_dyninfo_active_vector_field_allownegative = (p0=="betagrid"||p0=="omegagrid");
+      if ( p1 == "base64" ) {
+        if ( m_data.version < 7 )
+          NCRYSTAL_THROW2(BadInput,e1<<": base64 encoded values for keyword \""<<p0<<"\" in line "<<lineno
+                          <<" are not supported in the indicated NCMAT format version, \"NCMAT v"<<m_data.version
+                          <<"\". They are only available starting with \"NCMAT v7\".");
+        m_dyninfo_active_vector_field_base64 = true;
+        m_dyninfo_base64_payload.clear();
+        m_dyninfo_base64_lineno = lineno;
+        for ( auto it = std::next(itParseToVect); it != itParseToVectE; ++it )
+          m_dyninfo_base64_payload.append( it->data(), it->size() );
+        return;
+      }
     }
   }
 
@@ -770,29 +925,26 @@ void NC::NCMATParser::handleSectionData_DYNINFO(const Parts& parts, unsigned lin
     NCRYSTAL_THROW2(BadInput,descr()<<": Unexpected content in line "<<lineno<<": "<<parts.front());
   nc_assert_always( itParseToVect != itParseToVectE );
   std::size_t idx = (itParseToVect-parts.begin());
-  std::string tmp_strcache0, tmp_strcache1;
   for (; itParseToVect!=itParseToVectE; ++itParseToVect,++idx) {
     double val;
-    const std::string * srcnumstr = &(*itParseToVect);
-    const std::string * srcrepeatstr = nullptr;
+    StrView srcnumstr = *itParseToVect;
+    Optional<StrView> srcrepeatstr;
     //First check for compact notation of repeated entries:
-    auto idx_repeat_marker = srcnumstr->find('r');
-    if (idx_repeat_marker != std::string::npos) {
-      tmp_strcache0.assign(*srcnumstr,0,idx_repeat_marker);
-      tmp_strcache1.assign(*srcnumstr,idx_repeat_marker+1,srcnumstr->size()-(idx_repeat_marker+1));
-      srcnumstr = &tmp_strcache0;
-      srcrepeatstr = &tmp_strcache1;
+    auto idx_repeat_marker = srcnumstr.find('r');
+    if (idx_repeat_marker != StrView::npos) {
+      srcrepeatstr = srcnumstr.substr(idx_repeat_marker+1);
+      srcnumstr = srcnumstr.substr(0,idx_repeat_marker);
     }
 
     unsigned repeat_count = 1;
     try {
-      if (srcrepeatstr) {
-        int irc = str2int(*srcrepeatstr);
+      if (srcrepeatstr.has_value()) {
+        int irc = str2int(srcrepeatstr.value());
         if (irc<2)
           NCRYSTAL_THROW2(BadInput,"repeated entry count parameter must be >= 2");
         repeat_count = irc;
       }
-      val = str2dbl(*srcnumstr);
+      val = str2dbl(srcnumstr);
     } catch (Error::BadInput&e) {
       NCRYSTAL_THROW2(BadInput,e1<<": problem while decoding vector entry #"<<1+(itParseToVect-parts.begin())<<" in line "<<lineno<<" : "<<e.what());
     }
@@ -805,6 +957,44 @@ void NC::NCMATParser::handleSectionData_DYNINFO(const Parts& parts, unsigned lin
   }
 }
 
+void NC::NCMATParser::finishBase64VectorField()
+{
+  //Decode payload of little-endian IEEE 754 doubles into the active field:
+  nc_assert_always( m_dyninfo_active_vector_field_base64 && m_dyninfo_active_vector_field );
+  m_dyninfo_active_vector_field_base64 = false;
+  VectD& target = *m_dyninfo_active_vector_field;
+  auto errprefix = [this]()
+  {
+    return descr() + ": problem while decoding base64 encoded vector starting in line "
+      + std::to_string( m_dyninfo_base64_lineno ) + " : ";
+  };
+  std::vector<uint8_t> bytes;
+  try {
+    bytes = base64str2bytes( m_dyninfo_base64_payload );
+  } catch (Error::BadInput&e) {
+    NCRYSTAL_THROW2(BadInput,errprefix()<<e.what());
+  }
+  if ( bytes.empty() || bytes.size() % 8 != 0 )
+    NCRYSTAL_THROW2(BadInput,errprefix()<<"decoded data is not a non-empty array of 8-byte floating point numbers");
+  const std::size_t n = bytes.size() / 8;
+  target.reserve( target.size() + n );
+  for ( std::size_t i = 0; i < n; ++i ) {
+    uint64_t bits = 0;
+    for ( unsigned ib = 0; ib < 8; ++ib )
+      bits |= static_cast<uint64_t>( bytes[8*i+ib] ) << ( 8 * ib );
+    double val;
+    static_assert( sizeof(val) == sizeof(bits), "" );
+    std::memcpy( &val, &bits, sizeof(val) );
+    if ( ncisnan(val) || ncisinf(val) )
+      NCRYSTAL_THROW2(BadInput,errprefix()<<"NaN or infinite number in entry #"<<i+1);
+    if ( !m_dyninfo_active_vector_field_allownegative && val < 0.0 )
+      NCRYSTAL_THROW2(BadInput,errprefix()<<"Negative number in entry #"<<i+1);
+    target.push_back( val );
+  }
+  m_dyninfo_base64_payload.clear();
+  m_dyninfo_base64_payload.shrink_to_fit();
+}
+
 void NC::NCMATParser::handleSectionData_DENSITY(const Parts& parts, unsigned lineno)
 {
   if (parts.empty()) {
@@ -876,14 +1066,14 @@ void NC::NCMATParser::handleSectionData_OTHERPHASES(const Parts& parts, unsigned
   }
   if (parts.size()<2)
     NCRYSTAL_THROW2(BadInput,descr()<<": wrong number of entries on line "<<lineno<<" in @OTHERPHASES section");
-  auto volfrac = StrView(parts.at(0)).toDbl();
+  auto volfrac = parts.at(0).toDbl();
   if ( !volfrac.has_value() || !(volfrac.value()>0.0) || !(volfrac.value()<1.0) )
     NCRYSTAL_THROW2(BadInput,descr()<<": invalid volume fraction \""<<parts.at(0)<<"\" specified in @OTHERPHASES section in line "
                     <<lineno<<" (must be a floating point number greater than 0.0 and less than 1.0)");
-  std::string cfgstr = parts.at(1);
+  std::string cfgstr = parts.at(1).to_string();
   for ( auto i : ncrange(2,(int)parts.size()) ) {
     cfgstr += ' ';//normalise whitespace to single space (as documented in the NCMAT doc)
-    cfgstr += parts.at(i);
+    parts.at(i).appendToString(cfgstr);
   }
 
   m_data.otherPhases.emplace_back(volfrac.value(),cfgstr);
@@ -896,7 +1086,7 @@ void NC::NCMATParser::handleSectionData_ATOMDB(const Parts& parts, unsigned line
     return;//end of section, nothing to do
   if ( parts.at(0)!="nodefaults" )
     validateElementName(parts.at(0),lineno);
-  m_data.atomDBLines.emplace_back(parts);
+  m_data.atomDBLines.emplace_back(partsToVectS(parts));
 }
 
 void NC::NCMATParser::handleSectionData_CUSTOM(const Parts& parts, unsigned)
@@ -904,5 +1094,165 @@ void NC::NCMATParser::handleSectionData_CUSTOM(const Parts& parts, unsigned)
   if (parts.empty())
     return;//end of section, nothing to do
   nc_assert(!m_data.customSections.empty());
-  m_data.customSections.back().second.push_back(parts);
+  m_data.customSections.back().second.push_back(partsToVectS(parts));
+}
+
+std::string NC::encodeNCMATDataBinary( const NCMATData& data )
+{
+  BinWriter w;
+  w.raw( ncmatbin_magic, sizeof(ncmatbin_magic) );
+  w.u32( ncmatbin_formatVersion );
+  w.u32( ncmatbin_byteOrderMarker );
+  w.i32( data.version );
+  w.i32( data.stateOfMatter.has_value() ? static_cast<int32_t>( enumAsInt( data.stateOfMatter.value() ) ) : -1 );
+  for ( auto v : data.cell.lengths )
+    w.dbl( v );
+  for ( auto v : data.cell.angles )
+    w.dbl( v );
+  w.u64( data.atompos.size() );
+  for ( auto& e : data.atompos ) {
+    w.str( e.first );
+    for ( auto v : e.second )
+      w.dbl( v );
+  }
+  w.i32( data.spacegroup );
+  w.u32( data.debyetemp_global.has_value() ? 1 : 0 );
+  w.dbl( data.debyetemp_global.has_value() ? data.debyetemp_global.value().dbl() : 0.0 );
+  w.u64( data.debyetemp_perelement.size() );
+  for ( auto& e : data.debyetemp_perelement ) {
+    w.str( e.first );
+    w.dbl( e.second.dbl() );
+  }
+  w.u64( data.dyninfos.size() );
+  for ( auto& di : data.dyninfos ) {
+    w.i32( static_cast<int32_t>( di.dyninfo_type ) );
+    w.str( di.element_name );
+    w.dbl( di.fraction );
+    w.u64( di.fields.size() );
+    for ( auto& f : di.fields ) {
+      w.str( f.first );
+      w.dbls( f.second );
+    }
+  }
+  w.i32( static_cast<int32_t>( data.density_unit ) );
+  w.dbl( data.density );
+  w.u64( data.atomDBLines.size() );
+  for ( auto& line : data.atomDBLines )
+    w.strs( line );
+  w.u64( data.otherPhases.size() );
+  for ( auto& e : data.otherPhases ) {
+    w.dbl( e.first );
+    w.str( e.second );
+  }
+  w.u64( data.customSections.size() );
+  for ( auto& cs : data.customSections ) {
+    w.str( cs.first );
+    w.u64( cs.second.size() );
+    for ( auto& line : cs.second )
+      w.strs( line );
+  }
+  return std::move( w.data() );
+}
+
+NC::NCMATData NC::decodeNCMATDataBinary( const char * rawdata, std::size_t len )
+{
+  BinReader r( rawdata, len );
+  char magic[sizeof(ncmatbin_magic)];
+  r.raw( magic, sizeof(magic) );
+  if ( std::memcmp( magic, ncmatbin_magic, sizeof(magic) ) != 0 )
+    NCRYSTAL_THROW(BadInput,"Data is not in binary NCMAT format");
+  if ( r.u32() != ncmatbin_formatVersion )
+    NCRYSTAL_THROW(BadInput,"Unsupported binary NCMAT format version");
+  if ( r.u32() != ncmatbin_byteOrderMarker )
+    NCRYSTAL_THROW(BadInput,"Binary NCMAT data was written with a different byte order");
+
+  NCMATData data;
+  data.version = r.i32();
+  if ( data.version < 1 || data.version > NCMATData::latest_version )
+    NCRYSTAL_THROW(BadInput,"Invalid NCMAT version in binary NCMAT data");
+  {
+    const int32_t som = r.i32();
+    if ( som == enumAsInt( NCMATData::StateOfMatter::Solid ) )
+      data.stateOfMatter = NCMATData::StateOfMatter::Solid;
+    else if ( som == enumAsInt( NCMATData::StateOfMatter::Gas ) )
+      data.stateOfMatter = NCMATData::StateOfMatter::Gas;
+    else if ( som == enumAsInt( NCMATData::StateOfMatter::Liquid ) )
+      data.stateOfMatter = NCMATData::StateOfMatter::Liquid;
+    else if ( som != -1 )
+      NCRYSTAL_THROW(BadInput,"Invalid state of matter in binary NCMAT data");
+  }
+  for ( auto& v : data.cell.lengths )
+    v = r.dbl();
+  for ( auto& v : data.cell.angles )
+    v = r.dbl();
+  data.atompos.resize( r.count( 8 + 3*sizeof(double) ) );
+  for ( auto& e : data.atompos ) {
+    e.first = r.str();
+    for ( auto& v : e.second )
+      v = r.dbl();
+  }
+  data.spacegroup = r.i32();
+  {
+    const bool has_global = ( r.u32() != 0 );
+    const double dt = r.dbl();
+    if ( has_global )
+      data.debyetemp_global = DebyeTemperature{ dt };
+  }
+  {
+    const std::size_t n = r.count( 8 + sizeof(double) );
+    data.debyetemp_perelement.reserve( n );
+    for ( std::size_t i = 0; i < n; ++i ) {
+      std::string name = r.str();
+      data.debyetemp_perelement.emplace_back( std::move(name), DebyeTemperature{ r.dbl() } );
+    }
+  }
+  data.dyninfos.resize( r.count( 4 + 8 + sizeof(double) + 8 ) );
+  for ( auto& di : data.dyninfos ) {
+    const int32_t ditype = r.i32();
+    if ( ditype < NCMATData::DynInfo::Sterile || ditype > NCMATData::DynInfo::Undefined )
+      NCRYSTAL_THROW(BadInput,"Invalid dynamic info type in binary NCMAT data");
+    di.dyninfo_type = static_cast<NCMATData::DynInfo::DynInfoType>( ditype );
+    di.element_name = r.str();
+    di.fraction = r.dbl();
+    const std::size_t nfields = r.count( 16 );
+    for ( std::size_t i = 0; i < nfields; ++i ) {
+      std::string name = r.str();
+      di.fields[name] = r.dbls();
+    }
+  }
+  {
+    const int32_t du = r.i32();
+    if ( du != NCMATData::ATOMS_PER_AA3 && du != NCMATData::KG_PER_M3 )
+      NCRYSTAL_THROW(BadInput,"Invalid density unit in binary NCMAT data");
+    data.density_unit = static_cast<NCMATData::DensityUnit>( du );
+  }
+  data.density = r.dbl();
+  data.atomDBLines.resize( r.count( 8 ) );
+  for ( auto& line : data.atomDBLines )
+    line = r.strs();
+  data.otherPhases.resize( r.count( sizeof(double) + 8 ) );
+  for ( auto& e : data.otherPhases ) {
+    e.first = r.dbl();
+    e.second = r.str();
+  }
+  data.customSections.resize( r.count( 16 ) );
+  for ( auto& cs : data.customSections ) {
+    cs.first = r.str();
+    cs.second.resize( r.count( 8 ) );
+    for ( auto& line : cs.second )
+      line = r.strs();
+  }
+  if ( !r.atEnd() )
+    NCRYSTAL_THROW(BadInput,"Trailing bytes in binary NCMAT data");
+  return data;
+}
+
+void NC::registerPreParsedNCMATData( const char * static_text_data,
+                                     const unsigned char * static_binary_data,
+                                     std::size_t binary_len )
+{
+  nc_assert_always( static_text_data && static_binary_data );
+  auto& db = getPreParsedDB();
+  NCRYSTAL_LOCK_GUARD(db.mtx);
+  db.entries[static_text_data] = { static_binary_data, binary_len };
 }
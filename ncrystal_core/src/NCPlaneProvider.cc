@@ -29,6 +29,12 @@ namespace NC = NCrystal;
 NC::PlaneProvider::PlaneProvider() = default;
 NC::PlaneProvider::~PlaneProvider() = default;
 
+NC::Optional<NC::PlaneProvider::SymGroup> NC::PlaneProvider::getNextSymGroup()
+{
+  NCRYSTAL_THROW(LogicError,"Do not call getNextSymGroup() on plane providers without symmetry() information.");
+  return NullOpt;
+}
+
 namespace NCrystal {
 
   namespace {
@@ -107,6 +113,7 @@ namespace NCrystal {
       HKLList::const_iterator m_it, m_itB, m_itE;
       const HKL * m_it_inner;
       const HKL * m_it_innerE;
+      bool m_symgroups;
     public:
       PlaneProviderStd_HKL( const Info * info, OptionalInfoPtr iptr )
         : PlaneProvider(),
@@ -118,7 +125,8 @@ namespace NCrystal {
             nc_assert_always( isOneOf(info->hklInfoType(),HKLInfoType::SymEqvGroup,HKLInfoType::ExplicitHKLs) );
             return info->getStructureInfo().spacegroup;
           }() ),
-          m_reci_lattice( getReciprocalLatticeRot( info->getStructureInfo() ) )
+          m_reci_lattice( getReciprocalLatticeRot( info->getStructureInfo() ) ),
+          m_symgroups( info->hklInfoType() == HKLInfoType::SymEqvGroup )
       {
         nc_assert( m_hklExpander.canExpand( info->hklInfoType() ) );
         auto& l = info->hklList();
@@ -164,6 +172,22 @@ namespace NCrystal {
         ++m_it_inner;
         return p;
       }
+
+      const EqRefl* symmetry() const override
+      {
+        return m_symgroups ? m_hklExpander.symmetry() : nullptr;
+      }
+
+      Optional<SymGroup> getNextSymGroup() override
+      {
+        nc_assert_always( m_symgroups );
+        if ( m_it == m_itE )
+          return NullOpt;
+        nc_assert( m_it->multiplicity % 2 == 0 );
+        SymGroup g{ m_it->dspacing, m_it->fsquared, m_it->hkl, m_it->multiplicity / 2 };
+        ++m_it;
+        return g;
+      }
     };
 
     std::unique_ptr<PlaneProvider> actual_createStdPlaneProvider( const Info* info, OptionalInfoPtr iptr )
@@ -21,10 +21,9 @@
 #include "NCrystal/NCPluginMgmt.hh"
 #include "NCrystal/internal/NCDynLoader.hh"
 #include "NCrystal/internal/NCString.hh"
+#include "NCrystal/internal/NCFactoryUtils.hh"
 #include <iostream>
 
-//MT TODO: Do we need to make these thread-safe?
-
 namespace NC = NCrystal;
 namespace NCP = NCrystal::Plugins;
 
@@ -48,6 +47,7 @@ namespace NCrystal {
       {
         //Mutex is already locked when this is called!
         nc_assert_always(pinfo.pluginType==PluginType::Dynamic||pinfo.pluginType==PluginType::Builtin);
+        InitProfileScope profileScope( "loadPlugin", [&pinfo](){ return pinfo.pluginName; } );
         bool verbose = ncgetenv_bool("DEBUG_PLUGIN");
         std::string ptypestr(pinfo.pluginType==PluginType::Dynamic?"dynamic":"builtin");
         if (verbose)
@@ -81,6 +81,7 @@ namespace NCrystal {
                                         std::string pluginName,
                                         std::string regfctname )
       {
+        InitProfileScope profileScope( "loadDynamicPlugin", [&path_to_shared_lib](){ return path_to_shared_lib; } );
         PluginInfo pinfo;
         pinfo.pluginType = PluginType::Dynamic;
         pinfo.fileName = path_to_shared_lib;
@@ -115,6 +116,85 @@ NCP::PluginInfo NCP::loadDynamicPlugin( std::string path_to_shared_lib )
   return loadDynamicPluginImpl( path_to_shared_lib, "", "ncplugin_register" );
 }
 
+namespace NCrystal {
+  namespace Plugins {
+    namespace {
+      struct LazyPlugin {
+        std::string fileName;
+        VectS dataTypes;
+        bool loaded = false;
+      };
+      struct LazyPluginDB {
+        //Recursive mutex is held while loading, so other threads wait for the
+        //loading to finish, while the loading thread itself is free to trigger
+        //further factory requests:
+        std::recursive_mutex mtx;
+        std::vector<LazyPlugin> plugins;
+        std::atomic<unsigned> npending{0};//for lock-free early exit
+      };
+      LazyPluginDB& getLazyPluginDB()
+      {
+        static LazyPluginDB db;
+        return db;
+      }
+
+      bool loadLazyPlugins( const std::string* dataType )
+      {
+        auto& db = getLazyPluginDB();
+        if ( db.npending.load() == 0 )
+          return false;
+        std::lock_guard<std::recursive_mutex> lock(db.mtx);
+        bool anyloaded = false;
+        //NB: Index-based loop since plugins might register further lazy plugins:
+        for ( std::size_t i = 0; i < db.plugins.size(); ++i ) {
+          if ( db.plugins.at(i).loaded )
+            continue;
+          if ( dataType && !std::count( db.plugins.at(i).dataTypes.begin(),
+                                        db.plugins.at(i).dataTypes.end(),
+                                        *dataType ) )
+            continue;
+          db.plugins.at(i).loaded = true;
+          --db.npending;
+          const std::string fn = db.plugins.at(i).fileName;
+          if (ncgetenv_bool("DEBUG_PLUGIN"))
+            std::cout<<"NCrystal: Triggering on-demand load of dynamic plugin: "<<fn<<std::endl;
+          loadDynamicPlugin( fn );
+          anyloaded = true;
+        }
+        return anyloaded;
+      }
+    }
+  }
+}
+
+void NCP::registerLazyDynamicPlugin( std::string path_to_shared_lib, VectS dataTypes )
+{
+  if ( path_to_shared_lib.empty() )
+    NCRYSTAL_THROW(BadInput,"registerLazyDynamicPlugin: empty path to shared library");
+  for ( auto& dt : dataTypes ) {
+    if ( dt.empty() || !isSimpleASCII(dt,AllowTabs::No,AllowNewLine::No) || contains_any(dt," .") )
+      NCRYSTAL_THROW2(BadInput,"registerLazyDynamicPlugin: invalid data type specification \""
+                      <<dt<<"\" for \""<<path_to_shared_lib<<"\"");
+  }
+  auto& db = getLazyPluginDB();
+  std::lock_guard<std::recursive_mutex> lock(db.mtx);
+  LazyPlugin lp;
+  lp.fileName = std::move(path_to_shared_lib);
+  lp.dataTypes = std::move(dataTypes);
+  db.plugins.push_back( std::move(lp) );
+  ++db.npending;
+}
+
+bool NCP::loadLazyPluginsForDataType( const std::string& dataType )
+{
+  return loadLazyPlugins( &dataType );
+}
+
+bool NCP::loadAllLazyPlugins()
+{
+  return loadLazyPlugins( nullptr );
+}
+
 NCP::PluginInfo NCP::loadBuiltinPlugin( std::string pluginName,
                                         std::function<void()> regfct )
 {
@@ -183,19 +263,22 @@ namespace NCrystal {
 
 void NCP::ensurePluginsLoaded()
 {
-  static std::atomic<bool> first(true);
-  bool btrue(true);
-  if (!first.compare_exchange_strong(btrue,false))
-    return;//only the first call will proceed past this point. If we instead
-           //used a mutex, we would get a deadlock (e.g. when registerFactory
-           //calls ensurePluginsLoaded before checking that the new factory name
-           //is unique). The MT-safety of the calls below should be the same as
-           //for any other call to loadXXXPlugin.
-
-  static bool done = false;
-  if (done)
+  static std::atomic<bool> s_done(false);
+  if ( s_done.load() )
+    return;//fast path
+
+  //Only the first call will proceed past this point. Other threads will wait
+  //for the loading to finish, while recursive calls from the loading thread
+  //itself (e.g. when registerFactory calls ensurePluginsLoaded before checking
+  //that the new factory name is unique) return immediately, which is why a
+  //recursive mutex is used:
+  static std::recursive_mutex s_mtx;
+  std::lock_guard<std::recursive_mutex> lock(s_mtx);
+  static bool s_started = false;
+  if ( s_started )
     return;
-  done = true;
+  s_started = true;
+  struct MarkDone { ~MarkDone() { s_done = true; } } markdone;
 
 #ifndef NCRYSTAL_DISABLE_STDDATASOURCES
   loadBuiltinPlugin("stddatasrc",ncrystal_register_stddatasrc_factory);
@@ -228,11 +311,24 @@ void NCP::ensurePluginsLoaded()
   provideBuiltinPlugins();
 #endif
 
-  //Dynamic custom plugins, as indicated by environment variable:
+  //Dynamic custom plugins, as indicated by environment variable (those with
+  //data types listed after '@' are only loaded on demand):
   for (auto& pluginlib : split2(ncgetenv("PLUGIN_LIST"),0,':')) {
     trim(pluginlib);
     if (pluginlib.empty())
       continue;
-    Plugins::loadDynamicPlugin(pluginlib);
+    auto parts = split2(pluginlib,1,'@');
+    if ( parts.size() == 2 ) {
+      VectS dataTypes;
+      for ( auto& dt : split2(parts.at(1),0,',') ) {
+        trim(dt);
+        if ( !dt.empty() )
+          dataTypes.push_back(dt);
+      }
+      trim(parts.at(0));
+      Plugins::registerLazyDynamicPlugin(parts.at(0),std::move(dataTypes));
+    } else {
+      Plugins::loadDynamicPlugin(pluginlib);
+    }
   }
 }
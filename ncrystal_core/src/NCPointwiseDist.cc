@@ -24,6 +24,13 @@
 
 namespace NC = NCrystal;
 
+namespace NCrystal {
+  namespace {
+    //For smaller distributions, a binary search is faster than the guide table:
+    constexpr std::size_t guideMinPoints = 32;
+  }
+}
+
 NC::PointwiseDist::PointwiseDist(const VectD &xvals, const VectD &yvals)
   : PointwiseDist( VectD(xvals), VectD(yvals) )
 {
@@ -71,34 +78,114 @@ NC::PointwiseDist::PointwiseDist( VectD&& xvals, VectD&& yvals )
     e *= normfact;
   nc_assert( ncabs(1.0-m_cdf.back()) < 1.0e-14 );
   m_cdf.back() = 1.0;
+  initGuide();
+}
+
+void NC::PointwiseDist::initGuide()
+{
+  const std::size_t n = m_cdf.size();
+  if ( n >= std::numeric_limits<unsigned>::max() )
+    NCRYSTAL_THROW(CalcError, "too many points in distribution.");
+  if ( n < guideMinPoints )
+    return;//binary search is faster
+  const std::size_t ncells = n - 1;
+  m_guide.resize( ncells + 1 );
+  std::size_t i = 0;
+  for ( std::size_t c = 0; c <= ncells; ++c ) {
+    const double p = double(c) / ncells;
+    while ( i < n && m_cdf[i] < p )
+      ++i;
+    m_guide[c] = static_cast<unsigned>( i );
+  }
+}
+
+std::size_t NC::PointwiseDist::findCDFBin( double p ) const
+{
+  //Equivalent to std::lower_bound over the full m_cdf:
+  const double * cdf = m_cdf.data();
+  const std::size_t n = m_cdf.size();
+  if ( m_guide.empty() )
+    return std::lower_bound( cdf, cdf + n, p ) - cdf;
+  const std::size_t ncells = m_guide.size() - 1;
+  const std::size_t c = std::min<std::size_t>( static_cast<std::size_t>( p * ncells ), ncells - 1 );
+  std::size_t lo = m_guide[c];
+  std::size_t hi = m_guide[c+1];
+  //Guard against rounding in p*ncells:
+  while ( lo > 0 && !( cdf[lo-1] < p ) )
+    --lo;
+  while ( hi < n && cdf[hi] < p )
+    ++hi;
+  if ( hi - lo <= 8 ) {
+    while ( lo < hi && cdf[lo] < p )
+      ++lo;
+    return lo;
+  }
+  return std::lower_bound( cdf + lo, cdf + hi, p ) - cdf;
+}
+
+namespace NCrystal {
+  namespace {
+    //Invert the CDF inside bin [i-1,i] (with i found by a lower_bound search):
+    std::pair<double,unsigned> pwdistInvertBin( const double * x,
+                                                const double * y,
+                                                const double * cdf,
+                                                std::size_t n,
+                                                std::size_t i,
+                                                double p )
+    {
+      i = std::max<std::size_t>(std::min<std::size_t>(i,n-1),1);
+      nc_assert( i>0 && i < n );
+      double dx = x[i]-x[i-1];
+      double c = (p-cdf[i-1]);
+      double a = y[i-1];
+      double d = y[i] - a;
+      double zdx;
+      if (!a) {
+        zdx = d>0.0 ? std::sqrt( ( 2.0 * c * dx ) / d ) : 0.5*dx;//a=0 and d=0 should not really happen...
+      } else {
+        double e = d * c / ( dx * a * a );
+        if (ncabs(e)>1e-7) {
+          //apply formula:
+          zdx = ( std::sqrt( 1.0 + 2.0 * e ) - 1.0 ) * dx * a / d;
+        } else {
+          //calculate via expansion (solves numerical issue when d is near zero):
+          zdx = ( 1 + 0.5 * e * ( e - 1.0 ) ) * c / a;
+        }
+      }
+      return std::pair<double,unsigned>( ncclamp(x[i-1] + zdx,x[i-1],x[i]), i-1 );
+    }
+  }
 }
 
 std::pair<double,unsigned> NC::PointwiseDist::percentileWithIndex(double p ) const
 {
+  const std::size_t n = m_x.size();
   nc_assert(p>=0.&&p<=1.0);
   if(p==1.)
-    return std::pair<double,unsigned>(m_x.back(), m_x.size()-2);
-
-  std::size_t i = std::max<std::size_t>(std::min<std::size_t>(std::lower_bound(m_cdf.begin(), m_cdf.end(), p)-m_cdf.begin(),m_cdf.size()-1),1);
-  nc_assert( i>0 && i < m_x.size() );
-  double dx = m_x[i]-m_x[i-1];
-  double c = (p-m_cdf[i-1]);
-  double a = m_y[i-1];
-  double d = m_y[i] - a;
-  double zdx;
-  if (!a) {
-    zdx = d>0.0 ? std::sqrt( ( 2.0 * c * dx ) / d ) : 0.5*dx;//a=0 and d=0 should not really happen...
-  } else {
-    double e = d * c / ( dx * a * a );
-    if (ncabs(e)>1e-7) {
-      //apply formula:
-      zdx = ( std::sqrt( 1.0 + 2.0 * e ) - 1.0 ) * dx * a / d;
-    } else {
-      //calculate via expansion (solves numerical issue when d is near zero):
-      zdx = ( 1 + 0.5 * e * ( e - 1.0 ) ) * c / a;
-    }
-  }
-  return std::pair<double,unsigned>( ncclamp(m_x[i-1] + zdx,m_x[i-1],m_x[i]), i-1 );
+    return std::pair<double,unsigned>(m_x[n-1], n-2);
+  return pwdistInvertBin( m_x.data(), m_y.data(), m_cdf.data(), n, findCDFBin( p ), p );
+}
+
+std::pair<double,unsigned> NC::PointwiseDist::percentileWithIndex( const double * x,
+                                                                   const double * y,
+                                                                   const double * cdf,
+                                                                   std::size_t n,
+                                                                   double p )
+{
+  nc_assert(n>=2);
+  nc_assert(p>=0.&&p<=1.0);
+  if(p==1.)
+    return std::pair<double,unsigned>(x[n-1], n-2);
+  return pwdistInvertBin( x, y, cdf, n, std::lower_bound(cdf, cdf + n, p)-cdf, p );
+}
+
+void NC::PointwiseDist::sampleMany( RNG& rng, Span<double> out ) const
+{
+  if ( out.empty() )
+    return;
+  rng.generateMany( out.data(), out.size() );
+  for ( auto& e : out )
+    e = percentileWithIndex( e ).first;
 }
 
 double NC::PointwiseDist::commulIntegral( double x ) const
@@ -0,0 +1,214 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/internal/NCTabulatedXS.hh"
+#include "NCrystal/internal/NCPowderPattern.hh"
+#include "NCrystal/internal/NCPCBragg.hh"
+#include "NCrystal/internal/NCThreadUtils.hh"
+#include "NCrystal/internal/NCMath.hh"
+#include "NCrystal/NCRNG.hh"
+
+namespace NC = NCrystal;
+namespace NCPI = NCrystal::ProcImpl;
+
+namespace NCrystal {
+  namespace {
+
+    //Incident energies are handled in chunks of this size, each chunk using
+    //its own RNG stream for the background:
+    constexpr std::size_t powderpattern_chunksize = 256;
+
+    void collectComponents( const NCPI::ProcPtr& proc, double scale,
+                            std::vector<NCPI::ProcComposition::Component>& out )
+    {
+      auto pc = dynamic_cast<const NCPI::ProcComposition*>( proc.get() );
+      if ( pc ) {
+        for ( auto& c : pc->components() )
+          collectComponents( c.process, scale * c.scale, out );
+        return;
+      }
+      if ( !proc->isNull() && scale > 0.0 )
+        out.emplace_back( scale, proc );
+    }
+
+    struct ComponentData {
+      double scale;
+      NCPI::ProcPtr process;
+      bool analytic;
+      //Plane tables for analytic components, and the factor by which
+      //energies must be scaled before lookups in them (see PCBraggStrained):
+      VectD v2dE, fdm_commul;
+      double ekinScale;
+    };
+
+    class AngleBinning {
+    public:
+      AngleBinning( const VectD& edges ) : m_edges(edges) {}
+      //Bin index of angle, or nbins() if outside all bins:
+      std::size_t find( double angle ) const
+      {
+        if ( !( angle >= m_edges.front() ) || angle > m_edges.back() )
+          return nbins();
+        std::size_t i = std::upper_bound( m_edges.begin(), m_edges.end(), angle ) - m_edges.begin();
+        return std::min<std::size_t>( i, nbins() ) - 1;//angle==edges.back() goes in the last bin
+      }
+      std::size_t nbins() const { return m_edges.size() - 1; }
+    private:
+      const VectD& m_edges;
+    };
+
+    void addBragg( const ComponentData& cd, const AngleBinning& binning,
+                   double ekin, double weight, double * out )
+    {
+      const double e = ekin * cd.ekinScale;
+      if ( cd.v2dE.empty() || e < cd.v2dE.front() )
+        return;
+      const std::size_t nplanes = std::upper_bound( cd.v2dE.begin(), cd.v2dE.end(), e ) - cd.v2dE.begin();
+      //Cross section of plane i is (fdm_commul[i]-fdm_commul[i-1])/e, and the
+      //scattering angle is 2*theta_bragg with sin^2(theta_bragg)=v2dE[i]/e:
+      const double f = weight * cd.scale / e;
+      double prev = 0.0;
+      for ( std::size_t i = 0; i < nplanes; ++i ) {
+        const double contrib = cd.fdm_commul[i] - prev;
+        prev = cd.fdm_commul[i];
+        const double sinthetasq = std::min( 1.0, cd.v2dE[i] / e );
+        const std::size_t ibin = binning.find( 2.0 * std::asin( std::sqrt( sinthetasq ) ) );
+        if ( ibin < binning.nbins() )
+          out[ibin] += f * contrib;
+      }
+    }
+
+  }
+}
+
+NC::PowderPattern NC::calcPowderPattern( ProcImpl::ProcPtr scatter,
+                                         Span<const double> ekin,
+                                         Span<const double> weights,
+                                         const PowderPatternCfg& cfg )
+{
+  if ( scatter->isOriented() )
+    NCRYSTAL_THROW(BadInput,"calcPowderPattern: only non-oriented processes are supported");
+  if ( ekin.size() != weights.size() )
+    NCRYSTAL_THROW(BadInput,"calcPowderPattern: ekin and weights arrays must have the same size");
+  const VectD& edges = cfg.binEdges;
+  if ( edges.size() < 2 || !( edges.front() >= 0.0 ) || !( edges.back() <= kPi ) )
+    NCRYSTAL_THROW(BadInput,"calcPowderPattern: needs at least two bin edges in [0,pi]");
+  for ( std::size_t i = 1; i < edges.size(); ++i )
+    if ( !( edges[i] > edges[i-1] ) )
+      NCRYSTAL_THROW(BadInput,"calcPowderPattern: bin edges must be increasing");
+  const AngleBinning binning( edges );
+  const std::size_t nbins = binning.nbins();
+
+  //Components:
+  std::vector<NCPI::ProcComposition::Component> flat;
+  collectComponents( scatter, 1.0, flat );
+  std::vector<ComponentData> comps;
+  for ( auto& c : flat ) {
+    ComponentData cd{ c.scale, c.process, false, {}, {}, 1.0 };
+    const PCBragg * pcbragg = dynamic_cast<const PCBragg*>( c.process.get() );
+    auto strained = dynamic_cast<const PCBraggStrained*>( c.process.get() );
+    if ( strained ) {
+      pcbragg = &strained->original();
+      cd.ekinScale = ncsquare( strained->dspacingScale() );
+    }
+    if ( pcbragg ) {
+      cd.analytic = true;
+      cd.v2dE = pcbragg->get2dE();
+      cd.fdm_commul = pcbragg->getFDMCommul();
+    }
+    comps.push_back( std::move(cd) );
+  }
+  const std::size_t ncomp = comps.size();
+
+  PowderPattern result;
+  for ( auto& cd : comps )
+    result.components.push_back( PowderPattern::Component{ cd.process->name(), cd.analytic, VectD( nbins, 0.0 ) } );
+
+  //Process chunks of energies in parallel, in groups of limited size whose
+  //results are added in a fixed order (so results do not depend on the
+  //number of threads):
+  const std::size_t nsamples = cfg.nSamplesBackground;
+  const std::size_t nchunks = ( ekin.size() + powderpattern_chunksize - 1 ) / powderpattern_chunksize;
+  const std::size_t ngroup = 4 * std::max<std::size_t>( 1, cfg.nthreads );
+  std::vector<VectD> chunkresults;
+  for ( std::size_t igroup = 0; igroup < nchunks; igroup += ngroup ) {
+    const std::size_t ngroupchunks = std::min( ngroup, nchunks - igroup );
+    chunkresults.assign( ngroupchunks, VectD( ncomp * nbins, 0.0 ) );
+    parallelForIndex( ngroupchunks, cfg.nthreads, [&]( std::size_t i )
+    {
+      const std::size_t ichunk = igroup + i;
+      const std::size_t ibegin = ichunk * powderpattern_chunksize;
+      const std::size_t iend = std::min<std::size_t>( ibegin + powderpattern_chunksize, ekin.size() );
+      double * out = chunkresults[i].data();
+      Optional<shared_obj<RNGStream>> rng;
+      VectD ekinbuf;
+      std::vector<ScatterOutcomeIsotropic> outcomes;
+      for ( std::size_t icomp = 0; icomp < ncomp; ++icomp ) {
+        const ComponentData& cd = comps[icomp];
+        double * outcomp = out + icomp * nbins;
+        if ( cd.analytic ) {
+          for ( std::size_t ie = ibegin; ie < iend; ++ie )
+            if ( weights[ie] != 0.0 )
+              addBragg( cd, binning, ekin[ie], weights[ie], outcomp );
+          continue;
+        }
+        if ( nsamples == 0 )
+          continue;
+        if ( !rng.has_value() )
+          rng = createBuiltinCounterRNG( cfg.seed, ichunk );
+        CachePtr cp;
+        for ( std::size_t ie = ibegin; ie < iend; ++ie ) {
+          if ( weights[ie] == 0.0 )
+            continue;
+          const double xs = cd.process->crossSectionIsotropic( cp, NeutronEnergy{ ekin[ie] } ).dbl();
+          if ( !( xs > 0.0 ) )
+            continue;
+          ekinbuf.assign( nsamples, ekin[ie] );
+          if ( outcomes.size() < nsamples )
+            outcomes.resize( nsamples, ScatterOutcomeIsotropic{ NeutronEnergy{0.0}, CosineScatAngle{1.0} } );
+          cd.process->sampleScatterIsotropicMany( cp, *rng.value(), ekinbuf.data(), nsamples, outcomes.data() );
+          const double f = weights[ie] * cd.scale * xs / nsamples;
+          for ( std::size_t k = 0; k < nsamples; ++k ) {
+            const double mu = ncclamp( outcomes[k].mu.dbl(), -1.0, 1.0 );
+            const std::size_t ibin = binning.find( std::acos( mu ) );
+            if ( ibin < nbins )
+              outcomp[ibin] += f;
+          }
+        }
+      }
+    } );
+    for ( auto& cr : chunkresults )
+      for ( std::size_t icomp = 0; icomp < ncomp; ++icomp )
+        for ( std::size_t ibin = 0; ibin < nbins; ++ibin )
+          result.components[icomp].values[ibin] += cr[icomp * nbins + ibin];
+  }
+
+  result.total.assign( nbins, 0.0 );
+  result.totalBragg.assign( nbins, 0.0 );
+  result.totalBackground.assign( nbins, 0.0 );
+  for ( auto& c : result.components ) {
+    VectD& t = c.analytic ? result.totalBragg : result.totalBackground;
+    for ( std::size_t ibin = 0; ibin < nbins; ++ibin ) {
+      t[ibin] += c.values[ibin];
+      result.total[ibin] += c.values[ibin];
+    }
+  }
+  return result;
+}
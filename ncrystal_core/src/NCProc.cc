@@ -19,6 +19,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "NCrystal/NCProc.hh"
+#include "NCrystal/internal/NCRandUtils.hh"
 
 namespace NC = NCrystal;
 
@@ -72,6 +73,28 @@ void NC::Scatter::replaceRNGAndUpdateProducer( shared_obj<RNGStream> r )
   m_rng = std::move(r);
 }
 
+void NC::Scatter::sampleScatterManyByIdx( uint64_t seed, const uint64_t* neutronids,
+                                          const double* ekin, const NeutronDirection* dirs,
+                                          std::size_t N, ScatterOutcome* out )
+{
+  RandPhiloxSubstream rng;
+  for ( std::size_t i = 0; i < N; ++i ) {
+    rng.reset( seed, neutronids[i] );
+    out[i] = m_proc->sampleScatter( m_cachePtr, rng, NeutronEnergy{ ekin[i] }, dirs[i] );
+  }
+}
+
+void NC::Scatter::sampleScatterIsotropicManyByIdx( uint64_t seed, const uint64_t* neutronids,
+                                                   const double* ekin, std::size_t N,
+                                                   ScatterOutcomeIsotropic* out )
+{
+  RandPhiloxSubstream rng;
+  for ( std::size_t i = 0; i < N; ++i ) {
+    rng.reset( seed, neutronids[i] );
+    out[i] = m_proc->sampleScatterIsotropic( m_cachePtr, rng, NeutronEnergy{ ekin[i] } );
+  }
+}
+
 NC::Absorption NC::Absorption::clone() const
 {
   return Absorption( m_proc );
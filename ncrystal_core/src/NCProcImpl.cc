@@ -21,10 +21,101 @@
 #include "NCrystal/NCProcImpl.hh"
 #include "NCrystal/internal/NCRandUtils.hh"
 #include "NCrystal/internal/NCString.hh"
+#include "NCrystal/internal/NCMath.hh"
+#include "NCrystal/internal/NCFactoryUtils.hh"
+#include "NCrystal/internal/NCPCBragg.hh"
+#include "NCrystal/internal/NCElIncScatter.hh"
+#include "NCrystal/internal/NCSABScatter.hh"
+#include "NCrystal/internal/NCRuntimeCounters.hh"
+#include "NCrystal/internal/NCTraceZones.hh"
+#include "NCrystal/internal/NCScratchArena.hh"
+#include "NCrystal/internal/NCFlatExport.hh"
+#include <typeinfo>
 
 namespace NC = NCrystal;
 namespace NCPI = NCrystal::ProcImpl;
 
+std::pair<NC::CrossSect,NC::ScatterOutcome> NCPI::Process::crossSectionAndSampleScatter( CachePtr& cp,
+                                                                                      RNG& rng,
+                                                                                      NeutronEnergy ekin,
+                                                                                      const NeutronDirection& dir ) const
+{
+  CrossSect xs = crossSection( cp, ekin, dir );
+  return { xs, sampleScatter( cp, rng, ekin, dir ) };
+}
+
+void NCPI::Process::crossSectionMany( CachePtr& cp,
+                                     const double* ekin,
+                                     const NeutronDirection* dirs,
+                                     std::size_t N,
+                                     double* out_xs ) const
+{
+  for ( std::size_t i = 0; i < N; ++i )
+    out_xs[i] = crossSection( cp, NeutronEnergy{ ekin[i] }, dirs[i] ).dbl();
+}
+
+void NCPI::Process::crossSectionIsotropicMany( CachePtr& cp,
+                                              const double* ekin,
+                                              std::size_t N,
+                                              double* out_xs ) const
+{
+  for ( std::size_t i = 0; i < N; ++i )
+    out_xs[i] = crossSectionIsotropic( cp, NeutronEnergy{ ekin[i] } ).dbl();
+}
+
+void NCPI::Process::sampleScatterMany( CachePtr& cp,
+                                      RNG& rng,
+                                      const double* ekin,
+                                      const NeutronDirection* dirs,
+                                      std::size_t N,
+                                      ScatterOutcome* out ) const
+{
+  for ( std::size_t i = 0; i < N; ++i )
+    out[i] = sampleScatter( cp, rng, NeutronEnergy{ ekin[i] }, dirs[i] );
+}
+
+void NCPI::Process::sampleScatterIsotropicMany( CachePtr& cp,
+                                               RNG& rng,
+                                               const double* ekin,
+                                               std::size_t N,
+                                               ScatterOutcomeIsotropic* out ) const
+{
+  for ( std::size_t i = 0; i < N; ++i )
+    out[i] = sampleScatterIsotropic( cp, rng, NeutronEnergy{ ekin[i] } );
+}
+
+void NCPI::Process::sampleScatterRepeated( CachePtr& cp,
+                                          RNG& rng,
+                                          NeutronEnergy ekin,
+                                          const NeutronDirection& dir,
+                                          std::size_t N,
+                                          ScatterOutcome* out ) const
+{
+  constexpr std::size_t chunksize = 128;
+  const std::size_t nbuf = std::min<std::size_t>( chunksize, N );
+  SmallVector<double,chunksize> buf_ekin;
+  buf_ekin.resize( nbuf, ekin.dbl() );
+  SmallVector<NeutronDirection,chunksize> buf_dirs;
+  buf_dirs.resize( nbuf, dir );
+  for ( std::size_t ioffset = 0; ioffset < N; ioffset += chunksize )
+    sampleScatterMany( cp, rng, buf_ekin.data(), buf_dirs.data(),
+                       std::min<std::size_t>( chunksize, N - ioffset ), out + ioffset );
+}
+
+void NCPI::Process::sampleScatterIsotropicRepeated( CachePtr& cp,
+                                                   RNG& rng,
+                                                   NeutronEnergy ekin,
+                                                   std::size_t N,
+                                                   ScatterOutcomeIsotropic* out ) const
+{
+  constexpr std::size_t chunksize = 128;
+  SmallVector<double,chunksize> buf_ekin;
+  buf_ekin.resize( std::min<std::size_t>( chunksize, N ), ekin.dbl() );
+  for ( std::size_t ioffset = 0; ioffset < N; ioffset += chunksize )
+    sampleScatterIsotropicMany( cp, rng, buf_ekin.data(),
+                                std::min<std::size_t>( chunksize, N - ioffset ), out + ioffset );
+}
+
 NC::ScatterOutcome NCPI::ScatterIsotropicMat::sampleScatter( CachePtr& cp,
                                                              RNG& rng,
                                                              NeutronEnergy ekin,
@@ -35,6 +126,68 @@ NC::ScatterOutcome NCPI::ScatterIsotropicMat::sampleScatter( CachePtr& cp,
   return { outcome_isotropic.ekin, outdir };
 }
 
+void NCPI::ScatterIsotropicMat::sampleScatterMany( CachePtr& cp,
+                                                  RNG& rng,
+                                                  const double* ekin,
+                                                  const NeutronDirection* dirs,
+                                                  std::size_t N,
+                                                  ScatterOutcome* out ) const
+{
+  //Sample chunks of isotropic outcomes, and convert all mu values in a chunk
+  //to directions at once:
+  constexpr std::size_t chunksize = 128;
+  SmallVector<ScatterOutcomeIsotropic,chunksize> buf_iso;
+  buf_iso.resize( std::min<std::size_t>( chunksize, N ) );
+  double mu[chunksize], x[chunksize], y[chunksize], z[chunksize];
+  for ( std::size_t ioffset = 0; ioffset < N; ioffset += chunksize ) {
+    const std::size_t n = std::min<std::size_t>( chunksize, N - ioffset );
+    sampleScatterIsotropicMany( cp, rng, ekin + ioffset, n, buf_iso.data() );
+    for ( std::size_t j = 0; j < n; ++j ) {
+      const auto& d = dirs[ioffset+j];
+      mu[j] = buf_iso[j].mu.dbl();
+      x[j] = d[0];
+      y[j] = d[1];
+      z[j] = d[2];
+    }
+    randDirectionsGivenScatterMu( rng, n, mu, x, y, z, x, y, z );
+    for ( std::size_t j = 0; j < n; ++j ) {
+      auto& o = out[ioffset+j];
+      o.ekin = buf_iso[j].ekin;
+      o.direction = NeutronDirection{ x[j], y[j], z[j] };
+    }
+  }
+}
+
+void NCPI::ScatterIsotropicMat::sampleScatterRepeated( CachePtr& cp,
+                                                      RNG& rng,
+                                                      NeutronEnergy ekin,
+                                                      const NeutronDirection& dir,
+                                                      std::size_t N,
+                                                      ScatterOutcome* out ) const
+{
+  //As sampleScatterMany, but with sampleScatterIsotropicRepeated:
+  constexpr std::size_t chunksize = 128;
+  SmallVector<ScatterOutcomeIsotropic,chunksize> buf_iso;
+  buf_iso.resize( std::min<std::size_t>( chunksize, N ) );
+  double mu[chunksize], x[chunksize], y[chunksize], z[chunksize];
+  for ( std::size_t ioffset = 0; ioffset < N; ioffset += chunksize ) {
+    const std::size_t n = std::min<std::size_t>( chunksize, N - ioffset );
+    sampleScatterIsotropicRepeated( cp, rng, ekin, n, buf_iso.data() );
+    for ( std::size_t j = 0; j < n; ++j ) {
+      mu[j] = buf_iso[j].mu.dbl();
+      x[j] = dir[0];
+      y[j] = dir[1];
+      z[j] = dir[2];
+    }
+    randDirectionsGivenScatterMu( rng, n, mu, x, y, z, x, y, z );
+    for ( std::size_t j = 0; j < n; ++j ) {
+      auto& o = out[ioffset+j];
+      o.ekin = buf_iso[j].ekin;
+      o.direction = NeutronDirection{ x[j], y[j], z[j] };
+    }
+  }
+}
+
 NC::CrossSect NCPI::ScatterAnisotropicMat::crossSectionIsotropic( CachePtr&, NeutronEnergy ) const
 {
   NCRYSTAL_THROW(LogicError,"Process::crossSectionIsotropic can only be called for isotropic materials.");
@@ -81,37 +234,364 @@ NC::ScatterOutcome NC::ProcImpl::NullProcess::sampleScatter( CachePtr&,
   return { ekin, dir };
 }
 
+namespace NCrystal {
+  namespace {
+
+    class CacheArena : private NoCopyMove {
+      //Memory block from which CacheBase::operator new allocates objects while
+      //the arena is active (via Scope objects) in the current thread. Memory
+      //is only reclaimed when the arena is destroyed or reset, so the arena
+      //must outlive all objects allocated in it. Allocations not fitting in
+      //the remaining space go to the heap.
+    public:
+      void reset( std::size_t capacity )
+      {
+        m_used = 0;
+        const std::size_t nblocks = ( capacity + blocksize - 1 ) / blocksize;
+        if ( nblocks != m_nblocks ) {
+          m_data.reset( nblocks ? new std::max_align_t[nblocks] : nullptr );
+          m_nblocks = nblocks;
+        }
+      }
+
+      void* allocate( std::size_t n )
+      {
+        const std::size_t nb = ( n + blocksize - 1 ) / blocksize;
+        if ( nb > m_nblocks - m_used )
+          return nullptr;
+        void * p = m_data.get() + m_used;
+        m_used += nb;
+        return p;
+      }
+
+      static constexpr std::size_t blocksize = sizeof(std::max_align_t);
+
+      static CacheArena*& active()
+      {
+        static thread_local CacheArena* s_active = nullptr;
+        return s_active;
+      }
+
+      class Scope : private NoCopyMove {
+        CacheArena* m_prev;
+      public:
+        Scope( CacheArena& a ) : m_prev(active()) { active() = &a; }
+        ~Scope() { active() = m_prev; }
+      };
+
+    private:
+      std::unique_ptr<std::max_align_t[]> m_data;
+      std::size_t m_nblocks = 0;
+      std::size_t m_used = 0;
+    };
+
+    //Objects are preceded by a header (keeping the alignment), marking
+    //whether they live on the heap or in an arena:
+    constexpr std::size_t cacheAllocHeaderSize = alignof(std::max_align_t);
+    static_assert( cacheAllocHeaderSize >= 1, "" );
+    enum class CacheAllocType : unsigned char { Heap = 1, Arena = 2 };
+  }
+}
+
+void* NC::CacheBase::operator new( std::size_t n )
+{
+  const std::size_t ntot = n + cacheAllocHeaderSize;
+  CacheAllocType t = CacheAllocType::Arena;
+  void * p = ( CacheArena::active() ? CacheArena::active()->allocate( ntot ) : nullptr );
+  if ( !p ) {
+    t = CacheAllocType::Heap;
+    p = ::operator new( ntot );
+  }
+  *static_cast<CacheAllocType*>(p) = t;
+  return static_cast<unsigned char*>(p) + cacheAllocHeaderSize;
+}
+
+void NC::CacheBase::operator delete( void* p ) noexcept
+{
+  if ( !p )
+    return;
+  void * pp = static_cast<unsigned char*>(p) - cacheAllocHeaderSize;
+  if ( *static_cast<CacheAllocType*>(pp) == CacheAllocType::Heap )
+    ::operator delete( pp );
+  //Nothing to do for arena memory, which is reclaimed along with the arena.
+}
+
 namespace NCrystal {
   namespace ProcImpl {
 
+    namespace {
+      //Typical ProcComposition instances (as created by the standard scatter
+      //factory) combine a fixed set of model types like PCBragg, ElIncScatter
+      //and SABScatter. Components of these (final) types are recognised once
+      //when the cache is set up, and calls to them in the hot paths below are
+      //then dispatched statically rather than through the vtable:
+      enum class CompKind : unsigned char { Generic, PCBragg, ElIncScatter, SABScatter };
+
+      CompKind classifyComponent( const Process& p )
+      {
+        const auto& t = typeid(p);
+        if ( t == typeid(PCBragg) )
+          return CompKind::PCBragg;
+        if ( t == typeid(ElIncScatter) )
+          return CompKind::ElIncScatter;
+        if ( t == typeid(SABScatter) )
+          return CompKind::SABScatter;
+        return CompKind::Generic;
+      }
+
+      template<class TProc>
+      struct CompCall {
+        static CrossSect xsIso( const Process& p, CachePtr& cp, NeutronEnergy ekin )
+        {
+          return static_cast<const TProc&>(p).crossSectionIsotropic( cp, ekin );
+        }
+        static ScatterOutcomeIsotropic sampleIso( const Process& p, CachePtr& cp, RNG& rng, NeutronEnergy ekin )
+        {
+          return static_cast<const TProc&>(p).sampleScatterIsotropic( cp, rng, ekin );
+        }
+        static ScatterOutcome sample( const Process& p, CachePtr& cp, RNG& rng,
+                                      NeutronEnergy ekin, const NeutronDirection& dir )
+        {
+          return static_cast<const TProc&>(p).sampleScatter( cp, rng, ekin, dir );
+        }
+      };
+
+      CrossSect compCrossSectionIsotropic( CompKind k, const Process& p, CachePtr& cp, NeutronEnergy ekin )
+      {
+        switch ( k ) {
+        case CompKind::PCBragg: return CompCall<PCBragg>::xsIso( p, cp, ekin );
+        case CompKind::ElIncScatter: return CompCall<ElIncScatter>::xsIso( p, cp, ekin );
+        case CompKind::SABScatter: return CompCall<SABScatter>::xsIso( p, cp, ekin );
+        default: return p.crossSectionIsotropic( cp, ekin );
+        }
+      }
+
+      ScatterOutcomeIsotropic compSampleScatterIsotropic( CompKind k, const Process& p, CachePtr& cp,
+                                                          RNG& rng, NeutronEnergy ekin )
+      {
+        switch ( k ) {
+        case CompKind::PCBragg: return CompCall<PCBragg>::sampleIso( p, cp, rng, ekin );
+        case CompKind::ElIncScatter: return CompCall<ElIncScatter>::sampleIso( p, cp, rng, ekin );
+        case CompKind::SABScatter: return CompCall<SABScatter>::sampleIso( p, cp, rng, ekin );
+        default: return p.sampleScatterIsotropic( cp, rng, ekin );
+        }
+      }
+
+      ScatterOutcome compSampleScatter( CompKind k, const Process& p, CachePtr& cp, RNG& rng,
+                                        NeutronEnergy ekin, const NeutronDirection& dir )
+      {
+        switch ( k ) {
+        case CompKind::PCBragg: return CompCall<PCBragg>::sample( p, cp, rng, ekin, dir );
+        case CompKind::ElIncScatter: return CompCall<ElIncScatter>::sample( p, cp, rng, ekin, dir );
+        case CompKind::SABScatter: return CompCall<SABScatter>::sample( p, cp, rng, ekin, dir );
+        default: return p.sampleScatter( cp, rng, ekin, dir );
+        }
+      }
+    }
+
     class CacheProcComp final : public CacheBase {
     public:
-      void invalidateCache() override { key_ekin = NeutronEnergy{-1.0}; }
+      void invalidateCache() override
+      {
+        cur.key_ekin = NeutronEnergy{-1.0};
+        for ( auto& e : prev )
+          e.key_ekin = NeutronEnergy{-1.0};
+      }
 
       unsigned nHistory = 0;
-      NeutronEnergy key_ekin = NeutronEnergy{-1.0};
-      NeutronDirection key_dir = NeutronDirection{0.,0.,0.};//only used for anisotropic materials
-      double tot_xs = -1.0;
+
+      //Cross sections are remembered for the most recent (energy,direction)
+      //values, since calling code often alternates between a few neutron
+      //states (e.g. Geant4 asking for cross sections before and after other
+      //processes acted, or when a neutron crosses a boundary):
+      struct XSEntry {
+        NeutronEnergy key_ekin = NeutronEnergy{-1.0};
+        NeutronDirection key_dir = NeutronDirection{0.,0.,0.};//only used for anisotropic materials
+        double tot_xs = -1.0;
+        SmallVector<double,6> componentXSectCommul;
+        void swap( XSEntry& o ) noexcept
+        {
+          std::swap( key_ekin, o.key_ekin );
+          std::swap( key_dir, o.key_dir );
+          std::swap( tot_xs, o.tot_xs );
+          componentXSectCommul.swap( o.componentXSectCommul );
+        }
+        void reset( std::size_t ncomp )
+        {
+          key_ekin = NeutronEnergy{-1.0};
+          key_dir = NeutronDirection{0.,0.,0.};
+          tot_xs = -1.0;
+          componentXSectCommul.clear();
+          componentXSectCommul.resize(ncomp,0.0);
+        }
+      };
+      static constexpr unsigned nPrevEntries = 3;
+      XSEntry cur;//most recently used entry
+      std::array<XSEntry,nPrevEntries> prev;//previous entries, most recent first
+
+      //Make prev[k] the current entry, keeping the others in order of use:
+      void promote( unsigned k ) noexcept
+      {
+        nc_assert( k < nPrevEntries );
+        for ( unsigned i = 0; i <= k; ++i )
+          cur.swap( prev[i] );
+      }
+
       struct ComponentCache {
         CachePtr cachePtr;
         EnergyDomain domain;
+        CompKind kind;
+        //Components not advertising batch capabilities are called neutron by
+        //neutron in the batched methods, avoiding the gathering of inputs:
+        bool batchXS;
+        bool batchSampling;
       };
+      //Component caches are created (by the components) in the arena while
+      //it is activated in calls to the components. It is declared before the
+      //componentCache member, in order to outlive the objects:
+      CacheArena arena;
       SmallVector<ComponentCache,6> componentCache;
-      SmallVector<double,6> componentXSectCommul;
+      //Temporary buffers of the batched methods:
+      ScratchArena scratch;
 
       void reset(unsigned nhist,const ProcComposition::ComponentList& comps) {
         nHistory = nhist;
-        key_ekin = NeutronEnergy{-1.0};
-        key_dir = NeutronDirection{0.,0.,0.};
-        tot_xs = -1.0;
+        cur.reset( comps.size() );
+        for ( auto& e : prev )
+          e.reset( comps.size() );
         componentCache.clear();
+        //Room for typical component caches (larger ones go on the heap). No
+        //room is needed for stateless components, which never create caches:
+        std::size_t nstateful = 0;
+        for ( auto& e : comps )
+          if ( !e.process->isStateless() )
+            ++nstateful;
+        arena.reset( nstateful * arenaBytesPerComponent );
         componentCache.reserve_hint(comps.size());
         for ( auto e : comps )
-          componentCache.push_back({{nullptr},e.process->domain()});
-        componentXSectCommul.clear();
-        componentXSectCommul.resize(comps.size(),0.0);
+          componentCache.push_back({{nullptr},e.process->domain(),classifyComponent(*e.process),
+                                    e.process->hasCapability(Process::CapBatchCrossSection),
+                                    e.process->hasCapability(Process::CapBatchSampling)});
       }
       CacheProcComp() { reset(nHistory,{}); }
+      static constexpr std::size_t arenaBytesPerComponent = 256;
+    };
+
+    namespace {
+      //Number of neutrons processed at a time in batched ProcComposition methods:
+      constexpr std::size_t chunksize = 128;
+    }
+
+    class ProcComposition::Tabulation {
+    public:
+      //Commulative component cross sections (scaled), tabulated at the points
+      //of an energy grid, with ncomp values per grid point (so the last of
+      //these is the total cross section):
+      unsigned ncomp = 0;
+      VectD egrid;
+      VectD commul;
+
+      bool covers( double ekin ) const
+      {
+        return ekin >= egrid.front() && ekin <= egrid.back();
+      }
+
+      std::pair<std::size_t,double> findBin( double ekin ) const
+      {
+        //Returns bin index, i, and the fraction t for interpolation between
+        //grid points i and i+1:
+        nc_assert( covers(ekin) && egrid.size() >= 2 );
+        std::size_t i = std::upper_bound( egrid.begin(), egrid.end(), ekin ) - egrid.begin();
+        i = ( i == 0 ? 0 : std::min<std::size_t>( i - 1, egrid.size() - 2 ) );
+        const double e0 = egrid[i];
+        const double t = ( ekin - e0 ) / ( egrid[i+1] - e0 );
+        return { i, t };
+      }
+
+      double evalTotal( double ekin ) const
+      {
+        auto bin = findBin( ekin );
+        const double * c = &commul[ ( bin.first + 1 ) * ncomp - 1 ];
+        return c[0] + bin.second * ( c[ncomp] - c[0] );
+      }
+
+      void evalCommul( double ekin, double * out ) const
+      {
+        auto bin = findBin( ekin );
+        const double * c = &commul[ bin.first * ncomp ];
+        for ( unsigned i = 0; i < ncomp; ++i )
+          out[i] = c[i] + bin.second * ( c[ncomp+i] - c[i] );
+      }
+    };
+
+    class ProcComposition::DomainIntervals {
+    public:
+      //The finite edges of all component domains, sorted and without
+      //duplicates, define breakpoints.size()+1 intervals, where interval k
+      //covers energies in [breakpoints[k-1],breakpoints[k]) (with the obvious
+      //modifications for the first and last interval). For each interval, the
+      //(increasing) indices of components for which the domain overlaps the
+      //interval are listed in active[offsets[k]..offsets[k+1]), and are also
+      //marked in the flags[k*ncomp+i] array. The listed components must still
+      //check their domains, since a domain ending exactly at the lower edge of
+      //an interval is considered overlapping:
+      unsigned ncomp = 0;
+      VectD breakpoints;
+      std::vector<unsigned> offsets;
+      std::vector<unsigned> active;
+      std::vector<unsigned char> flags;
+
+      std::size_t findInterval( double ekin ) const
+      {
+        return std::upper_bound( breakpoints.begin(), breakpoints.end(), ekin ) - breakpoints.begin();
+      }
+
+      Span<const unsigned> activeComponents( std::size_t k ) const
+      {
+        nc_assert( k + 1 < offsets.size() );
+        return { active.data() + offsets[k], active.data() + offsets[k+1] };
+      }
+
+      bool isActive( std::size_t k, unsigned icomp ) const
+      {
+        nc_assert( icomp < ncomp && k * ncomp + icomp < flags.size() );
+        return flags[ k * ncomp + icomp ] != 0;
+      }
+
+      DomainIntervals( const ComponentList& comps )
+        : ncomp( static_cast<unsigned>( comps.size() ) )
+      {
+        for ( auto& c : comps ) {
+          const auto d = c.process->domain();
+          for ( double e : { d.elow.dbl(), d.ehigh.dbl() } )
+            if ( std::isfinite( e ) )
+              breakpoints.push_back( e );
+        }
+        std::sort( breakpoints.begin(), breakpoints.end() );
+        breakpoints.erase( std::unique( breakpoints.begin(), breakpoints.end() ), breakpoints.end() );
+        const std::size_t nintervals = breakpoints.size() + 1;
+        offsets.reserve( nintervals + 1 );
+        flags.resize( nintervals * ncomp, 0 );
+        for ( std::size_t k = 0; k < nintervals; ++k ) {
+          offsets.push_back( static_cast<unsigned>( active.size() ) );
+          const double lower = ( k == 0 ? -kInfinity : breakpoints[k-1] );
+          const double upper = ( k == nintervals - 1 ? kInfinity : breakpoints[k] );
+          for ( unsigned i = 0; i < ncomp; ++i ) {
+            const auto d = comps[i].process->domain();
+            if ( d.elow.dbl() < upper && d.ehigh.dbl() >= lower ) {
+              active.push_back( i );
+              flags[ k * ncomp + i ] = 1;
+            }
+          }
+        }
+        offsets.push_back( static_cast<unsigned>( active.size() ) );
+      }
+
+      std::size_t memoryFootprint() const
+      {
+        return ( sizeof(DomainIntervals) + breakpoints.capacity() * sizeof(double)
+                 + ( offsets.capacity() + active.capacity() ) * sizeof(unsigned) + flags.capacity() );
+      }
     };
 
     class ProcComposition::Impl {
@@ -128,10 +608,38 @@ namespace NCrystal {
           cache.reset(THIS->m_nHistory,THIS->m_components);
         }
         nc_assert(cache.componentCache.size()==THIS->m_components.size());
-        nc_assert(cache.componentXSectCommul.size()==THIS->m_components.size());
+        nc_assert(cache.cur.componentXSectCommul.size()==THIS->m_components.size());
         return cache;
       }
 
+      template<class TCompXS>
+      static void evalCommulXS( const ProcComposition* THIS,
+                                CacheProcComp& cache,
+                                NeutronEnergy ekin,
+                                CacheProcComp::XSEntry& entry,
+                                TCompXS&& compXS )
+      {
+        //Fill the commulative (scaled) component cross sections of the entry,
+        //only visiting the components which are active at ekin:
+        nc_assert( THIS->m_domainIntervals != nullptr );
+        const auto& di = *THIS->m_domainIntervals;
+        const unsigned ncomp = THIS->m_components.size();
+        double * commul = entry.componentXSectCommul.data();
+        double tot = 0.0;
+        unsigned inext = 0;
+        for ( unsigned i : di.activeComponents( di.findInterval( ekin.dbl() ) ) ) {
+          for ( ; inext < i; ++inext )
+            commul[inext] = tot;
+          if ( cache.componentCache[i].domain.contains(ekin) )
+            tot += THIS->m_components[i].scale * compXS( i ).dbl();
+          commul[i] = tot;
+          inext = i + 1;
+        }
+        for ( ; inext < ncomp; ++inext )
+          commul[inext] = tot;
+        entry.tot_xs = tot;
+      }
+
       static CacheProcComp& updateCacheIsotropic( const ProcComposition* THIS,
                                                   CachePtr& cacheptr,
                                                   NeutronEnergy ekin )
@@ -140,35 +648,54 @@ namespace NCrystal {
         nc_assert(ekin.dbl()>=0.0);
         nc_assert(THIS->m_domain.contains(ekin) );
         auto& cache = initAndAccessCache(THIS,cacheptr);
-        nc_assert(cache.key_dir.as<Vector>().isStrictNullVector());//no mixing between anisotropic and isotropic cache.
+        nc_assert(cache.cur.key_dir.as<Vector>().isStrictNullVector());//no mixing between anisotropic and isotropic cache.
 
-        //Compare cached ekin to provided value.
-        if ( cache.key_ekin == ekin )
-          return cache;
-
-        //Try a bit more FP-sensible cache checking, in case 80-bit registers
-        //are somehow messing up stuff (although it is rather unlikely that they
+        //Compare cached ekin values to provided value. Try a bit more
+        //FP-sensible cache checking as well, in case 80-bit registers are
+        //somehow messing up stuff (although it is rather unlikely that they
         //will given the non-inlined source of ekin):
-        if ( floateq(cache.key_ekin.dbl(),ekin.dbl(),1e-15,0.0) )
+        auto keyMatches = [ekin]( const CacheProcComp::XSEntry& e )
+        {
+          return e.key_ekin == ekin || floateq(e.key_ekin.dbl(),ekin.dbl(),1e-15,0.0);
+        };
+        if ( keyMatches( cache.cur ) ) {
+          NCRYSTAL_RTCOUNT(CacheHits);
           return cache;
+        }
+        for ( unsigned k = 0; k < CacheProcComp::nPrevEntries; ++k ) {
+          if ( keyMatches( cache.prev[k] ) ) {
+            NCRYSTAL_RTCOUNT(CacheHits);
+            cache.promote( k );
+            return cache;
+          }
+        }
 
-        //Ok, cache was not valid!
-        cache.key_ekin = NeutronEnergy{-1.0};//put to invalid value while
+        //Ok, cache was not valid! Recycle the least recently used entry:
+        NCRYSTAL_RTCOUNT(CacheMisses);
+        cache.promote( CacheProcComp::nPrevEntries - 1 );
+        auto& entry = cache.cur;
+        entry.key_ekin = NeutronEnergy{-1.0};//put to invalid value while
                                              //updating for exception safety.
 
-        unsigned ncomp = THIS->m_components.size();
-        cache.tot_xs = 0.0;
-        for ( unsigned i = 0; i < ncomp; ++ i ) {
-          auto comp = THIS->m_components[i];
-          auto& compCache = cache.componentCache[i];
-          CrossSect xs = ( compCache.domain.contains(ekin)
-                           ? comp.process->crossSectionIsotropic(compCache.cachePtr,ekin)
-                           : CrossSect{0.0} );
-          cache.componentXSectCommul[i] = ( cache.tot_xs += ( comp.scale * xs.dbl() ) );
+        if ( THIS->m_tab != nullptr && THIS->m_tab->covers( ekin.dbl() ) ) {
+          //Tabulated mode:
+          THIS->m_tab->evalCommul( ekin.dbl(), entry.componentXSectCommul.data() );
+          entry.tot_xs = entry.componentXSectCommul.back();
+          entry.key_ekin = ekin;
+          return cache;
         }
 
+        CacheArena::Scope arenascope( cache.arena );
+        evalCommulXS( THIS, cache, ekin, entry,
+                      [&cache,THIS,ekin]( unsigned i )
+                      {
+                        auto& compCache = cache.componentCache[i];
+                        return compCrossSectionIsotropic( compCache.kind, *THIS->m_components[i].process,
+                                                          compCache.cachePtr, ekin );
+                      } );
+
         //All ok:
-        cache.key_ekin = ekin;
+        entry.key_ekin = ekin;
         return cache;
       }
 
@@ -182,41 +709,331 @@ namespace NCrystal {
         nc_assert(THIS->m_domain.contains(ekin) );
         auto& cache = initAndAccessCache(THIS,cacheptr);
 
-        //Compare cached ekin to provided value.
-        if ( cache.key_ekin == ekin && cache.key_dir == dir )
-          return cache;
-
-        //Try a bit more FP-sensible cache checking, in case 80-bit registers
-        //are somehow messing up stuff (although it is rather unlikely that they
+        //Compare cached ekin and dir values to provided values. Try a bit more
+        //FP-sensible cache checking as well, in case 80-bit registers are
+        //somehow messing up stuff (although it is rather unlikely that they
         //will given the non-inlined source of ekin):
-        auto cmpfloat = [](double a,double b){ return floateq(a,b,1e-15,0.0); };
-        if ( cmpfloat( cache.key_ekin.dbl(),ekin.dbl() )
-             && cmpfloat( cache.key_dir[0],dir[0] )
-             && cmpfloat( cache.key_dir[1],dir[1] )
-             && cmpfloat( cache.key_dir[2],dir[2] ) )
+        auto keyMatches = [ekin,&dir]( const CacheProcComp::XSEntry& e )
+        {
+          if ( e.key_ekin == ekin && e.key_dir == dir )
+            return true;
+          auto cmpfloat = [](double a,double b){ return floateq(a,b,1e-15,0.0); };
+          return ( cmpfloat( e.key_ekin.dbl(),ekin.dbl() )
+                   && cmpfloat( e.key_dir[0],dir[0] )
+                   && cmpfloat( e.key_dir[1],dir[1] )
+                   && cmpfloat( e.key_dir[2],dir[2] ) );
+        };
+        if ( keyMatches( cache.cur ) ) {
+          NCRYSTAL_RTCOUNT(CacheHits);
           return cache;
+        }
+        for ( unsigned k = 0; k < CacheProcComp::nPrevEntries; ++k ) {
+          if ( keyMatches( cache.prev[k] ) ) {
+            NCRYSTAL_RTCOUNT(CacheHits);
+            cache.promote( k );
+            return cache;
+          }
+        }
 
-        //Ok, cache was not valid!
-        cache.key_ekin = NeutronEnergy{-1.0};//put to invalid value while
+        //Ok, cache was not valid! Recycle the least recently used entry:
+        NCRYSTAL_RTCOUNT(CacheMisses);
+        cache.promote( CacheProcComp::nPrevEntries - 1 );
+        auto& entry = cache.cur;
+        entry.key_ekin = NeutronEnergy{-1.0};//put to invalid value while
                                              //updating for exception safety.
 
-        unsigned ncomp = THIS->m_components.size();
-        cache.tot_xs = 0.0;
+        CacheArena::Scope arenascope( cache.arena );
+        evalCommulXS( THIS, cache, ekin, entry,
+                      [&cache,THIS,ekin,&dir]( unsigned i )
+                      {
+                        return THIS->m_components[i].process->crossSection( cache.componentCache[i].cachePtr,
+                                                                             ekin, dir );
+                      } );
+
+        //All ok:
+        entry.key_ekin = ekin;
+        entry.key_dir = dir;
+        return cache;
+      }
+
+      static void evalCommulXSChunk( const ProcComposition* THIS,
+                                     CacheProcComp& cache,
+                                     const double* ekin,
+                                     const NeutronDirection* dirs,
+                                     std::size_t n,
+                                     double* out_commul )
+      {
+        //For a chunk of n<=chunksize neutrons, fill out_commul[j*ncomp+i] with
+        //the commulative (scaled) cross section of components 0..i for neutron
+        //j. Each component is asked to evaluate cross sections for all
+        //neutrons inside its domain in one batched call. A null dirs pointer
+        //indicates isotropic evaluation. Sums are accumulated in the same order
+        //as in updateCacheIsotropic/updateCacheAnisotropic, so results are
+        //identical to those of the single-neutron methods (the cached state of
+        //the latter is not touched).
+        nc_assert( n <= chunksize );
+        const unsigned ncomp = THIS->m_components.size();
+        double buf_ekin[chunksize];
+        double buf_xs[chunksize];
+        std::size_t buf_idx[chunksize];
+        bool from_table[chunksize];
+        SmallVector<NeutronDirection,chunksize> buf_dirs;
+        if ( dirs )
+          buf_dirs.resize( n );
+        const Tabulation * tab = ( dirs ? nullptr : THIS->m_tab.get() );
+        nc_assert( THIS->m_domainIntervals != nullptr );
+        const auto& di = *THIS->m_domainIntervals;
+        std::size_t interval[chunksize];
+        for ( std::size_t j = 0; j < n; ++j ) {
+          from_table[j] = tab && tab->covers( ekin[j] );
+          if ( from_table[j] )
+            tab->evalCommul( ekin[j], out_commul + j*ncomp );
+          else
+            interval[j] = di.findInterval( ekin[j] );
+        }
         for ( unsigned i = 0; i < ncomp; ++ i ) {
-          auto comp = THIS->m_components[i];
+          auto& comp = THIS->m_components[i];
           auto& compCache = cache.componentCache[i];
-          CrossSect xs = ( compCache.domain.contains(ekin)
-                           ? comp.process->crossSection(compCache.cachePtr,ekin,dir)
-                           : CrossSect{0.0} );
-          cache.componentXSectCommul[i] = ( cache.tot_xs += ( comp.scale * xs.get() ) );
+          if ( !compCache.batchXS ) {
+            for ( std::size_t j = 0; j < n; ++j ) {
+              if ( from_table[j] )
+                continue;
+              double& c = out_commul[j*ncomp+i];
+              c = ( i ? out_commul[j*ncomp+i-1] : 0.0 );
+              if ( di.isActive( interval[j], i ) && compCache.domain.contains( NeutronEnergy{ ekin[j] } ) )
+                c += comp.scale * ( dirs
+                                    ? comp.process->crossSection( compCache.cachePtr, NeutronEnergy{ ekin[j] }, dirs[j] )
+                                    : compCrossSectionIsotropic( compCache.kind, *comp.process, compCache.cachePtr,
+                                                                 NeutronEnergy{ ekin[j] } ) ).dbl();
+            }
+            continue;
+          }
+          std::size_t nsel = 0;
+          for ( std::size_t j = 0; j < n; ++j ) {
+            if ( from_table[j] )
+              continue;
+            out_commul[j*ncomp+i] = ( i ? out_commul[j*ncomp+i-1] : 0.0 );
+            if ( di.isActive( interval[j], i ) && compCache.domain.contains( NeutronEnergy{ ekin[j] } ) ) {
+              buf_idx[nsel] = j;
+              buf_ekin[nsel] = ekin[j];
+              if ( dirs )
+                buf_dirs[nsel] = dirs[j];
+              ++nsel;
+            }
+          }
+          if ( !nsel )
+            continue;
+          if ( dirs )
+            comp.process->crossSectionMany( compCache.cachePtr, buf_ekin, buf_dirs.data(), nsel, buf_xs );
+          else
+            comp.process->crossSectionIsotropicMany( compCache.cachePtr, buf_ekin, nsel, buf_xs );
+          const double scale = comp.scale;
+          for ( std::size_t j = 0; j < nsel; ++j )
+            out_commul[buf_idx[j]*ncomp+i] += scale * buf_xs[j];
         }
+      }
 
-        //All ok:
-        cache.key_ekin = ekin;
-        cache.key_dir = dir;
-        return cache;
+      static void crossSectionMany( const ProcComposition* THIS,
+                                    CachePtr& cacheptr,
+                                    const double* ekin,
+                                    const NeutronDirection* dirs,
+                                    std::size_t N,
+                                    double* out_xs )
+      {
+        std::fill( out_xs, out_xs + N, 0.0 );
+        if ( N == 0 || THIS->isNull() )
+          return;
+        auto& cache = initAndAccessCache(THIS,cacheptr);
+        const unsigned ncomp = THIS->m_components.size();
+        ScratchArena::Scope scratchScope( cache.scratch );
+        double * commul = cache.scratch.allocate<double>( ncomp * std::min<std::size_t>( chunksize, N ) );
+        for ( std::size_t ioffset = 0; ioffset < N; ioffset += chunksize ) {
+          const std::size_t n = std::min<std::size_t>( chunksize, N - ioffset );
+          evalCommulXSChunk( THIS, cache, ekin + ioffset, ( dirs ? dirs + ioffset : nullptr ), n, commul );
+          for ( std::size_t j = 0; j < n; ++j )
+            out_xs[ioffset+j] = commul[j*ncomp+ncomp-1];
+        }
+      }
+
+      //Helpers for sampleScatterMany below:
+      static void sampleComponentMany( const Process& p, CachePtr& cp, RNG& rng,
+                                       const double* ekin, const NeutronDirection* dirs,
+                                       std::size_t n, ScatterOutcome* out )
+      {
+        p.sampleScatterMany( cp, rng, ekin, dirs, n, out );
       }
 
+      static void sampleComponentMany( const Process& p, CachePtr& cp, RNG& rng,
+                                       const double* ekin, const NeutronDirection*,
+                                       std::size_t n, ScatterOutcomeIsotropic* out )
+      {
+        p.sampleScatterIsotropicMany( cp, rng, ekin, n, out );
+      }
+
+      static void sampleComponentSingle( CompKind k, const Process& p, CachePtr& cp, RNG& rng,
+                                         double ekin, const NeutronDirection* dir, ScatterOutcome& out )
+      {
+        out = compSampleScatter( k, p, cp, rng, NeutronEnergy{ ekin }, *dir );
+      }
+
+      static void sampleComponentSingle( CompKind k, const Process& p, CachePtr& cp, RNG& rng,
+                                         double ekin, const NeutronDirection*, ScatterOutcomeIsotropic& out )
+      {
+        out = compSampleScatterIsotropic( k, p, cp, rng, NeutronEnergy{ ekin } );
+      }
+
+      static void setUnscattered( double ekin, const NeutronDirection* dir, ScatterOutcome& out )
+      {
+        out.ekin = NeutronEnergy{ ekin };
+        out.direction = *dir;
+      }
+
+      static void setUnscattered( double ekin, const NeutronDirection*, ScatterOutcomeIsotropic& out )
+      {
+        out.ekin = NeutronEnergy{ ekin };
+        out.mu = CosineScatAngle{ 1.0 };
+      }
+
+      static void sampleComponentRepeated( const Process& p, CachePtr& cp, RNG& rng, NeutronEnergy ekin,
+                                           const NeutronDirection* dir, std::size_t n, ScatterOutcome* out )
+      {
+        p.sampleScatterRepeated( cp, rng, ekin, *dir, n, out );
+      }
+
+      static void sampleComponentRepeated( const Process& p, CachePtr& cp, RNG& rng, NeutronEnergy ekin,
+                                           const NeutronDirection*, std::size_t n, ScatterOutcomeIsotropic* out )
+      {
+        p.sampleScatterIsotropicRepeated( cp, rng, ekin, n, out );
+      }
+
+      template<class TOutcome>
+      static void sampleScatterRepeated( const ProcComposition* THIS,
+                                         CachePtr& cacheptr,
+                                         RNG& rng,
+                                         NeutronEnergy ekin,
+                                         const NeutronDirection* dir,
+                                         std::size_t N,
+                                         TOutcome* out )
+      {
+        //Like sampleScatterMany below, but the component cross sections are
+        //only evaluated (or found in the cache) once:
+        if ( N == 0 )
+          return;
+        if ( THIS->isNull() || !THIS->m_domain.contains( ekin ) ) {
+          for ( std::size_t j = 0; j < N; ++j )
+            setUnscattered( ekin.dbl(), dir, out[j] );
+          return;
+        }
+        auto& cache = ( THIS->m_materialType == MaterialType::Anisotropic
+                        ? updateCacheAnisotropic( THIS, cacheptr, ekin, *dir )
+                        : updateCacheIsotropic( THIS, cacheptr, ekin ) );
+        const unsigned ncomp = THIS->m_components.size();
+        SmallVector<double,8> commul( SVAllowCopy, cache.cur.componentXSectCommul.begin(),
+                                      cache.cur.componentXSectCommul.end() );
+        nc_assert( commul.size() == ncomp );
+        unsigned choices[chunksize];
+        std::size_t buf_idx[chunksize];
+        SmallVector<TOutcome,chunksize> buf_out;
+        buf_out.resize( std::min<std::size_t>( chunksize, N ) );
+        CacheArena::Scope arenascope( cache.arena );
+        for ( std::size_t ioffset = 0; ioffset < N; ioffset += chunksize ) {
+          const std::size_t n = std::min<std::size_t>( chunksize, N - ioffset );
+          TOutcome * chunk_out = out + ioffset;
+          for ( std::size_t j = 0; j < n; ++j )
+            choices[j] = static_cast<unsigned>( pickRandIdxByWeight( rng, Span<const double>( commul.begin(),
+                                                                                              commul.end() ) ) );
+          for ( unsigned i = 0; i < ncomp; ++ i ) {
+            std::size_t nsel = 0;
+            for ( std::size_t j = 0; j < n; ++j )
+              if ( choices[j] == i )
+                buf_idx[nsel++] = j;
+            if ( !nsel )
+              continue;
+            sampleComponentRepeated( *THIS->m_components[i].process, cache.componentCache[i].cachePtr, rng,
+                                     ekin, dir, nsel, buf_out.data() );
+            for ( std::size_t j = 0; j < nsel; ++j )
+              chunk_out[buf_idx[j]] = buf_out[j];
+          }
+        }
+      }
+
+      template<class TOutcome>
+      static void sampleScatterMany( const ProcComposition* THIS,
+                                     CachePtr& cacheptr,
+                                     RNG& rng,
+                                     const double* ekin,
+                                     const NeutronDirection* dirs,
+                                     std::size_t N,
+                                     TOutcome* out )
+      {
+        //Batched sampling. For each chunk of neutrons, first all components
+        //are selected, and then each component is asked to sample scatterings
+        //for the neutrons assigned to it in a single batched call.
+        if ( N == 0 )
+          return;
+        if ( THIS->isNull() ) {
+          for ( std::size_t j = 0; j < N; ++j )
+            setUnscattered( ekin[j], ( dirs ? dirs + j : nullptr ), out[j] );
+          return;
+        }
+        auto& cache = initAndAccessCache(THIS,cacheptr);
+        const unsigned ncomp = THIS->m_components.size();
+        const std::size_t nchunk = std::min<std::size_t>( chunksize, N );
+        ScratchArena::Scope scratchScope( cache.scratch );
+        double * commul = cache.scratch.allocate<double>( ncomp * nchunk );
+        unsigned choices[chunksize];
+        double buf_ekin[chunksize];
+        std::size_t buf_idx[chunksize];
+        SmallVector<NeutronDirection,chunksize> buf_dirs;
+        if ( dirs )
+          buf_dirs.resize( nchunk );
+        SmallVector<TOutcome,chunksize> buf_out;
+        buf_out.resize( nchunk );
+        for ( std::size_t ioffset = 0; ioffset < N; ioffset += chunksize ) {
+          const std::size_t n = std::min<std::size_t>( chunksize, N - ioffset );
+          const double * chunk_ekin = ekin + ioffset;
+          const NeutronDirection * chunk_dirs = ( dirs ? dirs + ioffset : nullptr );
+          TOutcome * chunk_out = out + ioffset;
+          evalCommulXSChunk( THIS, cache, chunk_ekin, chunk_dirs, n, commul );
+          //Select components (neutrons outside the domain are unaffected):
+          for ( std::size_t j = 0; j < n; ++j ) {
+            if ( !THIS->m_domain.contains( NeutronEnergy{ chunk_ekin[j] } ) ) {
+              choices[j] = ncomp;
+              setUnscattered( chunk_ekin[j], ( chunk_dirs ? chunk_dirs + j : nullptr ), chunk_out[j] );
+            } else {
+              choices[j] = static_cast<unsigned>( pickRandIdxByWeight( rng, Span<const double>( &commul[j*ncomp],
+                                                                                                &commul[j*ncomp] + ncomp ) ) );
+            }
+          }
+          //Sample each component in turn:
+          for ( unsigned i = 0; i < ncomp; ++ i ) {
+            auto& compCache = cache.componentCache[i];
+            if ( !compCache.batchSampling ) {
+              for ( std::size_t j = 0; j < n; ++j )
+                if ( choices[j] == i )
+                  sampleComponentSingle( compCache.kind, *THIS->m_components[i].process, compCache.cachePtr, rng,
+                                         chunk_ekin[j], ( chunk_dirs ? chunk_dirs + j : nullptr ), chunk_out[j] );
+              continue;
+            }
+            std::size_t nsel = 0;
+            for ( std::size_t j = 0; j < n; ++j ) {
+              if ( choices[j] == i ) {
+                buf_idx[nsel] = j;
+                buf_ekin[nsel] = chunk_ekin[j];
+                if ( chunk_dirs )
+                  buf_dirs[nsel] = chunk_dirs[j];
+                ++nsel;
+              }
+            }
+            if ( !nsel )
+              continue;
+            sampleComponentMany( *THIS->m_components[i].process, compCache.cachePtr, rng,
+                                 buf_ekin, ( chunk_dirs ? buf_dirs.data() : nullptr ), nsel, buf_out.data() );
+            for ( std::size_t j = 0; j < nsel; ++j )
+              chunk_out[buf_idx[j]] = buf_out[j];
+          }
+        }
+      }
     };
   }
 }
@@ -229,7 +1046,91 @@ NCPI::ProcComposition::ProcComposition( ComponentList components,
   addComponents(std::move(components));
 }
 
+namespace NCrystal {
+  namespace ProcImpl {
+    namespace {
+
+      //Cache of merged processes, keyed on the unique IDs and scales of the
+      //two input processes. This avoids repeating potentially expensive merges
+      //(e.g. of PCBragg plane lists) when the same phases appear in several
+      //compositions. The pointers in the key are only used during creation:
+      struct MergeKey {
+        UniqueIDValue uid1, uid2;
+        double scale1, scale2;
+        const Process* p1;
+        const Process* p2;
+        bool operator<( const MergeKey& o ) const
+        {
+          if ( uid1 != o.uid1 )
+            return uid1 < o.uid1;
+          if ( uid2 != o.uid2 )
+            return uid2 < o.uid2;
+          if ( scale1 != o.scale1 )
+            return scale1 < o.scale1;
+          return scale2 < o.scale2;
+        }
+      };
+
+      OptionalProcPtr notMergeableMarker( ProcessType pt )
+      {
+        return pt == ProcessType::Scatter ? getGlobalNullScatter() : getGlobalNullAbsorption();
+      }
+
+      class MergedProcessFactory : public CachedFactoryBase<MergeKey,Process,10> {
+      public:
+        const char* factoryName() const final { return "MergedProcessFactory"; }
+        std::string keyToString( const MergeKey& key ) const final
+        {
+          std::ostringstream ss;
+          ss<<"(Process id="<<key.uid1.value<<" scale="<<fmt(key.scale1)
+            <<"; Process id="<<key.uid2.value<<" scale="<<fmt(key.scale2)<<")";
+          return ss.str();
+        }
+      protected:
+        ShPtr actualCreate( const MergeKey& key ) const final
+        {
+          nc_assert( key.p1 && key.p1->getUniqueID() == key.uid1 );
+          nc_assert( key.p2 && key.p2->getUniqueID() == key.uid2 );
+          auto merged = key.p1->createMerged( *key.p2, key.scale1, key.scale2 );
+          if ( merged != nullptr )
+            return merged;
+          //Factories can not hold null results, so processes which can not be
+          //merged are indicated with the (never merged) global null process:
+          return notMergeableMarker( key.p1->processType() );
+        }
+      };
+      static MergedProcessFactory s_mergedProcessFactory;
+
+      OptionalProcPtr createMergedCached( const Process& p1, double scale1,
+                                          const Process& p2, double scale2 )
+      {
+        //All current createMerged implementations require both processes to
+        //be of the same type, so do not clutter the cache with other pairs:
+        if ( typeid(p1) != typeid(p2) )
+          return p1.createMerged( p2, scale1, scale2 );
+        auto res = s_mergedProcessFactory.create( MergeKey{ p1.getUniqueID(), p2.getUniqueID(),
+                                                            scale1, scale2, &p1, &p2 } );
+        nc_assert( res != nullptr );
+        if ( res == notMergeableMarker( p1.processType() ) )
+          return nullptr;
+        return res;
+      }
+    }
+  }
+}
+
 void NCPI::ProcComposition::addComponent( NCPI::ProcPtr process, double scale )
+{
+  addComponentImpl( std::move(process), scale );
+  updateDomainIntervals();
+}
+
+void NCPI::ProcComposition::updateDomainIntervals()
+{
+  m_domainIntervals = std::make_shared<const DomainIntervals>( m_components );
+}
+
+void NCPI::ProcComposition::addComponentImpl( NCPI::ProcPtr process, double scale )
 {
   if ( !process ) {
     NCRYSTAL_THROW(BadInput,"Trying to add nullptr component!");
@@ -243,12 +1144,13 @@ void NCPI::ProcComposition::addComponent( NCPI::ProcPtr process, double scale )
 
   if ( scale == 0.0 || process->isNull() )
     return;
+  m_tab.reset();//any tabulated data would be invalidated by the modification
   auto asproccomp = dynamic_cast<const ProcComposition*>(process.get());
   if (asproccomp) {
     if ( asproccomp == this )
       NCRYSTAL_THROW(BadInput,"It is not allowed to add a ProcComposition object as a component of itself");
-    addComponents( {SVAllowCopy,asproccomp->components()}, scale );
-
+    for ( auto& e : asproccomp->components() )
+      addComponentImpl( e.process, e.scale * scale );
     return;
   }
   ++m_nHistory;//record changes to m_components.
@@ -279,7 +1181,7 @@ void NCPI::ProcComposition::addComponent( NCPI::ProcPtr process, double scale )
       //multiple PCBragg instances into one more efficient one which has just
       //one internal hkl list to search - this is potentially quite useful for
       //multiphase materials:
-      auto merged_process = e.process->createMerged( *process, e.scale, scale );
+      auto merged_process = createMergedCached( *e.process, e.scale, *process, scale );
       if ( merged_process != nullptr ) {
         e.process = std::move(merged_process);
         e.scale = 1.0;
@@ -304,31 +1206,71 @@ void NCPI::ProcComposition::addComponents( NCPI::ProcComposition::ComponentList
 {
   m_components.reserve_hint( m_components.size() + components.size() );
   for ( auto&& e : components )
-    addComponent(std::move(e.process),e.scale*scale);
+    addComponentImpl(std::move(e.process),e.scale*scale);
+  updateDomainIntervals();
 }
 
 NC::CrossSect NCPI::ProcComposition::crossSection( CachePtr& cacheptr,
                                                    NeutronEnergy ekin,
                                                    const NeutronDirection& dir ) const
 {
+  NCRYSTAL_RTCOUNTER_SCOPE(*this,XSCalls);
+  NCRYSTAL_TRACE_SAMPLING_ZONE( "ProcComposition::crossSection" );
   if ( ! m_domain.contains(ekin) )
     return CrossSect{ 0.0 };
+  if ( m_tab != nullptr && m_tab->covers( ekin.dbl() ) )
+    return CrossSect{ m_tab->evalTotal( ekin.dbl() ) };
   auto& cache = ( m_materialType == MaterialType::Anisotropic
                   ? Impl::updateCacheAnisotropic( this, cacheptr, ekin, dir )
                   : Impl::updateCacheIsotropic( this, cacheptr, ekin ) );
-  nc_assert( cache.tot_xs >= 0.0 );
-  return CrossSect{ cache.tot_xs };
+  nc_assert( cache.cur.tot_xs >= 0.0 );
+  return CrossSect{ cache.cur.tot_xs };
 }
 
 NC::CrossSect NCPI::ProcComposition::crossSectionIsotropic( CachePtr& cacheptr,
                                                             NeutronEnergy ekin ) const
 {
+  NCRYSTAL_RTCOUNTER_SCOPE(*this,XSCalls);
+  NCRYSTAL_TRACE_SAMPLING_ZONE( "ProcComposition::crossSectionIsotropic" );
   if (!m_domain.contains(ekin))
     return CrossSect{ 0.0 };
   nc_assert( m_materialType == MaterialType::Isotropic );
+  if ( m_tab != nullptr && m_tab->covers( ekin.dbl() ) )
+    return CrossSect{ m_tab->evalTotal( ekin.dbl() ) };
   auto& cache = Impl::updateCacheIsotropic( this, cacheptr, ekin );
-  nc_assert( cache.tot_xs >= 0.0 );
-  return CrossSect{cache.tot_xs};
+  nc_assert( cache.cur.tot_xs >= 0.0 );
+  return CrossSect{cache.cur.tot_xs};
+}
+
+void NCPI::ProcComposition::crossSectionMany( CachePtr& cacheptr,
+                                             const double* ekin,
+                                             const NeutronDirection* dirs,
+                                             std::size_t N,
+                                             double* out_xs ) const
+{
+  NCRYSTAL_RTCOUNTER_SCOPE_N(*this,XSCalls,N);
+  NCRYSTAL_TRACE_SAMPLING_ZONE( "ProcComposition::crossSectionMany" );
+  if ( m_materialType == MaterialType::Isotropic ) {
+    if ( detail::flatBackendCrossSectionMany( *this, cacheptr, ekin, N, out_xs ) )
+      return;
+    dirs = nullptr;
+  } else {
+    nc_assert_always( dirs != nullptr || N == 0 );
+  }
+  Impl::crossSectionMany( this, cacheptr, ekin, dirs, N, out_xs );
+}
+
+void NCPI::ProcComposition::crossSectionIsotropicMany( CachePtr& cacheptr,
+                                                      const double* ekin,
+                                                      std::size_t N,
+                                                      double* out_xs ) const
+{
+  NCRYSTAL_RTCOUNTER_SCOPE_N(*this,XSCalls,N);
+  NCRYSTAL_TRACE_SAMPLING_ZONE( "ProcComposition::crossSectionIsotropicMany" );
+  nc_assert( m_materialType == MaterialType::Isotropic );
+  if ( detail::flatBackendCrossSectionMany( *this, cacheptr, ekin, N, out_xs ) )
+    return;
+  Impl::crossSectionMany( this, cacheptr, ekin, nullptr, N, out_xs );
 }
 
 NC::ScatterOutcome NCPI::ProcComposition::sampleScatter( CachePtr& cacheptr,
@@ -336,26 +1278,155 @@ NC::ScatterOutcome NCPI::ProcComposition::sampleScatter( CachePtr& cacheptr,
                                                          NeutronEnergy ekin,
                                                          const NeutronDirection& dir ) const
 {
+  NCRYSTAL_RTCOUNTER_SCOPE(*this,SampleCalls);
+  NCRYSTAL_TRACE_SAMPLING_ZONE( "ProcComposition::sampleScatter" );
   if (!m_domain.contains(ekin))
     return { ekin, dir };//no effect when xs=0
 
   auto& cache = ( m_materialType == MaterialType::Anisotropic
                   ? Impl::updateCacheAnisotropic( this, cacheptr, ekin, dir )
                   : Impl::updateCacheIsotropic( this, cacheptr, ekin ) );
-  auto ichoice = pickRandIdxByWeight( rng, cache.componentXSectCommul );
-  return m_components[ichoice].process->sampleScatter(cache.componentCache[ichoice].cachePtr,rng,ekin,dir);
+  auto ichoice = pickRandIdxByWeight( rng, cache.cur.componentXSectCommul );
+  CacheArena::Scope arenascope( cache.arena );
+  auto& compCache = cache.componentCache[ichoice];
+  return compSampleScatter( compCache.kind, *m_components[ichoice].process, compCache.cachePtr, rng, ekin, dir );
 }
 
 NC::ScatterOutcomeIsotropic NCPI::ProcComposition::sampleScatterIsotropic( CachePtr& cacheptr,
                                                                            RNG& rng,
                                                                            NeutronEnergy ekin ) const
 {
+  NCRYSTAL_RTCOUNTER_SCOPE(*this,SampleCalls);
+  NCRYSTAL_TRACE_SAMPLING_ZONE( "ProcComposition::sampleScatterIsotropic" );
   if (!m_domain.contains(ekin))
     return { ekin, CosineScatAngle{1.0} };//no effect when xs=0
   nc_assert( m_materialType == MaterialType::Isotropic );
   auto& cache = Impl::updateCacheIsotropic( this, cacheptr, ekin );
-  auto ichoice = pickRandIdxByWeight( rng, cache.componentXSectCommul );
-  return m_components[ichoice].process->sampleScatterIsotropic(cache.componentCache[ichoice].cachePtr,rng,ekin);
+  auto ichoice = pickRandIdxByWeight( rng, cache.cur.componentXSectCommul );
+  CacheArena::Scope arenascope( cache.arena );
+  auto& compCache = cache.componentCache[ichoice];
+  return compSampleScatterIsotropic( compCache.kind, *m_components[ichoice].process, compCache.cachePtr, rng, ekin );
+}
+
+std::pair<NC::CrossSect,NC::ScatterOutcome> NCPI::ProcComposition::crossSectionAndSampleScatter( CachePtr& cacheptr,
+                                                                                              RNG& rng,
+                                                                                              NeutronEnergy ekin,
+                                                                                              const NeutronDirection& dir ) const
+{
+  NCRYSTAL_RTCOUNTER_SCOPE(*this,SampleCalls);
+  NCRYSTAL_TRACE_SAMPLING_ZONE( "ProcComposition::crossSectionAndSampleScatter" );
+  NCRYSTAL_RTCOUNT(XSCalls);
+  if (!m_domain.contains(ekin))
+    return { CrossSect{ 0.0 }, ScatterOutcome{ ekin, dir } };//no effect when xs=0
+
+  auto& cache = ( m_materialType == MaterialType::Anisotropic
+                  ? Impl::updateCacheAnisotropic( this, cacheptr, ekin, dir )
+                  : Impl::updateCacheIsotropic( this, cacheptr, ekin ) );
+  nc_assert( cache.cur.tot_xs >= 0.0 );
+  const CrossSect xs{ cache.cur.tot_xs };
+  auto ichoice = pickRandIdxByWeight( rng, cache.cur.componentXSectCommul );
+  CacheArena::Scope arenascope( cache.arena );
+  auto& compCache = cache.componentCache[ichoice];
+  return { xs, compSampleScatter( compCache.kind, *m_components[ichoice].process, compCache.cachePtr, rng, ekin, dir ) };
+}
+
+void NCPI::ProcComposition::componentCrossSections( CachePtr& cacheptr,
+                                                   NeutronEnergy ekin,
+                                                   const NeutronDirection& dir,
+                                                   double* out_xs ) const
+{
+  NCRYSTAL_RTCOUNTER_SCOPE(*this,XSCalls);
+  NCRYSTAL_TRACE_SAMPLING_ZONE( "ProcComposition::componentCrossSections" );
+  const std::size_t ncomp = m_components.size();
+  if (!m_domain.contains(ekin)) {
+    std::fill( out_xs, out_xs + ncomp, 0.0 );
+    return;
+  }
+  auto& cache = ( m_materialType == MaterialType::Anisotropic
+                  ? Impl::updateCacheAnisotropic( this, cacheptr, ekin, dir )
+                  : Impl::updateCacheIsotropic( this, cacheptr, ekin ) );
+  const auto& commul = cache.cur.componentXSectCommul;
+  double prev = 0.0;
+  for ( std::size_t i = 0; i < ncomp; ++i ) {
+    out_xs[i] = std::max( 0.0, commul[i] - prev );
+    prev = commul[i];
+  }
+}
+
+NC::ScatterOutcome NCPI::ProcComposition::sampleScatterComponent( CachePtr& cacheptr,
+                                                                  RNG& rng,
+                                                                  std::size_t icomponent,
+                                                                  NeutronEnergy ekin,
+                                                                  const NeutronDirection& dir ) const
+{
+  NCRYSTAL_RTCOUNTER_SCOPE(*this,SampleCalls);
+  NCRYSTAL_TRACE_SAMPLING_ZONE( "ProcComposition::sampleScatterComponent" );
+  if ( !( icomponent < m_components.size() ) )
+    NCRYSTAL_THROW2(BadInput,"ProcComposition::sampleScatterComponent: invalid component index "
+                    <<icomponent<<" (process has "<<m_components.size()<<" components)");
+  if (!m_domain.contains(ekin))
+    return { ekin, dir };//no effect when xs=0
+
+  auto& cache = ( m_materialType == MaterialType::Anisotropic
+                  ? Impl::updateCacheAnisotropic( this, cacheptr, ekin, dir )
+                  : Impl::updateCacheIsotropic( this, cacheptr, ekin ) );
+  CacheArena::Scope arenascope( cache.arena );
+  auto& compCache = cache.componentCache[icomponent];
+  return compSampleScatter( compCache.kind, *m_components[icomponent].process, compCache.cachePtr, rng, ekin, dir );
+}
+
+void NCPI::ProcComposition::sampleScatterMany( CachePtr& cacheptr,
+                                              RNG& rng,
+                                              const double* ekin,
+                                              const NeutronDirection* dirs,
+                                              std::size_t N,
+                                              ScatterOutcome* out ) const
+{
+  NCRYSTAL_RTCOUNTER_SCOPE_N(*this,SampleCalls,N);
+  NCRYSTAL_TRACE_SAMPLING_ZONE( "ProcComposition::sampleScatterMany" );
+  nc_assert_always( dirs != nullptr || N == 0 );
+  if ( m_materialType == MaterialType::Isotropic
+       && detail::flatBackendSampleScatterMany( *this, cacheptr, rng, ekin, dirs, N, out ) )
+    return;
+  Impl::sampleScatterMany( this, cacheptr, rng, ekin, dirs, N, out );
+}
+
+void NCPI::ProcComposition::sampleScatterRepeated( CachePtr& cacheptr,
+                                                  RNG& rng,
+                                                  NeutronEnergy ekin,
+                                                  const NeutronDirection& dir,
+                                                  std::size_t N,
+                                                  ScatterOutcome* out ) const
+{
+  NCRYSTAL_RTCOUNTER_SCOPE_N(*this,SampleCalls,N);
+  NCRYSTAL_TRACE_SAMPLING_ZONE( "ProcComposition::sampleScatterRepeated" );
+  Impl::sampleScatterRepeated( this, cacheptr, rng, ekin, &dir, N, out );
+}
+
+void NCPI::ProcComposition::sampleScatterIsotropicRepeated( CachePtr& cacheptr,
+                                                           RNG& rng,
+                                                           NeutronEnergy ekin,
+                                                           std::size_t N,
+                                                           ScatterOutcomeIsotropic* out ) const
+{
+  NCRYSTAL_RTCOUNTER_SCOPE_N(*this,SampleCalls,N);
+  NCRYSTAL_TRACE_SAMPLING_ZONE( "ProcComposition::sampleScatterIsotropicRepeated" );
+  nc_assert( m_materialType == MaterialType::Isotropic );
+  Impl::sampleScatterRepeated( this, cacheptr, rng, ekin, nullptr, N, out );
+}
+
+void NCPI::ProcComposition::sampleScatterIsotropicMany( CachePtr& cacheptr,
+                                                       RNG& rng,
+                                                       const double* ekin,
+                                                       std::size_t N,
+                                                       ScatterOutcomeIsotropic* out ) const
+{
+  NCRYSTAL_RTCOUNTER_SCOPE_N(*this,SampleCalls,N);
+  NCRYSTAL_TRACE_SAMPLING_ZONE( "ProcComposition::sampleScatterIsotropicMany" );
+  nc_assert( m_materialType == MaterialType::Isotropic );
+  if ( detail::flatBackendSampleScatterMany( *this, cacheptr, rng, ekin, N, out ) )
+    return;
+  Impl::sampleScatterMany( this, cacheptr, rng, ekin, nullptr, N, out );
 }
 
 NC::ProcImpl::ProcPtr NCPI::ProcComposition::combine( const ComponentList& components,
@@ -364,6 +1435,133 @@ NC::ProcImpl::ProcPtr NCPI::ProcComposition::combine( const ComponentList& compo
   return consumeAndCombine({SVAllowCopy,components},processType);
 }
 
+const NC::VectD& NCPI::ProcComposition::tabulatedEnergyGrid() const noexcept
+{
+  static const VectD s_empty;
+  return m_tab ? m_tab->egrid : s_empty;
+}
+
+NC::shared_obj<const NCPI::ProcComposition> NCPI::ProcComposition::createTabulated( ProcPtr proc,
+                                                                                 const ProcCompTabulationCfg& cfg )
+{
+  if ( proc->materialType() != MaterialType::Isotropic )
+    NCRYSTAL_THROW(BadInput,"ProcComposition::createTabulated can only be used with isotropic processes");
+  if ( !( cfg.tolerance > 0.0 ) || !( cfg.tolerance < 1.0 ) )
+    NCRYSTAL_THROW(BadInput,"ProcComposition::createTabulated: tolerance must be in (0,1)");
+  if ( !( cfg.emin.dbl() > 0.0 ) || !( cfg.emax > cfg.emin ) || std::isinf(cfg.emax.dbl()) )
+    NCRYSTAL_THROW(BadInput,"ProcComposition::createTabulated: invalid energy range");
+  if ( cfg.ndecade < 1 || cfg.npts_max < 2 )
+    NCRYSTAL_THROW(BadInput,"ProcComposition::createTabulated: invalid ndecade or npts_max values");
+
+  //Setup new ProcComposition with the same components:
+  auto asproccomp = dynamic_cast<const ProcComposition*>(proc.get());
+  auto pc = makeSO<ProcComposition>( ( asproccomp
+                                       ? ComponentList{ SVAllowCopy, asproccomp->components() }
+                                       : ComponentList{ Component{ 1.0, proc } } ),
+                                     proc->processType() );
+  if ( pc->m_components.empty() )
+    return pc;//null process, nothing to tabulate.
+
+  //Function for exact evaluation of commulative component cross sections:
+  const unsigned ncomp = pc->m_components.size();
+  CachePtr cacheptr;
+  auto evalExact = [&pc,&cacheptr,ncomp]( double ekin, double * out )
+  {
+    NeutronEnergy e{ekin};
+    if ( !pc->m_domain.contains(e) ) {
+      std::fill( out, out + ncomp, 0.0 );
+      return;
+    }
+    auto& cache = Impl::updateCacheIsotropic( pc.get(), cacheptr, e );
+    std::copy( cache.cur.componentXSectCommul.begin(), cache.cur.componentXSectCommul.end(), out );
+  };
+
+  //Initial grid:
+  const double emin = cfg.emin.dbl();
+  const double emax = cfg.emax.dbl();
+  VectD egrid;
+  if ( cfg.egrid.empty() ) {
+    const double ndecades = std::log10( emax / emin );
+    egrid = logspace( std::log10(emin), std::log10(emax),
+                      std::max<unsigned>( 2, static_cast<unsigned>( std::ceil( ndecades * cfg.ndecade ) ) + 1 ) );
+  } else {
+    egrid.reserve( cfg.egrid.size() + 2 );
+    egrid.push_back( emin );
+    for ( auto e : cfg.egrid )
+      if ( e > emin && e < emax )
+        egrid.push_back( e );
+    egrid.push_back( emax );
+    std::sort( egrid.begin(), egrid.end() );
+    egrid.erase( std::unique( egrid.begin(), egrid.end() ), egrid.end() );
+  }
+  egrid.front() = emin;
+  egrid.back() = emax;
+
+  //Adaptive refinement. Intervals are tested at several interior points, and are
+  //split as long as linear interpolation is not precise enough at any of
+  //these. Discontinuities (e.g. Bragg edges) will be resolved down to a
+  //relative energy interval width of min_relwidth:
+  constexpr double min_relwidth = 1e-9;
+  constexpr unsigned ntestdiv = 8;
+  struct Point { double e; std::vector<double> c; };
+  std::vector<Point> todo;
+  todo.reserve( egrid.size() );
+  for ( auto e : egrid ) {
+    todo.push_back( Point{ e, std::vector<double>(ncomp) } );
+    evalExact( e, todo.back().c.data() );
+  }
+  std::reverse( todo.begin(), todo.end() );
+  auto tab = std::make_shared<Tabulation>();
+  tab->ncomp = ncomp;
+  std::vector<double> tmp_exact(ncomp);
+  auto intervalIsOK = [&tmp_exact,&evalExact,ncomp,&cfg]( const Point& a, const Point& b )
+  {
+    if ( b.e - a.e < min_relwidth * a.e )
+      return true;
+    for ( unsigned k = 1; k < ntestdiv; ++k ) {
+      const double f = double(k) / ntestdiv;
+      const double e = a.e * std::pow( b.e / a.e, f );
+      const double t = ( e - a.e ) / ( b.e - a.e );
+      evalExact( e, tmp_exact.data() );
+      const double tol = cfg.tolerance * tmp_exact.back();
+      for ( unsigned i = 0; i < ncomp; ++i ) {
+        const double interp = a.c[i] + t * ( b.c[i] - a.c[i] );
+        if ( !( ncabs( interp - tmp_exact[i] ) <= tol ) )
+          return false;
+      }
+    }
+    return true;
+  };
+  //The todo list contains points in decreasing order of energy, and the
+  //completed points are transferred to the table:
+  Point current = std::move( todo.back() );
+  todo.pop_back();
+  std::size_t npts = 1;
+  auto appendToTable = [&tab]( const Point& p )
+  {
+    tab->egrid.push_back( p.e );
+    tab->commul.insert( tab->commul.end(), p.c.begin(), p.c.end() );
+  };
+  appendToTable( current );
+  while ( !todo.empty() ) {
+    const Point& next = todo.back();
+    if ( npts + todo.size() >= cfg.npts_max || intervalIsOK( current, next ) ) {
+      current = std::move( todo.back() );
+      todo.pop_back();
+      appendToTable( current );
+      ++npts;
+    } else {
+      Point mid{ std::sqrt( current.e * next.e ), std::vector<double>(ncomp) };
+      evalExact( mid.e, mid.c.data() );
+      todo.push_back( std::move(mid) );
+    }
+  }
+  tab->egrid.shrink_to_fit();
+  tab->commul.shrink_to_fit();
+  pc->m_tab = std::move(tab);
+  return pc;
+}
+
 NC::ProcImpl::ProcPtr NC::ProcImpl::getGlobalNullScatter()
 {
   static shared_obj<const Process> s_obj = makeSO<NullScatter>();
@@ -431,6 +1629,82 @@ void NC::ProcImpl::Process::initCachePtr(CachePtr& cp) const
 
 }
 
+void NC::ProcImpl::Process::warmup( EnergyDomain edom, WarmupLevel level ) const
+{
+  //Intersect with the domain of the process, and restrict unbounded domains
+  //to the range where models usually build lazy structures:
+  const auto procdom = domain();
+  double emin = std::max( std::max( edom.elow.dbl(), procdom.elow.dbl() ), 1e-5 );
+  double emax = std::min( std::min( edom.ehigh.dbl(), procdom.ehigh.dbl() ), 10.0 );
+  if ( !( emin <= emax ) )
+    return;
+  const unsigned npts = ( level == WarmupLevel::Complete ? 200 : 8 );
+  const VectD egrid = ( emin < emax ? logspace( std::log10(emin), std::log10(emax), npts ) : VectD{ emin } );
+
+  //Private cache and RNG stream, leaving the state of the caller untouched:
+  CachePtr cp;
+  auto rng = createBuiltinRNG( 0x4e4357u );
+  const bool isScatter = ( processType() == ProcessType::Scatter );
+  const bool oriented = isOriented();
+  const NeutronDirection dirs[] = { NeutronDirection{ 0.0, 0.0, 1.0 },
+                                    NeutronDirection{ 0.0, 1.0, 0.0 },
+                                    NeutronDirection{ 0.6, 0.0, 0.8 } };
+  for ( auto e : egrid ) {
+    const NeutronEnergy ekin{ e };
+    for ( auto& dir : dirs ) {
+      if ( oriented )
+        crossSection( cp, ekin, dir );
+      else
+        crossSectionIsotropic( cp, ekin );
+      if ( isScatter ) {
+        if ( oriented )
+          sampleScatter( cp, rng, ekin, dir );
+        else
+          sampleScatterIsotropic( cp, rng, ekin );
+      }
+      if ( !oriented )
+        break;
+    }
+  }
+}
+
+void NC::ProcImpl::ProcComposition::warmup( EnergyDomain edom, WarmupLevel level ) const
+{
+  for ( auto& c : m_components )
+    c.process->warmup( edom, level );
+}
+
+std::size_t NC::ProcImpl::Process::memoryFootprint() const
+{
+  return 256;
+}
+
+std::size_t NC::ProcImpl::ProcComposition::memoryFootprint() const
+{
+  std::size_t res = sizeof(ProcComposition);
+  for ( auto& c : m_components )
+    res += c.process->memoryFootprint();
+  if ( m_tab )
+    res += sizeof(Tabulation) + ( m_tab->egrid.capacity() + m_tab->commul.capacity() ) * sizeof(double);
+  if ( m_domainIntervals )
+    res += m_domainIntervals->memoryFootprint();
+  return res;
+}
+
+NC::Optional<NC::ProcImpl::OOVCrossSection> NC::ProcImpl::ProcComposition::analyticOOVCrossSection() const
+{
+  if ( m_tab )
+    return NullOpt;//must be consistent with the tabulated cross sections
+  double c = 0.0;
+  for ( auto& e : m_components ) {
+    auto oov = e.process->analyticOOVCrossSection();
+    if ( !oov.has_value() )
+      return NullOpt;
+    c += e.scale * oov.value().coefficient;
+  }
+  return OOVCrossSection{ c };
+}
+
 std::string NC::ProcImpl::Process::jsonDescription() const
 {
   std::ostringstream ss;
@@ -453,6 +1727,13 @@ std::string NC::ProcImpl::Process::jsonDescription() const
   } else {
     ss << ",\"specific\":{}";
   }
+  streamJSONDictEntry( ss,"memoryFootprint", static_cast<std::uint64_t>( this->memoryFootprint() ) );
+#ifdef NCRYSTAL_ENABLE_RUNTIME_COUNTERS
+  {
+    auto counters = RuntimeCounters::jsonForProcess( this->getUniqueID() );
+    ss << ",\"runtime_counters\":" << ( counters.has_value() ? counters.value() : std::string("{}") );
+  }
+#endif
   streamJSONDictEntry( ss,"uid", this->getUniqueID().value, JSONDictPos::LAST );
   return ss.str();
 }
@@ -460,7 +1741,13 @@ std::string NC::ProcImpl::Process::jsonDescription() const
 NC::Optional<std::string> NC::ProcImpl::ProcComposition::specificJSONDescription() const
 {
   std::ostringstream ss;
-  ss << "{\"summarystr\":\""<<m_components.size()<<" components, "<<(isOriented()?"oriented":"isotropic")<<"\"";
+  ss << "{\"summarystr\":\""<<m_components.size()<<" components, "<<(isOriented()?"oriented":"isotropic")
+     <<(m_tab?", tabulated":"")<<"\"";
+  if ( m_tab ) {
+    ss << ",\"tabulation\":";
+    streamJSONDictEntry( ss, "npts", static_cast<std::uint64_t>(m_tab->egrid.size()), JSONDictPos::FIRST );
+    streamJSONDictEntry( ss, "range", PairDD{ m_tab->egrid.front(), m_tab->egrid.back() }, JSONDictPos::LAST );
+  }
   ss << ",\"components\":[";
   bool first(true);
   for ( auto& c : m_components ) {
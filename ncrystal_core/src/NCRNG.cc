@@ -21,6 +21,7 @@
 #include "NCrystal/NCRNG.hh"
 #include "NCrystal/internal/NCRandUtils.hh"
 #include "NCrystal/internal/NCString.hh"
+#include "NCrystal/internal/NCRuntimeCounters.hh"
 
 #ifndef NCRYSTAL_DISABLE_THREADS
 #  include <thread>
@@ -86,6 +87,7 @@ namespace NCrystal {
   namespace RNGStream_detail {
 
     constexpr uint32_t builtinRNGStateTypeUID = 0xb067bd44;//randomly generated
+    constexpr uint32_t builtinCounterRNGStateTypeUID = 0x3c9e52a7;//randomly generated
 
     uint32_t extractStateUID( const char * fullfct, const std::string& state )
     {
@@ -131,9 +133,17 @@ NC::shared_obj<NC::RNGStream> NC::RNGStream::createJumped() const
   return optional_shared_obj<RNGStream>{nullptr};//can't just return nullptr when return type is shared_obj
 }
 
+NC::shared_obj<NC::RNGStream> NC::RNGStream::createByIndex( RNGStreamIndex ) const
+{
+  NCRYSTAL_THROW(LogicError,"createByIndex() is not supported by this RNG stream (check isIndexCapable() before calling).");
+  return optional_shared_obj<RNGStream>{nullptr};//can't just return nullptr when return type is shared_obj
+}
+
 bool NC::stateIsFromBuiltinRNG( const RNGStreamState& state )
 {
-  return RNGStream_detail::extractStateUID( "NCrystal::stateIsFromBuiltinRNG", state.get() ) == RNGStream_detail::builtinRNGStateTypeUID;
+  auto uid = RNGStream_detail::extractStateUID( "NCrystal::stateIsFromBuiltinRNG", state.get() );
+  return ( uid == RNGStream_detail::builtinRNGStateTypeUID
+           || uid == RNGStream_detail::builtinCounterRNGStateTypeUID );
 }
 
 namespace NCrystal {
@@ -144,13 +154,22 @@ namespace NCrystal {
     RNG_XRSR( RandXRSRImpl&& impl ) : m_impl(std::move(impl)) {}
     RNG_XRSR( no_init_t ) : m_impl(no_init) {}
 
-    bool coinflip() override { return m_impl.coinflip(); }
-    uint64_t generate64RndmBits() override { return m_impl.genUInt64(); }
-    uint32_t generate32RndmBits() override { return m_impl.genUInt32(); }
+    bool coinflip() override { NCRYSTAL_RTCOUNT(RNGDraws); return m_impl.coinflip(); }
+    uint64_t generate64RndmBits() override { NCRYSTAL_RTCOUNT(RNGDraws); return m_impl.genUInt64(); }
+    uint32_t generate32RndmBits() override { NCRYSTAL_RTCOUNT(RNGDraws); return m_impl.genUInt32(); }
 
   protected:
 
-    double actualGenerate() override { return m_impl.generate(); }
+    double actualGenerate() override { NCRYSTAL_RTCOUNT(RNGDraws); return m_impl.generate(); }
+    void actualGenerateMany( double* out, std::size_t n ) override
+    {
+      NCRYSTAL_RTCOUNT_N(RNGDraws,n);
+      //Work on a local copy, so the state can stay in registers:
+      RandXRSRImpl impl( m_impl.state() );
+      for ( std::size_t i = 0; i < n; ++i )
+        out[i] = impl.generate();
+      m_impl.state() = impl.state();
+    }
 
     uint32_t stateTypeUID() const noexcept override {
       return RNGStream_detail::builtinRNGStateTypeUID;
@@ -201,6 +220,89 @@ namespace NCrystal {
     RandXRSRImpl m_impl;
   };
 
+  class RNG_Philox final : public RNGStream {
+  public:
+
+    RNG_Philox( uint64_t seed, uint64_t stream, uint64_t pos = 0 ) : m_impl{seed,stream,pos} {}
+
+    bool coinflip() override { NCRYSTAL_RTCOUNT(RNGDraws); return m_impl.coinflip(); }
+    uint64_t generate64RndmBits() override { NCRYSTAL_RTCOUNT(RNGDraws); return m_impl.genUInt64(); }
+    uint32_t generate32RndmBits() override { NCRYSTAL_RTCOUNT(RNGDraws); return m_impl.genUInt32(); }
+
+  protected:
+
+    double actualGenerate() override { NCRYSTAL_RTCOUNT(RNGDraws); return m_impl.generate(); }
+    void actualGenerateMany( double* out, std::size_t n ) override
+    {
+      NCRYSTAL_RTCOUNT_N(RNGDraws,n);
+      for ( std::size_t i = 0; i < n; ++i )
+        out[i] = m_impl.generate();
+    }
+
+    uint32_t stateTypeUID() const noexcept override {
+      return RNGStream_detail::builtinCounterRNGStateTypeUID;
+    }
+
+    static RandPhiloxImpl detail_convstate(std::vector<uint8_t>&& v)
+    {
+      nc_assert_always( v.size() == 3*sizeof(uint64_t) );
+      const uint64_t pos = popFromStateVector<uint64_t>(v);
+      const uint64_t stream = popFromStateVector<uint64_t>(v);
+      const uint64_t key = popFromStateVector<uint64_t>(v);
+      nc_assert(v.empty());
+      return RandPhiloxImpl( key, stream, pos );
+    }
+    void actualSetState( std::vector<uint8_t>&& v ) override
+    {
+      m_impl = detail_convstate(std::move(v));
+    }
+    std::vector<uint8_t> actualGetState() const override
+    {
+      std::vector<uint8_t> v;
+      v.reserve( 3*sizeof(uint64_t) );
+      appendToStateVector<uint64_t>(v,m_impl.key());
+      appendToStateVector<uint64_t>(v,m_impl.stream());
+      appendToStateVector<uint64_t>(v,m_impl.position());
+      return v;
+    }
+
+    shared_obj<RNGStream> actualCloneWithNewState( std::vector<uint8_t>&& v ) const override
+    {
+      auto impl = detail_convstate(std::move(v));
+      return makeSO<RNG_Philox>( impl.key(), impl.stream(), impl.position() );
+    }
+
+    //Jumped streams share the stream index, but start at positions 2^48
+    //apart, giving 65535 jumps before running out of positions:
+    static constexpr uint64_t jumpSize = uint64_t{1} << 48;
+
+    bool isJumpCapable() const override
+    {
+      return true;
+    }
+
+    shared_obj<RNGStream> createJumped() const override
+    {
+      const uint64_t newpos = ( ( m_impl.position() / jumpSize ) + 1 ) * jumpSize;
+      if ( newpos == 0 )
+        NCRYSTAL_THROW(CalcError,"Too many jumps requested for counter-based RNG stream.");
+      return makeSO<RNG_Philox>( m_impl.key(), m_impl.stream(), newpos );
+    }
+
+    bool isIndexCapable() const override
+    {
+      return true;
+    }
+
+    shared_obj<RNGStream> createByIndex( RNGStreamIndex idx ) const override
+    {
+      return makeSO<RNG_Philox>( m_impl.key(), m_impl.stream() + 1 + idx.get() );
+    }
+
+  private:
+    RandPhiloxImpl m_impl;
+  };
+
   class RNG_OneFctForAllThreads final : public RNGStream {
   public:
     RNG_OneFctForAllThreads( std::function<double()> fct ) : m_fct{std::move(fct)} {}
@@ -217,8 +319,19 @@ NC::shared_obj<NC::RNGStream> NC::createBuiltinRNG( uint64_t seed )
   return makeSO<RNG_XRSR>(seed);
 }
 
+NC::shared_obj<NC::RNGStream> NC::createBuiltinCounterRNG( uint64_t seed, uint64_t streamidx )
+{
+  return makeSO<RNG_Philox>(seed,streamidx);
+}
+
 NC::shared_obj<NC::RNGStream> NC::createBuiltinRNG( const RNGStreamState& state )
 {
+  if ( RNGStream_detail::extractStateUID( "NCrystal::createBuiltinRNG", state.get() )
+       == RNGStream_detail::builtinCounterRNGStateTypeUID ) {
+    auto rng = makeSO<RNG_Philox>( 0, 0 );
+    rng->setState(state);
+    return rng;
+  }
   auto rng = makeSO<RNG_XRSR>( no_init );
   rng->setState(state);
   return rng;
@@ -229,6 +342,9 @@ namespace NCrystal {
     struct DefRNGProd {
       std::mutex mtx;
       optional_shared_obj<RNGProducer> producer;
+      //Incremented whenever producer is changed, so thread-local caches of
+      //streams from the previous producer can be invalidated without locking:
+      std::atomic<uint64_t> generation{1};
     };
     DefRNGProd& defRNGProdDB() {
       static DefRNGProd s_rngprod;
@@ -252,6 +368,7 @@ void NC::setDefaultRNG( NC::shared_obj<NC::RNGStream> rng )
   auto& d = defRNGProdDB();
   NCRYSTAL_LOCK_GUARD(d.mtx);
   d.producer = newprod;
+  ++d.generation;
 }
 
 void NC::clearDefaultRNG()
@@ -259,6 +376,7 @@ void NC::clearDefaultRNG()
   auto& d = defRNGProdDB();
   NCRYSTAL_LOCK_GUARD(d.mtx);
   d.producer = nullptr;
+  ++d.generation;
 }
 
 void NC::setDefaultRNGFctForAllThreads( std::function<double()> fct )
@@ -268,9 +386,17 @@ void NC::setDefaultRNGFctForAllThreads( std::function<double()> fct )
 
 namespace NCrystal {
   struct RNGProducer::Impl {
-    Impl( shared_obj<RNGStream> rng ) : m_nextproduct( std::move(rng) ) {}
+    UniqueID m_uid;
+    Impl( shared_obj<RNGStream> rng )
+      : m_nextproduct( rng )
+    {
+      //Keep original stream around for producing streams by index if possible:
+      if ( rng->isIndexCapable() && !rng->useInAllThreads() )
+        m_indexsource = std::move(rng);
+    }
     Impl( no_init_t ) {}
     optional_shared_obj<RNGStream> m_nextproduct;
+    optional_shared_obj<RNGStream> m_indexsource;
     optional_shared_obj<RNGStream> m_nextnextproduct;
     std::map<RNGStreamIndex,optional_shared_obj<RNGStream>> m_idxdb;
     std::map<ThreadID,optional_shared_obj<RNGStream>> m_thread_idxdb;
@@ -310,7 +436,7 @@ NC::shared_obj<NC::RNGStream> NC::RNGProducer::Impl::produceByIdxUnlocked( RNGSt
 {
   optional_shared_obj<RNGStream>& entry = m_idxdb[idx];
   if ( entry == nullptr )
-    entry = produceUnlocked();
+    entry = ( m_indexsource != nullptr ? m_indexsource->createByIndex(idx) : produceUnlocked() );
   return entry;
 }
 
@@ -334,15 +460,44 @@ NC::shared_obj<NC::RNGStream> NC::RNGProducer::produceByIdx( RNGStreamIndex idx
   return m_impl->produceByIdxUnlocked(idx);
 }
 
+namespace NCrystal {
+  namespace {
+    //Thread-local cache of the most recently produced stream for the current
+    //thread, avoiding the locks in repeated calls. Keys are unique ids, which
+    //are never reused, so entries can never refer to the wrong producer (they
+    //merely keep the stream alive until replaced):
+    struct TLStreamCache {
+      uint64_t key = 0;
+      optional_shared_obj<RNGStream> rng;
+    };
+  }
+}
+
 NC::shared_obj<NC::RNGStream> NC::RNGProducer::produceForCurrentThread()
 {
+#ifndef NCRYSTAL_DISABLE_THREADS
+  static thread_local TLStreamCache s_tlcache;
+  const uint64_t uid = m_impl->m_uid.getUniqueID().value;
+  if ( s_tlcache.key == uid ) {
+    nc_assert( s_tlcache.rng != nullptr );
+    return s_tlcache.rng;
+  }
+#endif
 #ifndef NCRYSTAL_DISABLE_THREADS
   ThreadID thread_id = std::this_thread::get_id();
 #else
   ThreadID thread_id = 1;//always the same!
 #endif
-  NCRYSTAL_LOCK_GUARD(m_impl->m_mtx);
-  return m_impl->produceByThreadIdxUnlocked(thread_id);
+  shared_obj<RNGStream> rng = [this,thread_id]()
+  {
+    NCRYSTAL_LOCK_GUARD(m_impl->m_mtx);
+    return m_impl->produceByThreadIdxUnlocked(thread_id);
+  }();
+#ifndef NCRYSTAL_DISABLE_THREADS
+  s_tlcache.rng = rng.optional();
+  s_tlcache.key = uid;
+#endif
+  return rng;
 }
 
 NC::RNGProducer::RNGProducer( no_init_t )
@@ -379,13 +534,40 @@ NC::RNGProducer::RNGProducer( shared_obj<RNGStream> rng, SkipOriginal skip_orig
   produceForCurrentThread();
 }
 
+void NC::RNGProducer::reinit( shared_obj<RNGStream> rng, SkipOriginal so )
+{
+  *this = RNGProducer(std::move(rng),so);
+  //The default producer might be reinitialised in place (e.g. via
+  //Scatter::replaceRNGAndUpdateProducer), so always invalidate the streams
+  //cached by getRNG() in all threads:
+  ++defRNGProdDB().generation;
+}
+
 NC::RNGProducer::RNGProducer( RNGProducer&& ) noexcept = default;
 NC::RNGProducer& NC::RNGProducer::operator=( RNGProducer&& ) noexcept = default;
 NC::RNGProducer::~RNGProducer() = default;
 
 NC::shared_obj<NC::RNGStream> NC::getRNG()
 {
+#ifndef NCRYSTAL_DISABLE_THREADS
+  //Fast path without locking if the default producer did not change since
+  //the last call in this thread (the generation must be read before the
+  //producer, so a concurrent change at worst causes a refresh in the next
+  //call):
+  static thread_local TLStreamCache s_tlcache;
+  auto& d = defRNGProdDB();
+  const uint64_t generation = d.generation.load();
+  if ( s_tlcache.key == generation ) {
+    nc_assert( s_tlcache.rng != nullptr );
+    return s_tlcache.rng;
+  }
+  auto rng = getDefaultRNGProducer()->produceForCurrentThread();
+  s_tlcache.rng = rng.optional();
+  s_tlcache.key = generation;
+  return rng;
+#else
   return getDefaultRNGProducer()->produceForCurrentThread();
+#endif
 }
 
 NC::shared_obj<NC::RNGStream> NC::getIndependentRNG()
@@ -20,6 +20,7 @@
 
 #include "NCrystal/internal/NCRandUtils.hh"
 #include "NCrystal/internal/NCMath.hh"
+#include "NCrystal/internal/NCString.hh"
 namespace NC=NCrystal;
 
 NC::Vector NC::randIsotropicDirection( RNG& rng )
@@ -33,9 +34,11 @@ NC::Vector NC::randIsotropicDirection( RNG& rng )
   //Available at https://projecteuclid.org/euclid.aoms/1177692644
 
   double x0,x1,s;
+  double r[2];
   do {
-    x0 = 2.0*rng.generate()-1.0;
-    x1 = 2.0*rng.generate()-1.0;
+    rng.generateMany( r, 2 );
+    x0 = 2.0*r[0]-1.0;
+    x1 = 2.0*r[1]-1.0;
     s = x0*x0 + x1*x1;
   } while (!s||s>=1);
   double t = 2.0*std::sqrt(1-s);
@@ -76,14 +79,100 @@ NC::Vector NC::randDirectionGivenScatterMu( RNG& rng, double mu, const Vector& i
   return { u.x()+k*xx, u.y()+k*yy, u.z()+k*zz };
 }
 
+namespace NCrystal {
+  namespace {
+    //(cos,sin) at the midpoints of 4096 equal-sized azimuthal bins:
+    struct AzimuthTable {
+      static constexpr unsigned nbins = 4096;
+      static constexpr double binwidth = k2Pi / nbins;
+      std::array<double,nbins> c, s;
+      AzimuthTable()
+      {
+        for ( unsigned i = 0; i < nbins; ++i ) {
+          c[i] = std::cos( ( i + 0.5 ) * binwidth );
+          s[i] = std::sin( ( i + 0.5 ) * binwidth );
+        }
+      }
+    };
+    constexpr unsigned AzimuthTable::nbins;
+    constexpr double AzimuthTable::binwidth;
+    static const AzimuthTable s_azimuthTable;
+  }
+}
+
+void NC::randDirectionsGivenScatterMu( RNG& rng, std::size_t n, const double * mu,
+                                       const double * in_x, const double * in_y, const double * in_z,
+                                       double * out_x, double * out_y, double * out_z,
+                                       AzimuthPrecision precision )
+{
+  constexpr std::size_t chunksize = 128;
+  double cosphi[chunksize];
+  double sinphi[chunksize];
+  const auto& tbl = s_azimuthTable;
+  for ( std::size_t ioffset = 0; ioffset < n; ioffset += chunksize ) {
+    const std::size_t nchunk = std::min<std::size_t>( chunksize, n - ioffset );
+
+    //Azimuthal angles:
+    rng.generateMany( cosphi, nchunk );
+    for ( std::size_t j = 0; j < nchunk; ++j ) {
+      const double w = cosphi[j] * AzimuthTable::nbins;
+      const unsigned k = ncmin( static_cast<unsigned>( w ), AzimuthTable::nbins - 1 );
+      if ( precision == AzimuthPrecision::Table ) {
+        cosphi[j] = tbl.c[k];
+        sinphi[j] = tbl.s[k];
+      } else {
+        //Offset from bin midpoint is |d|<=pi/4096, so truncation errors are
+        //below d^6/720~1e-20:
+        const double d = ( w - k - 0.5 ) * AzimuthTable::binwidth;
+        const double d2 = d * d;
+        const double cd = 1.0 - d2 * ( 0.5 - d2 * ( 1.0 / 24.0 ) );
+        const double sd = d * ( 1.0 - d2 * ( ( 1.0 / 6.0 ) - d2 * ( 1.0 / 120.0 ) ) );
+        cosphi[j] = tbl.c[k] * cd - tbl.s[k] * sd;
+        sinphi[j] = tbl.s[k] * cd + tbl.c[k] * sd;
+      }
+    }
+
+    //Construct outgoing directions:
+    for ( std::size_t j = 0; j < nchunk; ++j ) {
+      const std::size_t i = ioffset + j;
+      double x = in_x[i];
+      double y = in_y[i];
+      double z = in_z[i];
+      const double invm = 1.0 / std::sqrt( x*x + y*y + z*z );
+      x *= invm;
+      y *= invm;
+      z *= invm;
+      //Orthonormal basis (b1,b2) perpendicular to (x,y,z):
+      const double sign = std::copysign( 1.0, z );
+      const double a = -1.0 / ( sign + z );
+      const double b = x * y * a;
+      const double b1x = 1.0 + sign * x * x * a;
+      const double b1y = sign * b;
+      const double b1z = -sign * x;
+      const double b2x = b;
+      const double b2y = sign + y * y * a;
+      const double b2z = -y;
+      const double m = mu[i];
+      const double st = std::sqrt( ncmax( 0.0, 1.0 - m * m ) );
+      const double c1 = st * cosphi[j];
+      const double c2 = st * sinphi[j];
+      out_x[i] = m * x + c1 * b1x + c2 * b2x;
+      out_y[i] = m * y + c1 * b1y + c2 * b2y;
+      out_z[i] = m * z + c1 * b1z + c2 * b2z;
+    }
+  }
+}
+
 NC::PairDD NC::randPointOnUnitCircle( RNG& rng )
 {
   //Sample a random point on the unit circle. This is equivalent to sampling phi
   //randomly in [0,2pi) and letting (x,y)=(cosphi,sinphi).
   double a,b,m2;
+  double r[2];
   do {
-    a = -1.0+rng.generate()*2.0;
-    b = -1.0+rng.generate()*2.0;
+    rng.generateMany( r, 2 );
+    a = -1.0+r[0]*2.0;
+    b = -1.0+r[1]*2.0;
     m2 = a*a + b*b;
   } while ( !valueInInterval(0.001,1.0,m2) );
 
@@ -91,7 +180,168 @@ NC::PairDD NC::randPointOnUnitCircle( RNG& rng )
   return { a * m, b * m };
 }
 
-double NC::randNorm( NC::RNG& rng )
+namespace NCrystal {
+  namespace {
+
+    bool useZiggurat()
+    {
+#ifdef NCRYSTAL_RANDUTILS_ZIGGURAT
+      return true;
+#else
+      static const bool s_use = ncgetenv_bool("RAND_ZIGGURAT");
+      return s_use;
+#endif
+    }
+
+    //Ziggurat tables (cf. Marsaglia and Tsang 2000, and the ZIGNOR variant in
+    //J. A. Doornik, "An Improved Ziggurat Method to Generate Normal Random
+    //Samples", 2005). Layer 0 is the base strip including the tail, and layer
+    //i>0 is the rectangle [0,x_i]x[f(x_i),f(x_{i+1})]. Thus, points in layer i
+    //with x<x_{i+1} are always below f(x), and these are accepted directly
+    //(which happens ~99% of the time):
+    template<unsigned NLayers>
+    struct ZigguratTable {
+      std::array<double,NLayers+1> x;//layer edges (x[NLayers]=0)
+      std::array<double,NLayers+1> f;//f(x)
+      std::array<double,NLayers> r;//x[i+1]/x[i]
+      template<class TFct, class TInvFct>
+      ZigguratTable( double rr, double vv, TFct fct, TInvFct invfct )
+      {
+        x[0] = vv / fct(rr);
+        x[1] = rr;
+        for ( unsigned i = 2; i < NLayers; ++i )
+          x[i] = invfct( vv / x[i-1] + fct(x[i-1]) );
+        x[NLayers] = 0.0;
+        for ( unsigned i = 0; i <= NLayers; ++i )
+          f[i] = fct(x[i]);
+        for ( unsigned i = 0; i < NLayers; ++i )
+          r[i] = x[i+1] / x[i];
+      }
+    };
+
+    struct ZigguratTables {
+      //Unnormalised Gaussian exp(-x^2/2) with 128 layers (sign taken from
+      //the uniform number), and exponential exp(-x) with 256 layers:
+      static constexpr double norm_r = 3.442619855899;
+      static constexpr double exp_r = 7.69711747013104972;
+      ZigguratTable<128> norm;
+      ZigguratTable<256> exp;
+      ZigguratTables()
+        : norm( norm_r, 9.91256303526217e-3,
+                [](double xx) { return std::exp(-0.5*xx*xx); },
+                [](double ff) { return std::sqrt(-2.0*std::log(ff)); } ),
+          exp( exp_r, 3.949659822581572e-3,
+               [](double xx) { return std::exp(-xx); },
+               [](double ff) { return -std::log(ff); } )
+      {
+      }
+    };
+    constexpr double ZigguratTables::norm_r;
+    constexpr double ZigguratTables::exp_r;
+
+    //Trivially destructible, so safe to use even during static destruction:
+    static const ZigguratTables s_zig;
+
+    //Ziggurat sampling, with the first uniform number (in ]0,1]) provided by
+    //the caller. The layer index is taken from the leading bits of u, and the
+    //remaining (at least 45) bits are used as a new uniform number:
+    inline double zigNormFromUniform( double u, RNG& rng )
+    {
+      const auto& t = s_zig.norm;
+      while ( true ) {
+        const double w = u * 128.0;
+        const unsigned i = ncmin( static_cast<unsigned>( w ), 127u );
+        const double uu = 2.0 * ( w - i ) - 1.0;
+        if ( std::fabs( uu ) < t.r[i] )
+          return uu * t.x[i];
+        if ( i == 0 ) {
+          //Tail beyond r:
+          const double r = ZigguratTables::norm_r;
+          double xx, yy;
+          do {
+            xx = -std::log( rng.generate() ) / r;
+            yy = -std::log( rng.generate() );
+          } while ( 2.0 * yy < xx * xx );
+          return uu < 0.0 ? -( r + xx ) : r + xx;
+        }
+        const double xx = uu * t.x[i];
+        if ( t.f[i] + rng.generate() * ( t.f[i+1] - t.f[i] ) < ncexp( -0.5 * xx * xx ) )
+          return xx;
+        u = rng.generate();
+      }
+    }
+
+    inline double zigExpFromUniform( double u, RNG& rng )
+    {
+      const auto& t = s_zig.exp;
+      while ( true ) {
+        const double w = u * 256.0;
+        const unsigned i = ncmin( static_cast<unsigned>( w ), 255u );
+        const double uu = w - i;
+        if ( uu < t.r[i] )
+          return uu * t.x[i];
+        if ( i == 0 ) {
+          //Tail beyond r (the exponential distribution is memoryless):
+          return ZigguratTables::exp_r - std::log( rng.generate() );
+        }
+        const double xx = uu * t.x[i];
+        if ( t.f[i] + rng.generate() * ( t.f[i+1] - t.f[i] ) < ncexp( -xx ) )
+          return xx;
+        u = rng.generate();
+      }
+    }
+
+  }
+}
+
+double NC::randNormZiggurat( RNG& rng )
+{
+  return zigNormFromUniform( rng.generate(), rng );
+}
+
+double NC::randExpZiggurat( RNG& rng )
+{
+  return zigExpFromUniform( rng.generate(), rng );
+}
+
+double NC::randNorm( RNG& rng )
+{
+  return useZiggurat() ? zigNormFromUniform( rng.generate(), rng ) : randNormClassic( rng );
+}
+
+double NC::randExp( RNG& rng )
+{
+  return useZiggurat() ? zigExpFromUniform( rng.generate(), rng ) : randExpClassic( rng );
+}
+
+void NC::randNormMany( RNG& rng, double* out, std::size_t n )
+{
+  if ( !useZiggurat() ) {
+    std::size_t i = 0;
+    for ( ; i + 1 < n; i += 2 )
+      randNorm( rng, out[i], out[i+1] );
+    if ( i < n )
+      out[i] = randNormClassic( rng );
+    return;
+  }
+  rng.generateMany( out, n );
+  for ( std::size_t i = 0; i < n; ++i )
+    out[i] = zigNormFromUniform( out[i], rng );
+}
+
+void NC::randExpMany( RNG& rng, double* out, std::size_t n )
+{
+  rng.generateMany( out, n );
+  if ( !useZiggurat() ) {
+    for ( std::size_t i = 0; i < n; ++i )
+      out[i] = -std::log( out[i] );
+    return;
+  }
+  for ( std::size_t i = 0; i < n; ++i )
+    out[i] = zigExpFromUniform( out[i], rng );
+}
+
+double NC::randNormClassic( NC::RNG& rng )
 {
   //sample a single value from a unit normal distribution via the ratio method.
   //
@@ -119,6 +369,12 @@ double NC::randNorm( NC::RNG& rng )
 
 void NC::randNorm( NC::RNG& rng, double&g1, double&g2)
 {
+  if ( useZiggurat() ) {
+    g1 = zigNormFromUniform( rng.generate(), rng );
+    g2 = zigNormFromUniform( rng.generate(), rng );
+    return;
+  }
+
   //sample two independent values from a unit normal distribution via the polar method.
   //
   //The loop runs on average 4/pi ~= 1.27 times.
@@ -144,12 +400,10 @@ double NC::randNormTail(double tail, NC::RNG& rng)
     //exponential distribution with ziggurat sampling,
     //cf. https://en.wikipedia.org/wiki/Ziggurat_algorithm):
     //
-    //NB: The threshold value 0.8 came out of benchmarks. If e.g. -log(R)
-    //would be replaced by something faster, this should be retuned.
+    //NB: The threshold value 0.8 came out of benchmarks with -log(R)
+    //exponential sampling (randExp might instead use the ziggurat method).
     const double minvtail = 1.0/tail;
     while (true) {
-      //NB: If we ever implement a faster alternative to -log(R) exponential
-      //sampling, we can use it here instead!
       double x = minvtail * randExp(rng);
       double y = randExp(rng);
       if (2*y > x*x)
@@ -257,10 +511,18 @@ double NC::randExpDivSqrt( RNG& rng, double c, double a, double b )
 
     const double U = c*(b-a);
     const double invA = 1.0/A;
-    RandExpIntervalSampler expsampler(0,U,1.0);//cost 1 std::expm1
+    //When exp(-U) is negligible, values from the untruncated (and with the
+    //ziggurat method cheaper to sample) exponential only rarely need to be
+    //rejected:
+    const bool untruncated = ( U > 10.0 && useZiggurat() );
+    RandExpIntervalSampler expsampler;
+    if ( !untruncated )
+      expsampler.set(0,U,1.0);//cost 1 std::expm1
 
     while (true) {
-      double ugen = expsampler.sample(rng);//cost 1 std::log + 1 RNG
+      double ugen = ( untruncated ? randExp(rng) : expsampler.sample(rng) );//cost 1 std::log + 1 RNG (unless untruncated)
+      if ( ugen > U )
+        continue;
       double R = rng.generate();//cost 1 RNG
       if ( (1.0+ugen*invA)*R*R<1.0 )
         return ncclamp( (ugen+A)/c, a, b );//accepted, return corresponding x.
@@ -359,7 +621,7 @@ double NC::randExpDivSqrt( RNG& rng, double c, double a, double b )
         }
       }
       //Expensive check needed:
-      if ( Raccept < std::exp(-ugen) )
+      if ( Raccept < ncexp(-ugen) )
         break;//accept
     }
     return ncclamp( (ugen+A)/c, a, b );//accepted, return corresponding x.
@@ -536,3 +798,47 @@ uint64_t NC::RandXRSRImpl::splitmix64(uint64_t& x)
   z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
   return z ^ (z >> 31);
 }
+
+NC::RandPhiloxImpl::RandPhiloxImpl( uint64_t key, uint64_t stream, uint64_t position )
+  : m_key(key), m_stream(stream), m_pos(position)
+{
+  //Buffer is always filled before use at even positions, but must be
+  //initialised when starting at an odd position:
+  if ( m_pos & 1 )
+    fillBuffer();
+}
+
+NC::RandPhiloxImpl::block_t NC::RandPhiloxImpl::philox4x32_10( block_t c, uint64_t key )
+{
+  constexpr uint64_t M0 = 0xD2511F53;
+  constexpr uint64_t M1 = 0xCD9E8D57;
+  constexpr uint32_t W0 = 0x9E3779B9;
+  constexpr uint32_t W1 = 0xBB67AE85;
+  uint32_t k0 = static_cast<uint32_t>( key );
+  uint32_t k1 = static_cast<uint32_t>( key >> 32 );
+  for ( unsigned round = 0; round < 10; ++round ) {
+    if ( round ) {
+      k0 += W0;
+      k1 += W1;
+    }
+    const uint64_t p0 = M0 * c[0];
+    const uint64_t p1 = M1 * c[2];
+    c = block_t{ static_cast<uint32_t>( p1 >> 32 ) ^ c[1] ^ k0,
+          static_cast<uint32_t>( p1 ),
+                 static_cast<uint32_t>( p0 >> 32 ) ^ c[3] ^ k1,
+                 static_cast<uint32_t>( p0 ) };
+  }
+  return c;
+}
+
+void NC::RandPhiloxImpl::fillBuffer()
+{
+  const uint64_t blockidx = m_pos >> 1;
+  const block_t r = philox4x32_10( { static_cast<uint32_t>( blockidx ),
+                                     static_cast<uint32_t>( blockidx >> 32 ),
+                                     static_cast<uint32_t>( m_stream ),
+                                     static_cast<uint32_t>( m_stream >> 32 ) },
+                                   m_key );
+  m_buf[0] = ( uint64_t{ r[0] } << 32 ) | r[1];
+  m_buf[1] = ( uint64_t{ r[2] } << 32 ) | r[3];
+}
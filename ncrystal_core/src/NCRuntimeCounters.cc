@@ -0,0 +1,160 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/internal/NCRuntimeCounters.hh"
+#include "NCrystal/internal/NCString.hh"
+#include <map>
+
+namespace NC = NCrystal;
+namespace NCRC = NCrystal::RuntimeCounters;
+
+namespace NCrystal {
+  namespace RuntimeCounters {
+    namespace {
+
+      constexpr const char * counterNames[nCounters] = { "xs_calls",
+                                                         "sample_calls",
+                                                         "cache_hits",
+                                                         "cache_misses",
+                                                         "rejection_iterations",
+                                                         "rng_draws" };
+
+      //Blocks are never deleted (process uids are never reused), so pointers
+      //to them can be cached without locking:
+      struct Registry {
+        std::mutex mtx;
+        std::map<uint64_t,std::unique_ptr<Block>> blocks;
+      };
+      Registry& registry()
+      {
+        static Registry s_reg;
+        return s_reg;
+      }
+
+      Block& lookupOrCreateBlock( const ProcImpl::Process& proc )
+      {
+        const auto uid = proc.getUniqueID();
+        auto& reg = registry();
+        NCRYSTAL_LOCK_GUARD(reg.mtx);
+        auto it = reg.blocks.find( uid.value );
+        if ( it != reg.blocks.end() )
+          return *it->second;
+        auto b = std::make_unique<Block>();
+        b->uid = uid;
+        b->name = proc.name();
+        for ( auto& v : b->values )
+          v.store( 0, std::memory_order_relaxed );
+        Block& res = *b;
+        reg.blocks[uid.value] = std::move(b);
+        return res;
+      }
+
+      struct BlockCacheEntry {
+        uint64_t uid = 0;
+        Block* block = nullptr;
+      };
+      constexpr std::size_t blockCacheSize = 64;
+
+      void streamBlockJSON( std::ostream& os, const Block& b )
+      {
+        streamJSONDictEntry( os, "name", b.name, JSONDictPos::FIRST );
+        for ( unsigned i = 0; i < nCounters; ++i )
+          streamJSONDictEntry( os, counterNames[i],
+                               static_cast<std::uint64_t>( b.values[i].load( std::memory_order_relaxed ) ),
+                               ( i + 1 == nCounters ? JSONDictPos::LAST : JSONDictPos::OTHER ) );
+      }
+    }
+  }
+}
+
+NCRC::Block& NCRC::blockFor( const ProcImpl::Process& proc )
+{
+  //Small direct-mapped per-thread cache in front of the registry, to avoid
+  //locking a mutex for every call:
+#ifndef NCRYSTAL_DISABLE_THREADS
+  static thread_local BlockCacheEntry s_cache[blockCacheSize];
+#else
+  static BlockCacheEntry s_cache[blockCacheSize];
+#endif
+  const auto uid = proc.getUniqueID().value;
+  auto& entry = s_cache[ uid % blockCacheSize ];
+  if ( entry.block && entry.uid == uid )
+    return *entry.block;
+  Block& b = lookupOrCreateBlock( proc );
+  entry.uid = uid;
+  entry.block = &b;
+  return b;
+}
+
+NCRC::Block*& NCRC::activeBlock()
+{
+#ifndef NCRYSTAL_DISABLE_THREADS
+  static thread_local Block* s_active = nullptr;
+#else
+  static Block* s_active = nullptr;
+#endif
+  return s_active;
+}
+
+std::string NCRC::jsonSummary()
+{
+  std::ostringstream ss;
+  auto& reg = registry();
+  NCRYSTAL_LOCK_GUARD(reg.mtx);
+  ss << '{';
+  bool first = true;
+  for ( auto& e : reg.blocks ) {
+    const Block& b = *e.second;
+    bool anyNonZero = false;
+    for ( auto& v : b.values )
+      if ( v.load( std::memory_order_relaxed ) )
+        anyNonZero = true;
+    if ( !anyNonZero )
+      continue;
+    if ( !first )
+      ss << ',';
+    first = false;
+    ss << '"' << e.first << "\":";
+    streamBlockJSON( ss, b );
+  }
+  ss << '}';
+  return ss.str();
+}
+
+NC::Optional<std::string> NCRC::jsonForProcess( UniqueIDValue uid )
+{
+  auto& reg = registry();
+  NCRYSTAL_LOCK_GUARD(reg.mtx);
+  auto it = reg.blocks.find( uid.value );
+  if ( it == reg.blocks.end() )
+    return NullOpt;
+  std::ostringstream ss;
+  streamBlockJSON( ss, *it->second );
+  return ss.str();
+}
+
+void NCRC::reset()
+{
+  auto& reg = registry();
+  NCRYSTAL_LOCK_GUARD(reg.mtx);
+  for ( auto& e : reg.blocks )
+    for ( auto& v : e.second->values )
+      v.store( 0, std::memory_order_relaxed );
+}
@@ -22,6 +22,27 @@
 namespace NC = NCrystal;
 
 
+NC::ImmutableDblArray::ImmutableDblArray( VectD&& v )
+{
+  auto sp = std::make_shared<const VectD>( std::move(v) );
+  m_data = sp->empty() ? nullptr : sp->data();
+  m_size = sp->size();
+  m_keepalive = std::move(sp);
+}
+
+NC::ImmutableDblArray::ImmutableDblArray( const double * data, size_type n, std::shared_ptr<const void> keepalive )
+  : m_data(n?data:nullptr), m_size(n), m_keepalive(std::move(keepalive))
+{
+  nc_assert_always( n == 0 || ( data != nullptr && m_keepalive != nullptr ) );
+}
+
+const double& NC::ImmutableDblArray::at( size_type i ) const
+{
+  if ( !( i < m_size ) )
+    NCRYSTAL_THROW(LogicError,"ImmutableDblArray::at index out of range");
+  return m_data[i];
+}
+
 NC::SABData::SABData( VectD&& alphaGrid,
                       VectD&& betaGrid,
                       VectD&& sab,
@@ -29,6 +50,18 @@ NC::SABData::SABData( VectD&& alphaGrid,
                       SigmaBound boundXS,
                       AtomMass elementMassAMU,
                       double suggestedEmax )
+  : SABData( std::move(alphaGrid), std::move(betaGrid), ImmutableDblArray( std::move(sab) ),
+             temperature, boundXS, elementMassAMU, suggestedEmax )
+{
+}
+
+NC::SABData::SABData( VectD&& alphaGrid,
+                      VectD&& betaGrid,
+                      ImmutableDblArray sab,
+                      Temperature temperature,
+                      SigmaBound boundXS,
+                      AtomMass elementMassAMU,
+                      double suggestedEmax )
   : m_a(std::move(alphaGrid)),
     m_b(std::move(betaGrid)),
     m_sab(std::move(sab)),
@@ -49,6 +82,11 @@ NC::SABData::SABData( VectD&& alphaGrid,
   nc_assert(m_b.front()<0.0);
 }
 
+std::size_t NC::SABData::memoryFootprint() const noexcept
+{
+  return sizeof(SABData) + ( m_a.capacity() + m_b.capacity() + m_sab.size() ) * sizeof(double);
+}
+
 NC::VDOSData::VDOSData( PairDD egrid,
                         VectD&& density,
                         Temperature temperature,
@@ -0,0 +1,414 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/internal/NCSABDiskCache.hh"
+#include "NCrystal/internal/NCFileUtils.hh"
+#include "NCrystal/internal/NCString.hh"
+#include "NCrystal/NCVersion.hh"
+#include <fstream>
+#include <cstring>
+#include <limits>
+#include <map>
+#ifndef NCRYSTAL_DISABLE_THREADS
+#  include <mutex>
+#endif
+#if defined(__unix__) || (defined (__APPLE__) && defined (__MACH__))
+#  define NCRYSTAL_SABDISKCACHE_USE_MMAP
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+namespace NC = NCrystal;
+namespace NCSDC = NCrystal::SABDiskCache;
+
+namespace NCrystal {
+  namespace SABDiskCache {
+    namespace {
+
+      constexpr char magic[8] = { 'N','C','S','A','B','K','C','\0' };
+      constexpr char magicDerived[8] = { 'N','C','S','A','B','K','D','\0' };
+      constexpr uint64_t formatVersion = 2;
+      constexpr uint64_t byteOrderMarker = 0x0102030405060708ull;
+
+      struct FileHeader {
+        char magic[8];
+        uint64_t formatVersion;
+        uint64_t ncrystalVersion;
+        uint64_t byteOrderMarker;
+        uint64_t keyMaterialSize;
+        uint64_t nalpha;
+        uint64_t nbeta;
+        double temperature;
+        double boundXS;
+        double elementMassAMU;
+        double suggestedEmax;
+        uint64_t sabValueSize;//sizeof(double) or sizeof(float)
+      };
+      static_assert( sizeof(FileHeader) == 12*8, "" );
+
+      struct DerivedFileHeader {
+        char magic[8];
+        uint64_t formatVersion;
+        uint64_t ncrystalVersion;
+        uint64_t byteOrderMarker;
+        uint64_t keyMaterialHash;
+        uint64_t nsab;
+      };
+      static_assert( sizeof(DerivedFileHeader) == 6*8, "" );
+
+      DiskCacheDirSetting& cacheDirSetting()
+      {
+        static DiskCacheDirSetting s_setting("SAB_CACHEDIR");
+        return s_setting;
+      }
+
+      std::string cacheDir()
+      {
+        return cacheDirSetting().get();
+      }
+
+      bool storeAsFloat32()
+      {
+        static bool s_f32 = ncgetenv_bool("SAB_CACHE_FLOAT32");
+        return s_f32;
+      }
+
+      std::size_t paddedSize( std::size_t n )
+      {
+        return ( ( n + 7 ) / 8 ) * 8;
+      }
+
+      std::string cacheFileName( const KeyMaterial& km )
+      {
+        return diskCacheFileName( cacheDir(), "ncsabknl_", km );
+      }
+
+      template<class T>
+      void writeRaw( std::ostream& os, const T* src, std::size_t n )
+      {
+        os.write( reinterpret_cast<const char*>(src), n * sizeof(T) );
+      }
+
+      class MappedFile : private NoCopyMove {
+        //Read-only file content, memory mapped where supported (otherwise
+        //simply read into memory). Content is always 8-byte aligned.
+      public:
+        static std::shared_ptr<const MappedFile> open( const std::string& path );
+        const char * data() const { return m_data; }
+        std::size_t size() const { return m_size; }
+        const std::string& path() const { return m_path; }
+        MappedFile() = default;
+        ~MappedFile();
+      private:
+        const char * m_data = nullptr;
+        std::size_t m_size = 0;
+        std::string m_path;
+#ifndef NCRYSTAL_SABDISKCACHE_USE_MMAP
+        VectD m_buf;
+#endif
+      };
+
+#ifdef NCRYSTAL_SABDISKCACHE_USE_MMAP
+      MappedFile::~MappedFile()
+      {
+        if ( m_data )
+          munmap( const_cast<char*>(m_data), m_size );
+      }
+
+      std::shared_ptr<const MappedFile> MappedFile::open( const std::string& path )
+      {
+        int fd = ::open( path.c_str(), O_RDONLY );
+        if ( fd < 0 )
+          return nullptr;
+        struct stat st;
+        if ( fstat( fd, &st ) != 0 || st.st_size <= 0 ) {
+          ::close( fd );
+          return nullptr;
+        }
+        const std::size_t len = static_cast<std::size_t>( st.st_size );
+        void * addr = mmap( nullptr, len, PROT_READ, MAP_SHARED, fd, 0 );
+        ::close( fd );//mapping stays valid after closing
+        if ( addr == MAP_FAILED )
+          return nullptr;
+        auto mf = std::make_shared<MappedFile>();
+        mf->m_data = static_cast<const char*>(addr);
+        mf->m_size = len;
+        mf->m_path = path;
+        return mf;
+      }
+#else
+      MappedFile::~MappedFile() = default;
+
+      std::shared_ptr<const MappedFile> MappedFile::open( const std::string& path )
+      {
+        std::ifstream fh( path, std::ios::binary | std::ios::ate );
+        if ( !fh.good() )
+          return nullptr;
+        const auto len = fh.tellg();
+        if ( !( len > 0 ) )
+          return nullptr;
+        auto mf = std::make_shared<MappedFile>();
+        mf->m_buf.resize( ( static_cast<std::size_t>(len) + 7 ) / 8 );
+        fh.seekg( 0 );
+        fh.read( reinterpret_cast<char*>( mf->m_buf.data() ), len );
+        if ( !fh.good() )
+          return nullptr;
+        mf->m_data = reinterpret_cast<const char*>( mf->m_buf.data() );
+        mf->m_size = static_cast<std::size_t>(len);
+        mf->m_path = path;
+        return mf;
+      }
+#endif
+
+      //Registry of main files in use by live SABData objects, needed to find
+      //the associated .derived files. Entries are keyed by the storage of the
+      //S(alpha,beta) values, which is the mapped file itself, or a VectD in
+      //case of float32 files (where values are promoted upon loading):
+      struct MappedFileEntry {
+        std::weak_ptr<const void> storage;
+        std::string path;
+        uint64_t keyMaterialHash;
+      };
+      struct MappedFileRegistry {
+#ifndef NCRYSTAL_DISABLE_THREADS
+        std::mutex mtx;
+#endif
+        std::map<const void*,MappedFileEntry> entries;
+      };
+      MappedFileRegistry& mappedFileRegistry()
+      {
+        static MappedFileRegistry s_reg;
+        return s_reg;
+      }
+
+      void registerMappedFile( const std::shared_ptr<const void>& storage,
+                               const MappedFile& mf, uint64_t keyMaterialHash )
+      {
+        auto& reg = mappedFileRegistry();
+#ifndef NCRYSTAL_DISABLE_THREADS
+        std::lock_guard<std::mutex> guard(reg.mtx);
+#endif
+        //Cleanup expired entries:
+        for ( auto it = reg.entries.begin(); it != reg.entries.end(); ) {
+          if ( it->second.storage.expired() )
+            it = reg.entries.erase( it );
+          else
+            ++it;
+        }
+        reg.entries[storage.get()] = MappedFileEntry{ storage, mf.path(), keyMaterialHash };
+      }
+
+      //Returns path of main file (and key material hash) used for SABData, if any:
+      std::pair<std::string,uint64_t> findMappedFile( const SABData& data )
+      {
+        auto& reg = mappedFileRegistry();
+#ifndef NCRYSTAL_DISABLE_THREADS
+        std::lock_guard<std::mutex> guard(reg.mtx);
+#endif
+        auto it = reg.entries.find( data.sab().storage().get() );
+        if ( it == reg.entries.end() )
+          return { std::string(), 0 };
+        auto storage = it->second.storage.lock();
+        if ( storage.get() != data.sab().storage().get() )
+          return { std::string(), 0 };
+        return { it->second.path, it->second.keyMaterialHash };
+      }
+
+      std::string derivedFileName( const std::string& mainfilepath )
+      {
+        return mainfilepath + ".derived";
+      }
+
+    }
+  }
+}
+
+void NCSDC::setCacheDir( std::string dir )
+{
+  cacheDirSetting().set( std::move(dir) );
+}
+
+std::string NCSDC::getCacheDir()
+{
+  return cacheDir();
+}
+
+bool NCSDC::isEnabled()
+{
+  return !cacheDir().empty();
+}
+
+std::shared_ptr<const NC::SABData> NCSDC::load( const KeyMaterial& km )
+{
+  if ( !isEnabled() )
+    return nullptr;
+  auto mf = MappedFile::open( cacheFileName( km ) );
+  if ( !mf || mf->size() < sizeof(FileHeader) )
+    return nullptr;
+
+  FileHeader hdr;
+  std::memcpy( &hdr, mf->data(), sizeof(hdr) );
+  if ( std::memcmp( hdr.magic, magic, sizeof(magic) ) != 0
+       || hdr.formatVersion != formatVersion
+       || hdr.ncrystalVersion != static_cast<uint64_t>(NCRYSTAL_VERSION)
+       || hdr.byteOrderMarker != byteOrderMarker
+       || hdr.keyMaterialSize != km.str().size()
+       || hdr.nalpha < 2 || hdr.nbeta < 2
+       || hdr.nalpha > 1000000 || hdr.nbeta > 1000000
+       || !( hdr.sabValueSize == sizeof(double) || hdr.sabValueSize == sizeof(float) ) )
+    return nullptr;
+
+  const std::size_t na = static_cast<std::size_t>( hdr.nalpha );
+  const std::size_t nb = static_cast<std::size_t>( hdr.nbeta );
+  const std::size_t offset_km = sizeof(FileHeader);
+  const std::size_t offset_alpha = offset_km + paddedSize( km.str().size() );
+  const std::size_t offset_beta = offset_alpha + na * sizeof(double);
+  const std::size_t offset_sab = offset_beta + nb * sizeof(double);
+  const std::size_t sabValueSize = static_cast<std::size_t>( hdr.sabValueSize );
+  if ( mf->size() != offset_sab + paddedSize( na * nb * sabValueSize ) )
+    return nullptr;
+  if ( std::memcmp( mf->data() + offset_km, km.str().data(), km.str().size() ) != 0 )
+    return nullptr;//Different key material (hash collision or corrupted file).
+
+  auto dblptr = [&mf]( std::size_t offset ) { return reinterpret_cast<const double*>( mf->data() + offset ); };
+  ImmutableDblArray sab;
+  if ( sabValueSize == sizeof(double) ) {
+    sab = ImmutableDblArray( dblptr( offset_sab ), na * nb, mf );
+  } else {
+    const float * fltptr = reinterpret_cast<const float*>( mf->data() + offset_sab );
+    sab = ImmutableDblArray( VectD( fltptr, fltptr + na * nb ) );
+  }
+  registerMappedFile( sab.storage(), *mf, km.hash() );
+  try {
+    return std::make_shared<const SABData>( VectD( dblptr( offset_alpha ), dblptr( offset_alpha ) + na ),
+                                            VectD( dblptr( offset_beta ), dblptr( offset_beta ) + nb ),
+                                            std::move(sab),
+                                            Temperature{ hdr.temperature }, SigmaBound{ hdr.boundXS },
+                                            AtomMass{ hdr.elementMassAMU }, hdr.suggestedEmax );
+  } catch ( Error::Exception& ) {
+    return nullptr;//invalid content
+  }
+}
+
+std::shared_ptr<const NC::SABData> NCSDC::store( const KeyMaterial& km, const SABData& data )
+{
+  if ( !isEnabled() )
+    return nullptr;
+  //Optionally store S(alpha,beta) values in single precision, unless values
+  //are out of range (values below the float range are flushed to zero):
+  bool asFloat32 = storeAsFloat32();
+  if ( asFloat32 ) {
+    for ( auto e : data.sab() ) {
+      if ( !( e <= std::numeric_limits<float>::max() ) ) {
+        asFloat32 = false;
+        break;
+      }
+    }
+  }
+  auto writefct = [&km,&data,asFloat32]( std::ostream& os )
+  {
+    FileHeader hdr;
+    std::memcpy( hdr.magic, magic, sizeof(magic) );
+    hdr.formatVersion = formatVersion;
+    hdr.ncrystalVersion = static_cast<uint64_t>(NCRYSTAL_VERSION);
+    hdr.byteOrderMarker = byteOrderMarker;
+    hdr.keyMaterialSize = km.str().size();
+    hdr.nalpha = data.alphaGrid().size();
+    hdr.nbeta = data.betaGrid().size();
+    hdr.temperature = data.temperature().dbl();
+    hdr.boundXS = data.boundXS().dbl();
+    hdr.elementMassAMU = data.elementMassAMU().dbl();
+    hdr.suggestedEmax = data.suggestedEmax();
+    hdr.sabValueSize = asFloat32 ? sizeof(float) : sizeof(double);
+    writeRaw( os, &hdr, 1 );
+    std::string kmPadded = km.str();
+    kmPadded.resize( paddedSize( kmPadded.size() ), '\0' );
+    writeRaw( os, kmPadded.data(), kmPadded.size() );
+    writeRaw( os, data.alphaGrid().data(), data.alphaGrid().size() );
+    writeRaw( os, data.betaGrid().data(), data.betaGrid().size() );
+    if ( asFloat32 ) {
+      std::vector<float> sabf;
+      sabf.reserve( paddedSize( data.sab().size() * sizeof(float) ) / sizeof(float) );
+      for ( auto e : data.sab() )
+        sabf.push_back( static_cast<float>( e ) );
+      sabf.resize( sabf.capacity(), 0.0f );//padding
+      writeRaw( os, sabf.data(), sabf.size() );
+    } else {
+      writeRaw( os, data.sab().data(), data.sab().size() );
+    }
+  };
+  if ( !writeFileAtomically( cacheFileName( km ), writefct ) )
+    return nullptr;
+  return load( km );
+}
+
+NC::Optional<NCSDC::DerivedArrays> NCSDC::loadDerived( const SABData& data )
+{
+  auto mainfile = findMappedFile( data );
+  if ( mainfile.first.empty() )
+    return NullOpt;
+  auto mf = MappedFile::open( derivedFileName( mainfile.first ) );
+  if ( !mf || mf->size() < sizeof(DerivedFileHeader) )
+    return NullOpt;
+  DerivedFileHeader hdr;
+  std::memcpy( &hdr, mf->data(), sizeof(hdr) );
+  const std::size_t n = data.sab().size();
+  if ( std::memcmp( hdr.magic, magicDerived, sizeof(magicDerived) ) != 0
+       || hdr.formatVersion != formatVersion
+       || hdr.ncrystalVersion != static_cast<uint64_t>(NCRYSTAL_VERSION)
+       || hdr.byteOrderMarker != byteOrderMarker
+       || hdr.keyMaterialHash != mainfile.second
+       || hdr.nsab != n
+       || mf->size() != sizeof(DerivedFileHeader) + 2 * n * sizeof(double) )
+    return NullOpt;
+  auto dblptr = reinterpret_cast<const double*>( mf->data() + sizeof(DerivedFileHeader) );
+  DerivedArrays res{ ImmutableDblArray( dblptr, n, mf ),
+                     ImmutableDblArray( dblptr + n, n, mf ) };
+  return res;
+}
+
+NC::Optional<NCSDC::DerivedArrays> NCSDC::storeDerived( const SABData& data,
+                                                        const VectD& logsab,
+                                                        const VectD& alphaintegrals_cumul )
+{
+  nc_assert_always( logsab.size() == data.sab().size() );
+  nc_assert_always( alphaintegrals_cumul.size() == data.sab().size() );
+  auto mainfile = findMappedFile( data );
+  if ( mainfile.first.empty() )
+    return NullOpt;
+  auto writefct = [&]( std::ostream& os )
+  {
+    DerivedFileHeader hdr;
+    std::memcpy( hdr.magic, magicDerived, sizeof(magicDerived) );
+    hdr.formatVersion = formatVersion;
+    hdr.ncrystalVersion = static_cast<uint64_t>(NCRYSTAL_VERSION);
+    hdr.byteOrderMarker = byteOrderMarker;
+    hdr.keyMaterialHash = mainfile.second;
+    hdr.nsab = data.sab().size();
+    writeRaw( os, &hdr, 1 );
+    writeRaw( os, logsab.data(), logsab.size() );
+    writeRaw( os, alphaintegrals_cumul.data(), alphaintegrals_cumul.size() );
+  };
+  if ( !writeFileAtomically( derivedFileName( mainfile.first ), writefct ) )
+    return NullOpt;
+  return loadDerived( data );
+}
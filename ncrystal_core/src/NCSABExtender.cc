@@ -19,21 +19,41 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "NCrystal/internal/NCSABExtender.hh"
+#include "NCrystal/internal/NCString.hh"
+#include <atomic>
 namespace NC = NCrystal;
 
+struct NC::SAB::SABFGExtender::TabulatedTail {
+  std::mutex mtx;
+  std::atomic<const TabulatedFreeGasSampler*> sampler{nullptr};
+  std::shared_ptr<const TabulatedFreeGasSampler> owner;
+};
+
 NC::SAB::SABExtender::~SABExtender() = default;
 
+NC::PairDD NC::SAB::SABExtender::sampleAlphaBetaUntilKept( RNG& rng, NeutronEnergy ekin,
+                                                           const DiscardFct& discard ) const
+{
+  while (true) {
+    auto alphabeta = sampleAlphaBeta(rng,ekin);
+    if ( !discard(rng,alphabeta) )
+      return alphabeta;
+  }
+}
+
 NC::SAB::SABFGExtender::SABFGExtender( Temperature temp_k, AtomMass mass, NC::SigmaFree sigma )
   : m_xsprovider(temp_k,mass,sigma),
     m_t(DoValidate,temp_k),
-    m_m(DoValidate,mass)
+    m_m(DoValidate,mass),
+    m_tail(std::make_unique<TabulatedTail>())
 {
 }
 
 NC::SAB::SABFGExtender::SABFGExtender( Temperature temp_k, AtomMass mass, NC::SigmaBound sigma )
   : m_xsprovider(temp_k,mass,sigma),
     m_t(DoValidate,temp_k),
-    m_m(DoValidate,mass)
+    m_m(DoValidate,mass),
+    m_tail(std::make_unique<TabulatedTail>())
 {
 }
 
@@ -44,7 +64,47 @@ NC::CrossSect NC::SAB::SABFGExtender::crossSection(NeutronEnergy ekin) const
   return m_xsprovider.crossSection(ekin);
 }
 
+const NC::TabulatedFreeGasSampler * NC::SAB::SABFGExtender::tabulatedSampler( NeutronEnergy ekin ) const
+{
+  static const bool s_exact = ncgetenv_bool("SAB_EXACT_FGTAIL");
+  if ( s_exact || ekin.dbl() < 5.0 * m_t.kT() )
+    return nullptr;//disabled, or below range of tables
+  const TabulatedFreeGasSampler * ts = m_tail->sampler.load( std::memory_order_acquire );
+  if ( !ts ) {
+    NCRYSTAL_LOCK_GUARD( m_tail->mtx );
+    ts = m_tail->sampler.load( std::memory_order_relaxed );
+    if ( !ts ) {
+      m_tail->owner = getTabulatedFreeGasSampler( m_t, m_m ).getsp();
+      ts = m_tail->owner.get();
+      m_tail->sampler.store( ts, std::memory_order_release );
+    }
+  }
+  return ts->covers( ekin ) ? ts : nullptr;
+}
+
 NC::PairDD NC::SAB::SABFGExtender::sampleAlphaBeta( RNG& rng, NeutronEnergy ekin ) const
 {
+  auto ts = tabulatedSampler( ekin );
+  if ( ts )
+    return ts->sampleAlphaBeta( ekin, rng );
   return FreeGasSampler(ekin, m_t, m_m).sampleAlphaBeta(rng);
 }
+
+NC::PairDD NC::SAB::SABFGExtender::sampleAlphaBetaUntilKept( RNG& rng, NeutronEnergy ekin,
+                                                             const DiscardFct& discard ) const
+{
+  auto ts = tabulatedSampler( ekin );
+  if ( ts ) {
+    while (true) {
+      auto alphabeta = ts->sampleAlphaBeta( ekin, rng );
+      if ( !discard(rng,alphabeta) )
+        return alphabeta;
+    }
+  }
+  FreeGasSampler sampler(ekin, m_t, m_m);
+  while (true) {
+    auto alphabeta = sampler.sampleAlphaBeta(rng);
+    if ( !discard(rng,alphabeta) )
+      return alphabeta;
+  }
+}
@@ -22,16 +22,17 @@
 #include "NCrystal/internal/NCSABIntegrator.hh"
 #include "NCrystal/internal/NCMath.hh"
 #include "NCrystal/internal/NCFactoryUtils.hh"
+#include "NCrystal/NCFactImpl.hh"
 
 namespace NC = NCrystal;
 
 namespace NCrystal {
   namespace SAB {
 
-    //Cache key is (sabdata uid, egrid uid, sabdata ptr):
+    //Cache key is (sabdata uid, egrid uid, sampler alg, sabdata ptr):
     //TODO: we should use new thin-key support instead of these
     //shared_obj<const NC::SABData>* pointers!
-    typedef std::tuple<UniqueIDValue,UniqueIDValue,shared_obj<const NC::SABData>*> ScatHelperCacheKey;
+    typedef std::tuple<UniqueIDValue,UniqueIDValue,SamplerAlg,shared_obj<const NC::SABData>*> ScatHelperCacheKey;
 
     class ScatterHelperFactory : public NC::CachedFactoryBase<ScatHelperCacheKey,SABScatterHelper> {
     public:
@@ -39,43 +40,147 @@ namespace NCrystal {
       std::string keyToString( const ScatHelperCacheKey& key ) const final
       {
         std::ostringstream ss;
-        ss<<"(SABData id="<<std::get<0>(key).value<<";egrid id="<<std::get<1>(key).value<<")";
+        ss<<"(SABData id="<<std::get<0>(key).value<<";egrid id="<<std::get<1>(key).value
+          <<";sampleralg="<<static_cast<unsigned>(std::get<2>(key))<<")";
         return ss.str();
       }
+      void clearScaledKernelRegistry()
+      {
+        NCRYSTAL_LOCK_GUARD(m_registryMutex);
+        m_registry.clear();
+      }
     protected:
       virtual ShPtr actualCreate( const ScatHelperCacheKey& key ) const final
       {
-        auto sabdata_shptr = *std::get<2>(key);
+        auto sabdata_shptr = *std::get<3>(key);
         nc_assert( sabdata_shptr->getUniqueID() == std::get<0>(key) );
         auto egrid_shptr = egridFromUniqueID(std::get<1>(key));
-        return createScatterHelper(std::move(sabdata_shptr),std::move(egrid_shptr));
+        const HashValue hash = scaledKernelHash( key );
+        auto reference = findScaledKernel( hash, *sabdata_shptr, std::get<1>(key), std::get<2>(key) );
+        ShPtr result;
+        if ( reference.first != nullptr ) {
+          SABIntegrator si(sabdata_shptr,egrid_shptr.get(),nullptr,std::get<2>(key));
+          result = std::make_shared<const SABScatterHelper>( si.createScaledScatterHelper( *reference.first,
+                                                                                         reference.second ) );
+        } else {
+          result = createScatterHelper(sabdata_shptr,std::move(egrid_shptr),std::get<2>(key));
+        }
+        NCRYSTAL_LOCK_GUARD(m_registryMutex);
+        m_registry[hash].push_back( RegistryEntry{ sabdata_shptr.getsp(), result, sabdata_shptr->boundXS(),
+                                                   std::get<1>(key), std::get<2>(key) } );
+        return result;
+      }
+
+    private:
+      //Kernels which only differ in their boundXS values (e.g. rescaled copies of
+      //the same kernel, or Debye model kernels of different elements with
+      //similar masses) can share samplers, and their cross sections follow
+      //from simple rescaling. To find such kernels, we keep a registry of all
+      //created helpers, indexed by a hash of the SABData fields other than
+      //boundXS and the S values (the latter are only compared when all other
+      //fields match):
+      struct RegistryEntry {
+        std::weak_ptr<const SABData> data;
+        std::weak_ptr<const SABScatterHelper> helper;
+        SigmaBound boundXS;
+        UniqueIDValue egridID;
+        SamplerAlg alg;
+      };
+      mutable std::mutex m_registryMutex;
+      mutable std::map<HashValue,std::vector<RegistryEntry>> m_registry;
+
+      static HashValue scaledKernelHash( const ScatHelperCacheKey& key )
+      {
+        const SABData& d = **std::get<3>(key);
+        HashValue h = hashContainer( d.alphaGrid() );
+        hash_combine( h, hashContainer( d.betaGrid() ) );
+        hash_combine( h, d.sab().size() );
+        hash_combine( h, d.temperature().dbl() );
+        hash_combine( h, d.elementMassAMU().dbl() );
+        hash_combine( h, d.suggestedEmax() );
+        hash_combine( h, std::get<1>(key).value );
+        hash_combine( h, static_cast<unsigned>(std::get<2>(key)) );
+        return h;
+      }
+
+      static bool identicalUpToBoundXS( const SABData& a, const SABData& b )
+      {
+        if ( a.temperature() != b.temperature()
+             || a.elementMassAMU() != b.elementMassAMU()
+             || a.suggestedEmax() != b.suggestedEmax()
+             || a.alphaGrid() != b.alphaGrid()
+             || a.betaGrid() != b.betaGrid()
+             || a.sab().size() != b.sab().size() )
+          return false;
+        //Shared storage (common for Debye model kernels) needs no comparison:
+        return a.sab().data() == b.sab().data()
+          || std::equal( a.sab().begin(), a.sab().end(), b.sab().begin() );
+      }
+
+      std::pair<std::shared_ptr<const SABScatterHelper>,SigmaBound>
+      findScaledKernel( HashValue hash, const SABData& data, UniqueIDValue egridID, SamplerAlg alg ) const
+      {
+        NCRYSTAL_LOCK_GUARD(m_registryMutex);
+        auto it = m_registry.find( hash );
+        if ( it == m_registry.end() )
+          return { nullptr, SigmaBound{1.0} };
+        auto& v = it->second;
+        //Forget about expired entries while looking:
+        v.erase( std::remove_if( v.begin(), v.end(),
+                                 []( const RegistryEntry& e ) { return e.data.expired() || e.helper.expired(); } ),
+                 v.end() );
+        for ( auto& e : v ) {
+          if ( e.egridID != egridID || e.alg != alg || !( e.boundXS.dbl() > 0.0 ) )
+            continue;
+          auto d = e.data.lock();
+          auto h = e.helper.lock();
+          if ( d && h && identicalUpToBoundXS( *d, data ) )
+            return { std::move(h), e.boundXS };
+        }
+        if ( v.empty() )
+          m_registry.erase( it );
+        return { nullptr, SigmaBound{1.0} };
       }
     };
 
     static ScatterHelperFactory s_scathelperfact;
+
+    std::size_t evictFromScatterHelperCache( FactImpl::CacheEvictionRequest& req )
+    {
+      return s_scathelperfact.evict( [&req]( const ScatHelperCacheKey& key, const SABScatterHelper* )
+      {
+        return req.sabDataUIDs.count( std::get<0>(key) ) > 0;
+      } );
+    }
   }
 }
 
 std::unique_ptr<const NC::SAB::SABScatterHelper> NC::SAB::createScatterHelper( shared_obj<const NC::SABData> data,
-                                                                               std::shared_ptr<const VectD> energyGrid )
+                                                                               std::shared_ptr<const VectD> energyGrid,
+                                                                               SamplerAlg alg )
 {
   nc_assert(!!data);
-  SABIntegrator si(data,energyGrid.get());
+  SABIntegrator si(data,energyGrid.get(),nullptr,alg);
   auto sh = si.createScatterHelper();
   return std::make_unique<SABScatterHelper>(std::move(sh));
 }
 
 void NC::SAB::clearScatterHelperCache() {
   s_scathelperfact.cleanup();
+  s_scathelperfact.clearScaledKernelRegistry();
 }
 
 NC::shared_obj<const NC::SAB::SABScatterHelper> NC::SAB::createScatterHelperWithCache( shared_obj<const NC::SABData> dataptr,
-                                                                                       std::shared_ptr<const VectD> egrid )
+                                                                                       std::shared_ptr<const VectD> egrid,
+                                                                                       SamplerAlg alg )
 {
   nc_assert_always(!!dataptr);
+  static bool s_evictionRegistered = ( FactImpl::registerCacheEvictionFunction( evictFromScatterHelperCache ), true );
+  (void)s_evictionRegistered;
 
   ScatHelperCacheKey key( dataptr->getUniqueID(),
                           egridToUniqueID( egrid ),
+                          alg,
                           &dataptr );
 
   return s_scathelperfact.create(key);
@@ -92,6 +197,36 @@ namespace NCrystal {
   }
 }
 
+NC::SAB::EGridDensity NC::SAB::egridDensityFromCfgValue( const std::string& sabgrid )
+{
+  return ( sabgrid == "coarse" ? EGridDensity::Coarse
+           : ( sabgrid == "fine" ? EGridDensity::Fine
+               : ( sabgrid == "adaptive" ? EGridDensity::Adaptive
+                   : EGridDensity::Default ) ) );
+}
+
+std::shared_ptr<const NC::VectD> NC::SAB::applyEGridDensity( std::shared_ptr<const VectD> egrid, EGridDensity density )
+{
+  if ( density == EGridDensity::Default )
+    return egrid;
+  if ( egrid != nullptr && egrid->size() > 3 )
+    return egrid;//complete grid, keep as is
+  VectD spec{ 0.0, 0.0, 0.0 };
+  if ( egrid != nullptr && egrid->size() == 3 )
+    spec = *egrid;
+  else if ( egrid != nullptr && !egrid->empty() )
+    return egrid;//invalid, leave it to the SABIntegrator to complain
+  const double npts_orig = ( spec.at(2) > 0.0 ? spec.at(2) : double(egridDefaultNPoints) );
+  if ( spec.at(2) < 0.0 )
+    return egrid;//already adaptive
+  spec.at(2) = ( density == EGridDensity::Coarse
+                 ? std::max<double>( 20.0, std::floor( npts_orig / 5.0 ) )
+                 : std::floor( npts_orig * 3.0 ) );
+  if ( density == EGridDensity::Adaptive )
+    spec.at(2) = -spec.at(2);
+  return std::make_shared<const VectD>( std::move(spec) );
+}
+
 NC::UniqueIDValue NC::SAB::egridToUniqueID(const NC::VectD& egrid)
 {
   //NB: code duplicated from here to following function
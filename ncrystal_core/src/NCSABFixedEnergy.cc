@@ -0,0 +1,280 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/internal/NCTabulatedXS.hh"
+#include "NCrystal/internal/NCSABFixedEnergy.hh"
+#include "NCrystal/internal/NCSABUtils.hh"
+#include "NCrystal/internal/NCMath.hh"
+
+namespace NC = NCrystal;
+
+namespace NCrystal {
+  namespace SAB {
+    namespace {
+
+      //S(alpha) on a beta row, with log-linear interpolation (0 outside grid):
+      double evalSABRow( const VectD& alphaGrid, const double * srow, double alpha )
+      {
+        if ( !( alpha >= alphaGrid.front() && alpha <= alphaGrid.back() ) )
+          return 0.0;
+        std::size_t i = std::upper_bound( alphaGrid.begin(), alphaGrid.end(), alpha ) - alphaGrid.begin();
+        if ( i == alphaGrid.size() )
+          return srow[alphaGrid.size()-1];
+        nc_assert( i > 0 );
+        return SABUtils::interpolate_loglin_fallbacklinlin( alphaGrid[i-1], srow[i-1],
+                                                            alphaGrid[i], srow[i], alpha );
+      }
+
+      double evalSAB( const SABData& data, double alpha, double beta )
+      {
+        const auto& betaGrid = data.betaGrid();
+        if ( !( beta >= betaGrid.front() && beta <= betaGrid.back() ) )
+          return 0.0;
+        const auto& alphaGrid = data.alphaGrid();
+        const std::size_t nalpha = alphaGrid.size();
+        const double * sab = data.sab().data();
+        std::size_t i = std::upper_bound( betaGrid.begin(), betaGrid.end(), beta ) - betaGrid.begin();
+        if ( i == betaGrid.size() )
+          return evalSABRow( alphaGrid, sab + ( i - 1 ) * nalpha, alpha );
+        nc_assert( i > 0 );
+        const double b0 = betaGrid[i-1];
+        const double b1 = betaGrid[i];
+        const double s0 = evalSABRow( alphaGrid, sab + ( i - 1 ) * nalpha, alpha );
+        if ( beta == b0 )
+          return s0;
+        const double s1 = evalSABRow( alphaGrid, sab + i * nalpha, alpha );
+        return s0 + ( s1 - s0 ) * ( ( beta - b0 ) / ( b1 - b0 ) );
+      }
+
+      double evalDDXS( const SABData& data, double ekin, double eprime, double mu )
+      {
+        if ( !( eprime >= 0.0 ) || !( ekin > 0.0 ) || !( ncabs(mu) <= 1.0 ) )
+          return 0.0;
+        const double kT = data.temperature().kT();
+        const double beta = ( eprime - ekin ) / kT;
+        const double alpha = ncmax( 0.0, ( ekin + eprime - 2.0 * mu * std::sqrt( ekin * eprime ) ) / kT );
+        const double s = evalSAB( data, alpha, beta );
+        if ( !s )
+          return 0.0;
+        return ( data.boundXS().dbl() / ( 2.0 * kT ) ) * std::sqrt( eprime / ekin ) * s;
+      }
+
+      //Sample t in [0,1] from the linear density with values fa and fb at the
+      //end points:
+      double sampleLinearUnit( double fa, double fb, double r )
+      {
+        nc_assert( fa >= 0.0 && fb >= 0.0 );
+        const double fsum = fa + fb;
+        if ( !( fsum > 0.0 ) )
+          return r;
+        //Stable form of the root (sqrt(fa^2+r*(fb^2-fa^2))-fa)/(fb-fa):
+        return ncclamp( r * fsum / ( fa + std::sqrt( fa*fa + r * ( fb*fb - fa*fa ) ) ), 0.0, 1.0 );
+      }
+
+    }
+  }
+}
+
+void NC::SAB::doubleDifferentialCrossSection( const SABData& data,
+                                              const double* ekin, const double* eprime,
+                                              const double* mu, std::size_t n,
+                                              double* out_ddxs )
+{
+  for ( std::size_t i = 0; i < n; ++i )
+    out_ddxs[i] = evalDDXS( data, ekin[i], eprime[i], mu[i] );
+}
+
+NC::SAB::SABFixedEnergyTables::SABFixedEnergyTables( shared_obj<const SABData> data,
+                                                     VectD energies,
+                                                     const SABFixedEnergyTableCfg& cfg )
+  : m_data(std::move(data))
+{
+  if ( cfg.nmu < 1 || cfg.nmu > 1000000 )
+    NCRYSTAL_THROW2(BadInput,"SABFixedEnergyTables: invalid number of mu bins: "<<cfg.nmu);
+  if ( cfg.eprimeSubdivisions < 1 || cfg.eprimeSubdivisions > 10000 )
+    NCRYSTAL_THROW2(BadInput,"SABFixedEnergyTables: invalid number of E' subdivisions: "<<cfg.eprimeSubdivisions);
+  for ( auto e : energies )
+    if ( !( e > 0.0 ) || ncisinf(e) )
+      NCRYSTAL_THROW2(BadInput,"SABFixedEnergyTables: invalid neutron energy: "<<e);
+
+  m_mugrid = linspace( -1.0, 1.0, cfg.nmu + 1 );
+  const std::size_t nmu = m_mugrid.size();
+  const double kT = m_data->temperature().kT();
+  const auto& betaGrid = m_data->betaGrid();
+
+  m_tables.reserve( energies.size() );
+  for ( auto ekin : energies ) {
+    Table t;
+    t.ekin = ekin;
+    //E' nodes from the beta grid, starting at E'=0 (or at the lowest beta
+    //value, if kinematically accessible):
+    const double eprime_min = ncmax( 0.0, ekin + betaGrid.front() * kT );
+    const double eprime_max = ekin + betaGrid.back() * kT;
+    if ( !( eprime_max > eprime_min ) )
+      NCRYSTAL_THROW2(BadInput,"SABFixedEnergyTables: no kinematically accessible beta grid"
+                      " values at neutron energy "<<ekin<<" eV");
+    VectD nodes;
+    nodes.reserve( betaGrid.size() + 1 );
+    nodes.push_back( eprime_min );
+    for ( auto b : betaGrid ) {
+      const double ep = ekin + b * kT;
+      if ( ep > nodes.back() )
+        nodes.push_back( ep );
+    }
+    if ( nodes.back() < eprime_max )
+      nodes.push_back( eprime_max );
+    t.eprime.reserve( ( nodes.size() - 1 ) * cfg.eprimeSubdivisions + 1 );
+    for ( std::size_t i = 0; i + 1 < nodes.size(); ++i ) {
+      for ( unsigned k = 0; k < cfg.eprimeSubdivisions; ++k )
+        t.eprime.push_back( nodes[i] + ( nodes[i+1] - nodes[i] ) * ( double(k) / cfg.eprimeSubdivisions ) );
+    }
+    t.eprime.push_back( nodes.back() );
+
+    //Node values:
+    const std::size_t neprime = t.eprime.size();
+    t.ddxs.resize( neprime * nmu );
+    for ( std::size_t i = 0; i < neprime; ++i )
+      for ( std::size_t j = 0; j < nmu; ++j )
+        t.ddxs[i*nmu+j] = evalDDXS( *m_data, ekin, t.eprime[i], m_mugrid[j] );
+
+    //Cumulative cell integrals (cells are ordered as the nodes at their lower
+    //corners):
+    t.cellcumul.reserve( ( neprime - 1 ) * ( nmu - 1 ) );
+    StableSum sum;
+    for ( std::size_t i = 0; i + 1 < neprime; ++i ) {
+      const double de = t.eprime[i + 1] - t.eprime[i];
+      const double * f0 = &t.ddxs[i*nmu];
+      const double * f1 = f0 + nmu;
+      for ( std::size_t j = 0; j + 1 < nmu; ++j ) {
+        const double dmu = m_mugrid[j+1] - m_mugrid[j];
+        sum.add( 0.25 * de * dmu * ( f0[j] + f0[j+1] + f1[j] + f1[j+1] ) );
+        t.cellcumul.push_back( sum.sum() );
+      }
+    }
+    t.xs = sum.sum();
+    m_tables.push_back( std::move(t) );
+  }
+}
+
+const NC::SAB::SABFixedEnergyTables::Table& NC::SAB::SABFixedEnergyTables::table( std::size_t ie ) const
+{
+  if ( !( ie < m_tables.size() ) )
+    NCRYSTAL_THROW2(BadInput,"SABFixedEnergyTables: energy index "<<ie<<" out of range");
+  return m_tables[ie];
+}
+
+NC::NeutronEnergy NC::SAB::SABFixedEnergyTables::energy( std::size_t ie ) const
+{
+  return NeutronEnergy{ table(ie).ekin };
+}
+
+std::size_t NC::SAB::SABFixedEnergyTables::energyIndex( NeutronEnergy ekin ) const
+{
+  for ( std::size_t i = 0; i < m_tables.size(); ++i )
+    if ( m_tables[i].ekin == ekin.dbl() )
+      return i;
+  NCRYSTAL_THROW2(BadInput,"SABFixedEnergyTables: no table at neutron energy "<<ekin);
+}
+
+NC::CrossSect NC::SAB::SABFixedEnergyTables::crossSection( std::size_t ie ) const
+{
+  return CrossSect{ table(ie).xs };
+}
+
+const NC::VectD& NC::SAB::SABFixedEnergyTables::eprimeGrid( std::size_t ie ) const
+{
+  return table(ie).eprime;
+}
+
+const NC::VectD& NC::SAB::SABFixedEnergyTables::nodeValues( std::size_t ie ) const
+{
+  return table(ie).ddxs;
+}
+
+NC::PairDD NC::SAB::SABFixedEnergyTables::sampleDeltaEMu( std::size_t ie, RNG& rng ) const
+{
+  const Table& t = table(ie);
+  if ( !( t.xs > 0.0 ) ) {
+    //Vanishing cross section, do not scatter:
+    return { 0.0, 1.0 };
+  }
+  const std::size_t nmu = m_mugrid.size();
+  //Pick cell:
+  const double p = rng() * t.xs;
+  std::size_t icell = std::upper_bound( t.cellcumul.begin(), t.cellcumul.end(), p ) - t.cellcumul.begin();
+  if ( icell == t.cellcumul.size() )
+    --icell;
+  const std::size_t i = icell / ( nmu - 1 );
+  const std::size_t j = icell % ( nmu - 1 );
+  const double f00 = t.ddxs[i*nmu+j];
+  const double f01 = t.ddxs[i*nmu+j+1];
+  const double f10 = t.ddxs[(i+1)*nmu+j];
+  const double f11 = t.ddxs[(i+1)*nmu+j+1];
+  //Sample E' from the marginal, and then mu from the conditional distribution:
+  const double u = sampleLinearUnit( f00 + f01, f10 + f11, rng() );
+  const double v = sampleLinearUnit( f00 + ( f10 - f00 ) * u, f01 + ( f11 - f01 ) * u, rng() );
+  const double eprime = t.eprime[i] + ( t.eprime[i+1] - t.eprime[i] ) * u;
+  const double mu = ncclamp( m_mugrid[j] + ( m_mugrid[j+1] - m_mugrid[j] ) * v, -1.0, 1.0 );
+  return { eprime - t.ekin, mu };
+}
+
+void NC::SAB::SABFixedEnergyTables::sampleDeltaEMuMany( std::size_t ie, RNG& rng, std::size_t n,
+                                                        double* out_deltae, double* out_mu ) const
+{
+  for ( std::size_t k = 0; k < n; ++k ) {
+    auto r = sampleDeltaEMu( ie, rng );
+    out_deltae[k] = r.first;
+    out_mu[k] = r.second;
+  }
+}
+
+void NC::SAB::SABFixedEnergyTables::doubleDifferentialCrossSection( std::size_t ie, const double* eprime,
+                                                                    const double* mu, std::size_t n,
+                                                                    double* out_ddxs ) const
+{
+  const Table& t = table(ie);
+  const std::size_t nmu = m_mugrid.size();
+  const double mu0 = m_mugrid.front();
+  const double dmu = ( m_mugrid.back() - mu0 ) / ( nmu - 1 );
+  for ( std::size_t k = 0; k < n; ++k ) {
+    const double ep = eprime[k];
+    const double m = mu[k];
+    if ( !( ep >= t.eprime.front() && ep <= t.eprime.back() && ncabs(m) <= 1.0 ) ) {
+      out_ddxs[k] = 0.0;
+      continue;
+    }
+    std::size_t i = std::upper_bound( t.eprime.begin(), t.eprime.end(), ep ) - t.eprime.begin();
+    i = std::min<std::size_t>( std::max<std::size_t>( i, 1 ), t.eprime.size() - 1 ) - 1;
+    const std::size_t j = std::min<std::size_t>( static_cast<std::size_t>( ( m - mu0 ) / dmu ), nmu - 2 );
+    const double u = ncclamp( ( ep - t.eprime[i] ) / ( t.eprime[i+1] - t.eprime[i] ), 0.0, 1.0 );
+    const double v = ncclamp( ( m - m_mugrid[j] ) / ( m_mugrid[j+1] - m_mugrid[j] ), 0.0, 1.0 );
+    const double * f0 = &t.ddxs[i*nmu+j];
+    const double * f1 = f0 + nmu;
+    out_ddxs[k] = ( 1.0 - u ) * ( ( 1.0 - v ) * f0[0] + v * f0[1] ) + u * ( ( 1.0 - v ) * f1[0] + v * f1[1] );
+  }
+}
+
+std::size_t NC::SAB::SABFixedEnergyTables::memoryFootprint() const
+{
+  std::size_t n = sizeof(*this) + m_mugrid.size() * sizeof(double);
+  for ( auto& t : m_tables )
+    n += sizeof(Table) + ( t.eprime.size() + t.ddxs.size() + t.cellcumul.size() ) * sizeof(double);
+  return n;
+}
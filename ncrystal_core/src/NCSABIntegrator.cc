@@ -20,10 +20,16 @@
 
 #include "NCrystal/internal/NCSABIntegrator.hh"
 #include "NCrystal/internal/NCSABSamplerModels.hh"
+#include "NCrystal/internal/NCSABFactory.hh"
 #include "NCrystal/internal/NCSABUtils.hh"
 #include "NCrystal/internal/NCFactoryUtils.hh"
 #include "NCrystal/internal/NCIter.hh"
 #include "NCrystal/internal/NCString.hh"
+#include "NCrystal/NCSmallVector.hh"
+#include "NCrystal/internal/NCThreadUtils.hh"
+#include "NCrystal/internal/NCSABDiskCache.hh"
+#include "NCrystal/NCFact.hh"
+#include "NCrystal/NCFactImpl.hh"
 #include <iostream>
 
 namespace NC = NCrystal;
@@ -33,19 +39,24 @@ struct NC::SAB::SABIntegrator::Impl : private NoCopyMove {
 
   Impl( shared_obj<const SABData>,
         const VectD* egrid,
-        std::shared_ptr<const SABExtender> );
+        std::shared_ptr<const SABExtender>,
+        SamplerAlg );
   void doit(SABXSProvider *, SABSampler*, Optional<std::string>*);
   double determineEMax( const double ) const;
   double determineEMin( const double ) const;
   void setupEnergyGrid();
+  VectD adaptiveEnergyGrid( double emin, double emax, unsigned npts_max ) const;
+  std::string jsonDescription( const VectD& egrid ) const;
 
   //Input data:
   shared_obj<const SABData> m_data;
   VectD m_egrid;
   std::shared_ptr<const SABExtender> m_extender;
+  SamplerAlg m_alg;
 
   //Data derived from m_data:
   std::shared_ptr<const SABSamplerAtE_Alg1::CommonCache> m_derivedData;
+  std::shared_ptr<const SABSamplerAtE_Alias::CommonCache> m_aliasData;//only for SamplerAlg::Alias
 
   typedef std::unique_ptr<SABSamplerAtE> SamplerAtE_uptr;
   std::pair<SamplerAtE_uptr,double> analyseEnergyPoint(double ekin, bool doSampler ) const;
@@ -61,22 +72,38 @@ NS::SABIntegrator::~SABIntegrator() = default;
 
 NS::SABIntegrator::SABIntegrator( shared_obj<const SABData> data,
                                   const VectD* egrid,
-                                  std::shared_ptr<const SABExtender> sabextender )
-  : m_impl(std::move(data),egrid,std::move(sabextender))
+                                  std::shared_ptr<const SABExtender> sabextender,
+                                  SamplerAlg alg )
+  : m_impl(std::move(data),egrid,std::move(sabextender),alg)
 {
 }
 
 void NS::SABIntegrator::doit(SABXSProvider * out_xs, SABSampler* out_sampler, Optional<std::string>* json)
 {
+  InitProfileScope profileScope( "SABIntegrator::doit" );
   m_impl->doit(out_xs,out_sampler,json);
 }
 
+NS::SABScatterHelper NS::SABIntegrator::createScaledScatterHelper( const SABScatterHelper& reference,
+                                                                    SigmaBound referenceBoundXS )
+{
+  nc_assert_always( reference.sharedSampler() != nullptr );
+  nc_assert_always( referenceBoundXS.dbl() > 0.0 );
+  const double scale = m_impl->m_data->boundXS().dbl() / referenceBoundXS.dbl();
+  const VectD& egrid = reference.xsprovider.internalEGrid();
+  VectD xsvals = vectorTrf( reference.xsprovider.internalXSGrid(), [scale](double xs) { return xs * scale; } );
+  SABXSProvider xp( VectD(egrid.begin(),egrid.end()), std::move(xsvals), m_impl->m_extender );
+  return SABScatterHelper( std::move(xp), reference.sharedSampler(), m_impl->jsonDescription( egrid ) );
+}
+
 NS::SABIntegrator::Impl::Impl( shared_obj<const SABData> data,
                                const VectD* egrid,
-                               std::shared_ptr<const SABExtender> sabextender )
+                               std::shared_ptr<const SABExtender> sabextender,
+                               SamplerAlg alg )
   : m_data(std::move(data)),
     m_egrid((egrid&&!egrid->empty())?*egrid:VectD()),
-    m_extender(!sabextender?std::make_unique<SABFGExtender>(m_data->temperature(),m_data->elementMassAMU(),m_data->boundXS()):std::move(sabextender))
+    m_extender(!sabextender?std::make_unique<SABFGExtender>(m_data->temperature(),m_data->elementMassAMU(),m_data->boundXS()):std::move(sabextender)),
+    m_alg(alg)
 {
 }
 
@@ -100,6 +127,13 @@ namespace NCrystal {
         shared_obj<const SABData> data = *key.second;
         nc_assert( !!data && data->getUniqueID()==key.first );
 
+        //Check for (memory mapped) arrays in the persistent disk cache:
+        auto cached = SABDiskCache::loadDerived( *data );
+        if ( cached.has_value() )
+          return std::make_shared<const DerivedData>(DerivedData{ data,
+                                                                  std::move(cached.value().logsab),
+                                                                  std::move(cached.value().alphaintegrals_cumul) });
+
         const auto& alphaGrid = data->alphaGrid();
         const auto& sab = data->sab();
         const std::size_t nalpha = alphaGrid.size();
@@ -128,12 +162,28 @@ namespace NCrystal {
         }
         nc_assert(global_idx==sab.size());
 
-        //Wrap up and return:
-        return std::make_shared<const DerivedData>(DerivedData{data,std::move(logsab),std::move(alphaintegrals_cumul)});
+        //Wrap up and return (preferring any stored version in the disk cache,
+        //to share the memory with other processes):
+        auto stored = SABDiskCache::storeDerived( *data, logsab, alphaintegrals_cumul );
+        if ( stored.has_value() )
+          return std::make_shared<const DerivedData>(DerivedData{ data,
+                                                                  std::move(stored.value().logsab),
+                                                                  std::move(stored.value().alphaintegrals_cumul) });
+        return std::make_shared<const DerivedData>(DerivedData{ data,
+                                                                ImmutableDblArray(std::move(logsab)),
+                                                                ImmutableDblArray(std::move(alphaintegrals_cumul)) });
       }
     };
     static SABData2DerivedDataFactory s_SABData2DerivedDataFactory;
 
+    std::size_t evictFromDerivedDataCache( FactImpl::CacheEvictionRequest& req )
+    {
+      return s_SABData2DerivedDataFactory.evict( [&req]( const D2DDKey& key, const DerivedData* )
+      {
+        return req.sabDataUIDs.count( key.first ) > 0;
+      } );
+    }
+
   }
 }
 
@@ -202,10 +252,15 @@ void NS::SABIntegrator::Impl::setupEnergyGrid()
       NCRYSTAL_THROW(BadInput,"SABIntegrator invalid energy grid. It must either be a complete array, empty, or consist of three numbers: {emin, emax, npts}");
     double emin, emax;
     unsigned npts;
+    bool adaptive(false);
     if (m_egrid.size()==3) {
       emin = m_egrid.at(0);
       emax = m_egrid.at(1);
       double npts_fp = m_egrid.at(2);
+      if ( npts_fp < 0.0 ) {
+        adaptive = true;
+        npts_fp = -npts_fp;
+      }
       npts = static_cast<unsigned>(npts_fp);
       if ( npts != npts_fp )
         NCRYSTAL_THROW(BadInput,"SABIntegrator invalid energy grid. When the array has 3 elements, the third must be an integral number representing number of points.");
@@ -219,7 +274,7 @@ void NS::SABIntegrator::Impl::setupEnergyGrid()
       NCRYSTAL_THROW(BadInput,"SABIntegrator invalid energy grid. Values for emin/emax must fullfil 0<emin<emax or be 0 indicating automatic determination.");
 
     if ( npts==0 )
-      npts = 300;
+      npts = egridDefaultNPoints;
 
     const double kT = m_data->temperature().kT();
 
@@ -258,7 +313,10 @@ void NS::SABIntegrator::Impl::setupEnergyGrid()
     nc_assert_always(emin>0.0);
     nc_assert_always(emax>emin);
     nc_assert_always(npts>=2);
-    m_egrid = NC::geomspace(emin,emax,npts);
+    if ( adaptive )
+      m_egrid = adaptiveEnergyGrid(emin,emax,npts);
+    else
+      m_egrid = NC::geomspace(emin,emax,npts);
   }
 
   if ( m_egrid.size() < 10 )
@@ -269,66 +327,185 @@ void NS::SABIntegrator::Impl::setupEnergyGrid()
 
 }
 
+NC::VectD NS::SABIntegrator::Impl::adaptiveEnergyGrid( double emin, double emax, unsigned npts_max ) const
+{
+  //Start from a coarse grid, and test each interval at two interior points
+  //(at 1/3 and 2/3 of the interval in log(E)). If linear interpolation (as in
+  //SABXSProvider) deviates from the cross section at either of them by more
+  //than the tolerance, both points are added to the grid. The points of each
+  //round are independent, and are evaluated in parallel:
+  const double tolerance = 1e-3;
+  const double min_relwidth = 1e-6;
+  const unsigned nstart = 30;
+  npts_max = std::max<unsigned>( npts_max, nstart );
+  VectD egrid = NC::geomspace( emin, emax, nstart );
+  VectD xs( egrid.size() );
+  parallelForIndex( egrid.size(), getNumberOfThreads(),
+                    [this,&egrid,&xs]( std::size_t i ) { xs[i] = analyseEnergyPointForXS( egrid[i] ); } );
+  std::vector<char> done( egrid.size() - 1, 0 );//per interval
+  while ( egrid.size() + 2 <= npts_max ) {
+    std::vector<std::size_t> todo;
+    for ( auto i : ncrange( done.size() ) )
+      if ( !done[i] )
+        todo.push_back( i );
+    if ( todo.empty() )
+      break;
+    VectD etest( 2 * todo.size() ), xstest( 2 * todo.size() );
+    for ( auto j : ncrange( todo.size() ) ) {
+      const double ea = egrid[todo[j]];
+      const double r = egrid[todo[j]+1] / ea;
+      etest[2*j] = ea * std::cbrt( r );
+      etest[2*j+1] = ea * std::cbrt( r * r );
+    }
+    parallelForIndex( etest.size(), getNumberOfThreads(),
+                      [this,&etest,&xstest]( std::size_t k ) { xstest[k] = analyseEnergyPointForXS( etest[k] ); } );
+    //Merge the test points of failing intervals into the grid:
+    VectD new_egrid, new_xs;
+    std::vector<char> new_done;
+    new_egrid.reserve( egrid.size() + etest.size() );
+    new_xs.reserve( egrid.size() + etest.size() );
+    new_done.reserve( done.size() + etest.size() );
+    std::size_t j = 0;
+    std::size_t nleft = npts_max - egrid.size();
+    for ( auto i : ncrange( done.size() ) ) {
+      new_egrid.push_back( egrid[i] );
+      new_xs.push_back( xs[i] );
+      if ( done[i] ) {
+        new_done.push_back( 1 );
+        continue;
+      }
+      nc_assert( j < todo.size() && todo[j] == i );
+      const double ea = egrid[i], eb = egrid[i+1];
+      const double * et = &etest[2*j];
+      const double * xt = &xstest[2*j];
+      ++j;
+      bool ok = ( nleft < 2 );
+      if ( !ok ) {
+        ok = true;
+        for ( int k = 0; k < 2; ++k ) {
+          const double interp = xs[i] + ( xs[i+1] - xs[i] ) * ( et[k] - ea ) / ( eb - ea );
+          if ( !( ncabs( interp - xt[k] ) <= tolerance * xt[k] ) )
+            ok = false;
+        }
+      }
+      if ( ok ) {
+        new_done.push_back( 1 );
+        continue;
+      }
+      //Split, and only consider the new intervals further if they are still wide:
+      const char narrow = ( ( eb - ea ) < 3.0 * min_relwidth * ea ) ? 1 : 0;
+      for ( int k = 0; k < 2; ++k ) {
+        new_done.push_back( narrow );
+        new_egrid.push_back( et[k] );
+        new_xs.push_back( xt[k] );
+      }
+      new_done.push_back( narrow );
+      nleft -= 2;
+    }
+    new_egrid.push_back( egrid.back() );
+    new_xs.push_back( xs.back() );
+    egrid.swap( new_egrid );
+    xs.swap( new_xs );
+    done.swap( new_done );
+  }
+  nc_assert( egrid.size() == xs.size() && done.size() + 1 == egrid.size() );
+  return egrid;
+}
+
 void NS::SABIntegrator::Impl::doit(SABXSProvider * out_xs, SABSampler* out_sampler, Optional<std::string>* json)
 {
   nc_assert_always( out_xs || out_sampler );
-  if ( !m_derivedData )
+  if ( !m_derivedData ) {
+    static bool s_evictionRegistered = ( FactImpl::registerCacheEvictionFunction( evictFromDerivedDataCache ), true );
+    (void)s_evictionRegistered;
     m_derivedData = s_SABData2DerivedDataFactory.create(D2DDKey(m_data->getUniqueID(),&m_data));
+  }
 
   const bool doSampler = out_sampler!=nullptr;
+  if ( doSampler && m_alg == SamplerAlg::Alias && !m_aliasData )
+    m_aliasData = std::make_shared<const SABSamplerAtE_Alias::CommonCache>( m_derivedData );
 
   //Prepare and validate energy grid:
   setupEnergyGrid();
 
-  std::vector<std::unique_ptr<SABSamplerAtE>> energyPointSamplers;
-  if ( doSampler )
-    energyPointSamplers.reserve(m_egrid.size());
-  VectD xsvals;
-  xsvals.reserve(m_egrid.size());
-
-  for (const auto& energy : m_egrid ) {
-    nc_assert(energy>0.0);
-    auto sampleruptr_and_xs =  analyseEnergyPoint(energy, doSampler );
-    if ( doSampler )
-      energyPointSamplers.emplace_back(std::move(sampleruptr_and_xs.first));
-    xsvals.emplace_back( sampleruptr_and_xs.second );
-  }
+  //In lazy mode, samplers are only created when first needed:
+  static const bool s_lazy = ncgetenv_bool("SAB_LAZY");
+  const bool eagerSampler = doSampler && !s_lazy;
 
-  if ( doSampler )
+  //Analyse all energy points. These are independent, and can therefore be
+  //processed in parallel (each writing only to its own output slots):
+  std::vector<std::unique_ptr<SABSamplerAtE>> energyPointSamplers;
+  if ( eagerSampler )
+    energyPointSamplers.resize(m_egrid.size());
+  VectD xsvals(m_egrid.size(),0.0);
+
+  parallelForIndex( m_egrid.size(), getNumberOfThreads(),
+                    [this,eagerSampler,&energyPointSamplers,&xsvals]( std::size_t i )
+                    {
+                      const double energy = m_egrid[i];
+                      nc_assert(energy>0.0);
+                      auto sampleruptr_and_xs = analyseEnergyPoint(energy, eagerSampler );
+                      if ( eagerSampler )
+                        energyPointSamplers[i] = std::move(sampleruptr_and_xs.first);
+                      xsvals[i] = sampleruptr_and_xs.second;
+                    } );
+
+  if ( doSampler && !eagerSampler ) {
+    //The factory outlives this SABIntegrator, so give it its own Impl
+    //instance (sharing all the heavy data):
+    auto lazyImpl = std::make_shared<Impl>( m_data, nullptr, m_extender, m_alg );
+    lazyImpl->m_derivedData = m_derivedData;
+    lazyImpl->m_aliasData = m_aliasData;
+    out_sampler->setData( m_data->temperature(),
+                          VectD(m_egrid.begin(),m_egrid.end()),
+                          [lazyImpl](double energy)
+                          {
+                            return lazyImpl->analyseEnergyPoint( energy, true ).first;
+                          },
+                          m_extender, xsvals.back() );
+  } else if ( doSampler ) {
+    //Keep data of all energy points in one contiguous block of memory:
+    packSamplerData( energyPointSamplers );
     out_sampler->setData( m_data->temperature(),
                           VectD(m_egrid.begin(),m_egrid.end()),
                           std::move(energyPointSamplers),
                           m_extender, xsvals.back() );
+  }
   if ( out_xs )
     out_xs->setData( VectD(m_egrid.begin(),m_egrid.end()),
                      std::move(xsvals),
                      m_extender );
 
-  if (json) {
-    std::ostringstream ss;
-    {
-      std::ostringstream tmp;
-      tmp << "nalpha="<<m_data->alphaGrid().size()<<";nbeta="<<m_data->betaGrid().size();
-      tmp << ";Emax="<<NeutronEnergy{m_egrid.back()};
-      tmp << ";T="<<m_data->temperature();
-      tmp << ";M="<<m_data->elementMassAMU();
-      tmp << ";sigma_free="<<m_data->boundXS().free(m_data->elementMassAMU());
-      streamJSONDictEntry( ss, "summarystr", tmp.str(), JSONDictPos::FIRST );
-    }
-    streamJSONDictEntry( ss, "Emax", m_egrid.back()  );
-    streamJSONDictEntry( ss, "Emin", m_egrid.front()  );
-    streamJSONDictEntry( ss, "negrid", m_egrid.size()  );
-    streamJSONDictEntry( ss, "T", m_data->temperature().dbl()  );
-    streamJSONDictEntry( ss, "M", m_data->elementMassAMU().dbl()  );
-    streamJSONDictEntry( ss, "sigma_bound", m_data->boundXS().dbl()  );
-    streamJSONDictEntry( ss, "sigma_free", m_data->boundXS().free(m_data->elementMassAMU()).dbl()  );
-    streamJSONDictEntry( ss, "nbeta", m_data->betaGrid().size()  );
-    streamJSONDictEntry( ss, "nalpha", m_data->alphaGrid().size(), JSONDictPos::LAST  );
-    *json = ss.str();
-  }
+  if (json)
+    *json = jsonDescription( m_egrid );
 
 }
 
+std::string NS::SABIntegrator::Impl::jsonDescription( const VectD& egrid ) const
+{
+  nc_assert_always(!egrid.empty());
+  std::ostringstream ss;
+  {
+    std::ostringstream tmp;
+    tmp << "nalpha="<<m_data->alphaGrid().size()<<";nbeta="<<m_data->betaGrid().size();
+    tmp << ";Emax="<<NeutronEnergy{egrid.back()};
+    tmp << ";T="<<m_data->temperature();
+    tmp << ";M="<<m_data->elementMassAMU();
+    tmp << ";sigma_free="<<m_data->boundXS().free(m_data->elementMassAMU());
+    streamJSONDictEntry( ss, "summarystr", tmp.str(), JSONDictPos::FIRST );
+  }
+  streamJSONDictEntry( ss, "Emax", egrid.back()  );
+  streamJSONDictEntry( ss, "Emin", egrid.front()  );
+  streamJSONDictEntry( ss, "negrid", egrid.size()  );
+  streamJSONDictEntry( ss, "T", m_data->temperature().dbl()  );
+  streamJSONDictEntry( ss, "M", m_data->elementMassAMU().dbl()  );
+  streamJSONDictEntry( ss, "sigma_bound", m_data->boundXS().dbl()  );
+  streamJSONDictEntry( ss, "sigma_free", m_data->boundXS().free(m_data->elementMassAMU()).dbl()  );
+  streamJSONDictEntry( ss, "nbeta", m_data->betaGrid().size()  );
+  streamJSONDictEntry( ss, "nalpha", m_data->alphaGrid().size(), JSONDictPos::LAST  );
+  return ss.str();
+}
+
 std::pair<NS::SABIntegrator::Impl::SamplerAtE_uptr,double> NS::SABIntegrator::Impl::analyseEnergyPoint(double ekin, bool doSampler ) const
 {
   nc_assert_always(ekin>0.0);
@@ -348,8 +525,8 @@ std::pair<NS::SABIntegrator::Impl::SamplerAtE_uptr,double> NS::SABIntegrator::Im
   const auto& betaGrid = m_data->betaGrid();
   auto alphaGrid_span = Span<const double>(m_data->alphaGrid());
   nc_assert(!!m_derivedData);
-  const VectD& logsab = m_derivedData->logsab;
-  const VectD& alphaintegrals_cumul = m_derivedData->alphaintegrals_cumul;
+  const auto& logsab = m_derivedData->logsab;
+  const auto& alphaintegrals_cumul = m_derivedData->alphaintegrals_cumul;
 
   nc_assert(ekin>=0.);
   const double kT = m_data->temperature().kT();
@@ -412,12 +589,19 @@ std::pair<NS::SABIntegrator::Impl::SamplerAtE_uptr,double> NS::SABIntegrator::Im
 
   StableSum xs_total_stable;
 
+  //Kinematic limits at all relevant beta grid points in one go:
+  SmallVector<double,256> alimits_low, alimits_upp;
+  alimits_low.resize( relevant_betaGrid.size() );
+  alimits_upp.resize( relevant_betaGrid.size() );
+  getAlphaLimitsMany( ekin_div_kT, relevant_betaGrid.data(), relevant_betaGrid.size(),
+                      alimits_low.data(), alimits_upp.data() );
+
   for ( auto&& beta : enumerate(relevant_betaGrid) ) {
     nc_assert( beta.val >= beta_lower_limit );
     nc_assert( beta.val >= -ekin_div_kT );
     nc_assert( beta.idx < alpharanges.size() );
-    double alow,aupp;
-    std::tie(alow,aupp) = getAlphaLimits(ekin_div_kT, beta.val);
+    const double alow = alimits_low[beta.idx];
+    const double aupp = alimits_upp[beta.idx];
 
     nc_assert( aupp >= alow );//since beta>=-E/kT this must be the case
 
@@ -458,8 +642,8 @@ std::pair<NS::SABIntegrator::Impl::SamplerAtE_uptr,double> NS::SABIntegrator::Im
         } else {
           info.prob_front = tb.xs_front/xs_at_this_beta;
           info.prob_notback = 1.0 - tb.xs_back/xs_at_this_beta;
-          info.pt_front.alpha_idx = tb.imiddle_low;
-          info.pt_back.alpha_idx = tb.imiddle_upp;
+          info.alpha_idx_front = static_cast<uint32_t>(tb.imiddle_low);
+          info.alpha_idx_back = static_cast<uint32_t>(tb.imiddle_upp);
         }
       } else {
         nc_assert(xs_at_this_beta == 0.0);
@@ -498,6 +682,15 @@ std::pair<NS::SABIntegrator::Impl::SamplerAtE_uptr,double> NS::SABIntegrator::Im
     return { std::make_unique<SABSamplerAtE_NoScatter>(), xs_total };
 
   nc_assert(!!m_derivedData);
+  if ( m_alg == SamplerAlg::Alias ) {
+    nc_assert(!!m_aliasData);
+    return { std::make_unique<SABSamplerAtE_Alias>( m_aliasData,
+                                                    std::move(betasampler_vals),
+                                                    std::move(betasampler_weights),
+                                                    std::move(sampler_infos),
+                                                    ibeta_low ),
+             xs_total };
+  }
   SamplerAtE_uptr up = std::make_unique<SABSamplerAtE_Alg1>( m_derivedData,
                                                              std::move(betasampler_vals),
                                                              std::move(betasampler_weights),
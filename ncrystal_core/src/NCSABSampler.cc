@@ -21,9 +21,33 @@
 #include "NCrystal/internal/NCSABSampler.hh"
 #include "NCrystal/internal/NCSABUtils.hh"
 #include "NCrystal/internal/NCMath.hh"
+#include "NCrystal/internal/NCRuntimeCounters.hh"
+#include "NCrystal/internal/NCThreadUtils.hh"
+#include <atomic>
+#include <set>
 namespace NC = NCrystal;
 
+struct NC::SABSampler::LazySamplers : private NoCopyMove {
+  SamplerFactory factory;
+  std::unique_ptr<std::atomic<const SABSamplerAtE*>[]> samplers;
+  std::size_t n;
+  LazySamplers( SamplerFactory f, std::size_t nn )
+    : factory(std::move(f)), samplers(new std::atomic<const SABSamplerAtE*>[nn]), n(nn)
+  {
+    for ( std::size_t i = 0; i < n; ++i )
+      samplers[i].store( nullptr, std::memory_order_relaxed );
+  }
+  ~LazySamplers()
+  {
+    for ( std::size_t i = 0; i < n; ++i )
+      delete samplers[i].load( std::memory_order_relaxed );
+  }
+};
+
+NC::SABSampler::SABSampler() = default;
 NC::SABSampler::~SABSampler() = default;
+NC::SABSampler::SABSampler( SABSampler&& ) = default;
+NC::SABSampler& NC::SABSampler::operator=( SABSampler&& ) = default;
 
 NC::SABSampler::SABSampler( Temperature temperature,
                             VectD&& egrid,
@@ -41,8 +65,32 @@ void NC::SABSampler::setData( Temperature temperature,
                               std::shared_ptr<const SAB::SABExtender> extender,
                               double xsAtEmax )
 {
-  m_egrid = std::move(egrid);
   m_samplers = std::move(samplers);
+  m_lazySamplers.reset();
+  setDataCommon( temperature, std::move(egrid), std::move(extender), xsAtEmax );
+  nc_assert_always( m_egrid.size()>1 && m_egrid.size()==m_samplers.size() );
+}
+
+void NC::SABSampler::setData( Temperature temperature,
+                              VectD&& egrid,
+                              SamplerFactory factory,
+                              std::shared_ptr<const SAB::SABExtender> extender,
+                              double xsAtEmax )
+{
+  nc_assert_always( !!factory );
+  m_samplers.clear();
+  m_lazySamplers = std::make_unique<LazySamplers>( std::move(factory), egrid.size() );
+  setDataCommon( temperature, std::move(egrid), std::move(extender), xsAtEmax );
+  nc_assert_always( m_egrid.size()>1 );
+}
+
+void NC::SABSampler::setDataCommon( Temperature temperature,
+                                    VectD&& egrid,
+                                    std::shared_ptr<const SAB::SABExtender> extender,
+                                    double xsAtEmax )
+{
+  m_egrid = std::move(egrid);
+  m_egridIndex = GridIndex( m_egrid );
   m_kT = temperature.kT();
   m_extender = std::move(extender);
   m_xsAtEmax = xsAtEmax;
@@ -51,6 +99,29 @@ void NC::SABSampler::setData( Temperature temperature,
 
 }
 
+const NC::SABSamplerAtE& NC::SABSampler::getSampler( std::size_t iegrid ) const
+{
+  if ( !m_lazySamplers ) {
+    nc_assert( iegrid < m_samplers.size() );
+    return *m_samplers[iegrid];
+  }
+  auto& lazy = *m_lazySamplers;
+  nc_assert( iegrid < lazy.n );
+  auto& slot = lazy.samplers[iegrid];
+  const SABSamplerAtE* p = slot.load( std::memory_order_acquire );
+  if ( p )
+    return *p;
+  //First usage, create and publish. If another thread got there first, we
+  //discard our instance and use theirs:
+  std::unique_ptr<SABSamplerAtE> created = lazy.factory( m_egrid[iegrid] );
+  nc_assert_always( !!created );
+  const SABSamplerAtE* expected = nullptr;
+  if ( slot.compare_exchange_strong( expected, created.get(), std::memory_order_acq_rel, std::memory_order_acquire ) )
+    return *created.release();
+  nc_assert( expected != nullptr );
+  return *expected;
+}
+
 NC::PairDD NC::SABSampler::sampleHighE(NeutronEnergy ekin, RNG& rng) const
 {
   const double emax = m_egrid.back();
@@ -133,31 +204,40 @@ NC::PairDD NC::SABSampler::sampleHighE(NeutronEnergy ekin, RNG& rng) const
   }
 
   const double emax_div_kt = emax/m_kT;
-  while (true) {
-    //sample with extender:
-    auto alphabeta = m_extender->sampleAlphaBeta(rng,ekin);
-    //if outside emax curve, always return immediately:
+  auto insideEmaxCurve = [emax_div_kt]( const PairDD& alphabeta )
+  {
     if ( alphabeta.second <= -emax_div_kt )
-      return alphabeta;
+      return false;
     auto alims =  getAlphaLimits( emax_div_kt,alphabeta.second );
-    if (!valueInInterval(alims.first,alims.second,alphabeta.first))
-      return alphabeta;
-    //inside emax curve. Check P_discardinside:
-    if ( P_discardinside && rng.generate()<P_discardinside )
-      continue;//discard to avoid bias
-    //Sample with the table using ekin=emax!
-    return {-1.0,0.0};
-  }
+    return valueInInterval(alims.first,alims.second,alphabeta.first);
+  };
+
+  //Sample with extender (which can reuse its setup at this energy while
+  //sampled values are discarded):
+  auto alphabeta = m_extender->sampleAlphaBetaUntilKept( rng, ekin,
+    [P_discardinside,&insideEmaxCurve]( RNG& r, const PairDD& ab )
+    {
+      NCRYSTAL_RTCOUNT(RejectionIterations);
+      //inside emax curve. Check P_discardinside (discard to avoid bias):
+      return P_discardinside && insideEmaxCurve(ab) && r.generate()<P_discardinside;
+    } );
+
+  //if outside emax curve, always return immediately:
+  if ( !insideEmaxCurve(alphabeta) )
+    return alphabeta;
+
+  //Sample with the table using ekin=emax!
+  return {-1.0,0.0};
 }
 
 NC::PairDD NC::SABSampler::sampleAlphaBeta(NeutronEnergy ekin, RNG& rng) const
 {
-  nc_assert( m_egrid.size()>1 && m_egrid.size()==m_samplers.size() );
+  nc_assert( m_egrid.size()>1 && ( m_lazySamplers || m_egrid.size()==m_samplers.size() ) );
   double alpha,beta;
 
-  decltype(m_samplers.begin()) itSampler;
+  std::size_t isampler;
 
-  auto itEkinUpper = std::upper_bound ( m_egrid.begin(), m_egrid.end(), ekin.dbl() );
+  auto itEkinUpper = m_egrid.begin() + m_egridIndex.upperBoundIdx( m_egrid, ekin.dbl() );
   bool ultra_small_ekin_mode = false;
   const double ultra_small_ekin = m_egrid.front();
 
@@ -169,51 +249,112 @@ NC::PairDD NC::SABSampler::sampleAlphaBeta(NeutronEnergy ekin, RNG& rng) const
       return alphabeta;
     //HighE code decided that we must sample the kernel with ekin=emax:
     ekin = NeutronEnergy{m_egrid.back()};
-    itSampler = std::prev(m_samplers.end());
+    isampler = m_egrid.size() - 1;
 
   } else if ( itEkinUpper == m_egrid.begin() ) {
 
     //Low-E extrapolation. Beta-distribution is essentially unchanged at this
     //energy, but must treat alpha-sampling specially.
-    itSampler = m_samplers.begin();
+    isampler = 0;
     ultra_small_ekin_mode = (ekin.get()<ultra_small_ekin);
 
   } else {
 
     //Inside range of energy grid.
-    itSampler = m_samplers.begin()+std::distance(m_egrid.begin(), itEkinUpper);
+    isampler = static_cast<std::size_t>( std::distance(m_egrid.begin(), itEkinUpper) );
 
   }
 
-  //Sample with *itSampler, using the rejection method to make the results
-  //correct at the given ekin value:
+  //Sample with the chosen sampler, using the rejection method to make the
+  //results correct at the given ekin value:
+  const SABSamplerAtE& sampler = getSampler( isampler );
   const double ekin_div_kT = ekin.get()/m_kT;
-  const double sampling_ekin_div_kT = (ultra_small_ekin_mode ? ultra_small_ekin/m_kT : ekin_div_kT);
+
+  //NB: The samplers are always the ones at the lowest grid point at or above
+  //ekin, since this is the only choice giving unbiased results (samplers at
+  //lower grid points can not reach the entire kinematically accessible
+  //region). Since the SABSamplerAtE instances already restrict themselves to
+  //the kinematic region at the requested ekin_div_kT, results can be returned
+  //directly without any further checks:
+  if ( !ultra_small_ekin_mode ) {
+    std::tie(alpha,beta) = sampler.sampleAlphaBeta(ekin_div_kT, rng);
+#ifndef NDEBUG
+    auto alims = getAlphaLimits( ekin_div_kT, beta );
+    nc_assert( beta >= -ekin_div_kT );
+    nc_assert( valueInInterval(alims.first,alims.second,alpha) );
+#endif
+    return { alpha, beta };
+  }
+
+  //Ultra-small ekin mode, sample at ultra_small_ekin and check kinematics at ekin:
+  const double sampling_ekin_div_kT = ultra_small_ekin/m_kT;
   int loopmax(100);
   while (loopmax--) {
-    std::tie(alpha,beta) = (*itSampler)->sampleAlphaBeta(sampling_ekin_div_kT, rng);
+    NCRYSTAL_RTCOUNT(RejectionIterations);
+    std::tie(alpha,beta) = sampler.sampleAlphaBeta(sampling_ekin_div_kT, rng);
     if (beta<-ekin_div_kT)
       continue;
     double alow,aupp;
     std::tie(alow,aupp) = getAlphaLimits( ekin_div_kT, beta );
     if (valueInInterval(alow,aupp,alpha))
       return { alpha, beta };
-    if (ultra_small_ekin_mode) {
-      //energy is very low, so |alpha+ - alpha-| is also very low, and
-      //S(alpha+,beta)~=S(alpha-,beta) (or at least we could approximate S with
-      //a straight line over the interval. To avoid wasting time on potentially
-      //abysmal acceptance rates, we simply generate an isotropic alpha.
-      //
-      //TODO: the auto-emin-determination code finds the point where S has
-      //linear behaviour, not necessarily flat, so it would be consistent to
-      //sample with linear interpolation of S from (alpha-,beta) to
-      //(alpha+,beta).
-      return { alow + rng.generate()*(aupp-alow), beta };
-    }
+    //energy is very low, so |alpha+ - alpha-| is also very low, and
+    //S(alpha+,beta)~=S(alpha-,beta) (or at least we could approximate S with
+    //a straight line over the interval. To avoid wasting time on potentially
+    //abysmal acceptance rates, we simply generate an isotropic alpha.
+    //
+    //TODO: the auto-emin-determination code finds the point where S has
+    //linear behaviour, not necessarily flat, so it would be consistent to
+    //sample with linear interpolation of S from (alpha-,beta) to
+    //(alpha+,beta).
+    return { alow + rng.generate()*(aupp-alow), beta };
   }
   NCRYSTAL_THROW2(CalcError,"Infinite looping in sampleAlphaBeta(ekin="<<ekin<<")");
 }
 
+std::size_t NC::SABSampler::memoryFootprint() const
+{
+  std::size_t res = sizeof(SABSampler) + m_egrid.capacity() * sizeof(double) + m_egridIndex.memoryFootprint();
+  std::set<const void*> seenShared;
+  auto addSampler = [&res,&seenShared]( const SABSamplerAtE* s )
+  {
+    if ( !s )
+      return;
+    res += s->memoryFootprint();
+    auto shared = s->sharedDataFootprint();
+    if ( shared.first && seenShared.insert( shared.first ).second )
+      res += shared.second;
+  };
+  if ( m_lazySamplers ) {
+    auto& lazy = *m_lazySamplers;
+    res += sizeof(LazySamplers) + lazy.n * sizeof(lazy.samplers[0]);
+    for ( std::size_t i = 0; i < lazy.n; ++i )
+      addSampler( lazy.samplers[i].load( std::memory_order_acquire ) );
+  } else {
+    res += m_samplers.capacity() * sizeof(m_samplers[0]);
+    for ( auto& s : m_samplers )
+      addSampler( s.get() );
+  }
+  return res;
+}
+
+void NC::SABSampler::createSamplers( double emin, double emax, unsigned nthreads ) const
+{
+  if ( !m_lazySamplers || !( emin <= emax ) )
+    return;
+  //Same choice of samplers as in sampleAlphaBeta, i.e. the lowest grid point at
+  //or above ekin (or the last grid point above the grid):
+  auto samplerIdx = [this]( double ekin )
+  {
+    auto it = std::lower_bound( m_egrid.begin(), m_egrid.end(), ekin );
+    return std::min<std::size_t>( std::distance( m_egrid.begin(), it ), m_egrid.size() - 1 );
+  };
+  const std::size_t i0 = samplerIdx( emin );
+  const std::size_t i1 = samplerIdx( emax );
+  parallelForIndex( i1 + 1 - i0, nthreads,
+                    [this,i0]( std::size_t i ) { getSampler( i0 + i ); } );
+}
+
 NC::PairDD NC::SABSampler::sampleDeltaEMu(NeutronEnergy ekin, RNG& rng) const
 {
   auto alphabeta = sampleAlphaBeta(ekin,rng);
@@ -221,3 +362,40 @@ NC::PairDD NC::SABSampler::sampleDeltaEMu(NeutronEnergy ekin, RNG& rng) const
     return std::make_pair( alphabeta.second*m_kT, rng.generate()*2.0 - 1.0 );
   return convertAlphaBetaToDeltaEMu(alphabeta,ekin,m_kT);
 }
+
+void NC::SABSampler::sampleDeltaEMuMany( const double* ekin, std::size_t n, RNG& rng,
+                                         double* out_deltae, double* out_mu ) const
+{
+  //Neutrons in the isotropic limit are handled immediately, while the others
+  //are collected in chunks for the conversion:
+  constexpr std::size_t chunksize = 64;
+  double alpha[chunksize], beta[chunksize], ek[chunksize], de[chunksize], mu[chunksize];
+  std::size_t idx[chunksize];
+  std::size_t nchunk = 0;
+  auto flush = [&]()
+  {
+    convertAlphaBetaToDeltaEMuMany( alpha, beta, ek, nchunk, m_kT, de, mu );
+    for ( std::size_t j = 0; j < nchunk; ++j ) {
+      out_deltae[idx[j]] = de[j];
+      out_mu[idx[j]] = mu[j];
+    }
+    nchunk = 0;
+  };
+  for ( std::size_t i = 0; i < n; ++i ) {
+    const NeutronEnergy e{ekin[i]};
+    auto alphabeta = sampleAlphaBeta(e,rng);
+    if ( NC::muIsotropicAtBeta(alphabeta.second,e.get()/m_kT) ) {
+      out_deltae[i] = alphabeta.second*m_kT;
+      out_mu[i] = rng.generate()*2.0 - 1.0;
+      continue;
+    }
+    alpha[nchunk] = alphabeta.first;
+    beta[nchunk] = alphabeta.second;
+    ek[nchunk] = ekin[i];
+    idx[nchunk] = i;
+    if ( ++nchunk == chunksize )
+      flush();
+  }
+  if ( nchunk )
+    flush();
+}
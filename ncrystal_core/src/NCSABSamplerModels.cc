@@ -17,190 +17,527 @@
 //  limitations under the License.                                            //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
-
 #include "NCrystal/internal/NCSABSamplerModels.hh"
 #include "NCrystal/internal/NCSABUtils.hh"
 #include "NCrystal/internal/NCString.hh"
+#include "NCrystal/internal/NCPointwiseDist.hh"
+#include "NCrystal/internal/NCRuntimeCounters.hh"
 namespace NC = NCrystal;
 
+namespace NCrystal {
+  namespace SAB {
+    namespace {
+
+      //The rejection loop of Algorithm 1 of the sampling paper, shared by the
+      //sampler implementations. The nbetaVals betaVals are the points of
+      //P(beta|Ei) with betaVals[0] at the lower beta limit (where
+      //P(beta|Ei)=0), and
+      //sampleBeta(rng) must return a beta value along with the index of the
+      //bin in betaVals it belongs to. Finally,
+      //sampleAlpha(ibeta,rand_percentile) must sample alpha from
+      //F(alpha|beta_j,Ei) at the beta grid index ibeta.
+      template<class TBetaSampler, class TAlphaSampler>
+      PairDD sampleAlphaBetaImpl( const SABData& data,
+                                  const double * betaVals,
+                                  std::size_t nbetaVals,
+                                  std::size_t ibetaOffset,
+                                  double ekin_div_kT, RNG& rng,
+                                  TBetaSampler&& sampleBeta,
+                                  TAlphaSampler&& sampleAlpha )
+      {
+        const auto& betaGrid = data.betaGrid();
+        const auto& alphaGrid = data.alphaGrid();
+        nc_assert(ibetaOffset<betaGrid.size());
+        (void)nbetaVals;//only used in assertions
+
+        //Allow only loopmax sample attempts, to make sure we detect if code gets too
+        //inefficient. However, make sure users can override this if needed.
+        static const unsigned s_loopmax = []() -> unsigned
+                                          {
+                                            auto envstr = getenv("NCRYSTAL_SABSAMPLE_LOOPMAX");
+                                            return envstr ? str2int(envstr) : 100;
+                                          }();
+        unsigned iloopmax(s_loopmax+1);
+        while (--iloopmax) {
+          NCRYSTAL_RTCOUNT(RejectionIterations);
+          double beta;
+          unsigned ibetaSampled;
+          std::tie(beta,ibetaSampled) = sampleBeta( rng );
+
+          nc_assert( !ncisnan(beta) );
+          nc_assert( beta <= betaGrid.back() );
+          nc_assert( ibetaSampled < nbetaVals );
+
+          if (beta <= ncmax(-ekin_div_kT,betaGrid.front()))
+            continue;//reject
+          double alphal(-1.0), bl;
+          std::size_t ibeta;
+
+          double rand_percentile = rng.generate();
+
+          if ( beta <= betaVals[1] ) {
+            //Special case, beta is before the first actual betaGrid point used to
+            //construct this sampler instance. Simply pick uniformly in allowed
+            //region (nb: we could of course instead query the actual S-values
+            //and interpolate among them).
+            bl = betaVals[0];
+            auto alimits_bl = getAlphaLimits( ekin_div_kT, bl );
+            double alphal_low = ncclamp(alimits_bl.first,alphaGrid.front(),alphaGrid.back());
+            double alphal_up = ncclamp(alimits_bl.second,alphaGrid.front(),alphaGrid.back());
+            alphal = alphal_low + rng.generate()*(alphal_up-alphal_low);
+            ibeta = ibetaOffset;
+            //Double-check that chosen ibeta value gives correct bh=betaGrid.at(ibeta)
+            //value, i.e. betaVals[1]:
+            nc_assert(nbetaVals>=2);
+            nc_assert(floateq(betaVals[1],betaGrid.at(ibeta)));
+          } else {
+            ibeta = ibetaOffset + ibetaSampled;
+            nc_assert( ibeta>0 );
+            bl = betaGrid.at(ibeta-1);
+            alphal = sampleAlpha(ibeta-1, rand_percentile);
+          }
+
+          nc_assert( valueInInterval(betaGrid.at(ibeta-1),betaGrid.at(ibeta),beta) );
+          nc_assert( alphal>=0.0 );
+          nc_assert( ibeta < betaGrid.size() );
+
+          //Sample alphas (with same "random percentile" at two neighbouring beta grid
+          //points and combine with linear interpolation, as in line 9 in Algorithm 1
+          //of the paper:
+          double bh = betaGrid.at(ibeta);
+          double alphah = sampleAlpha(ibeta, rand_percentile);
+
+          nc_assert(bh-bl>0.0);
+          nc_assert(alphal>=0.0);
+          nc_assert(alphah>=0.0);
+          double alpha = alphal + (alphah-alphal) * (beta-bl)/(bh-bl);
+
+          //Check if we can accept this:
+          auto alimits = getAlphaLimits( ekin_div_kT, beta );
+          if ( valueInInterval( alimits.first, alimits.second, alpha ) )
+            return { alpha, beta };
+        }
+        NCRYSTAL_THROW2(CalcError,"Rejection method failed to sample kinematically valid (alpha,beta) point after "
+                        <<s_loopmax<<" attempts. Perhaps energy grid is too sparse?"
+                        " As a workaround it is possible to increase the allowed number of sampling attempts"
+                        " by setting the NCRYSTAL_SABSAMPLE_LOOPMAX variable to a higher number"
+                        " (but please consider reporting the issue to the NCrystal developers nonetheless).");
+      }
+
+      //Sample alpha from F(alpha|beta_j,Ei) (line 7-8 of Alg. 1 in the sampling
+      //paper). NB: this needs to work with a single random number, the
+      //percentile, for purposes of interpolating between two beta-rows. The
+      //findUpperBound(itCumul_low,itCumul_end,selectedArea) function must
+      //return the same as std::upper_bound over the given range of
+      //cumulative alpha integrals:
+      template<class TFindUpperBound>
+      double sampleAlphaImpl( const SABSamplerAtE_Alg1::CommonCache& common,
+                              const SABSamplerAtE_Alg1::AlphaSampleInfo& info,
+                              std::size_t ibeta, double rand_percentile,
+                              TFindUpperBound&& findUpperBound )
+      {
+        const auto& cd = common.data;
+        auto nalpha = cd->alphaGrid().size();
+        auto cumul = SABUtils::sliceSABAtBetaIdx_const(common.alphaintegrals_cumul,nalpha,ibeta);
+        auto sab = SABUtils::sliceSABAtBetaIdx_const(cd->sab(),nalpha,ibeta);
+        auto logsab = SABUtils::sliceSABAtBetaIdx_const(common.logsab,nalpha,ibeta);
+        auto clampRandNum = [](double r) { return ncclamp( r, std::numeric_limits<double>::min(), 1.0 ); };//ensure r is in (0,1]
+        auto clampUnitInterval = [](double r) { return ncclamp( r, 0.0, 1.0 ); };//ensure r is in [0,1]
+
+        if ( rand_percentile <= info.prob_front) {
+          if ( info.prob_front == 2.0) {
+            //special value indicating 0 cross-section at value, sample linearly in
+            //[pt_front.alpha,pt_back.alpha] for lack of better options..
+            double da = info.pt_back.alpha-info.pt_front.alpha;
+            nc_assert(da>=0.0);
+            return info.pt_front.alpha + rand_percentile*da;
+          } else if ( info.prob_front == 1.0) {
+            //Valid alpha range is narrow and contained within a single bin.
+            return SABUtils::sampleLogLinDist_fast( info.pt_front.alpha, info.pt_front.sval,
+                                                    info.pt_back.alpha, info.pt_back.sval,
+                                                    rand_percentile,
+                                                    info.pt_front.logsval, info.pt_back.logsval );
+          } else {
+            //Sample front tail
+            double percentile2 = clampRandNum( rand_percentile / info.prob_front );
+            return SABUtils::sampleLogLinDist_fast( info.pt_front.alpha, info.pt_front.sval,
+                                                    vectAt(cd->alphaGrid(),info.alpha_idx_front), sab[info.alpha_idx_front],
+                                                    percentile2,
+                                                    info.pt_front.logsval, logsab[info.alpha_idx_front] );
+          }
+        } else if ( rand_percentile <= info.prob_notback ) {
+          //Middle section - sample over entire alpha bins.
+          nc_assert( info.prob_notback - info.prob_front > 0.0 );
+          double percentile2 = clampUnitInterval( ( rand_percentile - info.prob_front ) / ( info.prob_notback - info.prob_front ) );
+          unsigned alphaidx_low(info.alpha_idx_front), alphaidx_upp(info.alpha_idx_back);
+          auto itCumul_low = std::next(cumul.begin(),alphaidx_low);
+          auto itCumul_upp = std::next(cumul.begin(),alphaidx_upp);
+          nc_assert( itCumul_upp > itCumul_low && itCumul_upp<cumul.end() );
+          double selectedArea = *itCumul_low + percentile2 * ( *itCumul_upp - *itCumul_low );
+          auto itCumul_selected_edgeupp = findUpperBound(itCumul_low, std::next(itCumul_upp), selectedArea);
+          if ( itCumul_selected_edgeupp > itCumul_upp )
+            return vectAt( cd->alphaGrid(), alphaidx_upp );
+          if ( itCumul_selected_edgeupp <= itCumul_low )
+            return vectAt( cd->alphaGrid(), alphaidx_low );
+
+          nc_assert(itCumul_selected_edgeupp>itCumul_low);
+          auto itCumul_selected_edgelow = std::prev(itCumul_selected_edgeupp);
+          nc_assert( *itCumul_selected_edgelow <= selectedArea );
+          nc_assert( *itCumul_selected_edgeupp >= selectedArea );
+          double binArea = *itCumul_selected_edgeupp - *itCumul_selected_edgelow;
+          nc_assert( binArea > 0.0);
+          //rescale leftover parts of rand_percentile back to the unit interval:
+          double rand_rescaled = clampRandNum((selectedArea-*itCumul_selected_edgelow)/binArea);
+          nc_assert( rand_rescaled >= 0.0 );
+          nc_assert( rand_rescaled <= 1.0 );
+          auto a0 = itCumul_selected_edgelow - cumul.begin();
+          auto a1 = a0 + 1;
+          //Interpolate in selected bin for alpha value:
+          return SABUtils::sampleLogLinDist_fast( vectAt(cd->alphaGrid(),a0), sab[a0],
+                                                  vectAt(cd->alphaGrid(),a1), sab[a1],
+                                                  rand_rescaled,
+                                                  logsab[a0], logsab[a1] );
+        } else {
+          //Sample back tail
+          nc_assert( 1.0 - info.prob_notback > 0.0 );
+          double percentile2 = clampRandNum ( ( rand_percentile - info.prob_notback ) / ( 1.0 - info.prob_notback ) );
+          return SABUtils::sampleLogLinDist_fast( vectAt(cd->alphaGrid(),info.alpha_idx_back), sab[info.alpha_idx_back],
+                                                  info.pt_back.alpha, info.pt_back.sval,
+                                                  percentile2,
+                                                  logsab[info.alpha_idx_back], info.pt_back.logsval );
+
+        }
+      }
+    }
+  }
+}
+
+NC::SAB::SABSamplerAtE_ArenaBased::SABSamplerAtE_ArenaBased( std::shared_ptr<const SABSamplerDataArena> arena )
+  : m_arena( std::move(arena) )
+{
+  nc_assert_always( !!m_arena );
+  m_sizes = m_arena->sizes();
+}
+
+void NC::SAB::packSamplerData( std::vector<std::unique_ptr<SABSamplerAtE>>& samplers )
+{
+  std::vector<SABSamplerAtE_ArenaBased*> arenaSamplers;
+  arenaSamplers.reserve( samplers.size() );
+  SABSamplerDataArena::Offsets total;
+  for ( auto& e : samplers ) {
+    auto p = dynamic_cast<SABSamplerAtE_ArenaBased*>( e.get() );
+    if ( !p )
+      continue;
+    arenaSamplers.push_back( p );
+    total.dbls += p->m_sizes.dbls;
+    total.infos += p->m_sizes.infos;
+    total.idxs += p->m_sizes.idxs;
+  }
+  if ( arenaSamplers.empty() )
+    return;
+
+  auto arena = std::make_shared<SABSamplerDataArena>();
+  arena->dbls.reserve( total.dbls );
+  arena->infos.reserve( total.infos );
+  arena->idxs.reserve( total.idxs );
+  std::vector<SABSamplerDataArena::Offsets> newOffsets;
+  newOffsets.reserve( arenaSamplers.size() );
+  for ( auto p : arenaSamplers ) {
+    newOffsets.push_back( arena->sizes() );
+    const auto& src = *p->m_arena;
+    const auto& o = p->m_offsets;
+    const auto& n = p->m_sizes;
+    arena->dbls.insert( arena->dbls.end(),
+                        std::next( src.dbls.begin(), o.dbls ),
+                        std::next( src.dbls.begin(), o.dbls + n.dbls ) );
+    arena->infos.insert( arena->infos.end(),
+                         std::next( src.infos.begin(), o.infos ),
+                         std::next( src.infos.begin(), o.infos + n.infos ) );
+    arena->idxs.insert( arena->idxs.end(),
+                        std::next( src.idxs.begin(), o.idxs ),
+                        std::next( src.idxs.begin(), o.idxs + n.idxs ) );
+  }
+  //Only switch over once the new arena is complete (releasing the old ones):
+  std::shared_ptr<const SABSamplerDataArena> carena( std::move(arena) );
+  for ( std::size_t i = 0; i < arenaSamplers.size(); ++i ) {
+    arenaSamplers[i]->m_arena = carena;
+    arenaSamplers[i]->m_offsets = newOffsets.at(i);
+  }
+}
+
+namespace NCrystal {
+  namespace SAB {
+    namespace {
+      std::shared_ptr<const SABSamplerDataArena> createAlg1Arena( VectD&& betaVals,
+                                                                 VectD&& betaWeights,
+                                                                 std::vector<SABAlphaSampleInfo>&& alphaSamplerInfos )
+      {
+        nc_assert( betaWeights.size() == betaVals.size() );
+        //+1 since vals,weights starts with (beta_lower,0.0):
+        nc_assert( alphaSamplerInfos.size()+1 == betaVals.size() );
+        //Use PointwiseDist to validate and normalise, then keep just the data:
+        PointwiseDist pd( std::move(betaVals), std::move(betaWeights) );
+        auto arena = std::make_shared<SABSamplerDataArena>();
+        const std::size_t n = pd.getXVals().size();
+        arena->dbls.reserve( 3 * n );
+        arena->dbls.insert( arena->dbls.end(), pd.getXVals().begin(), pd.getXVals().end() );
+        arena->dbls.insert( arena->dbls.end(), pd.getYVals().begin(), pd.getYVals().end() );
+        arena->dbls.insert( arena->dbls.end(), pd.getCDF().begin(), pd.getCDF().end() );
+        arena->infos.assign( alphaSamplerInfos.begin(), alphaSamplerInfos.end() );
+        return arena;
+      }
+
+      std::shared_ptr<const SABSamplerDataArena> createAliasArena( VectD&& betaVals,
+                                                                  VectD&& betaWeights,
+                                                                  std::vector<SABAlphaSampleInfo>&& alphaSamplerInfos )
+      {
+        nc_assert_always( betaWeights.size() == betaVals.size() );
+        nc_assert_always( betaVals.size() >= 2 );
+        //+1 since vals,weights starts with (beta_lower,0.0):
+        nc_assert( alphaSamplerInfos.size()+1 == betaVals.size() );
+
+        //Set up alias tables over the beta bins with Vose's method, using the
+        //(trapezoidal) bin integrals of P(beta|Ei) as weights:
+        const std::size_t n = betaVals.size() - 1;
+        VectD scaledProb( n );
+        StableSum total;
+        for ( std::size_t i = 0; i < n; ++i ) {
+          const double w = 0.5 * ( betaWeights[i] + betaWeights[i+1] ) * ( betaVals[i+1] - betaVals[i] );
+          if ( !( w >= 0.0 ) || std::isinf(w) )
+            NCRYSTAL_THROW(CalcError,"Invalid beta bin weight encountered while setting up alias tables.");
+          scaledProb[i] = w;
+          total.add( w );
+        }
+        if ( !( total.sum() > 0.0 ) )
+          NCRYSTAL_THROW(CalcError,"Vanishing beta distribution encountered while setting up alias tables.");
+        const double scale = n / total.sum();
+        for ( auto& e : scaledProb )
+          e *= scale;
+
+        VectD aliasProb( n, 1.0 );
+        std::vector<uint32_t> aliasIdx( n );
+        std::vector<uint32_t> small, large;
+        small.reserve( n );
+        large.reserve( n );
+        for ( std::size_t i = 0; i < n; ++i ) {
+          aliasIdx[i] = static_cast<uint32_t>( i );
+          ( scaledProb[i] < 1.0 ? small : large ).push_back( static_cast<uint32_t>( i ) );
+        }
+        while ( !small.empty() && !large.empty() ) {
+          const uint32_t s = small.back();
+          small.pop_back();
+          const uint32_t l = large.back();
+          aliasProb[s] = scaledProb[s];
+          aliasIdx[s] = l;
+          scaledProb[l] -= ( 1.0 - scaledProb[s] );
+          if ( scaledProb[l] < 1.0 ) {
+            large.pop_back();
+            small.push_back( l );
+          }
+        }
+        //Remaining entries (if any, due to numerical imprecision) keep
+        //aliasProb=1.0.
+
+        auto arena = std::make_shared<SABSamplerDataArena>();
+        arena->dbls.reserve( 3 * n + 2 );//i.e. 3*nbeta-1
+        arena->dbls.insert( arena->dbls.end(), betaVals.begin(), betaVals.end() );
+        arena->dbls.insert( arena->dbls.end(), betaWeights.begin(), betaWeights.end() );
+        arena->dbls.insert( arena->dbls.end(), aliasProb.begin(), aliasProb.end() );
+        arena->idxs.assign( aliasIdx.begin(), aliasIdx.end() );
+        arena->infos.assign( alphaSamplerInfos.begin(), alphaSamplerInfos.end() );
+        return arena;
+      }
+    }
+  }
+}
+
 NC::SAB::SABSamplerAtE_Alg1::SABSamplerAtE_Alg1( std::shared_ptr<const CommonCache> common,
                                                  VectD&& betaVals,
                                                  VectD&& betaWeights,
                                                  std::vector<AlphaSampleInfo>&& alphaSamplerInfos,
                                                  std::size_t ibetaOffset )
-  : m_common( std::move(common) ),
-    m_betaSampler(VectD(betaVals.begin(),betaVals.end()),//todo: in principle no need to copy here.
-                  VectD(betaWeights.begin(),betaWeights.end()) ),
-    m_alphaSamplerInfos( std::move(alphaSamplerInfos) ),
+  : SABSamplerAtE_ArenaBased( createAlg1Arena( std::move(betaVals),
+                                               std::move(betaWeights),
+                                               std::move(alphaSamplerInfos) ) ),
+    m_common( std::move(common) ),
     m_ibetaOffset( ibetaOffset )
 {
   nc_assert( !!m_common );
-  nc_assert( betaWeights.size() == betaVals.size() );
+  m_nbeta = m_common->data->betaGrid().size() + 1 - ibetaOffset;
+  nc_assert( arenaSizes().dbls == 3*m_nbeta && arenaSizes().infos+1 == m_nbeta );
+}
 
-  //+1 in the next two asserts since vals,weights starts with (beta_lower,0.0):
-  nc_assert( m_alphaSamplerInfos.size()+1 == betaVals.size() );
-  nc_assert( ibetaOffset+betaVals.size() == m_common->data->betaGrid().size()+1 );
+std::size_t NC::SAB::SABSamplerAtE_ArenaBased::memoryFootprint() const
+{
+  //Fixed overhead (incl. members of derived classes) is roughly estimated:
+  return 128 + m_sizes.dbls * sizeof(double)
+    + m_sizes.infos * sizeof(SABAlphaSampleInfo) + m_sizes.idxs * sizeof(uint32_t);
+}
+
+std::size_t NC::SAB::SABSamplerAtE_Alg1::CommonCache::memoryFootprint() const
+{
+  //The SABData is included, although it might also be kept alive elsewhere
+  //(e.g. in factory caches):
+  return sizeof(CommonCache) + ( logsab.size() + alphaintegrals_cumul.size() ) * sizeof(double)
+    + ( data ? data->memoryFootprint() : 0 );
+}
+
+std::pair<const void*,std::size_t> NC::SAB::SABSamplerAtE_Alg1::sharedDataFootprint() const
+{
+  return { m_common.get(), m_common->memoryFootprint() };
 }
 
 NC::PairDD NC::SAB::SABSamplerAtE_Alg1::sampleAlphaBeta(double ekin_div_kT, RNG&rng) const
 {
   nc_assert(!!m_common);
-  const auto& betaGrid = m_common->data->betaGrid();
-  const auto& alphaGrid = m_common->data->alphaGrid();
-  nc_assert(m_ibetaOffset<betaGrid.size());
-
-  //Allow only loopmax sample attempts, to make sure we detect if code gets too
-  //inefficient. However, make sure users can override this if needed.
-  static const unsigned s_loopmax = []() -> unsigned
-                                    {
-                                      auto envstr = getenv("NCRYSTAL_SABSAMPLE_LOOPMAX");
-                                      return envstr ? str2int(envstr) : 100;
-                                    }();
-  unsigned iloopmax(s_loopmax+1);
-  while (--iloopmax) {
-    double beta;
-    unsigned ibetaSampled;
-    std::tie(beta,ibetaSampled) = m_betaSampler.sampleWithIndex( rng );
-
-    nc_assert( !ncisnan(beta) );
-    nc_assert( beta <= betaGrid.back() );
-    nc_assert( ibetaSampled < m_betaSampler.getXVals().size() );
-
-    if (beta <= ncmax(-ekin_div_kT,betaGrid.front()))
-      continue;//reject
-    double alphal(-1.0), bl;
-    std::size_t ibeta;
-
-    double rand_percentile = rng.generate();
-
-    if ( beta <= m_betaSampler.getXVals().at(1) ) {
-      //Special case, beta is before the first actual betaGrid point used to
-      //construct this instance of SABSamplerAtE_Alg1. Simply pick uniformly in
-      //allowed region (nb: we could of course instead query the actual S-values
-      //and interpolate among them).
-      bl = m_betaSampler.getXVals().front();
-      auto alimits_bl = getAlphaLimits( ekin_div_kT, bl );
-      double alphal_low = ncclamp(alimits_bl.first,alphaGrid.front(),alphaGrid.back());
-      double alphal_up = ncclamp(alimits_bl.second,alphaGrid.front(),alphaGrid.back());
-      alphal = alphal_low + rng.generate()*(alphal_up-alphal_low);
-      ibeta = m_ibetaOffset;
-      //Double-check that chosen ibeta value gives correct bh=betaGrid.at(ibeta)
-      //value, i.e. m_betaSampler.getXVals().at(1):
-      nc_assert(floateq(m_betaSampler.getXVals().at(1),betaGrid.at(ibeta)));
-    } else {
-      ibeta = m_ibetaOffset + ibetaSampled;
-      nc_assert( ibeta>0 );
-      bl = betaGrid.at(ibeta-1);
-      alphal = sampleAlpha(ibeta-1, rand_percentile);
-    }
-
-    nc_assert( valueInInterval(betaGrid.at(ibeta-1),betaGrid.at(ibeta),beta) );
-    nc_assert( alphal>=0.0 );
-    nc_assert( ibeta < betaGrid.size() );
-
-    //Sample alphas (with same "random percentile" at two neighbouring beta grid
-    //points and combine with linear interpolation, as in line 9 in Algorithm 1
-    //of the paper:
-    double bh = betaGrid.at(ibeta);
-    double alphah = sampleAlpha(ibeta, rand_percentile);
-
-    nc_assert(bh-bl>0.0);
-    nc_assert(alphal>=0.0);
-    nc_assert(alphah>=0.0);
-    double alpha = alphal + (alphah-alphal) * (beta-bl)/(bh-bl);
-
-    //Check if we can accept this:
-    auto alimits = getAlphaLimits( ekin_div_kT, beta );
-    if ( valueInInterval( alimits.first, alimits.second, alpha ) )
-      return { alpha, beta };
-  }
-  NCRYSTAL_THROW2(CalcError,"Rejection method failed to sample kinematically valid (alpha,beta) point after "
-                  <<s_loopmax<<" attempts. Perhaps energy grid is too sparse?"
-                  " As a workaround it is possible to increase the allowed number of sampling attempts"
-                  " by setting the NCRYSTAL_SABSAMPLE_LOOPMAX variable to a higher number"
-                  " (but please consider reporting the issue to the NCrystal developers nonetheless).");
+  return sampleAlphaBetaImpl( *m_common->data, arenaDbls(), m_nbeta, m_ibetaOffset,
+                              ekin_div_kT, rng,
+                              [this](RNG& r) { return sampleBetaWithIndex( r ); },
+                              [this](std::size_t ibeta, double p) { return sampleAlpha( ibeta, p ); } );
 }
 
-double NC::SAB::SABSamplerAtE_Alg1::sampleBeta(RNG& rng) const
+std::pair<double,unsigned> NC::SAB::SABSamplerAtE_Alg1::sampleBetaWithIndex(RNG& rng) const
 {
-  return m_betaSampler.sample(rng);
+  const double * d = arenaDbls();
+  return PointwiseDist::percentileWithIndex( d, d + m_nbeta, d + 2*m_nbeta, m_nbeta, rng() );
 }
 
 double NC::SAB::SABSamplerAtE_Alg1::sampleAlpha(std::size_t ibeta, double rand_percentile) const
 {
-  nc_assert( ibeta >= m_ibetaOffset );
-  const auto& info = vectAt(m_alphaSamplerInfos,ibeta-m_ibetaOffset);
-
-  const auto& cd = m_common->data;
-  auto nalpha = cd->alphaGrid().size();
-  auto cumul = SABUtils::sliceSABAtBetaIdx_const(m_common->alphaintegrals_cumul,nalpha,ibeta);
-  auto sab = SABUtils::sliceSABAtBetaIdx_const(cd->sab(),nalpha,ibeta);
-  auto logsab = SABUtils::sliceSABAtBetaIdx_const(m_common->logsab,nalpha,ibeta);
-  auto clampRandNum = [](double r) { return ncclamp( r, std::numeric_limits<double>::min(), 1.0 ); };//ensure r is in (0,1]
-  auto clampUnitInterval = [](double r) { return ncclamp( r, 0.0, 1.0 ); };//ensure r is in [0,1]
-
-  if ( rand_percentile <= info.prob_front) {
-    if ( info.prob_front == 2.0) {
-      //special value indicating 0 cross-section at value, sample linearly in
-      //[pt_front.alpha,pt_back.alpha] for lack of better options..
-      double da = info.pt_back.alpha-info.pt_front.alpha;
-      nc_assert(da>=0.0);
-      return info.pt_front.alpha + rand_percentile*da;
-    } else if ( info.prob_front == 1.0) {
-      //Valid alpha range is narrow and contained within a single bin.
-      return SABUtils::sampleLogLinDist_fast( info.pt_front.alpha, info.pt_front.sval,
-                                              info.pt_back.alpha, info.pt_back.sval,
-                                              rand_percentile,
-                                              info.pt_front.logsval, info.pt_back.logsval );
-    } else {
-      //Sample front tail
-      double percentile2 = clampRandNum( rand_percentile / info.prob_front );
-      return SABUtils::sampleLogLinDist_fast( info.pt_front.alpha, info.pt_front.sval,
-                                              vectAt(cd->alphaGrid(),info.pt_front.alpha_idx), sab[info.pt_front.alpha_idx],
-                                              percentile2,
-                                              info.pt_front.logsval, logsab[info.pt_front.alpha_idx] );
+  nc_assert( ibeta >= m_ibetaOffset && ibeta-m_ibetaOffset+1 < m_nbeta );
+  return sampleAlphaImpl( *m_common, arenaInfos()[ibeta-m_ibetaOffset],
+                          ibeta, rand_percentile,
+                          [](const double* itB, const double* itE, double x) { return std::upper_bound(itB,itE,x); } );
+}
+
+NC::SAB::SABSamplerAtE_Alias::CommonCache::CommonCache( std::shared_ptr<const SABSamplerAtE_Alg1::CommonCache> b )
+  : base( std::move(b) )
+{
+  nc_assert_always( !!base );
+  const std::size_t nalpha = base->data->alphaGrid().size();
+  const std::size_t nbeta = base->data->betaGrid().size();
+  nc_assert_always( nalpha >= 2 && nalpha <= std::numeric_limits<uint16_t>::max() );
+  //On average one guide bin per alpha bin:
+  nguide = nalpha - 1;
+  alphaguides.resize( nbeta * ( nguide + 1 ) );
+  for ( std::size_t ibeta = 0; ibeta < nbeta; ++ibeta ) {
+    auto cumul = SABUtils::sliceSABAtBetaIdx_const(base->alphaintegrals_cumul,nalpha,ibeta);
+    const double total = cumul[nalpha-1];
+    uint16_t * guide = &alphaguides[ibeta*(nguide+1)];
+    std::size_t i = 0;
+    for ( std::size_t k = 0; k <= nguide; ++k ) {
+      const double threshold = total * ( double(k) / nguide );
+      while ( i < nalpha && !( cumul[i] > threshold ) )
+        ++i;
+      guide[k] = static_cast<uint16_t>( i );
     }
-  } else if ( rand_percentile <= info.prob_notback ) {
-    //Middle section - sample over entire alpha bins.
-    nc_assert( info.prob_notback - info.prob_front > 0.0 );
-    double percentile2 = clampUnitInterval( ( rand_percentile - info.prob_front ) / ( info.prob_notback - info.prob_front ) );
-    unsigned alphaidx_low(info.pt_front.alpha_idx), alphaidx_upp(info.pt_back.alpha_idx);
-    auto itCumul_low = std::next(cumul.begin(),alphaidx_low);
-    auto itCumul_upp = std::next(cumul.begin(),alphaidx_upp);
-    nc_assert( itCumul_upp > itCumul_low && itCumul_upp<cumul.end() );
-    double selectedArea = *itCumul_low + percentile2 * ( *itCumul_upp - *itCumul_low );
-    auto itCumul_selected_edgeupp = std::upper_bound(itCumul_low, std::next(itCumul_upp), selectedArea);
-    if ( itCumul_selected_edgeupp > itCumul_upp )
-      return vectAt( cd->alphaGrid(), alphaidx_upp );
-    if ( itCumul_selected_edgeupp <= itCumul_low )
-      return vectAt( cd->alphaGrid(), alphaidx_low );
-
-    nc_assert(itCumul_selected_edgeupp>itCumul_low);
-    auto itCumul_selected_edgelow = std::prev(itCumul_selected_edgeupp);
-    nc_assert( *itCumul_selected_edgelow <= selectedArea );
-    nc_assert( *itCumul_selected_edgeupp >= selectedArea );
-    double binArea = *itCumul_selected_edgeupp - *itCumul_selected_edgelow;
-    nc_assert( binArea > 0.0);
-    //rescale leftover parts of rand_percentile back to the unit interval:
-    double rand_rescaled = clampRandNum((selectedArea-*itCumul_selected_edgelow)/binArea);
-    nc_assert( rand_rescaled >= 0.0 );
-    nc_assert( rand_rescaled <= 1.0 );
-    auto a0 = itCumul_selected_edgelow - cumul.begin();
-    auto a1 = a0 + 1;
-    //Interpolate in selected bin for alpha value:
-    return SABUtils::sampleLogLinDist_fast( vectAt(cd->alphaGrid(),a0), sab[a0],
-                                            vectAt(cd->alphaGrid(),a1), sab[a1],
-                                            rand_rescaled,
-                                            logsab[a0], logsab[a1] );
+  }
+}
+
+NC::SAB::SABSamplerAtE_Alias::SABSamplerAtE_Alias( std::shared_ptr<const CommonCache> common,
+                                                   VectD&& betaVals,
+                                                   VectD&& betaWeights,
+                                                   std::vector<AlphaSampleInfo>&& alphaSamplerInfos,
+                                                   std::size_t ibetaOffset )
+  : SABSamplerAtE_ArenaBased( createAliasArena( std::move(betaVals),
+                                                std::move(betaWeights),
+                                                std::move(alphaSamplerInfos) ) ),
+    m_common( std::move(common) ),
+    m_ibetaOffset( ibetaOffset )
+{
+  nc_assert( !!m_common );
+  m_nbeta = m_common->base->data->betaGrid().size() + 1 - ibetaOffset;
+  nc_assert( arenaSizes().dbls == 3*m_nbeta-1 && arenaSizes().infos+1 == m_nbeta && arenaSizes().idxs+1 == m_nbeta );
+}
+
+std::pair<double,unsigned> NC::SAB::SABSamplerAtE_Alias::sampleBetaWithIndex( RNG& rng ) const
+{
+  const double * betaVals = arenaDbls();
+  const double * betaWeights = betaVals + m_nbeta;
+  const double * aliasProb = betaWeights + m_nbeta;
+  const uint32_t * aliasIdx = arenaIdxs();
+
+  //Pick bin with alias method. The leftover part of the random number is
+  //rescaled and used for sampling within the bin:
+  const std::size_t n = m_nbeta - 1;
+  const double u = rng.generate() * n;
+  std::size_t i = std::min<std::size_t>( static_cast<std::size_t>( u ), n - 1 );
+  double r = u - i;
+  const double p = aliasProb[i];
+  if ( r < p ) {
+    r /= p;
   } else {
-    //Sample back tail
-    nc_assert( 1.0 - info.prob_notback > 0.0 );
-    double percentile2 = clampRandNum ( ( rand_percentile - info.prob_notback ) / ( 1.0 - info.prob_notback ) );
-    return SABUtils::sampleLogLinDist_fast( vectAt(cd->alphaGrid(),info.pt_back.alpha_idx), sab[info.pt_back.alpha_idx],
-                                            info.pt_back.alpha, info.pt_back.sval,
-                                            percentile2,
-                                            logsab[info.pt_back.alpha_idx], info.pt_back.logsval );
+    r = ( r - p ) / ( 1.0 - p );
+    i = aliasIdx[i];
+  }
+  r = ncclamp( r, 0.0, 1.0 );
 
+  //Sample linearly varying density within bin (as in PointwiseDist):
+  const double x0 = betaVals[i];
+  const double dx = betaVals[i+1] - x0;
+  const double a = betaWeights[i];
+  const double d = betaWeights[i+1] - a;
+  const double c = r * ( a + 0.5 * d ) * dx;//area to the left of sampled point
+  double zdx;
+  if (!a) {
+    zdx = d>0.0 ? std::sqrt( ( 2.0 * c * dx ) / d ) : 0.5*dx;
+  } else {
+    double e = d * c / ( dx * a * a );
+    if (ncabs(e)>1e-7) {
+      zdx = ( std::sqrt( 1.0 + 2.0 * e ) - 1.0 ) * dx * a / d;
+    } else {
+      //calculate via expansion (solves numerical issue when d is near zero):
+      zdx = ( 1 + 0.5 * e * ( e - 1.0 ) ) * c / a;
+    }
   }
+  return { ncclamp( x0 + zdx, x0, betaVals[i+1] ), static_cast<unsigned>( i ) };
+}
 
+std::size_t NC::SAB::SABSamplerAtE_Alias::CommonCache::memoryFootprint() const
+{
+  return sizeof(CommonCache) + alphaguides.capacity() * sizeof(uint16_t)
+    + ( base ? base->memoryFootprint() : 0 );
+}
+
+std::pair<const void*,std::size_t> NC::SAB::SABSamplerAtE_Alias::sharedDataFootprint() const
+{
+  return { m_common.get(), m_common->memoryFootprint() };
+}
+
+NC::PairDD NC::SAB::SABSamplerAtE_Alias::sampleAlphaBeta(double ekin_div_kT, RNG&rng) const
+{
+  nc_assert(!!m_common);
+  const auto& common = *m_common->base;
+  const std::size_t nalpha = common.data->alphaGrid().size();
+  const std::size_t nguide = m_common->nguide;
+  auto sampleAlpha = [this,&common,nalpha,nguide](std::size_t ibeta, double rand_percentile)
+  {
+    nc_assert( ibeta >= m_ibetaOffset );
+    auto findUpperBound = [this,&common,nalpha,nguide,ibeta](const double* itB, const double* itE, double x)
+    {
+      //Locate the upper bound in the entire row via the guide tables, and
+      //verify the result (falling back to a binary search over the requested
+      //range if needed). Since the row is sorted, the upper bound in the
+      //[itB,itE) range is then simply found by clipping:
+      const double * cB = common.alphaintegrals_cumul.data() + ibeta * nalpha;
+      const double * cE = cB + nalpha;
+      const double total = cE[-1];
+      if ( total > 0.0 ) {
+        const double fg = x * ( nguide / total );
+        const std::size_t k = ( fg > 0.0 ? std::min<std::size_t>( static_cast<std::size_t>( fg ), nguide - 1 ) : 0 );
+        const uint16_t * guide = &m_common->alphaguides[ibeta*(nguide+1)+k];
+        const double * it = std::upper_bound( cB + guide[0], cB + guide[1], x );
+        if ( ( it == cB || !( it[-1] > x ) ) && ( it == cE || *it > x ) )
+          return std::max( itB, std::min( it, itE ) );
+      }
+      return std::upper_bound( itB, itE, x );
+    };
+    nc_assert( ibeta-m_ibetaOffset+1 < m_nbeta );
+    return sampleAlphaImpl( common, arenaInfos()[ibeta-m_ibetaOffset],
+                            ibeta, rand_percentile, findUpperBound );
+  };
+  return sampleAlphaBetaImpl( *common.data, arenaDbls(), m_nbeta, m_ibetaOffset,
+                              ekin_div_kT, rng,
+                              [this](RNG& r) { return sampleBetaWithIndex( r ); },
+                              sampleAlpha );
 }
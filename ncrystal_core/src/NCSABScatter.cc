@@ -21,14 +21,36 @@
 #include "NCrystal/internal/NCSABScatter.hh"
 #include "NCrystal/internal/NCSABFactory.hh"
 #include "NCrystal/internal/NCDynInfoUtils.hh"
+#include "NCrystal/internal/NCThreadUtils.hh"
+#include "NCrystal/NCFact.hh"
 #include "NCrystal/internal/NCSABFactory.hh"
 #include "NCrystal/internal/NCRandUtils.hh"
 #include "NCrystal/internal/NCVDOSToScatKnl.hh"
+#include "NCrystal/internal/NCRuntimeCounters.hh"
 namespace NC = NCrystal;
 
 struct NC::SABScatter::Impl {
+  //State of deferred creation, shared with any background warm-up task (which
+  //might run after the SABScatter object is gone):
+  struct Deferred {
+    std::mutex mtx;
+    HelperProducer producer;
+    std::shared_ptr<const SAB::SABScatterHelper> result;
+    const SAB::SABScatterHelper& get()
+    {
+      NCRYSTAL_LOCK_GUARD(mtx);
+      if ( !result ) {
+        nc_assert_always( producer != nullptr );
+        result = producer();
+        producer = nullptr;//release any objects kept alive by it
+      }
+      return *result;
+    }
+  };
   Impl(shared_obj<const SAB::SABScatterHelper> sp) : m_scathelper_shptr(std::move(sp)) {}
-  shared_obj<const SAB::SABScatterHelper> m_scathelper_shptr;
+  Impl(HelperProducer p) : m_deferred(std::make_shared<Deferred>()) { m_deferred->producer = std::move(p); }
+  std::shared_ptr<const SAB::SABScatterHelper> m_scathelper_shptr;
+  std::shared_ptr<Deferred> m_deferred;
 };
 
 NC::SABScatter::~SABScatter() = default;
@@ -36,7 +58,55 @@ NC::SABScatter::~SABScatter() = default;
 NC::SABScatter::SABScatter( shared_obj<const NC::SAB::SABScatterHelper> sh )
   : m_impl(std::move(sh)), m_sh(m_impl->m_scathelper_shptr.get())
 {
-  //All other constructors delegate to this one.
+  //All other non-deferred constructors delegate to this one.
+}
+
+NC::SABScatter::SABScatter( HelperProducer producer, bool backgroundWarmup )
+  : m_impl(std::move(producer)), m_sh(nullptr)
+{
+  if ( !m_impl->m_deferred->producer )
+    NCRYSTAL_THROW(BadInput,"SABScatter: invalid (empty) producer function");
+  if ( backgroundWarmup ) {
+    std::weak_ptr<Impl::Deferred> wp = m_impl->m_deferred;
+    queueBackgroundTask( [wp]()
+                         {
+                           auto d = wp.lock();
+                           if ( !d )
+                             return;//SABScatter object already gone
+                           try {
+                             d->get();
+                           } catch (...) {
+                             //Ignore, will be rethrown at first use.
+                           }
+                         }, getNumberOfThreads() );
+  }
+}
+
+const NC::SAB::SABScatterHelper& NC::SABScatter::initHelper() const
+{
+  nc_assert_always( m_impl->m_deferred != nullptr );
+  const SAB::SABScatterHelper& sh = m_impl->m_deferred->get();
+  m_sh.store( &sh, std::memory_order_release );
+  return sh;
+}
+
+NC::shared_obj<const NC::SAB::SABScatterHelper> NC::SABScatter::createHelper( const DI_ScatKnl& di_sk,
+                                                                             unsigned vdoslux,
+                                                                             bool useCache,
+                                                                             uint32_t vdos2sabExcludeFlag,
+                                                                             SAB::SamplerAlg samplerAlg,
+                                                                             SAB::EGridDensity egridDensity )
+{
+  auto sabdata_ptr = extractSABDataFromDynInfo(&di_sk,vdoslux,useCache,vdos2sabExcludeFlag);
+  nc_assert_always(!!sabdata_ptr);
+  auto egrid = SAB::applyEGridDensity( di_sk.energyGrid(), egridDensity );
+  return ( useCache
+           ? SAB::createScatterHelperWithCache( std::move(sabdata_ptr),
+                                                std::move(egrid),
+                                                samplerAlg )
+           : shared_obj<const SAB::SABScatterHelper>( SAB::createScatterHelper( std::move(sabdata_ptr),
+                                                                                std::move(egrid),
+                                                                                samplerAlg ) ) );
 }
 
 NC::SABScatter::SABScatter( std::unique_ptr<const NC::SAB::SABScatterHelper> upsh )
@@ -50,17 +120,10 @@ NC::SABScatter::SABScatter( NC::SAB::SABScatterHelper&& sh )
 }
 
 NC::SABScatter::SABScatter( const DI_ScatKnl& di_sk, unsigned vdoslux, bool
-                            useCache, uint32_t vdos2sabExcludeFlag )
-  : SABScatter( [&di_sk,vdoslux,useCache,vdos2sabExcludeFlag]()
-                {
-                  auto sabdata_ptr = extractSABDataFromDynInfo(&di_sk,vdoslux,useCache,vdos2sabExcludeFlag);
-                  nc_assert_always(!!sabdata_ptr);
-                  return ( useCache
-                           ? SAB::createScatterHelperWithCache( std::move(sabdata_ptr),
-                                                                di_sk.energyGrid() )
-                           : SAB::createScatterHelper( std::move(sabdata_ptr),
-                                                       di_sk.energyGrid() ) );
-                }() )
+                            useCache, uint32_t vdos2sabExcludeFlag,
+                            SAB::SamplerAlg samplerAlg,
+                            SAB::EGridDensity egridDensity )
+  : SABScatter( createHelper( di_sk, vdoslux, useCache, vdos2sabExcludeFlag, samplerAlg, egridDensity ) )
 {
 }
 
@@ -84,20 +147,64 @@ NC::SABScatter::SABScatter( shared_obj<const SABData> sabdata_shptr,
 {
 }
 
+std::size_t NC::SABScatter::memoryFootprint() const
+{
+  //NB: Scatter helpers shared with other SABScatter instances (via the
+  //factory cache) are counted for each of them. Deferred creation is not
+  //triggered here:
+  auto sh = m_sh.load( std::memory_order_acquire );
+  return sizeof(SABScatter) + sizeof(Impl) + ( sh ? sh->memoryFootprint() : 0 );
+}
+
+void NC::SABScatter::warmup( EnergyDomain edom, WarmupLevel level ) const
+{
+  const auto& sh = helper();
+  if ( level == WarmupLevel::Complete )
+    sh.sampler().createSamplers( edom.elow.dbl(), edom.ehigh.dbl(), getNumberOfThreads() );
+  ProcImpl::ScatterIsotropicMat::warmup( edom, level );
+}
+
 NC::CrossSect NC::SABScatter::crossSectionIsotropic( CachePtr&, NeutronEnergy ekin ) const
 {
-  return CrossSect{ m_sh->xsprovider.crossSection(ekin) };
+  NCRYSTAL_RTCOUNTER_SCOPE(*this,XSCalls);
+  return CrossSect{ helper().xsprovider.crossSection(ekin) };
+}
+
+void NC::SABScatter::crossSectionIsotropicMany( CachePtr&, const double* ekin,
+                                               std::size_t N, double* out_xs ) const
+{
+  NCRYSTAL_RTCOUNTER_SCOPE_N(*this,XSCalls,N);
+  helper().xsprovider.crossSectionMany( ekin, N, out_xs );
 }
 
 NC::ScatterOutcomeIsotropic NC::SABScatter::sampleScatterIsotropic( CachePtr&, RNG& rng, NeutronEnergy ekin ) const
 {
+  NCRYSTAL_RTCOUNTER_SCOPE(*this,SampleCalls);
   double delta_e, mu;
-  std::tie(delta_e,mu) = m_sh->sampler.sampleDeltaEMu(ekin, rng);
+  std::tie(delta_e,mu) = helper().sampler().sampleDeltaEMu(ekin, rng);
   nc_assert( mu >= -1.0 && mu <= 1.0 );
   return { NeutronEnergy{ncmax(0.0,ekin.get()+delta_e)}, CosineScatAngle{mu} };
 }
 
+void NC::SABScatter::sampleScatterIsotropicMany( CachePtr&, RNG& rng, const double* ekin,
+                                                std::size_t N, ScatterOutcomeIsotropic* out ) const
+{
+  NCRYSTAL_RTCOUNTER_SCOPE_N(*this,SampleCalls,N);
+  const auto& sampler = helper().sampler();
+  constexpr std::size_t chunksize = 128;
+  double delta_e[chunksize], mu[chunksize];
+  for ( std::size_t i0 = 0; i0 < N; i0 += chunksize ) {
+    const std::size_t n = std::min( chunksize, N - i0 );
+    sampler.sampleDeltaEMuMany( ekin + i0, n, rng, delta_e, mu );
+    for ( std::size_t j = 0; j < n; ++j ) {
+      nc_assert( mu[j] >= -1.0 && mu[j] <= 1.0 );
+      out[i0+j].ekin = NeutronEnergy{ncmax(0.0,ekin[i0+j]+delta_e[j])};
+      out[i0+j].mu = CosineScatAngle{mu[j]};
+    }
+  }
+}
+
 NC::Optional<std::string> NC::SABScatter::specificJSONDescription() const
 {
-  return m_sh->specificJSONDescription;
+  return helper().specificJSONDescription;
 }
@@ -0,0 +1,180 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/internal/NCSABTempGridScatter.hh"
+#include "NCrystal/internal/NCSABFactory.hh"
+#include "NCrystal/internal/NCSABUtils.hh"
+#include "NCrystal/internal/NCVDOSToScatKnl.hh"
+#include "NCrystal/internal/NCSABScatter.hh"
+#include "NCrystal/internal/NCRandUtils.hh"
+#include "NCrystal/NCFact.hh"
+#include "NCrystal/NCInfo.hh"
+#include "NCrystal/NCRNG.hh"
+#include "NCrystal/NCSmallVector.hh"
+namespace NC = NCrystal;
+
+NC::SABTempGridScatter::SABTempGridScatter( std::vector<Entry> entries )
+{
+  if ( entries.empty() )
+    NCRYSTAL_THROW(BadInput,"SABTempGridScatter requires at least one temperature");
+  std::stable_sort( entries.begin(), entries.end(),
+                    []( const Entry& a, const Entry& b ) { return a.first.dbl() < b.first.dbl(); } );
+  m_temps.reserve( entries.size() );
+  m_components.reserve( entries.size() );
+  for ( auto& e : entries ) {
+    e.first.validate();
+    if ( !m_temps.empty() && !( e.first.dbl() > m_temps.back() ) )
+      NCRYSTAL_THROW2(BadInput,"SABTempGridScatter got the same temperature more than once: "<<e.first);
+    if ( e.second.empty() )
+      NCRYSTAL_THROW2(BadInput,"SABTempGridScatter got no kernels at temperature "<<e.first);
+    for ( auto& c : e.second )
+      if ( !( c.first > 0.0 && c.first <= 1.0 ) )
+        NCRYSTAL_THROW2(BadInput,"SABTempGridScatter got invalid fraction "<<c.first);
+    m_temps.push_back( e.first.dbl() );
+    m_components.push_back( std::move(e.second) );
+  }
+}
+
+NC::SABTempGridScatter NC::SABTempGridScatter::createFromCfg( const MatCfg& cfg,
+                                                              const std::vector<Temperature>& temperatures )
+{
+  const auto samplerAlg = static_cast<SAB::SamplerAlg>( cfg.get_sabsampler() );
+  const auto egridDensity = SAB::egridDensityFromCfgValue( cfg.get_sabgrid() );
+  std::vector<Entry> entries;
+  entries.reserve( temperatures.size() );
+  for ( auto& temp : temperatures ) {
+    MatCfg cfg_at_temp = cfg.clone();
+    cfg_at_temp.set_temp( temp );
+    auto info = createInfo( cfg_at_temp );
+    std::vector<Component> components;
+    for ( auto& di : info->getDynamicInfoList() ) {
+      const DI_ScatKnl* di_scatknl = dynamic_cast<const DI_ScatKnl*>(di.get());
+      if ( di_scatknl ) {
+        components.emplace_back( di->fraction(),
+                                 SABScatter::createHelper( *di_scatknl, cfg.get_vdoslux(), true, 0,
+                                                           samplerAlg, egridDensity ) );
+      } else if ( !dynamic_cast<const DI_Sterile*>(di.get()) ) {
+        NCRYSTAL_THROW2(BadInput,"SABTempGridScatter requires all dynamic information of the material to be"
+                        " scattering kernels or VDOS curves (problematic entry for "<<info->displayLabel( di->atom().index )<<")");
+      }
+    }
+    if ( components.empty() )
+      NCRYSTAL_THROW2(BadInput,"SABTempGridScatter: no scattering kernels available for material at "<<temp);
+    entries.emplace_back( temp, std::move(components) );
+  }
+  return SABTempGridScatter( std::move(entries) );
+}
+NC::SABTempGridScatter NC::SABTempGridScatter::createFromVDOS( const VDOSData& vdosdata,
+                                                               const std::vector<Temperature>& temperatures,
+                                                               unsigned vdoslux,
+                                                               SAB::SamplerAlg samplerAlg )
+{
+  auto kernels = createScatteringKernels( vdosdata, temperatures, vdoslux );
+  nc_assert_always( kernels.size() == temperatures.size() );
+  std::vector<Entry> entries;
+  entries.reserve( kernels.size() );
+  for ( auto i : ncrange( kernels.size() ) ) {
+    auto sabdata = makeSO<const SABData>( SABUtils::transformKernelToStdFormat( std::move(kernels.at(i)) ) );
+    shared_obj<const SAB::SABScatterHelper> helper{ SAB::createScatterHelper( std::move(sabdata), nullptr, samplerAlg ) };
+    entries.emplace_back( temperatures.at(i), std::vector<Component>{ Component{ 1.0, std::move(helper) } } );
+  }
+  return SABTempGridScatter( std::move(entries) );
+}
+
+NC::SABTempGridScatter::Bracket NC::SABTempGridScatter::findBracket( double temperature ) const
+{
+  //Returns index i and weight w, such that the result is (1-w)*f(T_i)+w*f(T_{i+1}):
+  if ( !( temperature >= m_temps.front() && temperature <= m_temps.back() ) )
+    NCRYSTAL_THROW2(BadInput,"SABTempGridScatter: temperature "<<temperature
+                    <<"K is outside the available range ["<<m_temps.front()<<"K, "<<m_temps.back()<<"K]");
+  if ( m_temps.size() == 1 )
+    return { 0, 0.0 };
+  auto it = std::upper_bound( m_temps.begin(), m_temps.end(), temperature );
+  std::size_t idx = std::distance( m_temps.begin(), it );
+  idx = ( idx == 0 ? 0 : std::min<std::size_t>( idx - 1, m_temps.size() - 2 ) );
+  const double t0 = m_temps[idx];
+  const double t1 = m_temps[idx+1];
+  return { idx, ncclamp( ( temperature - t0 ) / ( t1 - t0 ), 0.0, 1.0 ) };
+}
+
+double NC::SABTempGridScatter::crossSectionAt( std::size_t itemp, NeutronEnergy ekin ) const
+{
+  double xs = 0.0;
+  for ( auto& c : m_components[itemp] )
+    xs += c.first * c.second->xsprovider.crossSection(ekin).dbl();
+  return xs;
+}
+
+NC::CrossSect NC::SABTempGridScatter::crossSection( NeutronEnergy ekin, Temperature temperature ) const
+{
+  auto b = findBracket( temperature.dbl() );
+  double xs = crossSectionAt( b.idx, ekin );
+  if ( b.w > 0.0 )
+    xs = (1.0-b.w) * xs + b.w * crossSectionAt( b.idx+1, ekin );
+  return CrossSect{ xs };
+}
+
+void NC::SABTempGridScatter::crossSectionMany( const double* ekin, const double* temperature,
+                                               std::size_t N, double* out_xs ) const
+{
+  for ( std::size_t i = 0; i < N; ++i )
+    out_xs[i] = crossSection( NeutronEnergy{ ekin[i] }, Temperature{ temperature[i] } ).dbl();
+}
+
+NC::ScatterOutcomeIsotropic NC::SABTempGridScatter::sampleImpl( RNG& rng, double ekin, double temperature ) const
+{
+  auto b = findBracket( temperature );
+  //Select kernel according to its contribution to the interpolated cross
+  //section (considering kernels at both bracketing temperatures):
+  const NeutronEnergy ekin_ne{ ekin };
+  const auto& comps0 = m_components[b.idx];
+  const std::vector<Component>* comps1 = ( b.w > 0.0 ? &m_components[b.idx+1] : nullptr );
+  SmallVector<double,16> commul;
+  double sum = 0.0;
+  for ( auto& c : comps0 )
+    commul.push_back( sum += (1.0-b.w) * c.first * c.second->xsprovider.crossSection( ekin_ne ).dbl() );
+  if ( comps1 ) {
+    for ( auto& c : *comps1 )
+      commul.push_back( sum += b.w * c.first * c.second->xsprovider.crossSection( ekin_ne ).dbl() );
+  }
+  const SAB::SABScatterHelper* helper;
+  if ( commul.size() == 1 || !( sum > 0.0 ) ) {
+    helper = comps0.front().second.get();
+  } else {
+    const std::size_t idx = pickRandIdxByWeight( rng, Span<const double>( commul.data(), commul.data() + commul.size() ) );
+    helper = ( idx < comps0.size() ? comps0[idx] : (*comps1)[idx-comps0.size()] ).second.get();
+  }
+  double delta_e, mu;
+  std::tie(delta_e,mu) = helper->sampler().sampleDeltaEMu( ekin_ne, rng );
+  nc_assert( mu >= -1.0 && mu <= 1.0 );
+  return { NeutronEnergy{ncmax(0.0,ekin+delta_e)}, CosineScatAngle{mu} };
+}
+
+NC::ScatterOutcomeIsotropic NC::SABTempGridScatter::sampleScatter( RNG& rng, NeutronEnergy ekin, Temperature temperature ) const
+{
+  return sampleImpl( rng, ekin.dbl(), temperature.dbl() );
+}
+
+void NC::SABTempGridScatter::sampleScatterMany( RNG& rng, const double* ekin, const double* temperature,
+                                                std::size_t N, ScatterOutcomeIsotropic* out ) const
+{
+  for ( std::size_t i = 0; i < N; ++i )
+    out[i] = sampleImpl( rng, ekin[i], temperature[i] );
+}
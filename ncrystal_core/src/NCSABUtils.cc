@@ -21,6 +21,7 @@
 #include "NCrystal/internal/NCSABUtils.hh"
 #include "NCrystal/internal/NCIter.hh"
 #include "NCrystal/internal/NCString.hh"
+#include "NCrystal/NCSmallVector.hh"
 namespace NC = NCrystal;
 
 NC::SABData NC::SABUtils::transformKernelToStdFormat( NC::ScatKnlData&& input )
@@ -148,15 +149,57 @@ NC::SABData NC::SABUtils::transformKernelToStdFormat( NC::ScatKnlData&& input )
   nc_assert_always( nminbeta_int >=0 && nminbeta_int < 20000 );
   const unsigned nminbeta = static_cast<unsigned>(nminbeta_int);
 
+  //Rows are only inserted where they make a difference. Inserted rows are
+  //linearly interpolated, while the subsequent processing interpolates
+  //log-linearly between rows, so what is being thickened is the difference
+  //between the two. At the midpoint of an interval, with S-values Sa and Sb at
+  //the edges, this difference is (Sa+Sb)/2-sqrt(Sa*Sb)=(sqrt(Sa)-sqrt(Sb))^2/2.
+  //Relative to the largest S-value at the same alpha, it must be below
+  //betaThickeningTol after splitting the interval into k pieces, where the
+  //difference is assumed to decrease as 1/k^2. The number of extra rows in any
+  //interval is never more than in the uniform thickening (which is recovered
+  //by setting the tolerance to 0).
+  const double betaThickeningTol = ncgetenv_dbl("SAB_BETATHICKENING_TOL",1e-3);
+  nc_assert_always( betaThickeningTol >= 0.0 && betaThickeningTol < 1.0 );
+
   if ( !input.betaGridOptimised && input.betaGrid.size() < nminbeta ) {
-    const unsigned nextra = nminbeta / input.betaGrid.size();//Number of extra beta points
+    const unsigned nextra = nminbeta / input.betaGrid.size();//Max number of extra beta points
                                                              //to insert between each point
     nc_assert_always( nextra >= 1 );
-    auto newNBeta = 1 + ( input.betaGrid.size() -1 ) * ( 1 + nextra );
+    const std::size_t nalpha = input.alphaGrid.size();
+    const std::size_t nbetaOld = input.betaGrid.size();
+
+    //Decide number of extra points for each interval:
+    std::vector<unsigned> nextraInInterval( nbetaOld - 1, nextra );
+    if ( betaThickeningTol > 0.0 ) {
+      VectD sqrtS = vectorTrf( input.sab, [](double S) { return std::sqrt( S ); } );
+      VectD invColMax( nalpha, 0.0 );//first holds maximum value, then inverted
+      for ( auto ibeta : ncrange( nbetaOld ) ) {
+        auto alphaSlice = sliceSABAtBetaIdx_const( input.sab, nalpha, ibeta );
+        for ( auto ialpha : ncrange( nalpha ) )
+          invColMax[ialpha] = ncmax( invColMax[ialpha], alphaSlice[ialpha] );
+      }
+      for ( auto& e : invColMax )
+        e = ( e > 0.0 ? 1.0 / e : 0.0 );
+      for ( auto ibeta : ncrange( nbetaOld - 1 ) ) {
+        const double * sqrtSRow = &sqrtS[ ibeta*nalpha ];
+        const double * sqrtSRowNext = sqrtSRow + nalpha;
+        double maxreldiff = 0.0;
+        for ( auto ialpha : ncrange( nalpha ) ) {
+          const double d = sqrtSRow[ialpha] - sqrtSRowNext[ialpha];
+          maxreldiff = ncmax( maxreldiff, 0.5 * d * d * invColMax[ialpha] );
+        }
+        const double k = std::ceil( std::sqrt( maxreldiff / betaThickeningTol ) );
+        nextraInInterval[ibeta] = ( k > nextra ? nextra : static_cast<unsigned>( ncmax( 1.0, k ) ) - 1 );
+      }
+    }
+    std::size_t newNBeta = nbetaOld;
+    for ( auto n : nextraInInterval )
+      newNBeta += n;
+
     VectD newb;
     newb.reserve( newNBeta );
     VectD newS;
-    const std::size_t nalpha = input.alphaGrid.size();
     newS.reserve( newNBeta * nalpha );
     auto itB = input.betaGrid.begin();
     auto itBLast = std::prev(input.betaGrid.end());
@@ -169,8 +212,9 @@ NC::SABData NC::SABUtils::transformKernelToStdFormat( NC::ScatKnlData&& input )
       newb.push_back(*itB);
       std::copy(alphaSlice.begin(), alphaSlice.end(), std::back_inserter(newS));
       //Then insert the new rows, one by one:
-      const double dBeta = (*itBNext - *itB)/(nextra+1);
-      for ( auto iextra : ncrange(nextra) ) {
+      const unsigned nextraHere = nextraInInterval[ibeta];
+      const double dBeta = (*itBNext - *itB)/(nextraHere+1);
+      for ( auto iextra : ncrange(nextraHere) ) {
         double beta = *itB + (iextra+1)*dBeta;
         newb.push_back(beta);
         for ( auto ialpha : ncrange(nalpha) ) {
@@ -366,10 +410,19 @@ void NC::SABUtils::activeGridRanges( const NC::SABData& data,
   auto itLow = alphaGrid.begin();
   auto itUpp = std::prev(alphaGrid.end());
 
-  for (auto&& beta : enumerate(data.betaGrid())) {
+  //Kinematic limits at all beta grid points in one go:
+  const auto& betaGrid = data.betaGrid();
+  SmallVector<double,256> alimits_low, alimits_upp;
+  alimits_low.resize( betaGrid.size() );
+  alimits_upp.resize( betaGrid.size() );
+  getAlphaLimitsMany( ekin_div_kT, betaGrid.data(), betaGrid.size(), alimits_low.data(), alimits_upp.data() );
+
+  for (auto&& beta : enumerate(betaGrid)) {
     double alow(-1.0),aupp(-2.0);
-    if ( beta.val > -ekin_div_kT )
-      std::tie(alow,aupp) = getAlphaLimits( ekin_div_kT, beta.val );
+    if ( beta.val > -ekin_div_kT ) {
+      alow = alimits_low[beta.idx];
+      aupp = alimits_upp[beta.idx];
+    }
     if ( agrid_back <= alow || agrid_front >= aupp || aupp < alow ) {
       //No kinematically accessible alpha grid ranges at this beta point (or
       //energy is so ultra low that numerical imprecision led to aupp=alow) .
@@ -19,6 +19,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "NCrystal/internal/NCSABXSProvider.hh"
+#include <functional>
 
 namespace NC = NCrystal;
 
@@ -42,6 +43,7 @@ void NC::SABXSProvider::setData( VectD&& egrid,
   nc_assert_always(!!m_extender);
   nc_assert_always(!m_egrid.empty());
   nc_assert_always(!m_xs.empty());
+  m_egridIndex = GridIndex( m_egrid );
 
   const double emax = m_egrid.back();
   const double extenderXS_emax = m_extender->crossSection(NeutronEnergy{emax}).dbl();
@@ -51,18 +53,62 @@ void NC::SABXSProvider::setData( VectD&& egrid,
   m_kExtension = ( tableXS_emax - extenderXS_emax ) * emax;
 }
 
+std::size_t NC::SABXSProvider::memoryFootprint() const
+{
+  return sizeof(SABXSProvider) + ( m_egrid.capacity() + m_xs.capacity() ) * sizeof(double)
+    + m_egridIndex.memoryFootprint();
+}
+
 NC::CrossSect NC::SABXSProvider::crossSection( NeutronEnergy ekin ) const
 {
-  nc_assert( ! m_xs.empty() && m_xs.size() == m_egrid.size() );
+  return CrossSect{ crossSectionAtIdx( ekin.dbl(), m_egridIndex.upperBoundIdx( m_egrid, ekin.dbl() ) ) };
+}
 
-  auto itEkinUpper = std::upper_bound ( m_egrid.begin(), m_egrid.end(), ekin.dbl() );
+void NC::SABXSProvider::crossSectionMany( const double* ekin, std::size_t N, double* out_xs ) const
+{
+  if ( N < 2 ) {
+    if ( N )
+      out_xs[0] = crossSection( NeutronEnergy{ ekin[0] } ).dbl();
+    return;
+  }
+  //Keep track of the upper bound index in the energy grid, moving it one step
+  //at a time as the input energies increase or decrease (the cost of a sorted
+  //curve is thus linear in the number of points and grid entries):
+  const std::size_t ngrid = m_egrid.size();
+  if ( std::is_sorted( ekin, ekin + N ) ) {
+    std::size_t iupper = m_egridIndex.upperBoundIdx( m_egrid, ekin[0] );
+    for ( std::size_t i = 0; i < N; ++i ) {
+      const double e = ekin[i];
+      while ( iupper < ngrid && m_egrid[iupper] <= e )
+        ++iupper;
+      out_xs[i] = crossSectionAtIdx( e, iupper );
+    }
+  } else if ( std::is_sorted( ekin, ekin + N, std::greater<double>() ) ) {
+    std::size_t iupper = m_egridIndex.upperBoundIdx( m_egrid, ekin[0] );
+    for ( std::size_t i = 0; i < N; ++i ) {
+      const double e = ekin[i];
+      while ( iupper > 0 && m_egrid[iupper-1] > e )
+        --iupper;
+      out_xs[i] = crossSectionAtIdx( e, iupper );
+    }
+  } else {
+    for ( std::size_t i = 0; i < N; ++i )
+      out_xs[i] = crossSection( NeutronEnergy{ ekin[i] } ).dbl();
+  }
+}
+
+double NC::SABXSProvider::crossSectionAtIdx( double ekin, std::size_t iupper ) const
+{
+  nc_assert( ! m_xs.empty() && m_xs.size() == m_egrid.size() );
+  nc_assert( iupper <= m_egrid.size() );
+  auto itEkinUpper = m_egrid.begin() + iupper;
   if ( itEkinUpper == m_egrid.end()) {
     //  integral_E(S) = (tableintegral_Emax(S)-extenderintegral_Emax(S))+extenderintegral_E(S)
     //  Now, in general XS(E) = [C/E] * integral_E(S),   C=sigmaB*kT/4. So:
     //    XS_E = [C/E] * integral_E(S)
     //            = [Emax/E]*([C/Emax]*tableintegral_Emax(S)-[C/Emax]*extenderintegral_Emax(S))+[C/E]*extenderintegral_E(S)
     //            = [Emax/E] *(tableXS_Emax-extenderXS_Emax) + extenderXS_E = k / E + extenderXS_E
-    return CrossSect{ m_kExtension / ekin.dbl() + m_extender->crossSection( ekin ).dbl() };
+    return m_kExtension / ekin + m_extender->crossSection( NeutronEnergy{ ekin } ).dbl();
   } else if ( itEkinUpper == m_egrid.begin() ) {
 
     //Energy is below lowest tabulated energy. At very small energies, the
@@ -77,7 +123,7 @@ NC::CrossSect NC::SABXSProvider::crossSection( NeutronEnergy ekin ) const
     //will decrease as 1/sqrt(E) for small energies (we have thus essentially
     //derived, or at least argued for, the "1/v law").
 
-    return CrossSect { ekin.dbl() > 0.0 ? std::sqrt( m_egrid.front() / ekin.dbl() ) * m_xs.front() : kInfinity };
+    return ekin > 0.0 ? std::sqrt( m_egrid.front() / ekin ) * m_xs.front() : kInfinity;
   } else {
     //linear interpolation in grid
     auto itEkinLower = std::prev(itEkinUpper);
@@ -86,10 +132,10 @@ NC::CrossSect NC::SABXSProvider::crossSection( NeutronEnergy ekin ) const
     const double dXS = *itXSUpper - *itXSLower;
     const double dEkin = *itEkinUpper - *itEkinLower;
     nc_assert(dEkin>0.0);
-    double xs = *itXSLower + dXS * ( ekin.dbl() - *itEkinLower ) / dEkin;
+    double xs = *itXSLower + dXS * ( ekin - *itEkinLower ) / dEkin;
     nc_assert(xs>=std::min<double>(*itXSLower,*itXSUpper));
     nc_assert(xs<=std::max<double>(*itXSLower,*itXSUpper));
-    return CrossSect{ xs };
+    return xs;
   }
 }
 
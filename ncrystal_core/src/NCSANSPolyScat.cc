@@ -0,0 +1,382 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/internal/NCSANSPolyScat.hh"
+#include "NCrystal/internal/NCMath.hh"
+#include "NCrystal/internal/NCString.hh"
+#include <sstream>
+#include <functional>
+namespace NC = NCrystal;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Theory:
+//
+// As in NCSANSSphScat.cc we start from [eq.1] from NCSANSUtils.hh:
+//
+//   sigma_sans(k) = C_sans * (Vp/k^2) * integral_0^2k{Q*P(Q)*S(Q)}dQ
+//
+// With S(Q)=1 and a number distribution n(R) of particle sizes, the volume
+// fraction phi in C_sans is shared between particles of all sizes, and Vp*P(Q)
+// must be replaced by <Vp^2*P(Q)>/<Vp> (with <> denoting averages over
+// n(R)). Writing Vp*P(Q)=A(Q)^2/Vp, the amplitudes A(Q) of the implemented
+// shapes are (with f(x) = 3*(sin(x)-x*cos(x))/x^3):
+//
+//  Sphere:            A = V(R)*f(QR)
+//  Core-shell sphere: A = (ratio-1)*V(R)*f(QR) + V(R+t)*f(Q(R+t)), Vp=V(R+t)
+//  Cylinder:          A^2 averaged over orientations, with mu=cos(alpha):
+//                     A^2 = Vp^2 * integral_0^1{ [ 2*J1(QR*sqrt(1-mu^2))/(QR*sqrt(1-mu^2))
+//                                                   * sinc(QL*mu/2) ]^2 }dmu
+//
+// The effective I(Q)=C_sans*<A(Q)^2>/<Vp> of all populations are added up and
+// tabulated on a log-spaced Q grid, after which:
+//
+//   sigma_sans(k) = (1/k^2) * integral_0^2k{Q*I(Q)}dQ
+//
+// Below the first grid point, Q*I(Q) is taken to be linear (not flat as the
+// default IofQHelper extrapolation), so cross sections approach a constant of
+// 2*I(0) when k->0.
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+namespace NCrystal {
+  namespace {
+
+    double sphereAmplitude( double x )
+    {
+      //3*(sin(x)-x*cos(x))/x^3, using a Taylor expansion at small x:
+      const double xsq = x*x;
+      if ( xsq < 0.0025 )
+        return 1.0 + xsq*(-0.1+xsq*(0.003571428571428571428571429+xsq*(-0.00006613756613756613756613757
+                                                                        +xsq*7.515632515632515632515633e-7)));
+      double sinx,cosx;
+      std::tie(sinx,cosx) = sincos_fast(x);
+      return 3.0 * ( sinx - x * cosx ) / ( xsq * x );
+    }
+
+    double twoJ1xDivX( double x )
+    {
+      //2*J1(x)/x, using the polynomial approximations in section 9.4 of
+      //Abramowitz and Stegun (absolute errors below 1e-7):
+      nc_assert( x >= 0.0 );
+      if ( x <= 3.0 ) {
+        const double y = ncsquare( x * (1.0/3.0) );
+        return 2.0 * ( 0.5+y*(-0.56249985+y*(0.21093573+y*(-0.03954289+y*(0.00443319
+                                                                          +y*(-0.00031761+y*0.00001109))))) );
+      }
+      const double y = 3.0 / x;
+      const double f1 = 0.79788456+y*(0.00000156+y*(0.01659667+y*(0.00017105+y*(-0.00249511
+                                                                              +y*(0.00113653-y*0.00020033)))));
+      const double theta1 = x-2.35619449+y*(0.12499612+y*(0.00005650+y*(-0.00637879+y*(0.00074348
+                                                                                     +y*(0.00079824-y*0.00029166)))));
+      return 2.0 * f1 * std::cos( theta1 ) / ( x * std::sqrt( x ) );
+    }
+
+    double sinc( double x )
+    {
+      const double xsq = x*x;
+      if ( xsq < 0.0025 )
+        return 1.0 + xsq*(-0.1666666666666666666666667+xsq*(0.008333333333333333333333333
+                                                             -xsq*0.0001984126984126984126984127));
+      return std::sin(x) / x;
+    }
+
+    //Simpson weights for n (odd) points (to be multiplied by the step size):
+    VectD simpsonWeights( unsigned n )
+    {
+      nc_assert( n >= 3 && n % 2 == 1 );
+      VectD w( n );
+      for ( auto i : ncrange( n ) )
+        w[i] = ( i == 0 || i + 1 == n ) ? 1.0/3.0 : ( i % 2 ? 4.0/3.0 : 2.0/3.0 );
+      return w;
+    }
+
+    struct SizeQuadrature {
+      VectD radii;
+      VectD weights;//normalised number distribution, summing to 1
+    };
+
+    SizeQuadrature sizeQuadrature( const SANSParticleModel& m, unsigned nRadii )
+    {
+      using SizeDist = SANSParticleModel::SizeDist;
+      SizeQuadrature res;
+      if ( m.sizeDist == SizeDist::Monodisperse ) {
+        res.radii.push_back( m.radius );
+        res.weights.push_back( 1.0 );
+        return res;
+      }
+      //Integrate over u=log(R), in which the number density is n(R)*R:
+      const unsigned n = std::max<unsigned>( 3, nRadii | 1u );
+      double ulow, uhigh;
+      std::function<double(double)> logdensity;
+      if ( m.sizeDist == SizeDist::LogNormal ) {
+        const double umed = std::log( m.radius );
+        const double s = m.width;
+        ulow = umed - 6.0 * s;
+        uhigh = umed + 6.0 * s;
+        logdensity = [umed,s]( double u ) { return -0.5 * ncsquare( ( u - umed ) / s ); };
+      } else {
+        nc_assert_always( m.sizeDist == SizeDist::Schulz );
+        //n(R) ~ R^z*exp(-(z+1)*R/Rmean) with z=1/width^2-1:
+        const double zp1 = 1.0 / ncsquare( m.width );
+        const double rmean = m.radius;
+        ulow = std::log( rmean * std::max<double>( 1e-3, 1.0 - 8.0 * m.width ) );
+        uhigh = std::log( rmean * ( 1.0 + 12.0 * m.width ) );
+        logdensity = [zp1,rmean]( double u ) { return zp1 * ( u - std::exp( u ) / rmean ); };
+      }
+      const double du = ( uhigh - ulow ) / ( n - 1 );
+      VectD w = simpsonWeights( n );
+      VectD logd( n );
+      for ( auto i : ncrange( n ) )
+        logd[i] = logdensity( ulow + i * du );
+      const double logdmax = *std::max_element( logd.begin(), logd.end() );
+      StableSum sum;
+      res.radii.reserve( n );
+      res.weights.reserve( n );
+      for ( auto i : ncrange( n ) ) {
+        res.radii.push_back( std::exp( ulow + i * du ) );
+        res.weights.push_back( w[i] * std::exp( logd[i] - logdmax ) );
+        sum.add( res.weights.back() );
+      }
+      const double norm = 1.0 / sum.sum();
+      for ( auto& e : res.weights )
+        e *= norm;
+      return res;
+    }
+
+    //Characteristic small and large length scales of a population:
+    PairDD lengthScales( const SANSParticleModel& m, const SizeQuadrature& sq )
+    {
+      using Shape = SANSParticleModel::Shape;
+      double rsmall = sq.radii.front();
+      double rlarge = sq.radii.back();
+      if ( m.shape == Shape::CoreShellSphere ) {
+        rsmall = std::min( rsmall, m.shell_thickness );
+        rlarge += m.shell_thickness;
+      } else if ( m.shape == Shape::Cylinder ) {
+        rsmall = std::min( rsmall, 0.5 * m.length );
+        rlarge = std::max( rlarge, 0.5 * m.length );
+      }
+      return { rsmall, rlarge };
+    }
+
+    double particleVolume( const SANSParticleModel& m, double r )
+    {
+      using Shape = SANSParticleModel::Shape;
+      constexpr double k4PiDiv3 = 4.0 * kPi / 3.0;
+      if ( m.shape == Shape::Sphere )
+        return k4PiDiv3 * nccube( r );
+      if ( m.shape == Shape::CoreShellSphere )
+        return k4PiDiv3 * nccube( r + m.shell_thickness );
+      nc_assert( m.shape == Shape::Cylinder );
+      return kPi * r * r * m.length;
+    }
+
+    //Squared amplitude, A(Q)^2 (see notes above):
+    double squaredAmplitude( const SANSParticleModel& m, double r, double q )
+    {
+      using Shape = SANSParticleModel::Shape;
+      if ( m.shape == Shape::Sphere )
+        return ncsquare( particleVolume( m, r ) * sphereAmplitude( q * r ) );
+      constexpr double k4PiDiv3 = 4.0 * kPi / 3.0;
+      if ( m.shape == Shape::CoreShellSphere ) {
+        const double rt = r + m.shell_thickness;
+        return ncsquare( ( m.core_contrast_ratio - 1.0 ) * k4PiDiv3 * nccube( r ) * sphereAmplitude( q * r )
+                         + k4PiDiv3 * nccube( rt ) * sphereAmplitude( q * rt ) );
+      }
+      nc_assert( m.shape == Shape::Cylinder );
+      //Orientational average, with enough points to resolve the oscillations
+      //of the integrand:
+      const double qr = q * r;
+      const double hqL = 0.5 * q * m.length;
+      const double nosc = std::max( qr, hqL ) * kInvPi;
+      const unsigned n = static_cast<unsigned>( ncclamp( 8.0 * nosc, 32.0, 512.0 ) ) | 1u;
+      const double dmu = 1.0 / ( n - 1 );
+      StableSum sum;
+      for ( auto i : ncrange( n ) ) {
+        const double mu = i * dmu;
+        const double w = ( i == 0 || i + 1 == n ) ? 1.0/3.0 : ( i % 2 ? 4.0/3.0 : 2.0/3.0 );
+        const double sinalpha = std::sqrt( std::max( 0.0, 1.0 - mu * mu ) );
+        sum.add( w * ncsquare( twoJ1xDivX( qr * sinalpha ) * sinc( hqL * mu ) ) );
+      }
+      return ncsquare( particleVolume( m, r ) ) * sum.sum() * dmu;
+    }
+
+  }
+}
+
+void NC::SANSParticleModel::validate() const
+{
+  if ( !(radius>0.0) || !(radius<1e6) )
+    NCRYSTAL_THROW2(BadInput,"SANSParticleModel radius value invalid or out of range: "<< radius <<" Aa");
+  if ( sizeDist == SizeDist::LogNormal && ( !(width>0.0) || !(width<=1.5) ) )
+    NCRYSTAL_THROW2(BadInput,"SANSParticleModel width of log-normal distribution must be in (0,1.5]: "<< width );
+  if ( sizeDist == SizeDist::Schulz && ( !(width>0.0) || !(width<1.0) ) )
+    NCRYSTAL_THROW2(BadInput,"SANSParticleModel width of Schulz distribution must be in (0,1): "<< width );
+  if ( shape == Shape::Cylinder && ( !(length>0.0) || !(length<1e7) ) )
+    NCRYSTAL_THROW2(BadInput,"SANSParticleModel cylinder length value invalid or out of range: "<< length <<" Aa");
+  if ( shape == Shape::CoreShellSphere ) {
+    if ( !(shell_thickness>0.0) || !(shell_thickness<1e6) )
+      NCRYSTAL_THROW2(BadInput,"SANSParticleModel shell thickness value invalid or out of range: "<< shell_thickness <<" Aa");
+    if ( !std::isfinite( core_contrast_ratio ) )
+      NCRYSTAL_THROW(BadInput,"SANSParticleModel core contrast ratio must be finite");
+  }
+}
+
+bool NC::SANSParticleModel::operator==( const SANSParticleModel& o ) const
+{
+  return ( shape == o.shape && sizeDist == o.sizeDist && radius == o.radius && width == o.width
+           && length == o.length && shell_thickness == o.shell_thickness
+           && core_contrast_ratio == o.core_contrast_ratio );
+}
+
+struct NC::SANSPolydisperseScatter::Table {
+  VectD q, iofq;
+};
+
+NC::SANSPolydisperseScatter::SANSPolydisperseScatter( SANSScaleFactor sfact,
+                                                      const SANSParticleModel& model,
+                                                      const SANSPolydisperseCfg& cfg )
+  : SANSPolydisperseScatter( PopulationList{ Population{ sfact, model } }, cfg )
+{
+}
+
+NC::SANSPolydisperseScatter::SANSPolydisperseScatter( PopulationList pops,
+                                                      const SANSPolydisperseCfg& cfg )
+  : SANSPolydisperseScatter( pops, cfg, [&pops,&cfg]()
+  {
+    if ( pops.empty() )
+      NCRYSTAL_THROW(BadInput,"SANSPolydisperseScatter needs at least one particle population");
+    if ( cfg.nQ < 10 || cfg.nQ > 1000000 || cfg.nRadii < 3 || cfg.nRadii > 10000 )
+      NCRYSTAL_THROW(BadInput,"SANSPolydisperseScatter: invalid nQ or nRadii values");
+    std::vector<SizeQuadrature> sqs;
+    sqs.reserve( pops.size() );
+    double rsmall = kInfinity;
+    double rlarge = 0.0;
+    for ( auto& p : pops ) {
+      if ( !(p.first.dbl()>=0.0) || !std::isfinite(p.first.dbl()) )
+        NCRYSTAL_THROW2(BadInput,"SANSPolydisperseScatter scale factor invalid: "<< p.first );
+      p.second.validate();
+      sqs.push_back( sizeQuadrature( p.second, cfg.nRadii ) );
+      auto ls = lengthScales( p.second, sqs.back() );
+      rsmall = std::min( rsmall, ls.first );
+      rlarge = std::max( rlarge, ls.second );
+    }
+    //Q grid from well below the Guinier regime, to far enough out in the
+    //~1/Q^4 tails that the remaining contributions to the integral are
+    //negligible (relative contributions ~1e-5):
+    Table t;
+    t.q = logspace( std::log10( 1e-3 / rlarge ), std::log10( 200.0 / rsmall ), cfg.nQ );
+    t.iofq.resize( t.q.size(), 0.0 );
+    for ( auto ip : ncrange( pops.size() ) ) {
+      const auto& m = pops[ip].second;
+      const auto& sq = sqs[ip];
+      StableSum meanvol;
+      for ( auto ir : ncrange( sq.radii.size() ) )
+        meanvol.add( sq.weights[ir] * particleVolume( m, sq.radii[ir] ) );
+      const double scale = pops[ip].first.dbl() / meanvol.sum();
+      for ( auto iq : ncrange( t.q.size() ) ) {
+        StableSum sum;
+        for ( auto ir : ncrange( sq.radii.size() ) )
+          sum.add( sq.weights[ir] * squaredAmplitude( m, sq.radii[ir], t.q[iq] ) );
+        t.iofq[iq] += scale * sum.sum();
+      }
+    }
+    return t;
+  }() )
+{
+}
+
+NC::SANSPolydisperseScatter::SANSPolydisperseScatter( PopulationList pops,
+                                                      const SANSPolydisperseCfg& cfg,
+                                                      Table&& t )
+  : m_populations( std::move(pops) ),
+    m_cfg( cfg ),
+    m_qmin( t.q.front() ),
+    m_iofqmin( t.iofq.front() ),
+    m_iofq( t.q, t.iofq )
+{
+}
+
+NC::CrossSect NC::SANSPolydisperseScatter::crossSectionIsotropic( CachePtr&, NeutronEnergy ekin ) const
+{
+  const double ksq = ekin2ksq( ekin.dbl() );
+  if ( 4.0 * ksq <= m_qmin * m_qmin )
+    return CrossSect{ 2.0 * m_iofqmin };
+  //Correct for the flat Q*I(Q) assumed by IofQHelper below m_qmin (see notes
+  //above):
+  const double integral = m_iofq.calcQIofQIntegral( ekin ) - 0.5 * m_qmin * m_qmin * m_iofqmin;
+  return CrossSect{ std::max( 0.0, integral ) / ksq };
+}
+
+NC::ScatterOutcomeIsotropic NC::SANSPolydisperseScatter::sampleScatterIsotropic( CachePtr&, RNG& rng, NeutronEnergy ekin ) const
+{
+  //Implement as elastic scattering, i.e. sample Q over 0..2k according to Q*I(Q):
+  const double ksq = ekin2ksq( ekin.dbl() );
+  if ( !(ksq>0.0) )
+    return { ekin, CosineScatAngle{1.0} };//Do nothing
+  const double twok = 2.0 * std::sqrt( ksq );
+  const double q = ( twok <= m_qmin
+                     ? twok * std::sqrt( rng.generate() )//Q*I(Q) is linear here
+                     : m_iofq.sampleQValue( rng, ekin ) );
+  double muval = ncclamp( 1.0 - q * q / ( 2.0 * ksq ), -1.0, 1.0 );
+  return { ekin, CosineScatAngle{muval} };
+}
+
+std::shared_ptr<NC::ProcImpl::Process> NC::SANSPolydisperseScatter::createMerged( const Process& oraw,
+                                                                                  double scale_self,
+                                                                                  double scale_other ) const
+{
+  auto optr = dynamic_cast<const SANSPolydisperseScatter*>(&oraw);
+  if ( !optr )
+    return nullptr;
+  PopulationList pops;
+  auto addPops = [&pops]( const PopulationList& pl, double scale )
+  {
+    for ( auto& p : pl ) {
+      const double sf = p.first.dbl() * scale;
+      auto it = std::find_if( pops.begin(), pops.end(),
+                              [&p]( const Population& e ) { return e.second == p.second; } );
+      if ( it != pops.end() )
+        it->first = SANSScaleFactor{ it->first.dbl() + sf };
+      else
+        pops.emplace_back( SANSScaleFactor{ sf }, p.second );
+    }
+  };
+  addPops( m_populations, scale_self );
+  addPops( optr->m_populations, scale_other );
+  return std::make_shared<SANSPolydisperseScatter>( std::move(pops), m_cfg );
+}
+
+NC::Optional<std::string> NC::SANSPolydisperseScatter::specificJSONDescription() const
+{
+  std::ostringstream ss;
+  CachePtr dummy;
+  auto xs_at10Aa = crossSectionIsotropic(dummy, NeutronWavelength{10.0} );
+  {
+    std::ostringstream tmp;
+    tmp << "npopulations="<<m_populations.size()<<";xs@10Aa="<<xs_at10Aa;
+    streamJSONDictEntry( ss, "summarystr", tmp.str(), JSONDictPos::FIRST );
+  }
+  streamJSONDictEntry( ss, "npopulations", m_populations.size() );
+  streamJSONDictEntry( ss, "nQ", m_cfg.nQ );
+  streamJSONDictEntry( ss, "xsAt10Aa", xs_at10Aa.dbl(), JSONDictPos::LAST  );
+  return ss.str();
+}
@@ -27,7 +27,9 @@
 #include "NCrystal/internal/NCString.hh"
 #include "NCrystal/internal/NCOrientUtils.hh"
 #include "NCrystal/internal/NCPlaneProvider.hh"
+#include "NCrystal/internal/NCRuntimeCounters.hh"
 #include <functional>//std::greater
+#include <unordered_map>
 namespace NC=NCrystal;
 
 struct NC::SCBragg::pimpl {
@@ -36,10 +38,19 @@ struct NC::SCBragg::pimpl {
   public:
     //A familiy is here taken to be all planes sharing d-spacing and fsquared.
 
-    std::vector<Vector> deminormals;
+    GaussMos::DemiNormals deminormals;
     double xsfact;// = fsquared / (unit_cell_volume * unit_cell_natoms)
     double inv2d;
 
+    //In compact mode (see setupCompactFamilies) the deminormals are not
+    //stored. Instead the planes are given in groups of symmetry-equivalent
+    //planes, by representative (h,k,l) indices along with their
+    //demi-normals, and masks of the symmetry operations giving distinct
+    //planes when applied to them:
+    std::vector<HKL> reps;
+    GaussMos::DemiNormals repnormals;
+    std::vector<uint32_t> opmasks;
+
     ReflectionFamily(double xsfct, double dspacing) ncnoexceptndebug
       : xsfact(xsfct), inv2d(0.5/dspacing) { nc_assert(xsfct>0&&dspacing>0); }
 
@@ -55,21 +66,106 @@ struct NC::SCBragg::pimpl {
     }
   };
 
-  typedef std::map<std::pair<uint64_t,uint64_t>,std::vector<Vector>,
-                   std::greater<std::pair<uint64_t,uint64_t> > > SCBraggSortMap;
+  typedef std::pair<uint64_t,uint64_t> FamilyKey;//discretised (dspacing,fsquared)
+  typedef std::map<FamilyKey,std::vector<Vector>,std::greater<FamilyKey>,
+                   MemPoolAllocator<std::pair<const FamilyKey,std::vector<Vector>>> > SCBraggSortMap;
+  typedef std::map<FamilyKey,std::vector<HKL>,std::greater<FamilyKey>,
+                   MemPoolAllocator<std::pair<const FamilyKey,std::vector<HKL>>> > SCBraggCompactSortMap;
+  typedef std::map<uint64_t,double,std::less<uint64_t>,
+                   MemPoolAllocator<std::pair<const uint64_t,double>> > SCBraggOrigValMap;
+  class FamilyKeys;
 
   pimpl( const NC::Info&, MosaicityFWHM, double dd,
          const SCOrientation&, PlaneProvider * plane_provider,
-         double prec, double ntrunc );
+         double prec, double ntrunc, double screening );
 
   double setupFamilies( const Info& cinfo,
+                        const RotMatrix& reci_lattice,
                         const RotMatrix& cry2lab,
                         PlaneProvider * plane_provider,
                         double V0numAtom );
 
+  //The compact representation stores just a representative of each group of
+  //symmetry-equivalent planes (reducing memory usage by the multiplicity of
+  //the groups). Candidate planes are found by testing the representatives
+  //against the neutron direction transformed by each of the symmetry
+  //operations, and only the demi-normals of the candidates are computed,
+  //exactly as in the normal representation. This is only possible if the
+  //plane provider provides symmetry groups, and returns false (leaving
+  //m_reflfamilies empty) if it turns out to be unsuitable:
+  bool setupCompactFamilies( const RotMatrix& reci_lattice,
+                             const RotMatrix& cry2lab,
+                             PlaneProvider * plane_provider,
+                             double V0numAtom,
+                             double& maxdspacing );
+  static uint32_t opMask( Span<const EqRefl::SymOp>, const HKL& );
+  Vector labDemiNormal( const HKL& hkl ) const
+  {
+    //NB: Same calculation as in the standard plane provider and setupFamilies:
+    Vector v = m_reci_lattice * Vector( hkl.h, hkl.k, hkl.l );
+    v.normalise();
+    return m_cry2lab * v;
+  }
+
+  class NormalIndex {
+  public:
+    //Index of the demi-normals of all families, based on the positions of the
+    //corresponding reciprocal lattice vectors, G=2*inv2d*normal, in a uniform
+    //grid of cells. Cells are ordered so the cells in a given (x,y) column are
+    //contiguous in z, and normals (and their inv2d values) are copied into
+    //arrays in that order. Demi-normals are identified by a global index,
+    //counting through all families in order.
+    void init( const std::vector<ReflectionFamily>& );
+    bool empty() const { return m_cellBegin.empty(); }
+    std::size_t nnormals() const { return m_gidx.size(); }
+    //Global index of first demi-normal in family ifam:
+    std::size_t familyBegin( std::size_t ifam ) const { return m_famBegin[ifam]; }
+
+    //Set bits in the bitmap (of nnormals() bits) for (at least) all
+    //demi-normals which might contribute for a neutron with the given
+    //direction and wavelength. Those are normals within the truncation angle
+    //ta of the Bragg condition, ||cos(angle(normal,dir))|-wl*inv2d|<ta (ta
+    //should include a margin for numerical imprecision):
+    void markCandidates( const Vector& dir, double wl, double inv2dcutoff,
+                         double ta, uint64_t* bitmap ) const;
+  private:
+    double m_gmin = 0.0;
+    double m_gmax = 0.0;
+    double m_h = 1.0;
+    double m_invh = 1.0;
+    int m_nd = 0;
+    std::vector<uint32_t> m_cellBegin;
+    VectD m_nx, m_ny, m_nz, m_inv2d;
+    std::vector<uint32_t> m_gidx;
+    std::vector<std::size_t> m_famBegin;
+    void markShell( const Vector& centre, double rmin, double rmax, double wl,
+                    const Vector& dir, double ta, uint64_t* bitmap ) const;
+    void markSlice( std::size_t ibegin, std::size_t iend, double wl,
+                    const Vector& dir, double ta, uint64_t* bitmap ) const;
+  public:
+    std::size_t memoryFootprint() const
+    {
+      return ( m_cellBegin.capacity() + m_gidx.capacity() ) * sizeof(uint32_t)
+        + ( m_nx.capacity() + m_ny.capacity() + m_nz.capacity() + m_inv2d.capacity() ) * sizeof(double)
+        + m_famBegin.capacity() * sizeof(std::size_t);
+    }
+  };
+
+  typedef std::array<int64_t,4> MemoKey;//discretised (log(wl),ux,uy,uz)
+  struct MemoKeyHash {
+    std::size_t operator()( const MemoKey& k ) const { return hashContainer( k ); }
+  };
+
   class Cache : public CacheBase {
   public:
-    void invalidateCache() override { ekin = -1.0; }
+    void invalidateCache() override
+    {
+      ekin = -1.0;
+      band_margin = -1.0;
+      memo.clear();
+      if ( memoEval )
+        memoEval->invalidateCache();
+    }
     //cache signature:
     double ekin = -1.0;//Start with invalid cache
     Vector dir;
@@ -77,23 +173,111 @@ struct NC::SCBragg::pimpl {
     double wl;
     VectD xs_commul;
     std::vector<GaussMos::ScatCache> scatcache;
+    //Candidate normals at the current energy, as pairs of (family index, end
+    //position in band_idx) and indices within the families. If band_margin>0,
+    //they include all normals which can contribute for any direction within
+    //a distance of band_margin from band_dir:
+    std::vector<std::pair<uint32_t,uint32_t>> band_fam;
+    std::vector<uint32_t> band_idx;
+    Vector band_dir;
+    double band_margin = -1.0;
+    //work buffer for index lookups:
+    std::vector<uint64_t> bitmap;
+    //In compact mode, band_idx refers to the candidate demi-normals in
+    //band_normals, and candidates are collected in band_cands:
+    GaussMos::DemiNormals band_normals;
+    std::vector<HKL> band_cands;
+    //Memoised cross sections (if enabled), and the cache object used for
+    //evaluating them (leaving the above untouched for sampling):
+    std::unordered_map<MemoKey,double,MemoKeyHash> memo;
+    std::unique_ptr<Cache> memoEval;
+    //Work buffers for sampleScatterInCone:
+    VectD cone_commul;
+    std::vector<uint32_t> cone_idx;
   };
+  double memoisedCrossSection( Cache&, NeutronEnergy, const Vector& ) const;
+  double m_memoTol = 0.0;//disabled if 0
+  std::size_t m_memoMaxEntries = 4096;
 
   void genScat( Cache&, RNG&, Vector& outdir ) const;
+  double genScatInCone( Cache&, RNG&, const Vector& conedir, double halfangle, Vector& outdir ) const;
   void updateCache( Cache&, NeutronEnergy, const Vector& ) const;
+  bool useIndex( double inv2dcutoff ) const;
+  //Fill band_fam and band_idx with (at least) all normals within ta of the
+  //Bragg condition for the given direction (not touching band_dir and
+  //band_margin), and evaluate the cross sections of the candidates:
+  void collectBand( Cache&, const Vector& dir, double inv2dcutoff, double ta ) const;
+  void collectBandCompact( Cache&, const Vector& dir, double inv2dcutoff, double ta ) const;
+  void collectBandHot( Cache&, const Vector& dir, double inv2dcutoff, double ta ) const;
+  void scanFamilies( Cache&, const Vector& dir, double inv2dcutoff, double ta, std::size_t ifambegin ) const;
+  void evaluateBand( Cache& ) const;
+
+  //The demi-normals of the leading families (those with the largest
+  //d-spacings, which can scatter neutrons in the widest range of wavelengths
+  //and therefore account for most of the work in a typical spectrum), copied
+  //into flat arrays along with their inv2d values and family indices. They can
+  //then be tested for the Bragg condition in a single vectorisable loop across
+  //families, only entering the per-family loops for the remaining (cold)
+  //families at wavelengths short enough for any of them to contribute:
+  struct HotNormals {
+    VectD nx, ny, nz, inv2d;
+    std::vector<uint32_t> fam, idx;
+    std::size_t nfam = 0;//number of families included
+    bool empty() const { return fam.empty(); }
+    std::size_t memoryFootprint() const
+    {
+      return ( nx.capacity() + ny.capacity() + nz.capacity() + inv2d.capacity() ) * sizeof(double)
+        + ( fam.capacity() + idx.capacity() ) * sizeof(uint32_t);
+    }
+  };
+  HotNormals m_hot;
+  void initHotNormals( std::size_t maxnormals );
+
+  //Candidate normals for neutrons inside a direction cone and wavelength
+  //range (see SCBragg::prepareForDirectionCone), in the same format as the
+  //band candidates in the cache. They include all normals within ta of the
+  //Bragg condition for any such neutron:
+  struct DirectionCone {
+    Vector dir;
+    double chord;//max distance from dir to unit vectors in the cone
+    double wlmin, wlmax, ta;
+    std::vector<std::pair<uint32_t,uint32_t>> fam;
+    std::vector<uint32_t> idx;
+  };
+  Optional<DirectionCone> m_cone;
+  bool coneCovers( const Vector& dir, double wl, double ta ) const
+  {
+    return m_cone.has_value() && ta <= m_cone.value().ta
+      && wl >= m_cone.value().wlmin && wl <= m_cone.value().wlmax
+      && ( dir - m_cone.value().dir ).mag2() <= ncsquare( m_cone.value().chord );
+  }
 
   double m_threshold_ekin;
+  double m_discardedFraction = 0.0;//as reported by the plane provider
   std::vector<ReflectionFamily> m_reflfamilies;
+  GaussMos::DemiNormals::Arena m_normalsArena;//data of all deminormals and repnormals
   GaussMos m_gm;
+  NormalIndex m_normalIndex;//only initialised when useful
+  double m_indexShellAngle = 0.0;
+  double m_bandMargin = 0.0;
+  bool m_compact = false;
+  std::vector<EqRefl::SymOp> m_symops;//only in compact mode
+  VectD m_symopsLabT;//only in compact mode
+  RotMatrix m_reci_lattice, m_cry2lab;//only in compact mode
 };
 
 NC::SCBragg::pimpl::pimpl(const NC::Info& cinfo, MosaicityFWHM mosaicity,
                           double dd, const SCOrientation& sco, PlaneProvider * plane_provider,
-                          double prec, double ntrunc)
+                          double prec, double ntrunc, double screening)
   : m_threshold_ekin(kInfinity),
     m_gm(mosaicity,prec,ntrunc)
 {
   m_gm.setDSpacingSpread(dd);
+  m_gm.setScreening(screening);
+  m_memoTol = ncgetenv_dbl("SCBRAGG_XSMEMO_TOL",0.0);
+  m_memoMaxEntries = static_cast<std::size_t>( std::max<int>( 1, ncgetenv_int("SCBRAGG_XSMEMO_SIZE",4096) ) );
+  if ( !( m_memoTol >= 0.0 && m_memoTol <= 0.01 ) )
+    NCRYSTAL_THROW(BadInput,"Invalid value of NCRYSTAL_SCBRAGG_XSMEMO_TOL (must be in [0,0.01])");
 
   //Always needs structure info:
   if (!cinfo.hasStructureInfo())
@@ -104,10 +288,255 @@ NC::SCBragg::pimpl::pimpl(const NC::Info& cinfo, MosaicityFWHM mosaicity,
   RotMatrix cry2lab = getCrystal2LabRot( sco, reci_lattice );
   double V0numAtom = cinfo.getStructureInfo().n_atoms * cinfo.getStructureInfo().volume;
 
-  double maxdsp = setupFamilies( cinfo, cry2lab, plane_provider, V0numAtom );
+  double maxdsp = setupFamilies( cinfo, reci_lattice, cry2lab, plane_provider, V0numAtom );
+  if ( plane_provider )
+    m_discardedFraction = plane_provider->discardedFraction();
+
+  //The demi-normals are now complete, so relocate them into a single block:
+  {
+    std::vector<GaussMos::DemiNormals*> dns;
+    dns.reserve( 2 * m_reflfamilies.size() );
+    for ( auto& fam : m_reflfamilies ) {
+      dns.push_back( &fam.deminormals );
+      dns.push_back( &fam.repnormals );
+    }
+    m_normalsArena = GaussMos::DemiNormals::pack( dns );
+  }
 
   m_threshold_ekin = wl2ekin(maxdsp * 2.0);
 
+  //With many demi-normals and a narrow truncation window, only a small
+  //fraction of the normals can contribute for a given neutron. In that case,
+  //use an index to find the candidates rather than scanning all normals. The
+  //angular margin added to the truncation (or screening) angle protects
+  //against numerical imprecision in the GaussMos truncation tests:
+  std::size_t nnormals(0);
+  for ( auto& fam : m_reflfamilies )
+    nnormals += fam.deminormals.size();
+  m_indexShellAngle = m_gm.mosaicityScreeningAngle() + 1e-6;
+  if ( nnormals >= 4096 && m_indexShellAngle < 0.05 && !ncgetenv_bool("SCBRAGG_NOINDEX") )
+    m_normalIndex.init( m_reflfamilies );
+
+  //Flat array of the demi-normals in the leading families (for a size of 0,
+  //set with NCRYSTAL_SCBRAGG_HOTSIZE, all families are scanned one by one).
+  //Like for the index, this only pays off when most normals are rejected by
+  //the truncation test:
+  const int hotsize = ncgetenv_int("SCBRAGG_HOTSIZE",4096);
+  if ( hotsize < 0 )
+    NCRYSTAL_THROW(BadInput,"Invalid value of NCRYSTAL_SCBRAGG_HOTSIZE (must be >=0)");
+  if ( !m_compact && hotsize > 0 && m_indexShellAngle < 0.05 )
+    initHotNormals( static_cast<std::size_t>( hotsize ) );
+
+  //Maximal change of direction (as the distance between unit vectors) for
+  //which a list of candidate normals can be reused for subsequent updates at
+  //the same energy:
+  m_bandMargin = std::min<double>( m_gm.mosaicityTruncationAngle(), 0.05 );
+}
+
+void NC::SCBragg::pimpl::initHotNormals( std::size_t maxnormals )
+{
+  //Include complete families, as long as the total does not exceed
+  //maxnormals. With a single family there is no per-family overhead to save:
+  std::size_t nfam(0), ntot(0);
+  for ( auto& fam : m_reflfamilies ) {
+    if ( ntot + fam.deminormals.size() > maxnormals )
+      break;
+    ntot += fam.deminormals.size();
+    ++nfam;
+  }
+  if ( nfam < 2 )
+    return;
+  m_hot.nfam = nfam;
+  m_hot.nx.reserve( ntot );
+  m_hot.ny.reserve( ntot );
+  m_hot.nz.reserve( ntot );
+  m_hot.inv2d.reserve( ntot );
+  m_hot.fam.reserve( ntot );
+  m_hot.idx.reserve( ntot );
+  for ( auto ifam : ncrange( nfam ) ) {
+    const ReflectionFamily& fam = m_reflfamilies[ifam];
+    for ( auto i : ncrange( fam.deminormals.size() ) ) {
+      const Vector n = fam.deminormals[i];
+      m_hot.nx.push_back( n[0] );
+      m_hot.ny.push_back( n[1] );
+      m_hot.nz.push_back( n[2] );
+      m_hot.inv2d.push_back( fam.inv2d );
+      m_hot.fam.push_back( static_cast<uint32_t>( ifam ) );
+      m_hot.idx.push_back( static_cast<uint32_t>( i ) );
+    }
+  }
+}
+
+void NC::SCBragg::pimpl::NormalIndex::init( const std::vector<ReflectionFamily>& families )
+{
+  m_famBegin.clear();
+  m_famBegin.reserve( families.size() + 1 );
+  std::size_t n(0);
+  for ( auto& fam : families ) {
+    m_famBegin.push_back( n );
+    n += fam.deminormals.size();
+  }
+  m_famBegin.push_back( n );
+  nc_assert_always( n < std::numeric_limits<uint32_t>::max() );
+  if ( !n )
+    return;
+
+  //Families are sorted by increasing value of inv2d, so the last one has the
+  //longest G vectors. Cells are kept rather coarse, since the normals in the
+  //visited cells are tested in a fast vectorised loop anyway, while the
+  //per-column overhead of a lookup grows with the number of cells:
+  m_gmax = 2.0 * families.back().inv2d * ( 1.0 + 1e-9 );
+  m_nd = ncclamp( static_cast<int>( std::cbrt( n / 8.0 ) ), 4, 64 );
+  m_gmin = -m_gmax;
+  m_h = 2.0 * m_gmax / m_nd;
+  m_invh = 1.0 / m_h;
+
+  auto coordIdx = [this]( double x )
+  {
+    return ncclamp( static_cast<int>( std::floor( ( x - m_gmin ) * m_invh ) ), 0, m_nd - 1 );
+  };
+
+  //Bin entries with a counting sort (keeping increasing order within cells):
+  std::vector<uint32_t> cellIdx;
+  cellIdx.reserve( n );
+  const std::size_t ncells = std::size_t(m_nd) * m_nd * m_nd;
+  m_cellBegin.clear();
+  m_cellBegin.resize( ncells + 1, 0 );
+  for ( auto& fam : families ) {
+    const double g = 2.0 * fam.inv2d;
+    for ( auto i : ncrange( fam.deminormals.size() ) ) {
+      const Vector G = fam.deminormals[i] * g;
+      const std::size_t ic = ( std::size_t( coordIdx( G[0] ) ) * m_nd + coordIdx( G[1] ) ) * m_nd + coordIdx( G[2] );
+      cellIdx.push_back( static_cast<uint32_t>( ic ) );
+      ++m_cellBegin[ic+1];
+    }
+  }
+  for ( auto ic : ncrange( ncells ) )
+    m_cellBegin[ic+1] += m_cellBegin[ic];
+  m_nx.resize( n );
+  m_ny.resize( n );
+  m_nz.resize( n );
+  m_inv2d.resize( n );
+  m_gidx.resize( n );
+  std::vector<uint32_t> fillPos( m_cellBegin.begin(), std::prev( m_cellBegin.end() ) );
+  std::size_t k(0);
+  for ( auto& fam : families ) {
+    for ( auto i : ncrange( fam.deminormals.size() ) ) {
+      const uint32_t pos = fillPos[ cellIdx[k] ]++;
+      const Vector nv = fam.deminormals[i];
+      m_nx[pos] = nv[0];
+      m_ny[pos] = nv[1];
+      m_nz[pos] = nv[2];
+      m_inv2d[pos] = fam.inv2d;
+      m_gidx[pos] = static_cast<uint32_t>( k++ );
+    }
+  }
+}
+
+void NC::SCBragg::pimpl::NormalIndex::markCandidates( const Vector& dir, double wl, double inv2dcutoff,
+                                                      double ta, uint64_t* bitmap ) const
+{
+  //For the G vectors, the Bragg condition means ||G-c|^2-R^2|<2*R*ta*|G|,
+  //with R=1/wl and c=+-R*dir (i.e. the two Ewald spheres), so G must be in
+  //the spherical shells where |G-c| is in R+-2*ta*min(2R,Gmax):
+  nc_assert( !empty() );
+  const double R = 1.0 / wl;
+  const double w = 2.0 * ta * std::min<double>( m_gmax, 2.0 * inv2dcutoff );
+  markShell( dir * R, R - w, R + w, wl, dir, ta, bitmap );
+  markShell( dir * (-R), R - w, R + w, wl, dir, ta, bitmap );
+}
+
+void NC::SCBragg::pimpl::NormalIndex::markSlice( std::size_t ibegin, std::size_t iend, double wl,
+                                                 const Vector& dir, double ta, uint64_t* bitmap ) const
+{
+  //Test normals in chunks, first with a vectorisable loop:
+  const double ux = dir[0];
+  const double uy = dir[1];
+  const double uz = dir[2];
+  constexpr std::size_t chunksize = 64;
+  double accept[chunksize];
+  for ( std::size_t ichunk = ibegin; ichunk < iend; ichunk += chunksize ) {
+    const std::size_t m = std::min<std::size_t>( chunksize, iend - ichunk );
+    const double * cx = m_nx.data() + ichunk;
+    const double * cy = m_ny.data() + ichunk;
+    const double * cz = m_nz.data() + ichunk;
+    const double * ci = m_inv2d.data() + ichunk;
+    for ( std::size_t i = 0; i < m; ++i ) {
+      const double dot = cx[i]*ux+cy[i]*uy+cz[i]*uz;
+      accept[i] = ( ncabs( ncabs( dot ) - wl * ci[i] ) < ta ? 1.0 : 0.0 );
+    }
+    const uint32_t * cg = m_gidx.data() + ichunk;
+    for ( std::size_t i = 0; i < m; ++i ) {
+      if ( accept[i] )
+        bitmap[ cg[i] >> 6 ] |= ( uint64_t(1) << ( cg[i] & 63 ) );
+    }
+  }
+}
+
+void NC::SCBragg::pimpl::NormalIndex::markShell( const Vector& c, double rmin, double rmax, double wl,
+                                                 const Vector& dir, double ta, uint64_t* bitmap ) const
+{
+  nc_assert( rmax >= rmin );
+  //Inflate the shell slightly, to be safe against rounding:
+  const double eps = 1e-9 * m_gmax;
+  rmin = std::max<double>( 0.0, rmin - eps );
+  rmax += eps;
+  const double rmin_sq = rmin * rmin;
+  const double rmax_sq = rmax * rmax;
+  auto cellCoord = [this]( double x )
+  {
+    //NB: Clamp before converting to int, since x might be far outside the grid:
+    return static_cast<int>( ncclamp( std::floor( ( x - m_gmin ) * m_invh ), -1.0, double(m_nd) ) );
+  };
+  auto idxLow = [this,&cellCoord]( double x ) { return std::max<int>( 0, cellCoord( x ) ); };
+  auto idxHigh = [this,&cellCoord]( double x ) { return std::min<int>( m_nd - 1, cellCoord( x ) ); };
+  //Min and max distance from c[coord] to points in cell i:
+  auto distRange = [this]( double c_coord, int i, double& dmin, double& dmax )
+  {
+    const double lo = m_gmin + i * m_h;
+    const double hi = lo + m_h;
+    dmin = ( c_coord < lo ? lo - c_coord : ( c_coord > hi ? c_coord - hi : 0.0 ) );
+    dmax = std::max<double>( ncabs( c_coord - lo ), ncabs( c_coord - hi ) );
+  };
+  auto markCells = [this,wl,&dir,ta,bitmap]( std::size_t colbase, int iz0, int iz1 )
+  {
+    if ( iz0 <= iz1 )
+      markSlice( m_cellBegin[colbase + iz0], m_cellBegin[colbase + iz1 + 1], wl, dir, ta, bitmap );
+  };
+
+  const int ix0 = idxLow( c[0] - rmax );
+  const int ix1 = idxHigh( c[0] + rmax );
+  for ( int ix = ix0; ix <= ix1; ++ix ) {
+    double dxmin, dxmax;
+    distRange( c[0], ix, dxmin, dxmax );
+    if ( dxmin * dxmin > rmax_sq )
+      continue;
+    const double ry = std::sqrt( rmax_sq - dxmin * dxmin );
+    const int iy0 = idxLow( c[1] - ry );
+    const int iy1 = idxHigh( c[1] + ry );
+    for ( int iy = iy0; iy <= iy1; ++iy ) {
+      double dymin, dymax;
+      distRange( c[1], iy, dymin, dymax );
+      const double dxymin_sq = dxmin * dxmin + dymin * dymin;
+      if ( dxymin_sq > rmax_sq )
+        continue;
+      const double dxymax_sq = dxmax * dxmax + dymax * dymax;
+      //Points of the shell in this column have z in c[2]+-[zin,zout]:
+      const double zout = std::sqrt( rmax_sq - dxymin_sq );
+      const double zin = ( rmin_sq > dxymax_sq ? std::sqrt( rmin_sq - dxymax_sq ) : 0.0 );
+      const std::size_t colbase = ( std::size_t(ix) * m_nd + iy ) * m_nd;
+      const int izA0 = idxLow( c[2] - zout );
+      const int izA1 = idxHigh( c[2] - zin );
+      const int izB0 = idxLow( c[2] + zin );
+      const int izB1 = idxHigh( c[2] + zout );
+      if ( izA1 + 1 >= izB0 ) {
+        markCells( colbase, izA0, izB1 );
+      } else {
+        markCells( colbase, izA0, izA1 );
+        markCells( colbase, izB0, izB1 );
+      }
+    }
+  }
 }
 
 NC::SCBragg::SCBragg( const NC::Info& cinfo,
@@ -115,14 +544,60 @@ NC::SCBragg::SCBragg( const NC::Info& cinfo,
                       MosaicityFWHM mosaicity,
                       double dd,
                       PlaneProvider * plane_provider,
-                      double prec, double ntrunc)
-  : m_pimpl(std::make_unique<pimpl>(cinfo,mosaicity,dd,sco,plane_provider,prec,ntrunc))
+                      double prec, double ntrunc, double screening)
+  : m_pimpl(std::make_unique<pimpl>(cinfo,mosaicity,dd,sco,plane_provider,prec,ntrunc,screening))
 {
 }
 
 NC::SCBragg::~SCBragg() = default;
 
+class NC::SCBragg::pimpl::FamilyKeys {
+public:
+  //Planes are collected into families sorted by (dsp,fsq). To avoid issues
+  //connected to floating point number keys, we store dspacing/fsquared as
+  //integers, keeping precision down to 1e-10 angstrom and 1e-10 barn
+  //respectively, but also try to avoid rounding issues when floating point
+  //values are not misbehaving:
+  FamilyKeys( MemPool& pool ) : m_origvals_dsp(MemPoolAllocator<void>(&pool)), m_origvals_fsq(MemPoolAllocator<void>(&pool)) {}
+
+  FamilyKey key( double dspacing, double fsq )
+  {
+    nc_assert(dspacing>0.0&&fsq>0.0&&dspacing<1e7&&fsq<1e7);
+    uint64_t ui_dsp = (uint64_t)(dspacing*two30+0.5);
+    uint64_t ui_fsq = (uint64_t)(fsq*two30+0.5);
+    //a bit messy, but nice to preserve values when possible:
+    registerOrigVal( m_origvals_dsp, ui_dsp, dspacing );
+    registerOrigVal( m_origvals_fsq, ui_fsq, fsq );
+    return { ui_dsp, ui_fsq };
+  }
+
+  double dspacing( const FamilyKey& k ) const { return origVal( m_origvals_dsp, k.first ); }
+  double fsq( const FamilyKey& k ) const { return origVal( m_origvals_fsq, k.second ); }
+
+private:
+  static constexpr double two30 = 1073741824.0;//2^30 ~= 1.07e9
+  SCBraggOrigValMap m_origvals_dsp, m_origvals_fsq;
+  static void registerOrigVal( SCBraggOrigValMap& m, uint64_t ui, double val )
+  {
+    SCBraggOrigValMap::iterator itOrig = m.find(ui);
+    if (itOrig==m.end()) {
+      m[ui] = val;
+    } else if (ncabs(val-itOrig->second)>1e-12) {
+      itOrig->second = -1;//multiple values observed ...!
+    }
+  }
+  static double origVal( const SCBraggOrigValMap& m, uint64_t ui )
+  {
+    SCBraggOrigValMap::const_iterator itOrig = m.find(ui);
+    nc_assert(itOrig!=m.end());
+    return (itOrig->second > 0 ? itOrig->second : ui / two30);
+  }
+};
+
+constexpr double NC::SCBragg::pimpl::FamilyKeys::two30;
+
 double NC::SCBragg::pimpl::setupFamilies( const NC::Info& cinfo,
+                                          const NC::RotMatrix& reci_lattice,
                                           const NC::RotMatrix& cry2lab,
                                           NC::PlaneProvider * plane_provider,
                                           double V0numAtom )
@@ -132,16 +607,6 @@ double NC::SCBragg::pimpl::setupFamilies( const NC::Info& cinfo,
   nc_assert_always(cinfo.hasStructureInfo());
   nc_assert(m_reflfamilies.empty());
 
-  //collect all planes, sorted by (dsp,fsq). To avoid issues connected to
-  //floating point number keys, we store dspacing/fsquared as integers, keeping
-  //precision down to 1e-10 angstrom and 1e-10 barn respectively.
-  SCBraggSortMap planes;
-  //but also try to avoid rounding issues when floating point values are not misbehaving:
-  std::map<uint64_t,double> origvals_dsp;
-  std::map<uint64_t,double> origvals_fsq;
-
-  const double two30 = 1073741824.0;//2^30 ~= 1.07e9
-
   std::unique_ptr<PlaneProvider> ppguard;
   if (!plane_provider) {
     //fall back to standard plane provider
@@ -153,6 +618,29 @@ double NC::SCBragg::pimpl::setupFamilies( const NC::Info& cinfo,
     plane_provider->prepareLoop();
   }
 
+  //Use the compact representation when the planes are available in symmetry
+  //groups, and there are so many demi-normals (or SCBRAGG_COMPACT is set)
+  //that memory usage is more of a concern than the speed of the normal index:
+  if ( plane_provider->symmetry() ) {
+    std::size_t nnormals(0);
+    Optional<PlaneProvider::SymGroup> opt_group;
+    while ( ( opt_group = plane_provider->getNextSymGroup() ).has_value() )
+      nnormals += opt_group.value().ndeminormals;
+    plane_provider->prepareLoop();
+    if ( nnormals >= 16777216 || ncgetenv_bool("SCBRAGG_COMPACT") ) {
+      double maxdspacing(0);
+      if ( setupCompactFamilies( reci_lattice, cry2lab, plane_provider, V0numAtom, maxdspacing ) )
+        return maxdspacing;
+      plane_provider->prepareLoop();
+    }
+  }
+
+  //collect all planes into families (the temporary maps take their nodes from
+  //a common memory pool):
+  MemPool pool;
+  FamilyKeys keys(pool);
+  SCBraggSortMap planes{ MemPoolAllocator<void>(&pool) };
+
   double maxdspacing(0);
 
   Optional<PlaneProvider::Plane> opt_plane;
@@ -161,31 +649,13 @@ double NC::SCBragg::pimpl::setupFamilies( const NC::Info& cinfo,
     if (pl.dspacing>maxdspacing)
       maxdspacing = pl.dspacing;
 
-    nc_assert(pl.dspacing>0.0&&pl.fsq>0.0&&pl.dspacing<1e7&&pl.fsq<1e7);
-    uint64_t ui_dsp = (uint64_t)(pl.dspacing*two30+0.5);
-    uint64_t ui_fsq = (uint64_t)(pl.fsq*two30+0.5);
-
-    //a bit messy, but nice to preserve values when possible:
-    std::map<uint64_t,double>::iterator itOrig = origvals_dsp.find(ui_dsp);
-    if (itOrig==origvals_dsp.end()) {
-      origvals_dsp[ui_dsp] = pl.dspacing;
-    } else if (ncabs(pl.dspacing-itOrig->second)>1e-12) {
-      itOrig->second = -1;//multiple values observed ...!
-    }
-    itOrig = origvals_fsq.find(ui_fsq);
-    if (itOrig==origvals_fsq.end()) {
-      origvals_fsq[ui_fsq] = pl.fsq;
-    } else if (ncabs(pl.fsq-itOrig->second)>1e-12) {
-      itOrig->second = -1;//multiple values observed ...!
-    }
-
-    std::pair<uint64_t,uint64_t> key(ui_dsp,ui_fsq);
+    FamilyKey key = keys.key( pl.dspacing, pl.fsq );
 
     SCBraggSortMap::iterator it = planes.find(key);
     if ( it != planes.end() ) {
       it->second.push_back(pl.demi_normal);
     } else {
-      std::pair<PairDD,std::vector<Vector> > newentry;
+      std::pair<FamilyKey,std::vector<Vector> > newentry;
       newentry.first = key;
       newentry.second.push_back(pl.demi_normal);
       planes.insert(it,newentry);
@@ -196,15 +666,7 @@ double NC::SCBragg::pimpl::setupFamilies( const NC::Info& cinfo,
   SCBraggSortMap::const_iterator it = planes.begin();
   for (;it!=planes.end();++it) {
 
-    std::map<uint64_t,double>::iterator itOrig = origvals_dsp.find(it->first.first);
-    nc_assert(itOrig!=origvals_dsp.end());
-    const double dsp = (itOrig->second > 0 ? itOrig->second : it->first.first / two30);
-
-    itOrig = origvals_fsq.find(it->first.second);
-    nc_assert(itOrig!=origvals_fsq.end());
-    const double fsq = (itOrig->second > 0 ? itOrig->second : it->first.second / two30);
-
-    m_reflfamilies.emplace_back(fsq/V0numAtom,dsp);
+    m_reflfamilies.emplace_back(keys.fsq(it->first)/V0numAtom,keys.dspacing(it->first));
 
     //transfer it->second into final vector and put in the lab frame:
     ReflectionFamily& fam = m_reflfamilies.back();
@@ -218,6 +680,103 @@ double NC::SCBragg::pimpl::setupFamilies( const NC::Info& cinfo,
   return maxdspacing;
 }
 
+bool NC::SCBragg::pimpl::setupCompactFamilies( const NC::RotMatrix& reci_lattice,
+                                                const NC::RotMatrix& cry2lab,
+                                                NC::PlaneProvider * plane_provider,
+                                                double V0numAtom,
+                                                double& maxdspacing )
+{
+  nc_assert(m_reflfamilies.empty());
+  const EqRefl * sym = plane_provider->symmetry();
+  nc_assert_always( sym != nullptr );
+  auto symops = sym->symmetryOperations();
+  nc_assert_always( !symops.empty() && symops.size() <= 32 );
+
+  //The symmetry operations in the lab frame, Q=M*S*M^-1 with M the
+  //transformation from (h,k,l) to lab frame coordinates. These should be
+  //orthogonal, unless the lattice parameters are inconsistent with the
+  //symmetry (in which case we refrain from using the compact
+  //representation). We keep the transposed matrices, since they transform the
+  //neutron direction u so that n0.(Q^T u)=(Q n0).u for demi-normals n0:
+  Matrix M = cry2lab * reci_lattice;
+  Matrix Minv = M.getInv();
+  VectD opsLabT;
+  opsLabT.reserve( 9 * symops.size() );
+  for ( auto& op : symops ) {
+    double sdata[9];
+    for ( auto i : ncrange( 9 ) )
+      sdata[i] = op.m[i];
+    Matrix QT = ~( M * Matrix( 3, 3, sdata ) * Minv );
+    Matrix QTQ = QT * ~QT;
+    for ( auto i : ncrange( 3u ) )
+      for ( auto j : ncrange( 3u ) )
+        if ( ncabs( QTQ[i][j] - ( i == j ? 1.0 : 0.0 ) ) > 1e-9 )
+          return false;
+    for ( auto i : ncrange( 3u ) )
+      for ( auto j : ncrange( 3u ) )
+        opsLabT.push_back( QT[i][j] );
+  }
+
+  MemPool pool;
+  FamilyKeys keys(pool);
+  SCBraggCompactSortMap groups{ MemPoolAllocator<void>(&pool) };
+
+  maxdspacing = 0.0;
+  Optional<PlaneProvider::SymGroup> opt_group;
+  while ( ( opt_group = plane_provider->getNextSymGroup() ).has_value() ) {
+    auto& g = opt_group.value();
+    if (g.dspacing>maxdspacing)
+      maxdspacing = g.dspacing;
+    FamilyKey key = keys.key( g.dspacing, g.fsq );
+    auto it = groups.find(key);
+    if ( it == groups.end() )
+      it = groups.insert( it, std::make_pair( key, std::vector<HKL>() ) );
+    it->second.push_back( EqRefl::normalise( g.hkl ) );
+    //Check that the number of distinct planes is as expected:
+    uint32_t mask = opMask( symops, it->second.back() );
+    std::size_t nbits(0);
+    for ( ; mask; mask &= mask - 1 )
+      ++nbits;
+    if ( nbits != g.ndeminormals ) {
+      m_reflfamilies.clear();
+      return false;
+    }
+  }
+
+  m_compact = true;
+  m_symops.assign( symops.begin(), symops.end() );
+  m_symopsLabT = std::move( opsLabT );
+  m_reci_lattice = RotMatrix( Matrix( MatrixAllowCopy, reci_lattice ) );
+  m_cry2lab = RotMatrix( Matrix( MatrixAllowCopy, cry2lab ) );
+
+  m_reflfamilies.reserve(groups.size());
+  for ( auto& e : groups ) {
+    m_reflfamilies.emplace_back(keys.fsq(e.first)/V0numAtom,keys.dspacing(e.first));
+    ReflectionFamily& fam = m_reflfamilies.back();
+    fam.reps.reserve( e.second.size() );
+    fam.repnormals.reserve( e.second.size() );
+    fam.opmasks.reserve( e.second.size() );
+    for ( auto& hkl : e.second ) {
+      fam.reps.push_back( hkl );
+      fam.repnormals.push_back( labDemiNormal( hkl ) );
+      fam.opmasks.push_back( opMask( symops, hkl ) );
+    }
+  }
+  return true;
+}
+
+uint32_t NC::SCBragg::pimpl::opMask( Span<const EqRefl::SymOp> symops, const HKL& hkl )
+{
+  //Mask of the operations giving distinct (normalised) planes:
+  HKL images[32];
+  uint32_t mask(0);
+  for ( auto j : ncrange( symops.size() ) ) {
+    images[j] = EqRefl::normalise( symops[j].apply( hkl ) );
+    if ( std::find( &images[0], &images[j], images[j] ) == &images[j] )
+      mask |= ( uint32_t(1) << j );
+  }
+  return mask;
+}
 
 namespace NCrystal {
   inline double SCBragg_cacheRound(double x) {
@@ -228,6 +787,237 @@ namespace NCrystal {
   }
 }
 
+bool NC::SCBragg::pimpl::useIndex( double inv2dcutoff ) const
+{
+  //Use the index when there are enough normals below the cutoff for it to
+  //pay off (families are sorted by inv2d):
+  if ( m_normalIndex.empty() )
+    return false;
+  auto itCut = std::lower_bound( m_reflfamilies.begin(), m_reflfamilies.end(), inv2dcutoff,
+                                 []( const ReflectionFamily& f, double v ) { return f.inv2d < v; } );
+  return m_normalIndex.familyBegin( itCut - m_reflfamilies.begin() ) >= 4096;
+}
+
+void NC::SCBragg::pimpl::collectBand( Cache& cache, const Vector& dir, double inv2dcutoff, double ta ) const
+{
+  if ( m_compact ) {
+    collectBandCompact( cache, dir, inv2dcutoff, ta );
+    return;
+  }
+  auto& band_fam = cache.band_fam;
+  auto& band_idx = cache.band_idx;
+  band_fam.clear();
+  band_idx.clear();
+  auto addNormal = [&band_fam,&band_idx]( std::size_t ifam, std::size_t i )
+  {
+    if ( band_fam.empty() || band_fam.back().first != ifam )
+      band_fam.emplace_back( static_cast<uint32_t>( ifam ), 0 );
+    band_idx.push_back( static_cast<uint32_t>( i ) );
+    band_fam.back().second = static_cast<uint32_t>( band_idx.size() );
+  };
+
+  if ( coneCovers( dir, cache.wl, ta ) ) {
+    //Test just the candidates of the direction cone (in order):
+    const DirectionCone& cone = m_cone.value();
+    uint32_t ibegin(0);
+    for ( auto& e : cone.fam ) {
+      const ReflectionFamily& fam = m_reflfamilies[e.first];
+      if( fam.inv2d >= inv2dcutoff )
+        break;//stop here, no more families fulfill w<2d requirement.
+      const double s = cache.wl * fam.inv2d;
+      for ( auto k : ncrange( ibegin, e.second ) ) {
+        const uint32_t i = cone.idx[k];
+        if ( ncabs( ncabs( fam.deminormals[i].dot( dir ) ) - s ) < ta )
+          addNormal( e.first, i );
+      }
+      ibegin = e.second;
+    }
+    return;
+  }
+
+  if ( useIndex( inv2dcutoff ) ) {
+    //Mark candidate normals in the bitmap, and go through them in order (so
+    //contributions end up in the same order as with a full scan):
+    auto& bitmap = cache.bitmap;
+    const std::size_t nwords = ( m_normalIndex.nnormals() + 63 ) / 64;
+    if ( bitmap.size() != nwords )
+      bitmap.assign( nwords, 0 );//NB: Always kept zeroed between calls
+    m_normalIndex.markCandidates( dir, cache.wl, inv2dcutoff, ta, bitmap.data() );
+    std::size_t ifam(0);
+    bool done(false);
+    for ( auto iw : ncrange( nwords ) ) {
+      uint64_t word = bitmap[iw];
+      if ( !word )
+        continue;
+      bitmap[iw] = 0;
+      if ( done )
+        continue;
+      for ( std::size_t ibit = iw * 64; word; word >>= 1, ++ibit ) {
+        if ( !( word & 1 ) )
+          continue;
+        while ( ibit >= m_normalIndex.familyBegin( ifam + 1 ) )
+          ++ifam;
+        if ( m_reflfamilies[ifam].inv2d >= inv2dcutoff ) {
+          done = true;//stop here, no more families fulfill w<2d requirement.
+          break;
+        }
+        addNormal( ifam, ibit - m_normalIndex.familyBegin( ifam ) );
+      }
+    }
+    return;
+  }
+
+  //Scan all families (starting with the hot normals, if available):
+  if ( !m_hot.empty() )
+    collectBandHot( cache, dir, inv2dcutoff, ta );
+  else
+    scanFamilies( cache, dir, inv2dcutoff, ta, 0 );
+}
+
+void NC::SCBragg::pimpl::scanFamilies( Cache& cache, const Vector& dir, double inv2dcutoff,
+                                       double ta, std::size_t ifambegin ) const
+{
+  //Scan families from ifambegin and onwards, testing normals in chunks with a
+  //vectorisable loop:
+  auto& band_fam = cache.band_fam;
+  auto& band_idx = cache.band_idx;
+  const double ux = dir[0];
+  const double uy = dir[1];
+  const double uz = dir[2];
+  constexpr std::size_t chunksize = 64;
+  double accept[chunksize];
+  for ( auto ifam : ncrange( ifambegin, m_reflfamilies.size() ) ) {
+    const ReflectionFamily& fam = m_reflfamilies[ifam];
+    if( fam.inv2d >= inv2dcutoff )
+      break;//stop here, no more families fulfill w<2d requirement.
+    const double s = cache.wl * fam.inv2d;
+    const std::size_t n = fam.deminormals.size();
+    for ( std::size_t ichunk = 0; ichunk < n; ichunk += chunksize ) {
+      const std::size_t m = std::min<std::size_t>( chunksize, n - ichunk );
+      const double * cx = fam.deminormals.xData() + ichunk;
+      const double * cy = fam.deminormals.yData() + ichunk;
+      const double * cz = fam.deminormals.zData() + ichunk;
+      for ( std::size_t i = 0; i < m; ++i )
+        accept[i] = ( ncabs( ncabs( cx[i]*ux+cy[i]*uy+cz[i]*uz ) - s ) < ta ? 1.0 : 0.0 );
+      for ( std::size_t i = 0; i < m; ++i ) {
+        if ( accept[i] ) {
+          if ( band_fam.empty() || band_fam.back().first != ifam )
+            band_fam.emplace_back( static_cast<uint32_t>( ifam ), 0 );
+          band_idx.push_back( static_cast<uint32_t>( ichunk + i ) );
+          band_fam.back().second = static_cast<uint32_t>( band_idx.size() );
+        }
+      }
+    }
+  }
+}
+
+void NC::SCBragg::pimpl::collectBandHot( Cache& cache, const Vector& dir, double inv2dcutoff, double ta ) const
+{
+  nc_assert( !m_hot.empty() && !m_compact );
+  auto& band_fam = cache.band_fam;
+  auto& band_idx = cache.band_idx;
+  band_fam.clear();
+  band_idx.clear();
+
+  //The hot normals are in order of increasing inv2d, so those fulfilling the
+  //w<2d requirement form a prefix. Test them in chunks with a vectorisable
+  //loop across families:
+  const std::size_t nhot = m_hot.inv2d.size();
+  const std::size_t nallowed = std::lower_bound( m_hot.inv2d.begin(), m_hot.inv2d.end(), inv2dcutoff ) - m_hot.inv2d.begin();
+  const double ux = dir[0];
+  const double uy = dir[1];
+  const double uz = dir[2];
+  const double wl = cache.wl;
+  constexpr std::size_t chunksize = 64;
+  double accept[chunksize];
+  for ( std::size_t ichunk = 0; ichunk < nallowed; ichunk += chunksize ) {
+    const std::size_t m = std::min<std::size_t>( chunksize, nallowed - ichunk );
+    const double * cx = m_hot.nx.data() + ichunk;
+    const double * cy = m_hot.ny.data() + ichunk;
+    const double * cz = m_hot.nz.data() + ichunk;
+    const double * ci = m_hot.inv2d.data() + ichunk;
+    for ( std::size_t i = 0; i < m; ++i )
+      accept[i] = ( ncabs( ncabs( cx[i]*ux+cy[i]*uy+cz[i]*uz ) - wl * ci[i] ) < ta ? 1.0 : 0.0 );
+    for ( std::size_t i = 0; i < m; ++i ) {
+      if ( !accept[i] )
+        continue;
+      const uint32_t ifam = m_hot.fam[ichunk+i];
+      if ( band_fam.empty() || band_fam.back().first != ifam )
+        band_fam.emplace_back( ifam, 0 );
+      band_idx.push_back( m_hot.idx[ichunk+i] );
+      band_fam.back().second = static_cast<uint32_t>( band_idx.size() );
+    }
+  }
+
+  //Only if all hot families can contribute, can any of the cold ones:
+  if ( nallowed == nhot )
+    scanFamilies( cache, dir, inv2dcutoff, ta, m_hot.nfam );
+}
+
+void NC::SCBragg::pimpl::collectBandCompact( Cache& cache, const Vector& dir, double inv2dcutoff, double ta ) const
+{
+  auto& band_fam = cache.band_fam;
+  auto& band_idx = cache.band_idx;
+  auto& cands = cache.band_cands;
+  band_fam.clear();
+  band_idx.clear();
+  cache.band_normals.clear();
+
+  //Neutron direction transformed by each symmetry operation:
+  const std::size_t nops = m_symops.size();
+  double ux[32], uy[32], uz[32];
+  for ( auto j : ncrange( nops ) ) {
+    const double * qt = &m_symopsLabT[9*j];
+    ux[j] = qt[0]*dir[0] + qt[1]*dir[1] + qt[2]*dir[2];
+    uy[j] = qt[3]*dir[0] + qt[4]*dir[1] + qt[5]*dir[2];
+    uz[j] = qt[6]*dir[0] + qt[7]*dir[1] + qt[8]*dir[2];
+  }
+
+  double accept[32];
+  for ( auto ifam : ncrange( m_reflfamilies.size() ) ) {
+    const ReflectionFamily& fam = m_reflfamilies[ifam];
+    if( fam.inv2d >= inv2dcutoff )
+      break;//stop here, no more families fulfill w<2d requirement.
+    const double s = cache.wl * fam.inv2d;
+    const std::size_t nbefore = band_idx.size();
+    for ( auto i : ncrange( fam.reps.size() ) ) {
+      //Test all images of the representative in a vectorisable loop:
+      const Vector n0 = fam.repnormals[i];
+      for ( std::size_t j = 0; j < nops; ++j )
+        accept[j] = ( ncabs( ncabs( n0[0]*ux[j]+n0[1]*uy[j]+n0[2]*uz[j] ) - s ) < ta ? 1.0 : 0.0 );
+      const uint32_t mask = fam.opmasks[i];
+      cands.clear();
+      for ( std::size_t j = 0; j < nops; ++j ) {
+        if ( accept[j] && ( mask & ( uint32_t(1) << j ) ) )
+          cands.push_back( EqRefl::normalise( m_symops[j].apply( fam.reps[i] ) ) );
+      }
+      //Add candidates in the same order as in the normal representation
+      //(sorted (h,k,l) values within each group):
+      std::sort( cands.begin(), cands.end() );
+      for ( auto& hkl : cands ) {
+        band_idx.push_back( static_cast<uint32_t>( cache.band_normals.size() ) );
+        cache.band_normals.push_back( labDemiNormal( hkl ) );
+      }
+    }
+    if ( band_idx.size() > nbefore )
+      band_fam.emplace_back( static_cast<uint32_t>( ifam ), static_cast<uint32_t>( band_idx.size() ) );
+  }
+}
+
+void NC::SCBragg::pimpl::evaluateBand( Cache& cache ) const
+{
+  GaussMos::InteractionPars interactionpars;
+  uint32_t ibegin(0);
+  for ( auto& e : cache.band_fam ) {
+    const ReflectionFamily& fam = m_reflfamilies[e.first];
+    interactionpars.set(cache.wl, fam.inv2d, fam.xsfact);
+    m_gm.calcCrossSections( interactionpars, cache.dir, m_compact ? cache.band_normals : fam.deminormals,
+                            cache.band_idx.data() + ibegin, e.second - ibegin,
+                            cache.scatcache, cache.xs_commul );
+    ibegin = e.second;
+  }
+}
+
 void NC::SCBragg::pimpl::updateCache( Cache& cache, NeutronEnergy ekin_raw, const NC::Vector& dir ) const
 {
   //We check the cache validity on the rounded ekin value, but for simplicity we
@@ -237,14 +1027,19 @@ void NC::SCBragg::pimpl::updateCache( Cache& cache, NeutronEnergy ekin_raw, cons
   //actually numerically imprecise for small angles, leading to occurances of
   //cache validity where it should have been invalid.
   double ekin = SCBragg_cacheRound(ekin_raw.get());
-  if ( cache.ekin==ekin && dir.angle_highres(cache.dir)<1.0e-12 ) {
+  const bool sameEnergy = ( cache.ekin==ekin );
+  if ( sameEnergy && dir.angle_highres(cache.dir)<1.0e-12 ) {
     //cache already valid!
+    NCRYSTAL_RTCOUNT(CacheHits);
     return;
   }
 
   //Cache not valid!
-  cache.dir = dir;
-  cache.dir.normalise();
+  NCRYSTAL_RTCOUNT(CacheMisses);
+  Vector newdir = dir;
+  newdir.normalise();
+  const bool smallStep = sameEnergy && ( newdir - cache.dir ).mag2() < ncsquare( m_bandMargin );
+  cache.dir = newdir;
 
   //Energy or direction is new, we must recalculate.
 
@@ -256,11 +1051,38 @@ void NC::SCBragg::pimpl::updateCache( Cache& cache, NeutronEnergy ekin_raw, cons
   if (cache.wl==0)
     return;//done, all cross-sections will be zero
 
-  std::vector<ReflectionFamily>::const_iterator it(m_reflfamilies.begin()), itE(m_reflfamilies.end());
-
   double inv2dcutoff = (1.0-2*std::numeric_limits<double>::epsilon())/cache.wl;
 
+  //Small changes of direction at the same energy (e.g. successive steps of a
+  //neutron inside a thick crystal) can reuse a list of candidate normals
+  //found for a wider window around the Bragg condition. Since
+  //|n.(d1-d0)|<=|d1-d0| for unit normals n, the list contains all normals
+  //which might contribute for directions within band_margin of band_dir, so
+  //the results are exactly the same as with a full update:
+  if ( !sameEnergy )
+    cache.band_margin = -1.0;
+  if ( cache.band_margin > 0.0 && ( cache.dir - cache.band_dir ).mag2() > ncsquare( cache.band_margin ) )
+    cache.band_margin = -1.0;
+  if ( cache.band_margin <= 0.0 && smallStep ) {
+    collectBand( cache, cache.dir, inv2dcutoff, m_indexShellAngle + m_bandMargin );
+    cache.band_dir = cache.dir;
+    cache.band_margin = m_bandMargin;
+  }
+  if ( cache.band_margin > 0.0 ) {
+    evaluateBand( cache );
+    nc_assert(cache.xs_commul.empty()||cache.xs_commul.back()>0.0);
+    return;
+  }
+
+  if ( m_compact || !m_hot.empty() || coneCovers( cache.dir, cache.wl, m_indexShellAngle ) || useIndex( inv2dcutoff ) ) {
+    collectBand( cache, cache.dir, inv2dcutoff, m_indexShellAngle );
+    evaluateBand( cache );
+    nc_assert(cache.xs_commul.empty()||cache.xs_commul.back()>0.0);
+    return;
+  }
+
   GaussMos::InteractionPars interactionpars;
+  std::vector<ReflectionFamily>::const_iterator it(m_reflfamilies.begin()), itE(m_reflfamilies.end());
   for( ; it!=itE; ++it) {
     const ReflectionFamily& fam = *it;
     if( fam.inv2d >= inv2dcutoff )
@@ -272,6 +1094,41 @@ void NC::SCBragg::pimpl::updateCache( Cache& cache, NeutronEnergy ekin_raw, cons
   nc_assert(cache.xs_commul.empty()||cache.xs_commul.back()>0.0);
 }
 
+double NC::SCBragg::pimpl::memoisedCrossSection( Cache& cache, NeutronEnergy ekin, const NC::Vector& dir ) const
+{
+  nc_assert( m_memoTol > 0.0 );
+  const double wl = ekin2wl( ekin.dbl() );
+  if ( !( wl > 0.0 ) )
+    return 0.0;
+  const double invtol = 1.0 / m_memoTol;
+  auto discretise = [invtol]( double x ) { return static_cast<int64_t>( std::floor( x * invtol + 0.5 ) ); };
+  Vector u = dir;
+  u.normalise();
+  const MemoKey key{ { discretise( std::log( wl ) ), discretise( u[0] ), discretise( u[1] ), discretise( u[2] ) } };
+  auto it = cache.memo.find( key );
+  if ( it != cache.memo.end() ) {
+    NCRYSTAL_RTCOUNT(CacheHits);
+    return it->second;
+  }
+
+  //Evaluate at the centre of the cell (so results do not depend on the order
+  //of calls):
+  if ( cache.memo.size() >= m_memoMaxEntries )
+    cache.memo.clear();
+  if ( !cache.memoEval )
+    cache.memoEval = std::make_unique<Cache>();
+  const double ekin_c = wl2ekin( std::exp( key[0] * m_memoTol ) );
+  Vector u_c( key[1] * m_memoTol, key[2] * m_memoTol, key[3] * m_memoTol );
+  double xs = 0.0;
+  if ( ekin_c > m_threshold_ekin && u_c.mag2() > 0.0 ) {
+    auto& ec = *cache.memoEval;
+    updateCache( ec, NeutronEnergy{ ekin_c }, u_c );
+    xs = ec.xs_commul.empty() ? 0.0 : ec.xs_commul.back();
+  }
+  cache.memo.emplace( key, xs );
+  return xs;
+}
+
 void NC::SCBragg::pimpl::genScat( Cache& cache, RNG& rng, NC::Vector& outdir ) const
 {
   nc_assert(!cache.xs_commul.empty());
@@ -285,6 +1142,70 @@ void NC::SCBragg::pimpl::genScat( Cache& cache, RNG& rng, NC::Vector& outdir ) c
   m_gm.genScat( rng, chosen_scatcache, cache.wl, cache.dir, outdir );
 }
 
+double NC::SCBragg::pimpl::genScatInCone( Cache& cache, RNG& rng, const NC::Vector& conedir,
+                                          double halfangle, NC::Vector& outdir ) const
+{
+  nc_assert(!cache.xs_commul.empty());
+  nc_assert(cache.xs_commul.size()==cache.scatcache.size());
+
+  //The outgoing direction deviates from the mirror image of the incoming
+  //direction in the nominal plane by at most twice the angle between the
+  //nominal and the actual normal, which is at most the mosaicity truncation
+  //angle. Thus, normals whose mirror directions are further than that from
+  //the cone can not contribute, and leaving them out does not bias results:
+  const double cos_selectangle = std::cos( std::min( kPi, halfangle + 2.0 * m_gm.mosaicityTruncationAngle() ) );
+  cache.cone_commul.clear();
+  cache.cone_idx.clear();
+  StableSum sum;
+  double prev = 0.0;
+  for ( std::size_t i = 0; i < cache.scatcache.size(); ++i ) {
+    const double contrib = cache.xs_commul[i] - prev;
+    prev = cache.xs_commul[i];
+    const Vector& n = cache.scatcache[i].plane_normal();
+    const Vector mirrordir = cache.dir - n * ( 2.0 * cache.dir.dot(n) / n.mag2() );
+    if ( mirrordir.dot(conedir) < cos_selectangle * mirrordir.mag() )
+      continue;
+    sum.add( contrib );
+    cache.cone_commul.push_back( sum.sum() );
+    cache.cone_idx.push_back( static_cast<uint32_t>( i ) );
+  }
+  if ( cache.cone_commul.empty() || !( cache.cone_commul.back() > 0.0 ) )
+    return 0.0;
+
+  std::size_t idx = pickRandIdxByWeight( rng, cache.cone_commul );
+  nc_assert( idx < cache.cone_idx.size() );
+  m_gm.genScat( rng, cache.scatcache[cache.cone_idx[idx]], cache.wl, cache.dir, outdir );
+  //Scatterings ending outside the cone are discarded:
+  if ( outdir.dot(conedir) < std::cos( halfangle ) * outdir.mag() )
+    return 0.0;
+  return cache.cone_commul.back() / cache.xs_commul.back();
+}
+
+std::pair<NC::ScatterOutcome,double> NC::SCBragg::sampleScatterInCone( CachePtr& cp, RNG& rng, NeutronEnergy ekin,
+                                                                      const NeutronDirection& indir,
+                                                                      const NeutronDirection& conedir,
+                                                                      double halfangle ) const
+{
+  Vector cdir = conedir.as<Vector>();
+  if ( !( cdir.mag2() > 0.0 ) )
+    NCRYSTAL_THROW(BadInput,"SCBragg::sampleScatterInCone: cone direction must be a non-zero vector");
+  if ( !( halfangle >= 0.0 && halfangle <= kPi ) )
+    NCRYSTAL_THROW(BadInput,"SCBragg::sampleScatterInCone: halfangle must be in [0,pi]");
+  cdir.normalise();
+  ScatterOutcome unscattered{ ekin, indir };
+  if ( ekin.get() <= m_pimpl->m_threshold_ekin )
+    return { unscattered, 0.0 };
+  auto& cache = accessCache<pimpl::Cache>(cp);
+  m_pimpl->updateCache( cache, ekin, indir.as<Vector>() );
+  if ( cache.xs_commul.empty() || cache.xs_commul.back()<=0.0 )
+    return { unscattered, 0.0 };
+  NeutronDirection outdir;
+  const double weight = m_pimpl->genScatInCone( cache, rng, cdir, halfangle, outdir.as<Vector>() );
+  if ( !( weight > 0.0 ) )
+    return { unscattered, 0.0 };
+  return { ScatterOutcome{ ekin, outdir }, weight };
+}
+
 NC::EnergyDomain NC::SCBragg::domain() const noexcept
 {
   return { NeutronEnergy{m_pimpl->m_threshold_ekin}, NeutronEnergy{kInfinity} };
@@ -292,15 +1213,19 @@ NC::EnergyDomain NC::SCBragg::domain() const noexcept
 
 NC::CrossSect NC::SCBragg::crossSection(CachePtr& cp, NeutronEnergy ekin, const NeutronDirection& dir ) const
 {
+  NCRYSTAL_RTCOUNTER_SCOPE(*this,XSCalls);
   if ( ekin.get() <= m_pimpl->m_threshold_ekin )
     return CrossSect{ 0.0 };
   auto& cache = accessCache<pimpl::Cache>(cp);
+  if ( m_pimpl->m_memoTol > 0.0 )
+    return CrossSect{ m_pimpl->memoisedCrossSection( cache, ekin, dir.as<Vector>() ) };
   m_pimpl->updateCache( cache, ekin, dir.as<Vector>() );
   return CrossSect{ cache.xs_commul.empty() ? 0.0 : cache.xs_commul.back() };
 }
 
 NC::ScatterOutcome NC::SCBragg::sampleScatter( CachePtr& cp, RNG& rng, NeutronEnergy ekin, const NeutronDirection& indir ) const
 {
+  NCRYSTAL_RTCOUNTER_SCOPE(*this,SampleCalls);
   if ( ekin.get() <= m_pimpl->m_threshold_ekin ) {
     //Scatterings not actually possible at this configuration, so don't change
     //state:
@@ -320,6 +1245,110 @@ NC::ScatterOutcome NC::SCBragg::sampleScatter( CachePtr& cp, RNG& rng, NeutronEn
   return { ekin, outdir };
 }
 
+void NC::SCBragg::sampleScatterRepeated( CachePtr& cp, RNG& rng, NeutronEnergy ekin, const NeutronDirection& indir,
+                                         std::size_t N, ScatterOutcome* out ) const
+{
+  //The cache is updated once, after which only the plane selection and the
+  //generation of the outgoing direction is needed for each neutron:
+  NCRYSTAL_RTCOUNTER_SCOPE_N(*this,SampleCalls,N);
+  auto fillUnscattered = [&]() { std::fill( out, out + N, ScatterOutcome{ ekin, indir } ); };
+  if ( ekin.get() <= m_pimpl->m_threshold_ekin )
+    return fillUnscattered();
+  auto& cache = accessCache<pimpl::Cache>(cp);
+  m_pimpl->updateCache( cache, ekin, indir.as<Vector>() );
+  if ( cache.xs_commul.empty() || cache.xs_commul.back()<=0.0 )
+    return fillUnscattered();
+  for ( std::size_t i = 0; i < N; ++i ) {
+    out[i].ekin = ekin;
+    m_pimpl->genScat( cache, rng, out[i].direction.as<Vector>() );
+  }
+}
+
+void NC::SCBragg::prepareForDirectionCone( const NeutronDirection& ndir, double halfangle,
+                                           NeutronEnergy emin, NeutronEnergy emax )
+{
+  Vector dir = ndir.as<Vector>();
+  if ( !( dir.mag2() > 0.0 ) )
+    NCRYSTAL_THROW(BadInput,"SCBragg::prepareForDirectionCone: direction must be a non-zero vector");
+  if ( !( halfangle >= 0.0 && halfangle <= kPi ) )
+    NCRYSTAL_THROW(BadInput,"SCBragg::prepareForDirectionCone: halfangle must be in [0,pi]");
+  if ( !( emin.dbl() >= 0.0 && emax >= emin ) )
+    NCRYSTAL_THROW(BadInput,"SCBragg::prepareForDirectionCone: invalid energy range");
+  dir.normalise();
+
+  auto& p = *m_pimpl;
+  p.m_cone.reset();
+  if ( p.m_compact )
+    return;
+
+  //The candidates must cover band updates as well (which use a wider window):
+  pimpl::DirectionCone cone;
+  cone.dir = dir;
+  cone.chord = 2.0 * std::sin( 0.5 * halfangle ) + 1e-9;
+  cone.wlmin = ekin2wl( emax.dbl() );
+  cone.wlmax = ekin2wl( emin.dbl() );
+  cone.ta = p.m_indexShellAngle + p.m_bandMargin;
+
+  //Since |n.u-n.dir|<=|u-dir| for unit vectors n, neutrons with directions u
+  //in the cone can only be within ta of the Bragg condition for normals with
+  //|n.dir| within ta+chord of wl*inv2d, for some wl in [wlmin,wlmax]:
+  const double w = cone.ta + cone.chord + 1e-9;
+  for ( auto ifam : ncrange( p.m_reflfamilies.size() ) ) {
+    const pimpl::ReflectionFamily& fam = p.m_reflfamilies[ifam];
+    if ( cone.wlmin * fam.inv2d >= 1.0 )
+      break;//no more families fulfill w<2d requirement within the range.
+    const double smin = cone.wlmin * fam.inv2d - w;
+    const double smax = cone.wlmax * fam.inv2d + w;//NB: inf if emin=0
+    const std::size_t nbefore = cone.idx.size();
+    for ( auto i : ncrange( fam.deminormals.size() ) ) {
+      const double s = ncabs( fam.deminormals[i].dot( dir ) );
+      if ( s > smin && s < smax )
+        cone.idx.push_back( static_cast<uint32_t>( i ) );
+    }
+    if ( cone.idx.size() > nbefore )
+      cone.fam.emplace_back( static_cast<uint32_t>( ifam ), static_cast<uint32_t>( cone.idx.size() ) );
+  }
+
+  //Only worth it if it reduces the number of normals considerably:
+  std::size_t nnormals(0);
+  for ( auto& fam : p.m_reflfamilies )
+    nnormals += fam.deminormals.size();
+  if ( 2 * cone.idx.size() > nnormals )
+    return;
+  cone.fam.shrink_to_fit();
+  cone.idx.shrink_to_fit();
+  p.m_cone = std::move( cone );
+}
+
+void NC::SCBragg::enableCrossSectionMemoisation( double tolerance, unsigned maxEntries )
+{
+  if ( !( tolerance >= 0.0 && tolerance <= 0.01 ) )
+    NCRYSTAL_THROW(BadInput,"SCBragg::enableCrossSectionMemoisation: tolerance must be in [0,0.01]");
+  if ( !maxEntries )
+    NCRYSTAL_THROW(BadInput,"SCBragg::enableCrossSectionMemoisation: maxEntries must be positive");
+  m_pimpl->m_memoTol = tolerance;
+  m_pimpl->m_memoMaxEntries = maxEntries;
+}
+
+std::size_t NC::SCBragg::memoryFootprint() const
+{
+  std::size_t res = sizeof(SCBragg) + sizeof(pimpl) + m_pimpl->m_normalIndex.memoryFootprint()
+    + m_pimpl->m_hot.memoryFootprint();
+  if ( m_pimpl->m_cone.has_value() )
+    res += m_pimpl->m_cone.value().fam.capacity() * sizeof(std::pair<uint32_t,uint32_t>)
+      + m_pimpl->m_cone.value().idx.capacity() * sizeof(uint32_t);
+  for ( auto& fam : m_pimpl->m_reflfamilies )
+    res += sizeof(fam) + fam.deminormals.size() * 3 * sizeof(double)
+      + fam.reps.size() * ( sizeof(HKL) + 3 * sizeof(double) + sizeof(uint32_t) );
+  res += m_pimpl->m_symops.capacity() * sizeof(EqRefl::SymOp) + m_pimpl->m_symopsLabT.capacity() * sizeof(double);
+  return res;
+}
+
+double NC::SCBragg::discardedFraction() const
+{
+  return m_pimpl->m_discardedFraction;
+}
+
 NC::Optional<std::string> NC::SCBragg::specificJSONDescription() const
 {
   auto nfam = m_pimpl->m_reflfamilies.size();
@@ -338,9 +1367,12 @@ NC::Optional<std::string> NC::SCBragg::specificJSONDescription() const
         <<";dmin="<<dmin
         <<"Aa;dmax="<<dmax
         <<"Aa;mos="<<mos;
+    if ( m_pimpl->m_discardedFraction > 0.0 )
+      tmp << ";discardedfrac="<<m_pimpl->m_discardedFraction;
     streamJSONDictEntry( ss, "summarystr", tmp.str(), JSONDictPos::FIRST );
   }
   streamJSONDictEntry( ss, "nfamilies", nfam );
+  streamJSONDictEntry( ss, "discardedfrac", m_pimpl->m_discardedFraction );
   streamJSONDictEntry( ss, "dmin", dmin );
   streamJSONDictEntry( ss, "dmax", dmax );
   streamJSONDictEntry( ss, "dmax", mos.dbl(), JSONDictPos::LAST );
@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCScatterPool.hh"
+#include <mutex>
+
+namespace NC = NCrystal;
+
+struct NC::ScatterPool::Impl {
+  Impl( Scatter&& p ) : prototype(std::move(p)) {}
+  std::mutex mtx;
+  Scatter prototype;
+  std::vector<std::unique_ptr<Scatter>> idle;
+  std::size_t ncreated = 0;
+  //Must hold lock when calling:
+  std::unique_ptr<Scatter> createClone()
+  {
+    auto sc = std::make_unique<Scatter>( prototype.clone() );
+    ++ncreated;
+    idle.reserve( ncreated );
+    return sc;
+  }
+};
+
+NC::ScatterPool::ScatterPool( Scatter&& prototype, std::size_t nreserve )
+  : m_impl(std::make_unique<Impl>(std::move(prototype)))
+{
+  reserve( nreserve );
+}
+
+NC::ScatterPool::~ScatterPool() = default;
+
+NC::ScatterPool::Handle NC::ScatterPool::acquire()
+{
+  std::lock_guard<std::mutex> guard( m_impl->mtx );
+  auto& idle = m_impl->idle;
+  if ( idle.empty() )
+    return Handle( this, m_impl->createClone() );
+  auto sc = std::move( idle.back() );
+  idle.pop_back();
+  return Handle( this, std::move(sc) );
+}
+
+void NC::ScatterPool::putBack( std::unique_ptr<Scatter> sc ) noexcept
+{
+  if ( !sc )
+    return;
+  std::lock_guard<std::mutex> guard( m_impl->mtx );
+  //NB: Capacity for all clones is reserved when they are created, so the
+  //push_back never allocates (and hence never throws):
+  m_impl->idle.push_back( std::move(sc) );
+}
+
+void NC::ScatterPool::release( Handle&& h )
+{
+  nc_assert_always( h.m_pool == this );
+  putBack( std::move(h.m_sc) );
+}
+
+void NC::ScatterPool::reserve( std::size_t n )
+{
+  std::lock_guard<std::mutex> guard( m_impl->mtx );
+  auto& idle = m_impl->idle;
+  while ( idle.size() < n )
+    idle.push_back( m_impl->createClone() );
+}
+
+std::size_t NC::ScatterPool::nIdle() const
+{
+  std::lock_guard<std::mutex> guard( m_impl->mtx );
+  return m_impl->idle.size();
+}
+
+std::size_t NC::ScatterPool::nCreated() const
+{
+  std::lock_guard<std::mutex> guard( m_impl->mtx );
+  return m_impl->ncreated;
+}
+
+NC::ScatterPool::Handle& NC::ScatterPool::Handle::operator=( Handle&& o )
+{
+  if ( this != &o ) {
+    if ( m_sc )
+      m_pool->putBack( std::move(m_sc) );
+    m_pool = o.m_pool;
+    m_sc = std::move(o.m_sc);
+  }
+  return *this;
+}
+
+NC::ScatterPool::Handle::~Handle()
+{
+  if ( m_sc )
+    m_pool->putBack( std::move(m_sc) );
+}
@@ -26,9 +26,10 @@
 //either linearly from the edge points or using a numerical derivative
 //estimation.
 
-void NCrystal::CubicSpline::set( const VectD& y,
-                                 double derivative_y_left,
-                                 double derivative_y_right )
+template<class TValue>
+void NCrystal::CubicSplineT<TValue>::set( const VectD& y,
+                                          double derivative_y_left,
+                                          double derivative_y_right )
 {
   const std::size_t n = y.size();
   nc_assert_always(n>3);
@@ -55,23 +56,27 @@ void NCrystal::CubicSpline::set( const VectD& y,
     y2[km1] *= y2[k];
     y2[km1] += u[km1];
   }
-  std::vector<PairDD > data;
-  data.reserve(y.size());
-  for (std::size_t i = 0; i < y.size(); ++i) {
-    data.push_back(std::make_pair(y[i],y2[i]));
-    nc_assert(!ncisnan(data.back().first));
-    nc_assert(!ncisnan(data.back().second));
+  std::vector<TValue> yvals, y2vals;
+  yvals.reserve(n);
+  y2vals.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    nc_assert(!ncisnan(y[i]));
+    nc_assert(!ncisnan(y2[i]));
+    yvals.push_back(static_cast<TValue>(y[i]));
+    y2vals.push_back(static_cast<TValue>(y2[i]));
   }
   //all good, set:
-  std::swap(m_data,data);
+  std::swap(m_y,yvals);
+  std::swap(m_y2,y2vals);
   m_nm2 = n-2;
 }
 
-void NCrystal::SplinedLookupTable::set( const VectD& fvals,
-                                        double a,double b,
-                                        double fprime_a, double fprime_b,
-                                        const std::string& name,
-                                        const std::string& description  )
+template<class TValue>
+void NCrystal::SplinedLookupTableT<TValue>::set( const VectD& fvals,
+                                                 double a,double b,
+                                                 double fprime_a, double fprime_b,
+                                                 const std::string& name,
+                                                 const std::string& description  )
 {
   nc_assert(b>a);
   nc_assert(fvals.size()>3);
@@ -86,12 +91,13 @@ void NCrystal::SplinedLookupTable::set( const VectD& fvals,
 
 }
 
-void NCrystal::SplinedLookupTable::set( const Fct1D* thefct,
-                                        double a,double b,
-                                        double fprime_a, double fprime_b,
-                                        unsigned npts,
-                                        const std::string& name,
-                                        const std::string& description )
+template<class TValue>
+void NCrystal::SplinedLookupTableT<TValue>::set( const Fct1D* thefct,
+                                                 double a,double b,
+                                                 double fprime_a, double fprime_b,
+                                                 unsigned npts,
+                                                 const std::string& name,
+                                                 const std::string& description )
 {
   nc_assert(!ncisnan(fprime_a));
   nc_assert(!ncisnan(fprime_b));
@@ -127,10 +133,11 @@ void NCrystal::SplinedLookupTable::set( const Fct1D* thefct,
 #include <iostream>
 #include <iomanip>
 
-void NCrystal::SplinedLookupTable::producefile( const Fct1D* thefct,
-                                                double fprime_a, double fprime_b,
-                                                const std::string& username,
-                                                const std::string& userdesc ) const
+template<class TValue>
+void NCrystal::SplinedLookupTableT<TValue>::producefile( const Fct1D* thefct,
+                                                         double fprime_a, double fprime_b,
+                                                         const std::string& username,
+                                                         const std::string& userdesc ) const
 {
 
   std::string name = (username.empty()?std::string("unknownspline"):username);
@@ -162,13 +169,13 @@ void NCrystal::SplinedLookupTable::producefile( const Fct1D* thefct,
   ofs << "#fprime_a = "<<fprime_a<<"\n";
   ofs << "#fprime_b = "<<fprime_b<<"\n";
   ofs << "#input_fvals = ";
-  for (std::size_t i = 0; i < m_spline.m_data.size(); ++i)
-    ofs<<" "<<m_spline.m_data[i].first;
+  for (std::size_t i = 0; i < m_spline.m_y.size(); ++i)
+    ofs<<" "<<m_spline.m_y[i];
   ofs << "\n#data_colums = x,spline_of_x";
   if (thefct)
     ofs <<",truefct_of_x";
   ofs<<"\n";
-  std::size_t numpts = 100*m_spline.m_data.size();
+  std::size_t numpts = 100*m_spline.m_y.size();
   if (numpts>1000000)
     numpts = std::max<std::size_t>(numpts/10,1000000);
   double delta = (m_b-m_a)/(numpts-1.0);
@@ -182,3 +189,7 @@ void NCrystal::SplinedLookupTable::producefile( const Fct1D* thefct,
   std::cout <<"NCrystal: Wrote "<<filename<<" (since NCRYSTAL_DEBUG_SPLINE is set)."<<std::endl;
 }
 
+template class NCrystal::CubicSplineT<double>;
+template class NCrystal::CubicSplineT<float>;
+template class NCrystal::SplinedLookupTableT<double>;
+template class NCrystal::SplinedLookupTableT<float>;
@@ -68,25 +68,33 @@ namespace NCrystal {
 
       nc_assert( request.isMultiPhase() );
 
-      ProcImpl::ProcComposition::ComponentList scatter_phases;
-
       const double totnd = request.info().getNumberDensity().dbl();
       if ( ! ( totnd > 0.0 ) )
         return ProcImpl::getGlobalNullScatter();//should not be possible but just to be safe
 
+      //Phases giving identical child requests (e.g. the same phase appearing
+      //several times) are deduplicated before any scatter objects are
+      //created, by summing their fractions:
+      std::vector<std::pair<double,FactImpl::ScatterRequest>> phase_requests;
       for ( auto&& info_ph : enumerate( request.info().getPhases() ) ) {
-
-        //Create corresponding scatter object and add:
         const double phase_fraction = info_ph.val.first * ( info_ph.val.second->getNumberDensity().dbl() /  totnd ) ;
         if ( ! phase_fraction )
           continue;
-
-        auto scatter_ph = FactImpl::createScatter( request.createChildRequest( info_ph.idx ) );
-
-        scatter_phases.push_back( ProcImpl::ProcComposition::Component{ phase_fraction, scatter_ph } );
-
+        auto child_request = request.createChildRequest( info_ph.idx );
+        auto it = std::find_if( phase_requests.begin(), phase_requests.end(),
+                                [&child_request]( const std::pair<double,FactImpl::ScatterRequest>& e )
+                                { return e.second == child_request; } );
+        if ( it != phase_requests.end() )
+          it->first += phase_fraction;
+        else
+          phase_requests.emplace_back( phase_fraction, std::move(child_request) );
       }
 
+      //Create corresponding scatter objects and add:
+      ProcImpl::ProcComposition::ComponentList scatter_phases;
+      for ( auto& e : phase_requests )
+        scatter_phases.push_back( ProcImpl::ProcComposition::Component{ e.first, FactImpl::createScatter( e.second ) } );
+
       //NB: When we add support for SANS physics in NCMAT files (not via
       //@CUSTOM_ sections), we will handle it here.
 
@@ -33,6 +33,9 @@
 #include "NCrystal/internal/NCSABScatter.hh"
 #include "NCrystal/internal/NCSABFactory.hh"
 #include "NCrystal/internal/NCString.hh"
+#include <functional>
+#include <map>
+#include <set>
 
 namespace NC = NCrystal;
 
@@ -48,6 +51,21 @@ namespace NC = NCrystal;
 
 namespace NCrystal {
 
+  namespace {
+    //Deferred creation of inelastic scattering kernels (see the HelperProducer
+    //constructor of SABScatter), controlled by the NCRYSTAL_SAB_DEFER
+    //environment variable. With a value of 1, kernels (including expansion of
+    //VDOS curves) are only created upon the first inelastic cross section or
+    //sampling call, and with a value of 2 their creation is additionally
+    //started immediately in background threads. The default (0) is to create
+    //them with the scatter process:
+    int deferSABMode()
+    {
+      static const int s_mode = std::max( 0, std::min( 2, ncgetenv_int("SAB_DEFER",0) ) );
+      return s_mode;
+    }
+  }
+
   class PlaneProviderWCutOff : public PlaneProvider {
   public:
 
@@ -76,6 +94,26 @@ namespace NCrystal {
       return NullOpt;
     }
 
+    const EqRefl* symmetry() const override { return m_pp->symmetry(); }
+    double discardedFraction() const override { return m_pp->discardedFraction(); }
+
+    Optional<SymGroup> getNextSymGroup() override {
+      Optional<SymGroup> res;
+      while ( ( res = m_pp->getNextSymGroup() ).has_value() ) {
+        if ( res.value().dspacing>=m_dcut )
+          return res;
+        //Withhold each plane in the group exactly as in getNextPlane:
+        const double fsq = res.value().fsq * 2;
+        for ( unsigned i = 0; i < res.value().ndeminormals; ++i ) {
+          if (m_withheldPlanes.empty()||m_withheldPlanes.back().first!=res.value().dspacing)
+            m_withheldPlanes.emplace_back(res.value().dspacing,fsq);
+          else
+            m_withheldPlanes.back().second += fsq;
+        }
+      }
+      return NullOpt;
+    }
+
     void prepareLoop() override { m_pp->prepareLoop(); m_withheldPlanes.clear(); }
     bool canProvide() const override { return m_pp->canProvide(); }
     bool hasPlanesWithheldInLastLoop() const { return !m_withheldPlanes.empty(); };
@@ -87,6 +125,170 @@ namespace NCrystal {
     PCBragg::VectDFM m_withheldPlanes;
   };
 
+  class PlaneProviderWPruning : public PlaneProvider {
+  public:
+
+    //Wraps plane provider and discards the families of planes (sharing
+    //dspacing and fsquared) contributing the least to the orientation-averaged
+    //Bragg cross section, as long as the discarded fraction of that cross
+    //section stays below the tolerance at all wavelengths. Will assume
+    //ownership of wrapped plane provider.
+    PlaneProviderWPruning( double tolerance, std::unique_ptr<PlaneProvider> pp )
+      : PlaneProvider(), m_pp(std::move(pp))
+    {
+      nc_assert( m_pp && tolerance > 0.0 && tolerance < 1.0 );
+      m_pp->prepareLoop();
+      if ( m_pp->canProvide() )
+        selectDiscardedFamilies( tolerance );
+      m_pp->prepareLoop();
+    }
+    virtual ~PlaneProviderWPruning() {}
+
+    Optional<Plane> getNextPlane() override {
+      Optional<Plane> res;
+      while ( ( res = m_pp->getNextPlane() ).has_value() ) {
+        if ( !isDiscarded( res.value().dspacing, res.value().fsq ) )
+          return res;
+      }
+      return NullOpt;
+    }
+
+    const EqRefl* symmetry() const override { return m_pp->symmetry(); }
+
+    Optional<SymGroup> getNextSymGroup() override {
+      Optional<SymGroup> res;
+      while ( ( res = m_pp->getNextSymGroup() ).has_value() ) {
+        if ( !isDiscarded( res.value().dspacing, res.value().fsq ) )
+          return res;
+      }
+      return NullOpt;
+    }
+
+    void prepareLoop() override { m_pp->prepareLoop(); }
+    bool canProvide() const override { return m_pp->canProvide(); }
+    double discardedFraction() const override { return m_discardedFraction; }
+
+  private:
+    typedef std::pair<double,double> FamilyKey;//(dspacing,fsquared)
+    std::unique_ptr<PlaneProvider> m_pp;
+    std::set<FamilyKey> m_discarded;
+    double m_discardedFraction = 0.0;
+
+    bool isDiscarded( double dspacing, double fsq ) const
+    {
+      return !m_discarded.empty() && m_discarded.count( FamilyKey{ dspacing, fsq } );
+    }
+
+    void selectDiscardedFamilies( double tolerance )
+    {
+      //The orientation-averaged cross section at wavelength lambda is
+      //proportional to the sum of d*fsq over all normals with 2d>lambda. Thus,
+      //the discarded fraction is largest just below the thresholds lambda=2d,
+      //and it is sufficient to check it at each of those.
+      std::map<FamilyKey,double> fam2weight;
+      if ( m_pp->symmetry() ) {
+        Optional<SymGroup> g;
+        while ( ( g = m_pp->getNextSymGroup() ).has_value() )
+          fam2weight[FamilyKey{g.value().dspacing,g.value().fsq}] += g.value().dspacing * g.value().fsq * g.value().ndeminormals;
+      } else {
+        Optional<Plane> p;
+        while ( ( p = m_pp->getNextPlane() ).has_value() )
+          fam2weight[FamilyKey{p.value().dspacing,p.value().fsq}] += p.value().dspacing * p.value().fsq;
+      }
+      //Families in order of decreasing dspacing, and for each of them the
+      //first index with the same dspacing (the thresholds of the families
+      //from this index and onwards are at or below their own):
+      struct Family { FamilyKey key; double weight; std::size_t ifirst; };
+      std::vector<Family> fams;
+      fams.reserve( fam2weight.size() );
+      for ( auto it = fam2weight.rbegin(); it != fam2weight.rend(); ++it )
+        if ( it->second > 0.0 )
+          fams.push_back( Family{ it->first, it->second, fams.size() } );
+      const std::size_t n = fams.size();
+      if ( n < 2 )
+        return;
+      for ( std::size_t i = 1; i < n; ++i )
+        if ( fams[i].key.first == fams[i-1].key.first )
+          fams[i].ifirst = fams[i-1].ifirst;
+      //Total cross section (up to a constant factor) just below each threshold:
+      VectD total( n );
+      {
+        double sum = 0.0;
+        for ( std::size_t i = 0; i < n; ++i )
+          total[i] = ( sum += fams[i].weight );
+        for ( std::size_t i = n - 1; i > 0; --i )
+          if ( fams[i-1].ifirst == fams[i].ifirst )
+            total[i-1] = total[i];
+      }
+
+      //Greedily discard the weakest families, as long as the allowed
+      //remainder (tolerance*total minus the discarded weight) stays
+      //non-negative at all thresholds. Since each family affects all
+      //thresholds from its own and onwards, a segment tree supporting range
+      //additions and range minimum queries is used to keep track of the
+      //smallest remainder:
+      std::size_t nleaves = 1;
+      while ( nleaves < n )
+        nleaves *= 2;
+      VectD treemin( 2 * nleaves, kInfinity );
+      VectD treeadd( 2 * nleaves, 0.0 );
+      for ( std::size_t i = 0; i < n; ++i )
+        treemin[nleaves+i] = tolerance * total[i];
+      for ( std::size_t i = nleaves - 1; i > 0; --i )
+        treemin[i] = std::min( treemin[2*i], treemin[2*i+1] );
+      //Add v to all leaves in [l,r) (node covers [nl,nr)), or query minimum:
+      std::function<void(std::size_t,std::size_t,std::size_t,std::size_t,std::size_t,double)> rangeAdd;
+      rangeAdd = [&]( std::size_t node, std::size_t nl, std::size_t nr, std::size_t l, std::size_t r, double v )
+      {
+        if ( r <= nl || nr <= l )
+          return;
+        if ( l <= nl && nr <= r ) {
+          treemin[node] += v;
+          treeadd[node] += v;
+          return;
+        }
+        const std::size_t nm = ( nl + nr ) / 2;
+        rangeAdd( 2 * node, nl, nm, l, r, v );
+        rangeAdd( 2 * node + 1, nm, nr, l, r, v );
+        treemin[node] = treeadd[node] + std::min( treemin[2*node], treemin[2*node+1] );
+      };
+      std::function<double(std::size_t,std::size_t,std::size_t,std::size_t,std::size_t)> rangeMin;
+      rangeMin = [&]( std::size_t node, std::size_t nl, std::size_t nr, std::size_t l, std::size_t r ) -> double
+      {
+        if ( r <= nl || nr <= l )
+          return kInfinity;
+        if ( l <= nl && nr <= r )
+          return treemin[node];
+        const std::size_t nm = ( nl + nr ) / 2;
+        return treeadd[node] + std::min( rangeMin( 2 * node, nl, nm, l, r ),
+                                         rangeMin( 2 * node + 1, nm, nr, l, r ) );
+      };
+
+      std::vector<std::size_t> byweight( n );
+      for ( std::size_t i = 0; i < n; ++i )
+        byweight[i] = i;
+      std::stable_sort( byweight.begin(), byweight.end(),
+                        [&fams]( std::size_t a, std::size_t b ) { return fams[a].weight < fams[b].weight; } );
+      VectD discarded( n, 0.0 );
+      for ( auto i : byweight ) {
+        const double w = fams[i].weight;
+        if ( rangeMin( 1, 0, nleaves, fams[i].ifirst, n ) < w )
+          continue;
+        rangeAdd( 1, 0, nleaves, fams[i].ifirst, n, -w );
+        m_discarded.insert( fams[i].key );
+        discarded[fams[i].ifirst] += w;
+      }
+
+      //Worst-case discarded fraction:
+      double sum = 0.0;
+      for ( std::size_t i = 0; i < n; ++i ) {
+        sum += discarded[i];
+        if ( i + 1 == n || fams[i+1].ifirst != fams[i].ifirst )
+          m_discardedFraction = std::max( m_discardedFraction, sum / total[i] );
+      }
+    }
+  };
+
   class StdScatFact : public FactImpl::ScatterFactory {
   public:
     const char * name() const noexcept final { return "stdscat"; }
@@ -131,8 +333,10 @@ namespace NCrystal {
       ///////////////////////////////////////////////////////////////////////////////////////////////////////////
       //Crystals: Incoherent-elastic component:
       if ( cfg.get_incoh_elas() && info.isCrystalline() ) {
-        if ( ElIncScatter::hasSufficientInfo(info) )
-          components.push_back({1.0,makeSO<ElIncScatter>(info)});
+        ElIncScatterCfg elinc_cfg;
+        elinc_cfg.use_tabulated_mu_sampling = ( cfg.get_elincsampler() == 1 );
+        if ( ElIncScatter::hasSufficientInfo(info, elinc_cfg) )
+          components.push_back({1.0,makeSO<ElIncScatter>(info,elinc_cfg)});
       }
 
       ///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -142,6 +346,10 @@ namespace NCrystal {
         if (cfg.isSingleCrystal()) {
           //TODO: factory function somewhere for this, so can be easily created directly in test-code?
           auto sc_pp = createStdPlaneProvider( cfg.infoPtr() );
+          if ( cfg.get_scprune() > 0.0 ) {
+            //Discard the weakest families of planes, within the tolerance:
+            sc_pp = std::make_unique<PlaneProviderWPruning>( cfg.get_scprune(), std::move(sc_pp) );
+          }
           PlaneProviderWCutOff* ppwcutoff(nullptr);
           if ( cfg.get_sccutoff() && cfg.get_sccutoff() > info.hklDMinVal() ) {
             //Improve efficiency by treating planes with dspacing less than
@@ -154,10 +362,10 @@ namespace NCrystal {
           SCOrientation sco = cfg.createSCOrientation();
           if (cfg.isLayeredCrystal()) {
             components.push_back({1.0,makeSO<LCBragg>( info, sco, cfg.get_mos(), cfg.get_lcaxis(), cfg.get_lcmode(),
-                                                       0,sc_pp.get(),cfg.get_mosprec(),0.0 )});
+                                                       0,sc_pp.get(),cfg.get_mosprec(),0.0,cfg.get_mosscreen() )});
           } else {
             components.push_back({1.0,makeSO<SCBragg>( info, sco,cfg.get_mos(),0.0,
-                                                       sc_pp.get(),cfg.get_mosprec(),0.)});
+                                                       sc_pp.get(),cfg.get_mosprec(),0.,cfg.get_mosscreen())});
 
 
           }
@@ -185,6 +393,7 @@ namespace NCrystal {
           ElIncScatterCfg elinc_cfg;
           elinc_cfg.use_sigma_incoherent = add_inc;
           elinc_cfg.use_sigma_coherent = add_coh;
+          elinc_cfg.use_tabulated_mu_sampling = ( cfg.get_elincsampler() == 1 );
           if ( ElIncScatter::hasSufficientInfo(info, elinc_cfg) )
             components.push_back({1.0,makeSO<ElIncScatter>(info,elinc_cfg)});
         }
@@ -209,6 +418,9 @@ namespace NCrystal {
         if ( !info.hasTemperature() )
           NCRYSTAL_THROW2(BadInput,"inelas="<<inelas<<" mode requires specification of material temperature");
 
+        const auto samplerAlg = static_cast<SAB::SamplerAlg>( cfg.get_sabsampler() );
+        const auto egridDensity = SAB::egridDensityFromCfgValue( cfg.get_sabgrid() );
+
         if ( inelas == "dyninfo" ) {
 
           if ( !info.hasDynamicInfo() )
@@ -237,7 +449,18 @@ namespace NCrystal {
           for (auto& di : info.getDynamicInfoList()) {
             const DI_ScatKnl* di_scatknl = dynamic_cast<const DI_ScatKnl*>(di.get());
             if (di_scatknl) {
-              components.push_back({di->fraction(),makeSO<SABScatter>(*di_scatknl, cfg.get_vdoslux(), true, vdos2sabExcludeFlag)});
+              const unsigned vdoslux = cfg.get_vdoslux();
+              if ( deferSABMode() ) {
+                //Keep the Info object (and thus the DI_ScatKnl) alive until needed:
+                auto infoptr = cfg.infoPtr();
+                SABScatter::HelperProducer producer = [infoptr,di_scatknl,vdoslux,vdos2sabExcludeFlag,samplerAlg,egridDensity]()
+                {
+                  return SABScatter::createHelper( *di_scatknl, vdoslux, true, vdos2sabExcludeFlag, samplerAlg, egridDensity );
+                };
+                components.push_back({di->fraction(),makeSO<SABScatter>(std::move(producer),deferSABMode()==2)});
+                continue;
+              }
+              components.push_back({di->fraction(),makeSO<SABScatter>(*di_scatknl, vdoslux, true, vdos2sabExcludeFlag, samplerAlg, egridDensity)});
             } else if (dynamic_cast<const DI_Sterile*>(di.get())) {
               continue;//just skip past sterile components
             } else if (dynamic_cast<const DI_FreeGas*>(di.get())) {
@@ -267,14 +490,23 @@ namespace NCrystal {
             ntot += ai.numberPerUnitCell();
           for ( auto& ai : info.getAtomInfos() ) {
             nc_assert_always( ai.debyeTemp().has_value() );
-            auto sabdata =  extractSABDataFromVDOSDebyeModel( ai.debyeTemp().value(),
-                                                              info.getTemperature(),
-                                                              ai.atomData().scatteringXS(),
-                                                              ai.atomData().averageMassAMU(),
-                                                              cfg.get_vdoslux() );
-            auto scathelper = SAB::createScatterHelperWithCache( std::move(sabdata) );
-            components.push_back({ai.numberPerUnitCell()*1.0/ntot,makeSO<SABScatter>(std::move(scathelper))});
-
+            const DebyeTemperature debyeTemp = ai.debyeTemp().value();
+            const Temperature temp = info.getTemperature();
+            const SigmaBound boundXS = ai.atomData().scatteringXS();
+            const AtomMass mass = ai.atomData().averageMassAMU();
+            const unsigned vdoslux = cfg.get_vdoslux();
+            SABScatter::HelperProducer producer = [debyeTemp,temp,boundXS,mass,vdoslux,egridDensity,samplerAlg]()
+            {
+              auto sabdata =  extractSABDataFromVDOSDebyeModel( debyeTemp, temp, boundXS, mass, vdoslux );
+              return SAB::createScatterHelperWithCache( std::move(sabdata),
+                                                        SAB::applyEGridDensity( nullptr, egridDensity ),
+                                                        samplerAlg );
+            };
+            const double fraction = ai.numberPerUnitCell()*1.0/ntot;
+            if ( deferSABMode() )
+              components.push_back({fraction,makeSO<SABScatter>(std::move(producer),deferSABMode()==2)});
+            else
+              components.push_back({fraction,makeSO<SABScatter>(producer())});
           }
         }
       }
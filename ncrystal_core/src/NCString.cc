@@ -23,6 +23,7 @@
 #include <istream>
 #include <iomanip>
 #include <cstdlib>
+#include <cstring>
 namespace NC = NCrystal;
 
 std::string NC::displayCharSafeQuoted( char ch, char quote_char )
@@ -437,6 +438,61 @@ std::vector<uint8_t> NC::hexstr2bytes(const std::string& v) {
   return res;
 }
 
+std::vector<uint8_t> NC::base64str2bytes(const std::string& v) {
+  //Lookup table with values of characters (64 for invalid characters):
+  struct Table {
+    unsigned char val[256];
+    Table() {
+      std::memset( val, 64, sizeof(val) );
+      const char * alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+      for ( unsigned i = 0; i < 64; ++i )
+        val[ static_cast<unsigned char>( alphabet[i] ) ] = static_cast<unsigned char>( i );
+    }
+  };
+  static const Table s_table;
+  std::size_t n = v.size();
+  unsigned npad = 0;
+  while ( n > 0 && v[n-1] == '=' && npad < 2 ) {
+    --n;
+    ++npad;
+  }
+  if ( ( npad > 0 && ( n + npad ) % 4 != 0 ) || n % 4 == 1 )
+    NCRYSTAL_THROW(BadInput, "Invalid length of base64 string");
+  std::vector<uint8_t> res( ( n * 3 ) / 4 );
+  const unsigned char * it = reinterpret_cast<const unsigned char*>( v.data() );
+  const unsigned char * itE = it + n;
+  uint8_t * out = res.data();
+  auto lookup = []( unsigned char c ) -> uint32_t
+  {
+    const unsigned char val = s_table.val[c];
+    if ( val == 64 )
+      NCRYSTAL_THROW2(BadInput, "Invalid character encountered in base64 string: "
+                      <<displayCharSafeQuoted(static_cast<char>(c)));
+    return val;
+  };
+  //Full groups of 4 characters -> 3 bytes:
+  for ( ; itE - it >= 4; it += 4 ) {
+    const uint32_t w = ( lookup(it[0]) << 18 ) | ( lookup(it[1]) << 12 ) | ( lookup(it[2]) << 6 ) | lookup(it[3]);
+    *out++ = static_cast<uint8_t>( w >> 16 );
+    *out++ = static_cast<uint8_t>( ( w >> 8 ) & 0xFF );
+    *out++ = static_cast<uint8_t>( w & 0xFF );
+  }
+  //Final partial group (2 or 3 characters -> 1 or 2 bytes):
+  if ( it != itE ) {
+    uint32_t w = ( lookup(it[0]) << 18 ) | ( lookup(it[1]) << 12 );
+    if ( itE - it == 3 )
+      w |= ( lookup(it[2]) << 6 );
+    const unsigned nbytes = static_cast<unsigned>( itE - it ) - 1;
+    if ( ( w & ( nbytes == 1 ? 0xFFFFu : 0xFFu ) ) != 0 )
+      NCRYSTAL_THROW(BadInput, "Invalid trailing bits in base64 string");
+    *out++ = static_cast<uint8_t>( w >> 16 );
+    if ( nbytes == 2 )
+      *out++ = static_cast<uint8_t>( ( w >> 8 ) & 0xFF );
+  }
+  nc_assert_always( out == res.data() + res.size() );
+  return res;
+}
+
 void NC::streamJSON( std::ostream& os, double val )
 {
   if ( ncisnan( val ) )
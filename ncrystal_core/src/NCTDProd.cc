@@ -21,62 +21,134 @@
 #include "NCrystal/NCFactImpl.hh"
 #include "NCrystal/internal/NCFileUtils.hh"
 #include "NCrystal/internal/NCString.hh"
+#include <list>
+#include <unordered_map>
 
 namespace NCrystal {
 
   namespace FactImpl {
 
-    template<std::size_t NCACHED>
     class TDProdDB {
     public:
+
+      //Store of TextData objects, allowing identical data to be provided via
+      //the same TextDataSP object (and thus with the same UID, which is used as
+      //a key in downstream caches). Objects are looked up via a hash-map on the
+      //data checksum. The nstrong most recently used objects are kept alive
+      //by the store itself (with proper LRU ordering), while all other objects
+      //are only weakly referenced, and are thus still found for as long as
+      //they are alive elsewhere. Expired weak references are swept out
+      //periodically, so the lookup cost stays O(1) even when many thousands
+      //of objects are produced.
+
+      TDProdDB( std::size_t nstrong ) : m_nstrong( std::max<std::size_t>( nstrong, 1 ) ) {}
+
       TextDataSP produceTextDataSP_PreferPreviousObject( TextData&& newtd )
       {
         nc_assert(newtd.dataUID().isUnset());
         uint64_t checkSum = newtd.rawData().calcCheckSum();
 
-        auto it = m_db.begin();
-        auto itE = m_db.end();
-
-        //First check if we have a compatible object already:
-        for ( ; it != itE; ++it ) {
-          if ( it->first == checkSum
-               && newtd.hasIdenticalMetaData(it->second)
-               && newtd.rawData().hasSameContent( it->second->rawData() ) )
+        //First check if we have a compatible object already. Objects with
+        //memory-mapped data whose file was modified since are not reused (nor
+        //read, as that might crash if the file was truncated), but forgotten:
+        auto range = m_index.equal_range( checkSum );
+        for ( auto it = range.first; it != range.second; ) {
+          OptionalTextDataSP existing = it->second.wp.lock();
+          if ( existing != nullptr && !mappedFileIsUnchanged( existing->rawData() ) ) {
+            if ( it->second.inLRU )
+              m_lru.erase( it->second.lruPos );
+            it = m_index.erase(it);
+            continue;
+          }
+          if ( existing != nullptr
+               && newtd.hasIdenticalMetaData(*existing)
+               && newtd.rawData().hasSameContent( existing->rawData() ) )
             {
-              break;//Found!
+              //Found!
+              TextDataSP result(std::move(existing));
+              markAsRecentlyUsed( it->second, result );
+              return result;
             }
+          ++it;
         }
-        if ( it == itE ) {
-          //Did not find existing. Finalize new TextData object construction by
-          //actually assigning a UID, then insert in cache:
-          auto newtdsp = makeSO<const TextData>(TextData::internal_consumeAndSetNewUID(std::move(newtd)));
-
-          if ( m_db.size() == NCACHED ) {
-            //Must first discard existing entry to make room:
-            auto itLast = std::prev(m_db.end());
-            for ( auto it2 = m_db.begin(); it2 != itLast; ++it2 )
-              *it2 = std::move( *std::next(it2) );
-            m_db.pop_back();
+
+        //Did not find existing. Finalize new TextData object construction by
+        //actually assigning a UID, then insert in cache:
+        auto newtdsp = makeSO<const TextData>(TextData::internal_consumeAndSetNewUID(std::move(newtd)));
+        if ( m_index.size() >= m_nextSweep )
+          sweepExpired();
+        auto itNew = m_index.emplace( checkSum, Entry() );
+        itNew->second.wp = newtdsp.getsp();
+        markAsRecentlyUsed( itNew->second, newtdsp );
+        return newtdsp;
+      }
+
+      void clear()
+      {
+        m_lru.clear();
+        m_index.clear();
+        m_nextSweep = minSweepSize();
+      }
+
+      void evict( const std::function<bool(const TextData&)>& pred, std::set<TextDataUID>& evicted_uids )
+      {
+        //Forget the alive objects for which pred returns true:
+        for ( auto it = m_index.begin(); it != m_index.end(); ) {
+          OptionalTextDataSP existing = it->second.wp.lock();
+          if ( existing == nullptr || !pred( *existing ) ) {
+            ++it;
+            continue;
           }
-          //add to back (which is the correct position indicating most recent
-          //access):
-          m_db.push_back(std::pair<uint64_t,TextDataSP>(checkSum,newtdsp));
-          return newtdsp;
-        } else {
-          //Found existing! But before returning we need to reorder entries,
-          //moving the requested entry to the back and sliding the other ones
-          //down to make room:
-          TextDataSP result(std::move(it->second));
-          auto itLast = std::prev(m_db.end());
-          for ( auto it2 = it; it2 != itLast; ++it2 )
-            *it2 = std::move( *std::next(it2) );
-          *itLast = std::pair<uint64_t,TextDataSP>(checkSum,result);
-          return result;
+          evicted_uids.insert( existing->dataUID() );
+          if ( it->second.inLRU )
+            m_lru.erase( it->second.lruPos );
+          it = m_index.erase(it);
         }
       }
-      void clear() { m_db.clear(); }
+
     private:
-      SmallVector<std::pair<uint64_t,TextDataSP>,NCACHED> m_db;
+      struct Entry;
+      using LRUList = std::list<std::pair<TextDataSP,Entry*>>;
+      struct Entry {
+        std::weak_ptr<const TextData> wp;
+        LRUList::iterator lruPos;
+        bool inLRU = false;
+      };
+      //NB: Pointers to Entry objects remain valid upon rehashing:
+      std::unordered_multimap<uint64_t,Entry> m_index;
+      LRUList m_lru;//least recently used first
+      std::size_t m_nstrong;
+      std::size_t m_nextSweep = minSweepSize();
+
+      std::size_t minSweepSize() const { return 2*m_nstrong + 16; }
+
+      void markAsRecentlyUsed( Entry& entry, const TextDataSP& td )
+      {
+        if ( entry.inLRU ) {
+          m_lru.splice( m_lru.end(), m_lru, entry.lruPos );
+          return;
+        }
+        m_lru.emplace_back( td, &entry );
+        entry.lruPos = std::prev( m_lru.end() );
+        entry.inLRU = true;
+        while ( m_lru.size() > m_nstrong ) {
+          m_lru.front().second->inLRU = false;
+          m_lru.pop_front();//only weakly referenced from now on
+        }
+      }
+
+      void sweepExpired()
+      {
+        for ( auto it = m_index.begin(); it != m_index.end(); ) {
+          if ( !it->second.inLRU && it->second.wp.expired() )
+            it = m_index.erase(it);
+          else
+            ++it;
+        }
+        //Sweep again when the index has doubled in size, so the amortised cost
+        //of sweeping is constant per insertion:
+        m_nextSweep = std::max( minSweepSize(), 2*m_index.size() );
+      }
     };
 
     class TDProd {
@@ -87,9 +159,12 @@ namespace NCrystal {
 #else
       static constexpr std::size_t very_large_threshold_nBytes = 1000000000000000ull;//1000TB (!!)
 #endif
-      TDProdDB<200> m_db_small;//in hypothetical extreme case this can retain 100kB*200 = 20MB
-      TDProdDB<10> m_db_large;//in hypothetical extreme case this can retain 10MB*10 = 100MB
-      TDProdDB<3> m_db_veryLarge;//max kept is 500MB*3=1.5GB (but the user really asked for it!)
+      //Number of objects kept alive in the three stores. The number of small
+      //objects can be modified with the NCRYSTAL_TEXTDATA_CACHE_SIZE
+      //environment variable:
+      TDProdDB m_db_small{ static_cast<std::size_t>( std::max<int>( 1, ncgetenv_int("TEXTDATA_CACHE_SIZE",200) ) ) };//by default this can retain 200kB*200 = 40MB
+      TDProdDB m_db_large{ 10 };//in hypothetical extreme case this can retain 10MB*10 = 100MB
+      TDProdDB m_db_veryLarge{ 3 };//max kept is 500MB*3=1.5GB (but the user really asked for it!)
     public:
       void clear()
       {
@@ -98,6 +173,13 @@ namespace NCrystal {
         m_db_veryLarge.clear();
       }
 
+      void evict( const std::function<bool(const TextData&)>& pred, std::set<TextDataUID>& evicted_uids )
+      {
+        m_db_small.evict( pred, evicted_uids );
+        m_db_large.evict( pred, evicted_uids );
+        m_db_veryLarge.evict( pred, evicted_uids );
+      }
+
       static TextData produceTextDataWithoutCache( const TextDataPath& textdatapath, TextDataSource&& tds )
       {
         std::string dataType = tds.dataType();
@@ -123,10 +205,15 @@ namespace NCrystal {
             path = std::move(pn);
 
           lastKnownOnDiskPath = TextData::LastKnownOnDiskAbsPath{path};
-          Optional<std::string> content = readEntireFileToString( lastKnownOnDiskPath.value().value );
-          if ( !content.has_value() )
-            NCRYSTAL_THROW2(DataLoadError,"Missing or unreadable file: "<<path);
-          rawdata = RawStrData(std::move(content.value()));
+          //Large files are memory-mapped when possible, rather than copied:
+          constexpr std::size_t mmap_min_size = 1048576;
+          rawdata = tryMapFileToRawStrData( lastKnownOnDiskPath.value().value, mmap_min_size );
+          if ( !rawdata.has_value() ) {
+            Optional<std::string> content = readEntireFileToString( lastKnownOnDiskPath.value().value );
+            if ( !content.has_value() )
+              NCRYSTAL_THROW2(DataLoadError,"Missing or unreadable file: "<<path);
+            rawdata = RawStrData(std::move(content.value()));
+          }
 
         } else {
           nc_assert( data.has_value<RawStrData>() );
@@ -198,5 +285,14 @@ namespace NCrystal {
       return db.db.produceTextDataSP_PreferPreviousObject( std::move(td) );
     }
 
+    std::set<TextDataUID> evictFromTextDataStore( const std::function<bool(const TextData&)>& pred )
+    {
+      std::set<TextDataUID> evicted_uids;
+      auto& db = globalTDProd();
+      NCRYSTAL_LOCK_GUARD(db.mtx);
+      db.db.evict( pred, evicted_uids );
+      return evicted_uids;
+    }
+
   }
 }
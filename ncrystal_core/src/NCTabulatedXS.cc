@@ -0,0 +1,446 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/internal/NCTabulatedXS.hh"
+#include "NCrystal/internal/NCPCBragg.hh"
+#include "NCrystal/internal/NCMath.hh"
+#include "NCrystal/internal/NCString.hh"
+#include "NCrystal/NCFactImpl.hh"
+#include "NCrystal/NCVersion.hh"
+#include <atomic>
+#include <cstring>
+#include <fstream>
+
+namespace NC = NCrystal;
+namespace NCPI = NCrystal::ProcImpl;
+
+namespace NCrystal {
+  namespace {
+
+    constexpr char magic[8] = { 'N','C','X','S','T','A','B','\0' };
+    constexpr uint64_t byteOrderMarker = 0x0102030405060708ull;
+
+    struct FileHeader {
+      char magic[8];
+      uint64_t formatVersion;
+      uint64_t ncrystalVersion;//informational only
+      uint64_t byteOrderMarker;
+      uint64_t cfgstrSize;
+      uint64_t namesSize;
+      uint64_t ncomp;
+      uint64_t negrid;
+      double tolerance;
+      double maxRelError;
+    };
+    static_assert( sizeof(FileHeader) == 10*8, "" );
+
+    std::size_t paddedSize( std::size_t n )
+    {
+      return ( ( n + 7 ) / 8 ) * 8;
+    }
+
+    void collectComponents( const NCPI::ProcPtr& proc, double scale,
+                            std::vector<NCPI::ProcComposition::Component>& out )
+    {
+      auto pc = dynamic_cast<const NCPI::ProcComposition*>( proc.get() );
+      if ( pc ) {
+        for ( auto& c : pc->components() )
+          collectComponents( c.process, scale * c.scale, out );
+        return;
+      }
+      if ( !proc->isNull() && scale > 0.0 )
+        out.emplace_back( scale, proc );
+    }
+
+    //Index i of the grid interval [egrid[i],egrid[i+1]] to use for
+    //interpolation at ekin (which must be inside the grid), and the fraction t
+    //for interpolation in it. At steps (repeated grid points are not possible,
+    //but the points on each side of a step are adjacent doubles), the interval
+    //above the step is used, as for the exact processes:
+    std::pair<std::size_t,double> findBin( const VectD& egrid, double ekin )
+    {
+      nc_assert( egrid.size() >= 2 && ekin >= egrid.front() && ekin <= egrid.back() );
+      std::size_t i = std::upper_bound( egrid.begin(), egrid.end(), ekin ) - egrid.begin();
+      i = ( i == 0 ? 0 : std::min<std::size_t>( i - 1, egrid.size() - 2 ) );
+      const double e0 = egrid[i];
+      return { i, ( ekin - e0 ) / ( egrid[i+1] - e0 ) };
+    }
+
+    template<class T>
+    void writeRaw( std::ostream& os, const T* src, std::size_t n )
+    {
+      os.write( reinterpret_cast<const char*>(src), n * sizeof(T) );
+    }
+
+    template<class T>
+    void readRaw( std::istream& is, T* dest, std::size_t n )
+    {
+      is.read( reinterpret_cast<char*>(dest), n * sizeof(T) );
+    }
+
+  }
+}
+
+NC::VectD NC::TabulatedXSData::totalXS() const
+{
+  VectD res( egrid.size(), 0.0 );
+  for ( auto& c : components ) {
+    nc_assert_always( c.xs.size() == egrid.size() );
+    for ( auto i : ncrange( egrid.size() ) )
+      res[i] += c.xs[i];
+  }
+  return res;
+}
+
+NC::TabulatedXSData NC::tabulateXS( ProcImpl::ProcPtr proc,
+                                    const ProcImpl::ProcCompTabulationCfg& cfg_orig,
+                                    std::string cfgstr )
+{
+  if ( proc->isOriented() )
+    NCRYSTAL_THROW(BadInput,"tabulateXS can only be used with isotropic processes");
+  if ( proc->processType() != ProcessType::Scatter )
+    NCRYSTAL_THROW(BadInput,"tabulateXS can only be used with scattering processes");
+
+  std::vector<NCPI::ProcComposition::Component> components;
+  collectComponents( proc, 1.0, components );
+
+  TabulatedXSData res;
+  res.cfgstr = std::move(cfgstr);
+  res.tolerance = cfg_orig.tolerance;
+  if ( components.empty() )
+    return res;
+
+  //Initial grid, with steps at the Bragg edges:
+  ProcImpl::ProcCompTabulationCfg cfg = cfg_orig;
+  if ( cfg.egrid.empty() ) {
+    const double emin = cfg.emin.dbl();
+    const double emax = cfg.emax.dbl();
+    if ( emin > 0.0 && emax > emin && !std::isinf(emax) && cfg.ndecade >= 1 ) {
+      const double ndecades = std::log10( emax / emin );
+      cfg.egrid = logspace( std::log10(emin), std::log10(emax),
+                            std::max<unsigned>( 2, static_cast<unsigned>( std::ceil( ndecades * cfg.ndecade ) ) + 1 ) );
+    }
+  }
+  for ( auto& c : components ) {
+    auto pcbragg = dynamic_cast<const PCBragg*>( c.process.get() );
+    if ( !pcbragg )
+      continue;
+    for ( auto e : pcbragg->get2dE() ) {
+      cfg.egrid.push_back( e );
+      cfg.egrid.push_back( std::nextafter( e, 0.0 ) );
+    }
+  }
+  res.egrid = NCPI::ProcComposition::createTabulated( proc, cfg )->tabulatedEnergyGrid();
+  nc_assert_always( res.egrid.size() >= 2 );
+
+  //Cross sections are evaluated exactly at the grid points:
+  const std::size_t negrid = res.egrid.size();
+  for ( auto& c : components ) {
+    res.components.emplace_back();
+    auto& rc = res.components.back();
+    rc.name = c.process->name();
+    rc.xs.reserve( negrid );
+    CachePtr cacheptr;
+    for ( auto e : res.egrid )
+      rc.xs.push_back( c.scale * c.process->crossSectionIsotropic( cacheptr, NeutronEnergy{e} ).dbl() );
+  }
+
+  //Error estimates from interior points of the grid intervals (the same points
+  //as used for refinement in createTabulated, ignoring the narrowest
+  //intervals, which are either known Bragg edges or other steps resolved to
+  //the limit of createTabulated):
+  constexpr unsigned ntestdiv = 8;
+  std::vector<CachePtr> cacheptrs( components.size() );
+  for ( std::size_t i = 0; i + 1 < negrid; ++i ) {
+    const double e0 = res.egrid[i];
+    const double e1 = res.egrid[i+1];
+    if ( e1 - e0 < 1e-9 * e0 )
+      continue;
+    for ( unsigned k = 1; k < ntestdiv; ++k ) {
+      const double e = e0 * std::pow( e1 / e0, double(k) / ntestdiv );
+      const double t = ( e - e0 ) / ( e1 - e0 );
+      double exact_total = 0.0;
+      double err_total = 0.0;
+      for ( auto ic : ncrange( components.size() ) ) {
+        auto& c = components[ic];
+        auto& rc = res.components[ic];
+        const double xs = c.scale * c.process->crossSectionIsotropic( cacheptrs[ic], NeutronEnergy{e} ).dbl();
+        const double err = ncabs( rc.xs[i] + t * ( rc.xs[i+1] - rc.xs[i] ) - xs );
+        rc.maxAbsError = std::max( rc.maxAbsError, err );
+        exact_total += xs;
+        err_total += err;
+      }
+      if ( err_total > 0.0 )
+        res.maxRelError = std::max( res.maxRelError,
+                                    exact_total > 0.0 ? err_total / exact_total : 1.0 );
+    }
+  }
+  return res;
+}
+
+void NC::exportTabulatedXS( const std::string& cfgstr, const std::string& filename,
+                            const ProcImpl::ProcCompTabulationCfg& cfg )
+{
+  MatCfg matcfg( cfgstr );
+  writeTabulatedXS( tabulateXS( FactImpl::createScatter( matcfg ), cfg, matcfg.toStrCfg() ), filename );
+}
+
+void NC::writeTabulatedXS( const TabulatedXSData& data, const std::string& filename )
+{
+  std::string names;
+  for ( auto& c : data.components ) {
+    if ( c.xs.size() != data.egrid.size() )
+      NCRYSTAL_THROW(BadInput,"writeTabulatedXS: inconsistent table sizes");
+    names.append( c.name.c_str(), c.name.size() + 1 );
+  }
+  FileHeader hdr;
+  std::memcpy( hdr.magic, magic, sizeof(magic) );
+  hdr.formatVersion = tabulatedXSFormatVersion;
+  hdr.ncrystalVersion = static_cast<uint64_t>(NCRYSTAL_VERSION);
+  hdr.byteOrderMarker = byteOrderMarker;
+  hdr.cfgstrSize = data.cfgstr.size();
+  hdr.namesSize = names.size();
+  hdr.ncomp = data.components.size();
+  hdr.negrid = data.egrid.size();
+  hdr.tolerance = data.tolerance;
+  hdr.maxRelError = data.maxRelError;
+
+  std::ofstream fh( filename, std::ios::binary | std::ios::trunc );
+  if ( !fh.good() )
+    NCRYSTAL_THROW2(FileNotFound,"Could not open file for writing: \""<<filename<<"\"");
+  writeRaw( fh, &hdr, 1 );
+  std::string cfgstrPadded = data.cfgstr;
+  cfgstrPadded.resize( paddedSize( cfgstrPadded.size() ), '\0' );
+  writeRaw( fh, cfgstrPadded.data(), cfgstrPadded.size() );
+  names.resize( paddedSize( names.size() ), '\0' );
+  writeRaw( fh, names.data(), names.size() );
+  writeRaw( fh, data.egrid.data(), data.egrid.size() );
+  for ( auto& c : data.components )
+    writeRaw( fh, c.xs.data(), c.xs.size() );
+  for ( auto& c : data.components )
+    writeRaw( fh, &c.maxAbsError, 1 );
+  fh.close();
+  if ( !fh.good() )
+    NCRYSTAL_THROW2(CalcError,"Problems writing file: \""<<filename<<"\"");
+}
+
+NC::TabulatedXSData NC::readTabulatedXS( const std::string& filename )
+{
+  std::ifstream fh( filename, std::ios::binary );
+  if ( !fh.good() )
+    NCRYSTAL_THROW2(FileNotFound,"Could not open file: \""<<filename<<"\"");
+  auto badFile = [&filename]( const char * reason )
+  {
+    NCRYSTAL_THROW2(BadInput,"Invalid cross section table file \""<<filename<<"\": "<<reason);
+  };
+  FileHeader hdr;
+  readRaw( fh, &hdr, 1 );
+  if ( !fh.good() || std::memcmp( hdr.magic, magic, sizeof(magic) ) != 0 )
+    badFile("not a cross section table");
+  if ( hdr.byteOrderMarker != byteOrderMarker )
+    badFile("written on a machine with a different byte order");
+  if ( hdr.formatVersion != tabulatedXSFormatVersion )
+    badFile("unsupported format version");
+  if ( hdr.cfgstrSize > 1000000 || hdr.namesSize > 1000000 || hdr.ncomp > 10000
+       || hdr.negrid == 1 || hdr.negrid > 100000000 || ( hdr.ncomp > 0 ) != ( hdr.negrid > 0 ) )
+    badFile("invalid header");
+
+  TabulatedXSData res;
+  res.tolerance = hdr.tolerance;
+  res.maxRelError = hdr.maxRelError;
+  std::string buf( paddedSize( hdr.cfgstrSize ), '\0' );
+  readRaw( fh, &buf[0], buf.size() );
+  res.cfgstr = buf.substr( 0, hdr.cfgstrSize );
+  buf.assign( paddedSize( hdr.namesSize ), '\0' );
+  readRaw( fh, &buf[0], buf.size() );
+  buf.resize( hdr.namesSize );
+  const std::size_t ncomp = static_cast<std::size_t>( hdr.ncomp );
+  const std::size_t negrid = static_cast<std::size_t>( hdr.negrid );
+  res.components.resize( ncomp );
+  std::size_t ipos = 0;
+  for ( auto& c : res.components ) {
+    const std::size_t iend = buf.find( '\0', ipos );
+    if ( iend == std::string::npos )
+      badFile("invalid component names");
+    c.name = buf.substr( ipos, iend - ipos );
+    ipos = iend + 1;
+  }
+  if ( ipos != buf.size() )
+    badFile("invalid component names");
+  res.egrid.resize( negrid );
+  readRaw( fh, res.egrid.data(), negrid );
+  for ( auto& c : res.components ) {
+    c.xs.resize( negrid );
+    readRaw( fh, c.xs.data(), negrid );
+  }
+  for ( auto& c : res.components )
+    readRaw( fh, &c.maxAbsError, 1 );
+  if ( !fh.good() || fh.peek() != std::char_traits<char>::eof() )
+    badFile("unexpected file size");
+  for ( std::size_t i = 1; i < negrid; ++i )
+    if ( !( res.egrid[i] > res.egrid[i-1] ) )
+      badFile("energy grid is not increasing");
+  if ( negrid && !( res.egrid.front() > 0.0 ) )
+    badFile("energy grid is not positive");
+  return res;
+}
+
+struct NC::TabulatedXSProcess::Delegate {
+  std::mutex mtx;
+  ProcImpl::OptionalProcPtr proc;
+  std::atomic<const Process*> procraw{nullptr};
+};
+
+NC::TabulatedXSProcess::TabulatedXSProcess( TabulatedXSData&& data )
+  : m_data( std::move(data) ),
+    m_total( m_data.totalXS() ),
+    m_delegate( std::make_unique<Delegate>() )
+{
+  if ( m_data.egrid.size() == 1 )
+    NCRYSTAL_THROW(BadInput,"TabulatedXSProcess: energy grid must have at least two points");
+}
+
+NC::TabulatedXSProcess::TabulatedXSProcess( TabulatedXSData&& data, ProcImpl::ProcPtr fullProcess )
+  : TabulatedXSProcess( std::move(data) )
+{
+  if ( fullProcess->isOriented() || fullProcess->processType() != ProcessType::Scatter )
+    NCRYSTAL_THROW(BadInput,"TabulatedXSProcess: full process must be an isotropic scattering process");
+  m_delegate->procraw = fullProcess.get();
+  m_delegate->proc = std::move(fullProcess);
+}
+
+NC::TabulatedXSProcess::~TabulatedXSProcess() = default;
+
+const NCPI::Process& NC::TabulatedXSProcess::fullProcess() const
+{
+  auto& d = *m_delegate;
+  const Process * p = d.procraw.load( std::memory_order_acquire );
+  if ( p )
+    return *p;
+  NCRYSTAL_LOCK_GUARD( d.mtx );
+  if ( !d.proc ) {
+    if ( m_data.cfgstr.empty() )
+      NCRYSTAL_THROW(CalcError,"TabulatedXSProcess: sampling and cross sections outside the"
+                     " tabulated energy range need the full process, but the table has no cfg-string");
+    auto proc = FactImpl::createScatter( MatCfg( m_data.cfgstr ) );
+    if ( proc->isOriented() )
+      NCRYSTAL_THROW(BadInput,"TabulatedXSProcess: full process is not isotropic");
+    d.proc = std::move(proc);
+    d.procraw.store( d.proc.get(), std::memory_order_release );
+  }
+  return *d.proc;
+}
+
+NC::CrossSect NC::TabulatedXSProcess::crossSectionIsotropic( CachePtr& cp, NeutronEnergy ekin ) const
+{
+  const double e = ekin.dbl();
+  if ( m_data.egrid.empty() )
+    return CrossSect{ 0.0 };
+  if ( !( e >= m_data.egrid.front() && e <= m_data.egrid.back() ) )
+    return fullProcess().crossSectionIsotropic( cp, ekin );
+  auto bin = findBin( m_data.egrid, e );
+  const double * c = &m_total[bin.first];
+  return CrossSect{ c[0] + bin.second * ( c[1] - c[0] ) };
+}
+
+void NC::TabulatedXSProcess::crossSectionIsotropicMany( CachePtr& cp, const double* ekin,
+                                                        std::size_t N, double* out_xs ) const
+{
+  for ( std::size_t i = 0; i < N; ++i )
+    out_xs[i] = crossSectionIsotropic( cp, NeutronEnergy{ ekin[i] } ).dbl();
+}
+
+NC::ScatterOutcomeIsotropic NC::TabulatedXSProcess::sampleScatterIsotropic( CachePtr& cp, RNG& rng,
+                                                                            NeutronEnergy ekin ) const
+{
+  if ( m_data.egrid.empty() )
+    return { ekin, CosineScatAngle{1.0} };
+  return fullProcess().sampleScatterIsotropic( cp, rng, ekin );
+}
+
+NC::ScatterOutcome NC::TabulatedXSProcess::sampleScatter( CachePtr& cp, RNG& rng, NeutronEnergy ekin,
+                                                          const NeutronDirection& indir ) const
+{
+  if ( m_data.egrid.empty() )
+    return { ekin, indir };
+  return fullProcess().sampleScatter( cp, rng, ekin, indir );
+}
+
+void NC::TabulatedXSProcess::sampleScatterIsotropicMany( CachePtr& cp, RNG& rng, const double* ekin,
+                                                         std::size_t N, ScatterOutcomeIsotropic* out ) const
+{
+  if ( m_data.egrid.empty() ) {
+    for ( std::size_t i = 0; i < N; ++i )
+      out[i] = { NeutronEnergy{ ekin[i] }, CosineScatAngle{1.0} };
+    return;
+  }
+  fullProcess().sampleScatterIsotropicMany( cp, rng, ekin, N, out );
+}
+
+void NC::TabulatedXSProcess::sampleScatterMany( CachePtr& cp, RNG& rng, const double* ekin,
+                                                const NeutronDirection* dirs,
+                                                std::size_t N, ScatterOutcome* out ) const
+{
+  if ( m_data.egrid.empty() ) {
+    for ( std::size_t i = 0; i < N; ++i )
+      out[i] = { NeutronEnergy{ ekin[i] }, dirs[i] };
+    return;
+  }
+  fullProcess().sampleScatterMany( cp, rng, ekin, dirs, N, out );
+}
+
+std::size_t NC::TabulatedXSProcess::memoryFootprint() const
+{
+  std::size_t res = sizeof(TabulatedXSProcess) + sizeof(Delegate)
+    + ( m_data.egrid.capacity() + m_total.capacity() ) * sizeof(double)
+    + m_data.cfgstr.capacity();
+  for ( auto& c : m_data.components )
+    res += sizeof(c) + c.name.capacity() + c.xs.capacity() * sizeof(double);
+  //NB: The full process is owned by the factory caches, and is not included.
+  return res;
+}
+
+NC::Optional<std::string> NC::TabulatedXSProcess::specificJSONDescription() const
+{
+  std::ostringstream ss;
+  {
+    std::ostringstream tmp;
+    tmp << "npts="<<m_data.egrid.size()
+        << ";ncomp="<<m_data.components.size()
+        << ";maxrelerr="<<fmt(m_data.maxRelError);
+    streamJSONDictEntry( ss, "summarystr", tmp.str(), JSONDictPos::FIRST );
+  }
+  streamJSONDictEntry( ss, "cfgstr", m_data.cfgstr );
+  streamJSONDictEntry( ss, "npts", m_data.egrid.size() );
+  streamJSONDictEntry( ss, "emin", m_data.emin() );
+  streamJSONDictEntry( ss, "emax", m_data.emax() );
+  VectS names;
+  for ( auto& c : m_data.components )
+    names.push_back( c.name );
+  streamJSONDictEntry( ss, "componentNames", names );
+  streamJSONDictEntry( ss, "tolerance", m_data.tolerance );
+  streamJSONDictEntry( ss, "maxRelError", m_data.maxRelError, JSONDictPos::LAST );
+  return ss.str();
+}
+
+NC::shared_obj<const NC::TabulatedXSProcess> NC::loadTabulatedXS( const std::string& filename )
+{
+  return makeSO<const TabulatedXSProcess>( readTabulatedXS( filename ) );
+}
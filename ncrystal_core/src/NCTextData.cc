@@ -19,6 +19,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "NCrystal/NCTextData.hh"
+#include "NCrystal/internal/NCTextDataLines.hh"
 #include "NCrystal/internal/NCString.hh"
 #include "NCrystal/internal/NCFileUtils.hh"
 #include <sstream>
@@ -89,6 +90,24 @@ void NC::TextData::Iterator::setup() {
     ++m_nextData;
 }
 
+void NC::TextDataLines::Iterator::setup() {
+  if ( *m_data == '\0' ) {
+    //already at end:
+    m_nextData = m_data;
+    m_line = StrView( m_data, 0 );
+    return;
+  }
+  const char * e = m_nextData = findNextNR0(m_data);
+  //Exclude \r, \n or \r\n chars from the view:
+  if ( *e == '\n' && e != m_data && *std::prev(e) == '\r' )
+    --e;
+  m_line = StrView( m_data, static_cast<StrView::size_type>( std::distance(m_data,e) ) );
+  //Make sure m_nextData points at the beginning of the next line (or the final
+  //\0 char):
+  if ( *m_nextData != '\0' )
+    ++m_nextData;
+}
+
 void NC::TextData::verifyOnDiskFileUnchanged() const
 {
   if ( !m_optOnDisk.has_value() )
@@ -170,6 +189,21 @@ NC::TextData::TextData( internal_with_unset_textdatauid_t, RawStrData data,
   }
 }
 
+NC::RawStrData::RawStrData( external_owner_t, std::shared_ptr<const void> owner,
+                            const char * dataBegin, const char * dataEnd,
+                            const char * srcdescr )
+  : m_b(dataBegin), m_e(dataEnd), m_owner(std::move(owner))
+{
+  nc_assert_always( m_owner != nullptr && m_b != nullptr && m_e >= m_b && *m_e == '\0' );
+  if ( std::strlen( m_b ) != (std::size_t)( m_e - m_b ) ) {
+    //Some extraneous null character must have spoiled it!
+    NCRYSTAL_THROW2(BadInput,"Invalid text data"
+                    <<(srcdescr?" in ":"")
+                    <<(srcdescr?srcdescr:"")
+                    <<": Data is not in UTF-8 or ASCII format.");
+  }
+}
+
 NC::RawStrData::RawStrData( shared_obj<std::string> d, const char * srcdescr )
   : m_s( std::move(d) )
 {
@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/internal/NCThreadUtils.hh"
+#ifndef NCRYSTAL_DISABLE_THREADS
+#  include <condition_variable>
+#  include <deque>
+#endif
+
+namespace NC = NCrystal;
+
+#ifndef NCRYSTAL_DISABLE_THREADS
+namespace NCrystal {
+  namespace {
+    //Never destroyed (see queueBackgroundTask), so the worker threads are
+    //detached and simply stop picking up new tasks once stop() was called:
+    class BackgroundTaskPool : private NoCopyMove {
+    public:
+      void stop()
+      {
+        //Discard pending tasks, but do not wait for running tasks:
+        {
+          std::lock_guard<std::mutex> lock(m_mtx);
+          m_stop = true;
+          m_tasks.clear();
+        }
+        m_cv.notify_all();
+      }
+
+      void queue( std::function<void()> task, unsigned maxThreads )
+      {
+        {
+          std::lock_guard<std::mutex> lock(m_mtx);
+          if ( m_stop )
+            return;
+          m_tasks.push_back( std::move(task) );
+          //Grow pool if all threads are busy:
+          if ( m_nIdle == 0 && m_nThreads < std::max<unsigned>( 1, maxThreads ) ) {
+            std::thread( [this](){ this->workerLoop(); } ).detach();
+            ++m_nThreads;
+          }
+        }
+        m_cv.notify_one();
+      }
+
+    private:
+      std::mutex m_mtx;
+      std::condition_variable m_cv;
+      std::deque<std::function<void()>> m_tasks;
+      unsigned m_nThreads = 0;
+      unsigned m_nIdle = 0;
+      bool m_stop = false;
+
+      void workerLoop()
+      {
+        std::unique_lock<std::mutex> lock(m_mtx);
+        while ( true ) {
+          ++m_nIdle;
+          m_cv.wait( lock, [this](){ return m_stop || !m_tasks.empty(); } );
+          --m_nIdle;
+          if ( m_stop )
+            return;
+          auto task = std::move( m_tasks.front() );
+          m_tasks.pop_front();
+          lock.unlock();
+          task();
+          lock.lock();
+        }
+      }
+    };
+  }
+}
+#endif
+
+void NC::queueBackgroundTask( std::function<void()> task, unsigned maxThreads )
+{
+#ifndef NCRYSTAL_DISABLE_THREADS
+  //The pool is intentionally leaked, since joining threads during static
+  //destruction could block (or deadlock) the programme exit. Instead, pending
+  //tasks are discarded when the guard below is destroyed:
+  static BackgroundTaskPool * s_pool = new BackgroundTaskPool;
+  struct StopAtExit { ~StopAtExit() { s_pool->stop(); } };
+  static StopAtExit s_stopAtExit;
+  s_pool->queue( std::move(task), maxThreads );
+#else
+  (void)maxThreads;
+  task();
+#endif
+}
@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/internal/NCTraceZones.hh"
+
+namespace NC = NCrystal;
+
+std::atomic<const NC::Trace::detail::Hooks*> NC::Trace::detail::s_activeHooks( nullptr );
+
+bool NC::Trace::isCompiledIn()
+{
+#ifdef NCRYSTAL_ENABLE_TRACING
+  return true;
+#else
+  return false;
+#endif
+}
+
+void NC::Trace::setHooks( BeginZoneFct beginZone, EndZoneFct endZone, void * userdata,
+                          bool includeSamplingZones )
+{
+  if ( !beginZone || !endZone )
+    NCRYSTAL_THROW(BadInput,"Trace::setHooks requires both begin and end functions");
+  //Intentionally leaked, since zones in other threads might still use them:
+  auto hooks = new detail::Hooks{ beginZone, endZone, userdata, includeSamplingZones };
+  detail::s_activeHooks.store( hooks, std::memory_order_release );
+}
+
+void NC::Trace::clearHooks()
+{
+  detail::s_activeHooks.store( nullptr, std::memory_order_release );
+}
@@ -0,0 +1,99 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/internal/NCTabulatedXS.hh"
+#include "NCrystal/internal/NCTransmission.hh"
+#include "NCrystal/internal/NCThreadUtils.hh"
+#include "NCrystal/internal/NCMath.hh"
+
+namespace NC = NCrystal;
+
+namespace NCrystal {
+  namespace {
+    //Wavelengths are handled in chunks of this size (also the minimal amount of
+    //work for a thread):
+    constexpr std::size_t transmission_chunksize = 1024;
+  }
+}
+
+void NC::calcTransmission( const Info& info,
+                           const ProcImpl::Process& scatter,
+                           const ProcImpl::Process* absorption,
+                           Span<const double> wavelengths,
+                           Span<const double> thicknesses,
+                           Span<double> out,
+                           unsigned nthreads )
+{
+  const std::size_t nwl = wavelengths.size();
+  const std::size_t nthick = thicknesses.size();
+  if ( static_cast<std::size_t>( out.size() ) != nwl * nthick )
+    NCRYSTAL_THROW(BadInput,"calcTransmission: output array has wrong size");
+  if ( scatter.isOriented() || ( absorption && absorption->isOriented() ) )
+    NCRYSTAL_THROW(BadInput,"calcTransmission: only non-oriented processes are supported");
+  for ( auto t : thicknesses )
+    if ( !(t >= 0.0) || ncisinf(t) )
+      NCRYSTAL_THROW2(BadInput,"calcTransmission: invalid thickness (must be non-negative and finite): "<<t);
+  if ( nwl == 0 || nthick == 0 )
+    return;
+
+  //Factor for converting cross sections [barn] to inverse mean free paths [1/m]:
+  const double xs2mu = 100.0 * info.getNumberDensity().dbl();
+
+  const std::size_t nchunks = ( nwl + transmission_chunksize - 1 ) / transmission_chunksize;
+  parallelForIndex( nchunks, nthreads, [&]( std::size_t ichunk )
+  {
+    const std::size_t ibegin = ichunk * transmission_chunksize;
+    const std::size_t n = std::min<std::size_t>( transmission_chunksize, nwl - ibegin );
+    double ekin[transmission_chunksize];
+    double mu[transmission_chunksize];
+    double xs_abs[transmission_chunksize];
+    for ( std::size_t i = 0; i < n; ++i )
+      ekin[i] = wl2ekin( wavelengths[ibegin+i] );
+    CachePtr cp;
+    scatter.crossSectionIsotropicMany( cp, ekin, n, mu );
+    if ( absorption ) {
+      CachePtr cp_abs;
+      absorption->crossSectionIsotropicMany( cp_abs, ekin, n, xs_abs );
+      for ( std::size_t i = 0; i < n; ++i )
+        mu[i] += xs_abs[i];
+    }
+    for ( std::size_t i = 0; i < n; ++i )
+      mu[i] *= xs2mu;
+    for ( std::size_t it = 0; it < nthick; ++it ) {
+      const double t = thicknesses[it];
+      double * o = out.data() + it * nwl + ibegin;
+      for ( std::size_t i = 0; i < n; ++i )
+        o[i] = std::exp( - mu[i] * t );
+    }
+  } );
+}
+
+NC::VectD NC::calcTransmission( const Info& info,
+                                const ProcImpl::Process& scatter,
+                                const ProcImpl::Process* absorption,
+                                Span<const double> wavelengths,
+                                double thickness,
+                                unsigned nthreads )
+{
+  VectD res( wavelengths.size() );
+  calcTransmission( info, scatter, absorption, wavelengths, Span<const double>( &thickness, &thickness + 1 ),
+                    res, nthreads );
+  return res;
+}
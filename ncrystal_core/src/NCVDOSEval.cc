@@ -102,6 +102,22 @@ NC::VDOSEval::VDOSEval(const VDOSData& vd)
   m_k *= scalefact;
 }
 
+NC::VDOSEval::VDOSEval( const VDOSEval& o, Temperature temperature )
+  : m_density(o.m_density),
+    m_emin(o.m_emin),
+    m_emax(o.m_emax),
+    m_k(o.m_k),
+    m_binwidth(o.m_binwidth),
+    m_invbinwidth(o.m_invbinwidth),
+    m_kT(constant_boltzmann*temperature.get()),
+    m_temperature(DoValidate,temperature),
+    m_elementMassAMU(o.m_elementMassAMU),
+    m_originalIntegral(o.m_originalIntegral),
+    m_nptsExtended(o.m_nptsExtended)
+{
+  nc_assert( m_temperature.get()>=1.0&&m_temperature.get()<1e5 );
+}
+
 double NC::VDOSEval::eval(double energy) const
 {
   nc_assert(energy>=0.0);
@@ -23,8 +23,12 @@
 #include "NCrystal/internal/NCVDOSGn.hh"
 #include "NCrystal/internal/NCKinUtils.hh"
 #include "NCrystal/internal/NCString.hh"
+#include "NCrystal/internal/NCFactoryUtils.hh"
+#include <sstream>
 #include "NCrystal/internal/NCIter.hh"
 #include "NCrystal/internal/NCSABUtils.hh"
+#include "NCrystal/internal/NCThreadUtils.hh"
+#include "NCrystal/NCFact.hh"
 namespace NC=NCrystal;
 #include <iostream>
 
@@ -68,11 +72,16 @@ namespace NCrystal {
 #endif
     }
 
+    ScatKnlData createScatteringKernelImpl( const VDOSEval&, SigmaBound, unsigned vdoslux, double targetEmax,
+                                            VDOSGn::TruncAndThinningParams, ScaleGnContributionFct );
+
     VectD fillSABFromVDOS( const VDOSGn& Gn_asym,
                            const double msd,
                            const VectD& alphaGrid,
                            const VectD& betaGrid,
-                           ScaleGnContributionFct scaleGnContribFct )
+                           ScaleGnContributionFct scaleGnContribFct,
+                           double orderTolerance,
+                           unsigned& nOrdersUsed )
     {
       // Evaluate S(alpha,beta) from Sjolander's II.28, recasted to alpha/beta
       // and excluding sigma*kT/4E from the definition of S.
@@ -99,8 +108,6 @@ namespace NCrystal {
                                       //the x^n/n! factor is added, and the other
                                       //half of exp(-x) we add later. This is done
                                       //to extend range of valid x-values.
-      VectD alpha_factors;
-      alpha_factors.resize(x_vals.size());
 
       //For reasons of numerical stability and efficiency, we always evaluate S
       //first for negative beta, and obtain the values at positive beta by the
@@ -117,118 +124,240 @@ namespace NCrystal {
       const VectD betaGridNonPositive( betaGrid.begin(), std::next(betaGrid.begin(),idx_zero+1) );//vector instead of span to simplify code below
       auto expbeta_vals_nonposbeta = vectorTrf( betaGridNonPositive, [](double beta){ return std::exp(beta); } );
 
-      //Now we loop and fill the S-table. First over phonon order, n, next over
-      //beta and finally alpha. We take care to keep as many calculations as
+      //Orders which can not contribute significantly within the grid are not
+      //added (it is cheaper to check this here than to tune how many orders
+      //are expanded in the first place). Since each Gn is normalised,
+      //int_beta{Gn}=1/kT, and order m can at most contribute
+      //2*x2alpha*int_0^xmax{f(x,m)}dx = 2*x2alpha*P(Poisson(xmax)>m) to the
+      //integral of S over the grid (the factor of 2 accounts for the beta>0
+      //values obtained via detailed balance). Summing this bound over all
+      //orders beyond n gives an upper limit, tailBound[n], on what is missed by
+      //stopping after order n. We stop once this is less than orderTolerance
+      //times the integral of S over the grid already accumulated:
+      nOrdersUsed = maxOrder;
+      VectD tailBound;
+      VectD alphaIntegrationWeights, betaIntegrationWeights;
+      if ( orderTolerance > 0.0 ) {
+        auto trapzWeights = []( const VectD& grid )
+        {
+          VectD w( grid.size(), 0.0 );
+          for ( std::size_t i = 1; i < grid.size(); ++i ) {
+            const double halfwidth = 0.5 * ( grid[i] - grid[i-1] );
+            w[i-1] += halfwidth;
+            w[i] += halfwidth;
+          }
+          return w;
+        };
+        alphaIntegrationWeights = trapzWeights( alphaGrid );
+        betaIntegrationWeights = trapzWeights( betaGrid );
+        //Poisson probabilities, p_k=exp(-xmax)*xmax^k/k!, evaluated in log-space
+        //and summed from above to get survival probabilities, P(Poisson>m):
+        const double xmax = x_vals.back();
+        const std::size_t kmax = std::max<std::size_t>( maxOrder + 1,
+                                                        static_cast<std::size_t>( xmax + 50.0*std::sqrt(xmax) + 50.0 ) );
+        VectD survival( maxOrder + 1, 0.0 );
+        {
+          VectD pk( kmax + 1 );
+          const double logxmax = std::log( xmax );
+          double logp = -xmax;
+          pk[0] = std::exp( logp );
+          for ( std::size_t k = 1; k <= kmax; ++k ) {
+            logp += logxmax - std::log( static_cast<double>( k ) );
+            pk[k] = std::exp( logp );
+          }
+          StableSum sum;
+          for ( std::size_t k = kmax; k > maxOrder; --k )
+            sum.add( pk[k] );
+          for ( std::size_t m = maxOrder; m >= 1; --m ) {
+            survival[m] = sum.sum();
+            sum.add( pk[m] );
+          }
+        }
+        tailBound.resize( maxOrder + 1, 0.0 );
+        const double x2alpha = 1.0 / alpha2x;
+        for ( unsigned m = maxOrder; m >= 1; --m ) {
+          const double scale = scaleGnContribFct ? scaleGnContribFct(m) : 1.0;
+          tailBound[m-1] = tailBound[m] + 2.0 * x2alpha * scale * survival[m];
+        }
+      }
+      auto integrateSAB = [&]()
+      {
+        StableSum sum;
+        for ( auto ibeta : ncrange( betaGrid.size() ) ) {
+          const double * itSAB = &sab[ ibeta * nalpha ];
+          double rowsum = 0.0;
+          for ( auto ialpha : ncrange( nalpha ) )
+            rowsum += itSAB[ialpha] * alphaIntegrationWeights[ialpha];
+          sum.add( rowsum * betaIntegrationWeights[ibeta] );
+        }
+        return sum.sum();
+      };
+
+      //Now we loop and fill the S-table. The phonon orders are processed in
+      //batches: for each batch we first prepare the alpha-dependent factors
+      //f(x,n) of all orders in the batch, after which the non-positive beta
+      //rows are filled in blocks of rows (concurrently if more than one thread
+      //is enabled via NCrystal::setNumberOfThreads). Each entry in the S-table
+      //is only ever updated from a single beta row, and contributions are
+      //always added in order of increasing n, so the results do not depend on
+      //the number of threads. We take care to keep as many calculations as
       //possible in the outer loops, while avoiding unnecessarily repeating
       //calculations or utilising enormous memory caches.
 
-      for ( unsigned n = 1; n <= maxOrder; ++n) {
-
-        const double contribScaleFactor = scaleGnContribFct ? scaleGnContribFct(n) : 1.0;
-        nc_assert(contribScaleFactor>=0.0);
-
-        //Prepare for Gn(beta)-evaluations:
-        auto betakT_Range = Gn_asym.eRange(n);
-        const double invn = 1.0/n;
-
-        //Preparation of f(x)=exp(-x)*x^n/n! is more tricky, due to reasons of
-        //efficiency and numerical issues. As explained above, for orders below
-        //stirling_threshold, we build up recursively, and above we use
-        //Stirling's formula:
-        if ( n < stirling_threshold ) {
-          //for reasonably low orders we can build up slowly and cheaply (leaving
-          //out of fxn_cache a final factor of expmhalfx for numerical stability):
-          for (auto x : enumerate(x_vals) )
-            vectAt(fxn_cache,x.idx) *= x.val*invn;
-          for (auto fxn : enumerate(fxn_cache) )
-            vectAt(alpha_factors,fxn.idx) = fxn.val * vectAt(expmhalfx_vals,fxn.idx) * kT;
-        } else {
-          //Very high order phonons, f(x) is non-zero at very high values of x, but
-          //exp(-0.5*x) becomes 0, precluding the direct/cheap evaluation. Instead
-          //we evaluate directly, with the help of Stirling's series for the
-          //factorial, n!. Everything is suitably rearranged so cancellations happen
-          //before the exponential is evaluated.
-          const double gn = V2SKDetail::stirlingsSeriesSum9thOrder(invn);
-          const double fact= kT * kInvSqrt2Pi/(std::sqrt(n)*gn);
-          if (!fact)
-            continue;//nothing can contribute at this order (should not really happen?)
-          const double logn = std::log(n);
-          for (auto x : enumerate(x_vals) ) {
-            const double exparg = n * ( vectAt(logx_vals,x.idx) - logn + 1.0 ) - x.val;
-            vectAt(alpha_factors,x.idx) = fact * std::exp(exparg);
+      const unsigned nthreads = getNumberOfThreads();
+      const std::size_t batch_capacity = std::max<std::size_t>( 1, std::min<std::size_t>( orderTolerance > 0.0 ? 32 : 256, ( 1u << 20 ) / std::max<std::size_t>(1,nalpha) ) );
+      constexpr std::size_t rows_per_block = 32;
+      const std::size_t nblocks = ( betaGridNonPositive.size() + rows_per_block - 1 ) / rows_per_block;
+      const std::size_t ntasks = std::max<std::size_t>( 1, std::min<std::size_t>( nthreads, nblocks ) );
+
+      struct OrderInfo {
+        double contribScaleFactor;
+        PairDD betakT_Range;
+        std::size_t ialpha_begin;//first non-zero entry in alpha factors
+        bool active;
+      };
+      std::vector<OrderInfo> batch_info( batch_capacity );
+      VectD batch_alpha_factors( batch_capacity * nalpha );
+
+      for ( unsigned nbegin = 1; nbegin <= maxOrder; nbegin += static_cast<unsigned>(batch_capacity) ) {
+        unsigned nend = static_cast<unsigned>( std::min<std::size_t>( std::size_t(maxOrder) + 1, nbegin + batch_capacity ) );
+        if ( orderTolerance > 0.0 && nbegin > 1 ) {
+          //Truncate at the first order whose remaining tail is negligible
+          //compared to the contributions of the previous batches:
+          const double tailLimit = orderTolerance * integrateSAB();
+          for ( unsigned n = nbegin - 1; n < nend; ++n ) {
+            if ( tailBound[n] <= tailLimit ) {
+              nend = n + 1;
+              nOrdersUsed = n;
+              break;
+            }
           }
+          if ( nend <= nbegin )
+            break;
         }
 
-        for ( auto beta : enumerate(betaGridNonPositive) ) {
-          //Can evaluate more precisely at negative beta values and simply flip +
-          //apply detailed balance factor for positive.
-          nc_assert( beta.val<=0.0 );
-          double energy = beta.val * kT;
-          if (!valueInInterval(betakT_Range,energy))
-            continue;//Gn(beta) zero here.
-
-          double expMbeta(0.0);
-          std::size_t posbeta_idx(0);
-          if ( beta.idx >= idx_firstflip ) {
-            posbeta_idx = idx_zero + ( idx_zero - beta.idx );
-            expMbeta = vectAt(expbeta_vals_nonposbeta,beta.idx);
-          }
-
-          const double Gn_asym_eval = contribScaleFactor * Gn_asym.eval(n,energy);
-          if ( !(Gn_asym_eval>0.0) )
-            continue;
-#if 0
-          //readable version of innermost loop:
-          const auto offset_alpharow = beta.idx*nalpha;
-          const auto offset_alpharow_posbeta = posbeta_idx*nalpha;
-          for ( auto alpha_fact : enumerate(alpha_factors) ) {
-            if ( !(alpha_fact.val>0.0) )
-              continue;
-            double contrib_S_negbeta = alpha_fact.val * Gn_asym_eval;
-
-            //Negative beta:
-            vectAt( sab, offset_alpharow + alpha_fact.idx ) += contrib_S_negbeta;
-            if ( expMbeta ) {
-              //Expand to beta>0 by first copying S-values,
-              //S(alpha,+beta)=S(alpha,-beta) and then applying the detailed
-              //balance factor, exp(-beta/2) twice to the values at beta>0, thus
-              //ensuring in the end that all entries end up with a correct factor:
-              vectAt( sab, offset_alpharow_posbeta + alpha_fact.idx ) += contrib_S_negbeta * expMbeta;
+        //Preparation of f(x)=exp(-x)*x^n/n! is more tricky, due to reasons of
+        //efficiency and numerical issues. As explained above, for orders below
+        //stirling_threshold, we build up recursively (necessarily in sequence),
+        //and above we use Stirling's formula (independently for each order):
+        auto prepareOrder = [&]( unsigned n )
+        {
+          OrderInfo& info = batch_info[n-nbegin];
+          info.contribScaleFactor = scaleGnContribFct ? scaleGnContribFct(n) : 1.0;
+          nc_assert(info.contribScaleFactor>=0.0);
+          //Prepare for Gn(beta)-evaluations:
+          info.betakT_Range = Gn_asym.eRange(n);
+          info.active = true;
+          const double invn = 1.0/n;
+          double * alpha_factors = &batch_alpha_factors[ (n-nbegin) * nalpha ];
+          if ( n < stirling_threshold ) {
+            //for reasonably low orders we can build up slowly and cheaply (leaving
+            //out of fxn_cache a final factor of expmhalfx for numerical stability):
+            for (auto x : enumerate(x_vals) )
+              vectAt(fxn_cache,x.idx) *= x.val*invn;
+            for (auto fxn : enumerate(fxn_cache) )
+              alpha_factors[fxn.idx] = fxn.val * vectAt(expmhalfx_vals,fxn.idx) * kT;
+          } else {
+            //Very high order phonons, f(x) is non-zero at very high values of x, but
+            //exp(-0.5*x) becomes 0, precluding the direct/cheap evaluation. Instead
+            //we evaluate directly, with the help of Stirling's series for the
+            //factorial, n!. Everything is suitably rearranged so cancellations happen
+            //before the exponential is evaluated.
+            const double gn = V2SKDetail::stirlingsSeriesSum9thOrder(invn);
+            const double fact= kT * kInvSqrt2Pi/(std::sqrt(n)*gn);
+            if (!fact) {
+              info.active = false;//nothing can contribute at this order (should not really happen?)
+              return;
             }
-          }//alpha loop
-#else
-          //Attempt to super-streamline this innermost loop:
-          nc_assert(nalpha==alpha_factors.size());
-          double * itAlphaFactB = &alpha_factors[0];
-          double * itAlphaFact = itAlphaFactB;
-          double * itAlphaFactE = itAlphaFactB + nalpha;
+            const double logn = std::log(n);
+            for (auto x : enumerate(x_vals) ) {
+              const double exparg = n * ( vectAt(logx_vals,x.idx) - logn + 1.0 ) - x.val;
+              alpha_factors[x.idx] = fact * std::exp(exparg);
+            }
+          }
           //Alpha-factors increase and then decrease. Thus, if we first skip
           //over any initial zeros in the alpha factors, we can break (rather
-          //than just continue) in the final loop whenever we see a zero.
-
-          //First skip over any initial zeros in alpha-factors:
-          while( !(*itAlphaFact>0.0) && itAlphaFact!=itAlphaFactE )
-            ++itAlphaFact;
-          double * itSAB = &sab[0] + (beta.idx*nalpha + (itAlphaFact-itAlphaFactB));
-          if ( expMbeta) {
-            double * itSAB_posbeta = &sab[0] + (posbeta_idx*nalpha + (itAlphaFact-itAlphaFactB));
-            for (;itAlphaFact!=itAlphaFactE;++itAlphaFact,++itSAB,++itSAB_posbeta) {
-              if ( !(*itAlphaFact>0.0) )
-                break;
-              double contrib_S_negbeta = *itAlphaFact * Gn_asym_eval;
-              *itSAB += contrib_S_negbeta;
-              *itSAB_posbeta += contrib_S_negbeta*expMbeta;
-            }//alpha loop where +-|beta| is available
-          } else {
-            for (;itAlphaFact!=itAlphaFactE;++itAlphaFact,++itSAB) {
-              if ( !(*itAlphaFact>0.0) )
-                break;
-              *itSAB += *itAlphaFact * Gn_asym_eval;
-            }//alpha loop where only -|beta| is available
-          }
-#endif
-        }//beta loop
-      }//phonon order loop
+          //than just continue) in the final loop whenever we see a zero:
+          std::size_t i = 0;
+          while ( i < nalpha && !(alpha_factors[i]>0.0) )
+            ++i;
+          info.ialpha_begin = i;
+          if ( i == nalpha )
+            info.active = false;
+        };
+        const unsigned nend_recursive = std::max<unsigned>( nbegin, std::min<unsigned>( nend, stirling_threshold ) );
+        for ( unsigned n = nbegin; n < nend_recursive; ++n )
+          prepareOrder( n );
+        parallelForIndex( nend - nend_recursive, nthreads,
+                          [&prepareOrder,nend_recursive]( std::size_t i )
+                          { prepareOrder( nend_recursive + static_cast<unsigned>(i) ); } );
+
+        auto fillBlock = [&]( std::size_t iblock )
+        {
+          const std::size_t ibeta_begin = iblock * rows_per_block;
+          const std::size_t ibeta_end = std::min<std::size_t>( ibeta_begin + rows_per_block, betaGridNonPositive.size() );
+          for ( unsigned n = nbegin; n < nend; ++n ) {
+            const OrderInfo& info = batch_info[n-nbegin];
+            if ( !info.active )
+              continue;
+            const double * itAlphaFactB = &batch_alpha_factors[ (n-nbegin) * nalpha ];
+            const double * itAlphaFactE = itAlphaFactB + nalpha;
+            for ( std::size_t ibeta = ibeta_begin; ibeta < ibeta_end; ++ibeta ) {
+              //Can evaluate more precisely at negative beta values and simply flip +
+              //apply detailed balance factor for positive.
+              const double betaval = betaGridNonPositive[ibeta];
+              nc_assert( betaval<=0.0 );
+              double energy = betaval * kT;
+              if (!valueInInterval(info.betakT_Range,energy))
+                continue;//Gn(beta) zero here.
+
+              double expMbeta(0.0);
+              std::size_t posbeta_idx(0);
+              if ( ibeta >= idx_firstflip ) {
+                posbeta_idx = idx_zero + ( idx_zero - ibeta );
+                expMbeta = vectAt(expbeta_vals_nonposbeta,ibeta);
+              }
+
+              const double Gn_asym_eval = info.contribScaleFactor * Gn_asym.eval(n,energy);
+              if ( !(Gn_asym_eval>0.0) )
+                continue;
+
+              //Streamlined innermost loop, starting at the first non-zero alpha
+              //factor and breaking at the next zero:
+              const double * itAlphaFact = itAlphaFactB + info.ialpha_begin;
+              double * itSAB = &sab[0] + (ibeta*nalpha + info.ialpha_begin);
+              if ( expMbeta) {
+                //Expand to beta>0 by copying S-values, S(alpha,+beta)=S(alpha,-beta),
+                //and applying the detailed balance factor:
+                double * itSAB_posbeta = &sab[0] + (posbeta_idx*nalpha + info.ialpha_begin);
+                for (;itAlphaFact!=itAlphaFactE;++itAlphaFact,++itSAB,++itSAB_posbeta) {
+                  if ( !(*itAlphaFact>0.0) )
+                    break;
+                  double contrib_S_negbeta = *itAlphaFact * Gn_asym_eval;
+                  *itSAB += contrib_S_negbeta;
+                  *itSAB_posbeta += contrib_S_negbeta*expMbeta;
+                }//alpha loop where +-|beta| is available
+              } else {
+                for (;itAlphaFact!=itAlphaFactE;++itAlphaFact,++itSAB) {
+                  if ( !(*itAlphaFact>0.0) )
+                    break;
+                  *itSAB += *itAlphaFact * Gn_asym_eval;
+                }//alpha loop where only -|beta| is available
+              }
+            }//beta loop
+          }//phonon order loop
+        };
+        //Blocks are distributed round-robin over the tasks, for load balancing
+        //(rows with beta near 0 usually receive contributions from more orders):
+        parallelForIndex( ntasks, nthreads,
+                          [&fillBlock,nblocks,ntasks]( std::size_t itask )
+                          {
+                            for ( std::size_t iblock = itask; iblock < nblocks; iblock += ntasks )
+                              fillBlock( iblock );
+                          } );
+        if ( nOrdersUsed < maxOrder )
+          break;
+      }//phonon order batch loop
 
       return sab;
     }
@@ -693,6 +822,50 @@ NC::ScatKnlData NC::createScatteringKernel( const VDOSData& vdosdata,
                                             VDOSGn::TruncAndThinningParams ttpars,
                                             ScaleGnContributionFct scaleGnContributionFct )
 {
+  return V2SKDetail::createScatteringKernelImpl( VDOSEval(vdosdata), vdosdata.boundXS(),
+                                                 vdoslux, targetEmax_requested,
+                                                 ttpars, std::move(scaleGnContributionFct) );
+}
+
+std::vector<NC::ScatKnlData> NC::createScatteringKernels( const VDOSData& vdosdata,
+                                                          const std::vector<Temperature>& temperatures,
+                                                          unsigned vdoslux,
+                                                          double targetEmax_requested,
+                                                          VDOSGn::TruncAndThinningParams ttpars,
+                                                          ScaleGnContributionFct scaleGnContributionFct )
+{
+  //The (validated and normalised) density is shared, while the expansions at
+  //the various temperatures are independent and carried out concurrently:
+  const VDOSEval vdoseval_base(vdosdata);
+  std::vector<Optional<ScatKnlData>> results( temperatures.size() );
+  parallelForIndex( temperatures.size(), getNumberOfThreads(),
+                    [&]( std::size_t i )
+                    {
+                      results[i] = V2SKDetail::createScatteringKernelImpl( VDOSEval( vdoseval_base, temperatures[i] ),
+                                                                           vdosdata.boundXS(),
+                                                                           vdoslux, targetEmax_requested,
+                                                                           ttpars, scaleGnContributionFct );
+                    } );
+  std::vector<ScatKnlData> out;
+  out.reserve( results.size() );
+  for ( auto& r : results )
+    out.push_back( std::move(r.value()) );
+  return out;
+}
+
+NC::ScatKnlData NC::V2SKDetail::createScatteringKernelImpl( const VDOSEval& vdoseval,
+                                                           SigmaBound boundXS,
+                                                           unsigned vdoslux,
+                                                           double targetEmax_requested,
+                                                           VDOSGn::TruncAndThinningParams ttpars,
+                                                           ScaleGnContributionFct scaleGnContributionFct )
+{
+  InitProfileScope profileScope( "createScatteringKernel", [&vdoseval,vdoslux]()
+  {
+    std::ostringstream ss;
+    ss << "T=" << vdoseval.temperature() << ", vdoslux=" << vdoslux;
+    return ss.str();
+  } );
   //Hidden unofficial env-vars used for special debugging purposes:
   auto getEnvInt = [](const char* name) { auto ev = getenv(name); return ev ? str2int(ev) :   0; };
   auto getEnvDbl = [](const char* name) { auto ev = getenv(name); return ev ? str2dbl(ev) : 0.0; };
@@ -710,11 +883,10 @@ NC::ScatKnlData NC::createScatteringKernel( const VDOSData& vdosdata,
   double targetEmax = targetEmax_requested>0.0 ? targetEmax_requested : lux2emax[vdoslux];
 
   if (V2SKDetail::s_verbose)
-    std::cout<<"NCrystal::VDOS2SK initialising with T="<<vdosdata.temperature()<<", vdoslux="<<vdoslux
+    std::cout<<"NCrystal::VDOS2SK initialising with T="<<vdoseval.temperature()<<", vdoslux="<<vdoslux
              <<", aiming for Emax="<<targetEmax<<"eV"<<(targetEmax_requested>0.0?" (as requested)":"")<<", ..."<<std::endl;
 
   //Initialise evaluators:
-  VDOSEval vdoseval(vdosdata);
   const double kT = vdoseval.kT();
   const double invkT = 1.0/kT;
   const double gamma0 = vdoseval.calcGamma0();
@@ -813,10 +985,20 @@ NC::ScatKnlData NC::createScatteringKernel( const VDOSData& vdosdata,
   //All done, now all that remains is to go through the (alpha,beta) pts in the
   //grid and use Sjolander's II.28 equation to calculate S(alpha,beta) there as
   //the sum of individual phonon orders:
-  auto sab = V2SKDetail::fillSABFromVDOS( Gn_asym, msd, alphaGrid, betaGrid, scaleGnContributionFct );
+  //
+  //Orders beyond max_phonon_order were needed to reach the kinematic curve at
+  //targetEmax, but their combined contribution to S(alpha,beta) integrated
+  //over the final grid might nonetheless be negligible, in which case they are
+  //skipped. The tolerance for this is relcontriblvl, i.e. the same level used
+  //for the ranges of each order above:
+  const double order_tolerance = ( override_max_order > 0 ? 0.0 : relcontriblvl );
+  unsigned n_orders_used = max_phonon_order;
+  auto sab = V2SKDetail::fillSABFromVDOS( Gn_asym, msd, alphaGrid, betaGrid, scaleGnContributionFct,
+                                          order_tolerance, n_orders_used );
 
   if (V2SKDetail::s_verbose)
     std::cout<<"NCrystal::VDOS2SK created SK with vdos expansion order N="<<max_phonon_order
+             <<" (of which "<<n_orders_used<<" contribute significantly within the grid)"
              <<", Emax="<<targetEmax<<"eV, nalpha="<<alphaGrid.size()<< " nbeta="<<betaGrid.size()<<std::endl;
 
   ScatKnlData out;
@@ -824,8 +1006,8 @@ NC::ScatKnlData NC::createScatteringKernel( const VDOSData& vdosdata,
   out.betaGrid  = std::move(betaGrid);
   out.sab       = std::move(sab);
   out.temperature = vdoseval.temperature();
-  out.boundXS = vdosdata.boundXS();
-  out.elementMassAMU = vdosdata.elementMassAMU();
+  out.boundXS = boundXS;
+  out.elementMassAMU = vdoseval.elementMassAMU();
   out.knltype = ScatKnlData::KnlType::SAB;
   out.suggestedEmax = targetEmax;
   out.betaGridOptimised = true;//prevent beta-thickening code upon conversion to SABData
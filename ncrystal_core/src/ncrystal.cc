@@ -37,6 +37,16 @@
 #include "NCrystal/internal/NCEqRefl.hh"//TODO: might not be needed eventually
 #include "NCrystal/internal/NCAtomDB.hh"
 #include "NCrystal/internal/NCVDOSEval.hh"
+#include "NCrystal/internal/NCFlatExport.hh"
+#include "NCrystal/internal/NCTabulatedXS.hh"
+#include "NCrystal/internal/NCFactoryUtils.hh"
+#include "NCrystal/internal/NCThreadUtils.hh"
+#include "NCrystal/internal/NCRandUtils.hh"
+#include "NCrystal/internal/NCMiniTransport.hh"
+#include "NCrystal/internal/NCTransmission.hh"
+#include "NCrystal/internal/NCPCBragg.hh"
+#include "NCrystal/internal/NCPowderPattern.hh"
+#include "NCrystal/internal/NCSABFixedEnergy.hh"
 #include <cstdio>
 #include <cstdlib>
 
@@ -233,6 +243,58 @@ namespace NCrystal {
     Wrapped_AtomData& extractWrapper(Wrapped_AtomData::c_handle_type h) { return extractWrapperImpl<Wrapped_AtomData>(h); }
     Wrapped_AtomData::object_type& extract(Wrapped_AtomData::c_handle_type h) { return extractWrapperImpl<Wrapped_AtomData>(h).obj(); }
 
+    ////////////////////////////////////////////////////////////////////////////////////
+    //Cache objects (used with a single physics process, which is bound upon first usage):
+    class CacheObj : private NoCopyMove {
+    public:
+      CachePtr& cacheFor( const ProcImpl::Process& proc )
+      {
+        //Stateless processes never touch the cache, so need no binding:
+        if ( proc.isStateless() )
+          return m_cacheptr;
+        const auto uid = proc.getUniqueID().value;
+        if ( !m_bound ) {
+          m_procuid = uid;
+          m_bound = true;
+        } else if ( m_procuid != uid ) {
+          NCRYSTAL_THROW(LogicError,"ncrystal_cache_t handles can not be used with more than one"
+                         " physics process (create a separate cache handle for each process).");
+        }
+        return m_cacheptr;
+      }
+      RNG& rng()
+      {
+        if ( !m_rng )
+          m_rng = getDefaultRNGProducer()->produceForCurrentThread();
+        return *m_rng;
+      }
+    private:
+      CachePtr m_cacheptr;
+      optional_shared_obj<RNGStream> m_rng;
+      uint64_t m_procuid = 0;
+      bool m_bound = false;
+    };
+
+    struct WrappedDef_Cache {
+      using object_type = CacheObj;
+      using c_handle_type = ncrystal_cache_t;
+      static constexpr ObjectTypeID object_typeid = 0x3a91e5c2;//randomly generated 32 bits
+      static constexpr const char * name() { return "Cache"; }
+    };
+    using Wrapped_Cache = Wrapped<WrappedDef_Cache>;
+    Wrapped_Cache& extractWrapper(Wrapped_Cache::c_handle_type h) { return extractWrapperImpl<Wrapped_Cache>(h); }
+    Wrapped_Cache::object_type& extract(Wrapped_Cache::c_handle_type h) { return extractWrapperImpl<Wrapped_Cache>(h).obj(); }
+
+    //Light-weight wrapper of RNG functions passed to the _c functions:
+    class CFctRNG final : public RNGStream {
+    public:
+      CFctRNG( double (*fct)() ) : m_fct(fct) {}
+    protected:
+      double actualGenerate() override { return m_fct(); }
+    private:
+      double (*m_fct)();
+    };
+
     Process& extractProcess(ncrystal_process_t h)
     {
       ObjectTypeID objtypeid = h.internal ? extractObjectTypeID(h.internal) : 0x0;
@@ -253,6 +315,7 @@ namespace NCrystal {
       static_assert(std::is_standard_layout<ncrystal_absorption_t>::value,"");
       static_assert(std::is_standard_layout<ncrystal_atomdata_t>::value,"");
       static_assert(std::is_standard_layout<ncrystal_info_t>::value,"");
+      static_assert(std::is_standard_layout<ncrystal_cache_t>::value,"");
       return *reinterpret_cast<void**>(o);
     }
 
@@ -263,14 +326,16 @@ namespace NCrystal {
                       " not the handle itself.");
     }
 
-    static int quietonerror = 0;
-    static int haltonerror = 1;
-    static int waserror = 0;
-    static char errmsg[512];
-    static char errtype[64];
-    static void (*custom_error_handler)(char *,char*) = 0;
+    //The error state is kept per thread, while the error handling settings are
+    //global:
+    static std::atomic<int> quietonerror = {0};
+    static std::atomic<int> haltonerror = {1};
+    static std::atomic<void (*)(char *,char*)> custom_error_handler = {nullptr};
+    static thread_local int waserror = 0;
+    static thread_local char errmsg[512];
+    static thread_local char errtype[64];
 
-    void setError(const char *msg, const char * etype = 0) throw() {
+    void recordError(const char *msg, const char * etype = 0) noexcept {
       if (!etype)
         etype="ncrystal_c-interface";
       strncpy(errmsg,msg,sizeof(errmsg)-1);
@@ -278,29 +343,46 @@ namespace NCrystal {
       //Ensure final null-char in case of very long input strings:
       errmsg[sizeof(errmsg)-1]='\0';
       errtype[sizeof(errtype)-1]='\0';
-      if (custom_error_handler) {
-        (*custom_error_handler)(errtype,errmsg);
+    }
+
+    void setError(const char *msg, const char * etype = 0) throw() {
+      recordError(msg,etype);
+      auto handler = custom_error_handler.load();
+      if (handler) {
+        (*handler)(errtype,errmsg);
       }
       waserror = 1;
-      if (!quietonerror)
+      if (!quietonerror.load())
         printf("NCrystal ERROR [%s]: %s\n",errtype,errmsg);
-      if (haltonerror) {
+      if (haltonerror.load()) {
         printf("NCrystal terminating due to ERROR\n");
         exit(1);
       }
     }
 
-    void handleError(const std::exception &e) throw() {
+    template<class TErrorFct>
+    void dispatchError(const std::exception &e, TErrorFct errfct) noexcept {
       const Error::Exception* nce = dynamic_cast<const Error::Exception*>(&e);
       if (nce) {
-        setError(nce->what(),nce->getTypeName());
+        errfct(nce->what(),nce->getTypeName());
         return;
       }
       const std::runtime_error* stdrte = dynamic_cast<const std::runtime_error*>(&e);
       if (stdrte)
-        setError(stdrte->what(),"std::runtime_error");
+        errfct(stdrte->what(),"std::runtime_error");
       else
-        setError("<unknown>","std::exception");
+        errfct("<unknown>","std::exception");
+    }
+
+    void handleError(const std::exception &e) throw() {
+      dispatchError( e, [](const char * msg, const char * etype) { setError(msg,etype); } );
+    }
+
+    //Error handling for functions returning status codes: Only record the error
+    //in the error state of the thread (no printouts, handlers or halting):
+    void handleErrorStatus(const std::exception &e) noexcept {
+      dispatchError( e, [](const char * msg, const char * etype) { recordError(msg,etype); } );
+      waserror = 1;
     }
 
   }
@@ -336,16 +418,12 @@ void ncrystal_clearerror()
 
 int ncrystal_setquietonerror(int q)
 {
-  int old = ncc::quietonerror;
-  ncc::quietonerror = q;
-  return old;
+  return ncc::quietonerror.exchange(q);
 }
 
 int ncrystal_sethaltonerror(int h)
 {
-  int old = ncc::haltonerror;
-  ncc::haltonerror = h;
-  return old;
+  return ncc::haltonerror.exchange(h);
 }
 
 int ncrystal_valid(void* object)
@@ -357,6 +435,7 @@ int ncrystal_valid(void* object)
 }
 
 #define NCCATCH catch (std::exception& e) { ncc::handleError(e); }
+#define NCCATCH_STATUS catch (std::exception& e) { ncc::handleErrorStatus(e); }
 
 ncrystal_process_t ncrystal_cast_scat2proc(ncrystal_scatter_t s)
 {
@@ -407,6 +486,7 @@ int ncrystal_refcount(void* addrhandle)
       case ncc::Wrapped_Scatter::object_typeid():    return static_cast<int>(ncc::forceCastWrapper<ncc::Wrapped_Scatter>(o).refCount());
       case ncc::Wrapped_Absorption::object_typeid(): return static_cast<int>(ncc::forceCastWrapper<ncc::Wrapped_Absorption>(o).refCount());
       case ncc::Wrapped_AtomData::object_typeid():   return static_cast<int>(ncc::forceCastWrapper<ncc::Wrapped_AtomData>(o).refCount());
+      case ncc::Wrapped_Cache::object_typeid():      return static_cast<int>(ncc::forceCastWrapper<ncc::Wrapped_Cache>(o).refCount());
       default: ncc::throwInvalidHandleType("ncrystal_refcount");
     };
   } NCCATCH;
@@ -422,6 +502,7 @@ void ncrystal_ref(void* addrhandle)
       case ncc::Wrapped_Scatter::object_typeid():    return ncc::forceCastWrapper<ncc::Wrapped_Scatter>(o).ref();
       case ncc::Wrapped_Absorption::object_typeid(): return ncc::forceCastWrapper<ncc::Wrapped_Absorption>(o).ref();
       case ncc::Wrapped_AtomData::object_typeid():   return ncc::forceCastWrapper<ncc::Wrapped_AtomData>(o).ref();
+      case ncc::Wrapped_Cache::object_typeid():      return ncc::forceCastWrapper<ncc::Wrapped_Cache>(o).ref();
       default: ncc::throwInvalidHandleType("ncrystal_ref");
     };
   } NCCATCH;
@@ -449,6 +530,7 @@ void ncrystal_unref(void* addrhandle)
       case ncc::Wrapped_Scatter::object_typeid():    return ncc::doUnref<ncc::Wrapped_Scatter>(addrhandle);
       case ncc::Wrapped_Absorption::object_typeid(): return ncc::doUnref<ncc::Wrapped_Absorption>(addrhandle);
       case ncc::Wrapped_AtomData::object_typeid():   return ncc::doUnref<ncc::Wrapped_AtomData>(addrhandle);
+      case ncc::Wrapped_Cache::object_typeid():      return ncc::doUnref<ncc::Wrapped_Cache>(addrhandle);
       default: ncc::throwInvalidHandleType("ncrystal_unref");
     };
   } NCCATCH;
@@ -650,6 +732,67 @@ void ncrystal_info_gethkl_allindices( ncrystal_info_t nfo, int idx,
   h[0] = k[0] = l[0] = 0;
 }
 
+namespace NCrystal {
+  namespace NCCInterface {
+    namespace {
+      NC::HKLList::const_iterator hklRangeBegin( const NC::HKLList& hklList, int start, int n )
+      {
+        if ( start < 0 || n < 0 || static_cast<std::size_t>(start) + static_cast<std::size_t>(n) > hklList.size() )
+          NCRYSTAL_THROW2(BadInput,"Invalid range of HKL list entries requested: start="<<start<<", n="<<n
+                          <<" (list has "<<hklList.size()<<" entries)");
+        return std::next(hklList.begin(),start);
+      }
+    }
+  }
+}
+
+void ncrystal_info_gethkl_many( ncrystal_info_t ci, int start, int n,
+                                int* h, int* k, int* l, int* multiplicity,
+                                double * dspacing, double* fsquared )
+{
+  try {
+    auto& info = ncc::extract(ci);
+    auto& hklList = info->hklList();
+    auto it = ncc::hklRangeBegin( hklList, start, n );
+    for ( int i = 0; i < n; ++i, ++it ) {
+      h[i] = it->hkl.h;
+      k[i] = it->hkl.k;
+      l[i] = it->hkl.l;
+      multiplicity[i] = it->multiplicity;
+      dspacing[i] = it->dspacing;
+      fsquared[i] = it->fsquared;
+    }
+    return;
+  } NCCATCH;
+  if ( n > 0 ) {
+    *h = *k = *l = *multiplicity = -9999;
+    *dspacing = *fsquared = -1.0;
+  }
+}
+
+void ncrystal_info_gethkl_allindices_many( ncrystal_info_t nfo, int start, int n,
+                                           int* h, int* k, int* l )
+{
+  try {
+    if ( n > 0 )
+      h[0] = k[0] = l[0] = 0;//signature for not possible
+    auto& info = ncc::extract(nfo);
+    auto& hklList = info->hklList();
+    auto it = ncc::hklRangeBegin( hklList, start, n );
+    auto res = NC::ExpandHKLHelper( *info );
+    for ( int i = 0; i < n; ++i, ++it ) {
+      for ( auto& e : res.expand( *it ) ) {
+        *h++ = e.h;
+        *k++ = e.k;
+        *l++ = e.l;
+      }
+    }
+    return;
+  } NCCATCH;
+  if ( n > 0 )
+    h[0] = k[0] = l[0] = 0;
+}
+
 unsigned ncrystal_info_ndyninfo( ncrystal_info_t ci )
 {
   try {
@@ -689,6 +832,92 @@ void ncrystal_dyninfo_base( ncrystal_info_t ci,
   *atomdataindex = *ditypeid = 0;
 }
 
+namespace {
+  //Kernel and energy grid, kept alive for the zero-copy access of
+  //ncrystal_dyninfo_extract_scatknl_ref:
+  struct ScatKnlRef {
+    std::shared_ptr<const NC::SABData> sabdata;
+    NC::DI_ScatKnl::EGridShPtr egrid;
+  };
+
+  void extractScatKnl( ncrystal_info_t ci, unsigned idyninfo, unsigned vdoslux,
+                       double * suggestedEmax, unsigned* negrid, unsigned* nalpha, unsigned* nbeta,
+                       const double** egrid, const double** alphagrid, const double** betagrid,
+                       const double** sab, void** keepalive )
+  {
+    if ( keepalive )
+      *keepalive = nullptr;
+    try {
+      auto& di = ncc::extract(ci)->getDynamicInfoList().at(idyninfo);
+      nc_assert_always(!!di);
+      std::shared_ptr<const NC::SABData> shptr_sabdata;
+      NC::DI_ScatKnl::EGridShPtr shptr_egrid;
+      auto di_sk = dynamic_cast<const NC::DI_ScatKnl*>(di.get());
+      if (di_sk) {
+        shptr_sabdata = NC::extractSABDataFromDynInfo(di_sk,vdoslux);
+        shptr_egrid = di_sk->energyGrid();
+        if ( keepalive ) {
+          //Caller takes over a reference to the data:
+          *keepalive = new ScatKnlRef{ shptr_sabdata, shptr_egrid };
+        } else {
+          //In case the sabdata factory does not keep strong references, we must
+          //keep the newly created object in shptr_sabdata alive when returning to
+          //C/Python code without shared pointers. For now we do this by adding to a
+          //global static array here:
+          static std::vector<std::shared_ptr<const NC::SABData>> s_keepAlive;
+          static std::mutex s_keepAlive_mutex;
+          NCRYSTAL_LOCK_GUARD(s_keepAlive_mutex);
+          s_keepAlive.push_back(shptr_sabdata);
+          static bool first = true;
+          if (first) {
+            //Register for clearance by global clearCaches function:
+            first = false;
+            NC::registerCacheCleanupFunction([](){ s_keepAlive.clear(); });
+          }
+        }
+      }
+      if (!!shptr_sabdata) {
+        const auto& sabdata = *shptr_sabdata;
+        unsigned na = static_cast<unsigned>(sabdata.alphaGrid().size());
+        unsigned nb = static_cast<unsigned>(sabdata.betaGrid().size());
+        unsigned nsab = static_cast<unsigned>(sabdata.sab().size());
+        nc_assert_always(na>1&&nb>1&&na*nb==nsab);
+        *nalpha = na;
+        *nbeta = nb;
+        *alphagrid = &sabdata.alphaGrid()[0];
+        *betagrid = &sabdata.betaGrid()[0];
+        *sab = &sabdata.sab()[0];
+        *suggestedEmax = sabdata.suggestedEmax();
+      } else {
+        *nalpha = 0;
+        *nbeta = 0;
+        *alphagrid = nullptr;
+        *betagrid = nullptr;
+        *sab = nullptr;
+        *suggestedEmax = 0.0;
+      }
+      if ( !shptr_egrid || shptr_egrid->empty() ) {
+        *negrid = 0;
+        //make sure egrid does at least point to valid memory (and avoid actually
+        //using 0-length arrays);
+        static const double dummy[1] = { 0.0 };
+        *egrid = &dummy[0];
+      } else {
+        *negrid = shptr_egrid->size();
+        *egrid = &(*shptr_egrid)[0];
+      }
+      return;
+    } NCCATCH;
+    if ( keepalive && *keepalive ) {
+      delete static_cast<ScatKnlRef*>( *keepalive );
+      *keepalive = nullptr;
+    }
+    *suggestedEmax = -1.0;
+    *negrid = *nalpha = *nbeta = 0;
+    *egrid = *alphagrid = *betagrid = *sab = nullptr;
+  }
+}
+
 void ncrystal_dyninfo_extract_scatknl( ncrystal_info_t ci,
                                        unsigned idyninfo,
                                        unsigned vdoslux,
@@ -701,66 +930,30 @@ void ncrystal_dyninfo_extract_scatknl( ncrystal_info_t ci,
                                        const double** betagrid,
                                        const double** sab )
 {
-  try {
-    auto& di = ncc::extract(ci)->getDynamicInfoList().at(idyninfo);
-    nc_assert_always(!!di);
-    std::shared_ptr<const NC::SABData> shptr_sabdata;
-    NC::DI_ScatKnl::EGridShPtr shptr_egrid;
-    auto di_sk = dynamic_cast<const NC::DI_ScatKnl*>(di.get());
-    if (di_sk) {
-      shptr_sabdata = NC::extractSABDataFromDynInfo(di_sk,vdoslux);
-      shptr_egrid = di_sk->energyGrid();
-      //In case the sabdata factory does not keep strong references, we must
-      //keep the newly created object in shptr_sabdata alive when returning to
-      //C/Python code without shared pointers. For now we do this by adding to a
-      //global static array here:
-      static std::vector<std::shared_ptr<const NC::SABData>> s_keepAlive;
-      static std::mutex s_keepAlive_mutex;
-      NCRYSTAL_LOCK_GUARD(s_keepAlive_mutex);
-      s_keepAlive.push_back(shptr_sabdata);
-      static bool first = true;
-      if (first) {
-        //Register for clearance by global clearCaches function:
-        first = false;
-        NC::registerCacheCleanupFunction([](){ s_keepAlive.clear(); });
-      }
+  extractScatKnl( ci, idyninfo, vdoslux, suggestedEmax, negrid, nalpha, nbeta,
+                  egrid, alphagrid, betagrid, sab, nullptr );
+}
 
-    }
-    if (!!shptr_sabdata) {
-      const auto& sabdata = *shptr_sabdata;
-      unsigned na = static_cast<unsigned>(sabdata.alphaGrid().size());
-      unsigned nb = static_cast<unsigned>(sabdata.betaGrid().size());
-      unsigned nsab = static_cast<unsigned>(sabdata.sab().size());
-      nc_assert_always(na>1&&nb>1&&na*nb==nsab);
-      *nalpha = na;
-      *nbeta = nb;
-      *alphagrid = &sabdata.alphaGrid()[0];
-      *betagrid = &sabdata.betaGrid()[0];
-      *sab = &sabdata.sab()[0];
-      *suggestedEmax = sabdata.suggestedEmax();
-    } else {
-      *nalpha = 0;
-      *nbeta = 0;
-      *alphagrid = nullptr;
-      *betagrid = nullptr;
-      *sab = nullptr;
-      *suggestedEmax = 0.0;
-    }
-    if ( !shptr_egrid || shptr_egrid->empty() ) {
-      *negrid = 0;
-      //make sure egrid does at least point to valid memory (and avoid actually
-      //using 0-length arrays);
-      static const double dummy[1] = { 0.0 };
-      *egrid = &dummy[0];
-    } else {
-      *negrid = shptr_egrid->size();
-      *egrid = &(*shptr_egrid)[0];
-    }
-    return;
-  } NCCATCH;
-  *suggestedEmax = -1.0;
-  *negrid = *nalpha = *nbeta = 0;
-  *egrid = *alphagrid = *betagrid = *sab = nullptr;
+void ncrystal_dyninfo_extract_scatknl_ref( ncrystal_info_t ci,
+                                           unsigned idyninfo,
+                                           unsigned vdoslux,
+                                           double * suggestedEmax,
+                                           unsigned* negrid,
+                                           unsigned* nalpha,
+                                           unsigned* nbeta,
+                                           const double** egrid,
+                                           const double** alphagrid,
+                                           const double** betagrid,
+                                           const double** sab,
+                                           void** keepalive )
+{
+  extractScatKnl( ci, idyninfo, vdoslux, suggestedEmax, negrid, nalpha, nbeta,
+                  egrid, alphagrid, betagrid, sab, keepalive );
+}
+
+void ncrystal_release_scatknl( void* keepalive )
+{
+  delete static_cast<ScatKnlRef*>( keepalive );
 }
 
 void ncrystal_dyninfo_extract_vdos( ncrystal_info_t ci,
@@ -830,6 +1023,69 @@ void ncrystal_dyninfo_extract_vdos_input( ncrystal_info_t ci,
   *vdos_egrid = *vdos_density = nullptr;
 }
 
+namespace NCrystal {
+  namespace NCCInterface {
+    namespace {
+      shared_obj<const SABData> getDynInfoSABData( ncrystal_info_t ci, unsigned idyninfo, unsigned vdoslux )
+      {
+        auto& di = ncc::extract(ci)->getDynamicInfoList().at(idyninfo);
+        nc_assert_always(!!di);
+        auto di_sk = dynamic_cast<const DI_ScatKnl*>(di.get());
+        if (!di_sk)
+          NCRYSTAL_THROW2(BadInput,"Dynamic info with index "<<idyninfo<<" does not provide a scattering kernel");
+        auto sabdata = extractSABDataFromDynInfo(di_sk,vdoslux);
+        nc_assert_always(!!sabdata);
+        return shared_obj<const SABData>(std::move(sabdata));
+      }
+    }
+  }
+}
+
+void ncrystal_dyninfo_ddxs( ncrystal_info_t ci,
+                            unsigned idyninfo,
+                            unsigned vdoslux,
+                            unsigned long n,
+                            const double * ekin,
+                            const double * eprime,
+                            const double * mu,
+                            double * results )
+{
+  try {
+    auto sabdata = ncc::getDynInfoSABData(ci,idyninfo,vdoslux);
+    NC::SAB::doubleDifferentialCrossSection( *sabdata, ekin, eprime, mu, n, results );
+    return;
+  } NCCATCH;
+  //non-halting-error, invalidate all output:
+  for ( unsigned long i = 0; i < n; ++i )
+    results[i] = -1.0;
+}
+
+void ncrystal_dyninfo_sample_fixedekin( ncrystal_info_t ci,
+                                        unsigned idyninfo,
+                                        unsigned vdoslux,
+                                        double ekin,
+                                        unsigned nmu,
+                                        unsigned long n,
+                                        unsigned long seed,
+                                        double * xs,
+                                        double * results_deltae,
+                                        double * results_mu )
+{
+  try {
+    NC::SAB::SABFixedEnergyTableCfg cfg;
+    cfg.nmu = nmu;
+    NC::SAB::SABFixedEnergyTables tables( ncc::getDynInfoSABData(ci,idyninfo,vdoslux), NC::VectD{ ekin }, cfg );
+    auto rng = NC::createBuiltinCounterRNG( seed );
+    tables.sampleDeltaEMuMany( 0, *rng, n, results_deltae, results_mu );
+    *xs = tables.crossSection( 0 ).dbl();
+    return;
+  } NCCATCH;
+  //non-halting-error, invalidate all output:
+  *xs = -1.0;
+  for ( unsigned long i = 0; i < n; ++i )
+    results_deltae[i] = results_mu[i] = -1.0;
+}
+
 void ncrystal_dyninfo_extract_vdosdebye( ncrystal_info_t ci,
                                          unsigned idyninfo,
                                          double * debye_temp )
@@ -853,6 +1109,56 @@ double ncrystal_info_dspacing_from_hkl( ncrystal_info_t ci, int h, int k, int l
   return -1.0;
 }
 
+void ncrystal_info_dspacing_from_hkl_many( ncrystal_info_t ci, unsigned long n,
+                                           const int* h, const int* k, const int* l,
+                                           double* out_dspacing )
+{
+  try {
+    std::vector<NC::HKL> hkls;
+    hkls.reserve( n );
+    for ( unsigned long i = 0; i < n; ++i )
+      hkls.emplace_back( h[i], k[i], l[i] );
+    ncc::extract(ci)->dspacingFromHKL( hkls.data(), hkls.size(), out_dspacing );
+    return;
+  } NCCATCH;
+  for ( unsigned long i = 0; i < n; ++i )
+    out_dspacing[i] = -1.0;
+}
+
+namespace NCrystal {
+  namespace NCCInterface {
+    namespace {
+      int findHKLIdx( const Info& info, int h, int k, int l )
+      {
+        const HKLInfo* hi = info.findHKL( HKL( h, k, l ) );
+        return hi ? static_cast<int>( hi - info.hklList().data() ) : -1;
+      }
+    }
+  }
+}
+
+int ncrystal_info_findhkl( ncrystal_info_t ci, int h, int k, int l )
+{
+  try {
+    return ncc::findHKLIdx( *ncc::extract(ci), h, k, l );
+  } NCCATCH;
+  return -1;
+}
+
+void ncrystal_info_findhkl_many( ncrystal_info_t ci, unsigned long n,
+                                 const int* h, const int* k, const int* l,
+                                 int* out_idx )
+{
+  try {
+    auto& info = *ncc::extract(ci);
+    for ( unsigned long i = 0; i < n; ++i )
+      out_idx[i] = ncc::findHKLIdx( info, h[i], k[i], l[i] );
+    return;
+  } NCCATCH;
+  for ( unsigned long i = 0; i < n; ++i )
+    out_idx[i] = -1;
+}
+
 double ncrystal_wl2ekin( double wl )
 {
   return NC::wl2ekin(wl);//doesn't throw
@@ -871,6 +1177,14 @@ int ncrystal_isnonoriented(ncrystal_process_t o)
   return 0;
 }
 
+int ncrystal_isstateless(ncrystal_process_t o)
+{
+  try {
+    return ncc::extractProcess(o).isStateless() ? 1 : 0;
+  } NCCATCH;
+  return 0;
+}
+
 const char * ncrystal_name(ncrystal_process_t o)
 {
   try {
@@ -879,6 +1193,17 @@ const char * ncrystal_name(ncrystal_process_t o)
   return 0;
 }
 
+int ncrystal_analytic_oov_coefficient( ncrystal_process_t o, double* coefficient )
+{
+  try {
+    auto oov = ncc::extractProcess(o).underlying().analyticOOVCrossSection();
+    *coefficient = oov.has_value() ? oov.value().coefficient : 0.0;
+    return oov.has_value() ? 1 : 0;
+  } NCCATCH;
+  *coefficient = -1.0;
+  return 0;
+}
+
 void ncrystal_domain( ncrystal_process_t o,
                       double* ekin_low, double* ekin_high)
 {
@@ -891,6 +1216,14 @@ void ncrystal_domain( ncrystal_process_t o,
   *ekin_low = *ekin_high = -1.0;
 }
 
+void ncrystal_warmup( ncrystal_process_t o, double ekin_low, double ekin_high, int complete )
+{
+  try {
+    ncc::extractProcess(o).warmup( NC::EnergyDomain{ NC::NeutronEnergy{ekin_low}, NC::NeutronEnergy{ekin_high} },
+                                   complete ? NC::WarmupLevel::Complete : NC::WarmupLevel::Essential );
+  } NCCATCH;
+}
+
 void ncrystal_crosssection( ncrystal_process_t o, double ekin, const double (*direction)[3], double* result)
 {
   try {
@@ -909,6 +1242,66 @@ void ncrystal_crosssection_nonoriented( ncrystal_process_t o, double ekin, doubl
   *result = -1.0;
 }
 
+void ncrystal_crosssection_scatabs( ncrystal_process_t scat, ncrystal_process_t abs,
+                                    double ekin, const double (*direction)[3],
+                                    double* result_scat, double* result_abs )
+{
+  try {
+    const NC::NeutronEnergy e{ekin};
+    *result_scat = ncc::extractProcess(scat).crossSection( e, NC::NeutronDirection{*direction} ).get();
+    if ( !abs.internal ) {
+      *result_abs = 0.0;
+      return;
+    }
+    auto& absproc = ncc::extractProcess(abs);
+    auto oov = absproc.underlying().analyticOOVCrossSection();
+    if ( oov.has_value() ) {
+      //Fast path for the common case of plain 1/v absorption:
+      *result_abs = oov.value().evaluate( e ).get();
+    } else {
+      *result_abs = absproc.crossSectionIsotropic( e ).get();
+    }
+    return;
+  } NCCATCH;
+  *result_scat = -1.0;
+  *result_abs = -1.0;
+}
+
+namespace NCrystal {
+  namespace NCCInterface {
+    namespace {
+      //Batched C functions pass the neutrons on to the batched C++ methods in
+      //chunks of this size:
+      constexpr unsigned long batch_chunksize = 4096;
+
+      //Sample scatterings of n neutrons (at most batch_chunksize) given as
+      //structure-of-arrays, using the provided buffers:
+      void sampleScatterSOAChunk( NC::Scatter& sc, unsigned long n,
+                                  const double * ekin, const double * dirx,
+                                  const double * diry, const double * dirz,
+                                  double* results_ekin, double * results_dirx,
+                                  double * results_diry, double * results_dirz,
+                                  std::vector<NC::NeutronDirection>& dirs,
+                                  std::vector<NC::ScatterOutcome>& outcomes )
+      {
+        nc_assert( n <= batch_chunksize );
+        dirs.clear();
+        for ( unsigned long i = 0; i < n; ++i )
+          dirs.emplace_back( dirx[i], diry[i], dirz[i] );
+        if ( outcomes.size() < n )
+          outcomes.resize( n, NC::ScatterOutcome{ NC::NeutronEnergy{0.0}, NC::NeutronDirection{0.0,0.0,1.0} } );
+        sc.sampleScatterMany( ekin, dirs.data(), n, outcomes.data() );
+        for ( unsigned long i = 0; i < n; ++i ) {
+          results_ekin[i] = outcomes[i].ekin.dbl();
+          results_dirx[i] = outcomes[i].direction[0];
+          results_diry[i] = outcomes[i].direction[1];
+          results_dirz[i] = outcomes[i].direction[2];
+        }
+      }
+    }
+  }
+}
+
 void ncrystal_crosssection_nonoriented_many( ncrystal_process_t o,
                                              const double * ekin,
                                              unsigned long n_ekin,
@@ -920,8 +1313,8 @@ void ncrystal_crosssection_nonoriented_many( ncrystal_process_t o,
   try {
     auto& process = ncc::extractProcess(o);
     while (repeat--) {
-      for (unsigned long i = 0; i < n_ekin; ++i)
-        *results++ = process.crossSectionIsotropic(NC::NeutronEnergy{ekin[i]}).get();
+      process.crossSectionIsotropicMany( ekin, n_ekin, results );
+      results += n_ekin;
     }
     return;
   } NCCATCH;
@@ -931,6 +1324,35 @@ void ncrystal_crosssection_nonoriented_many( ncrystal_process_t o,
   }
 }
 
+void ncrystal_crosssection_soa( ncrystal_process_t o,
+                                unsigned long n,
+                                const double * ekin,
+                                const double * dirx,
+                                const double * diry,
+                                const double * dirz,
+                                double* results )
+{
+  try {
+    auto& process = ncc::extractProcess(o);
+    if ( !process.isOriented() ) {
+      process.crossSectionIsotropicMany( ekin, n, results );
+      return;
+    }
+    std::vector<NC::NeutronDirection> dirs;
+    dirs.reserve( std::min<unsigned long>( n, ncc::batch_chunksize ) );
+    for ( unsigned long ioffset = 0; ioffset < n; ioffset += ncc::batch_chunksize ) {
+      const unsigned long nchunk = std::min<unsigned long>( ncc::batch_chunksize, n - ioffset );
+      dirs.clear();
+      for ( unsigned long i = ioffset; i < ioffset + nchunk; ++i )
+        dirs.emplace_back( dirx[i], diry[i], dirz[i] );
+      process.crossSectionMany( ekin + ioffset, dirs.data(), nchunk, results + ioffset );
+    }
+    return;
+  } NCCATCH;
+  for (unsigned long i = 0; i < n; ++i)
+    results[i] = -1.0;
+}
+
 void ncrystal_samplescatterisotropic( ncrystal_scatter_t o,
                                       double ekin,
                                       double* ekin_final,
@@ -964,6 +1386,235 @@ void ncrystal_samplescatter( ncrystal_scatter_t o,
   (*direction_final)[0] = (*direction_final)[1] = (*direction_final)[2] = 0.0;
 }
 
+void ncrystal_crosssection_and_samplescatter( ncrystal_scatter_t o,
+                                              double ekin,
+                                              const double (*direction)[3],
+                                              double* result_xs,
+                                              double* ekin_final,
+                                              double (*direction_final)[3] )
+{
+  try {
+    auto& sc = ncc::extract(o);
+    auto res = sc.crossSectionAndSampleScatter(NC::NeutronEnergy{ekin}, NC::NeutronDirection{*direction} );
+    *result_xs = res.first.dbl();
+    *ekin_final = res.second.ekin.dbl();
+    res.second.direction.applyTo(*direction_final);
+    return;
+  } NCCATCH;
+  *result_xs = -1.0;
+  *ekin_final = -1.0;
+  (*direction_final)[0] = (*direction_final)[1] = (*direction_final)[2] = 0.0;
+}
+
+
+ncrystal_cache_t ncrystal_create_cache()
+{
+  try {
+    return ncc::createNewCHandle<ncc::Wrapped_Cache>();
+  } NCCATCH;
+  return {nullptr};
+}
+
+namespace NCrystal {
+  namespace NCCInterface {
+    namespace {
+      //Implementations shared by the functions with explicit cache handles and
+      //their status code returning versions:
+      double crossSectionIsotropicWithCache( ncrystal_process_t o, ncrystal_cache_t c, double ekin )
+      {
+        auto& proc = extractProcess(o).underlying();
+        return proc.crossSectionIsotropic( extract(c).cacheFor(proc), NeutronEnergy{ekin} ).get();
+      }
+
+      double crossSectionWithCache( ncrystal_process_t o, ncrystal_cache_t c,
+                                    double ekin, const double (*direction)[3] )
+      {
+        auto& proc = extractProcess(o).underlying();
+        return proc.crossSection( extract(c).cacheFor(proc), NeutronEnergy{ekin},
+                                  NeutronDirection{*direction} ).get();
+      }
+
+      ScatterOutcomeIsotropic sampleScatterIsotropicWithCache( ncrystal_scatter_t o, ncrystal_cache_t c,
+                                                               double (*rng)(), double ekin )
+      {
+        auto& proc = extract(o).underlying();
+        auto& cache = extract(c);
+        if ( !rng )
+          return proc.sampleScatterIsotropic( cache.cacheFor(proc), cache.rng(), NeutronEnergy{ekin} );
+        CFctRNG crng(rng);
+        return proc.sampleScatterIsotropic( cache.cacheFor(proc), crng, NeutronEnergy{ekin} );
+      }
+
+      ScatterOutcome sampleScatterWithCache( ncrystal_scatter_t o, ncrystal_cache_t c,
+                                             double (*rng)(), double ekin,
+                                             const double (*direction)[3] )
+      {
+        auto& proc = extract(o).underlying();
+        auto& cache = extract(c);
+        const NeutronDirection dir{*direction};
+        if ( !rng )
+          return proc.sampleScatter( cache.cacheFor(proc), cache.rng(), NeutronEnergy{ekin}, dir );
+        CFctRNG crng(rng);
+        return proc.sampleScatter( cache.cacheFor(proc), crng, NeutronEnergy{ekin}, dir );
+      }
+    }
+  }
+}
+
+void ncrystal_crosssection_nonoriented_c( ncrystal_process_t o, ncrystal_cache_t c,
+                                          double ekin, double* result )
+{
+  try {
+    *result = ncc::crossSectionIsotropicWithCache( o, c, ekin );
+    return;
+  } NCCATCH;
+  *result = -1.0;
+}
+
+void ncrystal_crosssection_c( ncrystal_process_t o, ncrystal_cache_t c,
+                              double ekin, const double (*direction)[3], double* result )
+{
+  try {
+    *result = ncc::crossSectionWithCache( o, c, ekin, direction );
+    return;
+  } NCCATCH;
+  *result = -1.0;
+}
+
+void ncrystal_samplescatterisotropic_c( ncrystal_scatter_t o, ncrystal_cache_t c,
+                                        double (*rng)(), double ekin,
+                                        double* ekin_final, double* cos_scat_angle )
+{
+  try {
+    auto outcome = ncc::sampleScatterIsotropicWithCache( o, c, rng, ekin );
+    *ekin_final = outcome.ekin.dbl();
+    *cos_scat_angle = outcome.mu.dbl();
+    return;
+  } NCCATCH;
+  *ekin_final = -1.0;
+  *cos_scat_angle = -999;
+}
+
+void ncrystal_samplescatter_c( ncrystal_scatter_t o, ncrystal_cache_t c,
+                               double (*rng)(), double ekin,
+                               const double (*direction)[3],
+                               double* ekin_final,
+                               double (*direction_final)[3] )
+{
+  try {
+    auto outcome = ncc::sampleScatterWithCache( o, c, rng, ekin, direction );
+    *ekin_final = outcome.ekin.dbl();
+    outcome.direction.applyTo(*direction_final);
+    return;
+  } NCCATCH;
+  *ekin_final = -1.0;
+  (*direction_final)[0] = (*direction_final)[1] = (*direction_final)[2] = 0.0;
+}
+
+int ncrystal_crosssection_nonoriented_st( ncrystal_process_t o, double ekin, double* result )
+{
+  try {
+    *result = ncc::extractProcess(o).crossSectionIsotropic( NC::NeutronEnergy{ekin} ).get();
+    return 0;
+  } NCCATCH_STATUS;
+  *result = -1.0;
+  return 1;
+}
+
+int ncrystal_crosssection_st( ncrystal_process_t o, double ekin,
+                              const double (*direction)[3], double* result )
+{
+  try {
+    *result = ncc::extractProcess(o).crossSection( NC::NeutronEnergy{ekin}, NC::NeutronDirection{*direction} ).get();
+    return 0;
+  } NCCATCH_STATUS;
+  *result = -1.0;
+  return 1;
+}
+
+int ncrystal_samplescatterisotropic_st( ncrystal_scatter_t o, double ekin,
+                                        double* ekin_final, double* cos_scat_angle )
+{
+  try {
+    auto outcome = ncc::extract(o).sampleScatterIsotropic( NC::NeutronEnergy{ekin} );
+    *ekin_final = outcome.ekin.dbl();
+    *cos_scat_angle = outcome.mu.dbl();
+    return 0;
+  } NCCATCH_STATUS;
+  *ekin_final = -1.0;
+  *cos_scat_angle = -999;
+  return 1;
+}
+
+int ncrystal_samplescatter_st( ncrystal_scatter_t o, double ekin,
+                               const double (*direction)[3],
+                               double* ekin_final,
+                               double (*direction_final)[3] )
+{
+  try {
+    auto outcome = ncc::extract(o).sampleScatter( NC::NeutronEnergy{ekin}, NC::NeutronDirection{*direction} );
+    *ekin_final = outcome.ekin.dbl();
+    outcome.direction.applyTo(*direction_final);
+    return 0;
+  } NCCATCH_STATUS;
+  *ekin_final = -1.0;
+  (*direction_final)[0] = (*direction_final)[1] = (*direction_final)[2] = 0.0;
+  return 1;
+}
+
+int ncrystal_crosssection_nonoriented_c_st( ncrystal_process_t o, ncrystal_cache_t c,
+                                            double ekin, double* result )
+{
+  try {
+    *result = ncc::crossSectionIsotropicWithCache( o, c, ekin );
+    return 0;
+  } NCCATCH_STATUS;
+  *result = -1.0;
+  return 1;
+}
+
+int ncrystal_crosssection_c_st( ncrystal_process_t o, ncrystal_cache_t c,
+                                double ekin, const double (*direction)[3], double* result )
+{
+  try {
+    *result = ncc::crossSectionWithCache( o, c, ekin, direction );
+    return 0;
+  } NCCATCH_STATUS;
+  *result = -1.0;
+  return 1;
+}
+
+int ncrystal_samplescatterisotropic_c_st( ncrystal_scatter_t o, ncrystal_cache_t c,
+                                          double (*rng)(), double ekin,
+                                          double* ekin_final, double* cos_scat_angle )
+{
+  try {
+    auto outcome = ncc::sampleScatterIsotropicWithCache( o, c, rng, ekin );
+    *ekin_final = outcome.ekin.dbl();
+    *cos_scat_angle = outcome.mu.dbl();
+    return 0;
+  } NCCATCH_STATUS;
+  *ekin_final = -1.0;
+  *cos_scat_angle = -999;
+  return 1;
+}
+
+int ncrystal_samplescatter_c_st( ncrystal_scatter_t o, ncrystal_cache_t c,
+                                 double (*rng)(), double ekin,
+                                 const double (*direction)[3],
+                                 double* ekin_final,
+                                 double (*direction_final)[3] )
+{
+  try {
+    auto outcome = ncc::sampleScatterWithCache( o, c, rng, ekin, direction );
+    *ekin_final = outcome.ekin.dbl();
+    outcome.direction.applyTo(*direction_final);
+    return 0;
+  } NCCATCH_STATUS;
+  *ekin_final = -1.0;
+  (*direction_final)[0] = (*direction_final)[1] = (*direction_final)[2] = 0.0;
+  return 1;
+}
 
 void ncrystal_samplescatterisotropic_many( ncrystal_scatter_t o,
                                            const double * ekin,
@@ -977,11 +1628,30 @@ void ncrystal_samplescatterisotropic_many( ncrystal_scatter_t o,
   double* results_cos_scat_angle_orig = results_cos_scat_angle;
   try {
     auto& sc = ncc::extract(o);
+    std::vector<NC::ScatterOutcomeIsotropic> outcomes;
+    if ( n_ekin == 1 ) {
+      //All samplings at the same energy:
+      outcomes.resize( std::min<unsigned long>( repeat, ncc::batch_chunksize ) );
+      while ( repeat ) {
+        const unsigned long nchunk = std::min<unsigned long>( ncc::batch_chunksize, repeat );
+        sc.sampleScatterIsotropicRepeated( NC::NeutronEnergy{ *ekin }, nchunk, outcomes.data() );
+        for ( unsigned long i = 0; i < nchunk; ++i ) {
+          *results_ekin++ = outcomes[i].ekin.dbl();
+          *results_cos_scat_angle++ = outcomes[i].mu.dbl();
+        }
+        repeat -= nchunk;
+      }
+      return;
+    }
+    outcomes.resize( std::min<unsigned long>( n_ekin, ncc::batch_chunksize ) );
     while (repeat--) {
-      for (unsigned long i = 0; i < n_ekin; ++i) {
-        auto outcome = sc.sampleScatterIsotropic(NC::NeutronEnergy{ekin[i]});
-        *results_ekin++ = outcome.ekin.dbl();
-        *results_cos_scat_angle++ = outcome.mu.dbl();
+      for ( unsigned long ioffset = 0; ioffset < n_ekin; ioffset += ncc::batch_chunksize ) {
+        const unsigned long nchunk = std::min<unsigned long>( ncc::batch_chunksize, n_ekin - ioffset );
+        sc.sampleScatterIsotropicMany( ekin + ioffset, nchunk, outcomes.data() );
+        for ( unsigned long i = 0; i < nchunk; ++i ) {
+          *results_ekin++ = outcomes[i].ekin.dbl();
+          *results_cos_scat_angle++ = outcomes[i].mu.dbl();
+        }
       }
     }
     return;
@@ -1012,12 +1682,18 @@ void ncrystal_samplescatter_many( ncrystal_scatter_t o,
   try {
     NC::NeutronDirection dir{ *direction };
     auto& sc = ncc::extract(o);
-    while (repeat--) {
-      auto outcome = sc.sampleScatter(NC::NeutronEnergy{ekin}, dir);
-      *results_ekin++ = outcome.ekin.dbl();
-      *results_dirx++ = outcome.direction[0];
-      *results_diry++ = outcome.direction[1];
-      *results_dirz++ = outcome.direction[2];
+    const unsigned long nbuf = std::min<unsigned long>( repeat, ncc::batch_chunksize );
+    std::vector<NC::ScatterOutcome> outcomes( nbuf, NC::ScatterOutcome{ NC::NeutronEnergy{ekin}, dir } );
+    while ( repeat ) {
+      const unsigned long nchunk = std::min<unsigned long>( nbuf, repeat );
+      sc.sampleScatterRepeated( NC::NeutronEnergy{ekin}, dir, nchunk, outcomes.data() );
+      for ( unsigned long i = 0; i < nchunk; ++i ) {
+        *results_ekin++ = outcomes[i].ekin.dbl();
+        *results_dirx++ = outcomes[i].direction[0];
+        *results_diry++ = outcomes[i].direction[1];
+        *results_dirz++ = outcomes[i].direction[2];
+      }
+      repeat -= nchunk;
     }
     return;
   } NCCATCH;
@@ -1031,6 +1707,271 @@ void ncrystal_samplescatter_many( ncrystal_scatter_t o,
 
 }
 
+void ncrystal_samplescatter_soa( ncrystal_scatter_t o,
+                                 unsigned long n,
+                                 const double * ekin,
+                                 const double * dirx,
+                                 const double * diry,
+                                 const double * dirz,
+                                 double* results_ekin,
+                                 double * results_dirx,
+                                 double * results_diry,
+                                 double * results_dirz )
+{
+  try {
+    auto& sc = ncc::extract(o);
+    std::vector<NC::NeutronDirection> dirs;
+    dirs.reserve( std::min<unsigned long>( n, ncc::batch_chunksize ) );
+    std::vector<NC::ScatterOutcome> outcomes;
+    for ( unsigned long ioffset = 0; ioffset < n; ioffset += ncc::batch_chunksize ) {
+      const unsigned long nchunk = std::min<unsigned long>( ncc::batch_chunksize, n - ioffset );
+      ncc::sampleScatterSOAChunk( sc, nchunk, ekin + ioffset, dirx + ioffset, diry + ioffset, dirz + ioffset,
+                                  results_ekin + ioffset, results_dirx + ioffset,
+                                  results_diry + ioffset, results_dirz + ioffset,
+                                  dirs, outcomes );
+    }
+    return;
+  } NCCATCH;
+  //non-halting-error, invalidate all output:
+  for ( unsigned long i = 0; i < n; ++i ) {
+    results_ekin[i] = -1.0;
+    results_dirx[i] = results_diry[i] = results_dirz[i] = 0.0;
+  }
+}
+
+void ncrystal_samplescatter_soa_mt( ncrystal_scatter_t o,
+                                    unsigned nthreads,
+                                    unsigned long rngstreamidx_offset,
+                                    unsigned long n,
+                                    const double * ekin,
+                                    const double * dirx,
+                                    const double * diry,
+                                    const double * dirz,
+                                    double* results_ekin,
+                                    double * results_dirx,
+                                    double * results_diry,
+                                    double * results_dirz )
+{
+  try {
+    auto& sc = ncc::extract(o);
+    //Each chunk gets its own clone with a dedicated RNG stream, so the results
+    //do not depend on the number of threads. The clones are created in the
+    //calling thread in the order of the chunks, since RNG streams which can
+    //not be created directly from an index are otherwise handed out in the
+    //order of the requests. Clones are created for a limited number of chunks
+    //at a time, to keep memory usage bounded:
+    const std::size_t nchunks = ( n + ncc::batch_chunksize - 1 ) / ncc::batch_chunksize;
+    const std::size_t ngroup = 16 * std::max<std::size_t>( 1, nthreads );
+    std::vector<NC::Scatter> clones;
+    clones.reserve( std::min( ngroup, nchunks ) );
+    for ( std::size_t igroup = 0; igroup < nchunks; igroup += ngroup ) {
+      clones.clear();
+      const std::size_t ngroupchunks = std::min( ngroup, nchunks - igroup );
+      for ( std::size_t i = 0; i < ngroupchunks; ++i )
+        clones.push_back( sc.cloneByIdx( NC::RNGStreamIndex{ static_cast<uint64_t>( rngstreamidx_offset + igroup + i ) } ) );
+      //RNG streams used in all threads are shared by the clones, so the
+      //chunks must then be processed sequentially:
+      auto rngstream = dynamic_cast<const NC::RNGStream*>( &clones.front().rng() );
+      const unsigned nthreads_group = ( rngstream && rngstream->useInAllThreads() ) ? 1 : nthreads;
+      NC::parallelForIndex( ngroupchunks, nthreads_group, [&]( std::size_t i )
+      {
+        const unsigned long ioffset = ( igroup + i ) * ncc::batch_chunksize;
+        const unsigned long nchunk = std::min<unsigned long>( ncc::batch_chunksize, n - ioffset );
+        std::vector<NC::NeutronDirection> dirs;
+        dirs.reserve( nchunk );
+        std::vector<NC::ScatterOutcome> outcomes;
+        ncc::sampleScatterSOAChunk( clones[i], nchunk, ekin + ioffset, dirx + ioffset, diry + ioffset, dirz + ioffset,
+                                    results_ekin + ioffset, results_dirx + ioffset,
+                                    results_diry + ioffset, results_dirz + ioffset,
+                                    dirs, outcomes );
+      } );
+    }
+    return;
+  } NCCATCH;
+  //non-halting-error, invalidate all output:
+  for ( unsigned long i = 0; i < n; ++i ) {
+    results_ekin[i] = -1.0;
+    results_dirx[i] = results_diry[i] = results_dirz[i] = 0.0;
+  }
+}
+
+void ncrystal_samplescatter_soa_byidx( ncrystal_scatter_t o,
+                                       unsigned nthreads,
+                                       unsigned long seed,
+                                       unsigned long neutronid_offset,
+                                       unsigned long n,
+                                       const double * ekin,
+                                       const double * dirx,
+                                       const double * diry,
+                                       const double * dirz,
+                                       double* results_ekin,
+                                       double * results_dirx,
+                                       double * results_diry,
+                                       double * results_dirz )
+{
+  try {
+    //Every neutron has its own RNG stream, so chunks can be handled in any
+    //thread, each with its own cache:
+    const auto& proc = ncc::extract(o).underlying();
+    const std::size_t nchunks = ( n + ncc::batch_chunksize - 1 ) / ncc::batch_chunksize;
+    NC::parallelForIndex( nchunks, nthreads, [&]( std::size_t ichunk )
+    {
+      const unsigned long i0 = ichunk * ncc::batch_chunksize;
+      const unsigned long i1 = std::min<unsigned long>( i0 + ncc::batch_chunksize, n );
+      NC::CachePtr cacheptr;
+      NC::RandPhiloxSubstream rng;
+      for ( unsigned long i = i0; i < i1; ++i ) {
+        rng.reset( seed, static_cast<uint64_t>( neutronid_offset ) + i );
+        auto outcome = proc.sampleScatter( cacheptr, rng, NC::NeutronEnergy{ ekin[i] },
+                                           NC::NeutronDirection{ dirx[i], diry[i], dirz[i] } );
+        results_ekin[i] = outcome.ekin.dbl();
+        results_dirx[i] = outcome.direction[0];
+        results_diry[i] = outcome.direction[1];
+        results_dirz[i] = outcome.direction[2];
+      }
+    } );
+    return;
+  } NCCATCH;
+  //non-halting-error, invalidate all output:
+  for ( unsigned long i = 0; i < n; ++i ) {
+    results_ekin[i] = -1.0;
+    results_dirx[i] = results_diry[i] = results_dirz[i] = 0.0;
+  }
+}
+
+void ncrystal_minitransport_mt( ncrystal_scatter_t o,
+                                ncrystal_absorption_t a,
+                                double numberdensity,
+                                int shape,
+                                const double * shapeparams,
+                                int absmode,
+                                unsigned maxscat,
+                                unsigned nthreads,
+                                unsigned long rngstreamidx_offset,
+                                unsigned long n,
+                                double * x, double * y, double * z,
+                                double * ux, double * uy, double * uz,
+                                double * ekin, double * weight,
+                                unsigned * nscat, int * status,
+                                unsigned ntallybins,
+                                double * tallies )
+{
+  try {
+    namespace NCMT = NC::MiniTransport;
+    auto& sc = ncc::extract(o);
+    const NC::Absorption * abs = a.internal ? &ncc::extract(a) : nullptr;
+    NCMT::Config cfg;
+    switch ( shape ) {
+    case 0: cfg.geometry = NCMT::Geometry::slab( shapeparams[0] ); break;
+    case 1: cfg.geometry = NCMT::Geometry::box( shapeparams[0], shapeparams[1], shapeparams[2] ); break;
+    case 2: cfg.geometry = NCMT::Geometry::cylinder( shapeparams[0], shapeparams[1] ); break;
+    case 3: cfg.geometry = NCMT::Geometry::sphere( shapeparams[0] ); break;
+    default:
+      NCRYSTAL_THROW2(BadInput,"ncrystal_minitransport_mt: invalid shape code ("<<shape<<")");
+    }
+    switch ( absmode ) {
+    case 0: cfg.absorptionMode = NCMT::AbsorptionMode::None; break;
+    case 1: cfg.absorptionMode = NCMT::AbsorptionMode::Weight; break;
+    case 2: cfg.absorptionMode = NCMT::AbsorptionMode::Terminate; break;
+    default:
+      NCRYSTAL_THROW2(BadInput,"ncrystal_minitransport_mt: invalid absmode ("<<absmode<<")");
+    }
+    if ( tallies && ntallybins == 0 )
+      NCRYSTAL_THROW(BadInput,"ncrystal_minitransport_mt: ntallybins must be positive");
+    cfg.maxScatterings = maxscat;
+    cfg.nthreads = nthreads;
+    cfg.rngStreamIndexOffset = rngstreamidx_offset;
+
+    std::vector<NCMT::NeutronState> in;
+    in.reserve( n );
+    for ( unsigned long i = 0; i < n; ++i )
+      in.push_back( NCMT::NeutronState{ { x[i], y[i], z[i] }, { ux[i], uy[i], uz[i] }, ekin[i], weight[i] } );
+    std::vector<NCMT::ExitState> out( n );
+    NC::Optional<NCMT::Tallies> tal;
+    if ( tallies )
+      tal.emplace( ntallybins );
+    NCMT::propagate( sc, abs, NC::NumberDensity{ numberdensity }, cfg, in.data(), n, out.data(),
+                     tal.has_value() ? &tal.value() : nullptr );
+    for ( unsigned long i = 0; i < n; ++i ) {
+      const NCMT::NeutronState& s = out[i].state;
+      x[i] = s.pos[0]; y[i] = s.pos[1]; z[i] = s.pos[2];
+      ux[i] = s.dir[0]; uy[i] = s.dir[1]; uz[i] = s.dir[2];
+      ekin[i] = s.ekin;
+      weight[i] = s.weight;
+      nscat[i] = out[i].nscat;
+      status[i] = static_cast<int>( out[i].status );
+    }
+    if ( tallies ) {
+      std::copy( tal.value().exitWeightByNScat.begin(), tal.value().exitWeightByNScat.end(), tallies );
+      tallies[ntallybins] = tal.value().absorbedWeight;
+      tallies[ntallybins+1] = tal.value().missedWeight;
+      tallies[ntallybins+2] = tal.value().abandonedWeight;
+    }
+    return;
+  } NCCATCH;
+  //non-halting-error, invalidate all output:
+  for ( unsigned long i = 0; i < n; ++i )
+    status[i] = -1;
+}
+
+void ncrystal_calc_transmission( ncrystal_info_t ci,
+                                 ncrystal_scatter_t o,
+                                 ncrystal_absorption_t a,
+                                 unsigned long nwl,
+                                 const double * wavelengths,
+                                 unsigned long nthick,
+                                 const double * thicknesses,
+                                 unsigned nthreads,
+                                 double * results )
+{
+  try {
+    auto& info = ncc::extract(ci);
+    auto& sc = ncc::extract(o);
+    const NC::ProcImpl::Process * abs = a.internal ? &ncc::extract(a).underlying() : nullptr;
+    NC::calcTransmission( info, sc.underlying(), abs,
+                          NC::Span<const double>( wavelengths, wavelengths + nwl ),
+                          NC::Span<const double>( thicknesses, thicknesses + nthick ),
+                          NC::Span<double>( results, results + nwl * nthick ),
+                          nthreads );
+    return;
+  } NCCATCH;
+  //non-halting-error, invalidate all output:
+  for ( unsigned long i = 0; i < nwl * nthick; ++i )
+    results[i] = -1.0;
+}
+
+void ncrystal_calc_powder_pattern( ncrystal_scatter_t o,
+                                   unsigned long nekin,
+                                   const double * ekin,
+                                   const double * weights,
+                                   unsigned long nbins,
+                                   const double * bin_edges,
+                                   unsigned nsamples_background,
+                                   unsigned long seed,
+                                   unsigned nthreads,
+                                   double * results_bragg,
+                                   double * results_background )
+{
+  try {
+    auto& sc = ncc::extract(o);
+    NC::PowderPatternCfg cfg;
+    cfg.binEdges.assign( bin_edges, bin_edges + nbins + 1 );
+    cfg.nSamplesBackground = nsamples_background;
+    cfg.seed = seed;
+    cfg.nthreads = nthreads;
+    auto res = NC::calcPowderPattern( sc.underlyingPtr(),
+                                      NC::Span<const double>( ekin, ekin + nekin ),
+                                      NC::Span<const double>( weights, weights + nekin ),
+                                      cfg );
+    std::copy( res.totalBragg.begin(), res.totalBragg.end(), results_bragg );
+    std::copy( res.totalBackground.begin(), res.totalBackground.end(), results_background );
+    return;
+  } NCCATCH;
+  //non-halting-error, invalidate all output:
+  for ( unsigned long i = 0; i < nbins; ++i )
+    results_bragg[i] = results_background[i] = -1.0;
+}
+
 void ncrystal_genscatter_nonoriented( ncrystal_scatter_t o, double ekin, double* result_angle, double* result_dekin )
 {
   //obsolete fct:
@@ -1079,12 +2020,18 @@ void ncrystal_genscatter_many( ncrystal_scatter_t o,
   try {
     NC::NeutronDirection dir{ *indir };
     auto& sc = ncc::extract(o);
-    while (repeat--) {
-      auto outcome = sc.sampleScatter(NC::NeutronEnergy{ekin}, dir);
-      *results_dekin++ = outcome.ekin.get() - ekin;
-      *results_dirx++ = outcome.direction[0];
-      *results_diry++ = outcome.direction[1];
-      *results_dirz++ = outcome.direction[2];
+    const unsigned long nbuf = std::min<unsigned long>( repeat, ncc::batch_chunksize );
+    std::vector<NC::ScatterOutcome> outcomes( nbuf, NC::ScatterOutcome{ NC::NeutronEnergy{ekin}, dir } );
+    while ( repeat ) {
+      const unsigned long nchunk = std::min<unsigned long>( nbuf, repeat );
+      sc.sampleScatterRepeated( NC::NeutronEnergy{ekin}, dir, nchunk, outcomes.data() );
+      for ( unsigned long i = 0; i < nchunk; ++i ) {
+        *results_dekin++ = outcomes[i].ekin.get() - ekin;
+        *results_dirx++ = outcomes[i].direction[0];
+        *results_diry++ = outcomes[i].direction[1];
+        *results_dirz++ = outcomes[i].direction[2];
+      }
+      repeat -= nchunk;
     }
     return;
   } NCCATCH;
@@ -1176,6 +2123,14 @@ int ncrystal_info_nphases( ncrystal_info_t ih )
   return -1;
 }
 
+double ncrystal_info_memoryfootprint( ncrystal_info_t ih )
+{
+  try {
+    return static_cast<double>(ncc::extract(ih)->memoryFootprint());
+  } NCCATCH;
+  return -1.0;
+}
+
 ncrystal_info_t ncrystal_info_getphase( ncrystal_info_t ih, int iphase, double* fraction )
 {
   *fraction = -1.0;
@@ -1261,6 +2216,18 @@ ncrystal_scatter_t ncrystal_clone_scatter_rngforcurrentthread( ncrystal_scatter_
   return {nullptr};
 }
 
+ncrystal_scatter_t ncrystal_clone_scatter_dspacingscaled( ncrystal_scatter_t sh, double dspacing_scale )
+{
+  try {
+    auto& sc = ncc::extract(sh);
+    return ncc::createNewCHandle<ncc::Wrapped_Scatter>( NC::Scatter( sc.rngproducerSO(),
+                                                                     sc.rngproducer().produce(),
+                                                                     NC::applyDSpacingScale( sc.underlyingPtr(),
+                                                                                             dspacing_scale ) ) );
+  } NCCATCH;
+  return {nullptr};
+}
+
 ncrystal_scatter_t ncrystal_create_scatter_builtinrng( const char * cfgstr, unsigned long seed )
 {
   try {
@@ -1511,6 +2478,30 @@ void ncrystal_info_getcomponent( ncrystal_info_t ci, unsigned icomponent,
   *fraction = -1.0;
 }
 
+unsigned ncrystal_info_nflatcomponents( ncrystal_info_t ci )
+{
+  try {
+    auto n = ncc::extract(ci)->getFlatComposition().size();
+    nc_assert( n>0 && n < std::numeric_limits<unsigned>::max() );
+    return static_cast<unsigned>(n);
+  } NCCATCH;
+  return 0;
+}
+
+void ncrystal_info_getflatcomponents( ncrystal_info_t ci, unsigned* Z, unsigned* A,
+                                      double* fraction )
+{
+  try {
+    const auto& flatcomp = ncc::extract(ci)->getFlatComposition();
+    for ( auto i : NC::ncrange( flatcomp.size() ) ) {
+      Z[i] = flatcomp[i].Z;
+      A[i] = flatcomp[i].A;
+      fraction[i] = flatcomp[i].fraction;
+    }
+    return;
+  } NCCATCH;
+}
+
 ncrystal_atomdata_t ncrystal_create_atomdata_fromdb( unsigned z, unsigned a )
 {
   try {
@@ -1617,6 +2608,26 @@ void ncrystal_dealloc_stringlist( unsigned length, char** sl )
   }
 }
 
+double* ncrystal_export_flat_tables( ncrystal_scatter_t sc, unsigned long* length )
+{
+  try {
+    auto& scat = ncc::extract(sc);
+    NC::VectD v = NC::exportFlatIsotropic( scat.underlyingPtr() );
+    double * res = new double[v.size()];
+    std::copy( v.begin(), v.end(), res );
+    *length = v.size();
+    return res;
+  } NCCATCH;
+  *length = 0;
+  return nullptr;
+}
+
+void ncrystal_dealloc_doublearray( double* dd )
+{
+  if (dd)
+    delete[] dd;
+}
+
 void ncrystal_dealloc_string( char* ss )
 {
   if (ss)
@@ -1794,6 +2805,75 @@ void ncrystal_get_plugin_list( unsigned* nstrs,
   } NCCATCH;
 }
 
+char * ncrystal_factory_stats_json()
+{
+  try {
+    std::ostringstream ss;
+    ss << '[';
+    bool first = true;
+    for ( auto& e : NC::getAllFactoryStats() ) {
+      if ( !first )
+        ss << ',';
+      first = false;
+      const auto& s = e.second;
+      NC::streamJSONDictEntry( ss, "name", e.first, NC::JSONDictPos::FIRST );
+      NC::streamJSONDictEntry( ss, "nstrongrefs", static_cast<std::uint64_t>(s.nstrongrefs) );
+      NC::streamJSONDictEntry( ss, "nweakrefs", static_cast<std::uint64_t>(s.nweakrefs) );
+      NC::streamJSONDictEntry( ss, "nalive", static_cast<std::uint64_t>(s.nalive) );
+      NC::streamJSONDictEntry( ss, "strongRefBytes", static_cast<std::uint64_t>(s.strongRefBytes) );
+      NC::streamJSONDictEntry( ss, "aliveBytes", static_cast<std::uint64_t>(s.aliveBytes) );
+      NC::streamJSONDictEntry( ss, "nevictions", static_cast<std::uint64_t>(s.nevictions), NC::JSONDictPos::LAST );
+    }
+    ss << ']';
+    return ncc::createString(ss.str());
+  } NCCATCH;
+  return nullptr;
+}
+
+void ncrystal_create_snapshot( unsigned ncfgs, const char ** cfgstrs, const char * dirname )
+{
+  try {
+    std::vector<NC::MatCfg> cfgs;
+    cfgs.reserve( ncfgs );
+    for ( unsigned i = 0; i < ncfgs; ++i )
+      cfgs.emplace_back( cfgstrs[i] );
+    NC::createSnapshot( cfgs, dirname );
+  } NCCATCH;
+}
+
+void ncrystal_load_snapshot( const char * dirname, unsigned* ncfgs, char*** cfgstrs )
+{
+  *ncfgs = 0;
+  *cfgstrs = nullptr;
+  try {
+    ncc::createStringList( NC::loadSnapshot( dirname ), cfgstrs, ncfgs );
+  } NCCATCH;
+}
+
+void ncrystal_export_xstable( const char * cfgstr, const char * filename,
+                              double tolerance, double emin, double emax )
+{
+  try {
+    NC::ProcImpl::ProcCompTabulationCfg cfg;
+    cfg.tolerance = tolerance;
+    cfg.emin = NC::NeutronEnergy{emin};
+    cfg.emax = NC::NeutronEnergy{emax};
+    NC::exportTabulatedXS( cfgstr, filename, cfg );
+  } NCCATCH;
+}
+
+ncrystal_scatter_t ncrystal_load_xstable( const char * filename )
+{
+  try {
+    auto rngproducer = NC::getDefaultRNGProducer();
+    auto rng = rngproducer->produce();
+    return ncc::createNewCHandle<ncc::Wrapped_Scatter>( NC::Scatter( std::move(rngproducer),
+                                                                     std::move(rng),
+                                                                     NC::loadTabulatedXS( filename ) ) );
+  } NCCATCH;
+  return {nullptr};
+}
+
 char* ncrystal_get_file_contents( const char * name )
 {
   try {
@@ -0,0 +1,442 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+//Validation of approximate modes against the reference implementation, built
+//when NCrystal is configured with -DBUILD_BENCHMARKS=ON. The approximation is
+//specified either as a cfg-string fragment applied on top of the cfg-string
+//of each material (e.g. "vdoslux=1", "sabgrid=200" or "sabsampler=..."), or
+//as "tabulated", in which case the reference scattering process is wrapped in
+//a TabulatedXSProcess (see NCTabulatedXS.hh). Build options like
+//ENABLE_FASTMATH can be validated by running the same comparison with
+//different builds, and comparing the reported speed-ups.
+//
+//For each .ncmat file reported by DataSources::listAvailableFiles()
+//(except files found relative to the working directory), the scattering
+//processes are compared as follows:
+//
+//  * Cross sections are evaluated on a dense logarithmic energy grid in
+//    [1e-5,10]eV, and the maximal and mean relative errors are reported (with
+//    errors measured relative to the largest of the reference cross section
+//    and 1e-3 times its maximal value on the grid, to avoid blowing up
+//    errors where the cross section vanishes).
+//
+//  * Scatterings are sampled at a few neutron energies with both processes,
+//    and the distributions of final energies and scattering angle cosines are
+//    compared with two-sample Kolmogorov-Smirnov tests. The largest KS
+//    distance and smallest p-value over all energies and both variables are
+//    reported (note that p-values are only approximate for discrete
+//    distributions, like those of Bragg diffraction).
+//
+//  * Speed-ups (reference time divided by approximate time) are reported for
+//    initialisation after clearing caches (for "tabulated", this includes
+//    creating the reference process and the table), cross section evaluation
+//    and scattering sampling.
+//
+//Usage: ncrystal_approxcheck [-n <nsamples>] [-g <ngrid>] [-x <maxrelerr>]
+//                            [-p <minpvalue>] [-o <report.json>]
+//                            <approx> [<name-filter> ...]
+//
+//The -n and -g options set the number of samples per energy (default 20000)
+//and grid points (default 20000). If -x and/or -p are given, materials
+//exceeding the limits are marked as failures, and the exit code will be
+//non-zero if any failures occurred. The -o option additionally writes the
+//results to a JSON file. If name filters are given, only files containing
+//one of the filters in their name are used. Data files are located as
+//usual, so NCRYSTAL_DATA_PATH might have to be set when running from a build
+//directory.
+
+#include "NCrystal/NCrystal.hh"
+#include "NCrystal/internal/NCTabulatedXS.hh"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+namespace NC = NCrystal;
+
+namespace {
+
+  using clock = std::chrono::steady_clock;
+
+  double secondsSince( clock::time_point t0 )
+  {
+    return std::chrono::duration<double>( clock::now() - t0 ).count();
+  }
+
+  struct Settings {
+    std::string approx;
+    std::size_t nsamples = 20000;
+    std::size_t ngrid = 20000;
+    double maxRelErr = -1.0;//limits are only applied if >=0
+    double minPValue = -1.0;
+  };
+
+  struct Result {
+    std::string name;
+    std::string error;//set if comparison could not be carried out
+    double xsMaxRelErr = 0.0;
+    double xsMeanRelErr = 0.0;
+    double ksMaxDist = 0.0;
+    double ksMinPValue = 1.0;
+    double speedupInit = 0.0;
+    double speedupXS = 0.0;
+    double speedupSampling = 0.0;
+    bool failed = false;
+  };
+
+  //Wrapper evaluating a process through either the isotropic or the oriented
+  //interface (using a fixed direction in the latter case):
+  class ProcEval {
+  public:
+    ProcEval( NC::ProcImpl::ProcPtr p, bool oriented )
+      : m_proc( std::move(p) ), m_oriented( oriented ) {}
+    double xs( NC::NeutronEnergy ekin )
+    {
+      return ( m_oriented
+               ? m_proc->crossSection( m_cache, ekin, s_dir )
+               : m_proc->crossSectionIsotropic( m_cache, ekin ) ).get();
+    }
+    NC::ScatterOutcomeIsotropic sample( NC::RNG& rng, NC::NeutronEnergy ekin )
+    {
+      if ( !m_oriented )
+        return m_proc->sampleScatterIsotropic( m_cache, rng, ekin );
+      auto out = m_proc->sampleScatter( m_cache, rng, ekin, s_dir );
+      return { out.ekin, NC::CosineScatAngle{ out.direction[2] } };
+    }
+  private:
+    NC::ProcImpl::ProcPtr m_proc;
+    NC::CachePtr m_cache;
+    bool m_oriented;
+    static const NC::NeutronDirection s_dir;
+  };
+  const NC::NeutronDirection ProcEval::s_dir{ 0.0, 0.0, 1.0 };
+
+  //Two-sample Kolmogorov-Smirnov test (sorts the input vectors), returning
+  //the distance and the asymptotic p-value:
+  std::pair<double,double> ksTest( std::vector<double>& a, std::vector<double>& b )
+  {
+    std::sort( a.begin(), a.end() );
+    std::sort( b.begin(), b.end() );
+    const double na = a.size();
+    const double nb = b.size();
+    std::size_t ia = 0, ib = 0;
+    double d = 0.0;
+    while ( ia < a.size() && ib < b.size() ) {
+      const double x = std::min( a[ia], b[ib] );
+      while ( ia < a.size() && a[ia] <= x )
+        ++ia;
+      while ( ib < b.size() && b[ib] <= x )
+        ++ib;
+      d = std::max( d, std::fabs( ia / na - ib / nb ) );
+    }
+    const double ne = std::sqrt( na * nb / ( na + nb ) );
+    const double lambda = ( ne + 0.12 + 0.11 / ne ) * d;
+    //Kolmogorov distribution Q_KS(lambda):
+    double p = 0.0;
+    double sign = 1.0;
+    for ( int k = 1; k <= 100; ++k ) {
+      const double term = sign * 2.0 * std::exp( -2.0 * k * k * lambda * lambda );
+      p += term;
+      if ( std::fabs( term ) < 1e-12 )
+        break;
+      sign = -sign;
+    }
+    if ( lambda < 0.2 )
+      p = 1.0;//series converges poorly, and the result is 1 anyway
+    return { d, std::min( 1.0, std::max( 0.0, p ) ) };
+  }
+
+  NC::ProcImpl::ProcPtr createApprox( const Settings& settings, const std::string& cfgstr )
+  {
+    if ( settings.approx == "tabulated" ) {
+      auto ref = NC::FactImpl::createScatter( NC::MatCfg( cfgstr ) );
+      return NC::makeSO<NC::TabulatedXSProcess>( NC::tabulateXS( ref, NC::ProcImpl::ProcCompTabulationCfg(), cfgstr ), ref );
+    }
+    return NC::FactImpl::createScatter( NC::MatCfg( cfgstr + ";" + settings.approx ) );
+  }
+
+  Result compare( const Settings& settings, const std::string& cfgstr )
+  {
+    Result res;
+    res.name = cfgstr;
+
+    //Initialisation:
+    NC::clearCaches();
+    auto t0 = clock::now();
+    auto ref = NC::FactImpl::createScatter( NC::MatCfg( cfgstr ) );
+    const double tinit_ref = secondsSince( t0 );
+    NC::clearCaches();
+    t0 = clock::now();
+    auto approx = createApprox( settings, cfgstr );
+    const double tinit_approx = secondsSince( t0 );
+    res.speedupInit = tinit_ref / tinit_approx;
+
+    const bool oriented = ref->isOriented() || approx->isOriented();
+    ProcEval eval_ref( ref, oriented );
+    ProcEval eval_approx( approx, oriented );
+
+    //Cross sections on a logarithmic grid (evaluated once before timing, to
+    //not include the filling of caches and tables):
+    const double loge0 = std::log( 1e-5 );
+    const double loge1 = std::log( 10.0 );
+    std::vector<NC::NeutronEnergy> egrid;
+    egrid.reserve( settings.ngrid );
+    for ( std::size_t i = 0; i < settings.ngrid; ++i )
+      egrid.emplace_back( std::exp( loge0 + ( loge1 - loge0 ) * i / std::max<std::size_t>( 1, settings.ngrid - 1 ) ) );
+    std::vector<double> xs_ref, xs_approx;
+    xs_ref.reserve( egrid.size() );
+    xs_approx.reserve( egrid.size() );
+    for ( auto e : egrid ) {
+      xs_ref.push_back( eval_ref.xs( e ) );
+      xs_approx.push_back( eval_approx.xs( e ) );
+    }
+    double sink = 0.0;
+    t0 = clock::now();
+    for ( auto e : egrid )
+      sink += eval_ref.xs( e );
+    const double txs_ref = secondsSince( t0 );
+    t0 = clock::now();
+    for ( auto e : egrid )
+      sink += eval_approx.xs( e );
+    const double txs_approx = secondsSince( t0 );
+    res.speedupXS = txs_ref / txs_approx;
+
+    const double xsmax = *std::max_element( xs_ref.begin(), xs_ref.end() );
+    const double floor = std::max( 1e-3 * xsmax, 1e-300 );
+    double sumrelerr = 0.0;
+    for ( std::size_t i = 0; i < egrid.size(); ++i ) {
+      const double relerr = std::fabs( xs_approx[i] - xs_ref[i] ) / std::max( xs_ref[i], floor );
+      res.xsMaxRelErr = std::max( res.xsMaxRelErr, relerr );
+      sumrelerr += relerr;
+    }
+    res.xsMeanRelErr = sumrelerr / egrid.size();
+
+    //Sampling at a few energies (with independent RNG streams for the two
+    //processes):
+    auto rng_ref = NC::createBuiltinRNG( 123456789 );
+    auto rng_approx = rng_ref->createJumped();
+    double tsample_ref = 0.0;
+    double tsample_approx = 0.0;
+    for ( double e : { 0.001, 0.0253, 0.1, 1.0 } ) {
+      const NC::NeutronEnergy ekin{ e };
+      if ( !( eval_ref.xs( ekin ) > 0.0 ) || !( eval_approx.xs( ekin ) > 0.0 ) )
+        continue;
+      std::vector<double> eref, muref, eapprox, muapprox;
+      for ( auto* v : { &eref, &muref, &eapprox, &muapprox } )
+        v->reserve( settings.nsamples );
+      t0 = clock::now();
+      for ( std::size_t i = 0; i < settings.nsamples; ++i ) {
+        auto out = eval_ref.sample( *rng_ref, ekin );
+        eref.push_back( out.ekin.get() );
+        muref.push_back( out.mu.get() );
+      }
+      tsample_ref += secondsSince( t0 );
+      t0 = clock::now();
+      for ( std::size_t i = 0; i < settings.nsamples; ++i ) {
+        auto out = eval_approx.sample( *rng_approx, ekin );
+        eapprox.push_back( out.ekin.get() );
+        muapprox.push_back( out.mu.get() );
+      }
+      tsample_approx += secondsSince( t0 );
+      for ( auto ks : { ksTest( eref, eapprox ), ksTest( muref, muapprox ) } ) {
+        res.ksMaxDist = std::max( res.ksMaxDist, ks.first );
+        res.ksMinPValue = std::min( res.ksMinPValue, ks.second );
+      }
+    }
+    res.speedupSampling = ( tsample_approx > 0.0 ? tsample_ref / tsample_approx : 0.0 );
+
+    res.failed = ( ( settings.maxRelErr >= 0.0 && res.xsMaxRelErr > settings.maxRelErr )
+                   || ( settings.minPValue >= 0.0 && res.ksMinPValue < settings.minPValue ) );
+    if ( std::isnan( sink ) )
+      res.error = "NaN cross sections encountered";
+    return res;
+  }
+
+  NC::VectS availableNCMATFiles( const NC::VectS& filters )
+  {
+    std::set<std::string> names;
+    for ( auto& e : NC::DataSources::listAvailableFiles() ) {
+      if ( e.factName == "relpath" )
+        continue;
+      const std::string& n = e.name;
+      if ( n.size() < 6 || n.compare( n.size() - 6, 6, ".ncmat" ) != 0 )
+        continue;
+      bool matches = filters.empty();
+      for ( auto& f : filters )
+        matches = matches || n.find( f ) != std::string::npos;
+      if ( matches )
+        names.insert( n );
+    }
+    return NC::VectS( names.begin(), names.end() );
+  }
+
+  std::string jsonStr( const std::string& s )
+  {
+    std::ostringstream ss;
+    ss << '"';
+    for ( char c : s ) {
+      if ( c == '"' || c == '\\' )
+        ss << '\\' << c;
+      else if ( static_cast<unsigned char>( c ) < 0x20 )
+        ss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>( c ) << std::dec;
+      else
+        ss << c;
+    }
+    ss << '"';
+    return ss.str();
+  }
+
+  void writeJSON( std::ostream& os, const Settings& settings, const std::vector<Result>& results )
+  {
+    os << std::setprecision(6) << std::scientific;
+    os << "{\n  \"ncrystal_version\": " << jsonStr( NCRYSTAL_VERSION_STR )
+       << ",\n  \"approx\": " << jsonStr( settings.approx )
+       << ",\n  \"nsamples\": " << settings.nsamples
+       << ",\n  \"ngrid\": " << settings.ngrid
+       << ",\n  \"materials\": [";
+    bool first = true;
+    for ( auto& r : results ) {
+      os << ( first ? "\n" : ",\n" ) << "    { \"name\": " << jsonStr( r.name );
+      first = false;
+      if ( !r.error.empty() ) {
+        os << ", \"error\": " << jsonStr( r.error ) << " }";
+        continue;
+      }
+      os << ", \"xs_max_relerr\": " << r.xsMaxRelErr
+         << ", \"xs_mean_relerr\": " << r.xsMeanRelErr
+         << ", \"ks_max_dist\": " << r.ksMaxDist
+         << ", \"ks_min_pvalue\": " << r.ksMinPValue
+         << ", \"speedup_init\": " << r.speedupInit
+         << ", \"speedup_xs\": " << r.speedupXS
+         << ", \"speedup_sampling\": " << r.speedupSampling
+         << ", \"failed\": " << ( r.failed ? "true" : "false" ) << " }";
+    }
+    os << "\n  ]\n}\n";
+  }
+
+  void usage( const char * argv0 )
+  {
+    std::cout << "Usage: " << argv0 << " [-n <nsamples>] [-g <ngrid>] [-x <maxrelerr>]"
+              << " [-p <minpvalue>] [-o <report.json>] <approx> [<name-filter> ...]" << std::endl;
+  }
+}
+
+int main( int argc, char** argv ) {
+  NC::libClashDetect();
+
+  Settings settings;
+  std::string outfile;
+  NC::VectS positional;
+  for ( int i = 1; i < argc; ++i ) {
+    const bool hasval = i + 1 < argc;
+    if ( std::strcmp( argv[i], "-n" ) == 0 && hasval ) {
+      settings.nsamples = static_cast<std::size_t>( std::max( 10, std::atoi( argv[++i] ) ) );
+    } else if ( std::strcmp( argv[i], "-g" ) == 0 && hasval ) {
+      settings.ngrid = static_cast<std::size_t>( std::max( 2, std::atoi( argv[++i] ) ) );
+    } else if ( std::strcmp( argv[i], "-x" ) == 0 && hasval ) {
+      settings.maxRelErr = std::atof( argv[++i] );
+    } else if ( std::strcmp( argv[i], "-p" ) == 0 && hasval ) {
+      settings.minPValue = std::atof( argv[++i] );
+    } else if ( std::strcmp( argv[i], "-o" ) == 0 && hasval ) {
+      outfile = argv[++i];
+    } else if ( argv[i][0] == '-' ) {
+      usage( argv[0] );
+      return 1;
+    } else {
+      positional.push_back( argv[i] );
+    }
+  }
+  if ( positional.empty() ) {
+    usage( argv[0] );
+    return 1;
+  }
+  settings.approx = positional.front();
+  positional.erase( positional.begin() );
+
+  const auto names = availableNCMATFiles( positional );
+  if ( names.empty() ) {
+    std::cout << "ERROR: No .ncmat files found (is NCRYSTAL_DATA_PATH set correctly?)" << std::endl;
+    return 1;
+  }
+
+  std::cout << "Approximation: " << settings.approx << std::endl << std::endl;
+  std::cout << std::left << std::setw(48) << "material"
+            << std::right << std::setw(12) << "xs:maxrel"
+            << std::setw(12) << "xs:meanrel"
+            << std::setw(10) << "ks:dist"
+            << std::setw(10) << "ks:pval"
+            << std::setw(10) << "su:init"
+            << std::setw(10) << "su:xs"
+            << std::setw(10) << "su:samp" << std::endl;
+
+  std::vector<Result> results;
+  results.reserve( names.size() );
+  unsigned nfailed = 0;
+  for ( auto& name : names ) {
+    Result r;
+    try {
+      r = compare( settings, name );
+    } catch ( NC::Error::Exception& e ) {
+      r.name = name;
+      r.error = e.what();
+    }
+    if ( r.failed || !r.error.empty() )
+      ++nfailed;
+    std::cout << std::left << std::setw(48) << name << std::right;
+    if ( !r.error.empty() ) {
+      std::cout << "  ERROR: " << r.error << std::endl;
+    } else {
+      std::cout << std::scientific << std::setprecision(2)
+                << std::setw(12) << r.xsMaxRelErr
+                << std::setw(12) << r.xsMeanRelErr
+                << std::fixed << std::setprecision(4)
+                << std::setw(10) << r.ksMaxDist
+                << std::setw(10) << r.ksMinPValue
+                << std::setprecision(2)
+                << std::setw(10) << r.speedupInit
+                << std::setw(10) << r.speedupXS
+                << std::setw(10) << r.speedupSampling
+                << ( r.failed ? "  FAIL" : "" ) << std::endl;
+    }
+    results.push_back( std::move(r) );
+  }
+
+  if ( !outfile.empty() ) {
+    std::ofstream f( outfile );
+    writeJSON( f, settings, results );
+    f.close();
+    if ( !f.good() ) {
+      std::cout << "ERROR: Problems writing " << outfile << std::endl;
+      return 1;
+    }
+    std::cout << "Wrote " << outfile << std::endl;
+  }
+  if ( nfailed ) {
+    std::cout << nfailed << " of " << results.size() << " materials failed" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,256 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+//Micro-benchmarks of the per-neutron hot paths (crossSectionIsotropic,
+//crossSection and sampleScatter) of the individual process classes, built
+//when NCrystal is configured with -DBUILD_BENCHMARKS=ON. Neutron energies are
+//sampled log-uniformly and directions isotropically. For each process, the
+//time per call is reported along with the average number of random numbers
+//consumed per sampleScatter call. The output is intended for comparing
+//different builds or versions of NCrystal on the same machine. The layered
+//crystal mode with tabulated cross sections is not included, since its tables
+//must be fully built (by warmup) for isotropic directions, which is too slow.
+//
+//Usage: ncrystal_bench [-t <seconds>] [<name-filter> ...]
+//
+//The -t option sets the minimum time spent on each measurement (default 0.2).
+//If name filters are given, only benchmarks containing one of the filters in
+//their name are run. Data files are located as usual, so NCRYSTAL_DATA_PATH
+//might have to be set when running from a build directory.
+
+#include "NCrystal/NCrystal.hh"
+#include "NCrystal/internal/NCSANSSphScat.hh"
+#include "NCrystal/internal/NCMath.hh"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+namespace NC = NCrystal;
+
+namespace {
+
+  //Wraps another RNG, keeping track of how many numbers were requested:
+  class CountingRNG final : public NC::RNG {
+  public:
+    CountingRNG( NC::RNG& rng ) : m_rng(rng) {}
+    uint64_t count() const { return m_count; }
+    bool coinflip() override { ++m_count; return m_rng.coinflip(); }
+    uint64_t generate64RndmBits() override { ++m_count; return m_rng.generate64RndmBits(); }
+    uint32_t generate32RndmBits() override { ++m_count; return m_rng.generate32RndmBits(); }
+  protected:
+    double actualGenerate() override { ++m_count; return m_rng.generate(); }
+    void actualGenerateMany( double* out, std::size_t n ) override
+    {
+      m_count += n;
+      m_rng.generateMany( out, n );
+    }
+  private:
+    NC::RNG& m_rng;
+    uint64_t m_count = 0;
+  };
+
+  struct Neutrons {
+    std::vector<NC::NeutronEnergy> ekin;
+    std::vector<NC::NeutronDirection> dir;
+  };
+
+  Neutrons generateNeutrons( std::size_t n )
+  {
+    //Log-uniform energies in [1e-5,10]eV (~0.003-90Aa) and isotropic directions:
+    Neutrons res;
+    res.ekin.reserve( n );
+    res.dir.reserve( n );
+    auto rng = NC::createBuiltinRNG( 123456789 );
+    const double loge0 = std::log( 1e-5 );
+    const double loge1 = std::log( 10.0 );
+    for ( std::size_t i = 0; i < n; ++i ) {
+      res.ekin.emplace_back( std::exp( loge0 + ( loge1 - loge0 ) * rng->generate() ) );
+      const double cost = -1.0 + 2.0 * rng->generate();
+      const double sint = std::sqrt( std::max( 0.0, 1.0 - cost * cost ) );
+      const double phi = NC::k2Pi * rng->generate();
+      res.dir.emplace_back( sint * std::cos( phi ), sint * std::sin( phi ), cost );
+    }
+    return res;
+  }
+
+  //Time calls to fct(i) for i=0,1,2,... (indices wrapping around the neutron
+  //list), returning ns/call. After a few warm-up calls, the number of calls is
+  //doubled until the total time exceeds the requested minimum:
+  double timeCalls( double mintime, std::size_t nneutrons, const std::function<void(std::size_t)>& fct )
+  {
+    using clock = std::chrono::steady_clock;
+    std::size_t ncalls = 16;
+    std::size_t idx = 0;
+    //Warm up first (some processes fill caches or tables on demand):
+    for ( ; idx < ncalls; ++idx )
+      fct( idx );
+    while ( true ) {
+      auto t0 = clock::now();
+      for ( std::size_t i = 0; i < ncalls; ++i ) {
+        fct( idx );
+        if ( ++idx == nneutrons )
+          idx = 0;
+      }
+      const double dt = std::chrono::duration<double>( clock::now() - t0 ).count();
+      if ( dt >= mintime || ncalls >= ( std::size_t(1) << 40 ) )
+        return 1e9 * dt / ncalls;
+      ncalls *= 2;
+    }
+  }
+
+  struct Benchmark {
+    std::string name;
+    std::function<NC::ProcImpl::ProcPtr()> create;
+    std::string expectedProcName;
+  };
+
+  std::function<NC::ProcImpl::ProcPtr()> fromCfg( std::string cfgstr )
+  {
+    return [cfgstr]() { return NC::FactImpl::createScatter( NC::MatCfg( cfgstr ) ); };
+  }
+
+  //Pick out the process with the given name, which might be a component of a
+  //ProcComposition (e.g. for single crystals, where planes with very low
+  //d-spacing are modelled as a powder). Returns nullptr if not found:
+  NC::ProcImpl::OptionalProcPtr findProcess( NC::ProcImpl::ProcPtr proc, const std::string& name )
+  {
+    if ( name == proc->name() )
+      return proc;
+    auto pc = dynamic_cast<const NC::ProcImpl::ProcComposition*>( proc.get() );
+    if ( pc ) {
+      for ( auto& c : pc->components() )
+        if ( name == c.process->name() )
+          return c.process;
+    }
+    return nullptr;
+  }
+
+  std::vector<Benchmark> allBenchmarks()
+  {
+    const std::string sccfg = "Ge_sg227.ncmat;comp=coh_elas;mos=40arcsec"
+      ";dir1=@crys_hkl:5,1,1@lab:0,0,1;dir2=@crys_hkl:0,-1,1@lab:0,1,0";
+    const std::string lccfg = "C_sg194_pyrolytic_graphite.ncmat;comp=coh_elas;mos=3deg"
+      ";dir1=@crys_hkl:0,0,1@lab:0,0,1;dir2=@crys_hkl:1,0,0@lab:1,0,0;lcaxis=0,0,1";
+    std::vector<Benchmark> res;
+    res.push_back( { "PCBragg/Al", fromCfg("Al_sg225.ncmat;comp=coh_elas"), "PCBragg" } );
+    res.push_back( { "PCBragg/Al2O3", fromCfg("Al2O3_sg167_Corundum.ncmat;comp=coh_elas"), "PCBragg" } );
+    res.push_back( { "SCBragg/Ge", fromCfg(sccfg), "SCBragg" } );
+    for ( int lcmode : { 0, 100, -100 } )
+      res.push_back( { "LCBragg/PG/lcmode=" + std::to_string(lcmode),
+                       fromCfg( lccfg + ";lcmode=" + std::to_string(lcmode) ), "LCBragg" } );
+    res.push_back( { "SABScatter/Al", fromCfg("Al_sg225.ncmat;comp=inelas"), "SABScatter" } );
+    res.push_back( { "SABScatter/H2O", fromCfg("LiquidWaterH2O_T293.6K.ncmat;comp=inelas"), "SABScatter" } );
+    res.push_back( { "FreeGas/Al", fromCfg("Al_sg225.ncmat;comp=inelas;inelas=freegas"), "FreeGas" } );
+    res.push_back( { "ElIncScatter/V", fromCfg("V_sg229.ncmat;comp=incoh_elas"), "ElIncScatter" } );
+    res.push_back( { "SANSSphereScatter/r=100Aa",
+                     []()
+                     {
+                       return NC::makeSO<NC::SANSSphereScatter>( NC::SANSScaleFactor{ 1.0 },
+                                                                 NC::SANSSphereScatter::sphere_radius{ 100.0 } );
+                     }, "SANSSphereScatter" } );
+    return res;
+  }
+
+  bool matchesFilters( const std::string& name, const NC::VectS& filters )
+  {
+    if ( filters.empty() )
+      return true;
+    for ( auto& f : filters )
+      if ( name.find( f ) != std::string::npos )
+        return true;
+    return false;
+  }
+}
+
+int main( int argc, char** argv ) {
+  NC::libClashDetect();
+
+  double mintime = 0.2;
+  NC::VectS filters;
+  for ( int i = 1; i < argc; ++i ) {
+    if ( std::strcmp( argv[i], "-t" ) == 0 && i + 1 < argc ) {
+      mintime = std::atof( argv[++i] );
+    } else if ( argv[i][0] == '-' ) {
+      std::cout << "Usage: " << argv[0] << " [-t <seconds>] [<name-filter> ...]" << std::endl;
+      return 1;
+    } else {
+      filters.push_back( argv[i] );
+    }
+  }
+
+  constexpr std::size_t nneutrons = 65536;
+  const auto neutrons = generateNeutrons( nneutrons );
+  auto rng = NC::createBuiltinRNG( 987654321 );
+
+  std::cout << std::left << std::setw(28) << "benchmark"
+            << std::right << std::setw(14) << "xsiso[ns]"
+            << std::setw(14) << "xs[ns]"
+            << std::setw(14) << "sample[ns]"
+            << std::setw(14) << "rng/sample" << std::endl;
+
+  double sink = 0.0;
+  for ( auto& bm : allBenchmarks() ) {
+    if ( !matchesFilters( bm.name, filters ) )
+      continue;
+    auto created = bm.create();
+    auto proc = findProcess( created, bm.expectedProcName );
+    if ( !proc ) {
+      std::cout << "ERROR: Benchmark " << bm.name << " got a " << created->name()
+                << " process (expected " << bm.expectedProcName << ")" << std::endl;
+      return 1;
+    }
+    NC::CachePtr cp;
+    const double t_xsiso = ( proc->isOriented() ? -1.0 :
+                             timeCalls( mintime, nneutrons, [&]( std::size_t i )
+                             {
+                               sink += proc->crossSectionIsotropic( cp, neutrons.ekin[i] ).get();
+                             } ) );
+    const double t_xs = timeCalls( mintime, nneutrons, [&]( std::size_t i )
+    {
+      sink += proc->crossSection( cp, neutrons.ekin[i], neutrons.dir[i] ).get();
+    } );
+    const double t_sample = timeCalls( mintime, nneutrons, [&]( std::size_t i )
+    {
+      sink += proc->sampleScatter( cp, *rng, neutrons.ekin[i], neutrons.dir[i] ).ekin.get();
+    } );
+    //Count random numbers in a separate pass, to keep counting overhead out of
+    //the timings:
+    constexpr std::size_t ncount = 4096;
+    CountingRNG countingrng( *rng );
+    for ( std::size_t i = 0; i < ncount; ++i )
+      sink += proc->sampleScatter( cp, countingrng, neutrons.ekin[i], neutrons.dir[i] ).ekin.get();
+
+    std::cout << std::left << std::setw(28) << bm.name << std::right << std::fixed << std::setprecision(1);
+    if ( t_xsiso < 0.0 )
+      std::cout << std::setw(14) << "n/a";
+    else
+      std::cout << std::setw(14) << t_xsiso;
+    std::cout << std::setw(14) << t_xs << std::setw(14) << t_sample
+              << std::setw(14) << std::setprecision(2)
+              << double( countingrng.count() ) / ncount << std::endl;
+  }
+  //Make sure the results are used:
+  if ( std::isnan( sink ) )
+    std::cout << "(NaN encountered in results)" << std::endl;
+  return 0;
+}
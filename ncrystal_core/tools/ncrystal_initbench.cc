@@ -0,0 +1,339 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+//Benchmark of material initialisation (createInfo, createScatter and
+//createAbsorption), built when NCrystal is configured with
+//-DBUILD_BENCHMARKS=ON. It runs over all .ncmat files reported by
+//DataSources::listAvailableFiles() (i.e. normally the shipped data library),
+//except files found relative to the working directory, and for each
+//measures:
+//
+//  * Cold initialisation: after clearing all caches, the wall time of
+//    createInfo, createScatter and createAbsorption (called in that order, so
+//    the createScatter and createAbsorption timings do not include the
+//    creation of the Info object), along with the resident memory held after
+//    the calls and the peak resident memory during the calls (both relative to
+//    the resident memory after clearing the caches).
+//
+//  * Warm initialisation: the average wall time of the same calls, when the
+//    objects are already in the factory caches (using new MatCfg objects for
+//    each call, so the cost of parsing the cfg-strings is included).
+//
+//Memory figures are only available on Linux (peak values require kernel 4.0
+//or later), and are otherwise reported as null. Note that memory released
+//after clearing the caches is not necessarily returned to the OS, so figures
+//are mainly useful for spotting changes between builds or versions of
+//NCrystal. Likewise, SAB kernels loaded from an on-disk cache (see
+//NCSABDiskCache.hh) make cold initialisation faster, so such caches might have
+//to be disabled for comparable results.
+//
+//Usage: ncrystal_initbench [-o <report.json>] [-n <nwarm>] [<name-filter> ...]
+//
+//Results are printed as a table, and the -o option additionally writes them
+//to a JSON file. The -n option sets the number of warm calls to average over
+//(default 10). If name filters are given, only files containing one of the
+//filters in their name are used. Data files are located as usual, so
+//NCRYSTAL_DATA_PATH might have to be set when running from a build
+//directory.
+
+#include "NCrystal/NCrystal.hh"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+namespace NC = NCrystal;
+
+namespace {
+
+  class Memory {
+  public:
+    //Resident memory (current and peak) in bytes, read from /proc/self/status
+    //(-1 if unavailable):
+    static int64_t rss() { return readStatusField( "VmRSS:" ); }
+    static int64_t peak() { return readStatusField( "VmHWM:" ); }
+
+    //Reset the peak to the current value, returning false if not possible:
+    static bool resetPeak()
+    {
+#ifdef __linux__
+      std::ofstream f( "/proc/self/clear_refs" );
+      if ( !f.good() )
+        return false;
+      f << "5";
+      f.close();
+      return f.good();
+#else
+      return false;
+#endif
+    }
+
+  private:
+    static int64_t readStatusField( const char * fieldname )
+    {
+#ifdef __linux__
+      std::ifstream f( "/proc/self/status" );
+      std::string line;
+      const std::size_t n = std::strlen( fieldname );
+      while ( std::getline( f, line ) ) {
+        if ( line.compare( 0, n, fieldname ) != 0 )
+          continue;
+        std::istringstream ss( line.substr( n ) );
+        int64_t kb = -1;
+        ss >> kb;//value is in kB
+        return ( ss.fail() || kb < 0 ) ? -1 : kb * 1024;
+      }
+#else
+      (void)fieldname;
+#endif
+      return -1;
+    }
+  };
+
+  struct ColdResult {
+    double time_info = 0.0;
+    double time_scatter = 0.0;
+    double time_absorption = 0.0;
+    int64_t rss = -1;
+    int64_t peak = -1;
+  };
+
+  struct WarmResult {
+    double time_info = 0.0;
+    double time_scatter = 0.0;
+    double time_absorption = 0.0;
+  };
+
+  struct Result {
+    std::string name;
+    std::string error;//set if initialisation failed
+    ColdResult cold;
+    WarmResult warm;
+  };
+
+  using clock = std::chrono::steady_clock;
+
+  double secondsSince( clock::time_point t0 )
+  {
+    return std::chrono::duration<double>( clock::now() - t0 ).count();
+  }
+
+  ColdResult measureCold( const std::string& cfgstr, bool havePeak )
+  {
+    NC::clearCaches();
+    ColdResult res;
+    const int64_t rss0 = Memory::rss();
+    const bool peakOK = havePeak && Memory::resetPeak();
+    auto t0 = clock::now();
+    auto info = NC::createInfo( NC::MatCfg( cfgstr ) );
+    res.time_info = secondsSince( t0 );
+    t0 = clock::now();
+    auto scat = NC::createScatter( NC::MatCfg( cfgstr ) );
+    res.time_scatter = secondsSince( t0 );
+    t0 = clock::now();
+    auto absn = NC::createAbsorption( NC::MatCfg( cfgstr ) );
+    res.time_absorption = secondsSince( t0 );
+    const int64_t rss1 = Memory::rss();
+    const int64_t peak1 = ( peakOK ? Memory::peak() : -1 );
+    if ( rss0 >= 0 && rss1 >= 0 )
+      res.rss = rss1 - rss0;
+    if ( rss0 >= 0 && peak1 >= 0 )
+      res.peak = peak1 - rss0;
+    return res;
+  }
+
+  WarmResult measureWarm( const std::string& cfgstr, unsigned nwarm )
+  {
+    //Objects are already cached after measureCold:
+    WarmResult res;
+    for ( unsigned i = 0; i < nwarm; ++i ) {
+      auto t0 = clock::now();
+      auto info = NC::createInfo( NC::MatCfg( cfgstr ) );
+      res.time_info += secondsSince( t0 );
+      t0 = clock::now();
+      auto scat = NC::createScatter( NC::MatCfg( cfgstr ) );
+      res.time_scatter += secondsSince( t0 );
+      t0 = clock::now();
+      auto absn = NC::createAbsorption( NC::MatCfg( cfgstr ) );
+      res.time_absorption += secondsSince( t0 );
+    }
+    res.time_info /= nwarm;
+    res.time_scatter /= nwarm;
+    res.time_absorption /= nwarm;
+    return res;
+  }
+
+  NC::VectS availableNCMATFiles( const NC::VectS& filters )
+  {
+    std::set<std::string> names;
+    for ( auto& e : NC::DataSources::listAvailableFiles() ) {
+      //Skip files found relative to the working directory, which would
+      //otherwise give duplicates when running from the source tree:
+      if ( e.factName == "relpath" )
+        continue;
+      const std::string& n = e.name;
+      if ( n.size() < 6 || n.compare( n.size() - 6, 6, ".ncmat" ) != 0 )
+        continue;
+      bool matches = filters.empty();
+      for ( auto& f : filters )
+        matches = matches || n.find( f ) != std::string::npos;
+      if ( matches )
+        names.insert( n );
+    }
+    return NC::VectS( names.begin(), names.end() );
+  }
+
+  std::string jsonStr( const std::string& s )
+  {
+    std::ostringstream ss;
+    ss << '"';
+    for ( char c : s ) {
+      if ( c == '"' || c == '\\' )
+        ss << '\\' << c;
+      else if ( static_cast<unsigned char>( c ) < 0x20 )
+        ss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>( c ) << std::dec;
+      else
+        ss << c;
+    }
+    ss << '"';
+    return ss.str();
+  }
+
+  std::string jsonMem( int64_t v )
+  {
+    return v < 0 ? std::string("null") : std::to_string( v );
+  }
+
+  void writeJSON( std::ostream& os, const std::vector<Result>& results, unsigned nwarm )
+  {
+    os << std::setprecision(6) << std::scientific;
+    os << "{\n  \"ncrystal_version\": " << jsonStr( NCRYSTAL_VERSION_STR )
+       << ",\n  \"nwarm\": " << nwarm
+       << ",\n  \"units\": { \"time\": \"s\", \"memory\": \"bytes\" }"
+       << ",\n  \"materials\": [";
+    bool first = true;
+    for ( auto& r : results ) {
+      os << ( first ? "\n" : ",\n" ) << "    { \"name\": " << jsonStr( r.name );
+      first = false;
+      if ( !r.error.empty() ) {
+        os << ", \"error\": " << jsonStr( r.error ) << " }";
+        continue;
+      }
+      os << ",\n      \"cold\": { \"createInfo\": " << r.cold.time_info
+         << ", \"createScatter\": " << r.cold.time_scatter
+         << ", \"createAbsorption\": " << r.cold.time_absorption
+         << ", \"rss\": " << jsonMem( r.cold.rss )
+         << ", \"peak_rss\": " << jsonMem( r.cold.peak ) << " }"
+         << ",\n      \"warm\": { \"createInfo\": " << r.warm.time_info
+         << ", \"createScatter\": " << r.warm.time_scatter
+         << ", \"createAbsorption\": " << r.warm.time_absorption << " } }";
+    }
+    os << "\n  ]\n}\n";
+  }
+
+  std::string fmtMem( int64_t v )
+  {
+    if ( v < 0 )
+      return "n/a";
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1) << v / ( 1024.0 * 1024.0 );
+    return ss.str();
+  }
+}
+
+int main( int argc, char** argv ) {
+  NC::libClashDetect();
+
+  std::string outfile;
+  unsigned nwarm = 10;
+  NC::VectS filters;
+  for ( int i = 1; i < argc; ++i ) {
+    if ( std::strcmp( argv[i], "-o" ) == 0 && i + 1 < argc ) {
+      outfile = argv[++i];
+    } else if ( std::strcmp( argv[i], "-n" ) == 0 && i + 1 < argc ) {
+      nwarm = static_cast<unsigned>( std::max( 1, std::atoi( argv[++i] ) ) );
+    } else if ( argv[i][0] == '-' ) {
+      std::cout << "Usage: " << argv[0] << " [-o <report.json>] [-n <nwarm>] [<name-filter> ...]" << std::endl;
+      return 1;
+    } else {
+      filters.push_back( argv[i] );
+    }
+  }
+
+  const auto names = availableNCMATFiles( filters );
+  if ( names.empty() ) {
+    std::cout << "ERROR: No .ncmat files found (is NCRYSTAL_DATA_PATH set correctly?)" << std::endl;
+    return 1;
+  }
+
+  //Check once if peak memory can be measured:
+  const bool havePeak = Memory::resetPeak() && Memory::peak() >= 0;
+
+  std::cout << std::left << std::setw(48) << "material"
+            << std::right << std::setw(12) << "info[ms]"
+            << std::setw(12) << "scat[ms]"
+            << std::setw(12) << "abs[ms]"
+            << std::setw(11) << "rss[MB]"
+            << std::setw(11) << "peak[MB]"
+            << std::setw(14) << "warm[us]" << std::endl;
+
+  std::vector<Result> results;
+  results.reserve( names.size() );
+  for ( auto& name : names ) {
+    Result r;
+    r.name = name;
+    try {
+      r.cold = measureCold( name, havePeak );
+      r.warm = measureWarm( name, nwarm );
+    } catch ( NC::Error::Exception& e ) {
+      r.error = e.what();
+    }
+    std::cout << std::left << std::setw(48) << name << std::right;
+    if ( !r.error.empty() ) {
+      std::cout << "  ERROR: " << r.error << std::endl;
+    } else {
+      std::cout << std::fixed << std::setprecision(2)
+                << std::setw(12) << 1e3 * r.cold.time_info
+                << std::setw(12) << 1e3 * r.cold.time_scatter
+                << std::setw(12) << 1e3 * r.cold.time_absorption
+                << std::setw(11) << fmtMem( r.cold.rss )
+                << std::setw(11) << fmtMem( r.cold.peak )
+                << std::setw(14) << 1e6 * ( r.warm.time_info + r.warm.time_scatter + r.warm.time_absorption )
+                << std::endl;
+    }
+    results.push_back( std::move(r) );
+  }
+
+  if ( !outfile.empty() ) {
+    std::ofstream f( outfile );
+    writeJSON( f, results, nwarm );
+    f.close();
+    if ( !f.good() ) {
+      std::cout << "ERROR: Problems writing " << outfile << std::endl;
+      return 1;
+    }
+    std::cout << "Wrote " << outfile << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,284 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+//Multi-threaded scaling benchmark, built when NCrystal is configured with
+//-DBUILD_BENCHMARKS=ON. For thread counts 1,2,4,...,N (always ending with N),
+//it starts the threads simultaneously, and each thread first clones the
+//Scatter objects of a fixed set of materials (with cloneForCurrentThread, or
+//with cloneByIdx if -i is given), and then evaluates cross sections and
+//samples scatterings (one of each per neutron) for the materials in turn,
+//for a fixed amount of time. Reported are the total throughput, the
+//throughput per thread relative to that of a single thread (1.00 is perfect
+//scaling), and the average latency of the clone calls. Finally, the cost of
+//producing new RNG streams is measured with all threads concurrently using a
+//shared RNGProducer, both by jumping ahead in the default RNG (with
+//RNGProducer::produce) and by creating streams by index with the
+//counter-based RNG (with RNGProducer::produceByIdx). Together these expose
+//contention in the RNG and factory infrastructure.
+//
+//Usage: ncrystal_mtbench [-j <nthreads>] [-t <seconds>] [-i] [<cfgstr> ...]
+//
+//The -j option sets the maximum number of threads (default: number of
+//hardware threads), and -t the time spent on each measurement (default 0.5).
+//If cfg-strings are given, they replace the default set of materials. Data
+//files are located as usual, so NCRYSTAL_DATA_PATH might have to be set when
+//running from a build directory.
+
+#include "NCrystal/NCrystal.hh"
+#include "NCrystal/internal/NCMath.hh"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+namespace NC = NCrystal;
+
+namespace {
+
+  using clock = std::chrono::steady_clock;
+
+  struct Neutrons {
+    std::vector<NC::NeutronEnergy> ekin;
+    std::vector<NC::NeutronDirection> dir;
+  };
+
+  Neutrons generateNeutrons( std::size_t n )
+  {
+    //Log-uniform energies in [1e-5,10]eV (~0.003-90Aa) and isotropic directions:
+    Neutrons res;
+    res.ekin.reserve( n );
+    res.dir.reserve( n );
+    auto rng = NC::createBuiltinRNG( 123456789 );
+    const double loge0 = std::log( 1e-5 );
+    const double loge1 = std::log( 10.0 );
+    for ( std::size_t i = 0; i < n; ++i ) {
+      res.ekin.emplace_back( std::exp( loge0 + ( loge1 - loge0 ) * rng->generate() ) );
+      const double cost = -1.0 + 2.0 * rng->generate();
+      const double sint = std::sqrt( std::max( 0.0, 1.0 - cost * cost ) );
+      const double phi = NC::k2Pi * rng->generate();
+      res.dir.emplace_back( sint * std::cos( phi ), sint * std::sin( phi ), cost );
+    }
+    return res;
+  }
+
+  //Run fct(ithread) in nthreads threads, released simultaneously once all
+  //threads have started:
+  void runThreads( unsigned nthreads, const std::function<void(unsigned)>& fct )
+  {
+    std::atomic<unsigned> nready( 0 );
+    std::atomic<bool> go( false );
+    std::vector<std::thread> threads;
+    threads.reserve( nthreads );
+    for ( unsigned ith = 0; ith < nthreads; ++ith ) {
+      threads.emplace_back( [ith,&nready,&go,&fct]()
+      {
+        ++nready;
+        while ( !go )
+          std::this_thread::yield();
+        fct( ith );
+      } );
+    }
+    while ( nready < nthreads )
+      std::this_thread::yield();
+    go = true;
+    for ( auto& t : threads )
+      t.join();
+  }
+
+  struct ThreadResult {
+    double cloneTime = 0.0;//total time spent cloning [s]
+    double runTime = 0.0;//time spent in the evaluation loop [s]
+    uint64_t nneutrons = 0;
+    double sink = 0.0;
+  };
+
+  std::vector<ThreadResult> runScaling( std::vector<NC::Scatter>& scatters, const Neutrons& neutrons,
+                                        unsigned nthreads, double mintime, bool byIdx, uint64_t& idxOffset )
+  {
+    std::vector<ThreadResult> res( nthreads );
+    const uint64_t idx0 = idxOffset;
+    idxOffset += nthreads * scatters.size();
+    runThreads( nthreads, [&]( unsigned ith )
+    {
+      ThreadResult& r = res.at( ith );
+      std::vector<NC::Scatter> clones;
+      clones.reserve( scatters.size() );
+      auto t0 = clock::now();
+      for ( std::size_t i = 0; i < scatters.size(); ++i )
+        clones.push_back( byIdx
+                          ? scatters[i].cloneByIdx( NC::RNGStreamIndex{ idx0 + ith * scatters.size() + i } )
+                          : scatters[i].cloneForCurrentThread() );
+      auto t1 = clock::now();
+      r.cloneTime = std::chrono::duration<double>( t1 - t0 ).count();
+      //Start at different neutrons in each thread, and check the time after
+      //every batch of calls:
+      constexpr std::size_t nbatch = 64;
+      const std::size_t nn = neutrons.ekin.size();
+      std::size_t idx = ( ith * 7919 ) % nn;
+      while ( true ) {
+        for ( std::size_t ib = 0; ib < nbatch; ++ib ) {
+          for ( auto& sc : clones ) {
+            r.sink += sc.crossSection( neutrons.ekin[idx], neutrons.dir[idx] ).get();
+            r.sink += sc.sampleScatter( neutrons.ekin[idx], neutrons.dir[idx] ).ekin.get();
+          }
+          if ( ++idx == nn )
+            idx = 0;
+        }
+        r.nneutrons += nbatch;
+        r.runTime = std::chrono::duration<double>( clock::now() - t1 ).count();
+        if ( r.runTime >= mintime )
+          break;
+      }
+    } );
+    return res;
+  }
+
+  //Average time per RNGProducer::produce call (or produceByIdx call, with
+  //different indices in all calls) [ns], with all threads sharing the
+  //producer:
+  double timeProduce( NC::RNGProducer& producer, bool byIdx, unsigned nthreads, double mintime, double& sink )
+  {
+    std::vector<uint64_t> ncalls( nthreads, 0 );
+    std::vector<double> times( nthreads, 0.0 );
+    std::vector<double> sinks( nthreads, 0.0 );
+    runThreads( nthreads, [&]( unsigned ith )
+    {
+      auto t0 = clock::now();
+      while ( true ) {
+        for ( uint64_t i = 0; i < 16; ++i ) {
+          auto rng = ( byIdx
+                       ? producer.produceByIdx( NC::RNGStreamIndex{ ( uint64_t(ith) << 40 ) + ncalls[ith] + i } )
+                       : producer.produce() );
+          sinks[ith] += rng->generate();
+        }
+        ncalls[ith] += 16;
+        times[ith] = std::chrono::duration<double>( clock::now() - t0 ).count();
+        if ( times[ith] >= mintime )
+          break;
+      }
+    } );
+    double tottime = 0.0;
+    uint64_t totcalls = 0;
+    for ( unsigned ith = 0; ith < nthreads; ++ith ) {
+      tottime += times[ith];
+      totcalls += ncalls[ith];
+      sink += sinks[ith];
+    }
+    return 1e9 * tottime / totcalls;
+  }
+
+  std::vector<unsigned> threadCounts( unsigned nmax )
+  {
+    std::vector<unsigned> res;
+    for ( unsigned n = 1; n < nmax; n *= 2 )
+      res.push_back( n );
+    res.push_back( nmax );
+    return res;
+  }
+}
+
+int main( int argc, char** argv ) {
+  NC::libClashDetect();
+
+  unsigned nmax = std::max<unsigned>( 1, std::thread::hardware_concurrency() );
+  double mintime = 0.5;
+  bool byIdx = false;
+  NC::VectS cfgstrs;
+  for ( int i = 1; i < argc; ++i ) {
+    if ( std::strcmp( argv[i], "-j" ) == 0 && i + 1 < argc ) {
+      nmax = static_cast<unsigned>( std::max( 1, std::atoi( argv[++i] ) ) );
+    } else if ( std::strcmp( argv[i], "-t" ) == 0 && i + 1 < argc ) {
+      mintime = std::atof( argv[++i] );
+    } else if ( std::strcmp( argv[i], "-i" ) == 0 ) {
+      byIdx = true;
+    } else if ( argv[i][0] == '-' ) {
+      std::cout << "Usage: " << argv[0] << " [-j <nthreads>] [-t <seconds>] [-i] [<cfgstr> ...]" << std::endl;
+      return 1;
+    } else {
+      cfgstrs.push_back( argv[i] );
+    }
+  }
+  if ( cfgstrs.empty() )
+    cfgstrs = { "Al_sg225.ncmat",
+                "LiquidWaterH2O_T293.6K.ncmat",
+                "Al2O3_sg167_Corundum.ncmat",
+                "Ge_sg227.ncmat;mos=40arcsec;dir1=@crys_hkl:5,1,1@lab:0,0,1;dir2=@crys_hkl:0,-1,1@lab:0,1,0" };
+
+  std::cout << "Materials:" << std::endl;
+  std::vector<NC::Scatter> scatters;
+  for ( auto& c : cfgstrs ) {
+    std::cout << "  " << c << std::endl;
+    scatters.push_back( NC::createScatter( c ) );
+  }
+  std::cout << "Cloning with " << ( byIdx ? "cloneByIdx" : "cloneForCurrentThread" ) << std::endl << std::endl;
+
+  constexpr std::size_t nneutrons = 65536;
+  const auto neutrons = generateNeutrons( nneutrons );
+
+  std::cout << std::right << std::setw(8) << "threads"
+            << std::setw(16) << "total[kn/s]"
+            << std::setw(16) << "perthread[kn/s]"
+            << std::setw(12) << "scaling"
+            << std::setw(14) << "clone[us]" << std::endl;
+
+  double sink = 0.0;
+  double perThread1 = 0.0;
+  uint64_t idxOffset = 1000000;
+  for ( unsigned n : threadCounts( nmax ) ) {
+    auto res = runScaling( scatters, neutrons, n, mintime, byIdx, idxOffset );
+    double throughput = 0.0;
+    double clonetime = 0.0;
+    for ( auto& r : res ) {
+      throughput += r.nneutrons / r.runTime;
+      clonetime += r.cloneTime;
+      sink += r.sink;
+    }
+    const double perThread = throughput / n;
+    if ( n == 1 )
+      perThread1 = perThread;
+    std::cout << std::setw(8) << n << std::fixed << std::setprecision(1)
+              << std::setw(16) << 1e-3 * throughput
+              << std::setw(16) << 1e-3 * perThread
+              << std::setw(12) << std::setprecision(2) << perThread / perThread1
+              << std::setw(14) << std::setprecision(1)
+              << 1e6 * clonetime / ( n * scatters.size() ) << std::endl;
+  }
+
+  std::cout << std::endl << std::right << std::setw(8) << "threads"
+            << std::setw(22) << "produce(jump)[ns]"
+            << std::setw(22) << "byIdx(counter)[ns]" << std::endl;
+  for ( unsigned n : threadCounts( nmax ) ) {
+    NC::RNGProducer jumpProducer( NC::createBuiltinRNG( 12345 ) );
+    NC::RNGProducer counterProducer( NC::createBuiltinCounterRNG( 12345 ) );
+    const double t_jump = timeProduce( jumpProducer, false, n, mintime, sink );
+    const double t_counter = timeProduce( counterProducer, true, n, mintime, sink );
+    std::cout << std::setw(8) << n << std::fixed << std::setprecision(1)
+              << std::setw(22) << t_jump << std::setw(22) << t_counter << std::endl;
+  }
+
+  //Make sure the results are used:
+  if ( std::isnan( sink ) )
+    std::cout << "(NaN encountered in results)" << std::endl;
+  return 0;
+}
@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+//Build-time helper used when NCrystal is configured with -DEMBED_DATA=ON and
+//-DEMBED_DATA_PREPARSED=ON. It parses the shipped .ncmat files and generates
+//C++ code with the binary encoded NCMATData objects, along with a function
+//NCrystal::AutoGenNCMAT::registerStdNCMATPreParsed() registering them.
+//
+//Usage: ncrystal_ncmat2bin -o <outfile.cc> <file1.ncmat> [<file2.ncmat> ...]
+
+#include "NCrystal/NCParseNCMAT.hh"
+#include "NCrystal/internal/NCFileUtils.hh"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <set>
+
+namespace NC = NCrystal;
+
+namespace {
+  std::string basename( const std::string& path )
+  {
+    auto i = path.find_last_of("/\\");
+    return i == std::string::npos ? path : path.substr( i + 1 );
+  }
+
+  std::string encodeFile( const std::string& path, const std::string& name )
+  {
+    auto content = NC::readEntireFileToString( path );
+    if ( !content.has_value() )
+      NCRYSTAL_THROW2(FileNotFound,"Could not read file: "<<path);
+    NC::TextData td( NC::RawStrData( std::move( content.value() ) ),
+                     NC::TextData::DataType{"ncmat"},
+                     NC::DataSourceName{ name } );
+    //Store the data as produced when parsing without final validation (the
+    //runtime will validate if requested), but fail early on invalid files:
+    auto data = NC::parseNCMATData( td, false );
+    data.validate();
+    auto blob = NC::encodeNCMATDataBinary( data );
+    //Verify round trip:
+    auto data2 = NC::decodeNCMATDataBinary( blob.data(), blob.size() );
+    if ( NC::encodeNCMATDataBinary( data2 ) != blob )
+      NCRYSTAL_THROW2(LogicError,"Binary encoding round trip failed for file: "<<path);
+    return blob;
+  }
+}
+
+int main( int argc, char** argv )
+{
+  std::string outfile;
+  std::vector<std::string> infiles;
+  for ( int i = 1; i < argc; ++i ) {
+    std::string a( argv[i] );
+    if ( a == "-o" && i + 1 < argc )
+      outfile = argv[++i];
+    else
+      infiles.push_back( a );
+  }
+  if ( outfile.empty() || infiles.empty() ) {
+    std::cerr << "Usage: " << argv[0] << " -o <outfile.cc> <file1.ncmat> [<file2.ncmat> ...]" << std::endl;
+    return 1;
+  }
+
+  try {
+    std::ostringstream out;
+    out << "//Autogenerated by ncrystal_ncmat2bin. Do not edit.\n\n"
+        << "#include <cstddef>\n\n"
+        << "namespace NCrystal {\n"
+        << "  namespace internal {\n"
+        << "    void registerEmbeddedPreParsedNCMAT( const char*, const unsigned char*, std::size_t );\n"
+        << "  }\n"
+        << "  namespace AutoGenNCMAT {\n"
+        << "    void registerStdNCMATPreParsed();\n"
+        << "  }\n"
+        << "}\n\n"
+        << "namespace {\n";
+    std::set<std::string> seen;
+    std::vector<std::pair<std::string,std::size_t>> entries;
+    for ( auto& f : infiles ) {
+      const std::string name = basename( f );
+      if ( !seen.insert( name ).second )
+        NCRYSTAL_THROW2(BadInput,"Multiple files in input named: "<<name);
+      auto blob = encodeFile( f, name );
+      const std::size_t idx = entries.size();
+      out << "  //" << name << ":\n"
+          << "  const unsigned char ncmatbin_" << idx << "[" << blob.size() << "] = {";
+      for ( std::size_t i = 0; i < blob.size(); ++i ) {
+        if ( i % 20 == 0 )
+          out << "\n    ";
+        out << static_cast<unsigned>( static_cast<unsigned char>( blob[i] ) ) << ',';
+      }
+      out << "\n  };\n";
+      entries.emplace_back( name, blob.size() );
+    }
+    out << "}\n\n"
+        << "void NCrystal::AutoGenNCMAT::registerStdNCMATPreParsed()\n"
+        << "{\n";
+    for ( std::size_t i = 0; i < entries.size(); ++i )
+      out << "  internal::registerEmbeddedPreParsedNCMAT( \"" << entries.at(i).first
+          << "\", ncmatbin_" << i << ", " << entries.at(i).second << " );\n";
+    out << "}\n";
+
+    std::ofstream ofs( outfile, std::ios::out | std::ios::trunc );
+    ofs << out.str();
+    if ( !ofs.good() )
+      NCRYSTAL_THROW2(CalcError,"Could not write output file: "<<outfile);
+  } catch ( std::exception& e ) {
+    std::cerr << "ncrystal_ncmat2bin : ERROR - " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -28,8 +28,9 @@ namespace G4NCrystal {
   // Call just after initialising the G4 run manager, in order to modify the  //
   // physics processes of neutrons and let any "NCrystal" properties          //
   // associated to the G4Materials take over the elastic hadronic physics     //
-  // below 2eV (this is thus a run-time physics-list modification, and is an  //
-  // alternative to the usual approach of hard-coded physics lists):          //
+  // below their energy thresholds (5eV by default, see G4NCManager.hh). This //
+  // is thus a run-time physics-list modification, and is an alternative to   //
+  // the usual approach of hard-coded physics lists:                          //
   //                                                                          //
   // NB: For this to work, your physics list must have installed exactly one  //
   //    active process derived from G4HadronElasticProcess for neutrons.      //
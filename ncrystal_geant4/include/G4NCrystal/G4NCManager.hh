@@ -23,12 +23,18 @@
 
 #include <map>
 #include <vector>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <cassert>
+#include <limits>
 #include "G4Material.hh"
 #include "G4Version.hh"
 #include "G4MaterialPropertiesTable.hh"
 #include "NCrystal/NCProcImpl.hh"
 //Manager class tracking indices of NCrystal::Scatter instances associated to
-//G4Materials, via entries in the G4MaterialPropertiesTable's on the materials.
+//G4Materials, via entries in the G4MaterialPropertiesTable's on the materials
+//(and internally via a lookup table indexed by G4Material::GetIndex()).
 
 class G4Material;
 namespace NCrystal {
@@ -45,7 +51,14 @@ namespace G4NCrystal {
     //Methods needed to add NCrystal::Scatter* properties to G4Materials (via
     //the property tables):
     static Manager * getInstance();//Get the singleton
-    void addScatterProperty(G4Material*, NCrystal::ProcImpl::ProcPtr&&);
+
+    //The energy threshold specifies the neutron energies up to which the
+    //NCrystal process is used for the material (the wrapped Geant4 process
+    //takes over above it). When not specified (i.e. negative), the default
+    //threshold of 5eV is used, lowered if needed to the upper end of the
+    //domain() of the (non-null) process:
+    void addScatterProperty(G4Material*, NCrystal::ProcImpl::ProcPtr&&,
+                            G4double energyThreshold = -1.0 );
 
     //Methods for framework implementers:
     const NCrystal::ProcImpl::Process* getScatterProperty(G4Material*) const;//returns nullptr when absent.
@@ -55,6 +68,62 @@ namespace G4NCrystal {
     using ProcAndCache = std::pair<const NCrystal::ProcImpl::Process*,NCrystal::CachePtr*>;
     ProcAndCache getScatterPropertyWithThreadSafeCache(G4Material*) const;
 
+    //The CachePtr objects used above are by default kept in a pool owned by
+    //the current thread. Task-based run managers (where work moves between
+    //pooled tasks rather than being tied to long-lived worker threads) can
+    //instead keep a CachePool per task, and activate it with a Scope object
+    //while the task is running on a given thread. A pool must only be
+    //active in one thread at a time. Pools grow as needed, so materials can
+    //be added after they are created:
+    class CachePool {
+    public:
+      CachePool() = default;
+      CachePool( const CachePool& ) = delete;
+      CachePool& operator=( const CachePool& ) = delete;
+      NCrystal::CachePtr& cachePtr( unsigned scatter_idx );
+      void clear() { m_caches.clear(); }
+      class Scope {
+      public:
+        Scope( CachePool& );//activates pool in current thread
+        ~Scope();//restores previously active pool
+        Scope( const Scope& ) = delete;
+        Scope& operator=( const Scope& ) = delete;
+      private:
+        CachePool * m_prev;
+      };
+    private:
+      std::vector<NCrystal::CachePtr> m_caches;
+    };
+
+    //Energy threshold of given material (0 if absent), and the maximal
+    //threshold of all materials. Since the latter requires no material lookup,
+    //it should be checked first (the common case of high-energy neutrons can
+    //then be passed on directly to the wrapped process):
+    G4double getEnergyThreshold(G4Material*) const;
+    G4double maxEnergyThreshold() const { return m_maxThreshold; }
+
+    //Tabulated cross sections (per atom, in G4 units) of the scatter properties
+    //of isotropic materials, for fast mean-free-path evaluations during the
+    //event loop. The tables are built with the adaptive energy grids of
+    //NCrystal::ProcImpl::ProcComposition::createTabulated, so Bragg edges are
+    //resolved, and cross sections are given by a binary search and a linear
+    //interpolation in the range [emin,emax]:
+    struct XSTable {
+      std::vector<G4double> egrid;
+      std::vector<G4double> xs;
+      G4double emin() const { return egrid.front(); }
+      G4double emax() const { return egrid.back(); }
+      G4double crossSection( G4double ekin ) const;//requires emin<=ekin<=emax
+    };
+    const XSTable* getXSTable(G4Material*) const;//returns nullptr when absent.
+
+    //Build missing tables (up to the largest energy threshold of the materials
+    //using them) for all current scatter properties. This is intended to be
+    //called at physics table building time (first in the master thread), and
+    //must not be invoked concurrently with event processing when new scatter
+    //properties were added:
+    void buildXSTables();
+
     //Thoroughly clear caches, manager singleton, and possibly NCrystal
     //factories. It is NOT safe to use the Scatter properties of already created
     //G4Materials after this.
@@ -78,6 +147,22 @@ namespace G4NCrystal {
     static Manager * s_mgr;
     std::vector<NCrystal::ProcImpl::ProcPtr> m_scatters;
     std::map<uint64_t,unsigned> m_scat2idx;
+    //Stateless processes never use their caches, so they all share a single
+    //(always empty) cache instead of getting one per thread:
+    std::vector<char> m_scatidxIsStateless;
+    mutable NCrystal::CachePtr m_statelessCache;
+    //Scatter indices and energy thresholds by G4Material::GetIndex() (filled in
+    //addScatterProperty), for fast lookups during the event loop:
+    struct MatEntry {
+      unsigned scatidx = std::numeric_limits<unsigned>::max();
+      G4double threshold = 0.0;
+    };
+    std::vector<MatEntry> m_matentries;
+    std::vector<G4double> m_scatidx2maxthreshold;
+    G4double m_maxThreshold = 0.0;
+    //Tables by scatter index (nullptr when absent):
+    std::vector<std::unique_ptr<const XSTable>> m_xstables;
+    std::mutex m_xstablesMutex;
     G4String m_key;
     NCrystal::CachePtr& getCachePtrForCurrentThreadAndProcess( unsigned scatter_idx ) const;
     //Returns numeric_limits<unsigned>::max() if not available:
@@ -98,43 +183,51 @@ namespace G4NCrystal {
       return {nullptr,nullptr};
     assert(scatidx<m_scatters.size());
     const NCrystal::ProcImpl::Process* sp = m_scatters[scatidx].get();
+    if ( m_scatidxIsStateless[scatidx] )
+      return { sp, &m_statelessCache };
     return { sp, &getCachePtrForCurrentThreadAndProcess( scatidx ) };
   }
 
   inline unsigned Manager::lookupScatterPropertyIndex(G4Material*mat) const
   {
-    G4MaterialPropertiesTable* matprop = mat->GetMaterialPropertiesTable();
-    constexpr unsigned not_found = std::numeric_limits<unsigned>::max();
-    if (!matprop)
-      return not_found;
-#if G4VERSION_NUMBER < 1040
-    //Property maps pre-Geant4 10.4
-    using PropMap_T = std::map< G4String, G4double, std::less<G4String> > ;
-    const PropMap_T* propcmap = matprop->GetPropertiesCMap();
-    PropMap_T::size_type size = propcmap->size();
-    //Access property like this instead of via
-    //ConstPropertyExists+GetConstProperty, to avoid needless string allocations
-    //and double map lookup:
-    if (size<=1) {
-      //Optimise to quickly check in small maps, since we are likely the only
-      //user of constant material properties (this check can be removed if the
-      //situation changes drastically):
-      PropMap_T::const_iterator it;
-      return (size && (it=propcmap->begin())->first == m_key) ? static_cast<unsigned>(it->second) : not_found;
-    } else {
-      //Full map search:
-      PropMap_T::const_iterator it = propcmap->find(m_key);
-      return it==propcmap->end() ? not_found : static_cast<unsigned>(it->second);
-    }
-#else
-    //Property maps post Geant4 10.4. Here the internal keys are integers, but
-    //we can't be sure it is always the same in different materials. Unfortunately
-    //GetConstProperty triggers a G4 exception in case the key is not present,
-    //so for safety we have to trigger one extra map search via ConstPropertyExists:
-    if ( matprop->GetConstPropertyMap()->empty() || !matprop->ConstPropertyExists(m_key) )
-      return not_found;
-    return static_cast<unsigned>(matprop->GetConstProperty(m_key));
-#endif
+    //The scatter index is also stored as the "NCScat" constant property on the
+    //material (as in all previous releases), but looking it up in the
+    //string-keyed property map in every step is too slow, so we instead keep a
+    //flat vector indexed by the material index:
+    const std::size_t matidx = mat->GetIndex();
+    return ( matidx < m_matentries.size()
+             ? m_matentries[matidx].scatidx
+             : std::numeric_limits<unsigned>::max() );
+  }
+
+  inline G4double Manager::getEnergyThreshold(G4Material*mat) const
+  {
+    const std::size_t matidx = mat->GetIndex();
+    return matidx < m_matentries.size() ? m_matentries[matidx].threshold : 0.0;
+  }
+
+  inline NCrystal::CachePtr& Manager::CachePool::cachePtr( unsigned scatter_idx )
+  {
+    if ( !( scatter_idx < m_caches.size() ) )
+      m_caches.resize( scatter_idx + 1 );
+    return m_caches[scatter_idx];
+  }
+
+  inline const Manager::XSTable* Manager::getXSTable(G4Material*mat) const
+  {
+    unsigned scatidx = lookupScatterPropertyIndex(mat);
+    return scatidx < m_xstables.size() ? m_xstables[scatidx].get() : nullptr;
+  }
+
+  inline G4double Manager::XSTable::crossSection( G4double ekin ) const
+  {
+    assert( egrid.size() >= 2 && ekin >= egrid.front() && ekin <= egrid.back() );
+    std::size_t i = std::upper_bound( egrid.begin(), egrid.end(), ekin ) - egrid.begin();
+    i = ( i == 0 ? 0 : std::min<std::size_t>( i - 1, egrid.size() - 2 ) );
+    const G4double e0 = egrid[i];
+    const G4double e1 = egrid[i+1];
+    const G4double t = ( e1 > e0 ? ( ekin - e0 ) / ( e1 - e0 ) : 0.0 );
+    return xs[i] + t * ( xs[i+1] - xs[i] );
   }
 
   inline const NCrystal::ProcImpl::Process* Manager::getScatterProperty(G4Material*mat) const
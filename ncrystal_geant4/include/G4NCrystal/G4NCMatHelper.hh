@@ -23,6 +23,7 @@
 
 #include "NCrystal/NCMatCfg.hh"
 #include "G4Material.hh"
+#include <vector>
 
 namespace G4NCrystal {
 
@@ -38,6 +39,15 @@ namespace G4NCrystal {
   //Alternatively create, configure and pass in an NCrystal MatCfg object:
   NCRYSTAL_API G4Material * createMaterial( const MatCfg&  cfg );
 
+  //Create materials for a list of configuration strings at once (results are
+  //in the same order as the input). The (potentially expensive) initialisation
+  //of the NCrystal objects takes place concurrently, using up to
+  //NCrystal::getNumberOfThreads() threads (see NCFact.hh), after which the
+  //G4Material objects are created serially in the calling thread. Repeated
+  //requests for the same configuration (in this or separate calls) always
+  //return the same G4Material:
+  NCRYSTAL_API std::vector<G4Material*> createMaterials( const std::vector<G4String>& cfgstrs );
+
   //Set/disable debug output (off by default unless NCRYSTAL_DEBUG_G4MATERIALS
   //was set when the library was loaded):
   NCRYSTAL_API void enableCreateMaterialVerbosity(bool = true);
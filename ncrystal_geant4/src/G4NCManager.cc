@@ -21,6 +21,7 @@
 #include "G4NCrystal/G4NCManager.hh"
 
 #include "G4Material.hh"
+#include "G4SystemOfUnits.hh"
 #include "Randomize.hh"
 #include "globals.hh"
 
@@ -47,18 +48,38 @@ NCG4::Manager * NCG4::Manager::getInstance()
   return s_mgr;
 }
 
+namespace G4NCrystal {
+  namespace {
+    //Pool activated via CachePool::Scope (protect thread_local keyword to
+    //avoid potential headaches in ST builds):
+#ifdef G4MULTITHREADED
+    thread_local
+#endif
+    Manager::CachePool * s_activeCachePool = nullptr;
+  }
+}
+
+NCG4::Manager::CachePool::Scope::Scope( CachePool& pool )
+  : m_prev( s_activeCachePool )
+{
+  s_activeCachePool = &pool;
+}
+
+NCG4::Manager::CachePool::Scope::~Scope()
+{
+  s_activeCachePool = m_prev;
+}
+
 NC::CachePtr& NCG4::Manager::getCachePtrForCurrentThreadAndProcess( unsigned scatter_idx ) const {
+  assert( scatter_idx < m_scatters.size() );
+  if ( s_activeCachePool )
+    return s_activeCachePool->cachePtr( scatter_idx );
   static
 #ifdef G4MULTITHREADED //protect thread_local keyword to avoid potential headaches in ST builds
  thread_local
 #endif
-    std::unique_ptr<std::vector<NCrystal::CachePtr>> cacheptrs;
-  if ( cacheptrs == nullptr ) {
-    cacheptrs = std::make_unique<decltype(cacheptrs)::element_type>();
-    cacheptrs->resize( m_scatters.size() );
-  }
-  assert( scatter_idx < cacheptrs->size() );
-  return (*cacheptrs)[scatter_idx];
+    CachePool threadCachePool;
+  return threadCachePool.cachePtr( scatter_idx );
 }
 
 NCrystal::ProcImpl::OptionalProcPtr NCG4::Manager::getScatterPropertyPtr(G4Material*mat) const
@@ -70,7 +91,8 @@ NCrystal::ProcImpl::OptionalProcPtr NCG4::Manager::getScatterPropertyPtr(G4Mater
   return m_scatters.at(scatidx);
 }
 
-void NCG4::Manager::addScatterProperty(G4Material* mat,NCrystal::ProcImpl::ProcPtr&&scat)
+void NCG4::Manager::addScatterProperty(G4Material* mat,NCrystal::ProcImpl::ProcPtr&&scat,
+                                       G4double energyThreshold)
 {
   if ( mat == nullptr || scat == nullptr )
     G4Exception ("NCG4::Manager::addScatterProperty", "NCAddingNull",
@@ -99,6 +121,7 @@ void NCG4::Manager::addScatterProperty(G4Material* mat,NCrystal::ProcImpl::ProcP
   if ( it == m_scat2idx.end() ) {
     idx = m_scatters.size();
     m_scat2idx[scatuid] = idx;
+    m_scatidxIsStateless.push_back( scat->isStateless() ? 1 : 0 );
     m_scatters.push_back(std::move(scat));
   } else {
     //already known:
@@ -106,6 +129,65 @@ void NCG4::Manager::addScatterProperty(G4Material* mat,NCrystal::ProcImpl::ProcP
   }
   assert( unsigned(double(idx)) == idx );//make sure we can get the idx back out
   matprop->AddConstProperty(m_key.c_str(), idx);
+
+  if ( energyThreshold < 0.0 ) {
+    //Default threshold, but never beyond the domain of the process (null
+    //processes keep the default, since they are meant to disable scattering):
+    energyThreshold = 5*CLHEP::eV;
+    const auto& proc = m_scatters.at(idx);
+    if ( !proc->isNull() )
+      energyThreshold = std::min<G4double>( energyThreshold, proc->domain().ehigh.dbl() * CLHEP::eV );
+  }
+
+  const std::size_t matidx = mat->GetIndex();
+  if ( !( matidx < m_matentries.size() ) )
+    m_matentries.resize( matidx + 1 );
+  m_matentries[matidx].scatidx = idx;
+  m_matentries[matidx].threshold = energyThreshold;
+
+  if ( !( idx < m_scatidx2maxthreshold.size() ) )
+    m_scatidx2maxthreshold.resize( idx + 1, 0.0 );
+  m_scatidx2maxthreshold[idx] = std::max( m_scatidx2maxthreshold[idx], energyThreshold );
+  m_maxThreshold = std::max( m_maxThreshold, energyThreshold );
+}
+
+void NCG4::Manager::buildXSTables()
+{
+  std::lock_guard<std::mutex> guard(m_xstablesMutex);
+  if ( m_xstables.size() < m_scatters.size() )
+    m_xstables.resize( m_scatters.size() );
+  for ( std::size_t i = 0; i < m_scatters.size(); ++i ) {
+    const auto& proc = m_scatters[i];
+    if ( m_xstables[i] != nullptr )
+      continue;
+    try {
+      NC::ProcImpl::ProcCompTabulationCfg cfg;
+      cfg.emax = NC::NeutronEnergy{ m_scatidx2maxthreshold.at(i) / CLHEP::eV };//NCrystal unit is eV
+      //Create lazily initialised structures here rather than in the first
+      //events:
+      proc->warmup( NC::EnergyDomain{ NC::NeutronEnergy{0.0}, cfg.emax } );
+      if ( proc->isOriented() )
+        continue;
+      if ( !( cfg.emax > cfg.emin ) )
+        continue;
+      auto tabulated = NC::ProcImpl::ProcComposition::createTabulated( proc, cfg );
+      const NC::VectD& egrid = tabulated->tabulatedEnergyGrid();
+      if ( egrid.size() < 2 )
+        continue;//null process
+      //Cross sections are evaluated exactly at the grid points:
+      auto table = std::make_unique<XSTable>();
+      table->egrid.reserve( egrid.size() );
+      table->xs.reserve( egrid.size() );
+      NC::CachePtr cacheptr;
+      for ( auto e : egrid ) {
+        table->egrid.push_back( e * CLHEP::eV );
+        table->xs.push_back( proc->crossSectionIsotropic( cacheptr, NC::NeutronEnergy{e} ).get() * CLHEP::barn );
+      }
+      m_xstables[i] = std::move(table);
+    } catch ( NC::Error::Exception& e ) {
+      handleError("G4NCrystal::Manager::buildXSTables",103,e);
+    }
+  }
 }
 
 void NCG4::Manager::cleanup()
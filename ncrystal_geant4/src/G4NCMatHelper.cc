@@ -23,6 +23,8 @@
 #include "NCrystal/NCVersion.hh"
 #include "NCrystal/NCFactImpl.hh"
 #include "NCrystal/NCCompositionUtils.hh"
+#include "NCrystal/NCFact.hh"
+#include "NCrystal/internal/NCThreadUtils.hh"
 #include "G4NistManager.hh"
 #include "G4ios.hh"
 #include <atomic>
@@ -229,6 +231,23 @@ namespace G4NCrystal {
 
     G4Material * getFinalMaterialImpl( const NC::MatCfg& cfg ) {
 
+      //Geometries often use the same cfg for many volumes, so first look for
+      //the material via the normalised cfg (for single phase cfgs, this is
+      //combined with the UID of the data, in case it was modified). This
+      //avoids the creation of the NCrystal objects below, even if those would
+      //mostly just be looked up in the NCrystal factory caches:
+      std::pair<uint64_t,std::string> cfg_key;
+      if ( cfg.isSinglePhase() ) {
+        cfg_key.first = cfg.textDataUID().value();
+        cfg_key.second = cfg.toStrCfg(false);
+        auto itcfg = m_g4cfgmaterials.find(cfg_key);
+        if ( itcfg != m_g4cfgmaterials.end() ) {
+          G4Material * mat = G4Material::GetMaterialTable()->at(itcfg->second);
+          if (mat)
+            return mat;//was created and still alive
+        }
+      }
+
       //The key is simply the UID's of the NCrystal Info (for
       //density/temperature/composition/...) and Scatter (for cross sectins and
       //sampling) objects. This conveniently piggy-backs on the NCrystal factory
@@ -241,8 +260,11 @@ namespace G4NCrystal {
       auto it = m_g4finalmaterials.find(cache_key);
       if ( it != m_g4finalmaterials.end() ) {
         G4Material * mat = G4Material::GetMaterialTable()->at(it->second);
-        if (mat)
+        if (mat) {
+          if ( !cfg_key.second.empty() )
+            m_g4cfgmaterials[cfg_key] = it->second;
           return mat;//was created and still alive
+        }
       }
       //Must create:
 
@@ -272,8 +294,10 @@ namespace G4NCrystal {
 
       G4NCrystal::Manager::getInstance()->addScatterProperty(mat,std::move(scatter));
 
-      //Add to cache and return:
+      //Add to caches and return:
       m_g4finalmaterials[cache_key] = mat->GetIndex();
+      if ( !cfg_key.second.empty() )
+        m_g4cfgmaterials[cfg_key] = mat->GetIndex();
       return mat;
     }
 
@@ -286,6 +310,7 @@ namespace G4NCrystal {
     std::map<NCCU::ElementBreakdownLW,G4Index> m_g4elements;
     std::map<NCCU::LWBreakdown,G4Index> m_g4basematerials;
     std::map<std::pair<uint64_t,uint64_t>,G4Index> m_g4finalmaterials;
+    std::map<std::pair<uint64_t,std::string>,G4Index> m_g4cfgmaterials;
   };
 
   struct NCG4ObjectDB {
@@ -344,3 +369,53 @@ G4Material * G4NCrystal::createMaterial( const NC::MatCfg&  cfg )
   }
   return 0;
 }
+
+std::vector<G4Material*> G4NCrystal::createMaterials( const std::vector<G4String>& cfgstrs )
+{
+  std::vector<G4Material*> result;
+  try {
+    //Parse the cfgs and initialise the NCrystal objects concurrently (once for
+    //each distinct cfg string). The G4 objects must then be created serially:
+    std::vector<std::string> unique_cfgstrs;
+    std::vector<std::size_t> unique_idx;
+    unique_idx.reserve(cfgstrs.size());
+    {
+      std::map<std::string,std::size_t> str2idx;
+      for ( auto& cfgstr : cfgstrs ) {
+        auto it = str2idx.find(cfgstr);
+        if ( it == str2idx.end() ) {
+          it = str2idx.emplace( cfgstr, unique_cfgstrs.size() ).first;
+          unique_cfgstrs.push_back( cfgstr );
+        }
+        unique_idx.push_back( it->second );
+      }
+    }
+    const std::size_t nunique = unique_cfgstrs.size();
+    std::vector<NC::Optional<NC::MatCfg>> cfgs( nunique );
+    std::vector<NC::Optional<NC::shared_obj<const NC::Info>>> infos( nunique );
+    std::vector<NC::Optional<NC::ProcImpl::ProcPtr>> scatters( nunique );//keep objects alive
+    NC::parallelForIndex( nunique, NC::getNumberOfThreads(),
+                          [&]( std::size_t i )
+                          {
+                            cfgs[i] = NC::MatCfg( unique_cfgstrs[i] );
+                            infos[i] = NC::FactImpl::createInfo( cfgs[i].value() );
+                            scatters[i] = NC::FactImpl::createScatter( cfgs[i].value() );
+                          } );
+
+    std::vector<G4Material*> unique_mats;
+    unique_mats.reserve( nunique );
+    {
+      auto& db = objDB();
+      NCRYSTAL_LOCK_GUARD(db.mtx);
+      for ( auto& cfg : cfgs )
+        unique_mats.push_back( db.db.getFinalMaterial( cfg.value() ) );
+    }
+    result.reserve( cfgstrs.size() );
+    for ( auto i : unique_idx )
+      result.push_back( unique_mats.at(i) );
+  } catch ( NC::Error::Exception& e ) {
+    Manager::handleError("G4NCrystal::createMaterials",101,e);
+    result.assign( cfgstrs.size(), nullptr );
+  }
+  return result;
+}
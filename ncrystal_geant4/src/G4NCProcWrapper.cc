@@ -21,6 +21,7 @@
 #include "G4NCProcWrapper.hh"
 #include "G4NCrystal/G4NCManager.hh"
 #include "NCrystal/NCRNG.hh"
+#include "NCrystal/internal/NCRotMatrix.hh"
 
 #include "G4Step.hh"
 #include "G4StepPoint.hh"
@@ -31,6 +32,7 @@
 #include "G4ParticleChange.hh"
 #include "G4VTouchable.hh"
 #include "G4NavigationHistory.hh"
+#include "G4AffineTransform.hh"
 
 namespace NC = NCrystal;
 namespace NCG4 = G4NCrystal;
@@ -45,12 +47,117 @@ namespace G4NCrystal {
       //
       //  RNG_G4Wrapper rng(G4Random::getTheEngine());
       //
-      //Since G4Random::getTheEngine() always returns a thread-local engine, this is then MT-safe!
-      constexpr RNG_G4Wrapper(CLHEP::HepRandomEngine * e) noexcept : m_engine(e) {}
+      //Since G4Random::getTheEngine() always returns a thread-local engine, this
+      //is then MT-safe!
+      //
+      //Rather than invoking the engine for each number, numbers are produced
+      //in blocks via flatArray and served from the buffer. Unused numbers are
+      //discarded along with the object, to keep results independent of
+      //earlier steps (e.g. when engines are reseeded for each event). To
+      //limit the waste for scatterings needing only a few numbers, the block
+      //size starts small and is doubled with each refill:
+      RNG_G4Wrapper(CLHEP::HepRandomEngine * e) noexcept : m_engine(e) {}
     protected:
-      double actualGenerate() override { return m_engine->flat(); }
+      double actualGenerate() override
+      {
+        if ( m_next == m_nfilled )
+          refill();
+        return m_buf[m_next++];
+      }
+    private:
+      static constexpr unsigned nbuf_min = 4;
+      static constexpr unsigned nbuf_max = 256;//must be nbuf_min times a power of 2
+      unsigned m_next = 0;
+      unsigned m_nfilled = 0;
+      unsigned m_nblock = nbuf_min;
+      double m_buf[nbuf_max];
+      void refill()
+      {
+        m_engine->flatArray( static_cast<int>(m_nblock), m_buf );
+        m_nfilled = m_nblock;
+        m_next = 0;
+        if ( m_nblock < nbuf_max )
+          m_nblock *= 2;
+      }
+    };
+
+
+    class LocalFrameCache {
+    public:
+      //Rotation between the lab frame and the local frame of the volume of an
+      //oriented material. To avoid recomputing this for each step, the
+      //rotation of the most recently used touchable is kept in a per-thread
+      //cache, which is keyed by the touchable and the copy of the physical
+      //volume (the translation is also compared, in order to catch touchable
+      //objects which are reused at a different location). Identity transforms
+      //result in no rotations at all.
+      static LocalFrameCache& forTouchable( const G4VTouchable& );
+
+      NC::NeutronDirection toLocal( const G4ThreeVector& ) const;
+      G4ThreeVector toLab( const NC::NeutronDirection& ) const;
+
+    private:
+      const G4VTouchable * m_touchable = nullptr;
+      const G4VPhysicalVolume * m_volume = nullptr;
+      G4int m_copyNo = 0;
+      G4ThreeVector m_translation;
+      bool m_identity = true;
+      NC::RotMatrix m_rot;//lab to local frame
+      void update( const G4VTouchable&, const G4AffineTransform& );
     };
 
+    LocalFrameCache& LocalFrameCache::forTouchable( const G4VTouchable& touchable )
+    {
+      static thread_local LocalFrameCache s_cache;
+      const G4AffineTransform& trf = touchable.GetHistory()->GetTopTransform();
+      if ( &touchable != s_cache.m_touchable
+           || touchable.GetVolume() != s_cache.m_volume
+           || touchable.GetCopyNumber() != s_cache.m_copyNo
+           || trf.NetTranslation() != s_cache.m_translation )
+        s_cache.update( touchable, trf );
+      return s_cache;
+    }
+
+    void LocalFrameCache::update( const G4VTouchable& touchable, const G4AffineTransform& trf )
+    {
+      m_touchable = &touchable;
+      m_volume = touchable.GetVolume();
+      m_copyNo = touchable.GetCopyNumber();
+      m_translation = trf.NetTranslation();
+      m_identity = !trf.IsRotated();
+      if ( m_identity )
+        return;
+      //The columns of the matrix are the transformed unit vectors:
+      const G4ThreeVector cx = trf.TransformAxis( G4ThreeVector(1.0,0.0,0.0) );
+      const G4ThreeVector cy = trf.TransformAxis( G4ThreeVector(0.0,1.0,0.0) );
+      const G4ThreeVector cz = trf.TransformAxis( G4ThreeVector(0.0,0.0,1.0) );
+      const double data[9] = { cx.x(), cy.x(), cz.x(),
+                               cx.y(), cy.y(), cz.y(),
+                               cx.z(), cy.z(), cz.z() };
+      m_rot = NC::RotMatrix( data );
+    }
+
+    inline NC::NeutronDirection LocalFrameCache::toLocal( const G4ThreeVector& v ) const
+    {
+      if ( m_identity )
+        return NC::NeutronDirection{ v.x(), v.y(), v.z() };
+      const NC::Vector r = m_rot * NC::Vector( v.x(), v.y(), v.z() );
+      return NC::NeutronDirection{ r.x(), r.y(), r.z() };
+    }
+
+    inline G4ThreeVector LocalFrameCache::toLab( const NC::NeutronDirection& d ) const
+    {
+      if ( m_identity )
+        return G4ThreeVector( d[0], d[1], d[2] );
+      //The inverse of a rotation is its transpose:
+      const double * r0 = m_rot[0];
+      const double * r1 = m_rot[1];
+      const double * r2 = m_rot[2];
+      return G4ThreeVector( r0[0]*d[0] + r1[0]*d[1] + r2[0]*d[2],
+                            r0[1]*d[0] + r1[1]*d[1] + r2[1]*d[2],
+                            r0[2]*d[0] + r1[2]*d[1] + r2[2]*d[2] );
+    }
+
   }
 }
 
@@ -78,15 +185,15 @@ G4VParticleChange* NCG4::ProcWrapper::PostStepDoIt(const G4Track& trk, const G4S
   //with the now disabled wrapped process):
   ClearNumberOfInteractionLengthLeft();
 
-  //TODO: Revisit the 5eV global threshold. Issue is perhaps tungsten
-  //which has resonances below 5eV. If possible, auto-detect the threshold by
-  //comparing G4 and NCrystal xsects around the threshold. Otherwise allow
-  //per-material specifications.
+  //Neutrons above all energy thresholds are passed on without any material
+  //lookups, and otherwise the threshold of the specific material is checked:
+  if ( !(ekin>0.0) || ekin > m_mgr->maxEnergyThreshold() )
+    return m_wrappedProc->PostStepDoIt(trk,step);
 
+  G4Material * mat = trk.GetMaterial();
   Manager::ProcAndCache procandcache;
-  if ( !(ekin>0.0)
-       || ekin > 5*CLHEP::eV
-       || ( procandcache = m_mgr->getScatterPropertyWithThreadSafeCache( trk.GetMaterial() ) ).first == nullptr )
+  if ( ekin > m_mgr->getEnergyThreshold( mat )
+       || ( procandcache = m_mgr->getScatterPropertyWithThreadSafeCache( mat ) ).first == nullptr )
     return m_wrappedProc->PostStepDoIt(trk,step);
 
  auto& ncscat = *procandcache.first;
@@ -109,11 +216,10 @@ G4VParticleChange* NCG4::ProcWrapper::PostStepDoIt(const G4Track& trk, const G4S
       g4outcome_dir.set(outcome.direction[0],outcome.direction[1],outcome.direction[2]);
     } else {
       //Orientation of material matters, need to transform to-and-from the frame of the volume (touchable):
-      const G4AffineTransform &trf = step.GetPreStepPoint()->GetTouchable()->GetHistory()->GetTopTransform();
-      G4ThreeVector indir_local = trf.TransformAxis(indir);
-      auto outcome = ncscat.sampleScatter(cacheptr,rng,nc_ekin_in, NC::NeutronDirection{indir_local.x(),indir_local.y(),indir_local.z()} );
+      const auto& frame = LocalFrameCache::forTouchable( *step.GetPreStepPoint()->GetTouchable() );
+      auto outcome = ncscat.sampleScatter(cacheptr,rng,nc_ekin_in, frame.toLocal(indir) );
       g4outcome_ekin = outcome.ekin.get() * CLHEP::eV;
-      g4outcome_dir = trf.Inverse().TransformAxis(G4ThreeVector{outcome.direction[0],outcome.direction[1],outcome.direction[2]});
+      g4outcome_dir = frame.toLab( outcome.direction );
     }
   } catch ( NC::Error::Exception& e ) {
     Manager::handleError("G4NCrystal::ProcWrapper::PostStepDoIt",101,e);
@@ -132,10 +238,25 @@ G4double NCG4::ProcWrapper::GetMeanFreePath(const G4Track& trk, G4double p, G4Fo
   assert(trk.GetParticleDefinition()->GetPDGEncoding()==2112);
   const double ekin = trk.GetKineticEnergy();
 
-  Manager::ProcAndCache procandcache;
-  if ( !(ekin>0.0)
-       || ekin > 5*CLHEP::eV
-       || ( procandcache = m_mgr->getScatterPropertyWithThreadSafeCache( trk.GetMaterial() ) ).first == nullptr )
+  if ( !(ekin>0.0) || ekin > m_mgr->maxEnergyThreshold() )
+    return m_wrappedProc->GetMeanFreePath(trk,p,f);
+
+  G4Material * mat = trk.GetMaterial();
+  if ( ekin > m_mgr->getEnergyThreshold( mat ) )
+    return m_wrappedProc->GetMeanFreePath(trk,p,f);
+
+  //Fast path for isotropic materials, based on tables prepared in
+  //BuildPhysicsTable:
+  const Manager::XSTable * xstable = m_mgr->getXSTable( mat );
+  if ( xstable && ekin >= xstable->emin() && ekin <= xstable->emax() ) {
+    const double xs = xstable->crossSection( ekin );
+    return xs > 0.0
+      ? 1.0 / ( mat->GetTotNbOfAtomsPerVolume() * xs )
+      : NC::kInfinity ;
+  }
+
+  Manager::ProcAndCache procandcache = m_mgr->getScatterPropertyWithThreadSafeCache( mat );
+  if ( procandcache.first == nullptr )
     return m_wrappedProc->GetMeanFreePath(trk,p,f);
 
 
@@ -151,20 +272,24 @@ G4double NCG4::ProcWrapper::GetMeanFreePath(const G4Track& trk, G4double p, G4Fo
     if( ! ncscat.isOriented() ) {
       xs = ncscat.crossSection( cacheptr, nc_ekin_in, NC::NeutronDirection{indir.x(),indir.y(),indir.z()}).get() * CLHEP::barn;
     } else {
-      G4ThreeVector indir_local = trk.GetStep()->GetPreStepPoint()->GetTouchable()->GetHistory()->GetTopTransform().TransformAxis(indir);
-      xs = ncscat.crossSection( cacheptr, nc_ekin_in, NC::NeutronDirection{indir_local.x(),indir_local.y(),indir_local.z()} ).get() * CLHEP::barn;
+      const auto& frame = LocalFrameCache::forTouchable( *trk.GetStep()->GetPreStepPoint()->GetTouchable() );
+      xs = ncscat.crossSection( cacheptr, nc_ekin_in, frame.toLocal(indir) ).get() * CLHEP::barn;
     }
   } catch ( NC::Error::Exception& e ) {
     Manager::handleError("G4NCrystal::ProcWrapper::GetMeanFreePath",102,e);
   }
 
   return xs
-      ? 1.0 / ( trk.GetMaterial()->GetTotNbOfAtomsPerVolume() * xs )
+      ? 1.0 / ( mat->GetTotNbOfAtomsPerVolume() * xs )
       : NC::kInfinity ;
 }
 
 void NCG4::ProcWrapper::BuildPhysicsTable(const G4ParticleDefinition&)
 {
+  //Tabulate cross sections of isotropic NCrystal materials up to the energy
+  //thresholds below which NCrystal physics is used (tables already built, for
+  //instance by the master thread, are reused):
+  m_mgr->buildXSTables();
 }
 
 G4bool NCG4::ProcWrapper::IsApplicable(const G4ParticleDefinition& pd)
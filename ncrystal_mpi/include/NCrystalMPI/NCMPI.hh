@@ -0,0 +1,54 @@
+#ifndef NCrystalMPI_MPI_hh
+#define NCrystalMPI_MPI_hh
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystal/NCMatCfg.hh"
+#include <mpi.h>
+#include <string>
+#include <vector>
+
+//Optional MPI integration layer, avoiding that all ranks of a large MPI job
+//have to carry out the expensive parts of material initialisation
+//independently. It is built upon the material snapshots of NCFact.hh (see
+//NCrystal::createSnapshot and NCrystal::loadSnapshot): The first rank creates
+//a snapshot for the requested materials, and broadcasts its files to one rank
+//on each node, which writes them to a node-local directory. All ranks then
+//load the snapshot from that directory, so subsequent creation of the
+//materials on any rank simply reads the precomputed results (HKL lists and
+//scattering kernels with their sampling data) from those files.
+
+namespace NCrystalMPI {
+
+  //Collective call which must be made by all ranks of the communicator with
+  //identical cfgs. The snapshot files are placed in a new directory inside
+  //nodelocaldir (which must exist on all nodes), or inside $TMPDIR (/tmp if
+  //not set) in case nodelocaldir is empty. The directory is not removed
+  //again, since the files are needed as long as materials are being created.
+  //Errors on any rank result in exceptions being thrown on all ranks. Returns
+  //the path of the directory used on the current node:
+  std::string prepareMaterials( const std::vector<NCrystal::MatCfg>& cfgs,
+                                MPI_Comm comm = MPI_COMM_WORLD,
+                                const std::string& nodelocaldir = std::string() );
+
+}
+
+#endif
@@ -0,0 +1,233 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  This file is part of NCrystal (see https://mctools.github.io/ncrystal/)   //
+//                                                                            //
+//  Copyright 2015-2022 NCrystal developers                                   //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//      http://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "NCrystalMPI/NCMPI.hh"
+#include "NCrystal/NCFact.hh"
+#include "NCrystal/NCException.hh"
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace NC = NCrystal;
+
+namespace NCrystalMPI {
+  namespace {
+
+    //Files are broadcast as a single buffer holding the number of files
+    //followed by (namelength,name,datalength,data) for each file, with all
+    //lengths as 8-byte integers:
+    using Buffer = std::string;
+
+    void appendUInt64( Buffer& buf, uint64_t v )
+    {
+      char tmp[sizeof(v)];
+      std::memcpy( tmp, &v, sizeof(v) );
+      buf.append( tmp, sizeof(v) );
+    }
+
+    uint64_t readUInt64( const Buffer& buf, std::size_t& pos )
+    {
+      uint64_t v;
+      if ( buf.size() - pos < sizeof(v) )
+        NCRYSTAL_THROW(DataLoadError,"NCrystalMPI: corrupted snapshot buffer");
+      std::memcpy( &v, buf.data() + pos, sizeof(v) );
+      pos += sizeof(v);
+      return v;
+    }
+
+    std::string readChunk( const Buffer& buf, std::size_t& pos )
+    {
+      const uint64_t n = readUInt64( buf, pos );
+      if ( buf.size() - pos < n )
+        NCRYSTAL_THROW(DataLoadError,"NCrystalMPI: corrupted snapshot buffer");
+      std::string res( buf.data() + pos, static_cast<std::size_t>( n ) );
+      pos += static_cast<std::size_t>( n );
+      return res;
+    }
+
+    std::string readFile( const std::string& path )
+    {
+      std::ifstream ifs( path, std::ios::binary );
+      std::ostringstream ss;
+      ss << ifs.rdbuf();
+      if ( !ifs.good() && !ifs.eof() )
+        NCRYSTAL_THROW2(DataLoadError,"NCrystalMPI: could not read file \""<<path<<"\"");
+      return ss.str();
+    }
+
+    void writeFile( const std::string& path, const std::string& data )
+    {
+      std::ofstream ofs( path, std::ios::binary | std::ios::out | std::ios::trunc );
+      ofs.write( data.data(), data.size() );
+      if ( !ofs.good() )
+        NCRYSTAL_THROW2(CalcError,"NCrystalMPI: could not write file \""<<path<<"\"");
+    }
+
+    Buffer packDirectory( const std::string& dirname )
+    {
+      std::vector<std::string> names;
+      DIR * dir = opendir( dirname.c_str() );
+      if ( !dir )
+        NCRYSTAL_THROW2(FileNotFound,"NCrystalMPI: could not open directory \""<<dirname<<"\"");
+      while ( struct dirent * e = readdir( dir ) ) {
+        std::string name( e->d_name );
+        struct stat st;
+        if ( stat( ( dirname + "/" + name ).c_str(), &st ) == 0 && S_ISREG( st.st_mode ) )
+          names.push_back( std::move( name ) );
+      }
+      closedir( dir );
+      Buffer buf;
+      appendUInt64( buf, names.size() );
+      for ( auto& name : names ) {
+        std::string data = readFile( dirname + "/" + name );
+        appendUInt64( buf, name.size() );
+        buf.append( name );
+        appendUInt64( buf, data.size() );
+        buf.append( data );
+      }
+      return buf;
+    }
+
+    void unpackDirectory( const Buffer& buf, const std::string& dirname )
+    {
+      std::size_t pos = 0;
+      const uint64_t nfiles = readUInt64( buf, pos );
+      for ( uint64_t i = 0; i < nfiles; ++i ) {
+        std::string name = readChunk( buf, pos );
+        if ( name.empty() || name.find('/') != std::string::npos )
+          NCRYSTAL_THROW(DataLoadError,"NCrystalMPI: corrupted snapshot buffer");
+        writeFile( dirname + "/" + name, readChunk( buf, pos ) );
+      }
+    }
+
+    std::string createUniqueDir( const std::string& parent )
+    {
+      std::string base = parent;
+      if ( base.empty() ) {
+        const char * tmpdir = std::getenv("TMPDIR");
+        base = ( tmpdir && *tmpdir ) ? tmpdir : "/tmp";
+      }
+      std::string templ = base + "/ncrystal_mpi_snapshot_XXXXXX";
+      std::vector<char> tmp( templ.begin(), templ.end() );
+      tmp.push_back( '\0' );
+      if ( !mkdtemp( tmp.data() ) )
+        NCRYSTAL_THROW2(CalcError,"NCrystalMPI: could not create directory in \""<<base<<"\"");
+      return std::string( tmp.data() );
+    }
+
+    //Broadcast strings of any size (MPI counts are int):
+    void bcastString( std::string& s, int root, MPI_Comm comm )
+    {
+      int rank;
+      MPI_Comm_rank( comm, &rank );
+      uint64_t n = s.size();
+      MPI_Bcast( &n, 1, MPI_UINT64_T, root, comm );
+      if ( rank != root )
+        s.resize( static_cast<std::size_t>( n ) );
+      constexpr uint64_t maxchunk = INT_MAX;
+      for ( uint64_t offset = 0; offset < n; offset += maxchunk ) {
+        const int count = static_cast<int>( std::min<uint64_t>( maxchunk, n - offset ) );
+        MPI_Bcast( &s[static_cast<std::size_t>(offset)], count, MPI_CHAR, root, comm );
+      }
+    }
+
+    //Run a step on some ranks, and rethrow any error on all ranks of comm (so
+    //no rank is left waiting in a collective call):
+    template<class TFunc>
+    void collectiveStep( MPI_Comm comm, bool active, TFunc&& func )
+    {
+      std::string errmsg;
+      if ( active ) {
+        try {
+          func();
+        } catch ( std::exception& e ) {
+          errmsg = e.what();
+          if ( errmsg.empty() )
+            errmsg = "unknown error";
+        }
+      }
+      int failed = errmsg.empty() ? 0 : 1;
+      int anyfailed = 0;
+      MPI_Allreduce( &failed, &anyfailed, 1, MPI_INT, MPI_MAX, comm );
+      if ( !anyfailed )
+        return;
+      //Let the lowest failing rank tell the others what went wrong:
+      int rank;
+      MPI_Comm_rank( comm, &rank );
+      int srcrank = failed ? rank : INT_MAX;
+      int root = INT_MAX;
+      MPI_Allreduce( &srcrank, &root, 1, MPI_INT, MPI_MIN, comm );
+      bcastString( errmsg, root, comm );
+      NCRYSTAL_THROW2(CalcError,"NCrystalMPI: material preparation failed on rank "<<root<<": "<<errmsg);
+    }
+
+  }
+}
+
+std::string NCrystalMPI::prepareMaterials( const std::vector<NC::MatCfg>& cfgs,
+                                           MPI_Comm comm,
+                                           const std::string& nodelocaldir )
+{
+  int rank;
+  MPI_Comm_rank( comm, &rank );
+
+  //Ranks sharing a node, and a communicator with the first rank of each node
+  //(world rank 0 is always the first rank on its node):
+  MPI_Comm nodecomm, leadercomm;
+  MPI_Comm_split_type( comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &nodecomm );
+  int noderank;
+  MPI_Comm_rank( nodecomm, &noderank );
+  MPI_Comm_split( comm, noderank == 0 ? 0 : MPI_UNDEFINED, rank, &leadercomm );
+  struct FreeComms {
+    MPI_Comm& a; MPI_Comm& b;
+    ~FreeComms() { MPI_Comm_free( &a ); if ( b != MPI_COMM_NULL ) MPI_Comm_free( &b ); }
+  } freecomms{ nodecomm, leadercomm };
+
+  //Node leaders prepare directories, and the first rank creates the snapshot:
+  std::string dirname;
+  Buffer buf;
+  collectiveStep( comm, noderank == 0, [&]()
+  {
+    dirname = createUniqueDir( nodelocaldir );
+    if ( rank == 0 ) {
+      NC::createSnapshot( cfgs, dirname );
+      buf = packDirectory( dirname );
+    }
+  } );
+
+  //Distribute files to the other nodes:
+  collectiveStep( comm, noderank == 0 && leadercomm != MPI_COMM_NULL, [&]()
+  {
+    bcastString( buf, 0, leadercomm );
+    if ( rank != 0 )
+      unpackDirectory( buf, dirname );
+    Buffer().swap( buf );
+  } );
+
+  //Everyone loads the snapshot of their node:
+  bcastString( dirname, 0, nodecomm );
+  collectiveStep( comm, true, [&]() { NC::loadSnapshot( dirname ); } );
+  return dirname;
+}
@@ -73,14 +73,16 @@ _minpyversion=(3,6,0)
 if pyversion < _minpyversion:
     raise SystemExit('Unsupported python version %i.%i.%i detected (needs %i.%i.%i or later).'%(pyversion+_minpyversion))
 
+#NB: To keep "import NCrystal" fast, modules which are slow to import and not
+#needed by all code (in particular numpy, but also pathlib and json) are only
+#imported when needed, and the NCrystal library itself is only loaded when
+#first used (see _rawfct below):
 import numbers
-import pathlib
 import os
 import copy
 import ctypes
 import weakref
 import enum
-import json
 import collections
 
 ###################################
@@ -139,6 +141,7 @@ _k4PiSq     = 39.4784176043574344753379639995046045412547976
 standard_comp_types = ('coh_elas','incoh_elas','inelas','sans')#for client code checking all types of components.
 
 def _find_nclib():
+    import pathlib
 
     #If NCRYSTAL_LIB env var is set, we try that and only that:
     override=os.environ.get('NCRYSTAL_LIB',None)
@@ -170,10 +173,30 @@ def _find_nclib():
                              +' NCRYSTAL_LIB to point at the compiled NCrystal library.')
     return _.resolve()
 
-try:
-    import numpy as _np
-except ImportError:
-    _np = None
+class _LazyNumpy:
+    """Stand-in for the numpy module, which is imported on first attribute
+    access. Evaluates to False in a boolean context if numpy is absent."""
+    __slots__ = ('_mod','_tried')
+    def __init__(self):
+        self._mod, self._tried = None, False
+    def _get(self):
+        if not self._tried:
+            self._tried = True
+            try:
+                import numpy
+                self._mod = numpy
+            except ImportError:
+                pass
+        return self._mod
+    def __bool__(self):
+        return self._get() is not None
+    def __getattr__(self,name):
+        m = self._get()
+        if m is None:
+            _ensure_numpy()
+        return getattr(m,name)
+
+_np = _LazyNumpy()
 def _ensure_numpy():
     if not _np:
         raise NCException("Numpy not available - array based functionality is unavailable")
@@ -272,9 +295,15 @@ def _load(nclib_filename):
 
     def _wrap(fct_name,restype,argtypes,take_ref = False, hide=False, error_check=True):
         assert isinstance(argtypes,tuple)
-        raw=getattr(_nclib,fct_name)
-        raw.argtypes=argtypes
-        raw.restype=restype
+        #The C function is only looked up (and its signature declared) when
+        #first called, after which this stub is replaced by it:
+        def raw(*args):
+            nonlocal raw
+            r = getattr(_nclib,fct_name)
+            r.argtypes=argtypes
+            r.restype=restype
+            raw = r
+            return r(*args)
 
         if take_ref:
             assert len(argtypes)==1
@@ -324,6 +353,7 @@ def _load(nclib_filename):
     _wrap('ncrystal_ekin2wl',_dbl,(_dbl,))
     _wrap('ncrystal_wl2ekin',_dbl,(_dbl,))
     _wrap('ncrystal_isnonoriented',_int,(ncrystal_process_t,))
+    _wrap('ncrystal_isstateless',_int,(ncrystal_process_t,))
     _wrap('ncrystal_name',_cstr,(ncrystal_process_t,))
 
     _wrap('ncrystal_debyetemp2msd',_dbl,(_dbl,_dbl,_dbl))
@@ -372,6 +402,7 @@ def _load(nclib_filename):
     functions['ncrystal_info_getstructure'] = ncrystal_info_getstructure
 
     _wrap('ncrystal_info_nphases',_int,(ncrystal_info_t,))
+    _wrap('ncrystal_info_memoryfootprint',_dbl,(ncrystal_info_t,))
     _wrap('ncrystal_info_getphase',ncrystal_info_t,(ncrystal_info_t,_int,_dblp))
 
     _wrap('ncrystal_info_nhkl',_int,(ncrystal_info_t,))
@@ -381,10 +412,62 @@ def _load(nclib_filename):
     _wrap('ncrystal_info_hklinfotype',_int,(ncrystal_info_t,))
     _wrap('ncrystal_info_gethkl',None,(ncrystal_info_t,_int,_intp,_intp,_intp,_intp,_dblp,_dblp))
     _wrap('ncrystal_info_dspacing_from_hkl',_dbl,(ncrystal_info_t,_int,_int,_int))
+    _wrap('ncrystal_info_findhkl',_int,(ncrystal_info_t,_int,_int,_int))
     functions['ncrystal_info_gethkl_setuppars'] = lambda : (_int(),_int(),_int(),_int(),_dbl(),_dbl())
 
     _raw_gethkl_allindices = _wrap('ncrystal_info_gethkl_allindices',None,(ncrystal_info_t,_int,_intp,_intp,_intp), hide=True )
+    _raw_gethkl_many = _wrap('ncrystal_info_gethkl_many',None,(ncrystal_info_t,_int,_int,_intp,_intp,_intp,_intp,_dblp,_dblp), hide=True )
+    _raw_gethkl_allindices_many = _wrap('ncrystal_info_gethkl_allindices_many',None,(ncrystal_info_t,_int,_int,_intp,_intp,_intp), hide=True )
+    def get_hkllist_arrays(nfo,all_indices=False):
+        nhkl = int(functions['ncrystal_info_nhkl'](nfo))
+        h, hptr = _create_numpy_int_array( nhkl )
+        k, kptr = _create_numpy_int_array( nhkl )
+        l, lptr = _create_numpy_int_array( nhkl )
+        mult, multptr = _create_numpy_int_array( nhkl )
+        dsp, dspptr = _create_numpy_double_array( nhkl )
+        fsq, fsqptr = _create_numpy_double_array( nhkl )
+        _raw_gethkl_many(nfo,0,nhkl,hptr,kptr,lptr,multptr,dspptr,fsqptr)
+        if all_indices:
+            nc_assert( not _np.any( mult % 2 ) )
+            offsets = _np.cumsum( mult // 2 )
+            ntot = int(offsets[-1]) if nhkl else 0
+            hall, hallptr = _create_numpy_int_array( ntot )
+            kall, kallptr = _create_numpy_int_array( ntot )
+            lall, lallptr = _create_numpy_int_array( ntot )
+            _raw_gethkl_allindices_many(nfo,0,nhkl,hallptr,kallptr,lallptr)
+            #Views into the concatenated arrays, one per entry:
+            h, k, l = ( ( _np.split( a, offsets[:-1] ) if nhkl else [] ) for a in (hall,kall,lall) )
+        return h,k,l,mult,dsp,fsq
+    functions['get_hkllist_arrays']=get_hkllist_arrays
+
+    _raw_dspacing_from_hkl_many = _wrap('ncrystal_info_dspacing_from_hkl_many',None,(ncrystal_info_t,_ulong,_intp,_intp,_intp,_dblp), hide=True )
+    _raw_findhkl_many = _wrap('ncrystal_info_findhkl_many',None,(ncrystal_info_t,_ulong,_intp,_intp,_intp,_intp), hide=True )
+    def _hkl_arrays(h,k,l):
+        _ensure_numpy()
+        return tuple( _np.ascontiguousarray(a,dtype=_int).reshape(-1) for a in _np.broadcast_arrays(h,k,l) )
+    def info_dspacing_from_hkl_many(nfo,h,k,l):
+        h,k,l = _hkl_arrays(h,k,l)
+        res, resptr = _create_numpy_double_array( h.size )
+        _raw_dspacing_from_hkl_many(nfo,h.size,ndarray_to_intp(h),ndarray_to_intp(k),ndarray_to_intp(l),resptr)
+        return res
+    def info_findhkl_many(nfo,h,k,l):
+        h,k,l = _hkl_arrays(h,k,l)
+        res, resptr = _create_numpy_int_array( h.size )
+        _raw_findhkl_many(nfo,h.size,ndarray_to_intp(h),ndarray_to_intp(k),ndarray_to_intp(l),resptr)
+        return res
+    functions['info_dspacing_from_hkl_many']=info_dspacing_from_hkl_many
+    functions['info_findhkl_many']=info_findhkl_many
+
     def iter_hkllist(nfo,all_indices=False):
+        if _np:
+            #Extract everything in a single call:
+            h,k,l,mult,dsp,fsq = get_hkllist_arrays(nfo,all_indices=all_indices)
+            for idx in range(len(mult)):
+                if not all_indices:
+                    yield int(h[idx]),int(k[idx]),int(l[idx]),int(mult[idx]),float(dsp[idx]),float(fsq[idx])
+                else:
+                    yield h[idx],k[idx],l[idx],int(mult[idx]),float(dsp[idx]),float(fsq[idx])
+            return
         h,k,l,mult,dsp,fsq = _int(),_int(),_int(),_int(),_dbl(),_dbl()
         nhkl = int(functions['ncrystal_info_nhkl'](nfo))
         for idx in range(nhkl):
@@ -405,6 +488,9 @@ def _load(nclib_filename):
     _raw_di_base = _wrap('ncrystal_dyninfo_base',None,(ncrystal_info_t,_uint,_dblp,_uintp,_dblp,_uintp),hide=True)
     _raw_di_scatknl = _wrap('ncrystal_dyninfo_extract_scatknl',None,(ncrystal_info_t,_uint,_uint,_dblp,_uintp,_uintp,_uintp,
                                                                      _dblpp,_dblpp,_dblpp,_dblpp),hide=True)
+    _raw_di_scatknl_ref = _wrap('ncrystal_dyninfo_extract_scatknl_ref',None,(ncrystal_info_t,_uint,_uint,_dblp,_uintp,_uintp,_uintp,
+                                                                             _dblpp,_dblpp,_dblpp,_dblpp,ctypes.POINTER(_voidp)),hide=True)
+    _raw_release_scatknl = _wrap('ncrystal_release_scatknl',None,(_voidp,),hide=True,error_check=False)
     _raw_di_vdos = _wrap('ncrystal_dyninfo_extract_vdos',None,(ncrystal_info_t,_uint,_dblp,_dblp,_uintp,_dblpp),hide=True)
     _raw_di_vdosdebye = _wrap('ncrystal_dyninfo_extract_vdosdebye',None,(ncrystal_info_t,_uint,_dblp),hide=True)
     _raw_di_vdos_input = _wrap('ncrystal_dyninfo_extract_vdos_input',None,(ncrystal_info_t,_uint,_uintp,_dblpp,_uintp,_dblpp),hide=True)
@@ -420,6 +506,21 @@ def _load(nclib_filename):
         _raw_di_scatknl(infoobj,dynidx,vdoslux,sugEmax,ne,na,nb,
                         ctypes.byref(e),ctypes.byref(a),ctypes.byref(b),ctypes.byref(sab))
         return (sugEmax.value,ne.value,na.value,nb.value,e,a,b,sab)
+    class _ScatKnlRef:
+        #Owns a reference to a kernel in the C++ code, released when garbage
+        #collected (i.e. when no views of the kernel remain):
+        def __init__(self,ref):
+            self._ref, self._release = ref, _raw_release_scatknl
+        def __del__(self):
+            if self._ref:
+                self._release(self._ref)
+                self._ref = None
+    def ncrystal_dyninfo_extract_scatknl_ref(key,vdoslux):
+        infoobj,dynidx = key
+        sugEmax,ne,na,nb,e,a,b,sab,ref = _dbl(),_uint(),_uint(),_uint(),_dblp(),_dblp(),_dblp(),_dblp(),_voidp()
+        _raw_di_scatknl_ref(infoobj,dynidx,vdoslux,sugEmax,ne,na,nb,
+                            ctypes.byref(e),ctypes.byref(a),ctypes.byref(b),ctypes.byref(sab),ctypes.byref(ref))
+        return (sugEmax.value,ne.value,na.value,nb.value,e,a,b,sab,_ScatKnlRef(ref.value))
     def ncrystal_dyninfo_extract_vdos(key):
         infoobj,dynidx = key
         egrid_min,egrid_max,ndensity,densityptr = _dbl(),_dbl(),_uint(),_dblp()
@@ -437,10 +538,31 @@ def _load(nclib_filename):
         return (negrid.value,egridptr,ndensity.value,densityptr)
     functions['ncrystal_dyninfo_base'] = ncrystal_dyninfo_base
     functions['ncrystal_dyninfo_extract_scatknl'] = ncrystal_dyninfo_extract_scatknl
+    functions['ncrystal_dyninfo_extract_scatknl_ref'] = ncrystal_dyninfo_extract_scatknl_ref
     functions['ncrystal_dyninfo_extract_vdos'] = ncrystal_dyninfo_extract_vdos
     functions['ncrystal_dyninfo_extract_vdosdebye'] = ncrystal_dyninfo_extract_vdosdebye
     functions['ncrystal_dyninfo_extract_vdos_input'] = ncrystal_dyninfo_extract_vdos_input
 
+    _raw_di_ddxs = _wrap('ncrystal_dyninfo_ddxs',None,(ncrystal_info_t,_uint,_uint,_ulong,_dblp,_dblp,_dblp,_dblp),hide=True)
+    _raw_di_sample_fixedekin = _wrap('ncrystal_dyninfo_sample_fixedekin',None,(ncrystal_info_t,_uint,_uint,_dbl,_uint,_ulong,
+                                                                               _ulong,_dblp,_dblp,_dblp),hide=True)
+    def ncrystal_dyninfo_ddxs(key,vdoslux,ekin,eprime,mu):
+        _ensure_numpy()
+        infoobj,dynidx = key
+        e,ep,m = ( _np.ascontiguousarray(a,dtype=_dbl) for a in _np.broadcast_arrays(ekin,eprime,mu) )
+        res, res_ct = _create_numpy_double_array(e.size)
+        _raw_di_ddxs(infoobj,dynidx,vdoslux,e.size,ndarray_to_dblp(e),ndarray_to_dblp(ep),ndarray_to_dblp(m),res_ct)
+        return res.reshape(e.shape)
+    def ncrystal_dyninfo_sample_fixedekin(key,vdoslux,ekin,nmu,n,seed):
+        infoobj,dynidx = key
+        xs = _dbl()
+        de, de_ct = _create_numpy_double_array(n)
+        mu, mu_ct = _create_numpy_double_array(n)
+        _raw_di_sample_fixedekin(infoobj,dynidx,vdoslux,ekin,nmu,n,seed,xs,de_ct,mu_ct)
+        return xs.value,de,mu
+    functions['ncrystal_dyninfo_ddxs'] = ncrystal_dyninfo_ddxs
+    functions['ncrystal_dyninfo_sample_fixedekin'] = ncrystal_dyninfo_sample_fixedekin
+
     _raw_vdoseval = _wrap('ncrystal_vdoseval',None,(_dbl,_dbl,_uint,_dblp,_dbl,_dbl,_dblp,_dblp,_dblp,_dblp,_dblp),hide=True)
     def nc_vdoseval(emin,emax,density,temp,mass_amu):
         msd,dt,g0,teff,oint=_dbl(),_dbl(),_dbl(),_dbl(),_dbl()
@@ -457,6 +579,15 @@ def _load(nclib_filename):
         return aidx.value,fraction.value
     functions['ncrystal_info_getcomp']=ncrystal_info_getcomp
 
+    _wrap('ncrystal_info_nflatcomponents',_uint,(ncrystal_info_t,))
+    _raw_info_getflatcomps=_wrap('ncrystal_info_getflatcomponents',None,(ncrystal_info_t,_uintp,_uintp,_dblp),hide=True)
+    def ncrystal_info_getflatcomps(nfo):
+        n = int(functions['ncrystal_info_nflatcomponents'](nfo))
+        Z, A, fr = (_uint*n)(), (_uint*n)(), (_dbl*n)()
+        _raw_info_getflatcomps(nfo,Z,A,fr)
+        return [ (int(Z[i]),int(A[i]),float(fr[i])) for i in range(n) ]
+    functions['ncrystal_info_getflatcomps']=ncrystal_info_getflatcomps
+
     _wrap('ncrystal_create_atomdata',ncrystal_atomdata_t,(ncrystal_info_t,_uint))
     _raw_atomdata_subcomp = _wrap('ncrystal_create_atomdata_subcomp',ncrystal_atomdata_t,
                                   (ncrystal_atomdata_t,_uint,_dblp),hide=True)
@@ -511,15 +642,50 @@ def _load(nclib_filename):
     functions['ncrystal_register_in_mem_file_data']=ncrystal_register_in_mem_file_data
 
     def _prepare_many(ekin,repeat):
-        if _np is None and not repeat is None:
+        if not repeat is None and not _np:
             raise NCBadInput('Can not use "repeat" parameter when Numpy is absent on the system')
         if repeat is None and not hasattr(ekin,'__len__'):
             return None#scalar case, array interface not triggered
         repeat = 1 if repeat is None else repeat
-        ekin = (ekin if hasattr(ekin,'ctypes') else _np.asfarray(ekin) ) if hasattr(ekin,'__len__') else _np.ones(1)*ekin
+        #NB: Numpy arrays are only passed on directly when they are already
+        #contiguous arrays of doubles (otherwise a converted copy is used):
+        ekin = _np.ascontiguousarray(ekin,dtype=_dbl) if hasattr(ekin,'__len__') else _np.ones(1)*ekin
         #NB: returning the ekin object itself is important in order to keep a reference to it after the call:
         return ndarray_to_dblp(ekin),len(ekin),repeat,ekin
 
+    def _prepare_many_withdirs(ekin,direction,repeat):
+        #Like _prepare_many, but also accept either a single direction or an
+        #array of directions with shape (n,3), in which case ekin can be a
+        #scalar or an array of length n. Returns None if the array interface is
+        #not triggered, otherwise the ekin array and the three direction
+        #component arrays (all contiguous arrays of doubles, with any repeat
+        #already applied):
+        _is_multidir = hasattr(direction,'__len__') and len(direction)>0 and hasattr(direction[0],'__len__')
+        if repeat is None and not _is_multidir and not hasattr(ekin,'__len__'):
+            return None#scalar case, array interface not triggered
+        _ensure_numpy()
+        d = _np.asarray(direction,dtype=_dbl)
+        if d.ndim == 1:
+            d = d.reshape((1,3)) if d.shape==(3,) else None
+        elif d.ndim != 2 or d.shape[1] != 3:
+            d = None
+        if d is None:
+            raise NCBadInput('Invalid direction parameter (must be a single (ux,uy,uz) direction or an array of shape (n,3))')
+        e = _np.ascontiguousarray(ekin,dtype=_dbl).reshape(-1)
+        n = max(len(e),len(d))
+        if len(e) not in (1,n) or len(d) not in (1,n):
+            raise NCBadInput('Inconsistent lengths of ekin and direction arrays')
+        e = _np.broadcast_to(e,(n,))
+        d = _np.broadcast_to(d,(n,3))
+        repeat = 1 if repeat is None else repeat
+        if repeat != 1:
+            e = _np.tile(e,repeat)
+            d = _np.tile(d,(repeat,1))
+        return ( _np.ascontiguousarray(e),
+                 _np.ascontiguousarray(d[:,0]),
+                 _np.ascontiguousarray(d[:,1]),
+                 _np.ascontiguousarray(d[:,2]) )
+
     _raw_xs_no = _wrap('ncrystal_crosssection_nonoriented',None,(ncrystal_process_t,_dbl,_dblp),hide=True)
     _raw_xs_no_many = _wrap('ncrystal_crosssection_nonoriented_many',None,(ncrystal_process_t,_dblp,_ulong,
                                                                            _ulong,_dblp),hide=True)
@@ -543,12 +709,22 @@ def _load(nclib_filename):
         return (a.value,b.value)
     functions['ncrystal_domain'] = ncrystal_domain
 
+    _wrap('ncrystal_warmup',None,(ncrystal_process_t,_dbl,_dbl,_int))
+
+    _raw_analytic_oov = _wrap('ncrystal_analytic_oov_coefficient',_int,(ncrystal_process_t,_dblp),hide=True)
+    def ncrystal_analytic_oov_coefficient(proc):
+        c = _dbl()
+        return c.value if _raw_analytic_oov(proc,c) else None
+    functions['ncrystal_analytic_oov_coefficient'] = ncrystal_analytic_oov_coefficient
+
     _raw_samplesct_iso =_wrap('ncrystal_samplescatterisotropic',None,(ncrystal_scatter_t,_dbl,_dblp,_dblp),hide=True)
     _raw_samplesct_iso_many =_wrap('ncrystal_samplescatterisotropic_many',None,
                                    (ncrystal_scatter_t,_dblp,_ulong,_ulong,_dblp,_dblp),hide=True)
     _raw_samplescat = _wrap('ncrystal_samplescatter',None,( ncrystal_scatter_t, _dbl,_dbl*3,_dblp,_dbl*3),hide=True)
     _raw_samplescat_many = _wrap('ncrystal_samplescatter_many',None,( ncrystal_scatter_t,_dbl,_dbl*3,_ulong,
                                                                       _dblp,_dblp,_dblp,_dblp),hide=True)
+    _raw_samplescat_soa = _wrap('ncrystal_samplescatter_soa',None,( ncrystal_scatter_t,_ulong,_dblp,_dblp,_dblp,_dblp,
+                                                                    _dblp,_dblp,_dblp,_dblp),hide=True)
     def ncrystal_samplesct_iso(scat,ekin,repeat=None):
         many = _prepare_many(ekin,repeat)
         if many is None:
@@ -564,6 +740,17 @@ def _load(nclib_filename):
     functions['ncrystal_samplesct_iso'] = ncrystal_samplesct_iso
 
     def ncrystal_samplesct(scat, ekin, direction, repeat):
+        if hasattr(ekin,'__len__') or ( hasattr(direction,'__len__') and len(direction)>0
+                                         and hasattr(direction[0],'__len__') ):
+            e,ux,uy,uz = _prepare_many_withdirs(ekin,direction,repeat)
+            n = len(e)
+            res_ekin, res_ekin_ct = _create_numpy_double_array(n)
+            res_ux, res_ux_ct = _create_numpy_double_array(n)
+            res_uy, res_uy_ct = _create_numpy_double_array(n)
+            res_uz, res_uz_ct = _create_numpy_double_array(n)
+            _raw_samplescat_soa(scat,n,ndarray_to_dblp(e),ndarray_to_dblp(ux),ndarray_to_dblp(uy),ndarray_to_dblp(uz),
+                                res_ekin_ct,res_ux_ct,res_uy_ct,res_uz_ct)
+            return res_ekin,(res_ux,res_uy,res_uz)
         cdir = (_dbl * 3)(*direction)
         if not repeat:
             res_dir = (_dbl * 3)(0,0,0)
@@ -580,20 +767,123 @@ def _load(nclib_filename):
             return res_ekin,(res_ux,res_uy,res_uz)
     functions['ncrystal_samplesct']=ncrystal_samplesct
 
-    _raw_xs = _wrap('ncrystal_crosssection',None,(ncrystal_process_t,_dbl,_dbl*3,_dblp),hide=True)
-    def ncrystal_crosssection( proc, ekin, direction):
-        res = _dbl()
+    _raw_xsect_samplescat = _wrap('ncrystal_crosssection_and_samplescatter',None,( ncrystal_scatter_t, _dbl,_dbl*3,_dblp,_dblp,_dbl*3),hide=True)
+    def ncrystal_xsect_samplesct(scat, ekin, direction):
         cdir = (_dbl * 3)(*direction)
-        if hasattr(ekin,'__len__'):
-            #Todo: this vectorises on the Python side which is slow!
-            _ensure_numpy()
-            def e2xs(e):
-                _raw_xs(proc,e,cdir,res)
-                return res.value
-            return _np.vectorize(e2xs)(ekin)
-        else:
+        res_xs, res_ekin, res_dir = _dbl(), _dbl(), (_dbl * 3)(0,0,0)
+        _raw_xsect_samplescat(scat,ekin,cdir,res_xs,res_ekin,res_dir)
+        return res_xs.value,res_ekin.value,(res_dir[0],res_dir[1],res_dir[2])
+    functions['ncrystal_xsect_samplesct']=ncrystal_xsect_samplesct
+
+    _raw_samplescat_soa_mt = _wrap('ncrystal_samplescatter_soa_mt',None,( ncrystal_scatter_t,_uint,_ulong,_ulong,
+                                                                          _dblp,_dblp,_dblp,_dblp,
+                                                                          _dblp,_dblp,_dblp,_dblp),hide=True)
+    def ncrystal_samplesct_mt(scat, ekin, direction, nthreads, rngstreamidx_offset):
+        e,ux,uy,uz = _prepare_many_withdirs(ekin,direction,1)
+        n = len(e)
+        res_ekin, res_ekin_ct = _create_numpy_double_array(n)
+        res_ux, res_ux_ct = _create_numpy_double_array(n)
+        res_uy, res_uy_ct = _create_numpy_double_array(n)
+        res_uz, res_uz_ct = _create_numpy_double_array(n)
+        _raw_samplescat_soa_mt(scat,nthreads,rngstreamidx_offset,n,
+                               ndarray_to_dblp(e),ndarray_to_dblp(ux),ndarray_to_dblp(uy),ndarray_to_dblp(uz),
+                               res_ekin_ct,res_ux_ct,res_uy_ct,res_uz_ct)
+        return res_ekin,(res_ux,res_uy,res_uz)
+    functions['ncrystal_samplesct_mt']=ncrystal_samplesct_mt
+
+    _raw_samplescat_soa_byidx = _wrap('ncrystal_samplescatter_soa_byidx',None,( ncrystal_scatter_t,_uint,_ulong,_ulong,_ulong,
+                                                                                _dblp,_dblp,_dblp,_dblp,
+                                                                                _dblp,_dblp,_dblp,_dblp),hide=True)
+    def ncrystal_samplesct_byidx(scat, ekin, direction, nthreads, seed, neutronid_offset):
+        e,ux,uy,uz = _prepare_many_withdirs(ekin,direction,1)
+        n = len(e)
+        res_ekin, res_ekin_ct = _create_numpy_double_array(n)
+        res_ux, res_ux_ct = _create_numpy_double_array(n)
+        res_uy, res_uy_ct = _create_numpy_double_array(n)
+        res_uz, res_uz_ct = _create_numpy_double_array(n)
+        _raw_samplescat_soa_byidx(scat,nthreads,seed,neutronid_offset,n,
+                                  ndarray_to_dblp(e),ndarray_to_dblp(ux),ndarray_to_dblp(uy),ndarray_to_dblp(uz),
+                                  res_ekin_ct,res_ux_ct,res_uy_ct,res_uz_ct)
+        return res_ekin,(res_ux,res_uy,res_uz)
+    functions['ncrystal_samplesct_byidx']=ncrystal_samplesct_byidx
+
+    _raw_minitransport_mt = _wrap('ncrystal_minitransport_mt',None,( ncrystal_scatter_t,ncrystal_absorption_t,_dbl,
+                                                                     _int,_dblp,_int,_uint,_uint,_ulong,_ulong,
+                                                                     _dblp,_dblp,_dblp,_dblp,_dblp,_dblp,_dblp,_dblp,
+                                                                     _uintp,_intp,_uint,_dblp),hide=True)
+    def ncrystal_minitransport_mt(scat,absn,numberdensity,shape,shapeparams,absmode,maxscat,
+                                  nthreads,rngstreamidx_offset,pos,direction,ekin,weight,ntallybins):
+        _ensure_numpy()
+        p = _np.asarray(pos,dtype=_dbl)
+        d = _np.asarray(direction,dtype=_dbl)
+        if p.ndim != 2 or p.shape[1] != 3 or d.shape != p.shape:
+            raise NCBadInput('Invalid pos or direction arrays (must both have shape (n,3))')
+        n = len(p)
+        def _col(a):
+            return _np.array(a,dtype=_dbl,copy=True,order='C')
+        x,y,z = _col(p[:,0]),_col(p[:,1]),_col(p[:,2])
+        ux,uy,uz = _col(d[:,0]),_col(d[:,1]),_col(d[:,2])
+        e = _col(_np.broadcast_to(_np.asarray(ekin,dtype=_dbl),(n,)))
+        w = _col(_np.broadcast_to(_np.asarray(weight,dtype=_dbl),(n,)))
+        sp = _np.zeros(3,dtype=_dbl)
+        sp[:len(shapeparams)] = shapeparams
+        nscat, nscat_ct = _create_numpy_unsigned_array(n)
+        status, status_ct = _create_numpy_int_array(n)
+        tallies, tallies_ct = _create_numpy_double_array(ntallybins+3)
+        _raw_minitransport_mt(scat,absn,numberdensity,shape,ndarray_to_dblp(sp),absmode,maxscat,
+                              nthreads,rngstreamidx_offset,n,
+                              ndarray_to_dblp(x),ndarray_to_dblp(y),ndarray_to_dblp(z),
+                              ndarray_to_dblp(ux),ndarray_to_dblp(uy),ndarray_to_dblp(uz),
+                              ndarray_to_dblp(e),ndarray_to_dblp(w),
+                              nscat_ct,status_ct,ntallybins,tallies_ct)
+        return ( _np.stack((x,y,z),axis=1), _np.stack((ux,uy,uz),axis=1), e, w, nscat, status, tallies )
+    functions['ncrystal_minitransport_mt']=ncrystal_minitransport_mt
+
+    _raw_calc_transmission = _wrap('ncrystal_calc_transmission',None,( ncrystal_info_t,ncrystal_scatter_t,ncrystal_absorption_t,
+                                                                       _ulong,_dblp,_ulong,_dblp,_uint,_dblp),hide=True)
+    def ncrystal_calc_transmission(info,scat,absn,wavelengths,thicknesses,nthreads):
+        _ensure_numpy()
+        wl = _np.ascontiguousarray(wavelengths,dtype=_dbl).reshape(-1)
+        t = _np.ascontiguousarray(thicknesses,dtype=_dbl).reshape(-1)
+        res, res_ct = _create_numpy_double_array(len(wl)*len(t))
+        if absn is None:
+            absn = ncrystal_absorption_t()#internal=NULL, no absorption
+        _raw_calc_transmission(info,scat,absn,len(wl),ndarray_to_dblp(wl),len(t),ndarray_to_dblp(t),nthreads,res_ct)
+        return res.reshape((len(t),len(wl)))
+    functions['ncrystal_calc_transmission']=ncrystal_calc_transmission
+
+    _raw_calc_powder_pattern = _wrap('ncrystal_calc_powder_pattern',None,( ncrystal_scatter_t,_ulong,_dblp,_dblp,
+                                                                           _ulong,_dblp,_uint,_ulong,_uint,
+                                                                           _dblp,_dblp),hide=True)
+    def ncrystal_calc_powder_pattern(scat,ekin,weights,bin_edges,nsamples_background,seed,nthreads):
+        _ensure_numpy()
+        e = _np.ascontiguousarray(ekin,dtype=_dbl).reshape(-1)
+        w = _np.ascontiguousarray(_np.broadcast_to(_np.asarray(weights,dtype=_dbl),e.shape))
+        edges = _np.ascontiguousarray(bin_edges,dtype=_dbl).reshape(-1)
+        if len(edges) < 2:
+            raise NCBadInput('At least two bin edges are needed')
+        nbins = len(edges)-1
+        res_bragg, res_bragg_ct = _create_numpy_double_array(nbins)
+        res_bkgd, res_bkgd_ct = _create_numpy_double_array(nbins)
+        _raw_calc_powder_pattern(scat,len(e),ndarray_to_dblp(e),ndarray_to_dblp(w),
+                                 nbins,ndarray_to_dblp(edges),nsamples_background,seed,nthreads,
+                                 res_bragg_ct,res_bkgd_ct)
+        return res_bragg,res_bkgd
+    functions['ncrystal_calc_powder_pattern']=ncrystal_calc_powder_pattern
+
+    _raw_xs = _wrap('ncrystal_crosssection',None,(ncrystal_process_t,_dbl,_dbl*3,_dblp),hide=True)
+    _raw_xs_soa = _wrap('ncrystal_crosssection_soa',None,(ncrystal_process_t,_ulong,_dblp,_dblp,_dblp,_dblp,_dblp),hide=True)
+    def ncrystal_crosssection( proc, ekin, direction, repeat = None ):
+        many = _prepare_many_withdirs(ekin,direction,repeat)
+        if many is None:
+            res = _dbl()
+            cdir = (_dbl * 3)(*direction)
             _raw_xs(proc,ekin,cdir,res)
             return res.value
+        e,ux,uy,uz = many
+        xs, xs_ct = _create_numpy_double_array(len(e))
+        _raw_xs_soa(proc,len(e),ndarray_to_dblp(e),ndarray_to_dblp(ux),ndarray_to_dblp(uy),ndarray_to_dblp(uz),xs_ct)
+        return xs
     functions['ncrystal_crosssection'] = ncrystal_crosssection
 
     #Obsolete:
@@ -677,6 +967,7 @@ def _load(nclib_filename):
     _wrap('ncrystal_clone_scatter',ncrystal_scatter_t,(ncrystal_scatter_t,))
     _wrap('ncrystal_clone_scatter_rngbyidx',ncrystal_scatter_t,(ncrystal_scatter_t,_ulong))
     _wrap('ncrystal_clone_scatter_rngforcurrentthread',ncrystal_scatter_t,(ncrystal_scatter_t,))
+    _wrap('ncrystal_clone_scatter_dspacingscaled',ncrystal_scatter_t,(ncrystal_scatter_t,_dbl))
     _wrap('ncrystal_decodecfg_vdoslux',_uint,(_cstr,))
     _wrap('ncrystal_has_factory',_int,(_cstr,))
     _wrap('ncrystal_clear_caches',None,tuple())
@@ -704,9 +995,16 @@ def _load(nclib_filename):
 
     _raw_dbg_process = _wrap('ncrystal_dbg_process',_charptr,(ncrystal_process_t,),hide=True)
     def nc_dbg_proc(rawprocobj):
+        import json
         return json.loads( _decode_and_dealloc_raw_str( _raw_dbg_process( rawprocobj ) ) )
     functions['nc_dbg_proc']=nc_dbg_proc
 
+    _raw_factory_stats = _wrap('ncrystal_factory_stats_json',_charptr,tuple(),hide=True)
+    def nc_factory_stats():
+        import json
+        return json.loads( _decode_and_dealloc_raw_str( _raw_factory_stats() ) )
+    functions['nc_factory_stats']=nc_factory_stats
+
     _raw_decodecfg_json = _wrap('ncrystal_decodecfg_json',_charptr,(_cstr,),hide=True)
     def nc_cfgstr2json(cfgstr):
         return _decode_and_dealloc_raw_str( _raw_decodecfg_json(_str2cstr(cfgstr) ) )
@@ -778,6 +1076,25 @@ def _load(nclib_filename):
         return res
     functions['ncrystal_get_pluginlist'] = ncrystal_get_pluginlist
 
+    _raw_createsnapshot = _wrap('ncrystal_create_snapshot',None,(_uint,_cstrp,_cstr),hide=True)
+    def ncrystal_create_snapshot(cfgstrs,dirname):
+        cfgstrs = [_str2cstr(c) for c in cfgstrs]
+        _raw_createsnapshot(len(cfgstrs),(_cstr*len(cfgstrs))(*cfgstrs),_str2cstr(dirname))
+    functions['ncrystal_create_snapshot'] = ncrystal_create_snapshot
+
+    _raw_loadsnapshot = _wrap('ncrystal_load_snapshot',None,(_cstr,_uintp,_cstrpp),hide=True)
+    def ncrystal_load_snapshot(dirname):
+        n,l = _uint(),_cstrp()
+        _raw_loadsnapshot(_str2cstr(dirname),n,ctypes.byref(l))
+        res = [l[i].decode() for i in range(n.value)]
+        if n.value:
+            _raw_deallocstrlist(n,l)
+        return res
+    functions['ncrystal_load_snapshot'] = ncrystal_load_snapshot
+
+    _wrap('ncrystal_export_xstable',None,(_cstr,_cstr,_dbl,_dbl,_dbl))
+    _wrap('ncrystal_load_xstable',ncrystal_scatter_t,(_cstr,))
+
     _wrap('ncrystal_add_custom_search_dir',None,(_cstr,))
     _wrap('ncrystal_remove_custom_search_dirs',None,tuple())
     _wrap('ncrystal_enable_abspaths',None,(_int,))
@@ -787,7 +1104,16 @@ def _load(nclib_filename):
     _wrap('ncrystal_remove_all_data_sources',None,tuple())
     return functions
 
-_rawfct = _load(_find_nclib())
+class _LazyRawFcts(dict):
+    """Dictionary of wrapped C functions, loading the NCrystal library and
+    filling itself on the first lookup."""
+    def __missing__(self,key):
+        if self:
+            raise KeyError(key)
+        self.update(_load(_find_nclib()))
+        return self[key]
+
+_rawfct = _LazyRawFcts()
 
 def decodecfg_packfact(cfgstr):
     """OBSOLETE FUNCTION (always returns 1.0 now)."""
@@ -825,6 +1151,17 @@ class RCBase:
     def refCount(self):
         """Access reference count of wrapped C++ object"""
         return _rawfct['ncrystal_refcount'](self._rawobj)
+    def __reduce__(self):
+        """Info, Scatter and Absorption objects created directly from
+        cfg-strings can be pickled (e.g. for sending them to multiprocessing
+        workers). Only the cfg-string is stored, and the objects are recreated
+        from it when unpickled. If the cfg-string is covered by a snapshot
+        created or loaded in the current process (see createSnapshot), the
+        snapshot is loaded before recreating the object, so workers skip the
+        expensive parts of the initialisation. Note that RNG states are not
+        transferred, so unpickled Scatter objects should normally be cloned
+        with distinct rng_stream_index values in each worker."""
+        return _pickle_reduce(self)
 
 def nc_assert(b,msg=""):
     """Assertion which throws NCLogicError on failure"""
@@ -1028,12 +1365,14 @@ class Info(RCBase):
             rawobj = cfgstr[1]
         else:
             rawobj = _rawfct['ncrystal_create_info'](_str2cstr(cfgstr))
+            self._ncpickle_cfgstr = _cstr2str(_str2cstr(cfgstr))
         super(Info, self).__init__(rawobj)
         self.__dyninfo=None
         self.__atominfo=None
         self.__custom=None
         self.__atomdatas=[]
         self.__comp=None
+        self.__flatcomp=None
         self._som=None
         self._nphases = int(_rawfct['ncrystal_info_nphases'](rawobj))
         assert self._nphases == 0 or self._nphases >= 2
@@ -1112,6 +1451,18 @@ class Info(RCBase):
         return self._initComp() if self.__comp is None else self.__comp
     composition=property(getComposition)
 
+    def getFlatComposition(self):
+        """Get composition flattened into natural elements and isotopes, as list
+        of (Z,A,fraction) tuples sorted by (Z,A), where A=0 for natural
+        elements. Composite atoms (for instance from @ATOMDB sections or in
+        multi-phase materials) are recursively broken down, and each (Z,A)
+        appears just once. The flattening is done once, and cached.
+        """
+        if self.__flatcomp is None:
+            self.__flatcomp = tuple(_rawfct['ncrystal_info_getflatcomps'](self._rawobj))
+        return self.__flatcomp
+    flatcomposition=property(getFlatComposition)
+
     def dump(self,verbose=0):
         """Dump contained information to standard output. Use verbose argument to set
         verbosity level to 0 (minimal), 1 (middle), 2 (most verbose)."""
@@ -1119,6 +1470,11 @@ class Info(RCBase):
         sys.stderr.flush()
         _rawfct['ncrystal_dump_verbose'](self._rawobj,min(999,max(0,int(verbose))))
 
+    def memoryFootprint(self):
+        """Approximate memory footprint in bytes of the underlying C++ object
+        (including any phases)."""
+        return int(_rawfct['ncrystal_info_memoryfootprint'](self._rawobj))
+
     def hasTemperature(self):
         """Whether or not material has a temperature available"""
         return _rawfct['ncrystal_info_gettemperature'](self._rawobj)>-1
@@ -1406,6 +1762,17 @@ class Info(RCBase):
         nc_assert(self.hasHKLInfo())
         return _rawfct['iter_hkllist']( self._rawobj,
                                         all_indices = all_indices )
+    def hklListArrays(self,all_indices=False):
+        """The same information as hklList(), but extracted in a single call and
+        returned as a tuple of numpy arrays (h,k,l,multiplicity,dspacing,fsquared),
+        each with one entry per HKL group. This is much faster for materials
+        with many HKL planes. Running with all_indices=True, h, k, and l will
+        instead be lists of arrays as described for hklList() (all being views
+        into a single array).
+        """
+        nc_assert(self.hasHKLInfo())
+        return _rawfct['get_hkllist_arrays']( self._rawobj,
+                                              all_indices = all_indices )
     def getBraggThreshold(self):
         """Get Bragg threshold in Aa (returns None if non-crystalline). This
         method is meant as a fast way to access the Bragg threshold without
@@ -1426,9 +1793,26 @@ class Info(RCBase):
     def dspacingFromHKL(self, h, k, l):
         """Convenience method, calculating the d-spacing of a given Miller
         index. Calling this incurs the overhead of creating a reciprocal lattice
-        matrix from the structure info."""
+        matrix from the structure info. If h, k and l are arrays, a numpy array
+        with the d-spacings of all the indices is returned (creating the
+        reciprocal lattice matrix just once)."""
+        if any( hasattr(e,'__len__') for e in (h,k,l) ):
+            return _rawfct['info_dspacing_from_hkl_many'](self._rawobj,h,k,l)
         return float(_rawfct['ncrystal_info_dspacing_from_hkl'](self._rawobj,h,k,l))
 
+    def findHKL(self, h, k, l):
+        """Find the entry in the hkl list containing a given Miller index,
+        returning its index in the list (or None if not found). Symmetry
+        equivalent indices are found when the entries can be expanded (see
+        hklList(all_indices=True)), and (-h,-k,-l) always finds
+        the same entry as (h,k,l). A lookup table is built on first usage. If
+        h, k and l are arrays, a numpy array of indices is returned instead
+        (with -1 for indices which are not found)."""
+        if any( hasattr(e,'__len__') for e in (h,k,l) ):
+            return _rawfct['info_findhkl_many'](self._rawobj,h,k,l)
+        idx = int(_rawfct['ncrystal_info_findhkl'](self._rawobj,h,k,l))
+        return idx if idx >= 0 else None
+
     class DynamicInfo:
         """Class representing dynamic information (related to inelastic scattering)
            about a given atom"""
@@ -1487,6 +1871,15 @@ class Info(RCBase):
         def _copy_cptr_2_nparray(self,cptr,n):
             np = self._np()
             return np.copy(np.ctypeslib.as_array(cptr, shape=(n,)))
+        def _view_cptr_as_nparray(self,cptr,n,owner):
+            #Read-only view of the C array, keeping owner alive while needed
+            #(via the ctypes array object referenced by the numpy array):
+            np = self._np()
+            carr = (ctypes.c_double*n).from_address(ctypes.addressof(cptr.contents))
+            carr._nc_owner = owner
+            a = np.frombuffer(carr,dtype=np.float64,count=n)
+            a.flags.writeable = False
+            return a
 
         def __str__(self):
             n=self.__class__.__name__
@@ -1536,6 +1929,47 @@ class Info(RCBase):
             assert self.__lastknl is not None
             return self.__lastknl
 
+        def loadKernelView( self, vdoslux = 3 ):
+            """Like loadKernel, but the arrays are read-only views of the kernel
+               data in the C++ code rather than copies, which avoids copying
+               large kernels. The data is kept alive for as long as any of the
+               views exist. The result is not cached, so keep it around rather
+               than calling this repeatedly.
+            """
+            assert isinstance(vdoslux,numbers.Integral) and 0<=vdoslux<=5
+            sugEmax,ne,na,nb,eptr,aptr,bptr,sabptr,ref = _rawfct['ncrystal_dyninfo_extract_scatknl_ref'](self._key,int(vdoslux))
+            res={}
+            assert ne>=0
+            res['suggestedEmax'] = float(sugEmax)
+            res['egrid'] = self._view_cptr_as_nparray(eptr,ne,ref) if ne > 0 else self._np().zeros(0)
+            assert na>1 and nb>1
+            res['alpha'] = self._view_cptr_as_nparray(aptr,na,ref)
+            res['beta']  = self._view_cptr_as_nparray(bptr,nb,ref)
+            res['sab']   = self._view_cptr_as_nparray(sabptr,na*nb,ref)
+            return res
+
+        def doubleDifferentialCrossSection( self, ekin, eprime, mu, vdoslux = 3 ):
+            """Double differential scattering cross section, d^2sigma/dE'dmu
+               [barn/eV], evaluated directly from the S(alpha,beta) kernel at
+               neutron energies ekin [eV], final energies eprime [eV] and
+               mu=cos(scattering_angle). The arguments are broadcast against
+               each other. No extension of the kernel is applied, so results
+               are only complete well below the suggested Emax of the kernel.
+            """
+            assert isinstance(vdoslux,numbers.Integral) and 0<=vdoslux<=5
+            return _rawfct['ncrystal_dyninfo_ddxs'](self._key,int(vdoslux),ekin,eprime,mu)
+
+        def sampleFixedEnergy( self, ekin, n, seed = 0, nmu = 200, vdoslux = 3 ):
+            """Sample n (delta_ekin,mu) values at the fixed neutron energy ekin
+               [eV], with exact inverse-CDF sampling from a precomputed table
+               of d^2sigma/dE'dmu with nmu equidistant mu bins (rather than
+               the rejection sampling used in normal scattering). Results
+               depend only on the seed. Returns (xs,delta_ekin,mu), where xs
+               is the integrated cross section of the table [barn].
+            """
+            assert isinstance(vdoslux,numbers.Integral) and 0<=vdoslux<=5
+            return _rawfct['ncrystal_dyninfo_sample_fixedekin'](self._key,int(vdoslux),float(ekin),int(nmu),int(n),int(seed))
+
     class DI_ScatKnlDirect(DI_ScatKnl):
         """Pre-calculated scattering kernel which at most needs a (hidden) conversion to
            S(alpha,beta) format before it is available."""
@@ -1569,6 +2003,15 @@ class Info(RCBase):
                 self.__vdosdata = (vdos_egrid,vdos_density)
             return self.__vdosdata
 
+        def vdosDataView(self):
+            """Like vdosData, but vdos_density is a read-only view of the data
+               in the C++ code rather than a copy (keeping the associated Info
+               object alive for as long as the view exists). Not cached."""
+            _info = self._info_wr()
+            nc_assert(_info is not None,"DynamicInfo.vdosDataView can not be used after associated Info object is deleted")
+            emin,emax,nd,dptr = _rawfct['ncrystal_dyninfo_extract_vdos'](self._key)
+            return ( (emin,emax), self._view_cptr_as_nparray(dptr,nd,_info) )
+
         def __loadVDOSOrig(self):
             if self.__vdosorig is None:
                 neg,egptr,nds,dsptr = _rawfct['ncrystal_dyninfo_extract_vdos_input'](self._key)
@@ -1576,6 +2019,16 @@ class Info(RCBase):
                                     self._copy_cptr_2_nparray(dsptr,nds) )
             return self.__vdosorig
 
+        def vdosOrigView(self):
+            """Read-only views (rather than copies) of the original un-regularised
+               VDOS as (egrid,density), keeping the associated Info object alive
+               for as long as the views exist. Not cached."""
+            _info = self._info_wr()
+            nc_assert(_info is not None,"DynamicInfo.vdosOrigView can not be used after associated Info object is deleted")
+            neg,egptr,nds,dsptr = _rawfct['ncrystal_dyninfo_extract_vdos_input'](self._key)
+            return ( self._view_cptr_as_nparray(egptr,neg,_info) if neg else self._np().zeros(0),
+                     self._view_cptr_as_nparray(dsptr,nds,_info) if nds else self._np().zeros(0) )
+
         def vdosOrigEgrid(self):
             """Access the original un-regularised VDOS energy grid"""
             return self.__loadVDOSOrig()[0]
@@ -1739,6 +2192,27 @@ class Process(RCBase):
         """
         return _rawfct['ncrystal_domain'](self._rawobj)
 
+    def warmup(self,ekin_low=0.0,ekin_high=float('inf'),complete=False):
+        """Pre-create lazily initialised structures needed for neutron energies
+        in [ekin_low,ekin_high] (in eV), so subsequent calls do not suffer
+        delays from such initialisation. If complete is True, all energy
+        dependent structures are created (which can take longer), otherwise
+        only the essential ones.
+
+        """
+        _rawfct['ncrystal_warmup'](self._rawobj,ekin_low,ekin_high,1 if complete else 0)
+
+    def analyticOOVCoefficient(self):
+        """Coefficient c [barn*sqrt(eV)] if the cross section has pure 1/v scaling.
+
+        In that case, xs(ekin)=c/sqrt(ekin) can be evaluated directly by the
+        caller (e.g. numpy arrays of energies can be handled without calling
+        into NCrystal). Returns None for processes without such an analytic
+        form.
+
+        """
+        return _rawfct['ncrystal_analytic_oov_coefficient'](self._rawobj)
+
     def isNull(self):
         """Domain might indicate that this is a null-process, vanishing everywhere."""
         elow,ehigh = self.domain()
@@ -1752,9 +2226,21 @@ class Process(RCBase):
     def isOriented(self):
         """Check if process is oriented and results depend on the incident direction of the neutron"""
         return not self.isNonOriented()
-    def crossSection( self, ekin, direction ):
-        """Access cross sections."""
-        return _rawfct['ncrystal_crosssection'](self._rawobj,ekin, direction)
+    def isStateless(self):
+        """Check if process never uses a cache (for information only)"""
+        return bool(_rawfct['ncrystal_isstateless'](self._rawobj))
+    def crossSection( self, ekin, direction, repeat = None ):
+        """Access cross sections.
+
+        For efficiency it is possible to provide the ekin parameter as a numpy
+        array of numbers and/or the direction parameter as an array of
+        directions with shape (n,3), and get a corresponding array of cross
+        sections back. Likewise, the repeat parameter can be set to a positive
+        number, causing the ekin value(s) and direction(s) to be reused that
+        many times and a numpy array with results returned.
+
+        """
+        return _rawfct['ncrystal_crosssection'](self._rawobj,ekin, direction, repeat)
     def crossSectionIsotropic( self, ekin, repeat = None ):
         """Access cross sections (should not be called for oriented processes).
 
@@ -1774,17 +2260,13 @@ class Process(RCBase):
         """Convenience function which redirects calls to either crossSectionIsotropic
         or crossSection depending on whether or not a direction is given. It can
         also accept wavelengths instead of kinetic energies via the wl
-        parameter. The repeat parameter is currently only supported when
-        direction is not provided.
+        parameter.
         """
         ekin = Process._parseekin( ekin, wl )
         if direction is None:
             return self.crossSectionIsotropic( ekin, repeat )
         else:
-            if repeat is None:
-                return self.crossSection( ekin, direction )
-            else:
-                raise NCBadInput('The repeat parameter is not currently supported when the direction parameter is also provided.')
+            return self.crossSection( ekin, direction, repeat )
 
     @staticmethod
     def _parseekin(ekin,wl):
@@ -1835,6 +2317,11 @@ class Process(RCBase):
         """
         print(prefix+f'\n{prefix}'.join(self.getSummary(short='printable')))
 
+    def memoryFootprint(self):
+        """Approximate memory footprint in bytes of the underlying C++ process
+        object (including any sub-components)."""
+        return int(_rawfct['nc_dbg_proc'](self._rawobj)['memoryFootprint'])
+
 class Absorption(Process):
     """Base class for calculations of absorption in materials"""
 
@@ -1845,6 +2332,7 @@ class Absorption(Process):
             rawobj_abs = cfgstr[1]
         else:
             rawobj_abs = _rawfct['ncrystal_create_absorption'](_str2cstr(cfgstr))
+            self._ncpickle_cfgstr = _cstr2str(_str2cstr(cfgstr))
         self._rawobj_abs = rawobj_abs
         rawobj_proc = _rawfct['ncrystal_cast_abs2proc'](rawobj_abs)
         super(Absorption, self).__init__(rawobj_proc)
@@ -1875,6 +2363,7 @@ class Scatter(Process):
             self._rawobj_scat = cfgstr[1]
         else:
             self._rawobj_scat = _rawfct['ncrystal_create_scatter'](_str2cstr(cfgstr))
+            self._ncpickle_cfgstr = _cstr2str(_str2cstr(cfgstr))
         rawobj_proc = _rawfct['ncrystal_cast_scat2proc'](self._rawobj_scat)
         super(Scatter, self).__init__(rawobj_proc)
 
@@ -1915,6 +2404,16 @@ class Scatter(Process):
             newrawobj = _rawfct['ncrystal_clone_scatter'](self._rawobj_scat)
         return Scatter( ('_rawobj_',newrawobj) )
 
+    def cloneWithDSpacingScale(self,dspacing_scale):
+        """Clone object, with all powder Bragg diffraction components adjusted to
+        a lattice whose d-spacings are all scaled by dspacing_scale (isotropic
+        strain). This is cheap, since no plane tables are rebuilt, and is
+        intended for e.g. Bragg-edge strain mapping with one clone per
+        pixel. Other components (and number densities) are not affected.
+        """
+        newrawobj = _rawfct['ncrystal_clone_scatter_dspacingscaled'](self._rawobj_scat,float(dspacing_scale))
+        return Scatter( ('_rawobj_',newrawobj) )
+
     def sampleScatter( self, ekin, direction, repeat = None ):
         """Randomly generate scatterings.
 
@@ -1923,11 +2422,61 @@ class Scatter(Process):
         tuple(ekin_final,direction_final) where direct_final is itself a tuple
         (ux,uy,uz). The repeat parameter can be set to a positive number,
         causing the scattering to be sampled that many times and numpy arrays
-        with results returned.
+        with results returned. For efficiency it is also possible to provide
+        the ekin parameter as a numpy array of numbers and/or the direction
+        parameter as an array of directions with shape (n,3), in which case
+        numpy arrays with results for all neutrons are returned.
 
         """
         return _rawfct['ncrystal_samplesct'](self._rawobj_scat,ekin,direction,repeat)
 
+    def crossSectionAndSampleScatter( self, ekin, direction ):
+        """Get cross section and randomly generate a scattering in a single call.
+
+        Equivalent to calling crossSection(ekin,direction) followed by
+        sampleScatter(ekin,direction), but more efficient. Returns
+        tuple(xsect,ekin_final,direction_final) where direction_final is
+        itself a tuple (ux,uy,uz).
+
+        """
+        return _rawfct['ncrystal_xsect_samplesct'](self._rawobj_scat,ekin,direction)
+
+    def sampleScatterMany( self, ekin, direction, nthreads = None, rng_stream_index_offset = 0,
+                           seed = None, neutron_id_offset = 0 ):
+        """Randomly generate scatterings for many neutrons, using several threads.
+
+        Like sampleScatter with arrays of energies and/or directions (shape
+        (n,3)), but the sampling is carried out in up to nthreads parallel
+        threads (default: the number of CPU cores). The neutrons are handled in
+        fixed chunks of 4096, with chunk k using the RNG stream given by
+        rng_stream_index_offset+k (see the clone method), so the results do
+        not depend on the number of threads. Note that RNG streams with a given
+        index keep their state, so repeated calls continue the random sequences
+        rather than repeating them.
+
+        Alternatively, if a seed is provided, neutron i is sampled with its own
+        stream of the builtin counter-based RNG, given by the seed and the
+        neutron index neutron_id_offset+i. The results for a given neutron are
+        then bit-identical regardless of the number of threads and of how the
+        neutrons are split over calls (rng_stream_index_offset is not used).
+
+        """
+        if nthreads is None:
+            nthreads = os.cpu_count() or 1
+        if not isinstance(nthreads, numbers.Integral) or not 1 <= nthreads <= 4096:
+            raise NCBadInput('Scatter.sampleScatterMany(..): nthreads must be integral and in range [1,4096]')
+        if ( not isinstance(rng_stream_index_offset, numbers.Integral)
+             or not 0 <= rng_stream_index_offset <= 4294967295 ):
+            raise NCBadInput('Scatter.sampleScatterMany(..): rng_stream_index_offset must be integral and in range [0,4294967295]')
+        if seed is not None:
+            for v,vn in ((seed,'seed'),(neutron_id_offset,'neutron_id_offset')):
+                if not isinstance(v, numbers.Integral) or not 0 <= v <= 4294967295:
+                    raise NCBadInput('Scatter.sampleScatterMany(..): %s must be integral and in range [0,4294967295]'%vn)
+            return _rawfct['ncrystal_samplesct_byidx'](self._rawobj_scat,ekin,direction,
+                                                       int(nthreads),int(seed),int(neutron_id_offset))
+        return _rawfct['ncrystal_samplesct_mt'](self._rawobj_scat,ekin,direction,
+                                                int(nthreads),int(rng_stream_index_offset))
+
 
     def sampleScatterIsotropic( self, ekin, repeat = None ):
         """Randomly generate scatterings (should not be called for oriented processes).
@@ -2092,42 +2641,46 @@ def registerInMemoryFileData(virtual_filename,data):
        which will instead create a virtual alias for an on-disk file.
     """
     if ( isinstance(data,str) and data.startswith('ondisk://')):
+        import pathlib
         data = 'ondisk://'+str(pathlib.Path(data[9:]).resolve())
     _rawfct['ncrystal_register_in_mem_file_data'](virtual_filename,data)
 
 
 #numpy compatible wl2ekin and ekin2wl
-_c_wl2ekin = float(_rawfct['ncrystal_wl2ekin'](1.0))
-_c_ekin2wl = float(_rawfct['ncrystal_ekin2wl'](1.0))
+#The conversion constants are taken from the library when first needed:
+_c_conv = []
+def _c_convconsts():
+    if not _c_conv:
+        _c_conv.extend( (float(_rawfct['ncrystal_wl2ekin'](1.0)), float(_rawfct['ncrystal_ekin2wl'](1.0))) )
+    return _c_conv
 
 def wl2ekin(wl):
     """Convert neutron wavelength in Angstrom to kinetic energy in electronvolt"""
-    if _np and hasattr(wl,'__len__'):
+    if hasattr(wl,'__len__') and _np:
         #reciprocals without zero division:
         wlnonzero = wl != 0.0
         wlinv = 1.0 / _np.where( wlnonzero, wl, 1.0)#fallback 1.0 wont be used
-        return _c_wl2ekin * _np.square(_np.where( wlnonzero, wlinv, _np.inf))
+        return _c_convconsts()[0] * _np.square(_np.where( wlnonzero, wlinv, _np.inf))
     else:
         return _rawfct['ncrystal_wl2ekin'](wl)
 
 def ekin2wl(ekin):
     """Convert neutron kinetic energy in electronvolt to wavelength in Angstrom"""
-    if _np and hasattr(ekin,'__len__'):
+    if hasattr(ekin,'__len__') and _np:
         #reciprocals without zero division:
         ekinnonzero = ekin != 0.0
         ekininv = 1.0 / _np.where( ekinnonzero, ekin, 1.0)#fallback 1.0 wont be used
-        return _c_ekin2wl * _np.sqrt(_np.where( ekinnonzero, ekininv, _np.inf))
+        return _c_convconsts()[1] * _np.sqrt(_np.where( ekinnonzero, ekininv, _np.inf))
     else:
         return _rawfct['ncrystal_ekin2wl'](ekin)
 
-_const_ekin2ksq_factor = _k4PiSq / _c_wl2ekin
 def ekin2ksq(ekin):
     """Convert neutron kinetic energy in electronvolt to squared wavenumber (k^2) in 1/Angstrom^2"""
-    return _const_ekin2ksq_factor*ekin
+    return ( _k4PiSq / _c_convconsts()[0] ) * ekin
 
 def wl2k(wl):
     """Convert neutron wavelength in Angstrom to wavenumber (k) in 1/Angstrom. This is simply k=2pi/wl"""
-    if _np and hasattr(wl,'__len__'):
+    if hasattr(wl,'__len__') and _np:
         #reciprocals without zero division:
         wlnonzero = ekin != 0.0
         ksafe = _k2Pi / _np.where( wlnonzero, wl, 1.0)#fallback 1.0 wont be used
@@ -2142,6 +2695,179 @@ def wl2ksq(wl):
 def clearCaches():
     """Clear various caches"""
     _rawfct['ncrystal_clear_caches']()
+
+def factoryStats():
+    """Statistics of the internal factory caches, as a list of dictionaries (one
+    per factory, in order of first usage). The "strongRefBytes" and
+    "aliveBytes" entries give the approximate memory footprint in bytes of the
+    objects kept alive by the cache itself, and of all cached objects which
+    are still alive, respectively."""
+    return _rawfct['nc_factory_stats']()
+def createSnapshot(cfgstrs,dirname):
+    """Create material snapshot in the (existing) directory dirname, holding
+    precomputed HKL lists and scattering kernels for the materials described by
+    the cfgstrs (a single cfg-string or a list of them). Note that this clears
+    all caches. See NCFact.hh for more details."""
+    if isinstance(cfgstrs,str):
+        cfgstrs = [cfgstrs]
+    cfgstrs = [str(c) for c in cfgstrs]
+    _rawfct['ncrystal_create_snapshot'](cfgstrs,str(dirname))
+    _snapshots[os.path.abspath(str(dirname))] = set(cfgstrs)
+
+def loadSnapshot(dirname):
+    """Use material snapshot in directory dirname (created with createSnapshot)
+    for the rest of the process. Returns the list of cfg-strings covered by
+    the snapshot."""
+    res = _rawfct['ncrystal_load_snapshot'](str(dirname))
+    global _snapshot_loaded
+    _snapshot_loaded = os.path.abspath(str(dirname))
+    _snapshots[_snapshot_loaded] = set(res)
+    return res
+
+#Snapshots created or loaded in this process (directory -> cfg-strings), used
+#when pickling objects:
+_snapshots = {}
+_snapshot_loaded = None
+
+def _pickle_reduce(obj):
+    cfgstr = getattr(obj,'_ncpickle_cfgstr',None)
+    kind = obj.__class__.__name__
+    if cfgstr is None or kind not in ('Info','Scatter','Absorption'):
+        raise NCBadInput('Only Info, Scatter and Absorption objects created directly from'
+                         ' cfg-strings can be pickled (%s object was not)'%kind)
+    snapshotdir = None
+    if _snapshot_loaded is not None and cfgstr in _snapshots[_snapshot_loaded]:
+        snapshotdir = _snapshot_loaded
+    else:
+        snapshotdir = next((d for d,c in _snapshots.items() if cfgstr in c),None)
+    return (_pickle_recreate, (kind, cfgstr, snapshotdir))
+
+def _pickle_recreate(kind,cfgstr,snapshotdir):
+    if snapshotdir is not None and snapshotdir != _snapshot_loaded and os.path.isdir(snapshotdir):
+        loadSnapshot(snapshotdir)
+    return {'Info':Info,'Scatter':Scatter,'Absorption':Absorption}[kind](cfgstr)
+
+def exportXSTable(cfgstr,filename,tolerance=1e-3,emin=1e-5,emax=10.0):
+    """Tabulate the scattering cross sections of the (non-oriented) material in
+    the energy range [emin,emax] (in eV) to the given relative tolerance, and
+    write them to a compact binary file. The tables can be loaded with
+    loadXSTable. See NCTabulatedXS.hh for more details."""
+    _rawfct['ncrystal_export_xstable'](_str2cstr(cfgstr),_str2cstr(str(filename)),
+                                       float(tolerance),float(emin),float(emax))
+
+def loadXSTable(filename):
+    """Load a file written by exportXSTable, returning a Scatter object with
+    cross sections given by the tables. This is fast, and does not need the
+    data files of the material, unless the object is used for sampling
+    scatterings or for energies outside the tabulated range. In that case the
+    full scatter process is created on demand from the cfg-string stored in
+    the file."""
+    rawobj = _rawfct['ncrystal_load_xstable'](_str2cstr(str(filename)))
+    return Scatter(('_rawobj_',rawobj))
+
+def calcTransmission( info, scatter, wavelengths, thickness, absorption = None, nthreads = None ):
+    """Transmission, T=exp(-n*sigma*t), of neutrons through slabs of a
+    non-oriented material, for the given wavelengths [Aa] and thickness t [m].
+    The number density, n, is taken from the Info object, and sigma is the
+    total cross section of the Scatter object and (optionally) the Absorption
+    object. If thickness is an array of several thicknesses, the result is an
+    array of shape (len(thickness),len(wavelengths)), otherwise it is an array
+    of the same length as wavelengths. Large numbers of wavelengths are
+    processed in up to nthreads parallel threads (default: the number of CPU
+    cores). The cross sections are evaluated only once per wavelength, so
+    evaluating many thicknesses in a single call is cheap."""
+    if nthreads is None:
+        nthreads = os.cpu_count() or 1
+    if not isinstance(nthreads, numbers.Integral) or not 1 <= nthreads <= 4096:
+        raise NCBadInput('calcTransmission(..): nthreads must be integral and in range [1,4096]')
+    absn = absorption._rawobj_abs if absorption is not None else None
+    res = _rawfct['ncrystal_calc_transmission'](info._rawobj,scatter._rawobj_scat,absn,
+                                                wavelengths,thickness,int(nthreads))
+    return res if hasattr(thickness,'__len__') else res[0]
+
+def calcPowderPattern( scatter, ekin, weights, bin_edges, nsamples_background = 0, seed = 0, nthreads = None ):
+    """Calculate the distribution of scattering angles in a non-oriented
+    material, for an incident spectrum given by arrays of neutron energies
+    (eV) and weights, without Monte Carlo sampling of the Bragg diffraction.
+    The bin_edges are the increasing edges of the bins of scattering angle
+    (in radians, within [0,pi]). Returns two arrays, with the sum over the
+    spectrum of weight times the cross section (barn) for scattering into each
+    bin, for powder Bragg diffraction (calculated analytically from the plane
+    lists) and for all other components (the background). The background is
+    estimated by sampling nsamples_background scatterings per incident energy
+    (0 disables it) with RNG streams depending only on the seed, so results
+    are reproducible. Energies are processed in up to nthreads parallel
+    threads (default: the number of CPU cores). See NCPowderPattern.hh for
+    more details.
+    """
+    if nthreads is None:
+        nthreads = os.cpu_count() or 1
+    if not isinstance(nthreads, numbers.Integral) or not 1 <= nthreads <= 4096:
+        raise NCBadInput('calcPowderPattern(..): nthreads must be integral and in range [1,4096]')
+    if not isinstance(nsamples_background, numbers.Integral) or not 0 <= nsamples_background <= 4294967295:
+        raise NCBadInput('calcPowderPattern(..): nsamples_background must be integral and in range [0,4294967295]')
+    if not isinstance(seed, numbers.Integral) or not 0 <= seed <= 4294967295:
+        raise NCBadInput('calcPowderPattern(..): seed must be integral and in range [0,4294967295]')
+    return _rawfct['ncrystal_calc_powder_pattern'](scatter._rawobj_scat,ekin,weights,bin_edges,
+                                                   int(nsamples_background),int(seed),int(nthreads))
+
+def runMiniTransport( cfgstr, geometry, pos, direction, ekin, weight = 1.0, *,
+                      absorption = 'weight', maxscat = 1000, nthreads = None,
+                      rng_stream_index_offset = 0, ntallybins = 10 ):
+    """Propagate many neutrons through a single volume of the material given by
+    the cfg-string, with the built-in transport engine (see
+    NCMiniTransport.hh). The geometry is centred at the origin, with lengths in
+    meters, and must be one of ('slab',thickness), ('box',dx,dy,dz),
+    ('cylinder',radius,height) with the axis along y, or ('sphere',radius).
+
+    The neutron positions and directions are arrays with shape (n,3), while
+    ekin (eV) and weight can be arrays or scalars. The absorption mode is one
+    of 'none', 'weight' (continuous weight reduction) and 'terminate'. Neutrons
+    are abandoned after maxscat scatterings, and handled in batches using
+    multiple threads and RNG streams like Scatter.sampleScatterMany.
+
+    Returns a dictionary with the final positions, directions, ekin and weights
+    of all neutrons, along with their number of scatterings ('nscat') and
+    status ('status': 0=exited, 1=missed, 2=absorbed, 3=abandoned). Summed
+    weights of exiting neutrons by number of scatterings are in
+    'tally_exit_nscat' (the last of the ntallybins bins including all higher
+    numbers), and those of absorbed, missed, and abandoned neutrons in
+    'tally_absorbed', 'tally_missed' and 'tally_abandoned'.
+
+    """
+    shapes = { 'slab' : (0,1), 'box' : (1,3), 'cylinder' : (2,2), 'sphere' : (3,1) }
+    if not geometry or geometry[0] not in shapes or len(geometry) != 1 + shapes[geometry[0]][1]:
+        raise NCBadInput('runMiniTransport(..): invalid geometry parameter: %s'%str(geometry))
+    absmodes = { 'none' : 0, 'weight' : 1, 'terminate' : 2 }
+    if absorption not in absmodes:
+        raise NCBadInput('runMiniTransport(..): absorption must be one of %s'%(', '.join(absmodes.keys())))
+    if nthreads is None:
+        nthreads = os.cpu_count() or 1
+    if not isinstance(nthreads, numbers.Integral) or not 1 <= nthreads <= 4096:
+        raise NCBadInput('runMiniTransport(..): nthreads must be integral and in range [1,4096]')
+    if not isinstance(maxscat, numbers.Integral) or not 1 <= maxscat <= 4294967295:
+        raise NCBadInput('runMiniTransport(..): maxscat must be integral and in range [1,4294967295]')
+    if not isinstance(ntallybins, numbers.Integral) or not 1 <= ntallybins <= 1000000:
+        raise NCBadInput('runMiniTransport(..): ntallybins must be integral and in range [1,1000000]')
+    if ( not isinstance(rng_stream_index_offset, numbers.Integral)
+         or not 0 <= rng_stream_index_offset <= 4294967295 ):
+        raise NCBadInput('runMiniTransport(..): rng_stream_index_offset must be integral and in range [0,4294967295]')
+    info = createInfo(cfgstr)
+    scat = createScatter(cfgstr)
+    absn = createAbsorption(cfgstr)
+    p,d,e,w,nscat,status,tallies = _rawfct['ncrystal_minitransport_mt'](scat._rawobj_scat,absn._rawobj_abs,
+                                                                        info.getNumberDensity(),
+                                                                        shapes[geometry[0]][0],
+                                                                        [float(v) for v in geometry[1:]],
+                                                                        absmodes[absorption],int(maxscat),
+                                                                        int(nthreads),int(rng_stream_index_offset),
+                                                                        pos,direction,ekin,weight,int(ntallybins))
+    return dict( pos = p, direction = d, ekin = e, weight = w, nscat = nscat, status = status,
+                 tally_exit_nscat = tallies[:ntallybins],
+                 tally_absorbed = float(tallies[ntallybins]),
+                 tally_missed = float(tallies[ntallybins+1]),
+                 tally_abandoned = float(tallies[ntallybins+2]) )
+
 def clearInfoCaches():
     """Deprecated. Does the same as clearCaches()"""
     clearCaches()
@@ -2161,48 +2887,57 @@ def hasFactory(name):
     return bool(_rawfct['ncrystal_has_factory'](_str2cstr(name)))
 
 #Helper function, for scripts creating ncmat files:
-def formatVectorForNCMAT(name,values):
+def formatVectorForNCMAT(name,values,base64=False):
     """Utility function for help in python scripts composing .ncmat files,
        transforming an array of of values into a properly formatted text string,
        with word-wrapping, usage of <val>r<n> syntax, etc. Returns list of lines
        (strings) for .ncmat files.
+
+       If base64=True, the values are instead encoded exactly as
+       little-endian 8-byte floating point numbers in base64 encoding, which
+       requires files in NCMAT v7 format or later. This is both more compact
+       and much faster to parse for large arrays.
     """
+    _ensure_numpy()
+    if base64:
+        import base64 as _b64
+        payload = _b64.b64encode(_np.asarray(values,dtype='<f8').flatten().tobytes()).decode('ascii')
+        chunklen = 76
+        out = [ '  %s base64'%name ]
+        out += [ '    %s'%payload[i:i+chunklen] for i in range(0,len(payload),chunklen) ]
+        return ''.join('%s\n'%l for l in out)
+    def _fmtnum(num):
+        _ = '%g'%num if num else '0'#avoid 0.0, -0, etc.
+        if _.startswith('0.'):
+            _=_[1:]
+        return _
     def provideFormattedEntries():
-        def _fmtnum(num):
-            _ = '%g'%num if num else '0'#avoid 0.0, -0, etc.
-            if _.startswith('0.'):
-                _=_[1:]
-            return _
+        #Format each value once (via a list of Python floats, which is much
+        #faster than iterating over numpy scalars), and merge repeated entries:
+        fmtvals = [ _fmtnum(x) for x in _np.asarray(values,dtype=float).flatten().tolist() ]
         i=0
-        v=values.flatten()
-        nv=len(v)
+        nv=len(fmtvals)
         while i<nv:
-            fmt_vi=_fmtnum(v[i])
+            fmt_vi=fmtvals[i]
             #check if is repeated:
             irepeat=i
-            while irepeat+1<nv:
-                if _fmtnum(v[irepeat+1])==fmt_vi:
-                    irepeat+=1
-                else:
-                    break
-            yield '%sr%i'%(fmt_vi,1+irepeat-i) if irepeat>i else '%s'%fmt_vi
+            while irepeat+1<nv and fmtvals[irepeat+1]==fmt_vi:
+                irepeat+=1
+            yield '%sr%i'%(fmt_vi,1+irepeat-i) if irepeat>i else fmt_vi
             i=irepeat+1#advance
-    out=''
+    out=[]
     line='  %s'%name
     collim=80
     for e in provideFormattedEntries():
         snext=' %s'%e
-        line_next=line+snext
-        if len(line_next)>collim:
-            out += line
-            out += '\n'
+        if len(line)+len(snext)>collim:
+            out.append(line)
             line = '   '+snext
         else:
-            line = line_next
+            line += snext
     if line:
-        out += line
-        out += '\n'
-    return out
+        out.append(line)
+    return ''.join('%s\n'%l for l in out)
 
 #Accept custom random generator:
 def setDefaultRandomGenerator(rg, keepalive=True):
@@ -2437,6 +3172,7 @@ class TextData:
         self.__uid = int(l[1])
         self.__dsn = l[2]
         self.__datatype= l[3]
+        import pathlib
         self.__rp = pathlib.Path(l[4]) if l[4] else None
 
     @property
@@ -2489,6 +3225,7 @@ def getFileContents(name):
 
 def addCustomSearchDirectory(dirpath):
     """Register custom directories to be monitored for data files."""
+    import pathlib
     _rawfct['ncrystal_add_custom_search_dir'](_str2cstr(str(pathlib.Path(dirpath).resolve())))
 
 def removeCustomSearchDirectories():
@@ -2535,6 +3272,7 @@ def enableStandardDataLibrary( enable = True, dirpath_override = None ):
        enabled. In all cases, the location can be overridden if explicitly
        provided by the user as the second parameter to this function.
     """
+    import pathlib
     d = _str2cstr(str(pathlib.Path(dirpath_override).resolve())) if dirpath_override else ctypes.cast(None, ctypes.c_char_p)
     _rawfct['ncrystal_enable_stddatalib'](1 if enable else 0, d)
 
@@ -2596,6 +3334,7 @@ def decodeCfg(cfgstr,*,asJSONStr=False):
     _js = _rawfct['nc_cfgstr2json'](cfgstr)
     if asJSONStr:
         return _js
+    import json
     return json.loads(_js)
 
 def generateCfgStrDoc( mode = "print" ):
@@ -2613,6 +3352,7 @@ def generateCfgStrDoc( mode = "print" ):
     if mode == 'print':
         print(_)
     else:
+        import json
         return json.loads(_) if mode=='python' else _
 
 def test():
@@ -2732,7 +3472,7 @@ def _actualtest():
                  ( 0.06966887424392498, 0.11122479793760214 ),
                  ( 0.040517211926276296, -0.8699967641614244 ) ]
 
-    if _np is None:
+    if not _np:
         ekin,mu=[],[]
         for i in range(30):
             _ekin,_mu=nipc.sampleScatterIsotropic(wl2ekin(nipc_testwl))